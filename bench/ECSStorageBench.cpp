@@ -0,0 +1,168 @@
+#include "ecs/ECSManager.h"
+#include "ecs/Component.h"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <set>
+#include <typeindex>
+#include <unordered_map>
+#include <vector>
+
+// One LOD-style pass over N entities with transform, render and LOD components,
+// a third of them also trees, in two storage layouts:
+//  - archetype chunks: ECSManager::forEach walking each chunk's columns
+//  - the map-based storage ECSManager had before: one fixed std::array per
+//    component type behind unordered_maps from entity to slot, walked through
+//    the system's std::set of entities with a lookup per component
+// The legacy layout is copied here as it was, minus the component base class
+// with its vtable, so both sides store the same structs.
+namespace {
+class LegacyComponentArray {
+public:
+    virtual ~LegacyComponentArray() = default;
+};
+
+template<typename T>
+class LegacyTypedComponentArray : public LegacyComponentArray {
+public:
+    void insertComponent(EntityID entity, T component) {
+        size_t newIndex = m_size;
+        m_entityToIndex[entity] = newIndex;
+        m_indexToEntity[newIndex] = entity;
+        m_componentArray[newIndex] = component;
+        ++m_size;
+    }
+
+    T& getComponent(EntityID entity) {
+        return m_componentArray[m_entityToIndex[entity]];
+    }
+
+    static constexpr size_t MAX_ENTITIES = 10000;
+
+private:
+    std::array<T, MAX_ENTITIES> m_componentArray{};
+    std::unordered_map<EntityID, size_t> m_entityToIndex{};
+    std::unordered_map<size_t, EntityID> m_indexToEntity{};
+    size_t m_size{0};
+};
+
+class LegacyComponentManager {
+public:
+    template<typename T>
+    void registerComponent() {
+        m_componentArrays[std::type_index(typeid(T))] = std::make_shared<LegacyTypedComponentArray<T>>();
+    }
+
+    template<typename T>
+    void addComponent(EntityID entity, T component) {
+        getComponentArray<T>()->insertComponent(entity, component);
+    }
+
+    template<typename T>
+    T& getComponent(EntityID entity) {
+        return getComponentArray<T>()->getComponent(entity);
+    }
+
+private:
+    template<typename T>
+    std::shared_ptr<LegacyTypedComponentArray<T>> getComponentArray() {
+        return std::static_pointer_cast<LegacyTypedComponentArray<T>>(m_componentArrays[std::type_index(typeid(T))]);
+    }
+
+    std::unordered_map<std::type_index, std::shared_ptr<LegacyComponentArray>> m_componentArrays{};
+};
+
+constexpr int ITERATIONS = 20;
+
+TransformComponent makeTransform(uint32_t i) {
+    return TransformComponent(glm::vec3(static_cast<float>(i % 100) * 3.0f, 0.0f, static_cast<float>(i / 100) * 3.0f));
+}
+
+void updateLOD(const TransformComponent& transform, RenderComponent& render, LODComponent& lod,
+               const glm::vec3& cameraPos) {
+    lod.updateLOD(glm::length(transform.position - cameraPos));
+    render.visible = lod.shouldRender();
+}
+
+template<typename Func>
+double bestMs(Func func) {
+    double best = 1e30;
+    for (int i = 0; i < ITERATIONS; i++) {
+        auto start = std::chrono::high_resolution_clock::now();
+        func();
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+        best = std::min(best, ms);
+    }
+    return best;
+}
+
+void run(uint32_t count) {
+    glm::vec3 cameraPos(150.0f, 10.0f, 50.0f);
+
+    ECSManager ecs;
+    ecs.registerComponent<TransformComponent>();
+    ecs.registerComponent<RenderComponent>();
+    ecs.registerComponent<LODComponent>();
+    ecs.registerComponent<TreeComponent>();
+
+    auto legacy = std::make_unique<LegacyComponentManager>();
+    legacy->registerComponent<TransformComponent>();
+    legacy->registerComponent<RenderComponent>();
+    legacy->registerComponent<LODComponent>();
+    legacy->registerComponent<TreeComponent>();
+    std::set<EntityID> legacyEntities;
+
+    for (uint32_t i = 0; i < count; i++) {
+        EntityID entity = ecs.createEntity();
+        ecs.addComponent(entity, makeTransform(i));
+        ecs.addComponent(entity, RenderComponent());
+        ecs.addComponent(entity, LODComponent());
+
+        legacy->addComponent(i, makeTransform(i));
+        legacy->addComponent(i, RenderComponent());
+        legacy->addComponent(i, LODComponent());
+        legacyEntities.insert(i);
+
+        if (i % 3 == 0) {
+            ecs.addComponent(entity, TreeComponent());
+            legacy->addComponent(i, TreeComponent());
+        }
+    }
+
+    double chunkMs = bestMs([&]() {
+        ecs.forEach<TransformComponent, RenderComponent, LODComponent>(
+            [&](EntityID, TransformComponent& transform, RenderComponent& render, LODComponent& lod) {
+                updateLOD(transform, render, lod, cameraPos);
+            });
+    });
+    double legacyMs = bestMs([&]() {
+        for (EntityID entity : legacyEntities) {
+            updateLOD(legacy->getComponent<TransformComponent>(entity), legacy->getComponent<RenderComponent>(entity),
+                      legacy->getComponent<LODComponent>(entity), cameraPos);
+        }
+    });
+
+    // Both passes must have done the same work
+    size_t visible = 0;
+    size_t legacyVisible = 0;
+    ecs.forEach<RenderComponent>([&](EntityID, RenderComponent& render) { visible += render.visible; });
+    for (EntityID entity : legacyEntities) {
+        legacyVisible += legacy->getComponent<RenderComponent>(entity).visible;
+    }
+
+    std::cout << "  " << count << " entities: archetype chunks " << chunkMs * 1000.0 << " us ("
+              << chunkMs * 1e6 / count << " ns/entity), map-based " << legacyMs * 1000.0 << " us ("
+              << legacyMs * 1e6 / count << " ns/entity), " << legacyMs / chunkMs << "x"
+              << (visible == legacyVisible ? "" : " MISMATCH") << std::endl;
+}
+}
+
+int main() {
+    std::cout << "ECSStorageBench: LOD pass, best of " << ITERATIONS << std::endl;
+    for (uint32_t count : {1000u, 5000u, 10000u}) {
+        run(count);
+    }
+    return 0;
+}
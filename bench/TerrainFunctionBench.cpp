@@ -0,0 +1,54 @@
+#include "core/TerrainFunction.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+// Heights of one terrain tile's worth of positions, per call to height() and
+// in one heights() batch, as TerrainTileCache and entity placement request them
+namespace {
+constexpr uint32_t TILE_SIZE = 256;
+constexpr int ITERATIONS = 50;
+
+template<typename Func>
+double bestMs(Func func) {
+    double best = 1e30;
+    for (int i = 0; i < ITERATIONS; i++) {
+        auto start = std::chrono::high_resolution_clock::now();
+        func();
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+        best = std::min(best, ms);
+    }
+    return best;
+}
+}
+
+int main() {
+    std::vector<float> x;
+    std::vector<float> z;
+    for (uint32_t row = 0; row < TILE_SIZE; row++) {
+        for (uint32_t column = 0; column < TILE_SIZE; column++) {
+            x.push_back(1000.0f + static_cast<float>(column) * 0.5f);
+            z.push_back(-500.0f + static_cast<float>(row) * 0.5f);
+        }
+    }
+    std::vector<float> heights(x.size());
+    TerrainFunction::Parameters parameters;
+
+    double scalarMs = bestMs([&]() {
+        for (size_t i = 0; i < x.size(); i++) {
+            heights[i] = TerrainFunction::height(glm::vec2(x[i], z[i]), parameters);
+        }
+    });
+    double batchMs = bestMs([&]() {
+        TerrainFunction::heights(x.data(), z.data(), heights.data(), heights.size(), parameters);
+    });
+
+    double positions = static_cast<double>(x.size());
+    std::cout << "TerrainFunctionBench: " << x.size() << " positions, best of " << ITERATIONS << std::endl;
+    std::cout << "  scalar height()  " << scalarMs << " ms (" << positions / scalarMs / 1000.0 << " M/s)" << std::endl;
+    std::cout << "  heights() " << TerrainFunction::batchKernel() << "   " << batchMs << " ms ("
+              << positions / batchMs / 1000.0 << " M/s), " << scalarMs / batchMs << "x" << std::endl;
+    return 0;
+}
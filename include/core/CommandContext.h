@@ -0,0 +1,51 @@
+#pragma once
+
+#include "core/VulkanDevice.h"
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+class TimelineSemaphore;
+
+// Cross-queue dependency: wait until timeline reaches value before stageMask
+struct TimelineWait {
+    TimelineSemaphore* timeline;
+    uint64_t value;
+    VkPipelineStageFlags stageMask;
+};
+
+// One-shot command recording for a single queue. Buffers are recycled once the
+// queue's timeline passes their submission, so callers never block on the CPU
+// unless they explicitly wait on the returned value.
+class CommandContext {
+public:
+    CommandContext(VulkanDevice* device, VulkanDevice::QueueType queueType);
+    ~CommandContext();
+
+    CommandContext(const CommandContext&) = delete;
+    CommandContext& operator=(const CommandContext&) = delete;
+
+    // Start recording a one-time-submit command buffer
+    VkCommandBuffer begin();
+    // End and submit; returns the timeline value signaled on completion
+    uint64_t submit(VkCommandBuffer commandBuffer, const std::vector<TimelineWait>& waits = {});
+    // Submit and block until the queue has executed it
+    void submitAndWait(VkCommandBuffer commandBuffer, const std::vector<TimelineWait>& waits = {});
+
+    uint32_t getQueueFamily() const { return m_queueFamily; }
+    TimelineSemaphore* getTimeline() const { return m_timeline; }
+
+private:
+    void recycleCompleted();
+
+    VulkanDevice* m_device;
+    VkQueue m_queue{VK_NULL_HANDLE};
+    uint32_t m_queueFamily{0};
+    TimelineSemaphore* m_timeline{nullptr};
+    VkCommandPool m_commandPool{VK_NULL_HANDLE};
+
+    std::vector<std::pair<uint64_t, VkCommandBuffer>> m_inFlight;
+    std::vector<VkCommandBuffer> m_freeBuffers;
+    uint64_t m_lastSubmittedValue{0};
+};
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+class TimelineSemaphore;
+
+// Deferred destruction of GPU resources. Each release is tagged with the
+// timeline value of its last use and runs once the GPU has passed it, so
+// freeing a resource never needs vkDeviceWaitIdle.
+class DeletionQueue {
+public:
+    explicit DeletionQueue(TimelineSemaphore* timeline);
+    ~DeletionQueue();
+
+    // Destroy once the timeline reaches timelineValue
+    void push(uint64_t timelineValue, std::function<void()> deleter);
+    // Destroy once everything submitted so far has completed
+    void push(std::function<void()> deleter);
+    // Destroy once another queue's timeline reaches timelineValue
+    void push(TimelineSemaphore* timeline, uint64_t timelineValue, std::function<void()> deleter);
+
+    // Keep an owning object alive until the GPU is done with it
+    template<typename T>
+    void retire(std::unique_ptr<T> object, uint64_t timelineValue) {
+        std::shared_ptr<T> shared = std::move(object);
+        push(timelineValue, [shared]() mutable { shared.reset(); });
+    }
+
+    // Keep an owning object alive until another timeline reaches timelineValue
+    template<typename T>
+    void retire(std::unique_ptr<T> object, TimelineSemaphore* timeline, uint64_t timelineValue) {
+        std::shared_ptr<T> shared = std::move(object);
+        push(timeline, timelineValue, [shared]() mutable { shared.reset(); });
+    }
+
+    template<typename T>
+    void retire(std::unique_ptr<T> object) {
+        retire(std::move(object), currentValue());
+    }
+
+    // Run every deleter the GPU has passed; call once per frame
+    void collect();
+    // Run everything regardless of GPU progress; the device must be idle
+    void flush();
+
+    size_t getPendingCount() const;
+
+private:
+    struct Entry {
+        TimelineSemaphore* timeline;
+        uint64_t timelineValue;
+        std::function<void()> deleter;
+    };
+
+    uint64_t currentValue() const;
+
+    TimelineSemaphore* m_timeline;
+    std::vector<Entry> m_entries;
+    mutable std::mutex m_mutex;
+};
@@ -39,6 +39,8 @@ struct Frustum {
     void extractFromMatrix(const glm::mat4& viewProj);
     bool isVisible(const BoundingSphere& sphere) const;
     bool isVisible(const glm::vec3& point, float radius) const;
+    // Axis-aligned box; conservative near the frustum's corners
+    bool isBoxVisible(const glm::vec3& min, const glm::vec3& max) const;
 };
 
 class FrustumCuller {
@@ -47,6 +49,7 @@ public:
     
     void updateFrustum(const glm::mat4& viewMatrix, const glm::mat4& projMatrix);
     bool isVisible(const glm::vec3& position, float radius) const;
+    bool isBoxVisible(const glm::vec3& min, const glm::vec3& max) const;
     
     // LOD calculation
     float calculateLOD(const glm::vec3& position, const glm::vec3& cameraPos) const;
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+// Per-frame latency milestones, one record per frame in flight.
+// "GPU complete" is when the frame's work was seen finished by polling its
+// fence or timeline value, once per frame. That is no earlier than the point
+// the presentation engine may pick the image up, and is not the time it
+// actually reached the display.
+// "Present" is when VK_KHR_present_wait reported the frame's present ID as
+// shown, so it covers compositor and display queueing as well. It is only
+// measured on devices with present wait, and is likewise observed by polling.
+class LatencyTracker {
+public:
+    using Clock = std::chrono::high_resolution_clock;
+
+    explicit LatencyTracker(uint32_t frameSlots = 2);
+
+    void reset(uint32_t frameSlots);
+
+    void markInputSampled();
+    void markSubmitted(uint32_t frameSlot);
+    void markCompleted(uint32_t frameSlot);
+    bool isPending(uint32_t frameSlot) const;
+
+    // Present IDs are handed out in increasing order, so they complete in the
+    // order they were queued and only the oldest needs polling
+    void markPresentQueued(uint32_t frameSlot, uint64_t presentId);
+    bool getOldestPendingPresent(uint64_t& presentId) const;
+    void markOldestPresented();
+    // Present IDs belong to a swap chain; the old one's are never waited on
+    void dropPendingPresents();
+
+    // Smoothed timings in seconds
+    float getInputToSubmit() const { return m_inputToSubmit; }
+    float getSubmitToGpuComplete() const { return m_submitToGpuComplete; }
+    float getInputToGpuComplete() const { return m_inputToGpuComplete; }
+    bool hasPresentTimings() const { return m_presentMeasured; }
+    float getSubmitToPresent() const { return m_submitToPresent; }
+    float getInputToPresent() const { return m_inputToPresent; }
+
+private:
+    struct FrameRecord {
+        Clock::time_point inputSampled;
+        Clock::time_point submitted;
+        bool pending = false;
+    };
+
+    struct PendingPresent {
+        uint64_t presentId;
+        Clock::time_point inputSampled;
+        Clock::time_point submitted;
+    };
+
+    static void accumulate(float& average, float sample);
+
+    std::vector<FrameRecord> m_frames;
+    std::deque<PendingPresent> m_presents;
+    Clock::time_point m_lastInputSample;
+
+    float m_inputToSubmit{0.0f};
+    float m_submitToGpuComplete{0.0f};
+    float m_inputToGpuComplete{0.0f};
+    float m_submitToPresent{0.0f};
+    float m_inputToPresent{0.0f};
+    bool m_presentMeasured{false};
+};
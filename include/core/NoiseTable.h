@@ -0,0 +1,27 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <vector>
+
+// Tileable value noise shared by the CPU and the GPU. A SIZE x SIZE lattice of
+// 8-bit values is built once from an integer hash; the renderer uploads it as a
+// texture (see NoiseTexture) and CPU code reads the very same bytes here, so both
+// sides agree on every lattice value on every machine, where hashing with
+// fract(sin(x) * 43758) differs with each GPU's sine precision.
+//
+// Lattice point (i, j) sits at p = (i + 0.5, j + 0.5), the texel center, so
+// value(p) is what a linearly filtered fetch at uv = p / SIZE returns from the
+// texture's top level. Everything repeats every SIZE units.
+class NoiseTable {
+public:
+    static constexpr uint32_t SIZE = 256;
+
+    // Lattice value in [0, 1] at integer point (x, y), wrapped into the table
+    static float lattice(int32_t x, int32_t y);
+    // Bilinearly interpolated lattice, in [0, 1]
+    static float value(const glm::vec2& p);
+
+    // SIZE x SIZE R8 texels, row-major, for upload
+    static const std::vector<uint8_t>& texels();
+};
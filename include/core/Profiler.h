@@ -0,0 +1,86 @@
+#pragma once
+
+#include "core/VulkanDevice.h"
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// GPU timestamp profiler. Each frame slot owns a query pool; results are read
+// back when the slot comes around again, after VulkanSync has waited for it,
+// so reading never stalls the GPU. Where the device has pipelineStatisticsQuery,
+// a slot can also count fragment shader invocations over one section of the frame.
+class Profiler {
+public:
+    struct ScopeTiming {
+        std::string name;
+        double gpuMs;
+    };
+
+    struct CpuTiming {
+        std::string name;
+        double cpuMs;
+    };
+
+    Profiler(VulkanDevice* device, uint32_t framesInFlight, uint32_t maxScopes = 32);
+    ~Profiler();
+
+    // Call right after vkBeginCommandBuffer; the slot's previous submission must be complete
+    void beginFrame(VkCommandBuffer commandBuffer, uint32_t frameIndex);
+    void endFrame(VkCommandBuffer commandBuffer);
+
+    // Returns a scope id for endScope, or UINT32_MAX when out of queries
+    uint32_t beginScope(VkCommandBuffer commandBuffer, const std::string& name);
+    void endScope(VkCommandBuffer commandBuffer, uint32_t scope);
+
+    // At most one statistics section per frame; may be recorded inside a render pass.
+    // The tag comes back with the result, so callers can tell which mode a frame ran in.
+    void beginStatistics(VkCommandBuffer commandBuffer, uint32_t tag = 0);
+    void endStatistics(VkCommandBuffer commandBuffer);
+
+    // Results of the most recently completed frame
+    const std::vector<ScopeTiming>& getTimings() const { return m_timings; }
+    double getFrameGpuMs() const { return m_frameGpuMs; }
+    bool isSupported() const { return m_supported; }
+    uint64_t getFragmentInvocations() const { return m_fragmentInvocations; }
+    uint32_t getStatisticsTag() const { return m_statisticsTag; }
+    bool hasStatistics() const { return m_statisticsValid; }
+    bool isStatisticsSupported() const { return m_statisticsSupported; }
+
+    // CPU work timed by the caller (ECS systems, for one), main thread only.
+    // Timings added during a frame are returned from the next beginFrame on.
+    void addCpuTiming(const std::string& name, double cpuMs);
+    const std::vector<CpuTiming>& getCpuTimings() const { return m_cpuTimings; }
+
+private:
+    struct FrameSlot {
+        VkQueryPool queryPool{VK_NULL_HANDLE};
+        VkQueryPool statisticsPool{VK_NULL_HANDLE};
+        std::vector<std::string> scopeNames;
+        bool recorded{false};
+        bool statisticsRecorded{false};
+        uint32_t statisticsTag{0};
+    };
+
+    void readResults(FrameSlot& slot);
+
+    VulkanDevice* m_device;
+    uint32_t m_maxScopes;
+    uint32_t m_queryCount;
+    bool m_supported{false};
+    bool m_statisticsSupported{false};
+    bool m_statisticsActive{false};
+    double m_timestampPeriod{1.0}; // Nanoseconds per tick
+    uint64_t m_timestampMask{~0ull};
+
+    std::vector<FrameSlot> m_slots;
+    FrameSlot* m_currentSlot{nullptr};
+
+    std::vector<ScopeTiming> m_timings;
+    std::vector<CpuTiming> m_cpuTimings;
+    std::vector<CpuTiming> m_pendingCpuTimings;
+    double m_frameGpuMs{0.0};
+    uint64_t m_fragmentInvocations{0};
+    uint32_t m_statisticsTag{0};
+    bool m_statisticsValid{false};
+};
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <cstdint>
+
+// Queue family ownership transfers for resources created with
+// VK_SHARING_MODE_EXCLUSIVE. A release is recorded on the source queue and a
+// matching acquire on the destination queue; the destination submission must
+// also wait on the source queue's timeline. When both families are the same
+// the release is skipped and the acquire degrades to a plain barrier.
+class QueueOwnership {
+public:
+    static void releaseBuffer(VkCommandBuffer commandBuffer, VkBuffer buffer,
+                              uint32_t srcFamily, uint32_t dstFamily,
+                              VkAccessFlags srcAccess, VkPipelineStageFlags srcStage);
+    static void acquireBuffer(VkCommandBuffer commandBuffer, VkBuffer buffer,
+                              uint32_t srcFamily, uint32_t dstFamily,
+                              VkAccessFlags dstAccess, VkPipelineStageFlags dstStage);
+
+    // Layout transitions travel with the transfer: oldLayout/newLayout must
+    // match between the release and the acquire. Covers mipLevels levels and
+    // the first layers array layers.
+    static void releaseImage(VkCommandBuffer commandBuffer, VkImage image, uint32_t mipLevels,
+                             VkImageLayout oldLayout, VkImageLayout newLayout,
+                             uint32_t srcFamily, uint32_t dstFamily,
+                             VkAccessFlags srcAccess, VkPipelineStageFlags srcStage, uint32_t layers = 1);
+    static void acquireImage(VkCommandBuffer commandBuffer, VkImage image, uint32_t mipLevels,
+                             VkImageLayout oldLayout, VkImageLayout newLayout,
+                             uint32_t srcFamily, uint32_t dstFamily,
+                             VkAccessFlags dstAccess, VkPipelineStageFlags dstStage, uint32_t layers = 1);
+};
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <cstddef>
+
+// The procedural terrain height function on the CPU. Terrain tiles are generated
+// from it (see TerrainTileCache) and entities are placed with it, so this is the
+// one definition of the ground: terrain.frag and terrain_mesh.* only ever sample
+// what it produced.
+//
+// heights() evaluates many positions at once. Where the CPU allows it runs 8
+// lanes at a time with AVX2 (4 with NEON), using polynomial sin/cos instead of
+// the C library; results agree with height() to within a few millionths of
+// terrainHeight.
+class TerrainFunction {
+public:
+    // Everything the heights depend on
+    struct Parameters {
+        float terrainScale{1.0f};
+        float terrainHeight{25.0f};
+        int qualityLevel{2};
+
+        bool operator==(const Parameters& other) const {
+            return terrainScale == other.terrainScale && terrainHeight == other.terrainHeight &&
+                   qualityLevel == other.qualityLevel;
+        }
+        bool operator!=(const Parameters& other) const { return !(*this == other); }
+    };
+
+    // Bounds of height() in units of terrainHeight / 100, for any position and quality
+    static constexpr float HEIGHT_MIN = -58.0f;
+    static constexpr float HEIGHT_MAX = 44.0f;
+
+    // Height relative to the terrain's zero level at world XZ position p
+    static float height(const glm::vec2& p, const Parameters& parameters);
+    // Surface normal from central differences eps apart
+    static glm::vec3 normal(const glm::vec2& p, float eps, const Parameters& parameters);
+    // height() of count positions (x[i], z[i]) into heights[i]
+    static void heights(const float* x, const float* z, float* heights, size_t count,
+                        const Parameters& parameters);
+    // Name of the kernel heights() runs on this CPU: "avx2", "neon" or "scalar"
+    static const char* batchKernel();
+
+private:
+    // SIMD kernels, defined in TerrainFunctionSimd.cpp for the architectures it is built for
+    static void heightsAvx2(const float* x, const float* z, float* heights, size_t count,
+                            const Parameters& parameters);
+    static void heightsNeon(const float* x, const float* z, float* heights, size_t count,
+                            const Parameters& parameters);
+
+    static float hash21(const glm::vec2& p);
+    static float noise(const glm::vec2& p);
+    static float fbm(glm::vec2 p, int octaves);
+};
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+#include <cstdint>
+
+class VulkanDevice;
+
+// One timeline semaphore per queue. Every submission to the queue signals the
+// next value, so "has the GPU finished X" becomes a single counter comparison.
+class TimelineSemaphore {
+public:
+    TimelineSemaphore(VulkanDevice* device, uint64_t initialValue = 0);
+    ~TimelineSemaphore();
+
+    VkSemaphore getSemaphore() const { return m_semaphore; }
+
+    // Reserve the value the next submission on this queue will signal.
+    // Submissions must happen in the order the values were reserved.
+    uint64_t nextValue() { return ++m_lastSignaledValue; }
+    uint64_t getLastSignaledValue() const { return m_lastSignaledValue; }
+
+    uint64_t getCompletedValue() const;
+    bool isComplete(uint64_t value) const { return value <= getCompletedValue(); }
+    void wait(uint64_t value, uint64_t timeout = UINT64_MAX) const;
+
+private:
+    VulkanDevice* m_device;
+    VkSemaphore m_semaphore{VK_NULL_HANDLE};
+    uint64_t m_lastSignaledValue;
+};
@@ -8,9 +8,22 @@
 #include "core/WindowManager.h"
 #include "core/VulkanDevice.h"
 #include "core/VulkanSync.h"
+#include "core/LatencyTracker.h"
+#include "core/TimelineSemaphore.h"
+#include "core/Profiler.h"
 #include "debug/VulkanDebug.h"
 #include "rendering/SwapChain.h"
 #include "rendering/GraphicsPipeline.h"
+#include "rendering/RenderGraph.h"
+#include "rendering/ClusteredLighting.h"
+#include "rendering/CascadedShadowMaps.h"
+#include "rendering/ImageBasedLighting.h"
+#include "rendering/TemporalUpscaler.h"
+#include "rendering/WeightedBlendedOIT.h"
+#include "rendering/HiZOcclusionCuller.h"
+#include "rendering/PostProcessor.h"
+#include "rendering/RenderManager.h"
+#include "scene/Scene.h"
 #include "ui/DebugUI.h"
 #include "viewer/GLTFViewer.h"
 #include <memory>
@@ -34,14 +47,23 @@ private:
     const bool enableValidationLayers = true;
 #endif
 
+    // Use VK_KHR_dynamic_rendering / synchronization2 where supported; false forces the render pass path
+    const bool enableDynamicRendering = true;
+
     void initVulkan();
     void mainLoop();
     void cleanup();
     void createInstance();
     void createSurface();
-    void createFramebuffers();
     void drawFrame();
+    void buildFrameGraph(uint32_t imageIndex);
     void recreateSwapChain();
+    void createSwapChainResources(VkExtent2D extent);
+    void applyPresentationSettings();
+    void applyEnvironmentSettings();
+    void applyResolutionScaling();
+    void collectLatencySamples();
+    void updateScene(const glm::vec3& cameraPos, const glm::mat4& viewMatrix, const glm::mat4& projMatrix);
     void updatePerformanceStats();
     void processInput();
     void setupInputCallbacks();
@@ -52,19 +74,44 @@ private:
     void onScroll(double xoffset, double yoffset);
     void onKey(int key, int scancode, int action, int mods);
     void onDrop(int count, const char** paths);
+    
+    static VkPresentModeKHR toVkPresentMode(int presentMode);
+    static int fromVkPresentMode(VkPresentModeKHR presentMode);
 
     std::unique_ptr<WindowManager> m_windowManager;
     std::unique_ptr<VulkanDevice> m_device;
     std::unique_ptr<SwapChain> m_swapChain;
     std::unique_ptr<GraphicsPipeline> m_pipeline;
-    std::unique_ptr<Framebuffer> m_framebuffer;
+    std::unique_ptr<RenderGraph> m_renderGraph;
+    std::unique_ptr<ClusteredLighting> m_clusteredLighting;
+    std::unique_ptr<CascadedShadowMaps> m_shadowMaps;
+    std::unique_ptr<ImageBasedLighting> m_imageBasedLighting;
+    std::unique_ptr<TemporalUpscaler> m_temporalUpscaler;
+    std::unique_ptr<WeightedBlendedOIT> m_weightedOIT;
+    std::unique_ptr<HiZOcclusionCuller> m_occlusionCuller;
+    std::unique_ptr<PostProcessor> m_postProcessor;
+    std::unique_ptr<RenderManager> m_renderManager;
     std::unique_ptr<VulkanSync> m_sync;
+    // Signaled with the frame number by frame submits only; other graphics
+    // submits advance the graphics timeline, so it cannot count presents
+    std::unique_ptr<TimelineSemaphore> m_frameTimeline;
+    std::unique_ptr<Profiler> m_profiler;
     std::unique_ptr<DebugUI> m_debugUI;
     std::unique_ptr<GLTFViewer> m_viewer;
+    // Entities streamed over the terrain; simulated only, the render list is not drawn yet
+    std::unique_ptr<Scene> m_scene;
+    FrustumCuller m_sceneCuller;
 
     VkInstance m_instance{VK_NULL_HANDLE};
     VkSurfaceKHR m_surface{VK_NULL_HANDLE};
     VkDebugUtilsMessengerEXT m_debugMessenger{VK_NULL_HANDLE};
+    uint32_t m_instanceApiVersion{VK_API_VERSION_1_2};
+    uint32_t m_lightsGeneration{0}; // Loader generation the clustered light list was built from
+    uint32_t m_cullObjectsGeneration{0}; // Loader generation the occlusion culler's objects came from
+
+    // Scene resolution for this frame; below the swap chain's while upscaling
+    bool m_upscaleActive{false};
+    VkExtent2D m_renderExtent{0, 0};
 
     // Timing
     std::chrono::high_resolution_clock::time_point m_startTime;
@@ -75,7 +122,12 @@ private:
     PerformanceStats m_performanceStats;
     BackgroundSettings m_backgroundSettings;
 
-    static constexpr int MAX_FRAMES_IN_FLIGHT = 2;
+    // Presentation settings the current swap chain was built with
+    int m_appliedPresentMode{-1};
+    int m_appliedFramesInFlight{0};
+    int m_appliedImageCount{-1};
+    LatencyTracker m_latencyTracker;
+    uint64_t m_presentId{0}; // Last ID attached to a present, with present wait
 };
 
 #endif // VULKANAPP_H
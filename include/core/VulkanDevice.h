@@ -1,14 +1,22 @@
 #pragma once
 
 #include <vulkan/vulkan.h>
+#include <memory>
 #include <optional>
 #include <vector>
 
+class TimelineSemaphore;
+class DeletionQueue;
+
 class VulkanDevice {
 public:
+    enum class QueueType { Graphics, Transfer, Compute };
+
     struct QueueFamilyIndices {
         std::optional<uint32_t> graphicsFamily;
         std::optional<uint32_t> presentFamily;
+        std::optional<uint32_t> transferFamily; // Transfer-only family (DMA engine), if any
+        std::optional<uint32_t> computeFamily;  // Compute family without graphics, if any
 
         bool isComplete() {
             return graphicsFamily.has_value() && presentFamily.has_value();
@@ -30,10 +38,19 @@ public:
     QueueFamilyIndices findQueueFamilies(VkPhysicalDevice device);
     SwapChainSupportDetails querySwapChainSupport(VkPhysicalDevice device);
     static VkSurfaceFormatKHR chooseSwapSurfaceFormat(const std::vector<VkSurfaceFormatKHR>& availableFormats);
-    static VkPresentModeKHR chooseSwapPresentMode(const std::vector<VkPresentModeKHR>& availablePresentModes);
+    static VkPresentModeKHR chooseSwapPresentMode(const std::vector<VkPresentModeKHR>& availablePresentModes,
+                                                  VkPresentModeKHR preferredMode = VK_PRESENT_MODE_FIFO_KHR);
     void setSurface(VkSurfaceKHR newSurface) {
         surface = newSurface;
     }
+    // Call before createLogicalDevice; the device's usable API version is capped by the instance's
+    void setInstanceApiVersion(uint32_t apiVersion) {
+        m_instanceApiVersion = apiVersion;
+    }
+    // Allow dynamic rendering / synchronization2 when the device supports them
+    void setModernRenderingEnabled(bool enabled) {
+        m_modernRenderingEnabled = enabled;
+    }
 
     // Getters
     [[nodiscard]] VkDevice getDevice() const {
@@ -48,22 +65,113 @@ public:
     [[nodiscard]] VkQueue getPresentQueue() const {
         return m_presentQueue;
     }
+    // Transfer and compute fall back to the graphics queue when no dedicated family exists
+    [[nodiscard]] VkQueue getTransferQueue() const {
+        return m_transferQueue;
+    }
+    [[nodiscard]] VkQueue getComputeQueue() const {
+        return m_computeQueue;
+    }
+    [[nodiscard]] bool hasDedicatedTransferQueue() const {
+        return m_queueFamilies.transferFamily.has_value();
+    }
+    [[nodiscard]] bool hasAsyncComputeQueue() const {
+        return m_queueFamilies.computeFamily.has_value();
+    }
+    [[nodiscard]] const QueueFamilyIndices& getQueueFamilies() const {
+        return m_queueFamilies;
+    }
+    [[nodiscard]] VkQueue getQueue(QueueType type) const;
+    [[nodiscard]] uint32_t getQueueFamily(QueueType type) const;
+    [[nodiscard]] TimelineSemaphore* getTimeline(QueueType type) const;
     [[nodiscard]] VkSurfaceKHR getSurface() const {
         return surface;
     }
     [[nodiscard]] VkInstance getInstance() const {
         return m_instance;
     }
+    // Every graphics queue submission signals the next value of this timeline
+    [[nodiscard]] TimelineSemaphore* getGraphicsTimeline() const {
+        return m_graphicsTimeline.get();
+    }
+    [[nodiscard]] DeletionQueue* getDeletionQueue() const {
+        return m_deletionQueue.get();
+    }
+    [[nodiscard]] uint32_t getApiVersion() const {
+        return m_apiVersion;
+    }
+
+    // VK_KHR_dynamic_rendering / VK_KHR_synchronization2 (core in 1.3). When
+    // unsupported, rendering falls back to render pass objects and vkCmdPipelineBarrier.
+    [[nodiscard]] bool supportsDynamicRendering() const {
+        return m_dynamicRendering;
+    }
+    [[nodiscard]] bool supportsSynchronization2() const {
+        return m_synchronization2;
+    }
+    [[nodiscard]] bool supportsPipelineStatistics() const {
+        return m_pipelineStatistics;
+    }
+    // drawCount > 1 in vkCmdDrawIndexedIndirect; without it each command is issued separately
+    [[nodiscard]] bool supportsMultiDrawIndirect() const {
+        return m_multiDrawIndirect;
+    }
+    // The wireframe overlay's geometry stage; without it the overlay is unavailable
+    [[nodiscard]] bool supportsGeometryShader() const {
+        return m_geometryShader;
+    }
+    // VK_KHR_present_id + VK_KHR_present_wait: presents carry an ID that can be
+    // waited on until the image is shown. Without them latency is only measured
+    // to GPU completion.
+    [[nodiscard]] bool supportsPresentWait() const {
+        return m_presentWait;
+    }
+    // Largest gl_PointSize the points view may write; 1 without largePoints
+    [[nodiscard]] float getMaxPointSize() const {
+        return m_maxPointSize;
+    }
+    void cmdBeginRendering(VkCommandBuffer commandBuffer, const VkRenderingInfo* renderingInfo) const;
+    void cmdEndRendering(VkCommandBuffer commandBuffer) const;
+    void cmdPipelineBarrier2(VkCommandBuffer commandBuffer, const VkDependencyInfo* dependencyInfo) const;
+    VkResult waitForPresent(VkSwapchainKHR swapChain, uint64_t presentId, uint64_t timeout) const;
 
 private:
-    static int rateDeviceSuitability(VkPhysicalDevice device);
+    static bool supportsTimelineSemaphores(VkPhysicalDevice device);
+    static bool hasDeviceExtension(VkPhysicalDevice device, const char* extensionName);
+    void queryRenderingFeatures();
+    bool queryPresentWait();
+    void loadRenderingFunctions();
 
     VkInstance m_instance;
     VkPhysicalDevice m_physicalDevice{VK_NULL_HANDLE};
     VkDevice m_logicalDevice{VK_NULL_HANDLE};
     VkQueue m_graphicsQueue{};
     VkQueue m_presentQueue{};
+    VkQueue m_transferQueue{};
+    VkQueue m_computeQueue{};
     VkSurfaceKHR surface{VK_NULL_HANDLE};
+    QueueFamilyIndices m_queueFamilies;
+
+    // One timeline per queue; shared queues share their timeline
+    std::unique_ptr<TimelineSemaphore> m_graphicsTimeline;
+    std::unique_ptr<TimelineSemaphore> m_transferTimeline;
+    std::unique_ptr<TimelineSemaphore> m_computeTimeline;
+    std::unique_ptr<DeletionQueue> m_deletionQueue;
+
+    uint32_t m_instanceApiVersion{VK_API_VERSION_1_2};
+    uint32_t m_apiVersion{VK_API_VERSION_1_2};
+    bool m_modernRenderingEnabled{true};
+    bool m_dynamicRendering{false};
+    bool m_synchronization2{false};
+    bool m_pipelineStatistics{false};
+    bool m_multiDrawIndirect{false};
+    bool m_geometryShader{false};
+    bool m_presentWait{false};
+    float m_maxPointSize{1.0f};
+    PFN_vkCmdBeginRenderingKHR m_vkCmdBeginRendering{nullptr};
+    PFN_vkCmdEndRenderingKHR m_vkCmdEndRendering{nullptr};
+    PFN_vkCmdPipelineBarrier2KHR m_vkCmdPipelineBarrier2{nullptr};
+    PFN_vkWaitForPresentKHR m_vkWaitForPresent{nullptr};
 
     const std::vector<const char*>& m_validationLayers;
     bool m_enableValidationLayers;
@@ -4,6 +4,10 @@
 #include <vulkan/vulkan.h>
 #include <vector>
 
+// Frame pacing on top of the device's graphics timeline semaphore. Frame slots
+// and swapchain images remember the timeline value of their last submission
+// instead of owning fences. Binary semaphores remain only where the swapchain
+// requires them (acquire and present).
 class VulkanSync {
 public:
     VulkanSync(VulkanDevice* device, uint32_t maxFramesInFlight, uint32_t imageCount);
@@ -12,16 +16,21 @@ public:
     // Get synchronization objects
     VkSemaphore getImageAvailableSemaphore(uint32_t frameIndex) const { return m_imageAvailableSemaphores[frameIndex]; }
     VkSemaphore getRenderFinishedSemaphore(uint32_t imageIndex) const { return m_renderFinishedSemaphores[imageIndex]; }
-    VkFence getInFlightFence(uint32_t frameIndex) const { return m_inFlightFences[frameIndex]; }
-    VkFence* getImageInFlightFence(uint32_t imageIndex) { return &m_imagesInFlight[imageIndex]; }
 
     // Frame management
     void nextFrame() { m_currentFrame = (m_currentFrame + 1) % m_maxFramesInFlight; }
     uint32_t getCurrentFrame() const { return m_currentFrame; }
+    uint32_t getPreviousFrame() const { return (m_currentFrame + m_maxFramesInFlight - 1) % m_maxFramesInFlight; }
+    uint32_t getMaxFramesInFlight() const { return m_maxFramesInFlight; }
+    uint32_t getImageCount() const { return m_imageCount; }
 
-    // Fence operations
-    void waitForFence(uint32_t frameIndex) const;
-    void resetFence(uint32_t frameIndex) const;
+    // Record the timeline value a frame's submission signals
+    void setSubmittedValue(uint32_t frameIndex, uint32_t imageIndex, uint64_t timelineValue);
+
+    // Timeline waits
+    void waitForFrame(uint32_t frameIndex) const;
+    void waitForImage(uint32_t imageIndex) const;
+    bool isFrameComplete(uint32_t frameIndex) const;
 
 private:
     void createSyncObjects();
@@ -34,6 +43,6 @@ private:
 
     std::vector<VkSemaphore> m_imageAvailableSemaphores;  // One per frame
     std::vector<VkSemaphore> m_renderFinishedSemaphores;  // One per swapchain image
-    std::vector<VkFence> m_inFlightFences;                // One per frame
-    std::vector<VkFence> m_imagesInFlight;                // One per swapchain image
+    std::vector<uint64_t> m_frameValues;                  // One per frame
+    std::vector<uint64_t> m_imageValues;                  // One per swapchain image
 };
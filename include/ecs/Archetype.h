@@ -0,0 +1,106 @@
+#pragma once
+
+#include "ecs/Entity.h"
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+
+// What an archetype needs to know about a component type to store it without
+// knowing the type: its layout, and how to move and destroy one in place.
+struct ComponentInfo {
+    size_t size{0};
+    size_t alignment{1};
+    void (*moveConstruct)(void* destination, void* source){nullptr};
+    void (*destroy)(void* component){nullptr};
+
+    template<typename T>
+    static ComponentInfo of() {
+        ComponentInfo info;
+        info.size = sizeof(T);
+        info.alignment = alignof(T);
+        info.moveConstruct = [](void* destination, void* source) {
+            new (destination) T(std::move(*static_cast<T*>(source)));
+        };
+        info.destroy = [](void* component) { static_cast<T*>(component)->~T(); };
+        return info;
+    }
+};
+
+// All entities with exactly one set of components. Entities are packed into
+// fixed-size chunks; inside a chunk each component type is its own contiguous
+// array (plus one array of entity IDs), so a system touching two components of
+// a thousand entities streams through two dense arrays instead of chasing a
+// thousand lookups. Rows are addressed by a single index across all chunks,
+// and removal swaps the last row into the hole to keep every chunk but the
+// last one full.
+class Archetype {
+public:
+    static constexpr size_t CHUNK_SIZE = 16 * 1024;
+    static constexpr size_t CHUNK_ALIGNMENT = 64;
+
+    // infos is indexed by component type ID; only the types in mask are read
+    Archetype(ComponentMask mask, const std::array<ComponentInfo, MAX_COMPONENTS>& infos);
+    ~Archetype();
+
+    Archetype(const Archetype&) = delete;
+    Archetype& operator=(const Archetype&) = delete;
+
+    ComponentMask getMask() const { return m_mask; }
+    uint32_t getSize() const { return m_size; }
+    uint32_t getChunkCapacity() const { return m_chunkCapacity; }
+
+    // Appends a row for entity and returns its index. The row's components are
+    // raw storage: the caller constructs each of them before anything reads it.
+    uint32_t add(EntityID entity);
+    // Destroys the row's components and fills the hole with the last row.
+    // Returns the entity that moved into row, or INVALID_ENTITY if row was last.
+    EntityID remove(uint32_t row);
+    // Move-constructs every component the two archetypes share from row here
+    // into dstRow of destination; remove(row) still has to be called after
+    void moveShared(uint32_t row, Archetype& destination, uint32_t dstRow);
+
+    // type must be in the mask; other types have no column
+    void* getComponent(uint32_t type, uint32_t row) {
+        assert(m_mask.test(type));
+        Chunk& chunk = m_chunks[row / m_chunkCapacity];
+        return chunk.data + m_offsets[type] + (row % m_chunkCapacity) * m_infos[type].size;
+    }
+    EntityID getEntity(uint32_t row) const {
+        return getEntities(row / m_chunkCapacity)[row % m_chunkCapacity];
+    }
+
+    // Chunk-wise access for iteration: rows [0, getChunkCount(chunk)) of each
+    // column are live
+    size_t getChunkCount() const { return m_chunks.size(); }
+    uint32_t getChunkCount(size_t chunk) const { return m_chunks[chunk].count; }
+    const EntityID* getEntities(size_t chunk) const {
+        return reinterpret_cast<const EntityID*>(m_chunks[chunk].data);
+    }
+    void* getColumn(size_t chunk, uint32_t type) {
+        assert(m_mask.test(type));
+        return m_chunks[chunk].data + m_offsets[type];
+    }
+
+private:
+    struct Chunk {
+        std::byte* data{nullptr};
+        uint32_t count{0};
+    };
+
+    void computeLayout();
+    EntityID* entitiesOf(Chunk& chunk) { return reinterpret_cast<EntityID*>(chunk.data); }
+
+    ComponentMask m_mask;
+    std::array<ComponentInfo, MAX_COMPONENTS> m_infos{};
+    // Byte offset of each type's column from the start of a chunk
+    std::array<size_t, MAX_COMPONENTS> m_offsets{};
+    std::vector<uint32_t> m_types;
+    uint32_t m_chunkCapacity{0};
+    std::vector<Chunk> m_chunks;
+    uint32_t m_size{0};
+};
@@ -2,6 +2,7 @@
 
 #include <glm/glm.hpp>
 #include <cstdint>
+#include <cstdlib>
 
 // Component types
 enum class ComponentType : uint32_t {
@@ -13,13 +14,11 @@ enum class ComponentType : uint32_t {
     LOD = 1 << 5
 };
 
-// Base component interface
-struct Component {
-    virtual ~Component() = default;
-};
+// Components are plain data: ECSManager stores them by value in archetype
+// chunks (see Archetype), so they need no common base and carry no vtable
 
 // Transform component
-struct TransformComponent : public Component {
+struct TransformComponent {
     glm::vec3 position{0.0f};
     glm::vec3 rotation{0.0f};
     glm::vec3 scale{1.0f};
@@ -30,7 +29,7 @@ struct TransformComponent : public Component {
 };
 
 // Render component
-struct RenderComponent : public Component {
+struct RenderComponent {
     enum class EntityType {
         TREE,
         ROCK,
@@ -46,7 +45,7 @@ struct RenderComponent : public Component {
 };
 
 // LOD component
-struct LODComponent : public Component {
+struct LODComponent {
     int currentLOD{0};
     float distance{0.0f};
     bool inFrustum{true};
@@ -66,7 +65,7 @@ struct LODComponent : public Component {
 };
 
 // Tree-specific component
-struct TreeComponent : public Component {
+struct TreeComponent {
     float trunkHeight{3.0f};
     float trunkRadius{0.25f};
     float foliageRadius{2.0f};
@@ -80,7 +79,7 @@ struct TreeComponent : public Component {
 };
 
 // Rock-specific component
-struct RockComponent : public Component {
+struct RockComponent {
     glm::vec3 dimensions{1.2f, 1.0f, 1.5f};
     
     RockComponent() {
@@ -92,7 +91,7 @@ struct RockComponent : public Component {
 };
 
 // House-specific component
-struct HouseComponent : public Component {
+struct HouseComponent {
     float wallHeight{3.0f};
     float roofHeight{2.0f};
     glm::vec2 dimensions{4.0f, 5.0f};
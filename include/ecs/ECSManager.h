@@ -2,17 +2,27 @@
 
 #include "ecs/Entity.h"
 #include "ecs/Component.h"
-#include "ecs/ComponentManager.h"
+#include "ecs/Archetype.h"
+#include "ecs/EntityRegistry.h"
+#include "ecs/JobSystem.h"
+#include "ecs/SparseSet.h"
+#include "ecs/SpatialGrid.h"
 #include "core/FrustumCuller.h"
+#include <atomic>
 #include <memory>
-#include <set>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <typeindex>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
 class System {
 public:
     virtual ~System() = default;
-    std::set<EntityID> m_entities;
+    // Entities matching the system's signature, packed
+    SparseSet m_entities;
 };
 
 class ECSManager {
@@ -20,84 +30,241 @@ public:
     ECSManager();
     ~ECSManager() = default;
     
-    // Entity management
+    // Entity management. Handles are generational: after destroyEntity the
+    // handle stays invalid even once its index is reused.
     EntityID createEntity();
+    // No-op for stale handles
     void destroyEntity(EntityID entity);
+    bool isAlive(EntityID entity) const { return m_registry.isAlive(entity); }
+    const SparseSet& getEntities() const { return m_registry.getAlive(); }
     
-    // Component management
+    // Component management. Components live in the archetype matching the
+    // entity's component set, so adding or removing one moves the entity's
+    // other components to a different archetype.
     template<typename T>
     void registerComponent() {
-        m_componentManager->registerComponent<T>();
+        uint32_t type = componentId<T>();
+        if (type >= MAX_COMPONENTS) {
+            throw std::runtime_error("Failed to register component: too many component types!");
+        }
+        m_componentInfos[type] = ComponentInfo::of<T>();
     }
     
     template<typename T>
     void addComponent(EntityID entity, T component) {
-        m_componentManager->addComponent<T>(entity, component);
+        uint32_t type = componentId<T>();
+        EntityRecord& record = getRecord(entity);
+        if (record.archetype->getMask().test(type)) {
+            *static_cast<T*>(record.archetype->getComponent(type, record.row)) = std::move(component);
+        } else {
+            ComponentMask mask = record.archetype->getMask();
+            mask.set(type);
+            moveEntity(entity, mask);
+            new (record.archetype->getComponent(type, record.row)) T(std::move(component));
+            
+            updateEntitySystems(entity);
+        }
         
-        auto& entityMask = m_entityMasks[entity];
-        entityMask.set(m_componentManager->getComponentType<T>(), true);
-        
-        updateEntitySystems(entity);
+        if constexpr (affectsSpatialIndex<T>()) {
+            updateSpatialIndex(entity);
+        }
     }
     
     template<typename T>
     void removeComponent(EntityID entity) {
-        m_componentManager->removeComponent<T>(entity);
+        uint32_t type = componentId<T>();
+        EntityRecord& record = getRecord(entity);
+        if (!record.archetype->getMask().test(type)) {
+            return;
+        }
         
-        auto& entityMask = m_entityMasks[entity];
-        entityMask.set(m_componentManager->getComponentType<T>(), false);
+        ComponentMask mask = record.archetype->getMask();
+        mask.reset(type);
+        moveEntity(entity, mask);
         
         updateEntitySystems(entity);
+        
+        if constexpr (affectsSpatialIndex<T>()) {
+            updateSpatialIndex(entity);
+        }
     }
     
     template<typename T>
     T& getComponent(EntityID entity) {
-        return m_componentManager->getComponent<T>(entity);
+        uint32_t type = componentId<T>();
+        const EntityRecord& record = getRecord(entity);
+        if (!record.archetype->getMask().test(type)) {
+            throw std::runtime_error("Failed to get component: entity does not have it!");
+        }
+        return *static_cast<T*>(record.archetype->getComponent(type, record.row));
+    }
+    
+    template<typename T>
+    bool hasComponent(EntityID entity) const {
+        return getRecord(entity).archetype->getMask().test(componentId<T>());
     }
     
     template<typename T>
     uint32_t getComponentType() {
-        return m_componentManager->getComponentType<T>();
+        return componentId<T>();
+    }
+    
+    template<typename... Ts>
+    ComponentMask getComponentMask() {
+        ComponentMask mask;
+        (mask.set(componentId<Ts>()), ...);
+        return mask;
+    }
+    
+    // Calls func(EntityID, Ts&...) for every entity that has all of Ts, walking
+    // each matching archetype chunk by chunk. Entities must not be created or
+    // destroyed, nor components added or removed, from inside func.
+    template<typename... Ts, typename Func>
+    void forEach(Func&& func) {
+        ComponentMask mask = getComponentMask<Ts...>();
+        
+        for (const auto& archetype : m_archetypes) {
+            if ((archetype->getMask() & mask) != mask) continue;
+            
+            for (size_t chunk = 0; chunk < archetype->getChunkCount(); chunk++) {
+                forEachInChunk<Ts...>(ChunkRef{archetype.get(), chunk}, func);
+            }
+        }
+    }
+    
+    // One archetype chunk, the unit parallel iteration hands to a job
+    struct ChunkRef {
+        Archetype* archetype;
+        size_t chunk;
+    };
+    
+    // Appends every non-empty chunk holding entities with all of Ts
+    template<typename... Ts>
+    void queryChunks(std::vector<ChunkRef>& chunks) {
+        ComponentMask mask = getComponentMask<Ts...>();
+        
+        for (const auto& archetype : m_archetypes) {
+            if ((archetype->getMask() & mask) != mask) continue;
+            
+            for (size_t chunk = 0; chunk < archetype->getChunkCount(); chunk++) {
+                if (archetype->getChunkCount(chunk) > 0) {
+                    chunks.push_back(ChunkRef{archetype.get(), chunk});
+                }
+            }
+        }
+    }
+    
+    template<typename... Ts, typename Func>
+    void forEachInChunk(const ChunkRef& ref, Func&& func) {
+        iterateRows(func, ref.archetype->getEntities(ref.chunk), ref.archetype->getChunkCount(ref.chunk),
+                    static_cast<Ts*>(ref.archetype->getColumn(ref.chunk, componentId<Ts>()))...);
+    }
+    
+    // forEach with the matching chunks spread over the pool. func runs
+    // concurrently for different entities, so it may only write the components
+    // it is handed and must not touch other entities or change the entity set.
+    template<typename... Ts, typename Func>
+    void parallelForEach(JobSystem& jobs, Func&& func) {
+        std::vector<ChunkRef> chunks;
+        queryChunks<Ts...>(chunks);
+        
+        jobs.parallelFor(static_cast<uint32_t>(chunks.size()), PARALLEL_CHUNK_GRAIN,
+                         [&](uint32_t begin, uint32_t end) {
+                             for (uint32_t i = begin; i < end; i++) {
+                                 forEachInChunk<Ts...>(chunks[i], func);
+                             }
+                         });
     }
     
     // System management
     template<typename T>
     std::shared_ptr<T> registerSystem() {
-        std::type_index typeName = std::type_index(typeid(T));
-        
         auto system = std::make_shared<T>();
-        m_systems[typeName] = system;
+        getSystemEntry(std::type_index(typeid(T))).system = system;
         return system;
     }
     
     template<typename T>
     void setSystemSignature(ComponentMask signature) {
-        std::type_index typeName = std::type_index(typeid(T));
-        m_signatures[typeName] = signature;
+        getSystemEntry(std::type_index(typeid(T))).signature = signature;
     }
     
     template<typename T>
     std::shared_ptr<T> getSystem() {
-        std::type_index typeName = std::type_index(typeid(T));
-        return std::static_pointer_cast<T>(m_systems[typeName]);
+        return std::static_pointer_cast<T>(getSystemEntry(std::type_index(typeid(T))).system);
     }
     
+    // Spatial index over every entity with a TransformComponent, as a sphere
+    // of its RenderComponent's boundingRadius (zero without one). Adding,
+    // removing and destroying keep it current; code that moves an entity by
+    // writing its transform directly calls updateSpatialIndex afterwards.
+    const SpatialGrid& getSpatialGrid() const { return m_spatialGrid; }
+    void setPosition(EntityID entity, const glm::vec3& position);
+    void updateSpatialIndex(EntityID entity);
+    
     // Utility functions
     std::vector<EntityID> getEntitiesWithComponents(ComponentMask mask);
     void updateEntitySystems(EntityID entity);
     
-    // Get component arrays for iteration
+private:
+    // Where an entity's components are: its archetype and row within it
+    struct EntityRecord {
+        Archetype* archetype{nullptr};
+        uint32_t row{0};
+    };
+    
+    struct SystemEntry {
+        std::shared_ptr<System> system;
+        ComponentMask signature;
+    };
+    
+    // Indexed by entity index; throws for stale handles
+    EntityRecord& getRecord(EntityID entity) {
+        if (!m_registry.isAlive(entity)) {
+            throw std::runtime_error("Failed to access entity: handle is stale!");
+        }
+        return m_records[entityIndex(entity)];
+    }
+    const EntityRecord& getRecord(EntityID entity) const {
+        return const_cast<ECSManager*>(this)->getRecord(entity);
+    }
+    SystemEntry& getSystemEntry(std::type_index type);
+    
+    // Type IDs are shared by every ECSManager, handed out on first use
     template<typename T>
-    std::shared_ptr<TypedComponentArray<T>> getComponentArray() {
-        return m_componentManager->getComponentArray<T>();
+    static uint32_t componentId() {
+        static const uint32_t id = s_nextComponentType++;
+        return id;
     }
     
-private:
-    std::unique_ptr<ComponentManager> m_componentManager;
-    std::unordered_map<EntityID, ComponentMask> m_entityMasks;
-    std::unordered_map<std::type_index, ComponentMask> m_signatures;
-    std::unordered_map<std::type_index, std::shared_ptr<System>> m_systems;
-    std::set<EntityID> m_availableEntityIDs;
-    EntityID m_nextEntityID{0};
-    static constexpr EntityID MAX_ENTITIES = 10000;
+    template<typename T>
+    static constexpr bool affectsSpatialIndex() {
+        return std::is_same_v<T, TransformComponent> || std::is_same_v<T, RenderComponent>;
+    }
+    
+    // Chunks per job in parallelForEach
+    static constexpr uint32_t PARALLEL_CHUNK_GRAIN = 2;
+    
+    template<typename Func, typename... Ts>
+    static void iterateRows(Func& func, const EntityID* entities, uint32_t count, Ts*... columns) {
+        for (uint32_t i = 0; i < count; i++) {
+            func(entities[i], columns[i]...);
+        }
+    }
+    
+    Archetype* getArchetype(ComponentMask mask);
+    // Moves the entity to the archetype for mask, carrying over the components
+    // both archetypes have; components only the new one has are left unconstructed
+    void moveEntity(EntityID entity, ComponentMask mask);
+    
+    static std::atomic<uint32_t> s_nextComponentType;
+    std::array<ComponentInfo, MAX_COMPONENTS> m_componentInfos{};
+    std::vector<std::unique_ptr<Archetype>> m_archetypes;
+    std::unordered_map<ComponentMask, Archetype*> m_archetypesByMask;
+    EntityRegistry m_registry;
+    std::vector<EntityRecord> m_records;
+    SpatialGrid m_spatialGrid;
+    // Systems in registration order, walked on every membership update
+    std::vector<SystemEntry> m_systems;
+    std::unordered_map<std::type_index, size_t> m_systemIndices;
 };
\ No newline at end of file
@@ -2,50 +2,28 @@
 
 #include <cstdint>
 #include <bitset>
+#include <limits>
 
+// An entity handle: a slot index in the low bits and that slot's generation in
+// the high bits. Destroying an entity bumps its slot's generation, so handles
+// still held to it no longer match and are recognised as stale in O(1), even
+// after the slot is handed to a new entity.
 using EntityID = uint32_t;
-using ComponentMask = std::bitset<32>;
 
-class Entity {
-public:
-    Entity() : m_id(s_nextID++), m_componentMask(0) {}
-    Entity(EntityID id) : m_id(id), m_componentMask(0) {}
-    
-    EntityID getID() const { return m_id; }
-    
-    template<typename T>
-    void addComponent() {
-        m_componentMask.set(static_cast<size_t>(getComponentType<T>()));
-    }
-    
-    template<typename T>
-    void removeComponent() {
-        m_componentMask.reset(static_cast<size_t>(getComponentType<T>()));
-    }
-    
-    template<typename T>
-    bool hasComponent() const {
-        return m_componentMask.test(static_cast<size_t>(getComponentType<T>()));
-    }
-    
-    ComponentMask getComponentMask() const { return m_componentMask; }
-    
-    bool operator==(const Entity& other) const { return m_id == other.m_id; }
-    bool operator!=(const Entity& other) const { return m_id != other.m_id; }
-    
-private:
-    EntityID m_id;
-    ComponentMask m_componentMask;
-    static EntityID s_nextID;
-    
-    template<typename T>
-    constexpr uint32_t getComponentType() const;
-};
+constexpr uint32_t ENTITY_INDEX_BITS = 20;
+constexpr uint32_t ENTITY_INDEX_MASK = (1u << ENTITY_INDEX_BITS) - 1;
+constexpr uint32_t ENTITY_GENERATION_BITS = 32 - ENTITY_INDEX_BITS;
+constexpr uint32_t ENTITY_GENERATION_MASK = (1u << ENTITY_GENERATION_BITS) - 1;
 
-// Template specializations for component types
-template<> constexpr uint32_t Entity::getComponentType<struct TransformComponent>() const { return 0; }
-template<> constexpr uint32_t Entity::getComponentType<struct RenderComponent>() const { return 1; }
-template<> constexpr uint32_t Entity::getComponentType<struct TreeComponent>() const { return 2; }
-template<> constexpr uint32_t Entity::getComponentType<struct RockComponent>() const { return 3; }
-template<> constexpr uint32_t Entity::getComponentType<struct HouseComponent>() const { return 4; }
-template<> constexpr uint32_t Entity::getComponentType<struct LODComponent>() const { return 5; }
\ No newline at end of file
+inline uint32_t entityIndex(EntityID entity) { return entity & ENTITY_INDEX_MASK; }
+inline uint32_t entityGeneration(EntityID entity) { return entity >> ENTITY_INDEX_BITS; }
+inline EntityID makeEntity(uint32_t index, uint32_t generation) {
+    return (generation << ENTITY_INDEX_BITS) | index;
+}
+
+// One bit per registered component type
+constexpr uint32_t MAX_COMPONENTS = 32;
+using ComponentMask = std::bitset<MAX_COMPONENTS>;
+
+// All bits set: the last index at the last generation, which the registry never hands out
+constexpr EntityID INVALID_ENTITY = std::numeric_limits<EntityID>::max();
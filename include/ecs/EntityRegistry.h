@@ -0,0 +1,47 @@
+#pragma once
+
+#include "ecs/Entity.h"
+#include "ecs/SparseSet.h"
+#include <cstdint>
+#include <vector>
+
+// Hands out generational entity handles. Freed indices queue up in an
+// intrusive FIFO list threaded through the slots, and are only reused once
+// MIN_FREE_INDICES of them are waiting, so one index cycles through its
+// generations slowly and a stale handle is not revived by wrap-around.
+// After warm-up, create() and destroy() do not allocate.
+class EntityRegistry {
+public:
+    static constexpr uint32_t MIN_FREE_INDICES = 1024;
+
+    EntityID create();
+    // No-op for stale handles
+    void destroy(EntityID entity);
+
+    bool isAlive(EntityID entity) const {
+        uint32_t index = entityIndex(entity);
+        return index < m_slots.size() && m_slots[index].generation == entityGeneration(entity) &&
+               m_slots[index].alive;
+    }
+
+    // Every live entity, packed
+    const SparseSet& getAlive() const { return m_alive; }
+    size_t size() const { return m_alive.size(); }
+    // One past the highest index handed out so far
+    uint32_t getIndexCount() const { return static_cast<uint32_t>(m_slots.size()); }
+
+private:
+    static constexpr uint32_t NONE = UINT32_MAX;
+
+    struct Slot {
+        uint32_t generation{0};
+        uint32_t nextFree{NONE};
+        bool alive{false};
+    };
+
+    std::vector<Slot> m_slots;
+    uint32_t m_freeHead{NONE};
+    uint32_t m_freeTail{NONE};
+    uint32_t m_freeCount{0};
+    SparseSet m_alive;
+};
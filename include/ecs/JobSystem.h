@@ -0,0 +1,65 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Work-stealing thread pool for the ECS. Every worker owns a deque: it pushes
+// and pops jobs at the back, so nested work stays hot in its cache, and idle
+// workers steal from the front of the others'. Threads outside the pool push
+// round-robin. wait() runs queued jobs while the awaited ones are still
+// pending, so a job may itself submit and wait without tying up a worker.
+class JobSystem {
+public:
+    using Job = std::function<void()>;
+
+    // Number of submitted jobs not yet finished; one per batch of work to wait on
+    struct Counter {
+        std::atomic<uint32_t> pending{0};
+    };
+
+    // 0 workers picks one fewer than the hardware threads, leaving the caller's
+    explicit JobSystem(uint32_t workerCount = 0);
+    ~JobSystem();
+
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    void submit(Job job, Counter& counter);
+    void wait(Counter& counter);
+
+    // Calls func(begin, end) over [0, count) in ranges of about grain items,
+    // the first range on the calling thread. Returns when all are done.
+    void parallelFor(uint32_t count, uint32_t grain, const std::function<void(uint32_t, uint32_t)>& func);
+
+    uint32_t getWorkerCount() const { return static_cast<uint32_t>(m_workers.size()); }
+
+private:
+    struct Task {
+        Job job;
+        Counter* counter{nullptr};
+    };
+
+    struct Queue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    void workerLoop(uint32_t index);
+    // Own queue first (back), then the others (front); false when all are empty
+    bool runOne(uint32_t home);
+
+    std::vector<std::unique_ptr<Queue>> m_queues; // One per worker
+    std::vector<std::thread> m_workers;
+    std::atomic<uint32_t> m_nextQueue{0};
+    std::atomic<uint32_t> m_queuedTasks{0};
+    std::mutex m_sleepMutex;
+    std::condition_variable m_wake;
+    std::atomic<bool> m_stop{false};
+};
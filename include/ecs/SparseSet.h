@@ -0,0 +1,54 @@
+#pragma once
+
+#include "ecs/Entity.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// A set of entity handles with O(1) insert, erase and lookup and a packed
+// array to iterate. The sparse side maps an entity's index to its position in
+// the dense array and is split into pages allocated on first use, so a set
+// holding a few entities with high indices stays small. Neither pages nor
+// dense capacity are ever released: once a set has held n entities, cycling
+// up to n through it does not allocate.
+//
+// Lookups compare the full handle, so a stale handle to a destroyed entity is
+// never mistaken for the entity that reused its index.
+class SparseSet {
+public:
+    static constexpr uint32_t PAGE_SIZE = 4096;
+
+    bool contains(EntityID entity) const {
+        uint32_t position = find(entity);
+        return position != NONE && m_dense[position] == entity;
+    }
+
+    // No-op when already present
+    void insert(EntityID entity);
+    // Fills the hole with the last element; no-op when absent
+    void erase(EntityID entity);
+    void clear();
+
+    size_t size() const { return m_dense.size(); }
+    bool empty() const { return m_dense.empty(); }
+    const EntityID* data() const { return m_dense.data(); }
+    const EntityID* begin() const { return m_dense.data(); }
+    const EntityID* end() const { return m_dense.data() + m_dense.size(); }
+
+private:
+    static constexpr uint32_t NONE = UINT32_MAX;
+
+    uint32_t find(EntityID entity) const {
+        uint32_t index = entityIndex(entity);
+        size_t page = index / PAGE_SIZE;
+        if (page >= m_pages.size() || !m_pages[page]) {
+            return NONE;
+        }
+        return m_pages[page][index % PAGE_SIZE];
+    }
+    uint32_t& slot(EntityID entity);
+
+    std::vector<std::unique_ptr<uint32_t[]>> m_pages;
+    std::vector<EntityID> m_dense;
+};
@@ -0,0 +1,142 @@
+#pragma once
+
+#include "ecs/Entity.h"
+#include "core/FrustumCuller.h"
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// Loose uniform grid over the XZ plane for bounding spheres. An item lives in
+// the one cell holding its center; cells track the largest radius and the
+// height range of what they hold, and queries widen by that, so big items
+// need no multi-cell bookkeeping. Only occupied cells exist, found by hashing
+// their coordinates, so the grid covers an unbounded world at a cost that
+// follows how many items are near the query rather than how many exist.
+//
+// Items are 32-bit IDs, looked up by their entityIndex() bits, so ECS handles
+// and plain array indices both work. Moving an item within its cell does not
+// touch the cell lists. Emptied cells are recycled with their capacity.
+class SpatialGrid {
+public:
+    static constexpr float DEFAULT_CELL_SIZE = 32.0f;
+
+    explicit SpatialGrid(float cellSize = DEFAULT_CELL_SIZE);
+
+    // insert on an item already present behaves as update
+    void insert(uint32_t item, const glm::vec3& position, float radius);
+    void update(uint32_t item, const glm::vec3& position, float radius);
+    // No-op when absent
+    void remove(uint32_t item);
+    void clear();
+
+    bool contains(uint32_t item) const {
+        uint32_t index = entityIndex(item);
+        return index < m_items.size() && m_items[index].cell != NONE && m_items[index].id == item;
+    }
+    size_t size() const { return m_itemCount; }
+    size_t getCellCount() const { return m_cellIndices.size(); }
+
+    // Appends items whose sphere overlaps the query sphere
+    void queryRadius(const glm::vec3& center, float radius, std::vector<uint32_t>& results) const;
+    // Appends items whose center is farther than radius from center
+    void queryOutsideRadius(const glm::vec3& center, float radius, std::vector<uint32_t>& results) const;
+    // Appends items whose sphere is in the frustum and overlaps the query sphere
+    void queryFrustum(const FrustumCuller& frustumCuller, const glm::vec3& center, float radius,
+                      std::vector<uint32_t>& results) const;
+
+    // Whether any item for which accept(item) holds is closer than radius plus
+    // its own radius to center, stopping at the first; for rejecting placements
+    template<typename Predicate>
+    bool anyWithin(const glm::vec3& center, float radius, Predicate accept) const {
+        bool found = false;
+        visitCells(center, radius, [&](const Cell& cell) {
+            for (uint32_t item : cell.items) {
+                const Item& entry = m_items[entityIndex(item)];
+                float reach = radius + entry.radius;
+                glm::vec3 offset = entry.position - center;
+                if (glm::dot(offset, offset) < reach * reach && accept(item)) {
+                    found = true;
+                    return false;
+                }
+            }
+            return true;
+        });
+        return found;
+    }
+    bool anyWithin(const glm::vec3& center, float radius) const {
+        return anyWithin(center, radius, [](uint32_t) { return true; });
+    }
+
+private:
+    static constexpr uint32_t NONE = UINT32_MAX;
+
+    struct Item {
+        uint32_t id{0};
+        glm::vec3 position{0.0f};
+        float radius{0.0f};
+        uint32_t cell{NONE};
+        uint32_t slot{0}; // Position in the cell's list
+    };
+
+    struct Cell {
+        glm::ivec2 coord{0, 0};
+        std::vector<uint32_t> items;
+        // Grown by inserts, reset once the cell empties
+        float maxRadius{0.0f};
+        float minY{0.0f};
+        float maxY{0.0f};
+    };
+
+    glm::ivec2 cellCoord(const glm::vec3& position) const;
+    static uint64_t cellKey(const glm::ivec2& coord);
+    uint32_t acquireCell(const glm::ivec2& coord);
+    void addToCell(uint32_t cellIndex, Item& item);
+    void removeFromCell(Item& item);
+    // Box a cell's items lie in, spheres included
+    void cellBounds(const Cell& cell, glm::vec3& min, glm::vec3& max) const;
+
+    // Calls visit(cell) for every occupied cell a sphere of radius around
+    // center could overlap, until visit returns false
+    template<typename Visit>
+    void visitCells(const glm::vec3& center, float radius, Visit visit) const {
+        if (m_itemCount == 0) {
+            return;
+        }
+        // Items overhang their cell by at most the largest radius
+        float reach = radius + m_maxRadius;
+        glm::ivec2 low = cellCoord(center - glm::vec3(reach, 0.0f, reach));
+        glm::ivec2 high = cellCoord(center + glm::vec3(reach, 0.0f, reach));
+
+        // A query wider than the occupied area walks the cells instead
+        uint64_t span = static_cast<uint64_t>(high.x - low.x + 1) * static_cast<uint64_t>(high.y - low.y + 1);
+        if (span > m_cellIndices.size()) {
+            for (const auto& entry : m_cellIndices) {
+                const Cell& cell = m_cells[entry.second];
+                if (cell.coord.x < low.x || cell.coord.x > high.x || cell.coord.y < low.y || cell.coord.y > high.y) {
+                    continue;
+                }
+                if (!visit(cell)) return;
+            }
+            return;
+        }
+
+        for (int32_t z = low.y; z <= high.y; z++) {
+            for (int32_t x = low.x; x <= high.x; x++) {
+                auto it = m_cellIndices.find(cellKey(glm::ivec2(x, z)));
+                if (it == m_cellIndices.end()) continue;
+                if (!visit(m_cells[it->second])) return;
+            }
+        }
+    }
+
+    float m_cellSize;
+    float m_inverseCellSize;
+    std::vector<Item> m_items; // Indexed by entityIndex()
+    size_t m_itemCount{0};
+    std::vector<Cell> m_cells;
+    std::vector<uint32_t> m_freeCells;
+    std::unordered_map<uint64_t, uint32_t> m_cellIndices;
+    // Never shrinks, so queries stay conservative
+    float m_maxRadius{0.0f};
+};
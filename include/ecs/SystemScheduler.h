@@ -0,0 +1,74 @@
+#pragma once
+
+#include "ecs/Entity.h"
+#include "ecs/JobSystem.h"
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Runs a frame's ECS systems on a JobSystem. Each system declares the
+// components it reads and writes; two systems conflict when one writes what
+// the other touches, or when either changes the entity set (creates or
+// destroys entities, adds or removes components). From that, run() builds a
+// dependency graph for the frame: a system waits for every earlier-added
+// system it conflicts with, and systems with no path between them run at the
+// same time. Inside a system, ECSManager::parallelForEach splits the entity
+// range across the same pool.
+class SystemScheduler {
+public:
+    struct Access {
+        ComponentMask reads;
+        ComponentMask writes;
+        // Creates or destroys entities, or adds or removes components
+        bool structural{false};
+    };
+
+    struct SystemTiming {
+        std::string name;
+        double cpuMs;
+    };
+
+    using SystemFunc = std::function<void(JobSystem&)>;
+
+    explicit SystemScheduler(JobSystem* jobs);
+
+    // Systems run in an order consistent with the order they are added in
+    void addSystem(const std::string& name, const Access& access, SystemFunc func);
+    void setEnabled(const std::string& name, bool enabled);
+
+    // Runs every enabled system once and returns when all have finished
+    void run();
+
+    // Wall time of each system in the last run(), in the order added
+    const std::vector<SystemTiming>& getTimings() const { return m_timings; }
+    // Called with each timing at the end of run(), e.g. to forward to a profiler
+    void setTimingCallback(std::function<void(const std::string&, double)> callback) {
+        m_timingCallback = std::move(callback);
+    }
+
+private:
+    struct Node {
+        std::string name;
+        Access access;
+        SystemFunc func;
+        bool enabled{true};
+
+        // Rebuilt by run()
+        std::vector<uint32_t> successors;
+        uint32_t predecessorCount{0};
+        std::atomic<uint32_t> remaining{0};
+        double cpuMs{0.0};
+    };
+
+    static bool conflicts(const Access& a, const Access& b);
+    void buildGraph();
+    void launch(uint32_t node, JobSystem::Counter& counter);
+
+    JobSystem* m_jobs;
+    std::vector<std::unique_ptr<Node>> m_nodes;
+    std::vector<SystemTiming> m_timings;
+    std::function<void(const std::string&, double)> m_timingCallback;
+};
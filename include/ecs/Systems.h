@@ -2,7 +2,11 @@
 
 #include "ecs/ECSManager.h"
 #include "ecs/Component.h"
+#include "ecs/JobSystem.h"
+#include "ecs/SystemScheduler.h"
 #include "core/FrustumCuller.h"
+#include "core/NoiseTable.h"
+#include "core/TerrainFunction.h"
 #include <glm/glm.hpp>
 
 // Forward declarations
@@ -11,26 +15,51 @@ class ECSManager;
 // LOD and Culling System
 class LODSystem : public System {
 public:
-    void update(ECSManager* ecs, const glm::vec3& cameraPos, const FrustumCuller& frustumCuller);
+    static SystemScheduler::Access getAccess(ECSManager* ecs);
+    // Only entities the spatial grid finds in the view, within viewDistance,
+    // are updated, in parallel on jobs. The rest are hidden and keep their
+    // last LOD values.
+    void update(ECSManager* ecs, const glm::vec3& cameraPos, const FrustumCuller& frustumCuller, float viewDistance,
+                JobSystem& jobs);
+    
+private:
+    static constexpr uint32_t PARALLEL_GRAIN = 256;
+    
+    std::vector<EntityID> m_candidates;
+    std::vector<EntityID> m_inView; // Last frame's candidates, hidden again first thing
 };
 
 // Entity Generation System
 class EntityGenerationSystem : public System {
 public:
+    // Creates and destroys entities, so it never runs alongside another system
+    static SystemScheduler::Access getAccess(ECSManager* ecs);
     void generateEntitiesAroundCamera(ECSManager* ecs, const glm::vec3& cameraPos, float radius = 200.0f);
     void cleanupDistantEntities(ECSManager* ecs, const glm::vec3& cameraPos, float maxDistance = 300.0f);
+    // The terrain entities are placed on; should match what is rendered
+    void setTerrainParameters(const TerrainFunction::Parameters& parameters) { m_terrainParameters = parameters; }
     
 private:
+    struct PendingSpawn {
+        glm::vec3 position;
+        RenderComponent::EntityType type;
+        float boundingRadius;
+    };
+    
     glm::vec3 m_lastGenerationPos{0.0f};
     float m_lastGenerationRadius{0.0f};
+    TerrainFunction::Parameters m_terrainParameters;
+    std::vector<EntityID> m_toDestroy;
+    std::vector<PendingSpawn> m_pending;
     
-    float getTerrainHeight(const glm::vec2& pos) const;
-    bool isValidTreePosition(const glm::vec2& pos) const;
-    bool isValidRockPosition(const glm::vec2& pos) const;
-    bool isValidHousePosition(const glm::vec2& pos) const;
-    
-    float hash21(const glm::vec2& p) const;
-    float noise2D(const glm::vec2& p) const;
+    bool isValidTreePosition(const glm::vec2& pos, float terrainHeight) const;
+    bool isValidRockPosition(const glm::vec2& pos, float terrainHeight) const;
+    bool isValidHousePosition(const glm::vec2& pos, float terrainHeight) const;
+    // Skipped when the spot overlaps an entity from an earlier pass
+    void queueSpawn(ECSManager* ecs, const glm::vec3& position, RenderComponent::EntityType type,
+                    float boundingRadius);
+    template<typename Specific>
+    void spawn(ECSManager* ecs, const PendingSpawn& pending, Specific specific);
 };
 
 // Render System (for CPU-side render list generation)
@@ -51,6 +80,18 @@ public:
         };
     };
     
-    std::vector<RenderData> getRenderList(ECSManager* ecs);
+    static SystemScheduler::Access getAccess(ECSManager* ecs);
+    // Visible entities, gathered in parallel chunks on jobs; valid until the next call
+    const std::vector<RenderData>& getRenderList(ECSManager* ecs, JobSystem& jobs);
     void updateVisibility(ECSManager* ecs);
+    
+private:
+    // Appends visible entities that have Specific, fill copying its fields
+    template<typename Specific, typename Fill>
+    void collect(ECSManager* ecs, JobSystem& jobs, Fill fill);
+    
+    std::vector<RenderData> m_renderList;
+    std::vector<ECSManager::ChunkRef> m_chunks;
+    // One list per chunk, so jobs never share one; kept to reuse their capacity
+    std::vector<std::vector<RenderData>> m_chunkLists;
 };
\ No newline at end of file
@@ -4,6 +4,9 @@
 #include "entities/TreeEntity.h"
 #include "entities/RockEntity.h"
 #include "entities/HouseEntity.h"
+#include "core/NoiseTable.h"
+#include "core/TerrainFunction.h"
+#include "ecs/SpatialGrid.h"
 #include <vector>
 #include <memory>
 #include <glm/glm.hpp>
@@ -24,11 +27,14 @@ public:
     std::vector<Entity*> getEntitiesOfType(EntityType type) const;
 
     // Terrain-related functions
+    void setTerrainParameters(const TerrainFunction::Parameters& parameters) { m_terrainParameters = parameters; }
     float getTerrainHeight(float x, float z) const;
     bool isValidPlacementLocation(const glm::vec3& position, float radius) const;
 
 private:
     std::vector<std::unique_ptr<Entity>> m_entities;
+    // Indexed by position in m_entities, for placement checks
+    SpatialGrid m_grid;
     
     // Generation parameters
     float m_treeFrequency;
@@ -38,10 +44,9 @@ private:
     // Last generation center to avoid regenerating
     glm::vec3 m_lastGenerateCenter;
     float m_lastGenerateRadius;
+    TerrainFunction::Parameters m_terrainParameters;
     
     // Helper functions
-    float noise2D(float x, float y) const;
-    float hash21(float x, float y) const;
-    bool shouldPlaceEntity(float x, float z, EntityType type) const;
+    bool shouldPlaceEntity(float x, float z, float terrainHeight, EntityType type) const;
     glm::vec3 getRandomOffset(float maxOffset) const;
 };
\ No newline at end of file
@@ -0,0 +1,114 @@
+#pragma once
+
+#include "core/VulkanDevice.h"
+#include <vulkan/vulkan.h>
+#include <glm/glm.hpp>
+#include <array>
+
+// Cascaded shadow maps for the primary directional light. Cascades are fit to
+// slices of the view frustum, or to the whole model once a slice covers it.
+// All geometry is static, so a cascade's map is kept until the light, the
+// model or the quality changes, or the camera's slice leaves the (slightly
+// enlarged) region the map was rendered for. Orbiting a model therefore
+// re-renders nothing.
+//
+// Set 2 of the forward pipeline layout:
+//   binding 0: cascade matrices and splits (dynamic UBO, ring of slots)
+//   binding 1: one comparison-sampled depth map per cascade
+class CascadedShadowMaps {
+public:
+    static constexpr uint32_t CASCADE_COUNT = 4;
+    static constexpr uint32_t MAP_SIZE = 2048;
+    static constexpr VkFormat FORMAT = VK_FORMAT_D32_SFLOAT;
+
+    // Filter tiers, matching shader.frag
+    enum Quality { Off = 0, Hard = 1, Pcf3x3 = 2, Pcf5x5 = 3 };
+
+    struct Stats {
+        uint32_t activeCascades{0};
+        uint32_t renderedThisFrame{0};
+        uint64_t totalRenders{0};
+    };
+
+    explicit CascadedShadowMaps(VulkanDevice* device);
+    ~CascadedShadowMaps();
+
+    CascadedShadowMaps(const CascadedShadowMaps&) = delete;
+    CascadedShadowMaps& operator=(const CascadedShadowMaps&) = delete;
+
+    // Fit cascades to this frame's camera and decide which maps must be re-rendered.
+    // sceneGeneration changes whenever the shadow casters do.
+    void update(const glm::mat4& view, const glm::mat4& projection, float nearPlane, float farPlane,
+                const glm::vec3& lightDirection, const glm::vec3& sceneCenter, float sceneRadius,
+                uint32_t sceneGeneration, int quality);
+
+    bool isEnabled() const { return m_quality != Off; }
+    uint32_t getActiveCascades() const { return m_activeCascades; }
+    // True if the cascade's map is stale; clears once the caller records its render.
+    // Maps are kept in SHADER_READ_ONLY_OPTIMAL between frames.
+    bool needsRender(uint32_t cascade) const { return m_cascades[cascade].dirty; }
+    void markRendered(uint32_t cascade);
+
+    VkImage getImage(uint32_t cascade) const { return m_cascades[cascade].image; }
+    VkImageView getImageView(uint32_t cascade) const { return m_cascades[cascade].view; }
+    const glm::mat4& getLightViewProj(uint32_t cascade) const { return m_cascades[cascade].viewProj; }
+
+    // Bind set 2 for the forward pipeline
+    void bind(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout);
+
+    VkDescriptorSetLayout getDescriptorSetLayout() const { return m_descriptorSetLayout; }
+    const Stats& getStats() const { return m_stats; }
+
+private:
+    // std140 layout shared with shader.frag
+    struct ShadowData {
+        glm::mat4 lightViewProj[CASCADE_COUNT];
+        glm::vec4 splitDepths;    // View-space far distance of each cascade
+        glm::vec4 texelWorldSize; // Per cascade, for normal-offset bias
+        glm::vec4 params;         // x quality, y active cascades, z 1/MAP_SIZE
+    };
+
+    struct Cascade {
+        VkImage image{VK_NULL_HANDLE};
+        VkDeviceMemory memory{VK_NULL_HANDLE};
+        VkImageView view{VK_NULL_HANDLE};
+
+        // Region the current map was rendered for
+        glm::vec3 center{0.0f};
+        float radius{0.0f};
+        glm::mat4 viewProj{1.0f};
+        bool valid{false};
+        bool dirty{false};
+    };
+
+    void createImages();
+    void createSampler();
+    void createDescriptors();
+    glm::mat4 fitLightMatrix(const glm::vec3& center, float radius, const glm::vec3& lightDirection,
+                             const glm::vec3& sceneCenter, float sceneRadius) const;
+    uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties);
+
+    VulkanDevice* m_device;
+    std::array<Cascade, CASCADE_COUNT> m_cascades;
+    VkSampler m_sampler{VK_NULL_HANDLE};
+
+    VkDescriptorSetLayout m_descriptorSetLayout{VK_NULL_HANDLE};
+    VkDescriptorPool m_descriptorPool{VK_NULL_HANDLE};
+    VkDescriptorSet m_descriptorSet{VK_NULL_HANDLE};
+
+    // One slot per possible frame in flight plus one, so rewriting never races a reader
+    static constexpr uint32_t RING_SLOTS = 4;
+    VkBuffer m_uniformBuffer{VK_NULL_HANDLE};
+    VkDeviceMemory m_uniformMemory{VK_NULL_HANDLE};
+    void* m_uniformMapped{nullptr};
+    VkDeviceSize m_slotSize{0};
+    uint32_t m_slot{0};
+    ShadowData m_data{};
+
+    // What the cached maps depend on besides their region
+    glm::vec3 m_lightDirection{0.0f};
+    uint32_t m_sceneGeneration{UINT32_MAX};
+    int m_quality{Off};
+    uint32_t m_activeCascades{0};
+    Stats m_stats;
+};
@@ -0,0 +1,99 @@
+#pragma once
+
+#include "core/VulkanDevice.h"
+#include "rendering/ComputePipeline.h"
+#include "viewer/GLTFLoader.h"
+#include <vulkan/vulkan.h>
+#include <glm/glm.hpp>
+#include <memory>
+#include <vector>
+
+// Clustered forward lighting. The view frustum is split into a froxel grid
+// (screen tiles x exponential depth slices); a compute pass bins every
+// punctual light into the clusters its bounding sphere touches, and the
+// forward shader only shades with the lights of the fragment's cluster.
+//
+// Set 1 of the forward pipeline layout:
+//   binding 0: lights (world space, uploaded on model load)
+//   binding 1: per-cluster light count (written by the cull pass)
+//   binding 2: per-cluster light indices, MAX_LIGHTS_PER_CLUSTER slots each
+class ClusteredLighting {
+public:
+    // Grid X/Y match light_cull.comp's workgroup size
+    static constexpr uint32_t GRID_X = 16;
+    static constexpr uint32_t GRID_Y = 9;
+    static constexpr uint32_t GRID_Z = 24;
+    static constexpr uint32_t CLUSTER_COUNT = GRID_X * GRID_Y * GRID_Z;
+    static constexpr uint32_t MAX_LIGHTS_PER_CLUSTER = 128;
+
+    // Fragment push constants of the forward pipeline
+    struct ClusterParams {
+        glm::vec4 depthParams; // near, far, slice scale, slice bias
+        glm::vec4 tileSize;    // pixels per tile in x, y
+        glm::uvec4 grid;       // x, y, z, max lights per cluster
+    };
+
+    explicit ClusteredLighting(VulkanDevice* device);
+    ~ClusteredLighting();
+
+    ClusteredLighting(const ClusteredLighting&) = delete;
+    ClusteredLighting& operator=(const ClusteredLighting&) = delete;
+
+    // Replaces the light list; the previous buffer is retired once in-flight frames are done
+    void setLights(const std::vector<PunctualLight>& lights);
+
+    // Bin the lights for this frame's camera; record outside a render pass
+    void cull(VkCommandBuffer commandBuffer, const glm::mat4& view, const glm::mat4& projection,
+              float nearPlane, float farPlane);
+    // Bind set 1 and push the cluster lookup parameters for the forward pipeline
+    void bind(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout, float nearPlane, float farPlane,
+              VkExtent2D extent);
+
+    VkDescriptorSetLayout getDescriptorSetLayout() const { return m_descriptorSetLayout; }
+    VkBuffer getClusterCountBuffer() const { return m_clusterCountBuffer; }
+    VkBuffer getLightIndexBuffer() const { return m_lightIndexBuffer; }
+    VkDeviceSize getClusterCountSize() const { return sizeof(uint32_t) * CLUSTER_COUNT; }
+    VkDeviceSize getLightIndexSize() const { return sizeof(uint32_t) * CLUSTER_COUNT * MAX_LIGHTS_PER_CLUSTER; }
+    uint32_t getLightCount() const { return m_lightCount; }
+
+private:
+    // std430 layout shared with shader.frag and light_cull.comp
+    struct GpuLight {
+        glm::vec4 positionRange;  // xyz position, w range
+        glm::vec4 directionType;  // xyz direction, w type
+        glm::vec4 colorIntensity; // rgb color, a intensity
+        glm::vec4 spotScaleOffset; // x, y: cone attenuation scale/offset
+    };
+
+    struct CullParams {
+        glm::mat4 view;
+        glm::vec4 projParams; // 1/P[0][0], 1/P[1][1], near, far
+        glm::uvec4 counts;    // light count, max lights per cluster
+    };
+
+    void createDescriptorSetLayout();
+    void createDescriptorPool();
+    void createClusterBuffers();
+    void createLightBuffer(VkDeviceSize size);
+    void allocateDescriptorSet();
+    void createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties,
+                      VkBuffer& buffer, VkDeviceMemory& bufferMemory);
+    uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties);
+
+    VulkanDevice* m_device;
+    std::unique_ptr<ComputePipeline> m_cullPipeline;
+
+    VkDescriptorSetLayout m_descriptorSetLayout{VK_NULL_HANDLE};
+    VkDescriptorPool m_descriptorPool{VK_NULL_HANDLE};
+    VkDescriptorSet m_descriptorSet{VK_NULL_HANDLE};
+
+    VkBuffer m_lightBuffer{VK_NULL_HANDLE};
+    VkDeviceMemory m_lightBufferMemory{VK_NULL_HANDLE};
+    VkDeviceSize m_lightBufferSize{0};
+    uint32_t m_lightCount{0};
+
+    VkBuffer m_clusterCountBuffer{VK_NULL_HANDLE};
+    VkDeviceMemory m_clusterCountMemory{VK_NULL_HANDLE};
+    VkBuffer m_lightIndexBuffer{VK_NULL_HANDLE};
+    VkDeviceMemory m_lightIndexMemory{VK_NULL_HANDLE};
+};
@@ -10,12 +10,10 @@ public:
     ~CommandBuffer();
 
     void createCommandPool();
-    void createCommandBuffers(VkRenderPass renderPass, const std::vector<VkFramebuffer>& framebuffers,
-                            VkExtent2D extent, VkPipeline graphicsPipeline, VkPipelineLayout pipelineLayout,
-                            VkDescriptorSet descriptorSet);
-    void recordCommandBuffer(size_t index, VkRenderPass renderPass, VkFramebuffer framebuffer,
-                           VkExtent2D extent, VkPipeline graphicsPipeline, VkPipelineLayout pipelineLayout,
-                           VkDescriptorSet descriptorSet, class DebugUI* debugUI = nullptr, class GLTFViewer* viewer = nullptr);
+    void createCommandBuffers(uint32_t count);
+    // Records the frame's compiled render graph, bracketed by the profiler's frame timestamps
+    void recordCommandBuffer(size_t index, class RenderGraph* renderGraph, class Profiler* profiler = nullptr,
+                           uint32_t frameIndex = 0);
     VkCommandBuffer getCommandBuffer(size_t index) const { return m_commandBuffers[index]; }
     size_t size() const { return m_commandBuffers.size(); }
 
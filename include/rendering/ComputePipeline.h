@@ -0,0 +1,31 @@
+#pragma once
+
+#include "core/VulkanDevice.h"
+#include <vulkan/vulkan.h>
+#include <string>
+#include <vector>
+
+// Compute pipeline built from a single SPIR-V file in the shaders directory.
+// Push constants, if any, are one range visible to the compute stage.
+class ComputePipeline {
+public:
+    ComputePipeline(VulkanDevice* device, const std::string& shaderName,
+                    const std::vector<VkDescriptorSetLayout>& setLayouts, uint32_t pushConstantSize = 0,
+                    const VkSpecializationInfo* specialization = nullptr);
+    ~ComputePipeline();
+
+    ComputePipeline(const ComputePipeline&) = delete;
+    ComputePipeline& operator=(const ComputePipeline&) = delete;
+
+    void bind(VkCommandBuffer commandBuffer) const;
+
+    VkPipeline getPipeline() const { return m_pipeline; }
+    VkPipelineLayout getPipelineLayout() const { return m_pipelineLayout; }
+
+private:
+    static std::vector<char> readShaderFile(const std::string& filename);
+
+    VulkanDevice* m_device;
+    VkPipelineLayout m_pipelineLayout{VK_NULL_HANDLE};
+    VkPipeline m_pipeline{VK_NULL_HANDLE};
+};
@@ -3,39 +3,111 @@
 #include "core/VulkanDevice.h"
 #include "rendering/SwapChain.h"
 #include "rendering/RenderPass.h"
-#include "rendering/Framebuffer.h"
 #include "rendering/CommandBuffer.h"
 #include "rendering/UniformBuffer.h"
 #include <vulkan/vulkan.h>
 #include <string>
 #include <vector>
 #include <memory>
+#include <unordered_map>
 
 class GraphicsPipeline {
 public:
-    GraphicsPipeline(VulkanDevice* device, SwapChain* swapChain);
+    // Vertex push constants of the points pipeline
+    struct PointParams {
+        float worldSize;      // Point diameter in world units
+        float viewportHeight; // Render height in pixels
+        float minSize;        // gl_PointSize clamp, in pixels
+        float maxSize;
+    };
+
+    // lightingLayout, shadowLayout and environmentLayout become sets 1-3, next to the material/UBO set 0;
+    // oitCompositeLayout is set 0 of the weighted-blended OIT composite, presentLayout of the present draw
+    GraphicsPipeline(VulkanDevice* device, SwapChain* swapChain, VkDescriptorSetLayout lightingLayout,
+                     VkDescriptorSetLayout shadowLayout, VkDescriptorSetLayout environmentLayout,
+                     VkDescriptorSetLayout oitCompositeLayout, VkDescriptorSetLayout presentLayout);
     ~GraphicsPipeline();
 
-    VkRenderPass getRenderPass() const { return m_renderPass->getRenderPass(); }
+    // Swap chain color + depth, for the UI pass; VK_NULL_HANDLE with dynamic rendering
+    VkRenderPass getRenderPass() const { return m_renderPass ? m_renderPass->getRenderPass() : VK_NULL_HANDLE; }
+    // HDR scene color + depth, for pipelines drawn in the forward pass; VK_NULL_HANDLE with dynamic rendering
+    VkRenderPass getSceneRenderPass() const {
+        return m_sceneRenderPass ? m_sceneRenderPass->getRenderPass() : VK_NULL_HANDLE;
+    }
+    // Shading pipeline with no optional features (ShaderPermutation key 0)
     VkPipeline getPipeline() const { return m_graphicsPipeline; }
+    // Shading pipeline for a ShaderPermutation key, compiled on first use and cached.
+    // Shading writes linear HDR into a PostProcessor::HDR_FORMAT scene color.
+    // With depthPrepass the variant tests EQUAL against the prepass depth and does not write it.
+    // AlphaBlend variants blend over the target without writing depth; WeightedOIT variants
+    // render into the accumulation and revealage targets instead of the scene color.
+    VkPipeline getShadingPipeline(uint32_t permutation, bool depthPrepass);
+    uint32_t getShadingPipelineCount() const { return static_cast<uint32_t>(m_shadingPipelines.size()); }
+    // Depth prepass: position-only depth writes
+    VkPipeline getDepthPrepassPipeline() const { return m_depthPrepassPipeline; }
+    // Points view: unindexed POINT_LIST over the glTF vertices, PointParams as a vertex push constant
+    VkPipeline getPointsPipeline() const { return m_pointsPipeline; }
+    VkPipelineLayout getPointsPipelineLayout() const { return m_pointsPipelineLayout; }
+    // Cascade rendering: position-only, light matrix as a vertex push constant, depth bias on
+    VkPipeline getShadowPipeline() const { return m_shadowPipeline; }
+    VkPipelineLayout getShadowPipelineLayout() const { return m_shadowPipelineLayout; }
     VkPipelineLayout getPipelineLayout() const { return m_pipelineLayout; }
-    Framebuffer* getFramebuffer() const { return m_framebuffer.get(); }
+    // Full-screen resolve of the OIT targets over the scene color
+    VkPipeline getOitCompositePipeline() const { return m_oitCompositePipeline; }
+    VkPipelineLayout getOitCompositeLayout() const { return m_oitCompositePipelineLayout; }
+    // Full-screen copy of the post-processed image into the swap chain
+    VkPipeline getPresentPipeline() const { return m_presentPipeline; }
+    VkPipelineLayout getPresentLayout() const { return m_presentPipelineLayout; }
     CommandBuffer* getCommandBuffer() const { return m_commandBuffer.get(); }
     UniformBuffer* getUniformBuffer() const { return m_uniformBuffer.get(); }
 
 private:
     void createPipeline();
     void createGraphicsPipeline();
+    VkPipeline createShadingPipeline(uint32_t permutation, bool depthPrepass);
+    void createDepthPrepassPipeline();
+    void createShadowPipeline();
+    void createPointsPipeline();
+    void createOitCompositePipeline();
+    void createPresentPipeline();
+    // Fullscreen triangle + fragmentShader, with depth attached but unused
+    VkPipeline createFullscreenPipeline(const std::string& fragmentShader, VkDescriptorSetLayout setLayout,
+                                        VkFormat colorFormat, RenderPass* renderPass,
+                                        const VkPipelineColorBlendAttachmentState& blendState,
+                                        const VkSpecializationInfo* specialization, VkPipelineLayout& pipelineLayout);
     void createCommandBuffers();
     static std::vector<char> readShaderFile(const std::string& filename);
     VkShaderModule createShaderModule(const std::vector<char>& code);
 
     VulkanDevice* m_device;
     SwapChain* m_swapChain;
+    VkDescriptorSetLayout m_lightingLayout;
+    VkDescriptorSetLayout m_shadowLayout;
+    VkDescriptorSetLayout m_environmentLayout;
+    VkDescriptorSetLayout m_oitCompositeLayout;
+    VkDescriptorSetLayout m_presentLayout;
     std::unique_ptr<RenderPass> m_renderPass;
-    std::unique_ptr<Framebuffer> m_framebuffer;
+    std::unique_ptr<RenderPass> m_sceneRenderPass; // HDR scene color + depth
+    std::unique_ptr<RenderPass> m_depthRenderPass;
+    std::unique_ptr<RenderPass> m_oitRenderPass; // Accumulation + revealage + depth
     std::unique_ptr<CommandBuffer> m_commandBuffer;
     std::unique_ptr<UniformBuffer> m_uniformBuffer;
     VkPipelineLayout m_pipelineLayout{VK_NULL_HANDLE};
     VkPipeline m_graphicsPipeline{VK_NULL_HANDLE};
+    // Shading variants share these modules; they stay alive for lazy compiles
+    VkShaderModule m_vertShaderModule{VK_NULL_HANDLE};
+    VkShaderModule m_fragShaderModule{VK_NULL_HANDLE};
+    VkShaderModule m_wireframeGeomModule{VK_NULL_HANDLE};
+    VkPipelineCache m_pipelineCache{VK_NULL_HANDLE};
+    // Keyed by (permutation << 1) | depthPrepass
+    std::unordered_map<uint32_t, VkPipeline> m_shadingPipelines;
+    VkPipeline m_depthPrepassPipeline{VK_NULL_HANDLE};
+    VkPipelineLayout m_shadowPipelineLayout{VK_NULL_HANDLE};
+    VkPipeline m_shadowPipeline{VK_NULL_HANDLE};
+    VkPipelineLayout m_pointsPipelineLayout{VK_NULL_HANDLE};
+    VkPipeline m_pointsPipeline{VK_NULL_HANDLE};
+    VkPipelineLayout m_oitCompositePipelineLayout{VK_NULL_HANDLE};
+    VkPipeline m_oitCompositePipeline{VK_NULL_HANDLE};
+    VkPipelineLayout m_presentPipelineLayout{VK_NULL_HANDLE};
+    VkPipeline m_presentPipeline{VK_NULL_HANDLE};
 };
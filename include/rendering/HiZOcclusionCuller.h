@@ -0,0 +1,163 @@
+#pragma once
+
+#include "core/VulkanDevice.h"
+#include "rendering/ComputePipeline.h"
+#include "viewer/GLTFLoader.h"
+#include <vulkan/vulkan.h>
+#include <glm/glm.hpp>
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// GPU occlusion culling against a hierarchical depth (Hi-Z) pyramid. Every
+// frame a compute pass reduces the depth buffer into a mip chain where each
+// texel holds the farthest depth beneath it; an object whose nearest depth is
+// behind the farthest depth of the few texels covering its screen rectangle
+// cannot be seen.
+//
+// Culling runs in two phases around the pyramid build (occlusion_cull.comp):
+// the early phase draws whatever last frame's pyramid doesn't hide, the pyramid
+// is rebuilt from that depth, and the late phase gives the objects the early
+// phase rejected a second chance against it. Geometry that was just disoccluded
+// is therefore drawn late in the same frame instead of popping in a frame later.
+//
+// The culling outputs are VkDrawIndexedIndirectCommand arrays with one entry
+// per draw object (instanceCount 0 when culled), in the loader's material draw
+// order, so each material run stays one indirect draw. The pyramid is kept in
+// SHADER_READ_ONLY_OPTIMAL between frames; the build takes it through GENERAL.
+class HiZOcclusionCuller {
+public:
+    static constexpr VkFormat PYRAMID_FORMAT = VK_FORMAT_R32_SFLOAT;
+    static constexpr uint32_t MAX_LEVELS = 16;
+
+    // Read back a few frames late, once the GPU is done with them
+    struct Stats {
+        uint32_t objects{0};
+        uint32_t drawnEarly{0};
+        uint32_t drawnLate{0};
+        uint32_t occluded{0};
+        uint32_t outsideFrustum{0};
+    };
+
+    explicit HiZOcclusionCuller(VulkanDevice* device);
+    ~HiZOcclusionCuller();
+
+    HiZOcclusionCuller(const HiZOcclusionCuller&) = delete;
+    HiZOcclusionCuller& operator=(const HiZOcclusionCuller&) = delete;
+
+    // Replaces the object list; the previous buffers are retired once in-flight frames are done
+    void setObjects(const std::vector<DrawObject>& objects);
+    // (Re)create the pyramid at the output resolution; a no-op if it already matches
+    void resize(VkExtent2D outputExtent);
+    // Start a frame culled with viewProjection (unjittered) at renderExtent; the
+    // frame must run all three passes below
+    void beginFrame(const glm::mat4& viewProjection, VkExtent2D renderExtent);
+    // Skip the early-phase occlusion test next frame, e.g. after a frame without culling
+    void invalidateHistory() { m_historyValid = false; }
+
+    // Record outside a render pass, in this order
+    void cullEarly(VkCommandBuffer commandBuffer);
+    void buildPyramid(VkCommandBuffer commandBuffer, VkImageView depthView);
+    void cullLate(VkCommandBuffer commandBuffer);
+
+    VkImage getPyramid() const { return m_pyramid; }
+    VkImageView getPyramidView() const { return m_pyramidView; }
+    VkExtent2D getPyramidExtent() const { return m_pyramidExtent; }
+    uint32_t getPyramidLevels() const { return m_pyramidLevels; }
+
+    VkBuffer getEarlyCommandBuffer() const { return m_earlyCommandBuffer; }
+    VkBuffer getLateCommandBuffer() const { return m_lateCommandBuffer; }
+    VkBuffer getRejectedBuffer() const { return m_rejectedBuffer; }
+    VkDeviceSize getCommandBufferSize() const { return sizeof(VkDrawIndexedIndirectCommand) * m_capacity; }
+    VkDeviceSize getRejectedBufferSize() const { return sizeof(uint32_t) * m_capacity; }
+    uint32_t getObjectCount() const { return m_objectCount; }
+
+    const Stats& getStats() const { return m_stats; }
+
+private:
+    // std140 layout shared with occlusion_cull.comp
+    struct CullFrame {
+        glm::mat4 viewProj;
+        glm::mat4 historyViewProj;
+        glm::uvec4 pyramid;        // xy depth size, z levels
+        glm::uvec4 historyPyramid; // Same for last frame's pyramid, w 1 if usable
+        glm::uvec4 counts;         // x object count, y statistics slot
+    };
+
+    // Push constants shared with hiz_build.comp
+    struct BuildParams {
+        glm::ivec2 srcSize;
+        glm::ivec2 dstSize;
+        uint32_t level;
+    };
+
+    void createSampler();
+    void createDescriptors();
+    void createFrameBuffers();
+    void createObjectBuffers(uint32_t capacity);
+    void createPyramid(VkExtent2D extent);
+    void retirePyramid();
+    void dispatchCull(VkCommandBuffer commandBuffer, const ComputePipeline& pipeline);
+    static uint32_t levelCount(VkExtent2D depthExtent);
+    void createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties,
+                      VkBuffer& buffer, VkDeviceMemory& bufferMemory);
+    uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties);
+
+    VulkanDevice* m_device;
+    std::unique_ptr<ComputePipeline> m_buildPipeline;
+    std::unique_ptr<ComputePipeline> m_earlyPipeline;
+    std::unique_ptr<ComputePipeline> m_latePipeline;
+
+    VkSampler m_sampler{VK_NULL_HANDLE};
+    VkDescriptorSetLayout m_cullSetLayout{VK_NULL_HANDLE};
+    VkDescriptorSetLayout m_buildSetLayout{VK_NULL_HANDLE};
+    VkDescriptorPool m_descriptorPool{VK_NULL_HANDLE};
+
+    // Depth and pyramid views can change between frames, so each frame rewrites
+    // its own sets; one slot per possible frame in flight plus one
+    static constexpr uint32_t RING_SLOTS = 4;
+    std::array<VkDescriptorSet, RING_SLOTS> m_cullSets{};
+    std::array<std::array<VkDescriptorSet, MAX_LEVELS>, RING_SLOTS> m_buildSets{};
+    uint32_t m_slot{0};
+
+    // Per-slot uniforms and statistics counters, persistently mapped
+    VkBuffer m_frameBuffer{VK_NULL_HANDLE};
+    VkDeviceMemory m_frameMemory{VK_NULL_HANDLE};
+    void* m_frameMapped{nullptr};
+    VkDeviceSize m_frameSlotSize{0};
+    VkBuffer m_statisticsBuffer{VK_NULL_HANDLE};
+    VkDeviceMemory m_statisticsMemory{VK_NULL_HANDLE};
+    glm::uvec4* m_statisticsMapped{nullptr};
+
+    // Sized for the object list, at least one entry
+    uint32_t m_objectCount{0};
+    uint32_t m_capacity{0};
+    VkBuffer m_objectBuffer{VK_NULL_HANDLE};
+    VkDeviceMemory m_objectMemory{VK_NULL_HANDLE};
+    VkBuffer m_earlyCommandBuffer{VK_NULL_HANDLE};
+    VkDeviceMemory m_earlyCommandMemory{VK_NULL_HANDLE};
+    VkBuffer m_lateCommandBuffer{VK_NULL_HANDLE};
+    VkDeviceMemory m_lateCommandMemory{VK_NULL_HANDLE};
+    VkBuffer m_rejectedBuffer{VK_NULL_HANDLE};
+    VkDeviceMemory m_rejectedMemory{VK_NULL_HANDLE};
+
+    // Sized for the output resolution; frames use the part their render extent covers
+    VkImage m_pyramid{VK_NULL_HANDLE};
+    VkDeviceMemory m_pyramidMemory{VK_NULL_HANDLE};
+    VkImageView m_pyramidView{VK_NULL_HANDLE}; // All levels, sampled by the cull
+    std::array<VkImageView, MAX_LEVELS> m_levelViews{}; // One per level, for the build
+    VkExtent2D m_pyramidExtent{0, 0};  // Level 0
+    VkExtent2D m_outputExtent{0, 0};
+    uint32_t m_pyramidLevels{0};
+
+    // This frame's pyramid, and what last frame's was built from
+    VkExtent2D m_depthExtent{0, 0};
+    uint32_t m_frameLevels{0};
+    glm::mat4 m_historyViewProj{1.0f};
+    VkExtent2D m_historyExtent{0, 0};
+    uint32_t m_historyLevels{0};
+    bool m_historyValid{false};
+
+    Stats m_stats;
+};
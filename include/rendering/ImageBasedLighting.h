@@ -0,0 +1,134 @@
+#pragma once
+
+#include "core/VulkanDevice.h"
+#include "rendering/ComputePipeline.h"
+#include <vulkan/vulkan.h>
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Image-based lighting from an equirectangular HDR environment. Loading runs
+// compute passes that convert the panorama to a cubemap, prefilter it with the
+// GGX lobe into a roughness mip chain and project it to 9 SH coefficients for
+// diffuse irradiance; the last two run on the async compute queue when the
+// device has one. The results are cached on disk keyed by a hash of the
+// source file, so loading an environment again is a plain file upload. The
+// split-sum BRDF LUT depends on nothing but the BRDF, so it is built once.
+//
+// Set 3 of the forward pipeline layout:
+//   binding 0: prefiltered specular cubemap (roughness = mip / maxMip)
+//   binding 1: split-sum BRDF LUT (scale, bias)
+//   binding 2: irradiance SH9, already convolved with the cosine lobe and divided by pi
+class ImageBasedLighting {
+public:
+    static constexpr uint32_t CUBE_SIZE = 512;     // Intermediate environment cubemap
+    static constexpr uint32_t SPECULAR_SIZE = 256;
+    static constexpr uint32_t SPECULAR_MIPS = 6;   // 256 down to 8, roughness 0 to 1
+    static constexpr uint32_t BRDF_LUT_SIZE = 128;
+    static constexpr uint32_t SH_COEFFICIENTS = 9;
+    static constexpr VkFormat CUBE_FORMAT = VK_FORMAT_R16G16B16A16_SFLOAT;
+
+    // Fragment push constants, placed after ClusteredLighting::ClusterParams
+    struct ShadingParams {
+        glm::vec4 rotation; // cos, sin of the environment's rotation about +Y
+        glm::vec4 params;   // x intensity, y max specular mip, z 1 if an environment is loaded
+    };
+
+    explicit ImageBasedLighting(VulkanDevice* device);
+    ~ImageBasedLighting();
+
+    ImageBasedLighting(const ImageBasedLighting&) = delete;
+    ImageBasedLighting& operator=(const ImageBasedLighting&) = delete;
+
+    // Load an equirectangular .hdr, from the cache when it has been processed before.
+    // The previous environment is retired once in-flight frames are done with it.
+    bool loadEnvironment(const std::string& filePath);
+
+    // Bind set 3 and push the environment parameters for the forward pipeline
+    void bind(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout, float rotationDegrees, float intensity);
+
+    bool hasEnvironment() const { return m_hasEnvironment; }
+    const std::string& getEnvironmentPath() const { return m_environmentPath; }
+    // Wall-clock time of the last load and whether it came from the cache
+    double getLastLoadMs() const { return m_lastLoadMs; }
+    bool wasLastLoadCached() const { return m_lastLoadCached; }
+
+    VkDescriptorSetLayout getDescriptorSetLayout() const { return m_descriptorSetLayout; }
+
+private:
+    // Resources that change with the environment
+    struct Environment {
+        VkImage image{VK_NULL_HANDLE};
+        VkDeviceMemory memory{VK_NULL_HANDLE};
+        VkImageView view{VK_NULL_HANDLE};
+        VkBuffer shBuffer{VK_NULL_HANDLE};
+        VkDeviceMemory shMemory{VK_NULL_HANDLE};
+        VkDescriptorSet descriptorSet{VK_NULL_HANDLE};
+        uint32_t size{0};
+        uint32_t mipLevels{0};
+    };
+
+    // Contents of a cache file: SH coefficients, then every specular mip with its six faces
+    struct EnvironmentData {
+        uint32_t size{0};
+        uint32_t mipLevels{0};
+        std::vector<glm::vec4> sh;
+        std::vector<uint8_t> specular; // Raw CUBE_FORMAT texels
+    };
+
+    void createSamplers();
+    void createDescriptorSetLayouts();
+    void createDescriptorPool();
+    void createBrdfLut();
+
+    bool precompute(const std::vector<uint8_t>& fileData, EnvironmentData& outData);
+    bool readCache(const std::string& cachePath, uint64_t sourceHash, EnvironmentData& outData);
+    void writeCache(const std::string& cachePath, uint64_t sourceHash, const EnvironmentData& data);
+    std::string getCachePath(uint64_t sourceHash) const;
+
+    Environment createEnvironment(const EnvironmentData& data);
+    static void destroyEnvironment(VkDevice device, VkDescriptorPool pool, const Environment& environment);
+    VkDescriptorSet allocateComputeSet(VkImageView sampledView, VkSampler sampler, VkImageView storageView,
+                                       VkBuffer storageBuffer, VkDeviceSize storageBufferSize);
+
+    static uint64_t hashBytes(const std::vector<uint8_t>& data);
+    static VkDeviceSize cubeMipBytes(uint32_t size, uint32_t mipLevels);
+
+    void createImage(uint32_t width, uint32_t height, uint32_t mipLevels, uint32_t layers, VkFormat format,
+                     VkImageUsageFlags usage, VkImageCreateFlags flags, VkImage& image, VkDeviceMemory& memory);
+    VkImageView createImageView(VkImage image, VkImageViewType type, VkFormat format, uint32_t baseMip,
+                                uint32_t mipCount, uint32_t layers);
+    void createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties,
+                      VkBuffer& buffer, VkDeviceMemory& bufferMemory);
+    void transitionImage(VkCommandBuffer commandBuffer, VkImage image, uint32_t baseMip, uint32_t mipCount,
+                         uint32_t layers, VkImageLayout oldLayout, VkImageLayout newLayout,
+                         VkAccessFlags srcAccess, VkAccessFlags dstAccess,
+                         VkPipelineStageFlags srcStage, VkPipelineStageFlags dstStage);
+    uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties);
+
+    VulkanDevice* m_device;
+
+    std::unique_ptr<ComputePipeline> m_equirectToCubePipeline;
+    std::unique_ptr<ComputePipeline> m_prefilterPipeline;
+    std::unique_ptr<ComputePipeline> m_irradiancePipeline;
+    std::unique_ptr<ComputePipeline> m_brdfPipeline;
+
+    VkSampler m_sampler{VK_NULL_HANDLE};         // Cubemaps and the LUT
+    VkSampler m_equirectSampler{VK_NULL_HANDLE}; // Wraps horizontally
+    VkDescriptorSetLayout m_descriptorSetLayout{VK_NULL_HANDLE};
+    VkDescriptorSetLayout m_computeSetLayout{VK_NULL_HANDLE};
+    VkDescriptorPool m_descriptorPool{VK_NULL_HANDLE};
+    VkDescriptorPool m_computePool{VK_NULL_HANDLE};
+
+    VkImage m_brdfLut{VK_NULL_HANDLE};
+    VkDeviceMemory m_brdfLutMemory{VK_NULL_HANDLE};
+    VkImageView m_brdfLutView{VK_NULL_HANDLE};
+
+    Environment m_environment;
+    bool m_hasEnvironment{false};
+    std::string m_environmentPath;
+    double m_lastLoadMs{0.0};
+    bool m_lastLoadCached{false};
+};
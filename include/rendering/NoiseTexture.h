@@ -0,0 +1,38 @@
+#pragma once
+
+#include "core/VulkanDevice.h"
+#include <vulkan/vulkan.h>
+#include <cstdint>
+
+// NoiseTable's lattice as a repeating R8 texture, uploaded once at startup.
+// Shaders sample it with hardware bilinear filtering instead of hashing four
+// lattice points per lookup, and a box-filtered mip chain lets surfaces far
+// away fetch the average rather than alias. Level 0 matches NoiseTable::value()
+// at uv = p / NoiseTable::SIZE.
+class NoiseTexture {
+public:
+    static constexpr VkFormat FORMAT = VK_FORMAT_R8_UNORM;
+
+    explicit NoiseTexture(VulkanDevice* device);
+    ~NoiseTexture();
+
+    NoiseTexture(const NoiseTexture&) = delete;
+    NoiseTexture& operator=(const NoiseTexture&) = delete;
+
+    // Shader-read-only, linear filtering and mipmapping, repeat addressing
+    VkImageView getImageView() const { return m_view; }
+    VkSampler getSampler() const { return m_sampler; }
+
+private:
+    void createImage();
+    void upload();
+    void createSampler();
+    uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties);
+
+    VulkanDevice* m_device;
+    uint32_t m_mipLevels{1};
+    VkImage m_image{VK_NULL_HANDLE};
+    VkDeviceMemory m_memory{VK_NULL_HANDLE};
+    VkImageView m_view{VK_NULL_HANDLE};
+    VkSampler m_sampler{VK_NULL_HANDLE};
+};
@@ -0,0 +1,144 @@
+#pragma once
+
+#include "core/VulkanDevice.h"
+#include "rendering/ComputePipeline.h"
+#include <vulkan/vulkan.h>
+#include <glm/glm.hpp>
+#include <array>
+#include <cstdint>
+#include <memory>
+
+// HDR post-processing as one chain of compute dispatches, recorded by a single
+// render graph pass. The scene is shaded into an HDR_FORMAT target in linear
+// light; the chain then
+//   - downsamples the bright part of it into a bloom mip chain, building the
+//     luminance histogram for auto exposure in the same first dispatch,
+//   - turns the histogram into an exposure that adapts over time,
+//   - upsamples the bloom chain back up, and
+//   - adds bloom, exposes, tonemaps and display-encodes in one last dispatch,
+//     which also does the final bloom upsample step.
+// The result is a DISPLAY_FORMAT image that the UI pass copies into the swap
+// chain (see getPresentSetLayout) before drawing the interface over it.
+//
+// The bloom chain and the exposure state live here, outside the graph; process()
+// orders them against the previous frame itself.
+class PostProcessor {
+public:
+    static constexpr VkFormat HDR_FORMAT = VK_FORMAT_R16G16B16A16_SFLOAT;
+    static constexpr VkFormat DISPLAY_FORMAT = VK_FORMAT_R8G8B8A8_UNORM;
+    static constexpr uint32_t MAX_BLOOM_LEVELS = 6;
+
+    enum class Tonemapper : uint32_t {
+        Reinhard = 0,
+        ACES = 1,
+        AgX = 2,
+        Count
+    };
+
+    struct Settings {
+        Tonemapper tonemapper{Tonemapper::ACES};
+        bool autoExposure{true};
+        float exposure{1.0f}; // Manual exposure, or a multiplier on the automatic one
+        float gamma{2.2f};
+        bool bloom{true};
+        float bloomThreshold{1.0f}; // In exposed units
+        float bloomIntensity{0.05f};
+    };
+
+    // Read back a few frames late, once the GPU is done with them
+    struct Stats {
+        float exposure{1.0f};
+        float averageLuminance{0.0f};
+    };
+
+    explicit PostProcessor(VulkanDevice* device);
+    ~PostProcessor();
+
+    PostProcessor(const PostProcessor&) = delete;
+    PostProcessor& operator=(const PostProcessor&) = delete;
+
+    // (Re)create the bloom chain for this output resolution; a no-op if it already matches
+    void resize(VkExtent2D outputExtent);
+    // Record the chain outside a render pass. hdrView is sampled at the output
+    // resolution in SHADER_READ_ONLY_OPTIMAL; displayView is written in GENERAL.
+    void process(VkCommandBuffer commandBuffer, VkImageView hdrView, VkImageView displayView,
+                 const Settings& settings, float deltaSeconds);
+
+    // Set 0 of the present pipeline: the display image, sampled by present.frag
+    VkDescriptorSetLayout getPresentSetLayout() const { return m_presentSetLayout; }
+    void bindPresent(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout, VkImageView displayView);
+
+    const Stats& getStats() const { return m_stats; }
+
+private:
+    // Push constants shared by every post_*.comp shader
+    struct PostParams {
+        glm::ivec2 srcSize;
+        glm::ivec2 dstSize;
+        int32_t srcLevel;
+        uint32_t slot;
+        float deltaTime;
+        float exposure;
+        float bloomThreshold;
+        float bloomIntensity;
+        float gamma;
+        uint32_t autoExposure;
+    };
+
+    void createSamplers();
+    void createDescriptors();
+    void createStateBuffers();
+    void createPipelines();
+    void createBloomChain(VkExtent2D extent);
+    void retireBloomChain();
+    void writeDescriptors(VkImageView hdrView, VkImageView displayView);
+    void dispatch(VkCommandBuffer commandBuffer, const ComputePipeline& pipeline, uint32_t level,
+                  const PostParams& params, VkExtent2D groups);
+    static void computeBarrier(VkCommandBuffer commandBuffer);
+    VkExtent2D levelExtent(uint32_t level) const;
+    void createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties,
+                      VkBuffer& buffer, VkDeviceMemory& bufferMemory);
+    uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties);
+
+    VulkanDevice* m_device;
+    std::unique_ptr<ComputePipeline> m_firstDownsamplePipeline;
+    std::unique_ptr<ComputePipeline> m_downsamplePipeline;
+    std::unique_ptr<ComputePipeline> m_exposurePipeline;
+    std::unique_ptr<ComputePipeline> m_upsamplePipeline;
+    std::array<std::unique_ptr<ComputePipeline>, static_cast<size_t>(Tonemapper::Count)> m_compositePipelines;
+
+    VkSampler m_nearestSampler{VK_NULL_HANDLE}; // Scene and display images, read texel for texel
+    VkSampler m_linearSampler{VK_NULL_HANDLE};  // Bloom chain, filtered across levels
+    VkDescriptorSetLayout m_setLayout{VK_NULL_HANDLE};
+    VkDescriptorSetLayout m_presentSetLayout{VK_NULL_HANDLE};
+    VkDescriptorPool m_descriptorPool{VK_NULL_HANDLE};
+
+    // The scene and display images are graph transients that can change every
+    // frame, so each frame rewrites its own sets, one per bloom level written;
+    // one slot per possible frame in flight plus one
+    static constexpr uint32_t RING_SLOTS = 4;
+    std::array<std::array<VkDescriptorSet, MAX_BLOOM_LEVELS>, RING_SLOTS> m_sets{};
+    std::array<VkDescriptorSet, RING_SLOTS> m_presentSets{};
+    uint32_t m_slot{0};
+    uint32_t m_presentSlot{0};
+
+    // Luminance histogram (cleared by the exposure pass) and the adapted exposure
+    VkBuffer m_histogramBuffer{VK_NULL_HANDLE};
+    VkDeviceMemory m_histogramMemory{VK_NULL_HANDLE};
+    VkBuffer m_exposureBuffer{VK_NULL_HANDLE};
+    VkDeviceMemory m_exposureMemory{VK_NULL_HANDLE};
+    // Per-slot exposure readback, persistently mapped
+    VkBuffer m_statisticsBuffer{VK_NULL_HANDLE};
+    VkDeviceMemory m_statisticsMemory{VK_NULL_HANDLE};
+    glm::vec4* m_statisticsMapped{nullptr};
+
+    // Level 0 at half the output resolution
+    VkImage m_bloomImage{VK_NULL_HANDLE};
+    VkDeviceMemory m_bloomMemory{VK_NULL_HANDLE};
+    VkImageView m_bloomView{VK_NULL_HANDLE}; // All levels, sampled
+    std::array<VkImageView, MAX_BLOOM_LEVELS> m_bloomLevelViews{}; // One per level, written
+    uint32_t m_bloomLevels{0};
+    VkExtent2D m_outputExtent{0, 0};
+
+    Stats m_stats;
+};
@@ -0,0 +1,239 @@
+#pragma once
+
+#include "core/VulkanDevice.h"
+#include <vulkan/vulkan.h>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+class Profiler;
+
+using RGHandle = uint32_t;
+constexpr RGHandle RG_INVALID_HANDLE = UINT32_MAX;
+
+// Graph-owned image; memory may be shared with other transients whose
+// lifetimes do not overlap
+struct RGImageDesc {
+    VkFormat format{VK_FORMAT_UNDEFINED};
+    VkExtent2D extent{0, 0};
+    VkImageUsageFlags usage{0}; // Extra usage; attachment/sampled bits are derived from the passes
+};
+
+enum class RGUsage {
+    ColorAttachment,
+    DepthAttachment,
+    DepthReadOnly,
+    SampledRead,
+    StorageRead,
+    StorageWrite,
+    TransferSrc,
+    TransferDst,
+    IndirectRead
+};
+
+class RenderGraph;
+
+// Handed to a pass's setup callback to declare what the pass touches
+class RenderGraphBuilder {
+public:
+    void writeColor(RGHandle image, VkAttachmentLoadOp loadOp, VkClearColorValue clearColor = {});
+    void writeDepth(RGHandle image, VkAttachmentLoadOp loadOp, float clearDepth = 1.0f);
+    // Depth test against an earlier pass's depth without writing it
+    void readDepth(RGHandle image);
+    void readTexture(RGHandle image, VkPipelineStageFlags stages = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+    // Storage and copy accesses apply to imported buffers as well as images
+    void readStorage(RGHandle resource, VkPipelineStageFlags stages = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+    void writeStorage(RGHandle resource, VkPipelineStageFlags stages = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+    void copyFrom(RGHandle resource);
+    void copyTo(RGHandle resource);
+    // Draw parameters sourced from a buffer an earlier pass wrote
+    void readIndirect(RGHandle buffer);
+    // Keep the pass even if nothing reads its outputs
+    void setSideEffects();
+
+private:
+    friend class RenderGraph;
+    RenderGraphBuilder(RenderGraph* graph, uint32_t passIndex) : m_graph(graph), m_passIndex(passIndex) {}
+
+    RenderGraph* m_graph;
+    uint32_t m_passIndex;
+};
+
+// Per-frame render graph. Passes are declared every frame with their reads and
+// writes; compile() culls passes whose results are never consumed, picks store
+// ops, aliases transient image memory and derives the barriers between passes.
+// Passes with attachments get a render pass and framebuffer from the graph's
+// caches, or begin dynamic rendering directly where the device supports it, so
+// their execute callback only records draws. With synchronization2 each barrier
+// carries its own stage masks instead of sharing the pass's combined ones.
+// Imported buffers get the same hazard tracking, minus layouts.
+class RenderGraph {
+public:
+    struct Stats {
+        uint32_t passCount{0};
+        uint32_t culledPassCount{0};
+        uint32_t barrierCount{0};
+        uint32_t transientImageCount{0};
+        VkDeviceSize transientMemory{0};     // Bytes actually allocated
+        VkDeviceSize aliasedMemorySaved{0};  // Bytes saved by sharing memory
+    };
+
+    struct PassInfo {
+        std::string name;
+        bool culled;
+    };
+
+    explicit RenderGraph(VulkanDevice* device);
+    ~RenderGraph();
+
+    RenderGraph(const RenderGraph&) = delete;
+    RenderGraph& operator=(const RenderGraph&) = delete;
+
+    // Start declaring a new frame
+    void reset();
+
+    // External image; initialStage is the stage the producer (e.g. the acquire
+    // semaphore wait) makes it available at. finalLayout != UNDEFINED marks it
+    // as a graph output. Barriers cover mipLevels levels, all in one layout.
+    RGHandle importImage(const std::string& name, VkImage image, VkImageView view, VkFormat format,
+                         VkExtent2D extent, VkImageLayout initialLayout, VkPipelineStageFlags initialStage,
+                         VkImageLayout finalLayout, uint32_t mipLevels = 1);
+    RGHandle createImage(const std::string& name, const RGImageDesc& desc);
+    // External buffer; initialStage is where the previous frame last touched it,
+    // so the first write this frame waits for those reads to finish
+    RGHandle importBuffer(const std::string& name, VkBuffer buffer, VkDeviceSize size,
+                          VkPipelineStageFlags initialStage);
+
+    void addPass(const std::string& name,
+                 const std::function<void(RenderGraphBuilder&)>& setup,
+                 std::function<void(VkCommandBuffer)> execute);
+
+    void compile();
+    void execute(VkCommandBuffer commandBuffer, Profiler* profiler = nullptr);
+
+    // Valid after compile()
+    VkImage getImage(RGHandle handle) const { return m_resources[handle].image; }
+    VkImageView getImageView(RGHandle handle) const { return m_resources[handle].view; }
+    VkExtent2D getExtent(RGHandle handle) const { return m_resources[handle].desc.extent; }
+    VkBuffer getBuffer(RGHandle handle) const { return m_resources[handle].buffer; }
+
+    const Stats& getStats() const { return m_stats; }
+    const std::vector<PassInfo>& getPassInfo() const { return m_passInfo; }
+
+private:
+    friend class RenderGraphBuilder;
+
+    struct Resource {
+        std::string name;
+        RGImageDesc desc;
+        VkImageAspectFlags aspect{VK_IMAGE_ASPECT_COLOR_BIT};
+        uint32_t mipLevels{1};
+        bool imported{false};
+        VkImage image{VK_NULL_HANDLE};
+        VkImageView view{VK_NULL_HANDLE};
+        VkImageLayout initialLayout{VK_IMAGE_LAYOUT_UNDEFINED};
+        VkPipelineStageFlags initialStage{VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT};
+        VkImageLayout finalLayout{VK_IMAGE_LAYOUT_UNDEFINED};
+        bool isBuffer{false};
+        VkBuffer buffer{VK_NULL_HANDLE};
+        VkDeviceSize size{0};
+
+        // Compile results
+        uint32_t firstPass{UINT32_MAX};
+        uint32_t lastPass{0};
+        int32_t memoryBlock{-1};
+    };
+
+    struct Access {
+        RGHandle resource;
+        RGUsage usage;
+        VkPipelineStageFlags stages;
+        VkAttachmentLoadOp loadOp{VK_ATTACHMENT_LOAD_OP_DONT_CARE};
+        VkAttachmentStoreOp storeOp{VK_ATTACHMENT_STORE_OP_STORE};
+        VkClearValue clearValue{};
+    };
+
+    struct Pass {
+        std::string name;
+        std::vector<Access> accesses;
+        std::function<void(VkCommandBuffer)> execute;
+        bool sideEffects{false};
+        bool culled{false};
+
+        // Compile results
+        VkRenderPass renderPass{VK_NULL_HANDLE};
+        VkFramebuffer framebuffer{VK_NULL_HANDLE};
+        VkExtent2D extent{0, 0};
+        std::vector<VkClearValue> clearValues;
+        std::vector<VkImageMemoryBarrier> barriers;
+        std::vector<VkBufferMemoryBarrier> bufferBarriers;
+        VkPipelineStageFlags srcStages{0};
+        VkPipelineStageFlags dstStages{0};
+
+        // Dynamic rendering / synchronization2 path
+        bool rendering{false};
+        std::vector<VkRenderingAttachmentInfo> colorAttachments;
+        VkRenderingAttachmentInfo depthAttachment{};
+        bool hasDepthAttachment{false};
+        std::vector<VkImageMemoryBarrier2> barriers2;
+        std::vector<VkBufferMemoryBarrier2> bufferBarriers2;
+    };
+
+    // Persistent transient image, reused while its declaration is unchanged
+    struct TransientImage {
+        VkImage image{VK_NULL_HANDLE};
+        VkImageView view{VK_NULL_HANDLE};
+        VkMemoryRequirements requirements{};
+        int32_t memoryBlock{-1};
+    };
+
+    struct MemoryBlock {
+        VkDeviceMemory memory{VK_NULL_HANDLE};
+        VkDeviceSize size{0};
+        uint32_t memoryTypeBits{~0u};
+    };
+
+    void cullPasses();
+    void computeLifetimes();
+    void allocateTransients();
+    void buildBarriers();
+    void buildRenderPasses();
+    void releaseTransients();
+
+    VkRenderPass getOrCreateRenderPass(const std::vector<const Access*>& attachments);
+    VkFramebuffer getOrCreateFramebuffer(VkRenderPass renderPass, const std::vector<VkImageView>& views, VkExtent2D extent);
+    uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties);
+
+    static bool isWrite(RGUsage usage);
+    static bool isAttachment(RGUsage usage);
+    static VkImageLayout layoutFor(RGUsage usage);
+    static VkAccessFlags accessFor(RGUsage usage);
+    static VkImageUsageFlags imageUsageFor(RGUsage usage);
+    static VkAccessFlags2 accessFor2(RGUsage usage);
+    static VkAccessFlags2 srcAccessFor2(VkAccessFlags writeAccess);
+    static VkPipelineStageFlags2 stagesFor2(VkPipelineStageFlags stages);
+
+    VulkanDevice* m_device;
+    bool m_dynamicRendering;
+    bool m_synchronization2;
+
+    std::vector<Resource> m_resources;
+    std::vector<Pass> m_passes;
+    std::vector<VkImageMemoryBarrier> m_finalBarriers;
+    std::vector<VkImageMemoryBarrier2> m_finalBarriers2;
+    VkPipelineStageFlags m_finalSrcStages{0};
+
+    // Transient images and their aliased memory survive across frames and are
+    // rebuilt only when the frame's transient signature changes
+    std::string m_transientSignature;
+    std::map<std::string, TransientImage> m_transientImages;
+    std::vector<MemoryBlock> m_memoryBlocks;
+
+    std::map<std::string, VkRenderPass> m_renderPassCache;
+    std::map<std::string, VkFramebuffer> m_framebufferCache;
+
+    Stats m_stats;
+    std::vector<PassInfo> m_passInfo;
+};
@@ -1,88 +1,271 @@
 #pragma once
 
 #include "core/VulkanDevice.h"
-#include "rendering/SwapChain.h"
-#include "scene/Scene.h"
+#include "core/FrustumCuller.h"
+#include "ecs/Systems.h"
+#include "rendering/NoiseTexture.h"
+#include "rendering/RenderPass.h"
+#include "rendering/TerrainHeightfield.h"
 #include <vulkan/vulkan.h>
 #include <glm/glm.hpp>
+#include <array>
 #include <memory>
+#include <string>
+#include <vector>
 
-// Simple terrain-only uniform buffer
+// Terrain uniform buffer (matches terrain.frag and terrain_mesh.* exactly)
 struct TerrainUniformData {
-    glm::vec3 cameraPos;
-    float time;
-    glm::vec3 cameraTarget;
-    float aspectRatio;
     glm::mat4 viewMatrix;
     glm::mat4 projMatrix;
-    
+    glm::mat4 invViewProj;
+
+    glm::vec3 cameraPos;
+    float time;
+
     // Scene lighting
-    glm::vec3 sunDirection;
+    glm::vec3 sunDirection; // Towards the sun
     float sunIntensity;
     glm::vec3 sunColor;
-    float padding1;
+    float baseHeight; // World height of the terrain's zero level
     glm::vec3 ambientColor;
     float ambientIntensity;
     glm::vec3 skyColorHorizon;
-    float padding2;
+    float padding1;
     glm::vec3 skyColorZenith;
-    float padding3;
+    float padding2;
     glm::vec3 fogColor;
     float fogDensity;
-    
+
     // Terrain settings
     float terrainScale;
     float terrainHeight;
     float waterLevel;
     int enableWater;
-    
+
     // Quality settings
     int qualityLevel;
     float viewDistance;
-    float padding4[2];
+    glm::vec2 viewportSize;
+
+    // TerrainHeightfield::getRegion()
+    glm::vec4 heightfieldRegion;
+
+    // Reduced-resolution raymarch: x screen pixels per trace texel, y relative
+    // hit-distance jump that counts as an edge
+    glm::vec4 traceParameters;
 };
 
+// Procedural terrain, drawn into the scene's HDR color and depth targets so it
+// depth tests against glTF models like any other opaque surface. Both techniques
+// read the heights from a TerrainHeightfield, streamed in tiles around the camera:
+//   - Mesh (CDLOD): a quadtree over the world is walked on the CPU every frame and
+//     each selected node becomes one instance of a single grid patch, displaced by
+//     the height map in the vertex shader. A node takes the finest level whose
+//     range it is inside; over the last part of that range its odd vertices slide
+//     onto the next coarser grid, so neighbouring levels meet without cracks and
+//     switch without popping. Nodes outside the frustum or the view distance are
+//     never emitted, so cost follows what is on screen.
+//   - Raymarch: terrain.frag traces the heightfield for every pixel. With a
+//     raymarch scale above 1 it traces one ray per scale x scale block instead,
+//     into color and hit-distance targets before the scene pass, and the scene
+//     pass rebuilds full resolution from them: a depth-aware blend of the nearest
+//     trace texels, with only the pixels whose texels disagree on the hit
+//     distance traced again at full resolution.
+// The scene's entities (trees, rocks, houses) are drawn with the terrain, as
+// instanced low-poly shapes standing on the same ground and depth tested with it.
+// The sky fills whatever neither the scene nor the terrain covered.
 class RenderManager {
 public:
-    RenderManager(VulkanDevice* device, SwapChain* swapChain);
+    enum class Technique : int {
+        Mesh = 0,
+        Raymarch = 1
+    };
+
+    static constexpr uint32_t PATCH_RESOLUTION = 32; // Quads along a patch side
+    static constexpr uint32_t LOD_LEVELS = 6;
+    static constexpr float LEAF_SIZE = 16.0f;        // World size of a finest-level node
+    static constexpr uint32_t MAX_PATCHES = 4096;
+    static constexpr uint32_t MAX_ENTITY_INSTANCES = 4096; // Entity parts per frame
+    // Reduced-resolution raymarch targets: shaded color and distance to the hit (0 for sky)
+    static constexpr VkFormat TRACE_COLOR_FORMAT = VK_FORMAT_R16G16B16A16_SFLOAT;
+    static constexpr VkFormat TRACE_DISTANCE_FORMAT = VK_FORMAT_R32_SFLOAT;
+    // Relative hit-distance spread across a pixel's trace texels above which it is traced itself
+    static constexpr float TRACE_EDGE_THRESHOLD = 0.08f;
+
+    struct Settings {
+        Technique technique{Technique::Mesh};
+        uint32_t raymarchScale{1}; // Screen pixels per trace texel along each axis: 1, 2 or 4
+        int qualityLevel{2};
+        float viewDistance{250.0f};
+        float lodDistance{48.0f}; // Range of the finest level; each coarser level doubles it
+        float terrainScale{1.0f};
+        float terrainHeight{25.0f};
+        float baseHeight{-20.0f};
+        bool enableWater{true};
+        float waterLevel{-1.0f};
+        float fogDensity{0.005f};
+        glm::vec3 fogColor{0.7f, 0.8f, 0.9f};
+        glm::vec3 sunDirection{0.5f, 1.0f, 0.3f};
+        glm::vec3 sunColor{1.0f, 0.95f, 0.8f};
+        float sunIntensity{2.5f};
+        glm::vec3 ambientColor{0.2f, 0.3f, 0.4f};
+        float ambientIntensity{0.3f};
+        glm::vec3 skyColorHorizon{1.0f, 0.7f, 0.5f};
+        glm::vec3 skyColorZenith{0.3f, 0.6f, 1.0f};
+    };
+
+    struct Stats {
+        uint32_t patches{0};
+        uint32_t triangles{0};
+        uint32_t rebuilds{0}; // Heightfield region reassemblies
+        uint32_t entityInstances{0};
+        TerrainTileCache::Stats tiles;
+    };
+
+    RenderManager(VulkanDevice* device, VkRenderPass sceneRenderPass);
     ~RenderManager();
-    
-    void initialize();
-    void render(Scene* scene, const glm::mat4& viewMatrix, const glm::mat4& projMatrix);
-    void cleanup();
-    
-    // Camera and view settings
-    void updateCamera(const glm::vec3& position, const glm::vec3& target);
-    void setViewport(uint32_t width, uint32_t height);
-    
+
+    RenderManager(const RenderManager&) = delete;
+    RenderManager& operator=(const RenderManager&) = delete;
+
+    // CPU side of a frame: streams terrain tiles, selects the patches and writes the
+    // uniforms into a fresh ring slot. Returns true if recordHeightfield() has work
+    // and must be recorded this frame, before render().
+    bool update(const Settings& settings, const glm::mat4& viewMatrix, const glm::mat4& projMatrix,
+                VkExtent2D extent, float time);
+    // This frame's visible entities (Scene::getRenderList()), after update()
+    void updateEntities(const std::vector<RenderSystem::RenderData>& renderList);
+    // Record tile uploads and any heightfield reassembly, outside a render pass
+    void recordHeightfield(VkCommandBuffer commandBuffer);
+    // Size of the reduced-resolution trace targets this frame, or {0, 0} if the
+    // raymarch runs per pixel (or the mesh technique is active)
+    VkExtent2D getTraceExtent() const { return m_traceExtent; }
+    // Into the trace targets, after recordHeightfield() and before render(), which reads them.
+    // The targets are render graph transients, so this frame's upsample set is pointed at them here.
+    void renderTrace(VkCommandBuffer commandBuffer, VkImageView colorView, VkImageView distanceView);
+    // Inside the scene pass, after the opaque scene so hidden terrain fails the depth test early;
+    // the entities go first for the same reason
+    void render(VkCommandBuffer commandBuffer);
+
+    const Stats& getStats() const { return m_stats; }
+
 private:
-    void createTerrainPipeline();
-    void createEntityPipeline();
+    struct PatchVertex {
+        glm::vec2 grid; // 0..PATCH_RESOLUTION
+    };
+    // Per-instance vertex attributes of terrain_mesh.vert
+    struct PatchInstance {
+        glm::vec4 node;  // xy min corner (world XZ), z size, w level
+        glm::vec4 morph; // x morph start, y morph end distance
+    };
+    // Unit shapes the entities are built from, one range of the entity vertex buffer each
+    enum EntityMesh : uint32_t {
+        ENTITY_BOX,       // Walls: y 0..1, x and z -0.5..0.5
+        ENTITY_ROOF,      // Gable roof over the box's top, ridge along x
+        ENTITY_CYLINDER,  // Trunk: y 0..1, radius 1
+        ENTITY_SPHERE,    // Foliage and rocks: radius 1
+        ENTITY_SPHERE_LOW,
+        ENTITY_MESH_COUNT
+    };
+    struct EntityVertex {
+        glm::vec3 position;
+        glm::vec3 normal;
+    };
+    // Per-instance vertex attributes of entity.vert
+    struct EntityInstance {
+        glm::vec4 placement; // xyz position relative to the terrain's zero level, w yaw
+        glm::vec4 scale;
+        glm::vec4 color;
+    };
+
     void createUniformBuffers();
-    void updateTerrainUniforms(Scene* scene, const glm::mat4& viewMatrix, const glm::mat4& projMatrix);
-    void renderTerrain();
-    void renderEntities(Scene* scene);
-    
+    void createDescriptors();
+    void createTraceSampler();
+    void createPatchMesh();
+    void createEntityMeshes();
+    void createPipelines(VkRenderPass sceneRenderPass);
+    // Into colorFormats and depthFormat (VK_FORMAT_UNDEFINED: no depth, and no depth test);
+    // vertex and fragment specialization are optional
+    VkPipeline createPipeline(const std::string& vertexShader, const std::string& fragmentShader,
+                              const VkPipelineVertexInputStateCreateInfo& vertexInput,
+                              const VkSpecializationInfo* vertexSpecialization,
+                              const VkSpecializationInfo* fragmentSpecialization, VkCompareOp depthCompare,
+                              bool depthWrite, const std::vector<VkFormat>& colorFormats, VkFormat depthFormat,
+                              VkRenderPass renderPass);
+    void updateTerrainUniforms(const Settings& settings, const glm::mat4& viewMatrix, const glm::mat4& projMatrix,
+                               VkExtent2D extent, uint32_t traceScale, float time);
+    void selectPatches(const Settings& settings, const glm::mat4& viewProj);
+    void selectNode(const glm::vec2& origin, float size, uint32_t level, PatchInstance* instances);
+    void renderEntities(VkCommandBuffer commandBuffer);
+    void createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties,
+                      VkBuffer& buffer, VkDeviceMemory& bufferMemory);
+    uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties);
+    static std::vector<char> readShaderFile(const std::string& filename);
+    VkShaderModule createShaderModule(const std::vector<char>& code);
+
     VulkanDevice* m_device;
-    SwapChain* m_swapChain;
-    
-    // Terrain rendering
+    std::unique_ptr<TerrainHeightfield> m_heightfield;
+    std::unique_ptr<NoiseTexture> m_noiseTexture;
+
+    // Terrain rendering: set 0 is the uniform ring and noise, set 1 the heightfield, set 2 the trace targets
     VkPipelineLayout m_terrainPipelineLayout{VK_NULL_HANDLE};
-    VkPipeline m_terrainPipeline{VK_NULL_HANDLE};
-    VkBuffer m_terrainUniformBuffer{VK_NULL_HANDLE};
-    VkDeviceMemory m_terrainUniformMemory{VK_NULL_HANDLE};
-    void* m_terrainUniformMapped{nullptr};
+    VkPipeline m_terrainPipeline{VK_NULL_HANDLE};  // CDLOD patches
+    VkPipeline m_raymarchPipeline{VK_NULL_HANDLE}; // terrain.frag, terrain and sky
+    VkPipeline m_skyPipeline{VK_NULL_HANDLE};      // terrain.frag, sky only
+    VkPipeline m_tracePipeline{VK_NULL_HANDLE};    // terrain.frag into the trace targets
+    VkPipeline m_upsamplePipeline{VK_NULL_HANDLE}; // terrain.frag from the trace targets
+    VkPipeline m_entityPipeline{VK_NULL_HANDLE};   // Scene entities, set 0 only
     VkDescriptorSetLayout m_terrainDescriptorLayout{VK_NULL_HANDLE};
+    VkDescriptorSetLayout m_traceDescriptorLayout{VK_NULL_HANDLE};
     VkDescriptorPool m_descriptorPool{VK_NULL_HANDLE};
     VkDescriptorSet m_terrainDescriptorSet{VK_NULL_HANDLE};
-    
-    // Camera state
-    glm::vec3 m_cameraPos{0.0f, 15.0f, -25.0f};
-    glm::vec3 m_cameraTarget{0.0f, 5.0f, 0.0f};
-    uint32_t m_viewportWidth{640};
-    uint32_t m_viewportHeight{480};
-    
-    // Timing
-    float m_time{0.0f};
-    std::chrono::high_resolution_clock::time_point m_startTime;
-};
\ No newline at end of file
+    VkSampler m_traceSampler{VK_NULL_HANDLE};
+    // Render pass path only: the trace pipeline's color-only attachments
+    std::unique_ptr<RenderPass> m_traceRenderPass;
+
+    // Uniforms and patch instances, one slot per possible frame in flight plus one
+    static constexpr uint32_t RING_SLOTS = 4;
+    VkBuffer m_terrainUniformBuffer{VK_NULL_HANDLE};
+    VkDeviceMemory m_terrainUniformMemory{VK_NULL_HANDLE};
+    void* m_terrainUniformMapped{nullptr};
+    VkDeviceSize m_uniformSlotSize{0};
+    VkBuffer m_instanceBuffer{VK_NULL_HANDLE};
+    VkDeviceMemory m_instanceMemory{VK_NULL_HANDLE};
+    void* m_instanceMapped{nullptr};
+    uint32_t m_slot{0};
+    VkBuffer m_entityInstanceBuffer{VK_NULL_HANDLE};
+    VkDeviceMemory m_entityInstanceMemory{VK_NULL_HANDLE};
+    void* m_entityInstanceMapped{nullptr};
+    // The trace targets can change every frame, so each slot has its own set
+    std::array<VkDescriptorSet, RING_SLOTS> m_traceDescriptorSets{};
+
+    // One grid patch shared by every instance
+    VkBuffer m_patchVertexBuffer{VK_NULL_HANDLE};
+    VkDeviceMemory m_patchVertexMemory{VK_NULL_HANDLE};
+    VkBuffer m_patchIndexBuffer{VK_NULL_HANDLE};
+    VkDeviceMemory m_patchIndexMemory{VK_NULL_HANDLE};
+    uint32_t m_patchIndexCount{0};
+
+    // Every entity shape in one non-indexed buffer
+    VkBuffer m_entityVertexBuffer{VK_NULL_HANDLE};
+    VkDeviceMemory m_entityVertexMemory{VK_NULL_HANDLE};
+    std::array<uint32_t, ENTITY_MESH_COUNT> m_entityFirstVertex{};
+    std::array<uint32_t, ENTITY_MESH_COUNT> m_entityVertexCount{};
+
+    // This frame's selection
+    Technique m_technique{Technique::Mesh};
+    VkExtent2D m_traceExtent{0, 0};
+    Frustum m_frustum;
+    glm::vec3 m_cameraPos{0.0f};
+    float m_viewDistance{250.0f};
+    glm::vec2 m_heightRange{0.0f}; // World-space bounds of any height the function can produce
+    std::array<float, LOD_LEVELS> m_lodRanges{};
+    uint32_t m_patchCount{0};
+    // Entity parts grouped by shape, so each shape is one instanced draw
+    std::array<std::vector<EntityInstance>, ENTITY_MESH_COUNT> m_entityBatches;
+    std::array<uint32_t, ENTITY_MESH_COUNT> m_entityFirstInstance{};
+    std::array<uint32_t, ENTITY_MESH_COUNT> m_entityInstanceCount{};
+    TerrainHeightfield::Parameters m_heightfieldParameters;
+
+    Stats m_stats;
+};
@@ -3,22 +3,33 @@
 #include "core/VulkanDevice.h"
 #include "rendering/SwapChain.h"
 #include <vulkan/vulkan.h>
+#include <vector>
 
+// Color + depth render pass that pipelines (including ImGui's) are created
+// against on the render pass path. Frames render through the RenderGraph's own
+// compatible render passes; with dynamic rendering this class is not used.
 class RenderPass {
 public:
-    RenderPass(VulkanDevice* device, SwapChain* swapChain);
+    static constexpr VkFormat DEPTH_FORMAT = VK_FORMAT_D32_SFLOAT;
+
+    // depthOnly builds a depth-attachment-only pass, for depth prepass pipelines
+    RenderPass(VulkanDevice* device, SwapChain* swapChain, bool depthOnly = false);
+    // Color attachments in the given formats plus (unless depth is false) depth, for
+    // pipelines that draw into render graph transients rather than the swap chain
+    RenderPass(VulkanDevice* device, const std::vector<VkFormat>& colorFormats, bool depth = true);
     ~RenderPass();
 
     VkRenderPass getRenderPass() const { return m_renderPass; }
 
 private:
     void createRenderPass();
-    void createColorAttachment(VkAttachmentDescription& colorAttachment);
+    void createColorAttachment(VkAttachmentDescription& colorAttachment, VkFormat format);
     void createDepthAttachment(VkAttachmentDescription& depthAttachment);
-    void setupSubpass(VkSubpassDescription& subpass, VkAttachmentReference& colorAttachmentRef, VkAttachmentReference& depthAttachmentRef);
     void setupDependency(VkSubpassDependency& dependency);
 
     VulkanDevice* m_device;
-    SwapChain* m_swapChain;
     VkRenderPass m_renderPass;
+    std::vector<VkFormat> m_colorFormats; // Empty for a depth-only pass
+    bool m_presentable;                   // Color attachment is a swap chain image
+    bool m_depth;
 };
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstdint>
+
+// Key for one variant of the forward shading pipeline. Each feature bit maps to
+// a specialization constant in shader.frag or to pipeline state, so a material
+// compiles only the texture fetches it uses, and the debug render mode is
+// folded into the key so the PBR path carries no per-fragment mode branches.
+//
+// Layout: feature bits in the low byte, render mode above them.
+struct ShaderPermutation {
+    enum Feature : uint32_t {
+        NormalMap    = 1u << 0,
+        EmissiveMap  = 1u << 1,
+        OcclusionMap = 1u << 2,
+        VertexColors = 1u << 3,
+        AlphaMask    = 1u << 4, // glTF MASK: discard below the cutoff
+        AlphaBlend   = 1u << 5, // glTF BLEND: blending on, depth writes off
+        WeightedOIT  = 1u << 6, // Blend into the weighted-blended OIT targets instead
+    };
+
+    static constexpr uint32_t FEATURE_MASK = 0x7Fu;
+    static constexpr uint32_t TEXTURE_FEATURES = NormalMap | EmissiveMap | OcclusionMap | VertexColors;
+    static constexpr uint32_t RENDER_MODE_SHIFT = 8;
+    // Render modes with their own pipeline setup: the wireframe overlay adds a
+    // geometry stage, and points never go through the shading variants at all
+    static constexpr int WIREFRAME_MODE = 1;
+    static constexpr int POINTS_MODE = 2;
+
+    // Debug views drop the texture features they never read, so materials share
+    // variants; alpha handling is kept so cutouts and blending still apply
+    static constexpr uint32_t make(uint32_t bits, int mode) {
+        bits &= FEATURE_MASK;
+        uint32_t keep = TEXTURE_FEATURES;
+        switch (mode) {
+            case 3: keep = NormalMap; break;    // Normals
+            case 4: keep = VertexColors; break; // Albedo
+            case 5: case 6: keep = 0; break;    // Metallic, roughness
+            case 7: keep = OcclusionMap; break; // AO
+            default: break;
+        }
+        bits &= keep | ~TEXTURE_FEATURES;
+        return bits | (static_cast<uint32_t>(mode) << RENDER_MODE_SHIFT);
+    }
+    static constexpr uint32_t features(uint32_t key) { return key & FEATURE_MASK; }
+    static constexpr int renderMode(uint32_t key) { return static_cast<int>(key >> RENDER_MODE_SHIFT); }
+};
@@ -6,12 +6,17 @@
 
 class SwapChain {
 public:
-    SwapChain(VulkanDevice* device, VkExtent2D windowExtent);
+    // preferredImageCount of 0 keeps the driver minimum plus one. Passing the
+    // previous swap chain lets in-flight presents finish while it is replaced.
+    SwapChain(VulkanDevice* device, VkExtent2D windowExtent,
+              VkPresentModeKHR preferredPresentMode = VK_PRESENT_MODE_FIFO_KHR, uint32_t preferredImageCount = 0,
+              VkSwapchainKHR oldSwapChain = VK_NULL_HANDLE);
     ~SwapChain();
 
     VkSwapchainKHR getSwapChain() const { return m_swapChain; }
     VkFormat getImageFormat() const { return m_imageFormat; }
     VkExtent2D getExtent() const { return m_extent; }
+    VkPresentModeKHR getPresentMode() const { return m_presentMode; }
     const std::vector<VkImage>& getImages() const { return m_images; }
     const std::vector<VkImageView>& getImageViews() const { return m_imageViews; }
 
@@ -19,15 +24,18 @@ private:
     void createSwapChain();
     void createImageViews();
     VkSurfaceFormatKHR chooseSwapSurfaceFormat(const std::vector<VkSurfaceFormatKHR>& availableFormats);
-    VkPresentModeKHR chooseSwapPresentMode(const std::vector<VkPresentModeKHR>& availablePresentModes);
     VkExtent2D chooseSwapExtent(const VkSurfaceCapabilitiesKHR& capabilities);
 
     VulkanDevice* m_device;
     VkExtent2D m_windowExtent;
+    VkPresentModeKHR m_preferredPresentMode;
+    uint32_t m_preferredImageCount;
+    VkSwapchainKHR m_oldSwapChain;
 
     VkSwapchainKHR m_swapChain{VK_NULL_HANDLE};
     std::vector<VkImage> m_images;
     std::vector<VkImageView> m_imageViews;
     VkFormat m_imageFormat;
     VkExtent2D m_extent;
+    VkPresentModeKHR m_presentMode{VK_PRESENT_MODE_FIFO_KHR};
 };
@@ -0,0 +1,107 @@
+#pragma once
+
+#include "core/VulkanDevice.h"
+#include "rendering/ComputePipeline.h"
+#include <vulkan/vulkan.h>
+#include <glm/glm.hpp>
+#include <array>
+#include <cstdint>
+#include <memory>
+
+// Dynamic resolution with temporal upscaling. The scene is rendered at a
+// fraction of the output size with a sub-pixel jitter that cycles through a
+// Halton sequence; a compute resolve accumulates those samples into an
+// output-resolution history, reprojected with camera motion rebuilt from depth.
+// A frame-time controller picks the render scale from GPU timestamps, so heavy
+// scenes lose resolution gradually instead of dropping frames.
+//
+// History images stay in SHADER_READ_ONLY_OPTIMAL between frames; the frame
+// that writes one takes it through GENERAL and back.
+class TemporalUpscaler {
+public:
+    static constexpr VkFormat HISTORY_FORMAT = VK_FORMAT_R16G16B16A16_SFLOAT;
+    static constexpr float MIN_SCALE = 0.5f;
+    static constexpr float MAX_SCALE = 1.0f;
+
+    explicit TemporalUpscaler(VulkanDevice* device);
+    ~TemporalUpscaler();
+
+    TemporalUpscaler(const TemporalUpscaler&) = delete;
+    TemporalUpscaler& operator=(const TemporalUpscaler&) = delete;
+
+    // Frame-time controller. gpuMs is the latest measured GPU frame time (0 when
+    // timestamps are unavailable, which holds the current scale).
+    void updateScale(double gpuMs, float targetMs);
+    void resetScale() { m_scale = MAX_SCALE; }
+    float getRenderScale() const { return m_scale; }
+    VkExtent2D getRenderExtent(VkExtent2D outputExtent) const;
+
+    // (Re)create the history at the output resolution; a no-op if it already matches
+    void resize(VkExtent2D outputExtent);
+    // Start a frame: flip the history images and step the jitter sequence.
+    // Returns the projection offset in NDC for a renderExtent-sized target.
+    glm::vec2 beginFrame(VkExtent2D renderExtent);
+    // Drop the accumulated history, e.g. after switching models
+    void invalidateHistory() { m_historyValid = false; }
+
+    // History sampled this frame and history written this frame
+    VkImage getPreviousHistory() const { return m_history[m_historyIndex ^ 1].image; }
+    VkImageView getPreviousHistoryView() const { return m_history[m_historyIndex ^ 1].view; }
+    VkImage getCurrentHistory() const { return m_history[m_historyIndex].image; }
+    VkImageView getCurrentHistoryView() const { return m_history[m_historyIndex].view; }
+    VkExtent2D getOutputExtent() const { return m_outputExtent; }
+
+    // Resolve the jittered color into the current history. viewProjection is this
+    // frame's unjittered camera matrix; the previous one is remembered here.
+    void resolve(VkCommandBuffer commandBuffer, VkImageView colorView, VkImageView depthView,
+                 const glm::mat4& viewProjection);
+
+private:
+    // Push constants shared with temporal_resolve.comp
+    struct ResolveParams {
+        glm::mat4 reprojection;
+        glm::vec4 jitter; // xy jitter in UV units
+        glm::vec4 params; // x current frame weight, y 1 to discard history
+    };
+
+    struct HistoryImage {
+        VkImage image{VK_NULL_HANDLE};
+        VkDeviceMemory memory{VK_NULL_HANDLE};
+        VkImageView view{VK_NULL_HANDLE};
+    };
+
+    void createSamplers();
+    void createDescriptors();
+    void createHistory(VkExtent2D extent);
+    void retireHistory();
+    uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties);
+
+    VulkanDevice* m_device;
+    std::unique_ptr<ComputePipeline> m_resolvePipeline;
+
+    VkSampler m_linearSampler{VK_NULL_HANDLE};  // Color and history
+    VkSampler m_nearestSampler{VK_NULL_HANDLE}; // Depth, which need not support linear filtering
+    VkDescriptorSetLayout m_descriptorSetLayout{VK_NULL_HANDLE};
+    VkDescriptorPool m_descriptorPool{VK_NULL_HANDLE};
+
+    // Inputs are graph transients that can change every frame, so each frame
+    // rewrites its own set; one slot per possible frame in flight plus one
+    static constexpr uint32_t RING_SLOTS = 4;
+    std::array<VkDescriptorSet, RING_SLOTS> m_descriptorSets{};
+    uint32_t m_slot{0};
+
+    std::array<HistoryImage, 2> m_history;
+    uint32_t m_historyIndex{0};
+    VkExtent2D m_outputExtent{0, 0};
+    bool m_historyValid{false};
+    glm::mat4 m_previousViewProjection{1.0f};
+
+    // Jitter sequence and this frame's offset in UV units
+    uint32_t m_jitterIndex{0};
+    glm::vec2 m_jitterUV{0.0f};
+
+    // Controller state
+    float m_scale{MAX_SCALE};
+    double m_accumulatedMs{0.0};
+    uint32_t m_accumulatedFrames{0};
+};
@@ -0,0 +1,136 @@
+#pragma once
+
+#include "core/VulkanDevice.h"
+#include "core/TerrainFunction.h"
+#include "rendering/ComputePipeline.h"
+#include "rendering/TerrainTileCache.h"
+#include <vulkan/vulkan.h>
+#include <glm/glm.hpp>
+#include <memory>
+#include <vector>
+
+// The terrain surface around the camera, as the renderer samples it: a square
+// region of the world TILES_PER_SIDE TerrainTileCache tiles across, aligned to
+// the tile grid, holding
+//   - a height map, bilinearly filtered, which is the terrain surface,
+//   - a normal map from central differences of the height function, and
+//   - a max-height mip chain: level 0 holds the highest corner of each bilinear
+//     cell of the height map, every level above the highest of its 2x2 children.
+// A ray that passes above a cell's maximum cannot hit anything inside it, so the
+// raymarch in terrain.frag crosses open space a whole coarse cell at a time and
+// only intersects the bilinear surface itself in the few cells it grazes.
+//
+// Tiles are streamed continuously for the region around the camera plus a ring
+// of PREFETCH_TILES beyond it. Once the camera wanders an eighth of the way out
+// of the region, or the parameters change, a new region is targeted; it is
+// copied together from the tile atlas (and its max chain rebuilt) as soon as
+// every one of its tiles is resident. Until then the previous region is kept,
+// so the surface never shows tiles that have not arrived.
+//
+// Set 1 of the terrain pipeline layout:
+//   binding 0: height map (linear)
+//   binding 1: max-height mip chain (texelFetch with an explicit level)
+//   binding 2: normal map (linear), xyz in [-1, 1]
+class TerrainHeightfield {
+public:
+    static constexpr uint32_t RESOLUTION = 1024;
+    static constexpr VkFormat HEIGHT_FORMAT = TerrainTileCache::HEIGHT_FORMAT;
+    static constexpr VkFormat NORMAL_FORMAT = TerrainTileCache::NORMAL_FORMAT;
+    static constexpr uint32_t TILES_PER_SIDE = RESOLUTION / TerrainTileCache::TILE_RESOLUTION;
+    static constexpr uint32_t PREFETCH_TILES = 2;
+
+    struct Parameters {
+        TerrainFunction::Parameters terrain;
+        float extent{500.0f}; // Smallest world-space width of the region; rounded up to whole tiles
+
+        bool operator==(const Parameters& other) const {
+            return terrain == other.terrain && extent == other.extent;
+        }
+        bool operator!=(const Parameters& other) const { return !(*this == other); }
+    };
+
+    explicit TerrainHeightfield(VulkanDevice* device);
+    ~TerrainHeightfield();
+
+    TerrainHeightfield(const TerrainHeightfield&) = delete;
+    TerrainHeightfield& operator=(const TerrainHeightfield&) = delete;
+
+    // CPU side of a frame: streams tiles around cameraPos and decides whether the
+    // region is reassembled. Returns true if record() has work this frame, in
+    // which case it must be recorded before the textures are next sampled.
+    bool update(const glm::vec3& cameraPos, const Parameters& parameters);
+    // Record the tile uploads and any reassembly, outside a render pass. Earlier
+    // reads of the textures on this queue are waited for; afterwards they are in
+    // SHADER_READ_ONLY_OPTIMAL for the vertex and fragment stages. Returns true
+    // if the region was reassembled.
+    bool record(VkCommandBuffer commandBuffer);
+
+    // Bind set 1 of a terrain pipeline layout
+    void bind(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout) const;
+    VkDescriptorSetLayout getDescriptorSetLayout() const { return m_descriptorSetLayout; }
+
+    // xy: world XZ of the region's minimum corner, z: texel size, w: 1 once assembled.
+    // Height texel (i, j) is the height at origin + (i + 0.5, j + 0.5) * texelSize.
+    glm::vec4 getRegion() const;
+    uint32_t getMaxLevels() const { return m_maxLevels; }
+    const TerrainTileCache::Stats& getTileStats() const { return m_tileCache->getStats(); }
+
+private:
+    // Push constants of terrain_maxmip.comp
+    struct MaxMipParams {
+        int32_t srcLevel; // -1 reads the height map
+        int32_t dstSize;
+    };
+
+    void createSamplers();
+    void createImages();
+    void createDescriptors();
+    void createPipelines();
+    void createImage(VkFormat format, uint32_t mipLevels, VkImageUsageFlags usage, VkImage& image,
+                     VkDeviceMemory& memory);
+    void assemble(VkCommandBuffer commandBuffer);
+    void buildMaxChain(VkCommandBuffer commandBuffer);
+    TerrainTileCache::TileKey targetTile(uint32_t i, uint32_t j) const;
+    VkImageView createView(VkImage image, VkFormat format, uint32_t baseLevel, uint32_t levelCount);
+    uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties);
+
+    VulkanDevice* m_device;
+    std::unique_ptr<TerrainTileCache> m_tileCache;
+    std::unique_ptr<ComputePipeline> m_maxMipPipeline;
+
+    VkSampler m_linearSampler{VK_NULL_HANDLE};
+    VkSampler m_nearestSampler{VK_NULL_HANDLE};
+    VkDescriptorSetLayout m_descriptorSetLayout{VK_NULL_HANDLE};
+    VkDescriptorSetLayout m_computeSetLayout{VK_NULL_HANDLE};
+    VkDescriptorPool m_descriptorPool{VK_NULL_HANDLE};
+    VkDescriptorSet m_descriptorSet{VK_NULL_HANDLE};
+    // One per max-chain level: reads the level below (the height map for level 0)
+    std::vector<VkDescriptorSet> m_computeSets;
+
+    VkImage m_heightImage{VK_NULL_HANDLE};
+    VkDeviceMemory m_heightMemory{VK_NULL_HANDLE};
+    VkImageView m_heightView{VK_NULL_HANDLE};
+    VkImage m_normalImage{VK_NULL_HANDLE};
+    VkDeviceMemory m_normalMemory{VK_NULL_HANDLE};
+    VkImageView m_normalView{VK_NULL_HANDLE};
+    VkImage m_maxImage{VK_NULL_HANDLE};
+    VkDeviceMemory m_maxMemory{VK_NULL_HANDLE};
+    VkImageView m_maxView{VK_NULL_HANDLE};         // All levels, sampled
+    std::vector<VkImageView> m_maxLevelViews;      // One per level, written
+    uint32_t m_maxLevels{0};
+
+    // Assembled region
+    bool m_assembled{false};
+    Parameters m_parameters;
+    glm::vec2 m_center{0.0f};
+    glm::vec2 m_origin{0.0f};
+    float m_texelSize{1.0f};
+
+    // Region waiting for its tiles; its tile grid origin is in tiles of m_targetLevel
+    bool m_targetPending{false};
+    bool m_assembleThisFrame{false};
+    Parameters m_targetParameters;
+    int32_t m_targetLevel{0};
+    glm::ivec2 m_targetTile{0};
+    std::vector<TerrainTileCache::TileKey> m_wanted;
+};
@@ -0,0 +1,157 @@
+#pragma once
+
+#include "core/VulkanDevice.h"
+#include "core/TerrainFunction.h"
+#include <vulkan/vulkan.h>
+#include <glm/glm.hpp>
+#include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <list>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// Streams the terrain in fixed-size square tiles. Tiles are generated on worker
+// threads from TerrainFunction and uploaded into a pair of 2D array atlases (one
+// layer per tile) that are sized from a memory budget. Tiles are kept in LRU
+// order: every frame the caller names the tiles it wants, nearest first; resident
+// ones are touched, missing ones are queued for generation, and when the atlas is
+// full the tile unused for longest gives up its layer.
+//
+// The atlases stay in VK_IMAGE_LAYOUT_GENERAL and are only ever touched by
+// transfers: uploads write them, and TerrainHeightfield copies tiles out of them.
+class TerrainTileCache {
+public:
+    static constexpr uint32_t TILE_RESOLUTION = 64; // Texels along a tile side
+    static constexpr uint32_t MAX_UPLOADS_PER_FRAME = 16;
+    static constexpr VkDeviceSize DEFAULT_MEMORY_BUDGET = 32ull * 1024 * 1024;
+    static constexpr VkFormat HEIGHT_FORMAT = VK_FORMAT_R32_SFLOAT;
+    static constexpr VkFormat NORMAL_FORMAT = VK_FORMAT_R8G8B8A8_SNORM;
+
+    // Tile (x, z) of a level covers [x, x + 1) * tileSize(level) in world XZ, so
+    // every level is its own world-aligned grid
+    struct TileKey {
+        int32_t x{0};
+        int32_t z{0};
+        int32_t level{0};
+
+        bool operator==(const TileKey& other) const {
+            return x == other.x && z == other.z && level == other.level;
+        }
+    };
+    struct TileKeyHash {
+        size_t operator()(const TileKey& key) const {
+            size_t hash = static_cast<uint32_t>(key.x) * 73856093u;
+            hash ^= static_cast<uint32_t>(key.z) * 19349663u;
+            hash ^= static_cast<uint32_t>(key.level) * 83492791u;
+            return hash;
+        }
+    };
+
+    struct Stats {
+        uint32_t capacity{0};  // Atlas layers
+        uint32_t resident{0};
+        uint32_t pending{0};   // Queued, generating or waiting for upload
+        uint32_t uploads{0};   // This frame
+        uint64_t generated{0};
+        uint64_t evictions{0};
+    };
+
+    // minimumTiles: the most tiles a caller will ever want at once
+    TerrainTileCache(VulkanDevice* device, uint32_t minimumTiles, VkDeviceSize memoryBudget = DEFAULT_MEMORY_BUDGET);
+    ~TerrainTileCache();
+
+    TerrainTileCache(const TerrainTileCache&) = delete;
+    TerrainTileCache& operator=(const TerrainTileCache&) = delete;
+
+    static float tileSize(int32_t level) { return std::ldexp(1.0f, level); }
+
+    // Every tile is dropped when the parameters change
+    void setParameters(const TerrainFunction::Parameters& parameters);
+    // The tiles to keep this frame, in priority order. Afterwards finished tiles
+    // (up to MAX_UPLOADS_PER_FRAME) have been staged and count as resident, so
+    // recordUploads() must be recorded before anything reads them.
+    void request(const std::vector<TileKey>& tiles);
+    bool hasUploads() const { return !m_uploads.empty(); }
+    // Record this frame's staged uploads, outside a render pass. Transfers after
+    // it on the queue see the new tiles.
+    void recordUploads(VkCommandBuffer commandBuffer);
+
+    // Atlas layer of a resident tile, or -1
+    int32_t findLayer(const TileKey& key) const;
+    VkImage getHeightAtlas() const { return m_heightAtlas; }
+    VkImage getNormalAtlas() const { return m_normalAtlas; }
+    const Stats& getStats() const { return m_stats; }
+
+private:
+    struct Job {
+        TileKey key;
+        uint64_t generation;
+        TerrainFunction::Parameters parameters;
+    };
+    struct TileData {
+        TileKey key;
+        uint64_t generation;
+        std::vector<float> heights;
+        std::vector<uint32_t> normals; // Packed RGBA8_SNORM
+    };
+    struct Resident {
+        uint32_t layer;
+        uint64_t lastUsed; // Frame of the last request() that named it
+        std::list<TileKey>::iterator lruPosition;
+    };
+    struct Upload {
+        uint32_t layer;
+        VkDeviceSize offset; // Into the staging buffer: heights, then normals
+    };
+
+    void createAtlases();
+    void createStagingBuffer();
+    void createImage(VkFormat format, VkImage& image, VkDeviceMemory& memory);
+    void workerLoop();
+    static TileData generate(const Job& job);
+    void collectFinished();
+    // Frees the least recently used layer, unless that tile is wanted this frame
+    bool evict();
+    uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties);
+
+    VulkanDevice* m_device;
+    uint32_t m_capacity{0};
+
+    VkImage m_heightAtlas{VK_NULL_HANDLE};
+    VkDeviceMemory m_heightAtlasMemory{VK_NULL_HANDLE};
+    VkImage m_normalAtlas{VK_NULL_HANDLE};
+    VkDeviceMemory m_normalAtlasMemory{VK_NULL_HANDLE};
+
+    // Staged tiles, one slot per possible frame in flight plus one
+    static constexpr uint32_t RING_SLOTS = 4;
+    VkBuffer m_stagingBuffer{VK_NULL_HANDLE};
+    VkDeviceMemory m_stagingMemory{VK_NULL_HANDLE};
+    void* m_stagingMapped{nullptr};
+    uint32_t m_stagingSlot{0};
+    std::vector<Upload> m_uploads;
+
+    // Main thread only
+    TerrainFunction::Parameters m_parameters;
+    uint64_t m_generation{0};
+    uint64_t m_frame{0};
+    std::unordered_map<TileKey, Resident, TileKeyHash> m_resident;
+    std::list<TileKey> m_lru; // Most recently used first
+    std::vector<uint32_t> m_freeLayers;
+    // Queued for a worker or generated but not yet uploaded
+    std::unordered_set<TileKey, TileKeyHash> m_requested;
+
+    // Shared with the workers
+    std::vector<std::thread> m_workers;
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    std::deque<Job> m_queue;
+    std::vector<TileData> m_finished;
+    bool m_stopping{false};
+
+    Stats m_stats;
+};
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <array>
+#include <cstdint>
+#include <vector>
+
+// Back-to-front ordering for alpha-blended draws, redone every frame from the
+// camera. Each draw's view-space depth becomes a 32-bit key that sorts as an
+// unsigned integer, and an LSD radix sort (four 8-bit digits) orders them in
+// linear time. Large lists split the histogram and scatter steps of each digit
+// across worker threads; the per-chunk offsets keep the sort stable, so draws
+// at equal depth keep their material grouping.
+class TransparencySorter {
+public:
+    TransparencySorter();
+
+    // Indices into centers, farthest from the camera first
+    const std::vector<uint32_t>& sort(const std::vector<glm::vec3>& centers, const glm::mat4& viewMatrix);
+    const std::vector<uint32_t>& getOrder() const { return m_order; }
+
+    double getLastSortMs() const { return m_lastSortMs; }
+    uint32_t getLastChunkCount() const { return m_lastChunkCount; }
+
+private:
+    using Histogram = std::array<uint32_t, 256>;
+
+    void radixSort(uint32_t chunkCount);
+
+    uint32_t m_workerCount;
+    std::vector<uint32_t> m_keys;
+    std::vector<uint32_t> m_keysScratch;
+    std::vector<uint32_t> m_order;
+    std::vector<uint32_t> m_orderScratch;
+    std::vector<Histogram> m_histograms; // One per chunk
+
+    double m_lastSortMs{0.0};
+    uint32_t m_lastChunkCount{1};
+};
@@ -0,0 +1,54 @@
+#pragma once
+
+#include "core/VulkanDevice.h"
+#include <vulkan/vulkan.h>
+#include <array>
+#include <cstdint>
+
+// Weighted blended order-independent transparency (McGuire and Bavoil 2013).
+// Blended surfaces add their depth-weighted premultiplied color to an
+// accumulation target and multiply their coverage into a revealage target, in
+// any order; a full-screen composite then resolves the weighted average over
+// the opaque image. Cost is independent of how many transparent surfaces
+// overlap, at the price of approximate results where they differ strongly in
+// depth and color, so it backs up sorting for scenes with too many blended
+// draws to sort every frame.
+//
+// The accumulation pipelines are GraphicsPipeline shading variants
+// (ShaderPermutation::WeightedOIT); this class owns the composite's inputs.
+class WeightedBlendedOIT {
+public:
+    static constexpr VkFormat ACCUM_FORMAT = VK_FORMAT_R16G16B16A16_SFLOAT;
+    // 8-bit revealage bands visibly after a few layers
+    static constexpr VkFormat REVEALAGE_FORMAT = VK_FORMAT_R16_SFLOAT;
+    // In automatic mode, scenes with at least this many blended draws skip sorting
+    static constexpr uint32_t AUTO_DRAW_THRESHOLD = 512;
+
+    explicit WeightedBlendedOIT(VulkanDevice* device);
+    ~WeightedBlendedOIT();
+
+    WeightedBlendedOIT(const WeightedBlendedOIT&) = delete;
+    WeightedBlendedOIT& operator=(const WeightedBlendedOIT&) = delete;
+
+    // Set 0 of the composite pipeline: accumulation and revealage
+    VkDescriptorSetLayout getDescriptorSetLayout() const { return m_descriptorSetLayout; }
+
+    // Point this frame's set at the accumulation targets and bind it
+    void bindComposite(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout,
+                       VkImageView accumView, VkImageView revealageView);
+
+private:
+    void createSampler();
+    void createDescriptors();
+
+    VulkanDevice* m_device;
+    VkSampler m_sampler{VK_NULL_HANDLE};
+    VkDescriptorSetLayout m_descriptorSetLayout{VK_NULL_HANDLE};
+    VkDescriptorPool m_descriptorPool{VK_NULL_HANDLE};
+
+    // The targets are graph transients that can change every frame, so each
+    // frame rewrites its own set; one slot per possible frame in flight plus one
+    static constexpr uint32_t RING_SLOTS = 4;
+    std::array<VkDescriptorSet, RING_SLOTS> m_descriptorSets{};
+    uint32_t m_slot{0};
+};
@@ -1,6 +1,10 @@
 #pragma once
 
 #include "ecs/ECSManager.h"
+#include "ecs/JobSystem.h"
+#include "ecs/SystemScheduler.h"
+#include "ecs/Systems.h"
+#include "core/FrustumCuller.h"
 #include <glm/glm.hpp>
 #include <memory>
 
@@ -10,7 +14,9 @@ public:
     ~Scene() = default;
     
     void initialize();
-    void update(float deltaTime, const glm::vec3& cameraPos);
+    // Runs the frame's systems through the scheduler: entity streaming, then
+    // LOD and culling, then the render list
+    void update(float deltaTime, const glm::vec3& cameraPos, const FrustumCuller& frustumCuller);
     void cleanup();
     
     // Scene properties
@@ -40,6 +46,11 @@ public:
         // Entities
         float entitySpawnRadius = 100.0f;
         float entityCullDistance = 150.0f;
+        // Streaming reruns after the camera moves this fraction of the spawn radius, or after the interval
+        float entityStreamDistance = 0.1f;
+        float entityStreamInterval = 2.0f;
+        // Entities farther away are not LOD-updated or shown, up to the last LOD distance
+        float viewDistance = 250.0f;
         int maxEntities = 1000;
         bool enableTrees = true;
         bool enableRocks = true;
@@ -48,13 +59,27 @@ public:
     
     SceneSettings& getSettings() { return m_settings; }
     ECSManager* getECS() { return m_ecsManager.get(); }
+    // Per-system timings, and the hook to forward them to a profiler
+    SystemScheduler* getScheduler() { return m_scheduler.get(); }
+    // Built by the last update()
+    const std::vector<RenderSystem::RenderData>& getRenderList() const { return *m_renderList; }
     
 private:
     void generateTerrain();
+    void updateEntityStreaming();
     void populateEntities(const glm::vec3& cameraPos);
     
     SceneSettings m_settings;
     std::unique_ptr<ECSManager> m_ecsManager;
+    std::unique_ptr<JobSystem> m_jobs;
+    std::unique_ptr<SystemScheduler> m_scheduler;
     glm::vec3 m_lastCameraPos{0.0f};
     float m_lastSpawnTime{0.0f};
+    
+    // This frame's inputs, read by the scheduled systems
+    float m_deltaTime{0.0f};
+    glm::vec3 m_cameraPos{0.0f};
+    const FrustumCuller* m_frustumCuller{nullptr};
+    const std::vector<RenderSystem::RenderData>* m_renderList{&s_emptyRenderList};
+    static const std::vector<RenderSystem::RenderData> s_emptyRenderList;
 };
\ No newline at end of file
@@ -11,9 +11,22 @@
 #include <imgui.h>
 #include <imgui_impl_glfw.h>
 #include <imgui_impl_vulkan.h>
+#include <cstdint>
 #include <memory>
+#include <string>
+#include <vector>
 #include <glm/glm.hpp>
 
+struct PassTiming {
+    std::string name;
+    float gpuTime = 0.0f; // seconds
+};
+
+struct SystemTiming {
+    std::string name;
+    float cpuTime = 0.0f; // seconds
+};
+
 struct PerformanceStats {
     float frameTime = 0.0f;
     float fps = 0.0f;
@@ -21,6 +34,75 @@ struct PerformanceStats {
     float cpuTime = 0.0f;
     float gpuTime = 0.0f;
     int qualityLevel = 2;
+    
+    // Latency (seconds, smoothed)
+    float inputToSubmit = 0.0f;
+    float submitToGpuComplete = 0.0f;
+    float inputToGpuComplete = 0.0f;
+    bool presentTimed = false; // Present wait measured up to the image being shown
+    float submitToPresent = 0.0f;
+    float inputToPresent = 0.0f;
+    int activePresentMode = 0;
+    int swapchainImageCount = 0;
+    
+    // Render graph
+    std::vector<PassTiming> passTimings;
+    std::vector<SystemTiming> systemTimings; // Scene ECS systems, empty while the scene is idle
+    int graphPassCount = 0;
+    int graphCulledPasses = 0;
+    int graphBarrierCount = 0;
+    float transientMemoryMB = 0.0f;
+    float aliasedMemoryMB = 0.0f;
+    
+    // Fragment shader invocations in the shading pass (pipeline statistics)
+    bool fragmentStatsSupported = false;
+    uint64_t shadedFragments = 0;
+    uint64_t shadedFragmentsNoPrepass = 0;   // Last frame measured without the prepass
+    uint64_t shadedFragmentsWithPrepass = 0; // Last frame measured with it
+    
+    // Shadow cascades
+    int shadowCascadesActive = 0;
+    int shadowCascadesRendered = 0; // Re-rendered this frame; 0 while the cache holds
+    uint64_t shadowMapRenders = 0;
+    
+    // Dynamic resolution
+    float renderScale = 1.0f;
+    int renderWidth = 0;
+    int renderHeight = 0;
+    
+    // Post-processing, read back a few frames late
+    float postExposure = 1.0f;
+    float averageLuminance = 0.0f;
+    
+    // Shader permutations
+    int shadingVariants = 0; // Pipelines compiled so far
+    int materialDraws = 0;   // Draws per frame, one per material run
+    
+    // Transparency
+    int blendedDraws = 0;
+    bool weightedOITActive = false; // Otherwise blended draws are sorted
+    float transparencySortMs = 0.0f;
+    int transparencySortChunks = 1; // Threads sharing the last sort
+    
+    // Hi-Z occlusion culling, counted a few frames late
+    int cullObjects = 0;
+    int cullDrawnEarly = 0;
+    int cullDrawnLate = 0;  // Hidden last frame, visible now
+    int cullOccluded = 0;
+    int cullOutsideFrustum = 0;
+    
+    // Terrain
+    int terrainPatches = 0;
+    int terrainTriangles = 0;
+    uint64_t terrainRebuilds = 0;
+    int terrainTilesResident = 0;
+    int terrainTileCapacity = 0;
+    int terrainTilesPending = 0;
+    int terrainTileUploads = 0;
+    uint64_t terrainTilesGenerated = 0;
+    uint64_t terrainTileEvictions = 0;
+    int sceneEntities = 0;   // Visible this frame
+    int entityInstances = 0; // Their instanced parts
 };
 
 struct RenderSettings {
@@ -29,7 +111,34 @@ struct RenderSettings {
     bool enableWater = true;
     int qualityLevel = 2; // 0=low, 1=med, 2=high
     bool showDebugUI = true;
-    bool enableVSync = true;
+    
+    // Presentation
+    int presentMode = 0; // 0=FIFO (V-Sync), 1=FIFO Relaxed, 2=Mailbox, 3=Immediate
+    int framesInFlight = 2;
+    int swapchainImageCount = 0; // 0 = driver minimum + 1
+    bool lowLatencyMode = false; // Wait for the previous frame before sampling input
+    
+    // Lay down depth first so the PBR shader only runs on visible fragments
+    bool depthPrepass = false;
+    
+    // Skip primitives hidden behind others, tested on the GPU against a depth pyramid
+    bool occlusionCulling = true;
+    
+    // Render below the window's resolution and upscale temporally, scaling
+    // between 50% and 100% to keep GPU frame time under the target
+    bool dynamicResolution = false;
+    float targetFrameMs = 16.6f;
+    
+    // Alpha-blended materials: 0=Auto (sort, or weighted OIT for very many blended
+    // draws), 1=Sorted back to front, 2=Weighted blended OIT
+    int transparencyMode = 0;
+    
+    // Procedural terrain drawn with the scene: 0=CDLOD mesh, 1=Raymarch
+    bool showTerrain = false;
+    int terrainTechnique = 0;
+    int terrainRaymarchResolution = 0; // Raymarch trace: 0=Full, 1=Half, 2=Quarter (upsampled)
+    float terrainLodDistance = 48.0f; // Range of the finest mesh level
+    float terrainBaseHeight = -20.0f;
     
     // Visual settings for stunning terrain
     float viewDistance = 250.0f;
@@ -56,6 +165,12 @@ struct BackgroundSettings {
     // Environment
     float environmentRotation = 0.0f;
     float environmentIntensity = 1.0f;
+    
+    // HDR environment for image-based lighting
+    std::string pendingEnvironmentPath; // Set by the UI, consumed by VulkanApp
+    std::string environmentName;        // Empty until an environment is loaded
+    float environmentLoadMs = 0.0f;
+    bool environmentFromCache = false;
 };
 
 class DebugUI {
@@ -66,8 +181,9 @@ public:
     void newFrame();
     void render();
     void renderDebugPanel(PerformanceStats& stats, RenderSettings& settings);
-    void renderViewerPanel(PerformanceStats& stats, GLTFViewer* viewer, BackgroundSettings& backgroundSettings);
+    void renderViewerPanel(PerformanceStats& stats, RenderSettings& renderSettings, GLTFViewer* viewer, BackgroundSettings& backgroundSettings);
     void renderDrawData(VkCommandBuffer commandBuffer);
+    void setSwapChain(SwapChain* swapChain);
     
     VkCommandBuffer getCommandBuffer() const { return m_commandBuffer; }
     bool wantsCaptureMouse() const { return ImGui::GetIO().WantCaptureMouse; }
@@ -76,10 +192,13 @@ public:
 private:
     void createDescriptorPool();
     void createCommandBuffers();
+    void renderPresentationSettings(PerformanceStats& stats, RenderSettings& settings);
+    void renderFrameGraphStats(const PerformanceStats& stats);
 
     VulkanDevice* m_device;
     SwapChain* m_swapChain;
-    VkRenderPass m_renderPass;
+    VkRenderPass m_renderPass; // VK_NULL_HANDLE selects dynamic rendering
+    VkFormat m_colorFormat{VK_FORMAT_UNDEFINED};
     GLFWwindow* m_window;
     
     VkDescriptorPool m_descriptorPool{VK_NULL_HANDLE};
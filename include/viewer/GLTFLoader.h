@@ -1,6 +1,7 @@
 #pragma once
 
 #include "core/VulkanDevice.h"
+#include "core/CommandContext.h"
 #include <vulkan/vulkan.h>
 #include <glm/glm.hpp>
 #include <glm/gtc/quaternion.hpp>
@@ -9,6 +10,8 @@
 #include <string>
 #include <vector>
 #include <memory>
+#include <functional>
+#include <utility>
 
 struct Vertex {
     glm::vec3 position;
@@ -24,6 +27,7 @@ struct Primitive {
     uint32_t firstIndex;
     uint32_t indexCount;
     int32_t materialIndex = -1;
+    bool hasVertexColors = false; // COLOR_0 present
     VkBuffer indexBuffer{VK_NULL_HANDLE};
     VkDeviceMemory indexBufferMemory{VK_NULL_HANDLE};
 };
@@ -36,6 +40,8 @@ struct Mesh {
 };
 
 struct Material {
+    enum class AlphaMode { Opaque, Mask, Blend };
+    
     glm::vec4 baseColorFactor = glm::vec4(1.0f);
     float metallicFactor = 1.0f;
     float roughnessFactor = 1.0f;
@@ -46,6 +52,31 @@ struct Material {
     int normalTextureIndex = -1;
     int metallicRoughnessTextureIndex = -1;
     int emissiveTextureIndex = -1;
+    int occlusionTextureIndex = -1;
+    
+    AlphaMode alphaMode = AlphaMode::Opaque;
+    float alphaCutoff = 0.5f; // MASK only
+};
+
+// A run of indices sharing one material, drawn with one vkCmdDrawIndexed.
+// features holds the ShaderPermutation bits the material needs. Opaque and
+// masked runs also cover objectCount consecutive draw objects from firstObject.
+struct MaterialDraw {
+    uint32_t firstIndex;
+    uint32_t indexCount;
+    int32_t materialIndex;
+    uint32_t features;
+    uint32_t firstObject = 0;
+    uint32_t objectCount = 0;
+};
+
+// One opaque or masked primitive as seen by GPU culling: its model-space
+// bounding box and index range. Laid out for std430 (occlusion_cull.comp).
+struct DrawObject {
+    glm::vec3 boundsMin;
+    uint32_t firstIndex;
+    glm::vec3 boundsMax;
+    uint32_t indexCount;
 };
 
 struct Node {
@@ -61,6 +92,20 @@ struct Node {
     glm::mat4 getWorldMatrix(const std::vector<Node>& nodes) const;
 };
 
+// KHR_lights_punctual light, resolved to world space through its node
+struct PunctualLight {
+    enum class Type : int { Directional = 0, Point = 1, Spot = 2 };
+    
+    Type type = Type::Point;
+    glm::vec3 position = glm::vec3(0.0f);
+    glm::vec3 direction = glm::vec3(0.0f, 0.0f, -1.0f); // Node's -Z axis
+    glm::vec3 color = glm::vec3(1.0f);
+    float intensity = 1.0f;        // Candela for point/spot, lux for directional
+    float range = 0.0f;            // 0 means unlimited
+    float innerConeAngle = 0.0f;
+    float outerConeAngle = 0.7853981634f;
+};
+
 struct Texture {
     VkImage image{VK_NULL_HANDLE};
     VkDeviceMemory imageMemory{VK_NULL_HANDLE};
@@ -69,7 +114,7 @@ struct Texture {
     uint32_t width, height;
     uint32_t mipLevels;
     
-    // Temporary staging buffer for texture data
+    // Temporary staging buffer for texture data; released once the upload completes
     VkBuffer stagingBuffer{VK_NULL_HANDLE};
     VkDeviceMemory stagingMemory{VK_NULL_HANDLE};
 };
@@ -82,14 +127,40 @@ public:
     bool loadFromFile(const std::string& filePath);
     void cleanup();
     
-    // Rendering
-    void render(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout);
+    // Rendering: opaque then alpha-masked material runs, each sorted by permutation
+    // then material so state changes are minimal; bindMaterial runs before each draw.
+    // With an indirect buffer (one VkDrawIndexedIndirectCommand per draw object,
+    // e.g. from GPU culling) each run draws its objects' commands instead.
+    void render(VkCommandBuffer commandBuffer, const std::function<void(const MaterialDraw&)>& bindMaterial,
+                VkBuffer indirectBuffer = VK_NULL_HANDLE);
+    // Alpha-blended primitives in the given order (indices into getBlendDraws());
+    // an empty order draws them as stored
+    void renderBlended(VkCommandBuffer commandBuffer, const std::vector<uint32_t>& order,
+                       const std::function<void(const MaterialDraw&)>& bindMaterial);
+    // Position-only draw of the opaque geometry, plus alpha-masked geometry when
+    // includeMasked (cutouts cast solid shadows); blended geometry is never included.
+    // An indirect buffer is read as in render().
+    void renderDepth(VkCommandBuffer commandBuffer, bool includeMasked = false,
+                     VkBuffer indirectBuffer = VK_NULL_HANDLE);
+    // Every vertex once, unindexed, for a POINT_LIST pipeline; shared vertices are not repeated
+    void renderPoints(VkCommandBuffer commandBuffer);
     
     // Getters
     const std::vector<Mesh>& getMeshes() const { return m_meshes; }
     const std::vector<Material>& getMaterials() const { return m_materials; }
     const std::vector<Node>& getNodes() const { return m_nodes; }
     const std::vector<Texture>& getTextures() const { return m_textures; }
+    const std::vector<PunctualLight>& getLights() const { return m_lights; }
+    const std::vector<MaterialDraw>& getMaterialDraws() const { return m_materialDraws; }
+    // One per blended primitive, unmerged so each can be sorted on its own
+    const std::vector<MaterialDraw>& getBlendDraws() const { return m_blendDraws; }
+    // Bounding-box center of each blend draw, in model space
+    const std::vector<glm::vec3>& getBlendCenters() const { return m_blendCenters; }
+    bool hasMaskedDraws() const { return m_maskedDrawBegin < m_materialDraws.size(); }
+    // One per opaque or masked primitive, in material draw order
+    const std::vector<DrawObject>& getDrawObjects() const { return m_drawObjects; }
+    // Bumped on every successful load, so consumers can tell when per-model data changed
+    uint32_t getGeneration() const { return m_generation; }
     
     // Model bounds
     glm::vec3 getCenter() const { return m_center; }
@@ -122,23 +193,36 @@ private:
     void loadMaterial(const tinygltf::Model& model, const tinygltf::Material& material);
     void loadTexture(const tinygltf::Model& model, const tinygltf::Texture& texture);
     void loadImage(const tinygltf::Model& model, const tinygltf::Image& image, Texture& texture);
+    void loadLights(const tinygltf::Model& model);
     
+    void buildMaterialDraws();
+    void drawIndirect(VkCommandBuffer commandBuffer, VkBuffer indirectBuffer, uint32_t firstObject, uint32_t objectCount);
     void createBuffers();
+    void releaseModelResources();
     void calculateBounds();
     void createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties,
                      VkBuffer& buffer, VkDeviceMemory& bufferMemory);
     void createVulkanTexture(Texture& texture, const unsigned char* data, uint32_t width, uint32_t height, int channels);
-    void transitionImageLayout(VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout, uint32_t mipLevels);
-    void copyBufferToImage(VkBuffer buffer, VkImage image, uint32_t width, uint32_t height);
-    void generateMipmaps(VkImage image, VkFormat imageFormat, int32_t texWidth, int32_t texHeight, uint32_t mipLevels);
-    VkCommandBuffer beginSingleTimeCommands();
-    void endSingleTimeCommands(VkCommandBuffer commandBuffer);
+    void transitionImageLayout(VkCommandBuffer commandBuffer, VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout, uint32_t mipLevels);
+    void copyBufferToImage(VkCommandBuffer commandBuffer, VkBuffer buffer, VkImage image, uint32_t width, uint32_t height);
+    void generateMipmaps(VkCommandBuffer commandBuffer, VkImage image, VkFormat imageFormat, int32_t texWidth, int32_t texHeight, uint32_t mipLevels);
     void createDefaultTextures();
-    void createCommandPool();
     uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties);
     
+    // Uploads are recorded into one transfer-queue batch, then ownership is
+    // acquired on the graphics queue (which also builds the mip chains)
+    void beginUploadBatch();
+    void endUploadBatch();
+    void uploadBuffer(const void* data, VkDeviceSize size, VkBufferUsageFlags usage,
+                      VkAccessFlags dstAccess, VkPipelineStageFlags dstStage,
+                      VkBuffer& buffer, VkDeviceMemory& bufferMemory);
+    
     VulkanDevice* m_device;
-    VkCommandPool m_commandPool{VK_NULL_HANDLE};
+    std::unique_ptr<CommandContext> m_transferContext;
+    std::unique_ptr<CommandContext> m_graphicsContext;
+    VkCommandBuffer m_transferCommands{VK_NULL_HANDLE};
+    VkCommandBuffer m_graphicsCommands{VK_NULL_HANDLE};
+    std::vector<std::pair<VkBuffer, VkDeviceMemory>> m_pendingStaging;
     
     // glTF data
     tinygltf::Model m_model;
@@ -146,6 +230,16 @@ private:
     std::vector<Material> m_materials;
     std::vector<Node> m_nodes;
     std::vector<Texture> m_textures;
+    std::vector<PunctualLight> m_lights;
+    std::vector<MaterialDraw> m_materialDraws; // Opaque runs, then masked from m_maskedDrawBegin
+    size_t m_maskedDrawBegin{0};
+    std::vector<DrawObject> m_drawObjects; // Opaque objects, then masked from m_maskedObjectBegin
+    uint32_t m_maskedObjectBegin{0};
+    std::vector<MaterialDraw> m_blendDraws;
+    std::vector<glm::vec3> m_blendCenters;
+    // Merged index ranges (first, count) for the position-only draws
+    std::vector<std::pair<uint32_t, uint32_t>> m_opaqueDepthRanges;
+    std::vector<std::pair<uint32_t, uint32_t>> m_shadowDepthRanges;
     
     // Model bounds
     glm::vec3 m_center{0.0f};
@@ -164,6 +258,8 @@ private:
     // Vulkan buffers for rendering
     VkBuffer m_vertexBuffer{VK_NULL_HANDLE};
     VkDeviceMemory m_vertexBufferMemory{VK_NULL_HANDLE};
+    VkBuffer m_positionBuffer{VK_NULL_HANDLE}; // Positions only, 12 bytes per vertex
+    VkDeviceMemory m_positionBufferMemory{VK_NULL_HANDLE};
     VkBuffer m_indexBuffer{VK_NULL_HANDLE};
     VkDeviceMemory m_indexBufferMemory{VK_NULL_HANDLE};
     
@@ -175,4 +271,5 @@ private:
     Texture m_defaultAOTexture{};
     
     bool m_loaded{false};
+    uint32_t m_generation{0};
 };
\ No newline at end of file
@@ -5,13 +5,18 @@
 #include "viewer/GLTFLoader.h"
 #include "viewer/OrbitCamera.h"
 #include "viewer/Gizmo.h"
+#include "rendering/TransparencySorter.h"
 #include <glm/glm.hpp>
 #include <memory>
 #include <string>
+#include <vector>
+
+class GraphicsPipeline;
 
 struct ViewerSettings {
     // Rendering modes
-    int renderMode = 0; // 0=PBR, 1=Wireframe, 2=Points, 3=Normals, 4=Albedo, 5=Metallic, 6=Roughness, 7=AO
+    int renderMode = 0; // 0=PBR, 1=Wireframe overlay, 2=Points, 3=Normals, 4=Albedo, 5=Metallic, 6=Roughness, 7=AO
+    float pointSize = 0.005f; // Points mode: diameter as a fraction of the model radius
     
     // Primary light
     glm::vec3 lightDirection = glm::normalize(glm::vec3(-0.5f, -0.8f, -0.3f));
@@ -30,10 +35,16 @@ struct ViewerSettings {
     // IBL and environment
     float iblIntensity = 1.0f;
     float shadowIntensity = 1.0f;
+    int shadowQuality = 2; // 0=Off, 1=Hard, 2=PCF 3x3, 3=PCF 5x5
     
     // Post-processing
-    float exposure = 1.0f;
+    int tonemapper = 1; // PostProcessor::Tonemapper: 0=Reinhard, 1=ACES, 2=AgX
+    bool autoExposure = true;
+    float exposure = 1.0f; // Compensation on top of auto exposure
     float gamma = 2.2f;
+    bool bloom = true;
+    float bloomIntensity = 0.05f;
+    float bloomThreshold = 1.0f;
     
     // Material properties
     float metallicFactor = 1.0f;
@@ -57,20 +68,43 @@ struct ViewerSettings {
     float autoRotateSpeed = 0.5f;
     
     // Performance
-    bool enableVSync = true;
     bool showFPS = true;
 };
 
 class GLTFViewer {
 public:
+    // Fragment push constants, placed after ImageBasedLighting::ShadingParams
+    struct MaterialParams {
+        glm::vec4 baseColorFactor;
+        glm::vec4 alphaParams; // x alpha cutoff
+    };
+    
     GLTFViewer(VulkanDevice* device, SwapChain* swapChain);
     ~GLTFViewer();
     
     void initialize();
+    void setSwapChain(SwapChain* swapChain) { m_swapChain = swapChain; }
     void loadModel(const std::string& filePath);
     void update(float deltaTime);
     void render();
-    void renderToCommandBuffer(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout);
+    // Binds the shading variant and descriptor set each material needs. Opaque and
+    // alpha-masked draws only; masked ones are missing from the prepass, so they
+    // always use the depth-writing variants. An indirect buffer draws GPU-culled
+    // per-object commands instead (see GLTFLoader::render).
+    void renderToCommandBuffer(VkCommandBuffer commandBuffer, GraphicsPipeline* pipeline, bool depthPrepass,
+                               VkBuffer indirectBuffer = VK_NULL_HANDLE);
+    // Alpha-blended draws: back to front in the last sortTransparentDraws() order,
+    // or in any order into the weighted-blended OIT targets
+    void renderTransparentToCommandBuffer(VkCommandBuffer commandBuffer, GraphicsPipeline* pipeline, bool weightedOIT);
+    // includeMasked adds alpha-masked geometry, for shadow casting
+    void renderDepthToCommandBuffer(VkCommandBuffer commandBuffer, bool includeMasked = false,
+                                    VkBuffer indirectBuffer = VK_NULL_HANDLE);
+    // Points mode: every vertex as one distance-attenuated point, viewportHeight in render pixels
+    void renderPointsToCommandBuffer(VkCommandBuffer commandBuffer, GraphicsPipeline* pipeline, float viewportHeight);
+    // Orders the blended draws back to front for the current camera
+    void sortTransparentDraws();
+    uint32_t getBlendedDrawCount() const { return m_loader ? static_cast<uint32_t>(m_loader->getBlendDraws().size()) : 0; }
+    const TransparencySorter& getTransparencySorter() const { return m_transparencySorter; }
     void cleanup();
     
     // Camera controls
@@ -109,14 +143,22 @@ public:
     OrbitCamera& getCamera() { return *m_camera; }
     GLTFLoader& getLoader() { return *m_loader; }
     
-    // Vulkan resources access
+    // Vulkan resources access: the UBO with default textures, valid for any pass
     VkDescriptorSet getDescriptorSet() const { return m_descriptorSet; }
     
 private:
     void createRenderPipelines();
     void createUniformBuffer();
     void updateUniformBuffers();
-    void updateTextureDescriptors();
+    void createMaterialDescriptors();
+    
+    // Pipeline and material currently bound while recording a run of draws
+    struct MaterialBindState {
+        VkPipeline pipeline = VK_NULL_HANDLE;
+        int32_t materialIndex = -2;
+    };
+    void bindMaterialDraw(VkCommandBuffer commandBuffer, GraphicsPipeline* pipeline, const MaterialDraw& draw,
+                          uint32_t features, bool depthPrepass, MaterialBindState& state);
     void renderModel();
     void renderGizmo();
     uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties);
@@ -132,8 +174,6 @@ private:
     
     // Vulkan resources
     VkPipelineLayout m_pipelineLayout{VK_NULL_HANDLE};
-    VkPipeline m_solidPipeline{VK_NULL_HANDLE};
-    VkPipeline m_wireframePipeline{VK_NULL_HANDLE};
     
     // Uniform buffers
     VkBuffer m_uniformBuffer{VK_NULL_HANDLE};
@@ -143,6 +183,10 @@ private:
     VkDescriptorSetLayout m_descriptorLayout{VK_NULL_HANDLE};
     VkDescriptorPool m_descriptorPool{VK_NULL_HANDLE};
     VkDescriptorSet m_descriptorSet{VK_NULL_HANDLE};
+    // Set 0 per material: index 0 is the default set, material i uses i + 1
+    std::vector<VkDescriptorSet> m_materialDescriptorSets;
+    
+    TransparencySorter m_transparencySorter;
     
     // Mouse interaction state
     bool m_leftMousePressed{false};
@@ -25,7 +25,8 @@ public:
     
     // Getters
     glm::mat4 getViewMatrix() const;
-    glm::mat4 getProjectionMatrix(float aspectRatio) const;
+    // Includes the sub-pixel jitter unless jittered is false
+    glm::mat4 getProjectionMatrix(float aspectRatio, bool jittered = true) const;
     glm::vec3 getPosition() const;
     glm::vec3 getDirection() const;
     glm::vec3 getUp() const { return glm::vec3(0.0f, 1.0f, 0.0f); }
@@ -36,6 +37,8 @@ public:
     void setNearFar(float near, float far) { m_near = near; m_far = far; }
     void setTarget(const glm::vec3& target) { m_target = target; }
     void setDistance(float distance) { m_targetDistance = distance; }
+    // Projection offset in NDC for temporal upscaling; zero disables it
+    void setJitter(const glm::vec2& jitter) { m_jitter = jitter; }
     
     float getFOV() const { return m_fov; }
     float getNear() const { return m_near; }
@@ -74,6 +77,7 @@ private:
     float m_fov{45.0f};
     float m_near{0.1f};
     float m_far{1000.0f};
+    glm::vec2 m_jitter{0.0f};
     
     // Limits
     float m_minPitch{-89.0f};
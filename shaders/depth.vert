@@ -0,0 +1,20 @@
+#version 450
+
+// Depth prepass: position-only stream, same transform as shader.vert so the
+// shading pass can test with EQUAL
+
+layout(location = 0) in vec3 inPosition;
+
+// Uniform buffer (matrices only; layout matches shader.vert)
+layout(binding = 0) uniform UniformBufferObject {
+    mat4 modelMatrix;
+    mat4 viewMatrix;
+    mat4 projMatrix;
+} ubo;
+
+invariant gl_Position;
+
+void main() {
+    vec4 worldPos = ubo.modelMatrix * vec4(inPosition, 1.0);
+    gl_Position = ubo.projMatrix * ubo.viewMatrix * worldPos;
+}
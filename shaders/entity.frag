@@ -0,0 +1,70 @@
+#version 450
+
+// Scene entities, flat shaded under the terrain's sun, ambient and fog so they
+// sit in the same light as the ground they stand on.
+
+layout(location = 0) in vec3 fragWorldPos;
+layout(location = 1) in vec3 fragNormal;
+layout(location = 2) in vec3 fragColor;
+
+layout(location = 0) out vec4 outColor;
+
+// RenderManager's TerrainUniformData
+layout(set = 0, binding = 0) uniform TerrainUniformData {
+    mat4 viewMatrix;
+    mat4 projMatrix;
+    mat4 invViewProj;
+
+    vec3 cameraPos;
+    float time;
+
+    // Scene lighting
+    vec3 sunDirection;
+    float sunIntensity;
+    vec3 sunColor;
+    float baseHeight;
+    vec3 ambientColor;
+    float ambientIntensity;
+    vec3 skyColorHorizon;
+    float padding1;
+    vec3 skyColorZenith;
+    float padding2;
+    vec3 fogColor;
+    float fogDensity;
+
+    // Terrain settings
+    float terrainScale;
+    float terrainHeight;
+    float waterLevel;
+    int enableWater;
+
+    // Quality settings
+    int qualityLevel;
+    float viewDistance;
+    vec2 viewportSize;
+
+    // TerrainHeightfield::getRegion(): xy region origin (world XZ), z texel size
+    vec4 heightfieldRegion;
+
+    // Reduced-resolution raymarch: x screen pixels per trace texel, y relative
+    // hit-distance jump that counts as an edge
+    vec4 traceParameters;
+} ubo;
+
+vec3 applyFog(vec3 color, float distance, vec3 rayDir) {
+    float fogAmount = 1.0 - exp(-distance * ubo.fogDensity);
+    vec3 skyColor = mix(ubo.skyColorHorizon, ubo.skyColorZenith, max(rayDir.y * 0.5 + 0.5, 0.0));
+    return mix(color, skyColor, fogAmount);
+}
+
+void main() {
+    vec3 toSurface = fragWorldPos - ubo.cameraPos;
+    vec3 normal = normalize(fragNormal);
+
+    float diff = max(dot(normal, normalize(ubo.sunDirection)), 0.0);
+    vec3 diffuse = fragColor * ubo.sunColor * ubo.sunIntensity * diff;
+    vec3 ambient = fragColor * ubo.ambientColor * ubo.ambientIntensity;
+
+    // Linear HDR; the post chain tonemaps and encodes for display
+    outColor = vec4(applyFog(diffuse + ambient, length(toSurface), normalize(toSurface)), 1.0);
+}
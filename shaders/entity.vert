@@ -0,0 +1,72 @@
+#version 450
+
+// One part of a scene entity (see RenderManager::updateEntities): a unit shape
+// scaled, turned about the vertical and placed on the terrain.
+
+layout(location = 0) in vec3 inPosition;
+layout(location = 1) in vec3 inNormal;
+layout(location = 2) in vec4 inPlacement; // xyz position relative to the terrain's zero level, w yaw
+layout(location = 3) in vec4 inScale;     // xyz
+layout(location = 4) in vec4 inColor;     // rgb albedo
+
+// RenderManager's TerrainUniformData
+layout(set = 0, binding = 0) uniform TerrainUniformData {
+    mat4 viewMatrix;
+    mat4 projMatrix;
+    mat4 invViewProj;
+
+    vec3 cameraPos;
+    float time;
+
+    // Scene lighting
+    vec3 sunDirection;
+    float sunIntensity;
+    vec3 sunColor;
+    float baseHeight;
+    vec3 ambientColor;
+    float ambientIntensity;
+    vec3 skyColorHorizon;
+    float padding1;
+    vec3 skyColorZenith;
+    float padding2;
+    vec3 fogColor;
+    float fogDensity;
+
+    // Terrain settings
+    float terrainScale;
+    float terrainHeight;
+    float waterLevel;
+    int enableWater;
+
+    // Quality settings
+    int qualityLevel;
+    float viewDistance;
+    vec2 viewportSize;
+
+    // TerrainHeightfield::getRegion(): xy region origin (world XZ), z texel size
+    vec4 heightfieldRegion;
+
+    // Reduced-resolution raymarch: x screen pixels per trace texel, y relative
+    // hit-distance jump that counts as an edge
+    vec4 traceParameters;
+} ubo;
+
+layout(location = 0) out vec3 fragWorldPos;
+layout(location = 1) out vec3 fragNormal;
+layout(location = 2) out vec3 fragColor;
+
+void main() {
+    float c = cos(inPlacement.w);
+    float s = sin(inPlacement.w);
+    mat3 rotation = mat3(c, 0.0, -s,
+                         0.0, 1.0, 0.0,
+                         s, 0.0, c);
+
+    vec3 worldPos = inPlacement.xyz + rotation * (inPosition * inScale.xyz);
+    worldPos.y += ubo.baseHeight;
+
+    fragWorldPos = worldPos;
+    fragNormal = rotation * (inNormal / inScale.xyz);
+    fragColor = inColor.rgb;
+    gl_Position = ubo.projMatrix * ubo.viewMatrix * vec4(worldPos, 1.0);
+}
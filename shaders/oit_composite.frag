@@ -0,0 +1,28 @@
+#version 450
+
+// Weighted-blended OIT resolve. The accumulation target holds the sum of
+// weighted premultiplied colors (alpha: sum of weighted coverage), revealage the
+// product of (1 - alpha); their weighted average goes over the opaque image with
+// the pipeline's SRC_ALPHA / ONE_MINUS_SRC_ALPHA blend.
+
+layout(set = 0, binding = 0) uniform sampler2D accumulation;
+layout(set = 0, binding = 1) uniform sampler2D revealage;
+
+layout(location = 0) out vec4 outColor;
+
+void main() {
+    ivec2 texel = ivec2(gl_FragCoord.xy);
+    float revealed = texelFetch(revealage, texel, 0).r;
+    // Nothing transparent covers this pixel
+    if (revealed >= 1.0) {
+        discard;
+    }
+
+    vec4 accum = texelFetch(accumulation, texel, 0);
+    // Keep the sum finite where many bright layers overflow half floats
+    if (isinf(max(max(abs(accum.r), abs(accum.g)), abs(accum.b)))) {
+        accum.rgb = vec3(accum.a);
+    }
+    vec3 averageColor = accum.rgb / max(accum.a, 1e-5);
+    outColor = vec4(averageColor, 1.0 - revealed);
+}
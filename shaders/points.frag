@@ -0,0 +1,31 @@
+#version 450
+
+layout(location = 0) in vec3 fragWorldPos;
+layout(location = 1) in vec3 fragNormal;
+layout(location = 2) in vec4 fragColor;
+
+layout(location = 0) out vec4 outColor;
+
+layout(binding = 0) uniform UniformBufferObject {
+    mat4 modelMatrix;
+    mat4 viewMatrix;
+    mat4 projMatrix;
+    mat4 normalMatrix;
+    
+    vec3 cameraPos;
+    float time;
+} ubo;
+
+void main() {
+    // Round points; the square's corners are dropped
+    vec2 offset = gl_PointCoord * 2.0 - 1.0;
+    if (dot(offset, offset) > 1.0) {
+        discard;
+    }
+    
+    // Headlight shading keeps the point cloud's shape readable; linear HDR like the forward pass
+    vec3 viewDir = normalize(ubo.cameraPos - fragWorldPos);
+    float facing = abs(dot(normalize(fragNormal), viewDir));
+    vec3 baseColor = vec3(0.9, 0.25, 0.15) * fragColor.rgb;
+    outColor = vec4(baseColor * (0.35 + 0.65 * facing), 1.0);
+}
@@ -0,0 +1,43 @@
+#version 450
+
+// Points view: every vertex of the model once, as a round point whose size
+// shrinks with distance like a small sphere of fixed world size would.
+
+layout(location = 0) in vec3 inPosition;
+layout(location = 1) in vec3 inNormal;
+layout(location = 3) in vec4 inColor;
+
+// Only the matrices and camera position are used; same layout as shader.vert
+layout(binding = 0) uniform UniformBufferObject {
+    mat4 modelMatrix;
+    mat4 viewMatrix;
+    mat4 projMatrix;
+    mat4 normalMatrix;
+    
+    vec3 cameraPos;
+    float time;
+} ubo;
+
+layout(push_constant) uniform PointParams {
+    float worldSize;      // Point diameter in world units
+    float viewportHeight; // In pixels
+    float minSize;        // Clamp range in pixels
+    float maxSize;
+} push;
+
+layout(location = 0) out vec3 fragWorldPos;
+layout(location = 1) out vec3 fragNormal;
+layout(location = 2) out vec4 fragColor;
+
+void main() {
+    vec4 worldPos = ubo.modelMatrix * vec4(inPosition, 1.0);
+    gl_Position = ubo.projMatrix * ubo.viewMatrix * worldPos;
+    
+    // projMatrix[1][1] is cot(fovY / 2): world size to pixels at unit depth
+    float pixels = push.worldSize * ubo.projMatrix[1][1] * push.viewportHeight * 0.5 / max(gl_Position.w, 1e-4);
+    gl_PointSize = clamp(pixels, push.minSize, push.maxSize);
+    
+    fragWorldPos = worldPos.xyz;
+    fragNormal = normalize((ubo.normalMatrix * vec4(inNormal, 0.0)).xyz);
+    fragColor = inColor;
+}
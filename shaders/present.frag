@@ -0,0 +1,25 @@
+#version 450
+
+// Copies the post chain's display-encoded image into the swap chain. An sRGB
+// swap chain encodes on write, so the value is decoded first and the stored
+// bytes come out exactly as the post chain wrote them.
+
+layout(constant_id = 0) const bool SRGB_TARGET = false;
+
+layout(set = 0, binding = 0) uniform sampler2D displayColor;
+
+layout(location = 0) out vec4 outColor;
+
+vec3 srgbToLinear(vec3 color) {
+    vec3 low = color / 12.92;
+    vec3 high = pow((color + 0.055) / 1.055, vec3(2.4));
+    return mix(high, low, lessThanEqual(color, vec3(0.04045)));
+}
+
+void main() {
+    vec3 color = texelFetch(displayColor, ivec2(gl_FragCoord.xy), 0).rgb;
+    if (SRGB_TARGET) {
+        color = srgbToLinear(color);
+    }
+    outColor = vec4(color, 1.0);
+}
@@ -5,10 +5,26 @@ layout(location = 0) in vec3 fragWorldPos;
 layout(location = 1) in vec3 fragNormal;
 layout(location = 2) in vec2 fragTexCoord;
 layout(location = 3) in vec4 fragColor;
-layout(location = 4) in vec3 fragTangent;
-layout(location = 5) in vec3 fragBitangent;
+// Wireframe overlay only (see wireframe.geom)
+layout(location = 4) noperspective in vec3 fragBarycentric;
 
 layout(location = 0) out vec4 outColor;
+// Weighted-blended OIT only: the second target holds revealage
+layout(location = 1) out float outRevealage;
+
+// Permutation features (see ShaderPermutation). Each pipeline variant fixes
+// these, so disabled features compile away instead of branching per fragment.
+layout(constant_id = 0) const bool HAS_NORMAL_MAP = false;
+layout(constant_id = 1) const bool HAS_EMISSIVE_MAP = false;
+layout(constant_id = 2) const bool HAS_OCCLUSION_MAP = false;
+layout(constant_id = 3) const bool USE_VERTEX_COLORS = false;
+// 0=PBR, 1=Wireframe overlay, 3=Normals, 4=Albedo, 5=Metallic, 6=Roughness, 7=AO
+// (2=Points has its own pipeline, points.vert/points.frag)
+layout(constant_id = 4) const int RENDER_MODE = 0;
+// glTF alpha modes: MASK discards below the cutoff; BLEND under weighted OIT
+// writes accumulation and revealage instead of a blended color
+layout(constant_id = 5) const bool ALPHA_MASK = false;
+layout(constant_id = 6) const bool WEIGHTED_OIT = false;
 
 // Uniform buffer (matches vertex shader)
 layout(binding = 0) uniform UniformBufferObject {
@@ -36,7 +52,7 @@ layout(binding = 0) uniform UniformBufferObject {
     vec3 ambientColor;
     float ambientIntensity;
     
-    // IBL and environment
+    // IBL and environment; exposure and gamma are applied by the post chain, not here
     float exposure;
     float gamma;
     float iblIntensity;
@@ -45,7 +61,7 @@ layout(binding = 0) uniform UniformBufferObject {
     // Material override
     float metallicFactor;
     float roughnessFactor;
-    int renderMode;
+    int renderMode; // Unused here: the mode is the RENDER_MODE specialization constant
     float padding3;
 } ubo;
 
@@ -56,20 +72,97 @@ layout(binding = 3) uniform sampler2D metallicRoughnessMap;
 layout(binding = 4) uniform sampler2D emissiveMap;
 layout(binding = 5) uniform sampler2D aoMap;
 
+// Clustered punctual lights (see ClusteredLighting)
+struct PunctualLight {
+    vec4 positionRange;   // xyz position (world), w range
+    vec4 directionType;   // xyz direction (world), w type: 0 directional, 1 point, 2 spot
+    vec4 colorIntensity;
+    vec4 spotScaleOffset;
+};
+
+layout(std430, set = 1, binding = 0) readonly buffer LightBuffer {
+    PunctualLight lights[];
+};
+
+layout(std430, set = 1, binding = 1) readonly buffer ClusterCounts {
+    uint clusterLightCount[];
+};
+
+layout(std430, set = 1, binding = 2) readonly buffer ClusterIndices {
+    uint clusterLightIndices[];
+};
+
+// Cascaded shadow maps for the primary light (see CascadedShadowMaps)
+layout(set = 2, binding = 0) uniform ShadowData {
+    mat4 lightViewProj[4];
+    vec4 splitDepths;    // View-space far distance of each cascade
+    vec4 texelWorldSize; // World size of one texel per cascade
+    vec4 params;         // x quality (0 off, 1 hard, 2 PCF 3x3, 3 PCF 5x5), y active cascades, z 1/map size
+} shadow;
+
+layout(set = 2, binding = 1) uniform sampler2DShadow shadowMaps[4];
+
+// Precomputed image-based lighting (see ImageBasedLighting)
+layout(set = 3, binding = 0) uniform samplerCube specularEnvironment;
+layout(set = 3, binding = 1) uniform sampler2D brdfLut;
+layout(set = 3, binding = 2) uniform IrradianceSH {
+    vec4 sh[9]; // Cosine-convolved, divided by pi
+} irradiance;
+
+layout(push_constant) uniform FragmentParams {
+    // ClusteredLighting::ClusterParams
+    vec4 depthParams; // near, far, slice scale, slice bias
+    vec4 tileSize;    // pixels per tile in x, y
+    uvec4 grid;       // x, y, z, max lights per cluster
+    // ImageBasedLighting::ShadingParams
+    vec4 envRotation; // cos, sin about +Y
+    vec4 envParams;   // x intensity, y max specular mip, z 1 if an environment is loaded
+    // GLTFViewer::MaterialParams
+    vec4 baseColorFactor;
+    vec4 alphaParams; // x alpha cutoff
+} push;
+
 const float PI = 3.14159265359;
 
-// Utility functions
-vec3 getNormalFromMap() {
+// Tangent frame from screen-space derivatives of position and UV, so normal
+// mapping needs no per-vertex tangents
+vec3 getNormalFromMap(vec3 N) {
     vec3 tangentNormal = texture(normalMap, fragTexCoord).xyz * 2.0 - 1.0;
     
-    vec3 N = normalize(fragNormal);
-    vec3 T = normalize(fragTangent);
-    vec3 B = normalize(fragBitangent);
-    mat3 TBN = mat3(T, B, N);
+    vec3 dp1 = dFdx(fragWorldPos);
+    vec3 dp2 = dFdy(fragWorldPos);
+    vec2 duv1 = dFdx(fragTexCoord);
+    vec2 duv2 = dFdy(fragTexCoord);
+    
+    vec3 dp2perp = cross(dp2, N);
+    vec3 dp1perp = cross(N, dp1);
+    vec3 T = dp2perp * duv1.x + dp1perp * duv2.x;
+    vec3 B = dp2perp * duv1.y + dp1perp * duv2.y;
+    
+    // Degenerate UVs give no frame; keep the geometric normal
+    float maxLengthSq = max(dot(T, T), dot(B, B));
+    if (maxLengthSq < 1e-20) {
+        return N;
+    }
+    float invMax = inversesqrt(maxLengthSq);
+    mat3 TBN = mat3(T * invMax, B * invMax, N);
     
     return normalize(TBN * tangentNormal);
 }
 
+// Color is linear HDR; exposure, tonemapping and display encoding happen in the post chain
+void writeOutput(vec3 color, float alpha) {
+    if (WEIGHTED_OIT) {
+        // McGuire and Bavoil's depth weight: nearer surfaces dominate the average
+        float depthWeight = 3e3 * pow(1.0 - gl_FragCoord.z, 3.0);
+        float weight = clamp(alpha * max(1e-2, depthWeight), 1e-2, 3e3);
+        outColor = vec4(color * alpha, alpha) * weight;
+        outRevealage = alpha;
+    } else {
+        outColor = vec4(color, alpha);
+    }
+}
+
 float distributionGGX(vec3 N, vec3 H, float roughness) {
     float a = roughness * roughness;
     float a2 = a * a;
@@ -110,6 +203,92 @@ vec3 fresnelSchlickRoughness(float cosTheta, vec3 F0, float roughness) {
     return F0 + (max(vec3(1.0 - roughness), F0) - F0) * pow(clamp(1.0 - cosTheta, 0.0, 1.0), 5.0);
 }
 
+// KHR_lights_punctual range window: smooth falloff to zero at the light's range
+float rangeAttenuation(float lightDistance, float range) {
+    float ratio = lightDistance / range;
+    float window = clamp(1.0 - ratio * ratio * ratio * ratio, 0.0, 1.0);
+    return window * window / max(lightDistance * lightDistance, 0.0001);
+}
+
+uint clusterIndex() {
+    float viewDepth = -(ubo.viewMatrix * vec4(fragWorldPos, 1.0)).z;
+    uint slice = uint(clamp(log(max(viewDepth, push.depthParams.x)) * push.depthParams.z + push.depthParams.w,
+                            0.0, float(push.grid.z - 1)));
+    uvec2 tile = min(uvec2(gl_FragCoord.xy / push.tileSize.xy), push.grid.xy - 1);
+    return tile.x + tile.y * push.grid.x + slice * push.grid.x * push.grid.y;
+}
+
+// Constant indices only, so the sampler array never needs non-uniform indexing
+float sampleShadowMap(uint cascade, vec3 coord) {
+    switch (cascade) {
+        case 0: return texture(shadowMaps[0], coord);
+        case 1: return texture(shadowMaps[1], coord);
+        case 2: return texture(shadowMaps[2], coord);
+        default: return texture(shadowMaps[3], coord);
+    }
+}
+
+float shadowVisibility(vec3 normal, vec3 lightDir) {
+    int quality = int(shadow.params.x);
+    uint activeCascades = uint(shadow.params.y);
+    if (quality == 0 || activeCascades == 0) {
+        return 1.0;
+    }
+    
+    float viewDepth = -(ubo.viewMatrix * vec4(fragWorldPos, 1.0)).z;
+    uint cascade = activeCascades - 1;
+    for (uint i = 0; i < activeCascades - 1; i++) {
+        if (viewDepth <= shadow.splitDepths[i]) {
+            cascade = i;
+            break;
+        }
+    }
+    
+    // Normal offset scaled to the cascade's texel size, more at grazing angles
+    float NdotL = clamp(dot(normal, lightDir), 0.0, 1.0);
+    vec3 offsetPos = fragWorldPos + normal * shadow.texelWorldSize[cascade] * 1.5 * (1.0 - NdotL * 0.5);
+    vec4 lightClip = shadow.lightViewProj[cascade] * vec4(offsetPos, 1.0);
+    vec3 coord = vec3(lightClip.xy * 0.5 + 0.5, lightClip.z);
+    if (coord.z >= 1.0) {
+        return 1.0;
+    }
+    
+    if (quality == 1) {
+        return sampleShadowMap(cascade, coord);
+    }
+    
+    // Each comparison tap is already a bilinear 2x2 PCF
+    int radius = quality == 2 ? 1 : 2;
+    float texel = shadow.params.z;
+    float sum = 0.0;
+    for (int y = -radius; y <= radius; y++) {
+        for (int x = -radius; x <= radius; x++) {
+            sum += sampleShadowMap(cascade, vec3(coord.xy + vec2(x, y) * texel, coord.z));
+        }
+    }
+    float taps = float((2 * radius + 1) * (2 * radius + 1));
+    return sum / taps;
+}
+
+// Environment lookups happen in the rotated environment's frame
+vec3 environmentDirection(vec3 dir) {
+    vec2 r = push.envRotation.xy;
+    return vec3(r.x * dir.x - r.y * dir.z, dir.y, r.y * dir.x + r.x * dir.z);
+}
+
+vec3 evaluateIrradiance(vec3 n) {
+    vec3 result = irradiance.sh[0].rgb * 0.282095
+        + irradiance.sh[1].rgb * 0.488603 * n.y
+        + irradiance.sh[2].rgb * 0.488603 * n.z
+        + irradiance.sh[3].rgb * 0.488603 * n.x
+        + irradiance.sh[4].rgb * 1.092548 * n.x * n.y
+        + irradiance.sh[5].rgb * 1.092548 * n.y * n.z
+        + irradiance.sh[6].rgb * 0.315392 * (3.0 * n.z * n.z - 1.0)
+        + irradiance.sh[7].rgb * 1.092548 * n.x * n.z
+        + irradiance.sh[8].rgb * 0.546274 * (n.x * n.x - n.y * n.y);
+    return max(result, vec3(0.0));
+}
+
 vec3 calculatePBR(vec3 albedo, vec3 normal, vec3 viewDir, vec3 lightDir, vec3 lightColor, float metallic, float roughness) {
     vec3 halfwayDir = normalize(lightDir + viewDir);
     
@@ -133,16 +312,35 @@ vec3 calculatePBR(vec3 albedo, vec3 normal, vec3 viewDir, vec3 lightDir, vec3 li
     return (kD * albedo / PI + specular) * lightColor * NdotL;
 }
 
+// Coverage of a constant-width wire along the triangle's edges. The barycentrics
+// are linear in screen space, so dividing by their screen derivatives gives the
+// distance to each edge in pixels.
+float wireCoverage() {
+    const float WIRE_WIDTH = 1.0; // Pixels
+    vec3 pixels = fragBarycentric / max(fwidth(fragBarycentric), vec3(1e-6));
+    float edge = min(min(pixels.x, pixels.y), pixels.z);
+    return 1.0 - smoothstep(WIRE_WIDTH - 0.5, WIRE_WIDTH + 0.5, edge);
+}
+
 void main() {
     // Sample material properties from textures
-    vec4 albedoSample = texture(albedoMap, fragTexCoord);
-    vec3 albedo = albedoSample.rgb * fragColor.rgb;
-    float alpha = albedoSample.a * fragColor.a;
+    vec4 albedoSample = texture(albedoMap, fragTexCoord) * push.baseColorFactor;
+    vec3 albedo = albedoSample.rgb;
+    float alpha = albedoSample.a;
+    if (USE_VERTEX_COLORS) {
+        albedo *= fragColor.rgb;
+        alpha *= fragColor.a;
+    }
+    if (ALPHA_MASK) {
+        if (alpha < push.alphaParams.x) {
+            discard;
+        }
+        alpha = 1.0;
+    }
     
-    // Get normal from normal map or use vertex normal
     vec3 normal = normalize(fragNormal);
-    if (textureSize(normalMap, 0).x > 1) {
-        normal = getNormalFromMap();
+    if (HAS_NORMAL_MAP) {
+        normal = getNormalFromMap(normal);
     }
     
     // Sample metallic/roughness map (metallic in B channel, roughness in G channel)
@@ -154,19 +352,34 @@ void main() {
     metallic = clamp(metallic, 0.0, 1.0);
     roughness = clamp(roughness, 0.04, 1.0); // Prevent roughness from being too low
     
-    // Sample AO map
-    float ao = texture(aoMap, fragTexCoord).r;
-    if (textureSize(aoMap, 0).x <= 1) ao = 1.0; // No AO map
+    float ao = HAS_OCCLUSION_MAP ? texture(aoMap, fragTexCoord).r : 1.0;
+    
+    // Debug views skip lighting entirely
+    if (RENDER_MODE >= 3) {
+        vec3 debugColor;
+        if (RENDER_MODE == 3) { // Normals
+            debugColor = normal * 0.5 + 0.5;
+        } else if (RENDER_MODE == 4) { // Albedo only
+            debugColor = albedo;
+        } else if (RENDER_MODE == 5) { // Metallic only
+            debugColor = vec3(metallic);
+        } else if (RENDER_MODE == 6) { // Roughness only
+            debugColor = vec3(roughness);
+        } else { // AO only
+            debugColor = vec3(ao);
+        }
+        writeOutput(debugColor, alpha);
+        return;
+    }
     
-    // Sample emissive map
-    vec3 emissive = texture(emissiveMap, fragTexCoord).rgb;
-    if (textureSize(emissiveMap, 0).x <= 1) emissive = vec3(0.0); // No emissive map
+    vec3 emissive = HAS_EMISSIVE_MAP ? texture(emissiveMap, fragTexCoord).rgb : vec3(0.0);
     
     vec3 viewDir = normalize(ubo.cameraPos - fragWorldPos);
     
     // Primary light contribution
     vec3 lightDir1 = normalize(-ubo.lightDirection);
     vec3 Lo = calculatePBR(albedo, normal, viewDir, lightDir1, ubo.lightColor * ubo.lightIntensity, metallic, roughness);
+    Lo *= mix(1.0, shadowVisibility(normalize(fragNormal), lightDir1), ubo.shadowIntensity);
     
     // Secondary light contribution
     if (ubo.light2Intensity > 0.0) {
@@ -174,6 +387,32 @@ void main() {
         Lo += calculatePBR(albedo, normal, viewDir, lightDir2, ubo.light2Color * ubo.light2Intensity, metallic, roughness);
     }
     
+    // Model lights: only the ones binned into this fragment's cluster
+    uint clusterId = clusterIndex();
+    uint clusterLights = min(clusterLightCount[clusterId], push.grid.w);
+    uint clusterBase = clusterId * push.grid.w;
+    for (uint i = 0; i < clusterLights; i++) {
+        PunctualLight light = lights[clusterLightIndices[clusterBase + i]];
+        uint type = uint(light.directionType.w);
+        vec3 radiance = light.colorIntensity.rgb * light.colorIntensity.a;
+        
+        vec3 lightDir;
+        if (type == 0) {
+            lightDir = normalize(-light.directionType.xyz);
+        } else {
+            vec3 toLight = light.positionRange.xyz - fragWorldPos;
+            float lightDistance = length(toLight);
+            lightDir = toLight / max(lightDistance, 0.0001);
+            radiance *= rangeAttenuation(lightDistance, light.positionRange.w);
+            if (type == 2) {
+                float cd = dot(normalize(light.directionType.xyz), -lightDir);
+                float cone = clamp(cd * light.spotScaleOffset.x + light.spotScaleOffset.y, 0.0, 1.0);
+                radiance *= cone * cone;
+            }
+        }
+        Lo += calculatePBR(albedo, normal, viewDir, lightDir, radiance, metallic, roughness);
+    }
+    
     // Ambient lighting with improved IBL approximation
     vec3 F0 = vec3(0.04);
     F0 = mix(F0, albedo, metallic);
@@ -183,37 +422,27 @@ void main() {
     vec3 kD = 1.0 - kS;
     kD *= 1.0 - metallic;
     
-    // Enhanced ambient lighting
-    vec3 ambient = (kD * albedo + kS * 0.1) * ubo.ambientColor * ubo.ambientIntensity * ubo.iblIntensity * ao;
+    vec3 ambient;
+    if (push.envParams.z > 0.5) {
+        // Split-sum specular plus SH irradiance from the loaded environment
+        float NdotV = max(dot(normal, viewDir), 0.0);
+        vec3 R = reflect(-viewDir, normal);
+        vec3 prefiltered = textureLod(specularEnvironment, environmentDirection(R), roughness * push.envParams.y).rgb;
+        vec2 envBrdf = texture(brdfLut, vec2(NdotV, roughness)).rg;
+        vec3 diffuse = evaluateIrradiance(environmentDirection(normal)) * albedo;
+        vec3 specular = prefiltered * (F * envBrdf.x + envBrdf.y);
+        ambient = (kD * diffuse + specular) * ubo.iblIntensity * push.envParams.x * ao;
+    } else {
+        // Enhanced ambient lighting
+        ambient = (kD * albedo + kS * 0.1) * ubo.ambientColor * ubo.ambientIntensity * ubo.iblIntensity * ao;
+    }
     
     // Add emissive
     vec3 color = ambient + Lo + emissive;
     
-    // Handle render modes
-    if (ubo.renderMode == 1) { // Wireframe
-        color = mix(color, vec3(1.0), 0.8);
-    } else if (ubo.renderMode == 2) { // Points
-        color = vec3(1.0, 0.0, 0.0);
-    } else if (ubo.renderMode == 3) { // Normals
-        color = normal * 0.5 + 0.5;
-    } else if (ubo.renderMode == 4) { // Albedo only
-        color = albedo;
-    } else if (ubo.renderMode == 5) { // Metallic only
-        color = vec3(metallic);
-    } else if (ubo.renderMode == 6) { // Roughness only
-        color = vec3(roughness);
-    } else if (ubo.renderMode == 7) { // AO only
-        color = vec3(ao);
-    }
-    
-    // HDR tone mapping
-    color = color * ubo.exposure;
-    
-    // Reinhard tone mapping
-    color = color / (color + vec3(1.0));
-    
-    // Gamma correction
-    color = pow(color, vec3(1.0 / ubo.gamma));
-    
-    outColor = vec4(color, alpha);
-}
\ No newline at end of file
+    if (RENDER_MODE == 1) { // Wireframe overlay
+        color = mix(color, vec3(0.02), wireCoverage());
+    }
+    
+    writeOutput(color, alpha);
+}
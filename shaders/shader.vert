@@ -50,8 +50,11 @@ layout(location = 0) out vec3 fragWorldPos;
 layout(location = 1) out vec3 fragNormal;
 layout(location = 2) out vec2 fragTexCoord;
 layout(location = 3) out vec4 fragColor;
-layout(location = 4) out vec3 fragTangent;
-layout(location = 5) out vec3 fragBitangent;
+// Filled in per triangle by wireframe.geom; without it every pixel is far from an edge
+layout(location = 4) noperspective out vec3 fragBarycentric;
+
+// Bit-identical depth with depth.vert, required for the prepass EQUAL test
+invariant gl_Position;
 
 void main() {
     vec4 worldPos = ubo.modelMatrix * vec4(inPosition, 1.0);
@@ -61,11 +64,5 @@ void main() {
     fragNormal = normalize((ubo.normalMatrix * vec4(inNormal, 0.0)).xyz);
     fragTexCoord = inTexCoord;
     fragColor = inColor;
-    
-    // Calculate tangent space for normal mapping
-    // Simple tangent calculation (for proper normal mapping, tangents should come from the model)
-    vec3 c1 = cross(fragNormal, vec3(0.0, 0.0, 1.0));
-    vec3 c2 = cross(fragNormal, vec3(0.0, 1.0, 0.0));
-    fragTangent = normalize(length(c1) > length(c2) ? c1 : c2);
-    fragBitangent = normalize(cross(fragNormal, fragTangent));
+    fragBarycentric = vec3(1.0);
 }
@@ -0,0 +1,14 @@
+#version 450
+
+// Shadow map rendering: position-only stream transformed straight into the
+// cascade's light space
+
+layout(location = 0) in vec3 inPosition;
+
+layout(push_constant) uniform ShadowPush {
+    mat4 lightViewProj;
+} push;
+
+void main() {
+    gl_Position = push.lightViewProj * vec4(inPosition, 1.0);
+}
@@ -1,28 +1,44 @@
 #version 450
 
-layout(location = 0) in vec2 fragCoord;
+// Per-pixel terrain (RenderManager's Raymarch technique) and, with TRACE_TERRAIN
+// off, the sky behind the CDLOD mesh. Drawn as a fullscreen triangle after the
+// opaque scene; the hit's depth is written so the terrain and the scene occlude
+// each other, and sky pixels write the far plane so they only fill what nothing
+// else covered.
+//
+// At reduced resolution the raymarch is split in two. RAYMARCH_PASS 1 traces one
+// ray per trace texel into a color and a hit-distance target, outside the scene
+// pass; RAYMARCH_PASS 2 then runs per screen pixel in the scene pass, blending the
+// four nearest trace texels where their distances agree and tracing the pixel
+// itself only where they do not (silhouettes and the sky line).
+
+layout(constant_id = 0) const bool TRACE_TERRAIN = true;
+// 0: trace every pixel, 1: reduced-resolution trace, 2: upsample the trace
+layout(constant_id = 1) const int RAYMARCH_PASS = 0;
+
 layout(location = 0) out vec4 outColor;
+layout(location = 1) out float outDistance; // RAYMARCH_PASS 1 only; 0 where the ray missed
 
-// Simplified terrain-only uniform buffer
-layout(binding = 0) uniform TerrainUniformData {
-    vec3 cameraPos;
-    float time;
-    vec3 cameraTarget;
-    float aspectRatio;
+// RenderManager's TerrainUniformData
+layout(set = 0, binding = 0) uniform TerrainUniformData {
     mat4 viewMatrix;
     mat4 projMatrix;
+    mat4 invViewProj;
+    
+    vec3 cameraPos;
+    float time;
     
     // Scene lighting
     vec3 sunDirection;
     float sunIntensity;
     vec3 sunColor;
-    float padding1;
+    float baseHeight;
     vec3 ambientColor;
     float ambientIntensity;
     vec3 skyColorHorizon;
-    float padding2;
+    float padding1;
     vec3 skyColorZenith;
-    float padding3;
+    float padding2;
     vec3 fogColor;
     float fogDensity;
     
@@ -35,63 +51,38 @@ layout(binding = 0) uniform TerrainUniformData {
     // Quality settings
     int qualityLevel;
     float viewDistance;
-    float padding4[2];
+    vec2 viewportSize;
+    
+    // TerrainHeightfield::getRegion(): xy region origin (world XZ), z texel size
+    vec4 heightfieldRegion;
+
+    // Reduced-resolution raymarch: x screen pixels per trace texel, y relative
+    // hit-distance jump that counts as an edge
+    vec4 traceParameters;
 } ubo;
 
-// Fast noise functions
-float hash21(vec2 p) {
-    return fract(sin(dot(p, vec2(12.9898, 78.233))) * 43758.5453);
-}
+// Assembled by TerrainHeightfield from streamed tiles; the height function itself is TerrainFunction
+// NoiseTexture, wrapping every NoiseTable::SIZE texels
+layout(set = 0, binding = 1) uniform sampler2D noiseTexture;
 
-float noise(vec2 p) {
-    vec2 i = floor(p);
-    vec2 f = fract(p);
-    f = f * f * (3.0 - 2.0 * f);
-    
-    float a = hash21(i);
-    float b = hash21(i + vec2(1.0, 0.0));
-    float c = hash21(i + vec2(0.0, 1.0));
-    float d = hash21(i + vec2(1.0, 1.0));
-    
-    return mix(mix(a, b, f.x), mix(c, d, f.x), f.y);
-}
+layout(set = 1, binding = 0) uniform sampler2D heightMap;
+layout(set = 1, binding = 1) uniform sampler2D maxHeightChain;
+layout(set = 1, binding = 2) uniform sampler2D normalMap;
 
-float fbm(vec2 p, int octaves) {
-    float value = 0.0;
-    float amplitude = 0.5;
-    for (int i = 0; i < octaves; i++) {
-        value += amplitude * noise(p);
-        p *= 2.0;
-        amplitude *= 0.5;
-    }
-    return value;
+// RAYMARCH_PASS 1's targets, read by RAYMARCH_PASS 2
+layout(set = 2, binding = 0) uniform sampler2D traceColor;
+layout(set = 2, binding = 1) uniform sampler2D traceDistance;
+
+// Value noise from NoiseTable's lattice, one texel per lattice point, hardware
+// filtered. footprint is the pixel's size in lattice units and picks the mip, so
+// distant ground gets the average instead of shimmering.
+float noise(vec2 p, float footprint) {
+    return textureLod(noiseTexture, p / vec2(textureSize(noiseTexture, 0)), log2(max(footprint, 1e-4))).r;
 }
 
-// Optimized terrain height
-float getTerrainHeight(vec2 p) {
-    p *= ubo.terrainScale;
-    float height = 0.0;
-    
-    // Base terrain layers
-    height += sin(p.x * 0.008) * 15.0 + cos(p.y * 0.01) * 12.0;
-    height += sin(p.x * 0.02 + p.y * 0.015) * 8.0;
-    height += cos(p.x * 0.025) * cos(p.y * 0.03) * 5.0;
-    
-    // Add detail based on quality
-    if (ubo.qualityLevel >= 1) {
-        height += fbm(p * 0.05, 2) * 4.0;
-    }
-    if (ubo.qualityLevel >= 2) {
-        height += fbm(p * 0.1, 1) * 2.0;
-    }
-    
-    // River valleys
-    float river1 = abs(sin(p.x * 0.005 + cos(p.y * 0.003) * 2.0));
-    float river2 = abs(sin(p.y * 0.004 + cos(p.x * 0.006) * 1.5));
-    height -= smoothstep(0.0, 0.3, 1.0 - river1) * 10.0;
-    height -= smoothstep(0.0, 0.2, 1.0 - river2) * 8.0;
-    
-    return height * ubo.terrainHeight * 0.01;
+// World-space width of a screen pixel at this distance from the camera
+float pixelFootprint(float distance) {
+    return distance * 2.0 / (abs(ubo.projMatrix[1][1]) * ubo.viewportSize.y);
 }
 
 // Water height with waves
@@ -103,17 +94,14 @@ float getWaterHeight(vec2 p) {
     return ubo.waterLevel + waves;
 }
 
-// Terrain normal
+// Terrain normal, baked alongside the heights
 vec3 getTerrainNormal(vec2 p) {
-    float eps = 0.1;
-    float h = getTerrainHeight(p);
-    float hx = getTerrainHeight(p + vec2(eps, 0.0));
-    float hy = getTerrainHeight(p + vec2(0.0, eps));
-    return normalize(vec3(h - hx, eps, h - hy));
+    vec2 uv = (p - ubo.heightfieldRegion.xy) / (ubo.heightfieldRegion.z * vec2(textureSize(normalMap, 0)));
+    return normalize(textureLod(normalMap, uv, 0.0).xyz);
 }
 
 // Enhanced terrain material
-vec3 getTerrainMaterial(vec2 worldPos, float height, vec3 normal) {
+vec3 getTerrainMaterial(vec2 worldPos, float height, vec3 normal, float footprint) {
     float slope = 1.0 - normal.y;
     
     // Base colors
@@ -130,41 +118,134 @@ vec3 getTerrainMaterial(vec2 worldPos, float height, vec3 normal) {
     color = mix(color, snow, smoothstep(15.0, 20.0, height));
     
     // Add texture variation
-    float variation = noise(worldPos * 20.0) * 0.3 + 0.7;
+    float variation = noise(worldPos * 20.0, footprint * 20.0) * 0.3 + 0.7;
     color *= variation;
     
     return color;
 }
 
-// Simple ray-terrain intersection
-bool intersectTerrain(vec3 ro, vec3 rd, out vec3 hitPoint, out bool isWater) {
-    if (rd.y >= -0.001) return false;
+// Smallest s in [0, sMax] where the ray drops to the bilinear patch of cell
+// `cell`. Along a ray the patch height is quadratic in s, so the crossing is a
+// root of a quadratic rather than something to search for.
+bool intersectCell(ivec2 cell, vec2 u0, vec2 du, float y0, float dy, float sMax, out float s) {
+    float h00 = texelFetch(heightMap, cell, 0).r;
+    float h10 = texelFetch(heightMap, cell + ivec2(1, 0), 0).r;
+    float h01 = texelFetch(heightMap, cell + ivec2(0, 1), 0).r;
+    float h11 = texelFetch(heightMap, cell + ivec2(1, 1), 0).r;
     
-    float t = 0.1;
-    isWater = false;
+    vec2 f = u0 - vec2(cell);
+    float k1 = h10 - h00;
+    float k2 = h01 - h00;
+    float k3 = h00 - h10 - h01 + h11;
+    // Ray height minus patch height: a*s^2 + b*s + c
+    float a = -k3 * du.x * du.y;
+    float b = dy - (k1 * du.x + k2 * du.y + k3 * (f.x * du.y + f.y * du.x));
+    float c = y0 - (h00 + k1 * f.x + k2 * f.y + k3 * f.x * f.y);
+    
+    if (c <= 0.0) {
+        s = 0.0;
+        return true;
+    }
+    if (abs(a) < 1e-7) {
+        s = -c / b;
+        return b < 0.0 && s <= sMax;
+    }
+    float disc = b * b - 4.0 * a * c;
+    if (disc < 0.0) {
+        return false;
+    }
+    float root = sqrt(disc);
+    float s0 = (-b - root) / (2.0 * a);
+    float s1 = (-b + root) / (2.0 * a);
+    s = min(s0, s1) >= 0.0 ? min(s0, s1) : max(s0, s1);
+    return s >= 0.0 && s <= sMax;
+}
+
+// Ray against the baked heightfield. The walk runs over the max-height chain in
+// texel units: a cell the ray stays above is skipped whole and the walk moves up
+// a level, a cell it dips into is split by moving down one, and at level 0 the
+// bilinear patch is intersected exactly.
+bool intersectHeightfield(vec3 ro, vec3 rd, float tMax, out float tHit) {
+    vec2 size = vec2(textureSize(heightMap, 0));
+    int topLevel = textureQueryLevels(maxHeightChain) - 1;
+    // Texel-center coordinates: u = i is the height stored in texel i
+    vec2 uo = (ro.xz - ubo.heightfieldRegion.xy) / ubo.heightfieldRegion.z - 0.5;
+    vec2 ud = rd.xz / ubo.heightfieldRegion.z;
+    vec2 invUd = 1.0 / max(abs(ud), vec2(1e-8)) * sign(ud + vec2(1e-12));
     
-    for (int i = 0; i < 32; i++) {
-        vec3 p = ro + rd * t;
-        float terrainH = getTerrainHeight(p.xz);
-        float waterH = (ubo.enableWater == 1) ? getWaterHeight(p.xz) : -1000.0;
+    // Clip to the cells that have all four corners
+    vec2 tA = (vec2(0.0) - uo) * invUd;
+    vec2 tB = (size - 1.0 - uo) * invUd;
+    vec2 tNear = min(tA, tB);
+    vec2 tFar = max(tA, tB);
+    float t = max(max(tNear.x, tNear.y), 0.0);
+    float tEnd = min(min(tFar.x, tFar.y), tMax);
+    
+    int level = topLevel;
+    for (int i = 0; i < 96 && t < tEnd; i++) {
+        vec2 u = uo + ud * t;
+        float cellSize = float(1 << level);
+        // Nudged along the ray so a point on a boundary belongs to the cell ahead
+        ivec2 cell = ivec2(floor(u / cellSize + sign(ud) * 1e-4));
+        cell = clamp(cell, ivec2(0), ivec2((size - 2.0) / cellSize));
         
-        // Check water first
-        if (ubo.enableWater == 1 && p.y <= waterH && p.y > terrainH) {
-            hitPoint = vec3(p.x, waterH, p.z);
-            isWater = true;
-            return true;
+        vec2 boundary = (vec2(cell) + step(0.0, ud)) * cellSize;
+        vec2 tBoundary = (boundary - uo) * invUd;
+        float tExit = min(min(tBoundary.x, tBoundary.y), tEnd);
+        
+        float hMax = texelFetch(maxHeightChain, cell, level).r;
+        float yEnter = ro.y + rd.y * t;
+        float yExit = ro.y + rd.y * tExit;
+        if (min(yEnter, yExit) > hMax) {
+            // Entirely above: skip the cell, and go coarser once the ray has left its parent too
+            t = tExit;
+            ivec2 next = ivec2(floor((uo + ud * t) / cellSize + sign(ud) * 1e-4));
+            if (any(notEqual(next >> 1, cell >> 1))) {
+                level = min(level + 1, topLevel);
+            }
+            continue;
+        }
+        if (yEnter > hMax) {
+            // Nothing can be hit before the ray gets down to the cell's maximum
+            t = (hMax - ro.y) / rd.y;
+        }
+        if (level > 0) {
+            level--;
+            continue;
         }
         
-        // Check terrain
-        if (p.y <= terrainH) {
-            hitPoint = vec3(p.x, terrainH, p.z);
+        float s;
+        if (intersectCell(cell, uo + ud * t, ud, ro.y + rd.y * t, rd.y, tExit - t, s)) {
+            tHit = t + s;
             return true;
         }
-        
-        t += max(0.1, abs(p.y - max(terrainH, waterH)) * 0.5);
-        if (t > ubo.viewDistance) break;
+        t = tExit;
     }
+    return false;
+}
+
+// Terrain from the baked heightfield, then the water plane in front of it
+bool intersectTerrain(vec3 ro, vec3 rd, out vec3 hitPoint, out bool isWater) {
+    isWater = false;
+    
+    float tTerrain = ubo.viewDistance;
+    bool terrainHit = ubo.heightfieldRegion.w > 0.0 && intersectHeightfield(ro, rd, ubo.viewDistance, tTerrain);
     
+    // The waves are a fraction of a unit, so the plane at the water level stands in for them
+    if (ubo.enableWater == 1 && rd.y < 0.0 && ro.y > ubo.waterLevel) {
+        float tWater = (ubo.waterLevel - ro.y) / rd.y;
+        if (tWater < tTerrain) {
+            vec3 p = ro + rd * tWater;
+            hitPoint = vec3(p.x, getWaterHeight(p.xz), p.z);
+            isWater = true;
+            return true;
+        }
+    }
+    
+    if (terrainHit) {
+        hitPoint = ro + rd * tTerrain;
+        return true;
+    }
     return false;
 }
 
@@ -175,69 +256,164 @@ vec3 applyFog(vec3 color, float distance, vec3 rayDir) {
     return mix(color, skyColor, fogAmount);
 }
 
-void main() {
-    // Screen coordinates
-    vec2 uv = fragCoord;
-    uv.y = -uv.y;
-    uv.x *= ubo.aspectRatio;
-    
-    // Camera ray
-    vec3 ro = ubo.cameraPos;
-    vec3 forward = normalize(ubo.cameraTarget - ro);
-    vec3 right = normalize(cross(forward, vec3(0.0, 1.0, 0.0)));
-    vec3 up = cross(right, forward);
-    vec3 rd = normalize(forward + uv.x * right + uv.y * up);
+// Camera ray through a point in screen pixels, from the same matrices the scene was rasterized with
+vec3 cameraRay(vec2 pixel) {
+    vec2 ndc = pixel / ubo.viewportSize * 2.0 - 1.0;
+    vec4 nearPoint = ubo.invViewProj * vec4(ndc, 0.0, 1.0);
+    vec4 farPoint = ubo.invViewProj * vec4(ndc, 1.0, 1.0);
+    return normalize(farPoint.xyz / farPoint.w - nearPoint.xyz / nearPoint.w);
+}
+
+vec3 shadeSky(vec3 rd) {
+    float skyGradient = max(rd.y * 0.5 + 0.5, 0.0);
+    vec3 color = mix(ubo.skyColorHorizon, ubo.skyColorZenith, skyGradient);
     
-    vec3 color;
+    // Simple sun
+    float sunDot = max(dot(rd, normalize(ubo.sunDirection)), 0.0);
+    return color + ubo.sunColor * pow(sunDot, 128.0) * ubo.sunIntensity;
+}
+
+// Shaded, fogged terrain or water along the ray; false if the ray reaches the sky
+bool shadeTerrain(vec3 ro, vec3 rd, out vec3 color, out float distance) {
     vec3 hitPoint;
     bool isWater;
+    if (!intersectTerrain(ro, rd, hitPoint, isWater)) {
+        return false;
+    }
+    distance = length(hitPoint - ro);
     
-    if (intersectTerrain(ro, rd, hitPoint, isWater)) {
-        float distance = length(hitPoint - ro);
+    if (isWater) {
+        // Water rendering
+        vec3 waterColor = vec3(0.1, 0.3, 0.6);
+        vec3 normal = vec3(0.0, 1.0, 0.0); // Simplified for performance
         
-        if (isWater) {
-            // Water rendering
-            vec3 waterColor = vec3(0.1, 0.3, 0.6);
-            vec3 normal = vec3(0.0, 1.0, 0.0); // Simplified for performance
-            
-            // Simple reflection
-            float fresnel = pow(1.0 - max(dot(normal, -rd), 0.0), 2.0);
-            vec3 skyColor = mix(ubo.skyColorHorizon, ubo.skyColorZenith, 0.5);
-            waterColor = mix(waterColor, skyColor * 0.8, fresnel);
-            
-            // Lighting
-            float diff = max(dot(normal, normalize(ubo.sunDirection)), 0.0);
-            color = waterColor * (ubo.sunColor * ubo.sunIntensity * diff * 0.3 + ubo.ambientColor * ubo.ambientIntensity);
-            
-        } else {
-            // Terrain rendering
-            vec3 normal = getTerrainNormal(hitPoint.xz);
-            vec3 material = getTerrainMaterial(hitPoint.xz, hitPoint.y, normal);
-            
-            // Enhanced lighting
-            float diff = max(dot(normal, normalize(ubo.sunDirection)), 0.0);
-            vec3 diffuse = material * ubo.sunColor * ubo.sunIntensity * diff;
-            vec3 ambient = material * ubo.ambientColor * ubo.ambientIntensity;
-            
-            color = diffuse + ambient;
-        }
+        // Simple reflection
+        float fresnel = pow(1.0 - max(dot(normal, -rd), 0.0), 2.0);
+        vec3 skyColor = mix(ubo.skyColorHorizon, ubo.skyColorZenith, 0.5);
+        waterColor = mix(waterColor, skyColor * 0.8, fresnel);
         
-        // Apply atmospheric fog
-        color = applyFog(color, distance, rd);
+        // Lighting
+        float diff = max(dot(normal, normalize(ubo.sunDirection)), 0.0);
+        color = waterColor * (ubo.sunColor * ubo.sunIntensity * diff * 0.3 + ubo.ambientColor * ubo.ambientIntensity);
         
     } else {
-        // Sky rendering
-        float skyGradient = max(rd.y * 0.5 + 0.5, 0.0);
-        color = mix(ubo.skyColorHorizon, ubo.skyColorZenith, skyGradient);
+        // Terrain rendering
+        vec3 normal = getTerrainNormal(hitPoint.xz);
+        // A trace texel stands for a block of screen pixels
+        float footprint = pixelFootprint(distance) * (RAYMARCH_PASS == 1 ? ubo.traceParameters.x : 1.0);
+        vec3 material = getTerrainMaterial(hitPoint.xz, hitPoint.y, normal, footprint);
+        
+        // Enhanced lighting
+        float diff = max(dot(normal, normalize(ubo.sunDirection)), 0.0);
+        vec3 diffuse = material * ubo.sunColor * ubo.sunIntensity * diff;
+        vec3 ambient = material * ubo.ambientColor * ubo.ambientIntensity;
         
-        // Simple sun
-        float sunDot = max(dot(rd, normalize(ubo.sunDirection)), 0.0);
-        color += ubo.sunColor * pow(sunDot, 128.0) * ubo.sunIntensity;
+        color = diffuse + ambient;
     }
     
-    // Tone mapping and gamma correction
-    color = color / (color + vec3(1.0)); // Simple Reinhard
-    color = pow(color, vec3(1.0/2.2));   // Gamma correction
+    // Apply atmospheric fog
+    color = applyFog(color, distance, rd);
+    return true;
+}
+
+// This pixel from the 2x2 trace texels around it. Where all four hit at similar
+// distances the result is their bilinear blend, reweighted towards the texels
+// at the nearest one's distance; where all four saw sky the sky is shaded here.
+// Returns false if the footprint straddles an edge and the pixel must be traced.
+bool upsampleTrace(vec3 rd, out vec3 color, out float distance, out bool hit) {
+    vec2 p = gl_FragCoord.xy / ubo.traceParameters.x - 0.5;
+    ivec2 origin = ivec2(floor(p));
+    vec2 f = p - vec2(origin);
+    ivec2 maxTexel = textureSize(traceDistance, 0) - 1;
     
+    vec3 colors[4];
+    float distances[4];
+    float weights[4] = float[4]((1.0 - f.x) * (1.0 - f.y), f.x * (1.0 - f.y), (1.0 - f.x) * f.y, f.x * f.y);
+    int misses = 0;
+    int nearest = 0;
+    for (int i = 0; i < 4; i++) {
+        ivec2 texel = clamp(origin + ivec2(i & 1, i >> 1), ivec2(0), maxTexel);
+        colors[i] = texelFetch(traceColor, texel, 0).rgb;
+        distances[i] = texelFetch(traceDistance, texel, 0).r;
+        misses += distances[i] <= 0.0 ? 1 : 0;
+        nearest = weights[i] > weights[nearest] ? i : nearest;
+    }
+    
+    if (misses == 4) {
+        color = shadeSky(rd);
+        hit = false;
+        return true;
+    }
+    if (misses > 0) {
+        return false;
+    }
+    
+    float threshold = ubo.traceParameters.y;
+    float minDistance = min(min(distances[0], distances[1]), min(distances[2], distances[3]));
+    float maxDistance = max(max(distances[0], distances[1]), max(distances[2], distances[3]));
+    if (maxDistance > minDistance * (1.0 + threshold)) {
+        return false;
+    }
+    
+    // Range weight against the nearest texel, so a slope within the threshold
+    // still leans towards the surface this pixel is most likely on
+    float reference = distances[nearest];
+    float total = 0.0;
+    color = vec3(0.0);
+    distance = 0.0;
+    for (int i = 0; i < 4; i++) {
+        float w = weights[i] / (1.0 + abs(distances[i] - reference) / (reference * threshold));
+        color += colors[i] * w;
+        distance += distances[i] * w;
+        total += w;
+    }
+    color /= total;
+    distance /= total;
+    hit = true;
+    return true;
+}
+
+void main() {
+    // Heights are baked relative to the terrain's zero level, so trace in that frame
+    vec3 base = vec3(0.0, ubo.baseHeight, 0.0);
+    vec3 ro = ubo.cameraPos - base;
+    
+    vec3 color;
+    float distance = 0.0;
+    
+    if (RAYMARCH_PASS == 1) {
+        // Trace texel centers land on screen positions; the targets carry no depth
+        vec3 rd = cameraRay(gl_FragCoord.xy * ubo.traceParameters.x);
+        if (!shadeTerrain(ro, rd, color, distance)) {
+            color = shadeSky(rd);
+            distance = 0.0;
+        }
+        outColor = vec4(color, 1.0);
+        outDistance = distance;
+        return;
+    }
+    
+    vec3 rd = cameraRay(gl_FragCoord.xy);
+    bool hit = false;
+    bool resolved = false;
+    if (RAYMARCH_PASS == 2) {
+        resolved = upsampleTrace(rd, color, distance, hit);
+    }
+    if (!resolved) {
+        hit = TRACE_TERRAIN && shadeTerrain(ro, rd, color, distance);
+        if (!hit) {
+            color = shadeSky(rd);
+        }
+    }
+    
+    float depth = 1.0;
+    if (hit) {
+        // An upsampled distance is applied along this pixel's own ray, so depth stays continuous
+        vec4 clip = ubo.projMatrix * ubo.viewMatrix * vec4(ro + rd * distance + base, 1.0);
+        depth = clamp(clip.z / clip.w, 0.0, 1.0);
+    }
+    
+    // Linear HDR; the post chain tonemaps and encodes for display
     outColor = vec4(color, 1.0);
-}
\ No newline at end of file
+    gl_FragDepth = depth;
+}
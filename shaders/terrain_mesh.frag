@@ -0,0 +1,129 @@
+#version 450
+
+// Shading of the CDLOD terrain mesh: the same material, lighting, water and fog
+// as terrain.frag's raymarched surface, so the two techniques look alike.
+
+layout(location = 0) in vec3 fragWorldPos; // Relative to the terrain's zero level
+
+layout(location = 0) out vec4 outColor;
+
+// RenderManager's TerrainUniformData
+layout(set = 0, binding = 0) uniform TerrainUniformData {
+    mat4 viewMatrix;
+    mat4 projMatrix;
+    mat4 invViewProj;
+
+    vec3 cameraPos;
+    float time;
+
+    // Scene lighting
+    vec3 sunDirection;
+    float sunIntensity;
+    vec3 sunColor;
+    float baseHeight;
+    vec3 ambientColor;
+    float ambientIntensity;
+    vec3 skyColorHorizon;
+    float padding1;
+    vec3 skyColorZenith;
+    float padding2;
+    vec3 fogColor;
+    float fogDensity;
+
+    // Terrain settings
+    float terrainScale;
+    float terrainHeight;
+    float waterLevel;
+    int enableWater;
+
+    // Quality settings
+    int qualityLevel;
+    float viewDistance;
+    vec2 viewportSize;
+
+    // TerrainHeightfield::getRegion(): xy region origin (world XZ), z texel size
+    vec4 heightfieldRegion;
+
+    // Reduced-resolution raymarch: x screen pixels per trace texel, y relative
+    // hit-distance jump that counts as an edge
+    vec4 traceParameters;
+} ubo;
+
+// NoiseTexture, wrapping every NoiseTable::SIZE texels
+layout(set = 0, binding = 1) uniform sampler2D noiseTexture;
+
+layout(set = 1, binding = 2) uniform sampler2D normalMap;
+
+// Value noise from NoiseTable's lattice, one texel per lattice point, hardware
+// filtered. footprint is the pixel's size in lattice units and picks the mip, so
+// distant ground gets the average instead of shimmering.
+float noise(vec2 p, float footprint) {
+    return textureLod(noiseTexture, p / vec2(textureSize(noiseTexture, 0)), log2(max(footprint, 1e-4))).r;
+}
+
+// World-space width of a screen pixel at this distance from the camera
+float pixelFootprint(float distance) {
+    return distance * 2.0 / (abs(ubo.projMatrix[1][1]) * ubo.viewportSize.y);
+}
+
+vec3 getTerrainNormal(vec2 p) {
+    vec2 uv = (p - ubo.heightfieldRegion.xy) / (ubo.heightfieldRegion.z * vec2(textureSize(normalMap, 0)));
+    return normalize(textureLod(normalMap, uv, 0.0).xyz);
+}
+
+vec3 getTerrainMaterial(vec2 worldPos, float height, vec3 normal, float footprint) {
+    float slope = 1.0 - normal.y;
+
+    vec3 grass = vec3(0.3, 0.6, 0.2);
+    vec3 dirt = vec3(0.5, 0.35, 0.25);
+    vec3 rock = vec3(0.4, 0.4, 0.4);
+    vec3 snow = vec3(0.9, 0.9, 0.95);
+
+    vec3 color = grass;
+    color = mix(color, dirt, smoothstep(-2.0, 5.0, height));
+    color = mix(color, rock, smoothstep(0.4, 0.8, slope));
+    color = mix(color, snow, smoothstep(15.0, 20.0, height));
+
+    float variation = noise(worldPos * 20.0, footprint * 20.0) * 0.3 + 0.7;
+    return color * variation;
+}
+
+vec3 applyFog(vec3 color, float distance, vec3 rayDir) {
+    float fogAmount = 1.0 - exp(-distance * ubo.fogDensity);
+    vec3 skyColor = mix(ubo.skyColorHorizon, ubo.skyColorZenith, max(rayDir.y * 0.5 + 0.5, 0.0));
+    return mix(color, skyColor, fogAmount);
+}
+
+void main() {
+    vec3 cameraPos = ubo.cameraPos - vec3(0.0, ubo.baseHeight, 0.0);
+    vec3 toSurface = fragWorldPos - cameraPos;
+    vec3 rd = normalize(toSurface);
+    float distance = length(toSurface);
+    vec3 color;
+
+    // The mesh is the ground only; submerged parts are shaded as the water surface above them
+    if (ubo.enableWater == 1 && fragWorldPos.y < ubo.waterLevel && cameraPos.y > ubo.waterLevel) {
+        vec3 waterColor = vec3(0.1, 0.3, 0.6);
+        vec3 normal = vec3(0.0, 1.0, 0.0);
+
+        float fresnel = pow(1.0 - max(dot(normal, -rd), 0.0), 2.0);
+        vec3 skyColor = mix(ubo.skyColorHorizon, ubo.skyColorZenith, 0.5);
+        waterColor = mix(waterColor, skyColor * 0.8, fresnel);
+
+        float diff = max(dot(normal, normalize(ubo.sunDirection)), 0.0);
+        color = waterColor * (ubo.sunColor * ubo.sunIntensity * diff * 0.3 + ubo.ambientColor * ubo.ambientIntensity);
+        // Fog over the distance to the water surface, not the ground below it
+        distance *= (cameraPos.y - ubo.waterLevel) / max(cameraPos.y - fragWorldPos.y, 1e-4);
+    } else {
+        vec3 normal = getTerrainNormal(fragWorldPos.xz);
+        vec3 material = getTerrainMaterial(fragWorldPos.xz, fragWorldPos.y, normal, pixelFootprint(distance));
+
+        float diff = max(dot(normal, normalize(ubo.sunDirection)), 0.0);
+        vec3 diffuse = material * ubo.sunColor * ubo.sunIntensity * diff;
+        vec3 ambient = material * ubo.ambientColor * ubo.ambientIntensity;
+        color = diffuse + ambient;
+    }
+
+    // Linear HDR; the post chain tonemaps and encodes for display
+    outColor = vec4(applyFog(color, distance, rd), 1.0);
+}
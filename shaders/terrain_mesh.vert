@@ -0,0 +1,83 @@
+#version 450
+
+// One CDLOD patch instance (see RenderManager): a regular grid laid over the
+// node's square and displaced by the baked height map. Towards the far end of
+// its level's range each odd vertex slides onto its even neighbour, so by the
+// time a node meets the next coarser level its edges match that level's grid.
+
+layout(location = 0) in vec2 inGrid;     // 0..PATCH_RESOLUTION
+layout(location = 1) in vec4 inNode;     // xy min corner (world XZ), z size, w level
+layout(location = 2) in vec4 inMorph;    // x morph start, y morph end distance
+
+// RenderManager's TerrainUniformData
+layout(set = 0, binding = 0) uniform TerrainUniformData {
+    mat4 viewMatrix;
+    mat4 projMatrix;
+    mat4 invViewProj;
+
+    vec3 cameraPos;
+    float time;
+
+    // Scene lighting
+    vec3 sunDirection;
+    float sunIntensity;
+    vec3 sunColor;
+    float baseHeight;
+    vec3 ambientColor;
+    float ambientIntensity;
+    vec3 skyColorHorizon;
+    float padding1;
+    vec3 skyColorZenith;
+    float padding2;
+    vec3 fogColor;
+    float fogDensity;
+
+    // Terrain settings
+    float terrainScale;
+    float terrainHeight;
+    float waterLevel;
+    int enableWater;
+
+    // Quality settings
+    int qualityLevel;
+    float viewDistance;
+    vec2 viewportSize;
+
+    // TerrainHeightfield::getRegion(): xy region origin (world XZ), z texel size
+    vec4 heightfieldRegion;
+
+    // Reduced-resolution raymarch: x screen pixels per trace texel, y relative
+    // hit-distance jump that counts as an edge
+    vec4 traceParameters;
+} ubo;
+
+layout(set = 1, binding = 0) uniform sampler2D heightMap;
+
+layout(constant_id = 0) const float PATCH_RESOLUTION = 32.0;
+
+layout(location = 0) out vec3 fragWorldPos; // Relative to the terrain's zero level
+
+invariant gl_Position;
+
+float sampleHeight(vec2 p) {
+    vec2 uv = (p - ubo.heightfieldRegion.xy) / (ubo.heightfieldRegion.z * vec2(textureSize(heightMap, 0)));
+    return textureLod(heightMap, uv, 0.0).r;
+}
+
+void main() {
+    float spacing = inNode.z / PATCH_RESOLUTION;
+    vec2 p = inNode.xy + inGrid * spacing;
+
+    // Morph factor from the unmorphed vertex, which two nodes of a level sharing
+    // an edge agree on
+    vec3 worldPos = vec3(p.x, sampleHeight(p) + ubo.baseHeight, p.y);
+    float morphK = clamp((distance(ubo.cameraPos, worldPos) - inMorph.x) / (inMorph.y - inMorph.x), 0.0, 1.0);
+
+    // Odd grid lines move down onto the even one below, which is the coarser level's grid
+    vec2 grid = inGrid - fract(inGrid * 0.5) * 2.0 * morphK;
+    p = inNode.xy + grid * spacing;
+    float height = sampleHeight(p);
+
+    fragWorldPos = vec3(p.x, height, p.y);
+    gl_Position = ubo.projMatrix * ubo.viewMatrix * vec4(p.x, height + ubo.baseHeight, p.y, 1.0);
+}
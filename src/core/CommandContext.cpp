@@ -0,0 +1,125 @@
+#include "core/CommandContext.h"
+#include "core/TimelineSemaphore.h"
+#include <stdexcept>
+
+CommandContext::CommandContext(VulkanDevice* device, VulkanDevice::QueueType queueType)
+    : m_device(device) {
+    m_queue = m_device->getQueue(queueType);
+    m_queueFamily = m_device->getQueueFamily(queueType);
+    m_timeline = m_device->getTimeline(queueType);
+
+    VkCommandPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+    poolInfo.queueFamilyIndex = m_queueFamily;
+
+    if (vkCreateCommandPool(m_device->getDevice(), &poolInfo, nullptr, &m_commandPool) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create command context pool!");
+    }
+}
+
+CommandContext::~CommandContext() {
+    if (m_commandPool != VK_NULL_HANDLE) {
+        m_timeline->wait(m_lastSubmittedValue);
+        vkDestroyCommandPool(m_device->getDevice(), m_commandPool, nullptr);
+    }
+}
+
+void CommandContext::recycleCompleted() {
+    if (m_inFlight.empty()) {
+        return;
+    }
+
+    uint64_t completed = m_timeline->getCompletedValue();
+    auto it = m_inFlight.begin();
+    while (it != m_inFlight.end()) {
+        if (it->first <= completed) {
+            m_freeBuffers.push_back(it->second);
+            it = m_inFlight.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+VkCommandBuffer CommandContext::begin() {
+    recycleCompleted();
+
+    VkCommandBuffer commandBuffer;
+    if (!m_freeBuffers.empty()) {
+        commandBuffer = m_freeBuffers.back();
+        m_freeBuffers.pop_back();
+        vkResetCommandBuffer(commandBuffer, 0);
+    } else {
+        VkCommandBufferAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocInfo.commandPool = m_commandPool;
+        allocInfo.commandBufferCount = 1;
+
+        if (vkAllocateCommandBuffers(m_device->getDevice(), &allocInfo, &commandBuffer) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to allocate command context buffer!");
+        }
+    }
+
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+    if (vkBeginCommandBuffer(commandBuffer, &beginInfo) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to begin command context buffer!");
+    }
+    return commandBuffer;
+}
+
+uint64_t CommandContext::submit(VkCommandBuffer commandBuffer, const std::vector<TimelineWait>& waits) {
+    if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to end command context buffer!");
+    }
+
+    std::vector<VkSemaphore> waitSemaphores;
+    std::vector<uint64_t> waitValues;
+    std::vector<VkPipelineStageFlags> waitStages;
+    for (const auto& wait : waits) {
+        // Same-queue dependencies are already ordered by submission
+        if (wait.timeline == m_timeline) {
+            continue;
+        }
+        waitSemaphores.push_back(wait.timeline->getSemaphore());
+        waitValues.push_back(wait.value);
+        waitStages.push_back(wait.stageMask);
+    }
+
+    uint64_t signalValue = m_timeline->nextValue();
+    VkSemaphore signalSemaphore = m_timeline->getSemaphore();
+
+    VkTimelineSemaphoreSubmitInfo timelineInfo{};
+    timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+    timelineInfo.waitSemaphoreValueCount = static_cast<uint32_t>(waitValues.size());
+    timelineInfo.pWaitSemaphoreValues = waitValues.data();
+    timelineInfo.signalSemaphoreValueCount = 1;
+    timelineInfo.pSignalSemaphoreValues = &signalValue;
+
+    VkSubmitInfo submitInfo{};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.pNext = &timelineInfo;
+    submitInfo.waitSemaphoreCount = static_cast<uint32_t>(waitSemaphores.size());
+    submitInfo.pWaitSemaphores = waitSemaphores.data();
+    submitInfo.pWaitDstStageMask = waitStages.data();
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &commandBuffer;
+    submitInfo.signalSemaphoreCount = 1;
+    submitInfo.pSignalSemaphores = &signalSemaphore;
+
+    if (vkQueueSubmit(m_queue, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to submit command context buffer!");
+    }
+
+    m_inFlight.emplace_back(signalValue, commandBuffer);
+    m_lastSubmittedValue = signalValue;
+    return signalValue;
+}
+
+void CommandContext::submitAndWait(VkCommandBuffer commandBuffer, const std::vector<TimelineWait>& waits) {
+    m_timeline->wait(submit(commandBuffer, waits));
+}
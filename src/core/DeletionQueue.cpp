@@ -0,0 +1,71 @@
+#include "core/DeletionQueue.h"
+#include "core/TimelineSemaphore.h"
+#include <algorithm>
+#include <unordered_map>
+
+DeletionQueue::DeletionQueue(TimelineSemaphore* timeline) : m_timeline(timeline) {
+}
+
+DeletionQueue::~DeletionQueue() {
+    flush();
+}
+
+void DeletionQueue::push(uint64_t timelineValue, std::function<void()> deleter) {
+    push(m_timeline, timelineValue, std::move(deleter));
+}
+
+void DeletionQueue::push(std::function<void()> deleter) {
+    push(currentValue(), std::move(deleter));
+}
+
+void DeletionQueue::push(TimelineSemaphore* timeline, uint64_t timelineValue, std::function<void()> deleter) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_entries.push_back({timeline, timelineValue, std::move(deleter)});
+}
+
+void DeletionQueue::collect() {
+    // Pull ready entries out first so deleters are free to push new ones
+    std::vector<Entry> ready;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        // Query each timeline once per collect
+        std::unordered_map<TimelineSemaphore*, uint64_t> completed;
+        auto isPending = [&completed](const Entry& entry) {
+            auto it = completed.find(entry.timeline);
+            if (it == completed.end()) {
+                it = completed.emplace(entry.timeline, entry.timeline->getCompletedValue()).first;
+            }
+            return entry.timelineValue > it->second;
+        };
+
+        auto split = std::stable_partition(m_entries.begin(), m_entries.end(), isPending);
+        ready.assign(std::make_move_iterator(split), std::make_move_iterator(m_entries.end()));
+        m_entries.erase(split, m_entries.end());
+    }
+
+    for (auto& entry : ready) {
+        entry.deleter();
+    }
+}
+
+void DeletionQueue::flush() {
+    std::vector<Entry> entries;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        entries.swap(m_entries);
+    }
+
+    for (auto& entry : entries) {
+        entry.deleter();
+    }
+}
+
+size_t DeletionQueue::getPendingCount() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_entries.size();
+}
+
+uint64_t DeletionQueue::currentValue() const {
+    return m_timeline->getLastSignaledValue();
+}
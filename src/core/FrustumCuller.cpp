@@ -61,6 +61,19 @@ bool Frustum::isVisible(const glm::vec3& point, float radius) const {
     return true; // Inside or intersecting frustum
 }
 
+bool Frustum::isBoxVisible(const glm::vec3& min, const glm::vec3& max) const {
+    for (const auto& plane : planes) {
+        // The corner farthest along the plane normal
+        glm::vec3 corner(plane.normal.x >= 0.0f ? max.x : min.x,
+                         plane.normal.y >= 0.0f ? max.y : min.y,
+                         plane.normal.z >= 0.0f ? max.z : min.z);
+        if (plane.distanceToPoint(corner) < 0.0f) {
+            return false;
+        }
+    }
+    return true;
+}
+
 void FrustumCuller::updateFrustum(const glm::mat4& viewMatrix, const glm::mat4& projMatrix) {
     glm::mat4 viewProj = projMatrix * viewMatrix;
     m_frustum.extractFromMatrix(viewProj);
@@ -70,6 +83,10 @@ bool FrustumCuller::isVisible(const glm::vec3& position, float radius) const {
     return m_frustum.isVisible(position, radius);
 }
 
+bool FrustumCuller::isBoxVisible(const glm::vec3& min, const glm::vec3& max) const {
+    return m_frustum.isBoxVisible(min, max);
+}
+
 float FrustumCuller::calculateLOD(const glm::vec3& position, const glm::vec3& cameraPos) const {
     return glm::length(position - cameraPos);
 }
@@ -0,0 +1,84 @@
+#include "core/LatencyTracker.h"
+
+namespace {
+    constexpr float SMOOTHING = 0.1f;
+    // Presents the display has fallen this far behind on are dropped unmeasured
+    constexpr size_t MAX_PENDING_PRESENTS = 8;
+}
+
+LatencyTracker::LatencyTracker(uint32_t frameSlots) {
+    reset(frameSlots);
+}
+
+void LatencyTracker::reset(uint32_t frameSlots) {
+    m_frames.assign(frameSlots, FrameRecord{});
+    m_presents.clear();
+    m_lastInputSample = Clock::now();
+}
+
+void LatencyTracker::markInputSampled() {
+    m_lastInputSample = Clock::now();
+}
+
+void LatencyTracker::markSubmitted(uint32_t frameSlot) {
+    if (frameSlot >= m_frames.size()) return;
+
+    FrameRecord& frame = m_frames[frameSlot];
+    frame.inputSampled = m_lastInputSample;
+    frame.submitted = Clock::now();
+    frame.pending = true;
+
+    accumulate(m_inputToSubmit, std::chrono::duration<float>(frame.submitted - frame.inputSampled).count());
+}
+
+void LatencyTracker::markCompleted(uint32_t frameSlot) {
+    if (!isPending(frameSlot)) return;
+
+    FrameRecord& frame = m_frames[frameSlot];
+    auto completed = Clock::now();
+    frame.pending = false;
+
+    accumulate(m_submitToGpuComplete, std::chrono::duration<float>(completed - frame.submitted).count());
+    accumulate(m_inputToGpuComplete, std::chrono::duration<float>(completed - frame.inputSampled).count());
+}
+
+bool LatencyTracker::isPending(uint32_t frameSlot) const {
+    return frameSlot < m_frames.size() && m_frames[frameSlot].pending;
+}
+
+void LatencyTracker::markPresentQueued(uint32_t frameSlot, uint64_t presentId) {
+    if (frameSlot >= m_frames.size()) return;
+
+    const FrameRecord& frame = m_frames[frameSlot];
+    m_presents.push_back({presentId, frame.inputSampled, frame.submitted});
+    if (m_presents.size() > MAX_PENDING_PRESENTS) {
+        m_presents.pop_front();
+    }
+}
+
+bool LatencyTracker::getOldestPendingPresent(uint64_t& presentId) const {
+    if (m_presents.empty()) return false;
+
+    presentId = m_presents.front().presentId;
+    return true;
+}
+
+void LatencyTracker::markOldestPresented() {
+    if (m_presents.empty()) return;
+
+    const PendingPresent& present = m_presents.front();
+    auto presented = Clock::now();
+    accumulate(m_submitToPresent, std::chrono::duration<float>(presented - present.submitted).count());
+    accumulate(m_inputToPresent, std::chrono::duration<float>(presented - present.inputSampled).count());
+    m_presentMeasured = true;
+    m_presents.pop_front();
+}
+
+void LatencyTracker::dropPendingPresents() {
+    m_presents.clear();
+}
+
+void LatencyTracker::accumulate(float& average, float sample) {
+    // Seed with the first sample so the readout doesn't ramp up from zero
+    average = (average == 0.0f) ? sample : average + (sample - average) * SMOOTHING;
+}
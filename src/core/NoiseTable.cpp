@@ -0,0 +1,51 @@
+#include "core/NoiseTable.h"
+
+namespace {
+static_assert((NoiseTable::SIZE & (NoiseTable::SIZE - 1)) == 0, "Lattice wrapping relies on a power of two");
+
+// Integer avalanche hash; no floating point, so the table is identical everywhere
+uint32_t hashLattice(uint32_t index) {
+    uint32_t h = index;
+    h ^= h >> 16;
+    h *= 0x7feb352du;
+    h ^= h >> 15;
+    h *= 0x846ca68bu;
+    h ^= h >> 16;
+    return h;
+}
+
+std::vector<uint8_t> buildTexels() {
+    std::vector<uint8_t> texels(NoiseTable::SIZE * NoiseTable::SIZE);
+    for (uint32_t i = 0; i < texels.size(); i++) {
+        // Offset so index 0 does not hash to 0
+        texels[i] = static_cast<uint8_t>(hashLattice(i + 0x9e3779b9u) >> 24);
+    }
+    return texels;
+}
+}
+
+const std::vector<uint8_t>& NoiseTable::texels() {
+    static const std::vector<uint8_t> table = buildTexels();
+    return table;
+}
+
+float NoiseTable::lattice(int32_t x, int32_t y) {
+    uint32_t mask = SIZE - 1;
+    uint32_t index = (static_cast<uint32_t>(y) & mask) * SIZE + (static_cast<uint32_t>(x) & mask);
+    return static_cast<float>(texels()[index]) * (1.0f / 255.0f);
+}
+
+float NoiseTable::value(const glm::vec2& p) {
+    // Texel centers are the lattice points
+    glm::vec2 q = p - 0.5f;
+    glm::vec2 i = glm::floor(q);
+    glm::vec2 f = q - i;
+    int32_t x = static_cast<int32_t>(i.x);
+    int32_t y = static_cast<int32_t>(i.y);
+
+    float a = lattice(x, y);
+    float b = lattice(x + 1, y);
+    float c = lattice(x, y + 1);
+    float d = lattice(x + 1, y + 1);
+    return glm::mix(glm::mix(a, b, f.x), glm::mix(c, d, f.x), f.y);
+}
@@ -0,0 +1,192 @@
+#include "core/Profiler.h"
+#include <iostream>
+#include <stdexcept>
+
+// Query 0/1 bracket the whole frame, scope i uses queries 2+2i and 3+2i
+namespace {
+constexpr uint32_t FRAME_QUERIES = 2;
+}
+
+Profiler::Profiler(VulkanDevice* device, uint32_t framesInFlight, uint32_t maxScopes)
+    : m_device(device), m_maxScopes(maxScopes), m_queryCount(FRAME_QUERIES + maxScopes * 2) {
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(m_device->getPhysicalDevice(), &properties);
+
+    uint32_t familyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(m_device->getPhysicalDevice(), &familyCount, nullptr);
+    std::vector<VkQueueFamilyProperties> families(familyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(m_device->getPhysicalDevice(), &familyCount, families.data());
+
+    uint32_t validBits = families[m_device->getQueueFamily(VulkanDevice::QueueType::Graphics)].timestampValidBits;
+    m_supported = validBits > 0 && properties.limits.timestampPeriod > 0.0f;
+    m_statisticsSupported = m_device->supportsPipelineStatistics();
+    if (!m_supported) {
+        std::cout << "Profiler: Timestamps not supported on the graphics queue, GPU timings disabled" << std::endl;
+    }
+    if (!m_supported && !m_statisticsSupported) {
+        return;
+    }
+
+    m_timestampPeriod = properties.limits.timestampPeriod;
+    m_timestampMask = validBits >= 64 ? ~0ull : ((1ull << validBits) - 1);
+
+    m_slots.resize(framesInFlight);
+    for (auto& slot : m_slots) {
+        if (m_supported) {
+            VkQueryPoolCreateInfo poolInfo{};
+            poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+            poolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+            poolInfo.queryCount = m_queryCount;
+
+            if (vkCreateQueryPool(m_device->getDevice(), &poolInfo, nullptr, &slot.queryPool) != VK_SUCCESS) {
+                throw std::runtime_error("Failed to create timestamp query pool!");
+            }
+        }
+        if (m_statisticsSupported) {
+            VkQueryPoolCreateInfo poolInfo{};
+            poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+            poolInfo.queryType = VK_QUERY_TYPE_PIPELINE_STATISTICS;
+            poolInfo.queryCount = 1;
+            poolInfo.pipelineStatistics = VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT;
+
+            if (vkCreateQueryPool(m_device->getDevice(), &poolInfo, nullptr, &slot.statisticsPool) != VK_SUCCESS) {
+                throw std::runtime_error("Failed to create pipeline statistics query pool!");
+            }
+        }
+    }
+}
+
+Profiler::~Profiler() {
+    for (auto& slot : m_slots) {
+        if (slot.queryPool != VK_NULL_HANDLE) {
+            vkDestroyQueryPool(m_device->getDevice(), slot.queryPool, nullptr);
+        }
+        if (slot.statisticsPool != VK_NULL_HANDLE) {
+            vkDestroyQueryPool(m_device->getDevice(), slot.statisticsPool, nullptr);
+        }
+    }
+}
+
+void Profiler::beginFrame(VkCommandBuffer commandBuffer, uint32_t frameIndex) {
+    m_cpuTimings.swap(m_pendingCpuTimings);
+    m_pendingCpuTimings.clear();
+
+    if (m_slots.empty()) {
+        return;
+    }
+
+    FrameSlot& slot = m_slots[frameIndex % m_slots.size()];
+    if (slot.recorded) {
+        readResults(slot);
+    }
+
+    slot.scopeNames.clear();
+    slot.recorded = true;
+    slot.statisticsRecorded = false;
+    m_currentSlot = &slot;
+
+    // Resets must be recorded outside a render pass, so both pools are reset here
+    if (slot.statisticsPool != VK_NULL_HANDLE) {
+        vkCmdResetQueryPool(commandBuffer, slot.statisticsPool, 0, 1);
+    }
+    if (m_supported) {
+        vkCmdResetQueryPool(commandBuffer, slot.queryPool, 0, m_queryCount);
+        vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, slot.queryPool, 0);
+    }
+}
+
+void Profiler::addCpuTiming(const std::string& name, double cpuMs) {
+    m_pendingCpuTimings.push_back({name, cpuMs});
+}
+
+void Profiler::endFrame(VkCommandBuffer commandBuffer) {
+    if (!m_currentSlot) {
+        return;
+    }
+
+    if (m_supported) {
+        vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_currentSlot->queryPool, 1);
+    }
+    m_currentSlot = nullptr;
+}
+
+void Profiler::beginStatistics(VkCommandBuffer commandBuffer, uint32_t tag) {
+    if (!m_currentSlot || !m_statisticsSupported || m_currentSlot->statisticsRecorded) {
+        return;
+    }
+
+    vkCmdBeginQuery(commandBuffer, m_currentSlot->statisticsPool, 0, 0);
+    m_currentSlot->statisticsRecorded = true;
+    m_currentSlot->statisticsTag = tag;
+    m_statisticsActive = true;
+}
+
+void Profiler::endStatistics(VkCommandBuffer commandBuffer) {
+    if (!m_currentSlot || !m_statisticsActive) {
+        return;
+    }
+
+    vkCmdEndQuery(commandBuffer, m_currentSlot->statisticsPool, 0);
+    m_statisticsActive = false;
+}
+
+uint32_t Profiler::beginScope(VkCommandBuffer commandBuffer, const std::string& name) {
+    if (!m_currentSlot || !m_supported || m_currentSlot->scopeNames.size() >= m_maxScopes) {
+        return UINT32_MAX;
+    }
+
+    uint32_t scope = static_cast<uint32_t>(m_currentSlot->scopeNames.size());
+    m_currentSlot->scopeNames.push_back(name);
+    vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, m_currentSlot->queryPool,
+                        FRAME_QUERIES + scope * 2);
+    return scope;
+}
+
+void Profiler::endScope(VkCommandBuffer commandBuffer, uint32_t scope) {
+    if (!m_currentSlot || scope == UINT32_MAX) {
+        return;
+    }
+
+    vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_currentSlot->queryPool,
+                        FRAME_QUERIES + scope * 2 + 1);
+}
+
+void Profiler::readResults(FrameSlot& slot) {
+    // Frames that skipped the statistics section (e.g. no model loaded) report nothing
+    m_statisticsValid = false;
+    if (slot.statisticsRecorded) {
+        uint64_t invocations = 0;
+        if (vkGetQueryPoolResults(m_device->getDevice(), slot.statisticsPool, 0, 1, sizeof(invocations), &invocations,
+                                  sizeof(uint64_t), VK_QUERY_RESULT_64_BIT) == VK_SUCCESS) {
+            m_fragmentInvocations = invocations;
+            m_statisticsTag = slot.statisticsTag;
+            m_statisticsValid = true;
+        }
+    }
+
+    if (!m_supported) {
+        return;
+    }
+
+    uint32_t usedQueries = FRAME_QUERIES + static_cast<uint32_t>(slot.scopeNames.size()) * 2;
+    std::vector<uint64_t> results(usedQueries);
+
+    // The slot's submission has completed, so this does not wait
+    VkResult result = vkGetQueryPoolResults(m_device->getDevice(), slot.queryPool, 0, usedQueries,
+                                            results.size() * sizeof(uint64_t), results.data(), sizeof(uint64_t),
+                                            VK_QUERY_RESULT_64_BIT);
+    if (result != VK_SUCCESS) {
+        return;
+    }
+
+    auto toMs = [this](uint64_t begin, uint64_t end) {
+        uint64_t ticks = ((end & m_timestampMask) - (begin & m_timestampMask)) & m_timestampMask;
+        return static_cast<double>(ticks) * m_timestampPeriod / 1.0e6;
+    };
+
+    m_frameGpuMs = toMs(results[0], results[1]);
+    m_timings.clear();
+    for (size_t i = 0; i < slot.scopeNames.size(); i++) {
+        m_timings.push_back({slot.scopeNames[i], toMs(results[FRAME_QUERIES + i * 2], results[FRAME_QUERIES + i * 2 + 1])});
+    }
+}
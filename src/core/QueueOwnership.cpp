@@ -0,0 +1,107 @@
+#include "core/QueueOwnership.h"
+
+namespace {
+
+VkBufferMemoryBarrier makeBufferBarrier(VkBuffer buffer, uint32_t srcFamily, uint32_t dstFamily) {
+    VkBufferMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    barrier.buffer = buffer;
+    barrier.offset = 0;
+    barrier.size = VK_WHOLE_SIZE;
+    if (srcFamily == dstFamily) {
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    } else {
+        barrier.srcQueueFamilyIndex = srcFamily;
+        barrier.dstQueueFamilyIndex = dstFamily;
+    }
+    return barrier;
+}
+
+VkImageMemoryBarrier makeImageBarrier(VkImage image, uint32_t mipLevels, uint32_t layers, VkImageLayout oldLayout,
+                                      VkImageLayout newLayout, uint32_t srcFamily, uint32_t dstFamily) {
+    VkImageMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.image = image;
+    barrier.oldLayout = oldLayout;
+    barrier.newLayout = newLayout;
+    barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    barrier.subresourceRange.baseMipLevel = 0;
+    barrier.subresourceRange.levelCount = mipLevels;
+    barrier.subresourceRange.baseArrayLayer = 0;
+    barrier.subresourceRange.layerCount = layers;
+    if (srcFamily == dstFamily) {
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    } else {
+        barrier.srcQueueFamilyIndex = srcFamily;
+        barrier.dstQueueFamilyIndex = dstFamily;
+    }
+    return barrier;
+}
+
+} // namespace
+
+void QueueOwnership::releaseBuffer(VkCommandBuffer commandBuffer, VkBuffer buffer,
+                                   uint32_t srcFamily, uint32_t dstFamily,
+                                   VkAccessFlags srcAccess, VkPipelineStageFlags srcStage) {
+    if (srcFamily == dstFamily) {
+        return;
+    }
+
+    // dstAccessMask is ignored for a release
+    VkBufferMemoryBarrier barrier = makeBufferBarrier(buffer, srcFamily, dstFamily);
+    barrier.srcAccessMask = srcAccess;
+    barrier.dstAccessMask = 0;
+
+    vkCmdPipelineBarrier(commandBuffer, srcStage, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+                         0, 0, nullptr, 1, &barrier, 0, nullptr);
+}
+
+void QueueOwnership::acquireBuffer(VkCommandBuffer commandBuffer, VkBuffer buffer,
+                                   uint32_t srcFamily, uint32_t dstFamily,
+                                   VkAccessFlags dstAccess, VkPipelineStageFlags dstStage) {
+    VkBufferMemoryBarrier barrier = makeBufferBarrier(buffer, srcFamily, dstFamily);
+    VkPipelineStageFlags srcStage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+    if (srcFamily == dstFamily) {
+        // Same queue: a regular barrier after the copy
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        srcStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+    }
+    barrier.dstAccessMask = dstAccess;
+
+    vkCmdPipelineBarrier(commandBuffer, srcStage, dstStage, 0, 0, nullptr, 1, &barrier, 0, nullptr);
+}
+
+void QueueOwnership::releaseImage(VkCommandBuffer commandBuffer, VkImage image, uint32_t mipLevels,
+                                  VkImageLayout oldLayout, VkImageLayout newLayout,
+                                  uint32_t srcFamily, uint32_t dstFamily,
+                                  VkAccessFlags srcAccess, VkPipelineStageFlags srcStage, uint32_t layers) {
+    if (srcFamily == dstFamily) {
+        return;
+    }
+
+    VkImageMemoryBarrier barrier = makeImageBarrier(image, mipLevels, layers, oldLayout, newLayout,
+                                                    srcFamily, dstFamily);
+    barrier.srcAccessMask = srcAccess;
+    barrier.dstAccessMask = 0;
+
+    vkCmdPipelineBarrier(commandBuffer, srcStage, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+                         0, 0, nullptr, 0, nullptr, 1, &barrier);
+}
+
+void QueueOwnership::acquireImage(VkCommandBuffer commandBuffer, VkImage image, uint32_t mipLevels,
+                                  VkImageLayout oldLayout, VkImageLayout newLayout,
+                                  uint32_t srcFamily, uint32_t dstFamily,
+                                  VkAccessFlags dstAccess, VkPipelineStageFlags dstStage, uint32_t layers) {
+    VkImageMemoryBarrier barrier = makeImageBarrier(image, mipLevels, layers, oldLayout, newLayout,
+                                                    srcFamily, dstFamily);
+    VkPipelineStageFlags srcStage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+    if (srcFamily == dstFamily) {
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        srcStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
+    }
+    barrier.dstAccessMask = dstAccess;
+
+    vkCmdPipelineBarrier(commandBuffer, srcStage, dstStage, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+}
@@ -0,0 +1,112 @@
+#include "core/TerrainFunction.h"
+#include <cmath>
+#include <cstdint>
+
+// Lattice hash in [0, 1). A sine scaled by 43758 (as the shaders hash) amplifies
+// the last bit of any sine implementation into a different value, so the terrain
+// hashes the integer lattice point instead and every evaluation path agrees on it.
+float TerrainFunction::hash21(const glm::vec2& p) {
+    uint32_t h = static_cast<uint32_t>(static_cast<int32_t>(p.x)) * 0x8da6b343u ^
+                 static_cast<uint32_t>(static_cast<int32_t>(p.y)) * 0xd8163841u;
+    h ^= h >> 15;
+    h *= 0x2c1b3c6du;
+    h ^= h >> 12;
+    h *= 0x297a2d39u;
+    h ^= h >> 15;
+    return static_cast<float>(h >> 8) * (1.0f / 16777216.0f);
+}
+
+float TerrainFunction::noise(const glm::vec2& p) {
+    glm::vec2 i = glm::floor(p);
+    glm::vec2 f = p - i;
+    f = f * f * (3.0f - 2.0f * f);
+
+    float a = hash21(i);
+    float b = hash21(i + glm::vec2(1.0f, 0.0f));
+    float c = hash21(i + glm::vec2(0.0f, 1.0f));
+    float d = hash21(i + glm::vec2(1.0f, 1.0f));
+
+    return glm::mix(glm::mix(a, b, f.x), glm::mix(c, d, f.x), f.y);
+}
+
+float TerrainFunction::fbm(glm::vec2 p, int octaves) {
+    float value = 0.0f;
+    float amplitude = 0.5f;
+    for (int i = 0; i < octaves; i++) {
+        value += amplitude * noise(p);
+        p *= 2.0f;
+        amplitude *= 0.5f;
+    }
+    return value;
+}
+
+float TerrainFunction::height(const glm::vec2& position, const Parameters& parameters) {
+    glm::vec2 p = position * parameters.terrainScale;
+    float height = 0.0f;
+
+    // Base terrain layers
+    height += std::sin(p.x * 0.008f) * 15.0f + std::cos(p.y * 0.01f) * 12.0f;
+    height += std::sin(p.x * 0.02f + p.y * 0.015f) * 8.0f;
+    height += std::cos(p.x * 0.025f) * std::cos(p.y * 0.03f) * 5.0f;
+
+    // Add detail based on quality
+    if (parameters.qualityLevel >= 1) {
+        height += fbm(p * 0.05f, 2) * 4.0f;
+    }
+    if (parameters.qualityLevel >= 2) {
+        height += fbm(p * 0.1f, 1) * 2.0f;
+    }
+
+    // River valleys
+    float river1 = std::abs(std::sin(p.x * 0.005f + std::cos(p.y * 0.003f) * 2.0f));
+    float river2 = std::abs(std::sin(p.y * 0.004f + std::cos(p.x * 0.006f) * 1.5f));
+    height -= glm::smoothstep(0.0f, 0.3f, 1.0f - river1) * 10.0f;
+    height -= glm::smoothstep(0.0f, 0.2f, 1.0f - river2) * 8.0f;
+
+    return height * parameters.terrainHeight * 0.01f;
+}
+
+glm::vec3 TerrainFunction::normal(const glm::vec2& p, float eps, const Parameters& parameters) {
+    float dx = height(p + glm::vec2(eps, 0.0f), parameters) - height(p - glm::vec2(eps, 0.0f), parameters);
+    float dz = height(p + glm::vec2(0.0f, eps), parameters) - height(p - glm::vec2(0.0f, eps), parameters);
+    return glm::normalize(glm::vec3(-dx, 2.0f * eps, -dz));
+}
+
+namespace {
+#if defined(TERRAIN_SIMD_AVX2)
+bool cpuHasAvx2() {
+    static const bool supported = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+    return supported;
+}
+#endif
+}
+
+void TerrainFunction::heights(const float* x, const float* z, float* heights, size_t count,
+                              const Parameters& parameters) {
+#if defined(TERRAIN_SIMD_NEON)
+    heightsNeon(x, z, heights, count, parameters);
+#else
+#if defined(TERRAIN_SIMD_AVX2)
+    if (cpuHasAvx2()) {
+        heightsAvx2(x, z, heights, count, parameters);
+        return;
+    }
+#endif
+    for (size_t i = 0; i < count; i++) {
+        heights[i] = height(glm::vec2(x[i], z[i]), parameters);
+    }
+#endif
+}
+
+const char* TerrainFunction::batchKernel() {
+#if defined(TERRAIN_SIMD_NEON)
+    return "neon";
+#else
+#if defined(TERRAIN_SIMD_AVX2)
+    if (cpuHasAvx2()) {
+        return "avx2";
+    }
+#endif
+    return "scalar";
+#endif
+}
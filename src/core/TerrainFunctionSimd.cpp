@@ -0,0 +1,221 @@
+#include "core/TerrainFunction.h"
+
+// Batch kernels of TerrainFunction::heights(). This file alone is built with the
+// instruction set it targets (see CMakeLists.txt), and TerrainFunction only calls
+// into it once the CPU is known to support that, so the rest of the program runs
+// anywhere. Both kernels share one implementation over a Lanes register type.
+#if defined(TERRAIN_SIMD_AVX2) && defined(__AVX2__) && defined(__FMA__)
+#include <immintrin.h>
+#define TERRAIN_SIMD_KERNEL
+#elif defined(TERRAIN_SIMD_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define TERRAIN_SIMD_KERNEL
+#endif
+
+#if defined(TERRAIN_SIMD_KERNEL)
+#include <algorithm>
+
+namespace {
+#if defined(__AVX2__)
+struct Lanes {
+    static constexpr size_t WIDTH = 8;
+    __m256 v;
+};
+
+inline Lanes splat(float value) { return {_mm256_set1_ps(value)}; }
+inline Lanes load(const float* p) { return {_mm256_loadu_ps(p)}; }
+inline void store(float* p, Lanes a) { _mm256_storeu_ps(p, a.v); }
+inline Lanes operator+(Lanes a, Lanes b) { return {_mm256_add_ps(a.v, b.v)}; }
+inline Lanes operator-(Lanes a, Lanes b) { return {_mm256_sub_ps(a.v, b.v)}; }
+inline Lanes operator*(Lanes a, Lanes b) { return {_mm256_mul_ps(a.v, b.v)}; }
+// a * b + c, fused
+inline Lanes vmulAdd(Lanes a, Lanes b, Lanes c) { return {_mm256_fmadd_ps(a.v, b.v, c.v)}; }
+inline Lanes vfloor(Lanes a) { return {_mm256_floor_ps(a.v)}; }
+inline Lanes vround(Lanes a) { return {_mm256_round_ps(a.v, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC)}; }
+inline Lanes vabs(Lanes a) { return {_mm256_andnot_ps(_mm256_set1_ps(-0.0f), a.v)}; }
+inline Lanes vmin(Lanes a, Lanes b) { return {_mm256_min_ps(a.v, b.v)}; }
+inline Lanes vmax(Lanes a, Lanes b) { return {_mm256_max_ps(a.v, b.v)}; }
+// TerrainFunction::hash21() of whole-number lattice coordinates
+inline Lanes hash21(Lanes x, Lanes z) {
+    __m256i h = _mm256_xor_si256(_mm256_mullo_epi32(_mm256_cvtps_epi32(x.v), _mm256_set1_epi32(0x8da6b343)),
+                                 _mm256_mullo_epi32(_mm256_cvtps_epi32(z.v), _mm256_set1_epi32(0xd8163841)));
+    h = _mm256_xor_si256(h, _mm256_srli_epi32(h, 15));
+    h = _mm256_mullo_epi32(h, _mm256_set1_epi32(0x2c1b3c6d));
+    h = _mm256_xor_si256(h, _mm256_srli_epi32(h, 12));
+    h = _mm256_mullo_epi32(h, _mm256_set1_epi32(0x297a2d39));
+    h = _mm256_xor_si256(h, _mm256_srli_epi32(h, 15));
+    return {_mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_srli_epi32(h, 8)), _mm256_set1_ps(1.0f / 16777216.0f))};
+}
+// a negated in the lanes where the whole number k is odd
+inline Lanes flipIfOdd(Lanes a, Lanes k) {
+    __m256i sign = _mm256_slli_epi32(_mm256_cvtps_epi32(k.v), 31);
+    return {_mm256_xor_ps(a.v, _mm256_castsi256_ps(sign))};
+}
+#else
+struct Lanes {
+    static constexpr size_t WIDTH = 4;
+    float32x4_t v;
+};
+
+inline Lanes splat(float value) { return {vdupq_n_f32(value)}; }
+inline Lanes load(const float* p) { return {vld1q_f32(p)}; }
+inline void store(float* p, Lanes a) { vst1q_f32(p, a.v); }
+inline Lanes operator+(Lanes a, Lanes b) { return {vaddq_f32(a.v, b.v)}; }
+inline Lanes operator-(Lanes a, Lanes b) { return {vsubq_f32(a.v, b.v)}; }
+inline Lanes operator*(Lanes a, Lanes b) { return {vmulq_f32(a.v, b.v)}; }
+// a * b + c, fused
+inline Lanes vmulAdd(Lanes a, Lanes b, Lanes c) { return {vfmaq_f32(c.v, a.v, b.v)}; }
+inline Lanes vfloor(Lanes a) { return {vrndmq_f32(a.v)}; }
+inline Lanes vround(Lanes a) { return {vrndnq_f32(a.v)}; }
+inline Lanes vabs(Lanes a) { return {vabsq_f32(a.v)}; }
+inline Lanes vmin(Lanes a, Lanes b) { return {vminq_f32(a.v, b.v)}; }
+inline Lanes vmax(Lanes a, Lanes b) { return {vmaxq_f32(a.v, b.v)}; }
+// TerrainFunction::hash21() of whole-number lattice coordinates
+inline Lanes hash21(Lanes x, Lanes z) {
+    uint32x4_t h = veorq_u32(vmulq_n_u32(vreinterpretq_u32_s32(vcvtq_s32_f32(x.v)), 0x8da6b343u),
+                             vmulq_n_u32(vreinterpretq_u32_s32(vcvtq_s32_f32(z.v)), 0xd8163841u));
+    h = veorq_u32(h, vshrq_n_u32(h, 15));
+    h = vmulq_n_u32(h, 0x2c1b3c6du);
+    h = veorq_u32(h, vshrq_n_u32(h, 12));
+    h = vmulq_n_u32(h, 0x297a2d39u);
+    h = veorq_u32(h, vshrq_n_u32(h, 15));
+    return {vmulq_n_f32(vcvtq_f32_u32(vshrq_n_u32(h, 8)), 1.0f / 16777216.0f)};
+}
+// a negated in the lanes where the whole number k is odd
+inline Lanes flipIfOdd(Lanes a, Lanes k) {
+    uint32x4_t sign = vshlq_n_u32(vreinterpretq_u32_s32(vcvtq_s32_f32(k.v)), 31);
+    return {vreinterpretq_f32_u32(veorq_u32(vreinterpretq_u32_f32(a.v), sign))};
+}
+#endif
+
+// pi in four parts (Cody-Waite); with fused multiply-adds k * pi is removed from
+// the argument exactly for every k the terrain produces, even through the hash
+constexpr float PI_A = 3.140625f;
+constexpr float PI_B = 0.0009670257568359375f;
+constexpr float PI_C = 6.2771141529083251953e-07f;
+constexpr float PI_D = 1.2154201256553420762e-10f;
+constexpr float INV_PI = 0.31830988618379067154f;
+constexpr float HALF_PI = 1.57079632679489661923f;
+
+// sin(x) = (-1)^k sin(r) with x = k pi + r, |r| <= pi / 2, and sin(r) from its
+// Taylor series to r^11, which is within 6e-8 at the ends of that interval
+inline Lanes vsin(Lanes x) {
+    Lanes k = vround(x * splat(INV_PI));
+    Lanes r = vmulAdd(k, splat(-PI_A), x);
+    r = vmulAdd(k, splat(-PI_B), r);
+    r = vmulAdd(k, splat(-PI_C), r);
+    r = vmulAdd(k, splat(-PI_D), r);
+
+    Lanes r2 = r * r;
+    Lanes poly = vmulAdd(splat(-2.5052108e-8f), r2, splat(2.7557319e-6f));
+    poly = vmulAdd(poly, r2, splat(-1.9841270e-4f));
+    poly = vmulAdd(poly, r2, splat(8.3333333e-3f));
+    poly = vmulAdd(poly, r2, splat(-1.6666667e-1f));
+    return flipIfOdd(vmulAdd(r * r2, poly, r), k);
+}
+
+inline Lanes vcos(Lanes x) {
+    return vsin(x + splat(HALF_PI));
+}
+
+inline Lanes noise(Lanes x, Lanes z) {
+    Lanes ix = vfloor(x);
+    Lanes iz = vfloor(z);
+    Lanes fx = x - ix;
+    Lanes fz = z - iz;
+    fx = fx * fx * (splat(3.0f) - splat(2.0f) * fx);
+    fz = fz * fz * (splat(3.0f) - splat(2.0f) * fz);
+
+    Lanes one = splat(1.0f);
+    Lanes a = hash21(ix, iz);
+    Lanes b = hash21(ix + one, iz);
+    Lanes c = hash21(ix, iz + one);
+    Lanes d = hash21(ix + one, iz + one);
+
+    Lanes ab = vmulAdd(b - a, fx, a);
+    Lanes cd = vmulAdd(d - c, fx, c);
+    return vmulAdd(cd - ab, fz, ab);
+}
+
+inline Lanes fbm(Lanes x, Lanes z, int octaves) {
+    Lanes value = splat(0.0f);
+    float amplitude = 0.5f;
+    for (int i = 0; i < octaves; i++) {
+        value = vmulAdd(splat(amplitude), noise(x, z), value);
+        x = x * splat(2.0f);
+        z = z * splat(2.0f);
+        amplitude *= 0.5f;
+    }
+    return value;
+}
+
+inline Lanes smoothstep(float edge0, float edge1, Lanes x) {
+    Lanes t = (x - splat(edge0)) * splat(1.0f / (edge1 - edge0));
+    t = vmin(vmax(t, splat(0.0f)), splat(1.0f));
+    return t * t * (splat(3.0f) - splat(2.0f) * t);
+}
+
+// TerrainFunction::height(), lane by lane
+Lanes terrainHeight(Lanes x, Lanes z, const TerrainFunction::Parameters& parameters) {
+    x = x * splat(parameters.terrainScale);
+    z = z * splat(parameters.terrainScale);
+
+    // Base terrain layers
+    Lanes height = vsin(x * splat(0.008f)) * splat(15.0f) + vcos(z * splat(0.01f)) * splat(12.0f);
+    height = height + vsin(x * splat(0.02f) + z * splat(0.015f)) * splat(8.0f);
+    height = height + vcos(x * splat(0.025f)) * vcos(z * splat(0.03f)) * splat(5.0f);
+
+    // Add detail based on quality
+    if (parameters.qualityLevel >= 1) {
+        height = height + fbm(x * splat(0.05f), z * splat(0.05f), 2) * splat(4.0f);
+    }
+    if (parameters.qualityLevel >= 2) {
+        height = height + fbm(x * splat(0.1f), z * splat(0.1f), 1) * splat(2.0f);
+    }
+
+    // River valleys
+    Lanes one = splat(1.0f);
+    Lanes river1 = vabs(vsin(x * splat(0.005f) + vcos(z * splat(0.003f)) * splat(2.0f)));
+    Lanes river2 = vabs(vsin(z * splat(0.004f) + vcos(x * splat(0.006f)) * splat(1.5f)));
+    height = height - smoothstep(0.0f, 0.3f, one - river1) * splat(10.0f);
+    height = height - smoothstep(0.0f, 0.2f, one - river2) * splat(8.0f);
+
+    return height * splat(parameters.terrainHeight * 0.01f);
+}
+
+void heightsLanes(const float* x, const float* z, float* heights, size_t count,
+                  const TerrainFunction::Parameters& parameters) {
+    size_t i = 0;
+    for (; i + Lanes::WIDTH <= count; i += Lanes::WIDTH) {
+        store(heights + i, terrainHeight(load(x + i), load(z + i), parameters));
+    }
+    if (i == count) {
+        return;
+    }
+
+    // The tail runs as one more full batch, padded with its last position
+    float tailX[Lanes::WIDTH];
+    float tailZ[Lanes::WIDTH];
+    float tailHeights[Lanes::WIDTH];
+    for (size_t lane = 0; lane < Lanes::WIDTH; lane++) {
+        size_t source = std::min(i + lane, count - 1);
+        tailX[lane] = x[source];
+        tailZ[lane] = z[source];
+    }
+    store(tailHeights, terrainHeight(load(tailX), load(tailZ), parameters));
+    std::copy(tailHeights, tailHeights + (count - i), heights + i);
+}
+}
+
+#if defined(__AVX2__)
+void TerrainFunction::heightsAvx2(const float* x, const float* z, float* heights, size_t count,
+                                  const Parameters& parameters) {
+    heightsLanes(x, z, heights, count, parameters);
+}
+#else
+void TerrainFunction::heightsNeon(const float* x, const float* z, float* heights, size_t count,
+                                  const Parameters& parameters) {
+    heightsLanes(x, z, heights, count, parameters);
+}
+#endif
+#endif
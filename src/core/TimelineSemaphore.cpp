@@ -0,0 +1,46 @@
+#include "core/TimelineSemaphore.h"
+#include "core/VulkanDevice.h"
+#include <stdexcept>
+
+TimelineSemaphore::TimelineSemaphore(VulkanDevice* device, uint64_t initialValue)
+    : m_device(device), m_lastSignaledValue(initialValue) {
+    VkSemaphoreTypeCreateInfo typeInfo{};
+    typeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+    typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+    typeInfo.initialValue = initialValue;
+
+    VkSemaphoreCreateInfo semaphoreInfo{};
+    semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    semaphoreInfo.pNext = &typeInfo;
+
+    if (vkCreateSemaphore(m_device->getDevice(), &semaphoreInfo, nullptr, &m_semaphore) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create timeline semaphore!");
+    }
+}
+
+TimelineSemaphore::~TimelineSemaphore() {
+    if (m_semaphore != VK_NULL_HANDLE) {
+        vkDestroySemaphore(m_device->getDevice(), m_semaphore, nullptr);
+    }
+}
+
+uint64_t TimelineSemaphore::getCompletedValue() const {
+    uint64_t value = 0;
+    if (vkGetSemaphoreCounterValue(m_device->getDevice(), m_semaphore, &value) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to query timeline semaphore value!");
+    }
+    return value;
+}
+
+void TimelineSemaphore::wait(uint64_t value, uint64_t timeout) const {
+    VkSemaphoreWaitInfo waitInfo{};
+    waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+    waitInfo.semaphoreCount = 1;
+    waitInfo.pSemaphores = &m_semaphore;
+    waitInfo.pValues = &value;
+
+    VkResult result = vkWaitSemaphores(m_device->getDevice(), &waitInfo, timeout);
+    if (result != VK_SUCCESS && result != VK_TIMEOUT) {
+        throw std::runtime_error("Failed to wait on timeline semaphore!");
+    }
+}
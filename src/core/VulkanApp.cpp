@@ -5,18 +5,34 @@
 #include "core/VulkanApp.h"
 #include "core/WindowManager.h"
 #include "core/VulkanDevice.h"
+#include "core/TimelineSemaphore.h"
+#include "core/DeletionQueue.h"
 #include "debug/VulkanDebug.h"
 #include "rendering/SwapChain.h"
 #include "rendering/GraphicsPipeline.h"
+#include "rendering/ShaderPermutation.h"
 #include "rendering/UniformBuffer.h"
 #include "ui/DebugUI.h"
 #include <iostream>
 #include <stdexcept>
 #include <algorithm>
+#include <array>
 #include <cctype>
+#include <filesystem>
+#include <string>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
+namespace {
+// Scene pipelines take their viewport dynamically, since the render size follows the upscaler
+void setViewport(VkCommandBuffer commandBuffer, VkExtent2D extent) {
+    VkViewport viewport{0.0f, 0.0f, static_cast<float>(extent.width), static_cast<float>(extent.height), 0.0f, 1.0f};
+    VkRect2D scissor{{0, 0}, extent};
+    vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+    vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+}
+}
+
 void VulkanApp::run() {
     std::cout << "\n=== Starting Vulkan Application ===\n" << std::endl;
     m_windowManager = std::make_unique<WindowManager>(WIDTH, HEIGHT, "Vulkan glTF PBR Viewer");
@@ -41,17 +57,27 @@ void VulkanApp::initVulkan() {
     std::cout << "Creating Vulkan device..." << std::endl;
     m_device = std::make_unique<VulkanDevice>(m_instance, validationLayers, enableValidationLayers);
     m_device->setSurface(m_surface); // Set our stored surface
+    m_device->setInstanceApiVersion(m_instanceApiVersion);
+    m_device->setModernRenderingEnabled(enableDynamicRendering);
     m_device->pickPhysicalDevice();
     m_device->createLogicalDevice();
 
-    std::cout << "Creating swap chain..." << std::endl;
-    m_swapChain = std::make_unique<SwapChain>(m_device.get(), VkExtent2D{WIDTH, HEIGHT});
+    // The forward pipeline layout includes the light cluster, shadow and environment sets, so these come first
+    m_clusteredLighting = std::make_unique<ClusteredLighting>(m_device.get());
+    m_shadowMaps = std::make_unique<CascadedShadowMaps>(m_device.get());
+    m_imageBasedLighting = std::make_unique<ImageBasedLighting>(m_device.get());
+    m_temporalUpscaler = std::make_unique<TemporalUpscaler>(m_device.get());
+    m_weightedOIT = std::make_unique<WeightedBlendedOIT>(m_device.get());
+    m_occlusionCuller = std::make_unique<HiZOcclusionCuller>(m_device.get());
+    m_postProcessor = std::make_unique<PostProcessor>(m_device.get());
 
-    std::cout << "Creating graphics pipeline..." << std::endl;
-    m_pipeline = std::make_unique<GraphicsPipeline>(m_device.get(), m_swapChain.get());
+    std::cout << "Creating swap chain, pipeline and synchronization objects..." << std::endl;
+    m_frameTimeline = std::make_unique<TimelineSemaphore>(m_device.get());
+    createSwapChainResources(VkExtent2D{WIDTH, HEIGHT});
 
-    std::cout << "Creating synchronization objects..." << std::endl;
-    m_sync = std::make_unique<VulkanSync>(m_device.get(), MAX_FRAMES_IN_FLIGHT, m_swapChain->getImages().size());
+    // Scene render passes are rebuilt with the swap chain but keep their formats,
+    // so the terrain pipelines stay compatible with every one of them
+    m_renderManager = std::make_unique<RenderManager>(m_device.get(), m_pipeline->getSceneRenderPass());
 
     std::cout << "Creating Debug UI..." << std::endl;
     m_debugUI = std::make_unique<DebugUI>(m_device.get(), m_swapChain.get(), m_pipeline->getRenderPass(), m_windowManager->getWindow());
@@ -60,6 +86,16 @@ void VulkanApp::initVulkan() {
     m_viewer = std::make_unique<GLTFViewer>(m_device.get(), m_swapChain.get());
     m_viewer->initialize();
     
+    m_scene = std::make_unique<Scene>();
+    m_scene->initialize();
+    // Per-system CPU times are shown next to the GPU pass timings; the profiler
+    // is recreated with the swap chain, so it is looked up on every call
+    m_scene->getScheduler()->setTimingCallback([this](const std::string& name, double cpuMs) {
+        if (m_profiler) {
+            m_profiler->addCpuTiming(name, cpuMs);
+        }
+    });
+    
     // Connect input callbacks to the viewer
     setupInputCallbacks();
     
@@ -76,7 +112,6 @@ void VulkanApp::initVulkan() {
     m_renderSettings.qualityLevel = 1;      // Medium quality
     m_renderSettings.viewDistance = 250.0f; // Extended view distance
     m_renderSettings.showDebugUI = true;
-    m_renderSettings.enableVSync = true;
 
     std::cout << "Vulkan initialization complete\n" << std::endl;
     
@@ -97,6 +132,7 @@ void VulkanApp::initVulkan() {
     std::cout << "  B : Toggle bounding box" << std::endl;
     std::cout << "Drag & Drop:" << std::endl;
     std::cout << "  Drop .gltf/.glb files to load models" << std::endl;
+    std::cout << "  Drop .hdr files to load an environment for image-based lighting" << std::endl;
     std::cout << "  Drop .exr files (HDR textures supported)" << std::endl;
     std::cout << "================" << std::endl;
 }
@@ -118,7 +154,15 @@ void VulkanApp::createSurface() {
 void VulkanApp::mainLoop() {
     std::cout << "Entering main loop..." << std::endl;
     while (!m_windowManager->shouldClose()) {
+        // Low latency mode: let the GPU drain the previous frame before sampling
+        // input, so the input is as fresh as possible when it gets rendered
+        if (m_renderSettings.lowLatencyMode) {
+            m_sync->waitForFrame(m_sync->getPreviousFrame());
+        }
+        collectLatencySamples();
+        
         m_windowManager->pollEvents();
+        m_latencyTracker.markInputSampled();
         processInput();
         
         // Update performance stats
@@ -126,9 +170,18 @@ void VulkanApp::mainLoop() {
         
         // Update UI
         m_debugUI->newFrame();
-        m_debugUI->renderViewerPanel(m_performanceStats, m_viewer.get(), m_backgroundSettings);
+        m_debugUI->renderViewerPanel(m_performanceStats, m_renderSettings, m_viewer.get(), m_backgroundSettings);
         m_debugUI->render();
         
+        // Present mode / frame pacing changes need a new swap chain
+        applyPresentationSettings();
+        
+        // Environment loads precompute (or read the cache) before this frame is built
+        applyEnvironmentSettings();
+        
+        // Pick this frame's render resolution and jitter before the camera matrices are uploaded
+        applyResolutionScaling();
+        
         // Update viewer
         auto currentTime = std::chrono::high_resolution_clock::now();
         float deltaTime = std::chrono::duration<float>(currentTime - m_lastFrameTime).count();
@@ -148,8 +201,12 @@ void VulkanApp::mainLoop() {
 void VulkanApp::drawFrame() {
     uint32_t currentFrame = m_sync->getCurrentFrame();
 
-    // Wait for the previous frame's fence
-    m_sync->waitForFence(currentFrame);
+    // Wait until the GPU is done with this frame slot's previous submission
+    m_sync->waitForFrame(currentFrame);
+    m_latencyTracker.markCompleted(currentFrame);
+
+    // Release resources the GPU has moved past
+    m_device->getDeletionQueue()->collect();
 
     // Acquire the next image from the swap chain
     uint32_t imageIndex;
@@ -169,31 +226,14 @@ void VulkanApp::drawFrame() {
         throw std::runtime_error("Failed to acquire swap chain image!");
     }
 
-    // Check if a previous frame is using this image (i.e., there is its fence to wait on)
-    if (*m_sync->getImageInFlightFence(imageIndex) != VK_NULL_HANDLE) {
-        vkWaitForFences(m_device->getDevice(), 1, m_sync->getImageInFlightFence(imageIndex), VK_TRUE, UINT64_MAX);
-    }
-    // Mark the image as now being in use by this frame
-    *m_sync->getImageInFlightFence(imageIndex) = m_sync->getInFlightFence(currentFrame);
-
-    // Reset the fence for the current frame
-    m_sync->resetFence(currentFrame);
-
-    // Reset and record command buffer for this frame only
-    vkResetCommandBuffer(m_pipeline->getCommandBuffer()->getCommandBuffer(imageIndex), 0);
-    m_pipeline->getCommandBuffer()->recordCommandBuffer(
-        imageIndex,
-        m_pipeline->getRenderPass(),
-        m_pipeline->getFramebuffer()->getFramebuffer(imageIndex),
-        m_swapChain->getExtent(),
-        m_pipeline->getPipeline(),
-        m_pipeline->getPipelineLayout(),
-        m_pipeline->getUniformBuffer()->getDescriptorSet(),
-        m_debugUI.get(),
-        m_viewer.get()
-    );
-    
+    // A previous frame may still be rendering to this image
+    m_sync->waitForImage(imageIndex);
+
+    // Declare this frame's passes, then record them from the compiled graph
+    buildFrameGraph(imageIndex);
     auto commandBuffer = m_pipeline->getCommandBuffer()->getCommandBuffer(imageIndex);
+    vkResetCommandBuffer(commandBuffer, 0);
+    m_pipeline->getCommandBuffer()->recordCommandBuffer(imageIndex, m_renderGraph.get(), m_profiler.get(), currentFrame);
 
     // Submit command buffer
     VkSubmitInfo submitInfo{};
@@ -207,13 +247,30 @@ void VulkanApp::drawFrame() {
     submitInfo.commandBufferCount = 1;
     submitInfo.pCommandBuffers = &commandBuffer;
 
-    VkSemaphore signalSemaphores[] = {m_sync->getRenderFinishedSemaphore(imageIndex)};  // Use per-image semaphore
-    submitInfo.signalSemaphoreCount = 1;
+    // Signal the per-image present semaphore and the graphics timeline
+    TimelineSemaphore* timeline = m_device->getGraphicsTimeline();
+    uint64_t timelineValue = timeline->nextValue();
+
+    VkSemaphore signalSemaphores[] = {m_sync->getRenderFinishedSemaphore(imageIndex), timeline->getSemaphore(),
+                                      m_frameTimeline->getSemaphore()};
+    uint64_t signalValues[] = {0, timelineValue, m_frameTimeline->nextValue()}; // Binary semaphores ignore their value
+    uint64_t waitValues[] = {0};
+    submitInfo.signalSemaphoreCount = 3;
     submitInfo.pSignalSemaphores = signalSemaphores;
 
-    if (vkQueueSubmit(m_device->getGraphicsQueue(), 1, &submitInfo, m_sync->getInFlightFence(currentFrame)) != VK_SUCCESS) {
+    VkTimelineSemaphoreSubmitInfo timelineInfo{};
+    timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+    timelineInfo.waitSemaphoreValueCount = 1;
+    timelineInfo.pWaitSemaphoreValues = waitValues;
+    timelineInfo.signalSemaphoreValueCount = 3;
+    timelineInfo.pSignalSemaphoreValues = signalValues;
+    submitInfo.pNext = &timelineInfo;
+
+    if (vkQueueSubmit(m_device->getGraphicsQueue(), 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS) {
         throw std::runtime_error("Failed to submit draw command buffer!");
     }
+    m_sync->setSubmittedValue(currentFrame, imageIndex, timelineValue);
+    m_latencyTracker.markSubmitted(currentFrame);
 
     // Present the image
     VkPresentInfoKHR presentInfo{};
@@ -226,7 +283,20 @@ void VulkanApp::drawFrame() {
     presentInfo.pSwapchains = swapChains;
     presentInfo.pImageIndices = &imageIndex;
 
+    // Tag the present so collectLatencySamples can see when it is shown
+    VkPresentIdKHR presentId{};
+    if (m_device->supportsPresentWait()) {
+        m_presentId++;
+        presentId.sType = VK_STRUCTURE_TYPE_PRESENT_ID_KHR;
+        presentId.swapchainCount = 1;
+        presentId.pPresentIds = &m_presentId;
+        presentInfo.pNext = &presentId;
+    }
+
     result = vkQueuePresentKHR(m_device->getPresentQueue(), &presentInfo);
+    if (m_device->supportsPresentWait() && result == VK_SUCCESS) {
+        m_latencyTracker.markPresentQueued(currentFrame, m_presentId);
+    }
     if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || m_windowManager->wasResized()) {
         m_windowManager->resetResizeFlag();
         recreateSwapChain();
@@ -238,6 +308,541 @@ void VulkanApp::drawFrame() {
     m_sync->nextFrame();
 }
 
+void VulkanApp::buildFrameGraph(uint32_t imageIndex) {
+    RenderGraph& graph = *m_renderGraph;
+    graph.reset();
+
+    VkExtent2D outputExtent = m_swapChain->getExtent();
+    RGHandle backbuffer = graph.importImage("Backbuffer", m_swapChain->getImages()[imageIndex],
+                                           m_swapChain->getImageViews()[imageIndex], m_swapChain->getImageFormat(),
+                                           outputExtent, VK_IMAGE_LAYOUT_UNDEFINED,
+                                           VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, // Acquire semaphore wait stage
+                                           VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+
+    // The scene renders in linear HDR, at the dynamic resolution when upscaling;
+    // only the post chain's output reaches the backbuffer
+    bool upscale = m_upscaleActive;
+    VkExtent2D extent = upscale ? m_renderExtent : outputExtent;
+    RGHandle sceneColor = graph.createImage("SceneColor", {PostProcessor::HDR_FORMAT, extent, 0});
+    RGHandle depth = graph.createImage("Depth", {RenderPass::DEPTH_FORMAT, extent, 0});
+    // Matrices use the window's aspect ratio, matching GLTFViewer's uniform buffer
+    float aspectRatio = static_cast<float>(outputExtent.width) / static_cast<float>(outputExtent.height);
+
+    bool hasModel = m_viewer && m_viewer->hasModel();
+    // Points mode draws the vertices as they are: nothing to prepass, cull or blend
+    bool pointsMode = hasModel && m_viewer->getSettings().renderMode == ShaderPermutation::POINTS_MODE;
+    bool depthPrepass = m_renderSettings.depthPrepass && hasModel && !pointsMode;
+    // Alpha-masked draws are left out of the prepass, so they still write depth in the forward pass
+    bool maskedDraws = hasModel && m_viewer->getLoader().hasMaskedDraws();
+
+    // Blended draws are sorted back to front, unless there are so many that an
+    // order-independent approximation is cheaper than sorting them every frame
+    uint32_t blendedDraws = hasModel && !pointsMode ? m_viewer->getBlendedDrawCount() : 0;
+    int transparencyMode = m_renderSettings.transparencyMode;
+    bool weightedOIT = blendedDraws > 0 &&
+        (transparencyMode == 2 || (transparencyMode == 0 && blendedDraws >= WeightedBlendedOIT::AUTO_DRAW_THRESHOLD));
+    if (blendedDraws > 0 && !weightedOIT) {
+        m_viewer->sortTransparentDraws();
+    }
+    m_performanceStats.blendedDraws = static_cast<int>(blendedDraws);
+    m_performanceStats.weightedOITActive = weightedOIT;
+
+    // Re-upload the light list whenever a different model has been loaded
+    if (hasModel && m_viewer->getLoader().getGeneration() != m_lightsGeneration) {
+        m_clusteredLighting->setLights(m_viewer->getLoader().getLights());
+        m_lightsGeneration = m_viewer->getLoader().getGeneration();
+    }
+
+    // Opaque and masked objects are culled on the GPU in two phases around a Hi-Z
+    // pyramid build: the early phase tests against last frame's pyramid, the late
+    // phase re-tests what it rejected against the pyramid of this frame's early depth
+    bool occlusionCulling = m_renderSettings.occlusionCulling && hasModel && !pointsMode &&
+                            !m_viewer->getLoader().getDrawObjects().empty();
+    RGHandle hizPyramid = RG_INVALID_HANDLE;
+    RGHandle earlyCommands = RG_INVALID_HANDLE;
+    RGHandle lateCommands = RG_INVALID_HANDLE;
+    RGHandle rejectedObjects = RG_INVALID_HANDLE;
+    VkBuffer earlyIndirect = VK_NULL_HANDLE;
+    VkBuffer lateIndirect = VK_NULL_HANDLE;
+    if (occlusionCulling) {
+        const GLTFLoader& loader = m_viewer->getLoader();
+        if (loader.getGeneration() != m_cullObjectsGeneration) {
+            m_occlusionCuller->setObjects(loader.getDrawObjects());
+            m_cullObjectsGeneration = loader.getGeneration();
+        }
+        m_occlusionCuller->resize(outputExtent);
+        const OrbitCamera& camera = m_viewer->getCamera();
+        m_occlusionCuller->beginFrame(camera.getProjectionMatrix(aspectRatio, false) * camera.getViewMatrix(), extent);
+
+        // Last frame's early cull was the last reader of the pyramid, its forward passes of the command lists
+        hizPyramid = graph.importImage("HiZPyramid", m_occlusionCuller->getPyramid(), m_occlusionCuller->getPyramidView(),
+                                       HiZOcclusionCuller::PYRAMID_FORMAT, m_occlusionCuller->getPyramidExtent(),
+                                       VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                                       VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, m_occlusionCuller->getPyramidLevels());
+        earlyCommands = graph.importBuffer("EarlyDrawCommands", m_occlusionCuller->getEarlyCommandBuffer(),
+                                           m_occlusionCuller->getCommandBufferSize(),
+                                           VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT);
+        lateCommands = graph.importBuffer("LateDrawCommands", m_occlusionCuller->getLateCommandBuffer(),
+                                          m_occlusionCuller->getCommandBufferSize(),
+                                          VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT);
+        rejectedObjects = graph.importBuffer("RejectedObjects", m_occlusionCuller->getRejectedBuffer(),
+                                             m_occlusionCuller->getRejectedBufferSize(),
+                                             VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+        earlyIndirect = m_occlusionCuller->getEarlyCommandBuffer();
+        lateIndirect = m_occlusionCuller->getLateCommandBuffer();
+    } else {
+        // The pyramid stops tracking the camera while culling is off
+        m_occlusionCuller->invalidateHistory();
+    }
+
+    // The previous frame's forward pass is the last reader of the cluster lists
+    RGHandle clusterCounts = graph.importBuffer("ClusterLightCounts", m_clusteredLighting->getClusterCountBuffer(),
+                                                m_clusteredLighting->getClusterCountSize(),
+                                                VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+    RGHandle clusterIndices = graph.importBuffer("ClusterLightIndices", m_clusteredLighting->getLightIndexBuffer(),
+                                                 m_clusteredLighting->getLightIndexSize(),
+                                                 VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+
+    if (hasModel) {
+        graph.addPass("LightCulling",
+            [&](RenderGraphBuilder& builder) {
+                builder.writeStorage(clusterCounts);
+                builder.writeStorage(clusterIndices);
+            },
+            [this, aspectRatio](VkCommandBuffer commandBuffer) {
+                const OrbitCamera& camera = m_viewer->getCamera();
+                m_clusteredLighting->cull(commandBuffer, camera.getViewMatrix(), camera.getProjectionMatrix(aspectRatio),
+                                          camera.getNear(), camera.getFar());
+            });
+    }
+
+    // Shadow cascades: every map is sampled by the forward pass, but only stale ones are re-rendered
+    std::array<RGHandle, CascadedShadowMaps::CASCADE_COUNT> shadowCascades{};
+    if (hasModel) {
+        const OrbitCamera& camera = m_viewer->getCamera();
+        const GLTFLoader& loader = m_viewer->getLoader();
+        const ViewerSettings& settings = m_viewer->getSettings();
+        // Nothing beyond the far side of the model can receive a shadow
+        float shadowFar = std::min(camera.getFar(),
+                                   glm::length(camera.getPosition() - loader.getCenter()) + loader.getRadius());
+        shadowFar = std::max(shadowFar, camera.getNear() * 2.0f);
+        // Unjittered, so the jitter alone never moves a cascade out of its cached region
+        m_shadowMaps->update(camera.getViewMatrix(), camera.getProjectionMatrix(aspectRatio, false), camera.getNear(), shadowFar,
+                             settings.lightDirection, loader.getCenter(), loader.getRadius(), loader.getGeneration(),
+                             settings.shadowQuality);
+
+        for (uint32_t i = 0; i < CascadedShadowMaps::CASCADE_COUNT; i++) {
+            std::string name = "ShadowCascade" + std::to_string(i);
+            shadowCascades[i] = graph.importImage(name, m_shadowMaps->getImage(i), m_shadowMaps->getImageView(i),
+                                                  CascadedShadowMaps::FORMAT,
+                                                  {CascadedShadowMaps::MAP_SIZE, CascadedShadowMaps::MAP_SIZE},
+                                                  VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                                                  VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                                                  VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+            if (!m_shadowMaps->needsRender(i)) {
+                continue;
+            }
+
+            RGHandle cascade = shadowCascades[i];
+            graph.addPass(name,
+                [&](RenderGraphBuilder& builder) {
+                    builder.writeDepth(cascade, VK_ATTACHMENT_LOAD_OP_CLEAR, 1.0f);
+                },
+                [this, i](VkCommandBuffer commandBuffer) {
+                    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipeline->getShadowPipeline());
+                    vkCmdPushConstants(commandBuffer, m_pipeline->getShadowPipelineLayout(), VK_SHADER_STAGE_VERTEX_BIT,
+                                       0, sizeof(glm::mat4), &m_shadowMaps->getLightViewProj(i));
+                    // Cutouts cast solid shadows; blended surfaces cast none
+                    m_viewer->renderDepthToCommandBuffer(commandBuffer, true);
+                });
+            m_shadowMaps->markRendered(i);
+        }
+    }
+
+    if (occlusionCulling) {
+        graph.addPass("CullEarly",
+            [&](RenderGraphBuilder& builder) {
+                builder.readTexture(hizPyramid, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+                builder.writeStorage(earlyCommands);
+                builder.writeStorage(rejectedObjects);
+            },
+            [this](VkCommandBuffer commandBuffer) {
+                m_occlusionCuller->cullEarly(commandBuffer);
+            });
+    }
+
+    // Reduces the early depth into this frame's pyramid, then re-tests the early rejects against it
+    auto addLateCull = [&]() {
+        graph.addPass("HiZBuild",
+            [&](RenderGraphBuilder& builder) {
+                builder.readTexture(depth, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+                builder.writeStorage(hizPyramid);
+            },
+            [this, depth](VkCommandBuffer commandBuffer) {
+                m_occlusionCuller->buildPyramid(commandBuffer, m_renderGraph->getImageView(depth));
+            });
+        graph.addPass("CullLate",
+            [&](RenderGraphBuilder& builder) {
+                builder.readTexture(hizPyramid, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+                builder.readStorage(rejectedObjects);
+                builder.writeStorage(lateCommands);
+            },
+            [this](VkCommandBuffer commandBuffer) {
+                m_occlusionCuller->cullLate(commandBuffer);
+            });
+    };
+
+    auto bindDepthPrepass = [this, extent](VkCommandBuffer commandBuffer) {
+        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipeline->getDepthPrepassPipeline());
+        setViewport(commandBuffer, extent);
+        VkDescriptorSet viewerDescriptorSet = m_viewer->getDescriptorSet();
+        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+            m_pipeline->getPipelineLayout(), 0, 1, &viewerDescriptorSet, 0, nullptr);
+    };
+
+    if (depthPrepass) {
+        graph.addPass("DepthPrepass",
+            [&](RenderGraphBuilder& builder) {
+                builder.writeDepth(depth, VK_ATTACHMENT_LOAD_OP_CLEAR, 1.0f);
+                if (occlusionCulling) {
+                    builder.readIndirect(earlyCommands);
+                }
+            },
+            [this, bindDepthPrepass, earlyIndirect](VkCommandBuffer commandBuffer) {
+                bindDepthPrepass(commandBuffer);
+                m_viewer->renderDepthToCommandBuffer(commandBuffer, false, earlyIndirect);
+            });
+
+        // The late objects join the prepass too, so the forward pass's equal test finds their depth
+        if (occlusionCulling) {
+            addLateCull();
+            graph.addPass("DepthPrepassLate",
+                [&](RenderGraphBuilder& builder) {
+                    builder.writeDepth(depth, VK_ATTACHMENT_LOAD_OP_LOAD);
+                    builder.readIndirect(lateCommands);
+                },
+                [this, bindDepthPrepass, lateIndirect](VkCommandBuffer commandBuffer) {
+                    bindDepthPrepass(commandBuffer);
+                    m_viewer->renderDepthToCommandBuffer(commandBuffer, false, lateIndirect);
+                });
+        }
+    }
+
+    // Sets 0-3 and the cluster and environment push constants shared by every shading variant
+    auto bindForwardSets = [this, extent](VkCommandBuffer commandBuffer) {
+        // GLTFViewer's descriptor set has the camera matrices
+        VkDescriptorSet viewerDescriptorSet = m_viewer->getDescriptorSet();
+        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+            m_pipeline->getPipelineLayout(), 0, 1, &viewerDescriptorSet, 0, nullptr);
+        const OrbitCamera& camera = m_viewer->getCamera();
+        m_clusteredLighting->bind(commandBuffer, m_pipeline->getPipelineLayout(),
+                                  camera.getNear(), camera.getFar(), extent);
+        // Set 2 is part of the layout, so it is bound even with shadows off
+        m_shadowMaps->bind(commandBuffer, m_pipeline->getPipelineLayout());
+        m_imageBasedLighting->bind(commandBuffer, m_pipeline->getPipelineLayout(),
+                                   m_backgroundSettings.environmentRotation,
+                                   m_backgroundSettings.environmentIntensity);
+    };
+    auto readForwardInputs = [&](RenderGraphBuilder& builder) {
+        builder.readStorage(clusterCounts, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+        builder.readStorage(clusterIndices, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+        for (RGHandle cascade : shadowCascades) {
+            builder.readTexture(cascade);
+        }
+    };
+
+    // Procedural terrain and the scene's entities, drawn after the opaque scene with the
+    // same camera so they depth test against it; heights stream in as the camera moves
+    bool terrain = m_renderSettings.showTerrain && m_viewer;
+    RGHandle traceColor = RG_INVALID_HANDLE;
+    RGHandle traceDistance = RG_INVALID_HANDLE;
+    if (terrain) {
+        const OrbitCamera& camera = m_viewer->getCamera();
+        const ViewerSettings& settings = m_viewer->getSettings();
+        RenderManager::Settings terrainSettings;
+        terrainSettings.technique = static_cast<RenderManager::Technique>(m_renderSettings.terrainTechnique);
+        terrainSettings.raymarchScale = 1u << m_renderSettings.terrainRaymarchResolution;
+        terrainSettings.qualityLevel = m_renderSettings.qualityLevel;
+        terrainSettings.viewDistance = m_renderSettings.viewDistance;
+        terrainSettings.lodDistance = m_renderSettings.terrainLodDistance;
+        terrainSettings.baseHeight = m_renderSettings.terrainBaseHeight;
+        terrainSettings.enableWater = m_renderSettings.enableWater;
+        terrainSettings.fogDensity = m_renderSettings.fogDensity;
+        terrainSettings.skyColorHorizon = m_renderSettings.skyHorizon;
+        terrainSettings.skyColorZenith = m_renderSettings.skyZenith;
+        terrainSettings.sunColor = m_renderSettings.sunColor;
+        terrainSettings.sunIntensity = m_renderSettings.sunIntensity;
+        // Lit from where the model's primary light comes from
+        terrainSettings.sunDirection = -settings.lightDirection;
+        float time = std::chrono::duration<float>(std::chrono::high_resolution_clock::now() - m_startTime).count();
+
+        bool streaming = m_renderManager->update(terrainSettings, camera.getViewMatrix(),
+                                                 camera.getProjectionMatrix(aspectRatio), extent, time);
+        // Entities stream in over the same ground, around the same camera, and are drawn with the terrain
+        updateScene(camera.getPosition(), camera.getViewMatrix(), camera.getProjectionMatrix(aspectRatio));
+        m_renderManager->updateEntities(m_scene->getRenderList());
+        if (streaming) {
+            // Manages its own barriers against earlier frames' reads and the draws below
+            graph.addPass("TerrainStreaming",
+                [&](RenderGraphBuilder& builder) {
+                    builder.setSideEffects();
+                },
+                [this](VkCommandBuffer commandBuffer) {
+                    m_renderManager->recordHeightfield(commandBuffer);
+                });
+        }
+
+        // Reduced-resolution raymarch, rebuilt at full resolution by the terrain draw in the scene pass
+        VkExtent2D traceExtent = m_renderManager->getTraceExtent();
+        if (traceExtent.width > 0) {
+            traceColor = graph.createImage("TerrainTraceColor", {RenderManager::TRACE_COLOR_FORMAT, traceExtent, 0});
+            traceDistance = graph.createImage("TerrainTraceDistance",
+                                              {RenderManager::TRACE_DISTANCE_FORMAT, traceExtent, 0});
+            graph.addPass("TerrainTrace",
+                [&](RenderGraphBuilder& builder) {
+                    builder.writeColor(traceColor, VK_ATTACHMENT_LOAD_OP_DONT_CARE);
+                    builder.writeColor(traceDistance, VK_ATTACHMENT_LOAD_OP_DONT_CARE);
+                },
+                [this, traceExtent, traceColor, traceDistance](VkCommandBuffer commandBuffer) {
+                    setViewport(commandBuffer, traceExtent);
+                    m_renderManager->renderTrace(commandBuffer, m_renderGraph->getImageView(traceColor),
+                                                 m_renderGraph->getImageView(traceDistance));
+                });
+        }
+        const RenderManager::Stats& terrainStats = m_renderManager->getStats();
+        m_performanceStats.terrainPatches = static_cast<int>(terrainStats.patches);
+        m_performanceStats.terrainTriangles = static_cast<int>(terrainStats.triangles);
+        m_performanceStats.terrainRebuilds = terrainStats.rebuilds;
+        m_performanceStats.terrainTilesResident = static_cast<int>(terrainStats.tiles.resident);
+        m_performanceStats.terrainTileCapacity = static_cast<int>(terrainStats.tiles.capacity);
+        m_performanceStats.terrainTilesPending = static_cast<int>(terrainStats.tiles.pending);
+        m_performanceStats.terrainTileUploads = static_cast<int>(terrainStats.tiles.uploads);
+        m_performanceStats.terrainTilesGenerated = terrainStats.tiles.generated;
+        m_performanceStats.terrainTileEvictions = terrainStats.tiles.evictions;
+        m_performanceStats.sceneEntities = static_cast<int>(m_scene->getRenderList().size());
+        m_performanceStats.entityInstances = static_cast<int>(terrainStats.entityInstances);
+    }
+
+    // Without a prepass the forward pass draws the early objects itself, so the late
+    // ones (and the blended draws over them) need a second pass after the late cull
+    bool splitForward = occlusionCulling && !depthPrepass;
+    bool sortedBlending = blendedDraws > 0 && !weightedOIT;
+    VkBuffer forwardLateIndirect = splitForward ? VK_NULL_HANDLE : lateIndirect;
+    graph.addPass("Forward",
+        [&](RenderGraphBuilder& builder) {
+            builder.writeColor(sceneColor, VK_ATTACHMENT_LOAD_OP_CLEAR, {{0.95f, 0.95f, 0.95f, 1.0f}});
+            if (!depthPrepass) {
+                builder.writeDepth(depth, VK_ATTACHMENT_LOAD_OP_CLEAR, 1.0f);
+            } else if (maskedDraws || terrain) {
+                builder.writeDepth(depth, VK_ATTACHMENT_LOAD_OP_LOAD);
+            } else {
+                builder.readDepth(depth);
+            }
+            if (hasModel) {
+                readForwardInputs(builder);
+            }
+            if (traceColor != RG_INVALID_HANDLE && !splitForward) {
+                builder.readTexture(traceColor);
+                builder.readTexture(traceDistance);
+            }
+            if (occlusionCulling) {
+                builder.readIndirect(earlyCommands);
+                if (!splitForward) {
+                    builder.readIndirect(lateCommands);
+                }
+            }
+        },
+        [this, depthPrepass, pointsMode, extent, bindForwardSets, earlyIndirect, forwardLateIndirect,
+         sortedBlending = sortedBlending && !splitForward,
+         forwardTerrain = terrain && !splitForward](VkCommandBuffer commandBuffer) {
+            if (pointsMode) {
+                setViewport(commandBuffer, extent);
+                m_viewer->renderPointsToCommandBuffer(commandBuffer, m_pipeline.get(),
+                                                      static_cast<float>(extent.height));
+                if (forwardTerrain) {
+                    m_renderManager->render(commandBuffer);
+                }
+                return;
+            }
+
+            // The viewer switches to each material's shading variant; this binds the layout's sets
+            VkPipeline pipeline = m_pipeline->getShadingPipeline(0, depthPrepass);
+            vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+            setViewport(commandBuffer, extent);
+
+            if (m_viewer && m_viewer->hasModel()) {
+                bindForwardSets(commandBuffer);
+                m_profiler->beginStatistics(commandBuffer, depthPrepass ? 1 : 0);
+                m_viewer->renderToCommandBuffer(commandBuffer, m_pipeline.get(), depthPrepass, earlyIndirect);
+                if (forwardLateIndirect != VK_NULL_HANDLE) {
+                    m_viewer->renderToCommandBuffer(commandBuffer, m_pipeline.get(), depthPrepass, forwardLateIndirect);
+                }
+                // After the opaque scene, so the terrain it hides fails the depth test early
+                if (forwardTerrain) {
+                    m_renderManager->render(commandBuffer);
+                }
+                // Blended over the finished opaque image, farthest first
+                if (sortedBlending) {
+                    m_viewer->renderTransparentToCommandBuffer(commandBuffer, m_pipeline.get(), false);
+                }
+                m_profiler->endStatistics(commandBuffer);
+            } else {
+                // Fallback to pipeline descriptor set if no model
+                VkDescriptorSet descriptorSet = m_pipeline->getUniformBuffer()->getDescriptorSet();
+                vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+                    m_pipeline->getPipelineLayout(), 0, 1, &descriptorSet, 0, nullptr);
+                if (forwardTerrain) {
+                    m_renderManager->render(commandBuffer);
+                }
+            }
+        });
+
+    // Fragment statistics cover the early pass only; the late objects are normally few
+    if (splitForward) {
+        addLateCull();
+        graph.addPass("ForwardLate",
+            [&](RenderGraphBuilder& builder) {
+                builder.writeColor(sceneColor, VK_ATTACHMENT_LOAD_OP_LOAD);
+                builder.writeDepth(depth, VK_ATTACHMENT_LOAD_OP_LOAD);
+                builder.readIndirect(lateCommands);
+                readForwardInputs(builder);
+                if (traceColor != RG_INVALID_HANDLE) {
+                    builder.readTexture(traceColor);
+                    builder.readTexture(traceDistance);
+                }
+            },
+            [this, extent, bindForwardSets, lateIndirect, sortedBlending, terrain](VkCommandBuffer commandBuffer) {
+                vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipeline->getShadingPipeline(0, false));
+                setViewport(commandBuffer, extent);
+                bindForwardSets(commandBuffer);
+                m_viewer->renderToCommandBuffer(commandBuffer, m_pipeline.get(), false, lateIndirect);
+                if (terrain) {
+                    m_renderManager->render(commandBuffer);
+                }
+                if (sortedBlending) {
+                    m_viewer->renderTransparentToCommandBuffer(commandBuffer, m_pipeline.get(), false);
+                }
+            });
+    }
+
+    if (weightedOIT) {
+        // Accumulation starts empty and revealage fully revealed
+        RGHandle accumulation = graph.createImage("OITAccumulation", {WeightedBlendedOIT::ACCUM_FORMAT, extent, 0});
+        RGHandle revealage = graph.createImage("OITRevealage", {WeightedBlendedOIT::REVEALAGE_FORMAT, extent, 0});
+
+        graph.addPass("Transparency",
+            [&](RenderGraphBuilder& builder) {
+                builder.writeColor(accumulation, VK_ATTACHMENT_LOAD_OP_CLEAR, {{0.0f, 0.0f, 0.0f, 0.0f}});
+                builder.writeColor(revealage, VK_ATTACHMENT_LOAD_OP_CLEAR, {{1.0f, 0.0f, 0.0f, 0.0f}});
+                builder.readDepth(depth);
+                readForwardInputs(builder);
+            },
+            [this, extent, bindForwardSets](VkCommandBuffer commandBuffer) {
+                setViewport(commandBuffer, extent);
+                bindForwardSets(commandBuffer);
+                m_viewer->renderTransparentToCommandBuffer(commandBuffer, m_pipeline.get(), true);
+            });
+
+        // Depth rides along only to keep the pass compatible with the forward pipelines' attachments
+        graph.addPass("OITComposite",
+            [&](RenderGraphBuilder& builder) {
+                builder.writeColor(sceneColor, VK_ATTACHMENT_LOAD_OP_LOAD);
+                builder.readDepth(depth);
+                builder.readTexture(accumulation);
+                builder.readTexture(revealage);
+            },
+            [this, extent, accumulation, revealage](VkCommandBuffer commandBuffer) {
+                vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipeline->getOitCompositePipeline());
+                setViewport(commandBuffer, extent);
+                m_weightedOIT->bindComposite(commandBuffer, m_pipeline->getOitCompositeLayout(),
+                                             m_renderGraph->getImageView(accumulation),
+                                             m_renderGraph->getImageView(revealage));
+                vkCmdDraw(commandBuffer, 3, 1, 0, 0);
+            });
+    }
+
+    RGHandle postInput = sceneColor;
+    if (upscale) {
+        const OrbitCamera& camera = m_viewer->getCamera();
+        glm::mat4 viewProjection = camera.getProjectionMatrix(aspectRatio, false) * camera.getViewMatrix();
+        RGHandle previousHistory = graph.importImage("HistoryPrevious", m_temporalUpscaler->getPreviousHistory(),
+                                                     m_temporalUpscaler->getPreviousHistoryView(),
+                                                     TemporalUpscaler::HISTORY_FORMAT, outputExtent,
+                                                     VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                                                     VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                                                     VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+        // Last frame's resolve read this one, and the frame before post-processed it
+        RGHandle currentHistory = graph.importImage("History", m_temporalUpscaler->getCurrentHistory(),
+                                                    m_temporalUpscaler->getCurrentHistoryView(),
+                                                    TemporalUpscaler::HISTORY_FORMAT, outputExtent,
+                                                    VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                                                    VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                                                    VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+
+        graph.addPass("TemporalResolve",
+            [&](RenderGraphBuilder& builder) {
+                builder.readTexture(sceneColor, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+                builder.readTexture(depth, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+                builder.readTexture(previousHistory, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+                builder.writeStorage(currentHistory);
+            },
+            [this, sceneColor, depth, viewProjection](VkCommandBuffer commandBuffer) {
+                m_temporalUpscaler->resolve(commandBuffer, m_renderGraph->getImageView(sceneColor),
+                                            m_renderGraph->getImageView(depth), viewProjection);
+            });
+
+        // The history is already at output size
+        postInput = currentHistory;
+    }
+
+    // Bloom, auto exposure, tonemapping and display encoding, all in one pass
+    RGHandle displayColor = graph.createImage("DisplayColor", {PostProcessor::DISPLAY_FORMAT, outputExtent, 0});
+    const ViewerSettings& viewerSettings = m_viewer->getSettings();
+    PostProcessor::Settings postSettings;
+    postSettings.tonemapper = static_cast<PostProcessor::Tonemapper>(
+        std::clamp(viewerSettings.tonemapper, 0, static_cast<int>(PostProcessor::Tonemapper::Count) - 1));
+    postSettings.autoExposure = viewerSettings.autoExposure;
+    postSettings.exposure = viewerSettings.exposure;
+    postSettings.gamma = viewerSettings.gamma;
+    postSettings.bloom = viewerSettings.bloom;
+    postSettings.bloomThreshold = viewerSettings.bloomThreshold;
+    postSettings.bloomIntensity = viewerSettings.bloomIntensity;
+    float deltaSeconds = m_performanceStats.frameTime;
+    graph.addPass("PostProcess",
+        [&](RenderGraphBuilder& builder) {
+            builder.readTexture(postInput, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+            builder.writeStorage(displayColor);
+        },
+        [this, postInput, displayColor, outputExtent, postSettings, deltaSeconds](VkCommandBuffer commandBuffer) {
+            m_postProcessor->resize(outputExtent);
+            m_postProcessor->process(commandBuffer, m_renderGraph->getImageView(postInput),
+                                     m_renderGraph->getImageView(displayColor), postSettings, deltaSeconds);
+        });
+
+    // Swap chain images have no storage usage, so a fullscreen draw copies the
+    // post chain's output over before the interface goes on top. ImGui's pipeline
+    // was built against the color + depth render pass, so the UI pass carries
+    // depth as a don't-care attachment to stay compatible with it
+    RGHandle uiDepth = upscale ? graph.createImage("UIDepth", {RenderPass::DEPTH_FORMAT, outputExtent, 0}) : depth;
+    graph.addPass("UI",
+        [&](RenderGraphBuilder& builder) {
+            builder.readTexture(displayColor);
+            builder.writeColor(backbuffer, VK_ATTACHMENT_LOAD_OP_DONT_CARE);
+            builder.writeDepth(uiDepth, VK_ATTACHMENT_LOAD_OP_DONT_CARE);
+        },
+        [this, displayColor, outputExtent](VkCommandBuffer commandBuffer) {
+            setViewport(commandBuffer, outputExtent);
+            vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipeline->getPresentPipeline());
+            m_postProcessor->bindPresent(commandBuffer, m_pipeline->getPresentLayout(),
+                                         m_renderGraph->getImageView(displayColor));
+            vkCmdDraw(commandBuffer, 3, 1, 0, 0);
+
+            m_debugUI->renderDrawData(commandBuffer);
+        });
+
+    graph.compile();
+}
+
 void VulkanApp::recreateSwapChain() {
     int width = 0, height = 0;
     glfwGetFramebufferSize(m_windowManager->getWindow(), &width, &height);
@@ -246,15 +851,152 @@ void VulkanApp::recreateSwapChain() {
         glfwWaitEvents();
     }
 
-    vkDeviceWaitIdle(m_device->getDevice());
+    // The old swap chain, pipeline and sync objects are retired to the deletion
+    // queue inside createSwapChainResources, so there is no device-wide wait here
+    createSwapChainResources(VkExtent2D{static_cast<uint32_t>(width), static_cast<uint32_t>(height)});
+    
+    m_debugUI->setSwapChain(m_swapChain.get());
+    m_viewer->setSwapChain(m_swapChain.get());
+}
+
+void VulkanApp::createSwapChainResources(VkExtent2D extent) {
+    DeletionQueue* deletionQueue = m_device->getDeletionQueue();
+    uint64_t lastSubmitted = m_device->getGraphicsTimeline()->getLastSignaledValue();
+
+    // Presentation of old images isn't tracked by any timeline, so objects tied to
+    // the old swap chain stay alive until one further frame per image has completed.
+    // Counted in frames: other graphics submits also advance the graphics timeline.
+    uint64_t presentRetireFrame = m_frameTimeline->getLastSignaledValue() + (m_sync ? m_sync->getImageCount() : 0);
+
+    auto swapChain = std::make_unique<SwapChain>(m_device.get(), extent,
+                                                 toVkPresentMode(m_renderSettings.presentMode),
+                                                 static_cast<uint32_t>(m_renderSettings.swapchainImageCount),
+                                                 m_swapChain ? m_swapChain->getSwapChain() : VK_NULL_HANDLE);
+    if (m_pipeline) {
+        deletionQueue->retire(std::move(m_pipeline), lastSubmitted);
+    }
+    if (m_renderGraph) {
+        deletionQueue->retire(std::move(m_renderGraph), lastSubmitted);
+    }
+    if (m_swapChain) {
+        deletionQueue->retire(std::move(m_swapChain), m_frameTimeline.get(), presentRetireFrame);
+    }
+    m_swapChain = std::move(swapChain);
+    m_latencyTracker.dropPendingPresents();
+    m_pipeline = std::make_unique<GraphicsPipeline>(m_device.get(), m_swapChain.get(),
+                                                    m_clusteredLighting->getDescriptorSetLayout(),
+                                                    m_shadowMaps->getDescriptorSetLayout(),
+                                                    m_imageBasedLighting->getDescriptorSetLayout(),
+                                                    m_weightedOIT->getDescriptorSetLayout(),
+                                                    m_postProcessor->getPresentSetLayout());
+    m_renderGraph = std::make_unique<RenderGraph>(m_device.get());
+
+    // Sync objects are sized by frames in flight and swap chain image count
+    uint32_t framesInFlight = static_cast<uint32_t>(std::max(m_renderSettings.framesInFlight, 1));
+    uint32_t imageCount = static_cast<uint32_t>(m_swapChain->getImages().size());
+    if (!m_sync || m_sync->getMaxFramesInFlight() != framesInFlight || m_sync->getImageCount() != imageCount) {
+        if (m_sync) {
+            deletionQueue->retire(std::move(m_sync), m_frameTimeline.get(), presentRetireFrame);
+        }
+        if (m_profiler) {
+            deletionQueue->retire(std::move(m_profiler), lastSubmitted);
+        }
+        m_sync = std::make_unique<VulkanSync>(m_device.get(), framesInFlight, imageCount);
+        m_profiler = std::make_unique<Profiler>(m_device.get(), framesInFlight);
+        m_latencyTracker.reset(framesInFlight);
+    }
+
+    m_appliedPresentMode = m_renderSettings.presentMode;
+    m_appliedFramesInFlight = m_renderSettings.framesInFlight;
+    m_appliedImageCount = m_renderSettings.swapchainImageCount;
+    m_performanceStats.activePresentMode = fromVkPresentMode(m_swapChain->getPresentMode());
+    m_performanceStats.swapchainImageCount = static_cast<int>(imageCount);
+}
+
+void VulkanApp::applyPresentationSettings() {
+    if (m_renderSettings.presentMode != m_appliedPresentMode ||
+        m_renderSettings.framesInFlight != m_appliedFramesInFlight ||
+        m_renderSettings.swapchainImageCount != m_appliedImageCount) {
+        std::cout << "Presentation settings changed, recreating swap chain..." << std::endl;
+        recreateSwapChain();
+    }
+}
+
+void VulkanApp::applyEnvironmentSettings() {
+    if (m_backgroundSettings.pendingEnvironmentPath.empty()) {
+        return;
+    }
+
+    std::string filePath = std::move(m_backgroundSettings.pendingEnvironmentPath);
+    m_backgroundSettings.pendingEnvironmentPath.clear();
+    if (m_imageBasedLighting->loadEnvironment(filePath)) {
+        m_backgroundSettings.environmentName = std::filesystem::path(filePath).filename().string();
+        m_backgroundSettings.environmentLoadMs = static_cast<float>(m_imageBasedLighting->getLastLoadMs());
+        m_backgroundSettings.environmentFromCache = m_imageBasedLighting->wasLastLoadCached();
+    }
+}
+
+void VulkanApp::applyResolutionScaling() {
+    VkExtent2D outputExtent = m_swapChain->getExtent();
+    OrbitCamera& camera = m_viewer->getCamera();
+
+    // Upscaled frames reach the swap chain through the post chain like any other
+    m_upscaleActive = m_renderSettings.dynamicResolution;
+    if (!m_upscaleActive) {
+        m_temporalUpscaler->resetScale();
+        m_temporalUpscaler->invalidateHistory();
+        m_renderExtent = outputExtent;
+        camera.setJitter(glm::vec2(0.0f));
+        return;
+    }
 
-    // Clean up old resources
-    m_pipeline.reset();
-    m_swapChain.reset();
+    if (m_profiler && m_profiler->isSupported()) {
+        m_temporalUpscaler->updateScale(m_profiler->getFrameGpuMs(), m_renderSettings.targetFrameMs);
+    }
+    m_temporalUpscaler->resize(outputExtent);
+    m_renderExtent = m_temporalUpscaler->getRenderExtent(outputExtent);
+    camera.setJitter(m_temporalUpscaler->beginFrame(m_renderExtent));
+}
 
-    // Recreate swap chain and pipeline
-    m_swapChain = std::make_unique<SwapChain>(m_device.get(), VkExtent2D{static_cast<uint32_t>(width), static_cast<uint32_t>(height)});
-    m_pipeline = std::make_unique<GraphicsPipeline>(m_device.get(), m_swapChain.get());
+void VulkanApp::collectLatencySamples() {
+    // Frames whose GPU work finished since the last check
+    for (uint32_t i = 0; i < m_sync->getMaxFramesInFlight(); i++) {
+        if (m_latencyTracker.isPending(i) && m_sync->isFrameComplete(i)) {
+            m_latencyTracker.markCompleted(i);
+        }
+    }
+
+    // Presents shown since the last check, oldest first
+    uint64_t presentId = 0;
+    while (m_device->supportsPresentWait() && m_latencyTracker.getOldestPendingPresent(presentId)) {
+        VkResult result = m_device->waitForPresent(m_swapChain->getSwapChain(), presentId, 0);
+        if (result != VK_SUCCESS) {
+            // Out of date or lost: the swap chain is about to be recreated
+            if (result != VK_TIMEOUT) {
+                m_latencyTracker.dropPendingPresents();
+            }
+            break;
+        }
+        m_latencyTracker.markOldestPresented();
+    }
+}
+
+VkPresentModeKHR VulkanApp::toVkPresentMode(int presentMode) {
+    switch (presentMode) {
+        case 1: return VK_PRESENT_MODE_FIFO_RELAXED_KHR;
+        case 2: return VK_PRESENT_MODE_MAILBOX_KHR;
+        case 3: return VK_PRESENT_MODE_IMMEDIATE_KHR;
+        default: return VK_PRESENT_MODE_FIFO_KHR;
+    }
+}
+
+int VulkanApp::fromVkPresentMode(VkPresentModeKHR presentMode) {
+    switch (presentMode) {
+        case VK_PRESENT_MODE_FIFO_RELAXED_KHR: return 1;
+        case VK_PRESENT_MODE_MAILBOX_KHR: return 2;
+        case VK_PRESENT_MODE_IMMEDIATE_KHR: return 3;
+        default: return 0;
+    }
 }
 
 void VulkanApp::cleanup() {
@@ -265,7 +1007,28 @@ void VulkanApp::cleanup() {
         vkDeviceWaitIdle(m_device->getDevice());
     }
 
+    if (m_scene) {
+        m_scene->cleanup();
+        m_scene.reset();
+    }
+    m_viewer.reset();
+    m_debugUI.reset();
+    m_profiler.reset();
+    m_renderGraph.reset();
+    m_clusteredLighting.reset();
+    m_shadowMaps.reset();
+    m_imageBasedLighting.reset();
+    m_temporalUpscaler.reset();
+    m_weightedOIT.reset();
+    m_occlusionCuller.reset();
+    m_postProcessor.reset();
+    m_renderManager.reset();
     m_sync.reset();  // Destroy sync objects first
+    // Retired entries may still be waiting on the frame timeline; the device is idle
+    if (m_device) {
+        m_device->getDeletionQueue()->flush();
+    }
+    m_frameTimeline.reset();
     m_pipeline.reset();  // Destroy pipeline (includes framebuffer and render pass)
     m_swapChain.reset();  // Destroy swap chain
     m_device.reset();  // Destroy device
@@ -301,7 +1064,12 @@ void VulkanApp::createInstance() {
     appInfo.pApplicationName   = "Vulkan App";
     appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
     appInfo.pEngineName        = "No Engine";
-    appInfo.apiVersion         = VK_API_VERSION_1_0;
+    // 1.2 for timeline semaphores; 1.3 when the loader has it, so dynamic rendering
+    // and synchronization2 can be used as core features
+    uint32_t loaderVersion = VK_API_VERSION_1_0;
+    vkEnumerateInstanceVersion(&loaderVersion);
+    m_instanceApiVersion = loaderVersion >= VK_API_VERSION_1_3 ? VK_API_VERSION_1_3 : VK_API_VERSION_1_2;
+    appInfo.apiVersion         = m_instanceApiVersion;
 
     VkInstanceCreateInfo createInfo{};
     createInfo.sType            = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
@@ -327,6 +1095,14 @@ void VulkanApp::createInstance() {
     }
 }
 
+void VulkanApp::updateScene(const glm::vec3& cameraPos, const glm::mat4& viewMatrix, const glm::mat4& projMatrix) {
+    Scene::SceneSettings& settings = m_scene->getSettings();
+    settings.viewDistance = m_renderSettings.viewDistance;
+    
+    m_sceneCuller.updateFrustum(viewMatrix, projMatrix);
+    m_scene->update(m_performanceStats.frameTime, cameraPos, m_sceneCuller);
+}
+
 void VulkanApp::updatePerformanceStats() {
     auto currentTime = std::chrono::high_resolution_clock::now();
     float deltaTime = std::chrono::duration<float, std::chrono::seconds::period>(currentTime - m_lastFrameTime).count();
@@ -336,9 +1112,80 @@ void VulkanApp::updatePerformanceStats() {
         m_performanceStats.frameTime = deltaTime;
         m_performanceStats.fps = 1.0f / deltaTime;
         m_performanceStats.cpuTime = deltaTime; // Simplified for now
-        m_performanceStats.gpuTime = deltaTime * 0.7f; // Estimated
     }
     
+    // GPU timings lag a few frames behind: they come from the slot's previous use
+    if (m_profiler && m_profiler->isSupported()) {
+        m_performanceStats.gpuTime = static_cast<float>(m_profiler->getFrameGpuMs() / 1000.0);
+        m_performanceStats.passTimings.clear();
+        for (const auto& timing : m_profiler->getTimings()) {
+            m_performanceStats.passTimings.push_back({timing.name, static_cast<float>(timing.gpuMs / 1000.0)});
+        }
+    }
+    if (m_profiler) {
+        m_performanceStats.systemTimings.clear();
+        for (const auto& timing : m_profiler->getCpuTimings()) {
+            m_performanceStats.systemTimings.push_back({timing.name, static_cast<float>(timing.cpuMs / 1000.0)});
+        }
+        m_performanceStats.fragmentStatsSupported = m_profiler->isStatisticsSupported();
+        if (m_profiler->hasStatistics()) {
+            m_performanceStats.shadedFragments = m_profiler->getFragmentInvocations();
+            if (m_profiler->getStatisticsTag() == 1) {
+                m_performanceStats.shadedFragmentsWithPrepass = m_performanceStats.shadedFragments;
+            } else {
+                m_performanceStats.shadedFragmentsNoPrepass = m_performanceStats.shadedFragments;
+            }
+        }
+    }
+    if (m_renderGraph) {
+        const RenderGraph::Stats& graphStats = m_renderGraph->getStats();
+        m_performanceStats.graphPassCount = static_cast<int>(graphStats.passCount);
+        m_performanceStats.graphCulledPasses = static_cast<int>(graphStats.culledPassCount);
+        m_performanceStats.graphBarrierCount = static_cast<int>(graphStats.barrierCount);
+        m_performanceStats.transientMemoryMB = static_cast<float>(graphStats.transientMemory) / (1024.0f * 1024.0f);
+        m_performanceStats.aliasedMemoryMB = static_cast<float>(graphStats.aliasedMemorySaved) / (1024.0f * 1024.0f);
+    }
+    if (m_shadowMaps) {
+        const CascadedShadowMaps::Stats& shadowStats = m_shadowMaps->getStats();
+        m_performanceStats.shadowCascadesActive = static_cast<int>(shadowStats.activeCascades);
+        m_performanceStats.shadowCascadesRendered = static_cast<int>(shadowStats.renderedThisFrame);
+        m_performanceStats.shadowMapRenders = shadowStats.totalRenders;
+    }
+    if (m_swapChain && m_temporalUpscaler) {
+        m_performanceStats.renderScale = m_upscaleActive ? m_temporalUpscaler->getRenderScale() : 1.0f;
+        m_performanceStats.renderWidth = static_cast<int>(m_renderExtent.width);
+        m_performanceStats.renderHeight = static_cast<int>(m_renderExtent.height);
+    }
+    if (m_postProcessor) {
+        const PostProcessor::Stats& postStats = m_postProcessor->getStats();
+        m_performanceStats.postExposure = postStats.exposure;
+        m_performanceStats.averageLuminance = postStats.averageLuminance;
+    }
+    if (m_pipeline) {
+        m_performanceStats.shadingVariants = static_cast<int>(m_pipeline->getShadingPipelineCount());
+    }
+    if (m_occlusionCuller) {
+        const HiZOcclusionCuller::Stats& cullStats = m_occlusionCuller->getStats();
+        m_performanceStats.cullObjects = static_cast<int>(cullStats.objects);
+        m_performanceStats.cullDrawnEarly = static_cast<int>(cullStats.drawnEarly);
+        m_performanceStats.cullDrawnLate = static_cast<int>(cullStats.drawnLate);
+        m_performanceStats.cullOccluded = static_cast<int>(cullStats.occluded);
+        m_performanceStats.cullOutsideFrustum = static_cast<int>(cullStats.outsideFrustum);
+    }
+    if (m_viewer && m_viewer->hasModel()) {
+        m_performanceStats.materialDraws = static_cast<int>(m_viewer->getLoader().getMaterialDraws().size());
+        const TransparencySorter& sorter = m_viewer->getTransparencySorter();
+        m_performanceStats.transparencySortMs = static_cast<float>(sorter.getLastSortMs());
+        m_performanceStats.transparencySortChunks = static_cast<int>(sorter.getLastChunkCount());
+    }
+    
+    m_performanceStats.inputToSubmit = m_latencyTracker.getInputToSubmit();
+    m_performanceStats.submitToGpuComplete = m_latencyTracker.getSubmitToGpuComplete();
+    m_performanceStats.inputToGpuComplete = m_latencyTracker.getInputToGpuComplete();
+    m_performanceStats.presentTimed = m_latencyTracker.hasPresentTimings();
+    m_performanceStats.submitToPresent = m_latencyTracker.getSubmitToPresent();
+    m_performanceStats.inputToPresent = m_latencyTracker.getInputToPresent();
+    
     // No longer needed for glTF viewer
 }
 
@@ -408,13 +1255,15 @@ void VulkanApp::onDrop(int count, const char** paths) {
         // Check if it's a supported model file
         if (ext == "gltf" || ext == "glb") {
             m_viewer->loadModel(filePath);
+        } else if (ext == "hdr") {
+            m_backgroundSettings.pendingEnvironmentPath = filePath;
         } else if (ext == "exr") {
             std::cout << "EXR file dropped: " << filePath << std::endl;
             std::cout << "EXR files are supported as textures in glTF models" << std::endl;
             // EXR files are handled as textures when referenced in glTF models
         } else {
             std::cout << "Unsupported file type: " << ext << std::endl;
-            std::cout << "Supported formats: .gltf, .glb, .exr (as textures)" << std::endl;
+            std::cout << "Supported formats: .gltf, .glb, .hdr (environment), .exr (as textures)" << std::endl;
         }
     }
 }
@@ -1,5 +1,9 @@
 #include "core/VulkanDevice.h"
+#include "core/TimelineSemaphore.h"
+#include "core/DeletionQueue.h"
 
+#include <algorithm>
+#include <cstring>
 #include <iostream>
 #include <set>
 #include <stdexcept>
@@ -13,6 +17,15 @@ VulkanDevice::VulkanDevice(
 
 VulkanDevice::~VulkanDevice() {
     if (m_logicalDevice != VK_NULL_HANDLE) {
+        vkDeviceWaitIdle(m_logicalDevice);
+        if (m_deletionQueue) {
+            std::cout << "VulkanDevice: Flushing " << m_deletionQueue->getPendingCount() << " deferred release(s)" << std::endl;
+            m_deletionQueue.reset();
+        }
+        m_computeTimeline.reset();
+        m_transferTimeline.reset();
+        m_graphicsTimeline.reset();
+
         std::cout << "VulkanDevice: Destroying logical device" << std::endl;
         vkDestroyDevice(m_logicalDevice, nullptr);
     }
@@ -21,9 +34,16 @@ VulkanDevice::~VulkanDevice() {
 void VulkanDevice::createLogicalDevice() {
     std::cout << "VulkanDevice: Creating logical device..." << std::endl;
     QueueFamilyIndices indices = findQueueFamilies(m_physicalDevice);
+    m_queueFamilies = indices;
 
     std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
     std::set<uint32_t> uniqueQueueFamilies = {indices.graphicsFamily.value(), indices.presentFamily.value()};
+    if (indices.transferFamily.has_value()) {
+        uniqueQueueFamilies.insert(indices.transferFamily.value());
+    }
+    if (indices.computeFamily.has_value()) {
+        uniqueQueueFamilies.insert(indices.computeFamily.value());
+    }
 
     std::cout << "VulkanDevice: Setting up " << uniqueQueueFamilies.size() << " queue(s)" << std::endl;
 
@@ -37,10 +57,37 @@ void VulkanDevice::createLogicalDevice() {
         queueCreateInfos.push_back(queueCreateInfo);
     }
 
+    VkPhysicalDeviceFeatures supportedFeatures;
+    vkGetPhysicalDeviceFeatures(m_physicalDevice, &supportedFeatures);
+
     VkPhysicalDeviceFeatures deviceFeatures{};
+    // Optional: used by the profiler to count shader invocations
+    deviceFeatures.pipelineStatisticsQuery = supportedFeatures.pipelineStatisticsQuery;
+    m_pipelineStatistics = supportedFeatures.pipelineStatisticsQuery == VK_TRUE;
+    // Optional: lets the occlusion-culled draw lists go out as one indirect call per material run
+    deviceFeatures.multiDrawIndirect = supportedFeatures.multiDrawIndirect;
+    m_multiDrawIndirect = supportedFeatures.multiDrawIndirect == VK_TRUE;
+    // Optional: the wireframe overlay's barycentric pass-through; without it the overlay is unavailable
+    deviceFeatures.geometryShader = supportedFeatures.geometryShader;
+    m_geometryShader = supportedFeatures.geometryShader == VK_TRUE;
+    if (!m_geometryShader) {
+        std::cout << "VulkanDevice: Geometry shaders not supported, wireframe overlay disabled" << std::endl;
+    }
+    // Optional: point sizes above one pixel for the points view
+    deviceFeatures.largePoints = supportedFeatures.largePoints;
+    if (supportedFeatures.largePoints) {
+        VkPhysicalDeviceProperties properties;
+        vkGetPhysicalDeviceProperties(m_physicalDevice, &properties);
+        m_maxPointSize = properties.limits.pointSizeRange[1];
+    }
+
+    VkPhysicalDeviceTimelineSemaphoreFeatures timelineFeatures{};
+    timelineFeatures.sType             = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES;
+    timelineFeatures.timelineSemaphore = VK_TRUE;
 
     VkDeviceCreateInfo createInfo{};
     createInfo.sType                = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+    createInfo.pNext                = &timelineFeatures;
     createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
     createInfo.pQueueCreateInfos    = queueCreateInfos.data();
     createInfo.pEnabledFeatures     = &deviceFeatures;
@@ -51,6 +98,58 @@ void VulkanDevice::createLogicalDevice() {
 #endif
     deviceExtensions.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
 
+    // Dynamic rendering and synchronization2 are core features on 1.3 and
+    // extensions before that
+    queryRenderingFeatures();
+    bool core13 = m_apiVersion >= VK_API_VERSION_1_3;
+
+    VkPhysicalDeviceVulkan13Features vulkan13Features{};
+    vulkan13Features.sType            = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES;
+    vulkan13Features.dynamicRendering = m_dynamicRendering ? VK_TRUE : VK_FALSE;
+    vulkan13Features.synchronization2 = m_synchronization2 ? VK_TRUE : VK_FALSE;
+
+    VkPhysicalDeviceDynamicRenderingFeaturesKHR dynamicRenderingFeatures{};
+    dynamicRenderingFeatures.sType            = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES_KHR;
+    dynamicRenderingFeatures.dynamicRendering = VK_TRUE;
+
+    VkPhysicalDeviceSynchronization2FeaturesKHR synchronization2Features{};
+    synchronization2Features.sType            = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SYNCHRONIZATION_2_FEATURES_KHR;
+    synchronization2Features.synchronization2 = VK_TRUE;
+
+    if (core13 && (m_dynamicRendering || m_synchronization2)) {
+        timelineFeatures.pNext = &vulkan13Features;
+    } else if (!core13) {
+        void** next = &timelineFeatures.pNext;
+        if (m_dynamicRendering) {
+            deviceExtensions.push_back(VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME);
+            *next = &dynamicRenderingFeatures;
+            next = &dynamicRenderingFeatures.pNext;
+        }
+        if (m_synchronization2) {
+            deviceExtensions.push_back(VK_KHR_SYNCHRONIZATION_2_EXTENSION_NAME);
+            *next = &synchronization2Features;
+        }
+    }
+
+    // Present IDs with present wait let the latency readout measure up to the
+    // image being shown rather than to GPU completion
+    m_presentWait = queryPresentWait();
+    VkPhysicalDevicePresentIdFeaturesKHR presentIdFeatures{};
+    presentIdFeatures.sType     = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_ID_FEATURES_KHR;
+    presentIdFeatures.presentId = VK_TRUE;
+
+    VkPhysicalDevicePresentWaitFeaturesKHR presentWaitFeatures{};
+    presentWaitFeatures.sType       = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_WAIT_FEATURES_KHR;
+    presentWaitFeatures.presentWait = VK_TRUE;
+
+    if (m_presentWait) {
+        deviceExtensions.push_back(VK_KHR_PRESENT_ID_EXTENSION_NAME);
+        deviceExtensions.push_back(VK_KHR_PRESENT_WAIT_EXTENSION_NAME);
+        presentIdFeatures.pNext   = &presentWaitFeatures;
+        presentWaitFeatures.pNext = timelineFeatures.pNext;
+        timelineFeatures.pNext    = &presentIdFeatures;
+    }
+
     std::cout << "VulkanDevice: Enabling " << deviceExtensions.size() << " device extension(s)" << std::endl;
     for (const auto& ext : deviceExtensions) {
         std::cout << "  - " << ext << std::endl;
@@ -71,9 +170,147 @@ void VulkanDevice::createLogicalDevice() {
     std::cout << "VulkanDevice: Retrieving queue handles..." << std::endl;
     vkGetDeviceQueue(m_logicalDevice, indices.graphicsFamily.value(), 0, &m_graphicsQueue);
     vkGetDeviceQueue(m_logicalDevice, indices.presentFamily.value(), 0, &m_presentQueue);
+    m_transferQueue = m_graphicsQueue;
+    m_computeQueue = m_graphicsQueue;
+
+    m_graphicsTimeline = std::make_unique<TimelineSemaphore>(this);
+    if (indices.transferFamily.has_value()) {
+        vkGetDeviceQueue(m_logicalDevice, indices.transferFamily.value(), 0, &m_transferQueue);
+        m_transferTimeline = std::make_unique<TimelineSemaphore>(this);
+        std::cout << "VulkanDevice: Using dedicated transfer queue family " << indices.transferFamily.value() << std::endl;
+    }
+    if (indices.computeFamily.has_value()) {
+        vkGetDeviceQueue(m_logicalDevice, indices.computeFamily.value(), 0, &m_computeQueue);
+        m_computeTimeline = std::make_unique<TimelineSemaphore>(this);
+        std::cout << "VulkanDevice: Using async compute queue family " << indices.computeFamily.value() << std::endl;
+    }
+    m_deletionQueue = std::make_unique<DeletionQueue>(m_graphicsTimeline.get());
+    loadRenderingFunctions();
     std::cout << "VulkanDevice: Logical device created successfully" << std::endl;
 }
 
+void VulkanDevice::queryRenderingFeatures() {
+    VkPhysicalDeviceProperties deviceProperties;
+    vkGetPhysicalDeviceProperties(m_physicalDevice, &deviceProperties);
+    m_apiVersion = std::min(deviceProperties.apiVersion, m_instanceApiVersion);
+    m_dynamicRendering = false;
+    m_synchronization2 = false;
+
+    if (!m_modernRenderingEnabled) {
+        std::cout << "VulkanDevice: Dynamic rendering disabled, using render pass path" << std::endl;
+        return;
+    }
+
+    VkPhysicalDeviceFeatures2 features2{};
+    features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+
+    if (m_apiVersion >= VK_API_VERSION_1_3) {
+        VkPhysicalDeviceVulkan13Features vulkan13Features{};
+        vulkan13Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES;
+        features2.pNext = &vulkan13Features;
+        vkGetPhysicalDeviceFeatures2(m_physicalDevice, &features2);
+        m_dynamicRendering = vulkan13Features.dynamicRendering == VK_TRUE;
+        m_synchronization2 = vulkan13Features.synchronization2 == VK_TRUE;
+    } else {
+        VkPhysicalDeviceDynamicRenderingFeaturesKHR dynamicRenderingFeatures{};
+        dynamicRenderingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES_KHR;
+        VkPhysicalDeviceSynchronization2FeaturesKHR synchronization2Features{};
+        synchronization2Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SYNCHRONIZATION_2_FEATURES_KHR;
+        dynamicRenderingFeatures.pNext = &synchronization2Features;
+        features2.pNext = &dynamicRenderingFeatures;
+        vkGetPhysicalDeviceFeatures2(m_physicalDevice, &features2);
+
+        // Dynamic rendering also depends on depth_stencil_resolve and create_renderpass2, both core in 1.2
+        m_dynamicRendering = hasDeviceExtension(m_physicalDevice, VK_KHR_DYNAMIC_RENDERING_EXTENSION_NAME) &&
+                             dynamicRenderingFeatures.dynamicRendering == VK_TRUE;
+        m_synchronization2 = hasDeviceExtension(m_physicalDevice, VK_KHR_SYNCHRONIZATION_2_EXTENSION_NAME) &&
+                             synchronization2Features.synchronization2 == VK_TRUE;
+    }
+
+    std::cout << "VulkanDevice: Dynamic rendering " << (m_dynamicRendering ? "enabled" : "unavailable, using render pass path")
+              << ", synchronization2 " << (m_synchronization2 ? "enabled" : "unavailable") << std::endl;
+}
+
+bool VulkanDevice::queryPresentWait() {
+    bool supported = false;
+    if (hasDeviceExtension(m_physicalDevice, VK_KHR_PRESENT_ID_EXTENSION_NAME) &&
+        hasDeviceExtension(m_physicalDevice, VK_KHR_PRESENT_WAIT_EXTENSION_NAME)) {
+        VkPhysicalDevicePresentWaitFeaturesKHR presentWaitFeatures{};
+        presentWaitFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_WAIT_FEATURES_KHR;
+        VkPhysicalDevicePresentIdFeaturesKHR presentIdFeatures{};
+        presentIdFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_ID_FEATURES_KHR;
+        presentIdFeatures.pNext = &presentWaitFeatures;
+
+        VkPhysicalDeviceFeatures2 features2{};
+        features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+        features2.pNext = &presentIdFeatures;
+        vkGetPhysicalDeviceFeatures2(m_physicalDevice, &features2);
+        supported = presentIdFeatures.presentId == VK_TRUE && presentWaitFeatures.presentWait == VK_TRUE;
+    }
+
+    std::cout << "VulkanDevice: Present wait " << (supported ? "enabled" : "unavailable, latency measured to GPU completion")
+              << std::endl;
+    return supported;
+}
+
+void VulkanDevice::loadRenderingFunctions() {
+    // Through the device so KHR entry points work on 1.2 drivers too
+    bool core13 = m_apiVersion >= VK_API_VERSION_1_3;
+    if (m_dynamicRendering) {
+        m_vkCmdBeginRendering = reinterpret_cast<PFN_vkCmdBeginRenderingKHR>(
+            vkGetDeviceProcAddr(m_logicalDevice, core13 ? "vkCmdBeginRendering" : "vkCmdBeginRenderingKHR"));
+        m_vkCmdEndRendering = reinterpret_cast<PFN_vkCmdEndRenderingKHR>(
+            vkGetDeviceProcAddr(m_logicalDevice, core13 ? "vkCmdEndRendering" : "vkCmdEndRenderingKHR"));
+        if (!m_vkCmdBeginRendering || !m_vkCmdEndRendering) {
+            throw std::runtime_error("Failed to load dynamic rendering functions!");
+        }
+    }
+    if (m_synchronization2) {
+        m_vkCmdPipelineBarrier2 = reinterpret_cast<PFN_vkCmdPipelineBarrier2KHR>(
+            vkGetDeviceProcAddr(m_logicalDevice, core13 ? "vkCmdPipelineBarrier2" : "vkCmdPipelineBarrier2KHR"));
+        if (!m_vkCmdPipelineBarrier2) {
+            throw std::runtime_error("Failed to load synchronization2 functions!");
+        }
+    }
+    if (m_presentWait) {
+        m_vkWaitForPresent = reinterpret_cast<PFN_vkWaitForPresentKHR>(
+            vkGetDeviceProcAddr(m_logicalDevice, "vkWaitForPresentKHR"));
+        if (!m_vkWaitForPresent) {
+            throw std::runtime_error("Failed to load present wait functions!");
+        }
+    }
+}
+
+void VulkanDevice::cmdBeginRendering(VkCommandBuffer commandBuffer, const VkRenderingInfo* renderingInfo) const {
+    m_vkCmdBeginRendering(commandBuffer, renderingInfo);
+}
+
+void VulkanDevice::cmdEndRendering(VkCommandBuffer commandBuffer) const {
+    m_vkCmdEndRendering(commandBuffer);
+}
+
+void VulkanDevice::cmdPipelineBarrier2(VkCommandBuffer commandBuffer, const VkDependencyInfo* dependencyInfo) const {
+    m_vkCmdPipelineBarrier2(commandBuffer, dependencyInfo);
+}
+
+VkResult VulkanDevice::waitForPresent(VkSwapchainKHR swapChain, uint64_t presentId, uint64_t timeout) const {
+    return m_vkWaitForPresent(m_logicalDevice, swapChain, presentId, timeout);
+}
+
+bool VulkanDevice::hasDeviceExtension(VkPhysicalDevice device, const char* extensionName) {
+    uint32_t extensionCount = 0;
+    vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, nullptr);
+    std::vector<VkExtensionProperties> extensions(extensionCount);
+    vkEnumerateDeviceExtensionProperties(device, nullptr, &extensionCount, extensions.data());
+
+    for (const auto& extension : extensions) {
+        if (strcmp(extension.extensionName, extensionName) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
 void VulkanDevice::pickPhysicalDevice() {
     std::cout << "VulkanDevice: Selecting physical device..." << std::endl;
     uint32_t deviceCount = 0;
@@ -113,6 +350,11 @@ bool VulkanDevice::isDeviceSuitable(VkPhysicalDevice device) {
         return false;
     }
 
+    if (!supportsTimelineSemaphores(device)) {
+        std::cout << "VulkanDevice: Device does not support timeline semaphores" << std::endl;
+        return false;
+    }
+
     // Verify surface support capabilities
     VkSurfaceCapabilitiesKHR capabilities;
     if (vkGetPhysicalDeviceSurfaceCapabilitiesKHR(device, surface, &capabilities) != VK_SUCCESS) {
@@ -141,24 +383,50 @@ bool VulkanDevice::isDeviceSuitable(VkPhysicalDevice device) {
     return true;
 }
 
-int VulkanDevice::rateDeviceSuitability(VkPhysicalDevice device) {
-    VkPhysicalDeviceProperties deviceProperties;
-    vkGetPhysicalDeviceProperties(device, &deviceProperties);
-    VkPhysicalDeviceFeatures deviceFeatures;
-    vkGetPhysicalDeviceFeatures(device, &deviceFeatures);
+VkQueue VulkanDevice::getQueue(QueueType type) const {
+    switch (type) {
+        case QueueType::Transfer: return m_transferQueue;
+        case QueueType::Compute: return m_computeQueue;
+        default: return m_graphicsQueue;
+    }
+}
 
-    int score = 0;
+uint32_t VulkanDevice::getQueueFamily(QueueType type) const {
+    if (type == QueueType::Transfer && m_queueFamilies.transferFamily.has_value()) {
+        return m_queueFamilies.transferFamily.value();
+    }
+    if (type == QueueType::Compute && m_queueFamilies.computeFamily.has_value()) {
+        return m_queueFamilies.computeFamily.value();
+    }
+    return m_queueFamilies.graphicsFamily.value();
+}
 
-    if (deviceProperties.deviceType == VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU) {
-        score += 1000;
+TimelineSemaphore* VulkanDevice::getTimeline(QueueType type) const {
+    if (type == QueueType::Transfer && m_transferTimeline) {
+        return m_transferTimeline.get();
     }
-    score += static_cast<int>(deviceProperties.limits.maxImageDimension2D);
+    if (type == QueueType::Compute && m_computeTimeline) {
+        return m_computeTimeline.get();
+    }
+    return m_graphicsTimeline.get();
+}
 
-    if (!deviceFeatures.geometryShader) {
-        return 0;
+bool VulkanDevice::supportsTimelineSemaphores(VkPhysicalDevice device) {
+    VkPhysicalDeviceProperties deviceProperties;
+    vkGetPhysicalDeviceProperties(device, &deviceProperties);
+    if (deviceProperties.apiVersion < VK_API_VERSION_1_2) {
+        return false;
     }
 
-    return score;
+    VkPhysicalDeviceTimelineSemaphoreFeatures timelineFeatures{};
+    timelineFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES;
+
+    VkPhysicalDeviceFeatures2 features2{};
+    features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    features2.pNext = &timelineFeatures;
+    vkGetPhysicalDeviceFeatures2(device, &features2);
+
+    return timelineFeatures.timelineSemaphore == VK_TRUE;
 }
 
 VulkanDevice::QueueFamilyIndices VulkanDevice::findQueueFamilies(VkPhysicalDevice device) {
@@ -172,15 +440,17 @@ VulkanDevice::QueueFamilyIndices VulkanDevice::findQueueFamilies(VkPhysicalDevic
     vkGetPhysicalDeviceQueueFamilyProperties(device, &queueFamilyCount, queueFamilies.data());
 
     std::cout << "VulkanDevice: Examining " << queueFamilyCount << " queue familie(s)" << std::endl;
-    int i = 0;
+    uint32_t i = 0;
     for (const auto& queueFamily : queueFamilies) {
-        if (queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT) {
+        VkQueueFlags flags = queueFamily.queueFlags;
+
+        if ((flags & VK_QUEUE_GRAPHICS_BIT) && !indices.graphicsFamily.has_value()) {
             indices.graphicsFamily = i;
             std::cout << "VulkanDevice: Found graphics queue family at index " << i << std::endl;
         }
 
         VkBool32 presentSupport = false;
-        if (surface != VK_NULL_HANDLE) {
+        if (surface != VK_NULL_HANDLE && !indices.presentFamily.has_value()) {
             vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &presentSupport);
             if (presentSupport) {
                 indices.presentFamily = i;
@@ -188,8 +458,17 @@ VulkanDevice::QueueFamilyIndices VulkanDevice::findQueueFamilies(VkPhysicalDevic
             }
         }
 
-        if (indices.isComplete()) {
-            break;
+        // Transfer-only families are backed by the copy engines
+        if ((flags & VK_QUEUE_TRANSFER_BIT) && !(flags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT)) &&
+            !indices.transferFamily.has_value()) {
+            indices.transferFamily = i;
+            std::cout << "VulkanDevice: Found transfer queue family at index " << i << std::endl;
+        }
+
+        // Compute without graphics can run alongside rendering
+        if ((flags & VK_QUEUE_COMPUTE_BIT) && !(flags & VK_QUEUE_GRAPHICS_BIT) && !indices.computeFamily.has_value()) {
+            indices.computeFamily = i;
+            std::cout << "VulkanDevice: Found async compute queue family at index " << i << std::endl;
         }
         i++;
     }
@@ -218,13 +497,24 @@ VulkanDevice::SwapChainSupportDetails VulkanDevice::querySwapChainSupport(VkPhys
 
     return details;
 }
-VkPresentModeKHR VulkanDevice::chooseSwapPresentMode(const std::vector<VkPresentModeKHR>& availablePresentModes) {
-    for (const auto& mode : availablePresentModes) {
-        if (mode == VK_PRESENT_MODE_MAILBOX_KHR) {
-            return mode; // Mailbox is preferred for low latency
-        }
+VkPresentModeKHR VulkanDevice::chooseSwapPresentMode(const std::vector<VkPresentModeKHR>& availablePresentModes,
+                                                     VkPresentModeKHR preferredMode) {
+    auto isAvailable = [&availablePresentModes](VkPresentModeKHR mode) {
+        return std::find(availablePresentModes.begin(), availablePresentModes.end(), mode) != availablePresentModes.end();
+    };
+
+    if (isAvailable(preferredMode)) {
+        return preferredMode;
+    }
+
+    // Keep the uncapped, non-blocking behaviour if the exact mode is missing
+    if (preferredMode == VK_PRESENT_MODE_IMMEDIATE_KHR && isAvailable(VK_PRESENT_MODE_MAILBOX_KHR)) {
+        return VK_PRESENT_MODE_MAILBOX_KHR;
+    }
+    if (preferredMode == VK_PRESENT_MODE_MAILBOX_KHR && isAvailable(VK_PRESENT_MODE_IMMEDIATE_KHR)) {
+        return VK_PRESENT_MODE_IMMEDIATE_KHR;
     }
-    return VK_PRESENT_MODE_FIFO_KHR; // Fallback to FIFO
+    return VK_PRESENT_MODE_FIFO_KHR; // FIFO is the only mode guaranteed by the spec
 }
 VkSurfaceFormatKHR VulkanDevice::chooseSwapSurfaceFormat(const std::vector<VkSurfaceFormatKHR>& availableFormats) {
     for (const auto& format : availableFormats) {
@@ -1,4 +1,5 @@
 #include "core/VulkanSync.h"
+#include "core/TimelineSemaphore.h"
 #include <stdexcept>
 
 VulkanSync::VulkanSync(VulkanDevice* device, uint32_t maxFramesInFlight, uint32_t imageCount)
@@ -13,20 +14,15 @@ VulkanSync::~VulkanSync() {
 void VulkanSync::createSyncObjects() {
     m_imageAvailableSemaphores.resize(m_maxFramesInFlight);
     m_renderFinishedSemaphores.resize(m_imageCount);  // One per swapchain image
-    m_inFlightFences.resize(m_maxFramesInFlight);
-    m_imagesInFlight.resize(m_imageCount, VK_NULL_HANDLE);  // Initialize with VK_NULL_HANDLE
+    m_frameValues.resize(m_maxFramesInFlight, 0);     // Value 0 is always complete
+    m_imageValues.resize(m_imageCount, 0);
 
     VkSemaphoreCreateInfo semaphoreInfo{};
     semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
 
-    VkFenceCreateInfo fenceInfo{};
-    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-    fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
-
     // Create frame synchronization objects
     for (size_t i = 0; i < m_maxFramesInFlight; i++) {
-        if (vkCreateSemaphore(m_device->getDevice(), &semaphoreInfo, nullptr, &m_imageAvailableSemaphores[i]) != VK_SUCCESS ||
-            vkCreateFence(m_device->getDevice(), &fenceInfo, nullptr, &m_inFlightFences[i]) != VK_SUCCESS) {
+        if (vkCreateSemaphore(m_device->getDevice(), &semaphoreInfo, nullptr, &m_imageAvailableSemaphores[i]) != VK_SUCCESS) {
             throw std::runtime_error("Failed to create frame synchronization objects!");
         }
     }
@@ -42,7 +38,6 @@ void VulkanSync::createSyncObjects() {
 void VulkanSync::cleanup() {
     for (size_t i = 0; i < m_maxFramesInFlight; i++) {
         vkDestroySemaphore(m_device->getDevice(), m_imageAvailableSemaphores[i], nullptr);
-        vkDestroyFence(m_device->getDevice(), m_inFlightFences[i], nullptr);
     }
 
     for (size_t i = 0; i < m_imageCount; i++) {
@@ -50,10 +45,19 @@ void VulkanSync::cleanup() {
     }
 }
 
-void VulkanSync::waitForFence(uint32_t frameIndex) const {
-    vkWaitForFences(m_device->getDevice(), 1, &m_inFlightFences[frameIndex], VK_TRUE, UINT64_MAX);
+void VulkanSync::setSubmittedValue(uint32_t frameIndex, uint32_t imageIndex, uint64_t timelineValue) {
+    m_frameValues[frameIndex] = timelineValue;
+    m_imageValues[imageIndex] = timelineValue;
+}
+
+void VulkanSync::waitForFrame(uint32_t frameIndex) const {
+    m_device->getGraphicsTimeline()->wait(m_frameValues[frameIndex]);
+}
+
+void VulkanSync::waitForImage(uint32_t imageIndex) const {
+    m_device->getGraphicsTimeline()->wait(m_imageValues[imageIndex]);
 }
 
-void VulkanSync::resetFence(uint32_t frameIndex) const {
-    vkResetFences(m_device->getDevice(), 1, &m_inFlightFences[frameIndex]);
+bool VulkanSync::isFrameComplete(uint32_t frameIndex) const {
+    return m_device->getGraphicsTimeline()->isComplete(m_frameValues[frameIndex]);
 }
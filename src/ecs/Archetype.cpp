@@ -0,0 +1,103 @@
+#include "ecs/Archetype.h"
+#include <stdexcept>
+
+namespace {
+size_t alignUp(size_t offset, size_t alignment) {
+    return (offset + alignment - 1) / alignment * alignment;
+}
+}
+
+Archetype::Archetype(ComponentMask mask, const std::array<ComponentInfo, MAX_COMPONENTS>& infos) : m_mask(mask) {
+    for (uint32_t type = 0; type < MAX_COMPONENTS; type++) {
+        if (mask.test(type)) {
+            m_infos[type] = infos[type];
+            m_types.push_back(type);
+        }
+    }
+    computeLayout();
+}
+
+Archetype::~Archetype() {
+    for (uint32_t row = 0; row < m_size; row++) {
+        for (uint32_t type : m_types) {
+            m_infos[type].destroy(getComponent(type, row));
+        }
+    }
+    for (Chunk& chunk : m_chunks) {
+        ::operator delete(chunk.data, std::align_val_t{CHUNK_ALIGNMENT});
+    }
+}
+
+void Archetype::computeLayout() {
+    size_t rowSize = sizeof(EntityID);
+    for (uint32_t type : m_types) {
+        if (m_infos[type].alignment > CHUNK_ALIGNMENT) {
+            throw std::runtime_error("Failed to lay out archetype: component alignment exceeds chunk alignment!");
+        }
+        rowSize += m_infos[type].size;
+    }
+
+    // Start from the padding-free estimate and back off until the aligned
+    // columns fit
+    uint32_t capacity = static_cast<uint32_t>(CHUNK_SIZE / rowSize);
+    while (capacity > 0) {
+        size_t offset = capacity * sizeof(EntityID);
+        for (uint32_t type : m_types) {
+            offset = alignUp(offset, m_infos[type].alignment);
+            m_offsets[type] = offset;
+            offset += capacity * m_infos[type].size;
+        }
+        if (offset <= CHUNK_SIZE) {
+            break;
+        }
+        capacity--;
+    }
+    if (capacity == 0) {
+        throw std::runtime_error("Failed to lay out archetype: components exceed chunk size!");
+    }
+    m_chunkCapacity = capacity;
+}
+
+uint32_t Archetype::add(EntityID entity) {
+    size_t chunkIndex = m_size / m_chunkCapacity;
+    // Chunks emptied by remove() are kept, so refilling does not allocate
+    if (chunkIndex == m_chunks.size()) {
+        Chunk chunk;
+        chunk.data = static_cast<std::byte*>(::operator new(CHUNK_SIZE, std::align_val_t{CHUNK_ALIGNMENT}));
+        m_chunks.push_back(chunk);
+    }
+
+    Chunk& chunk = m_chunks[chunkIndex];
+    entitiesOf(chunk)[chunk.count++] = entity;
+    return m_size++;
+}
+
+EntityID Archetype::remove(uint32_t row) {
+    for (uint32_t type : m_types) {
+        m_infos[type].destroy(getComponent(type, row));
+    }
+
+    uint32_t last = m_size - 1;
+    EntityID moved = INVALID_ENTITY;
+    if (row != last) {
+        for (uint32_t type : m_types) {
+            void* source = getComponent(type, last);
+            m_infos[type].moveConstruct(getComponent(type, row), source);
+            m_infos[type].destroy(source);
+        }
+        moved = getEntity(last);
+        entitiesOf(m_chunks[row / m_chunkCapacity])[row % m_chunkCapacity] = moved;
+    }
+
+    m_chunks[last / m_chunkCapacity].count--;
+    m_size--;
+    return moved;
+}
+
+void Archetype::moveShared(uint32_t row, Archetype& destination, uint32_t dstRow) {
+    for (uint32_t type : m_types) {
+        if (destination.m_mask.test(type)) {
+            m_infos[type].moveConstruct(destination.getComponent(type, dstRow), getComponent(type, row));
+        }
+    }
+}
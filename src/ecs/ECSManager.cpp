@@ -1,64 +1,131 @@
 #include "ecs/ECSManager.h"
 #include <typeindex>
 
+std::atomic<uint32_t> ECSManager::s_nextComponentType{0};
+
 ECSManager::ECSManager() {
-    m_componentManager = std::make_unique<ComponentManager>();
+    // Entities without components still need a row to hold their ID
+    getArchetype(ComponentMask());
 }
 
 EntityID ECSManager::createEntity() {
-    EntityID id;
-    
-    if (!m_availableEntityIDs.empty()) {
-        id = *m_availableEntityIDs.begin();
-        m_availableEntityIDs.erase(m_availableEntityIDs.begin());
-    } else {
-        id = m_nextEntityID++;
+    EntityID id = m_registry.create();
+    if (m_records.size() < m_registry.getIndexCount()) {
+        m_records.resize(m_registry.getIndexCount());
     }
     
-    m_entityMasks[id] = ComponentMask();
+    Archetype* empty = getArchetype(ComponentMask());
+    m_records[entityIndex(id)] = EntityRecord{empty, empty->add(id)};
     return id;
 }
 
 void ECSManager::destroyEntity(EntityID entity) {
-    m_entityMasks.erase(entity);
+    if (!m_registry.isAlive(entity)) {
+        return;
+    }
+    
+    EntityRecord& record = m_records[entityIndex(entity)];
+    EntityID moved = record.archetype->remove(record.row);
+    if (moved != INVALID_ENTITY) {
+        m_records[entityIndex(moved)].row = record.row;
+    }
+    record = EntityRecord{};
+    m_spatialGrid.remove(entity);
+    
+    for (auto const& entry : m_systems) {
+        if (entry.system) {
+            entry.system->m_entities.erase(entity);
+        }
+    }
+    
+    m_registry.destroy(entity);
+}
+
+void ECSManager::setPosition(EntityID entity, const glm::vec3& position) {
+    getComponent<TransformComponent>(entity).position = position;
+    updateSpatialIndex(entity);
+}
+
+void ECSManager::updateSpatialIndex(EntityID entity) {
+    if (!hasComponent<TransformComponent>(entity)) {
+        m_spatialGrid.remove(entity);
+        return;
+    }
     
-    m_componentManager->entityDestroyed(entity);
+    float radius = hasComponent<RenderComponent>(entity) ? getComponent<RenderComponent>(entity).boundingRadius : 0.0f;
+    m_spatialGrid.update(entity, getComponent<TransformComponent>(entity).position, radius);
+}
+
+Archetype* ECSManager::getArchetype(ComponentMask mask) {
+    auto it = m_archetypesByMask.find(mask);
+    if (it != m_archetypesByMask.end()) {
+        return it->second;
+    }
+    
+    for (uint32_t type = 0; type < MAX_COMPONENTS; type++) {
+        if (mask.test(type) && m_componentInfos[type].size == 0) {
+            throw std::runtime_error("Failed to create archetype: component type was never registered!");
+        }
+    }
+    
+    m_archetypes.push_back(std::make_unique<Archetype>(mask, m_componentInfos));
+    Archetype* archetype = m_archetypes.back().get();
+    m_archetypesByMask[mask] = archetype;
+    return archetype;
+}
+
+void ECSManager::moveEntity(EntityID entity, ComponentMask mask) {
+    EntityRecord& record = getRecord(entity);
+    Archetype* source = record.archetype;
+    Archetype* destination = getArchetype(mask);
     
-    for (auto const& pair : m_systems) {
-        auto const& system = pair.second;
-        system->m_entities.erase(entity);
+    uint32_t row = destination->add(entity);
+    source->moveShared(record.row, *destination, row);
+    EntityID moved = source->remove(record.row);
+    if (moved != INVALID_ENTITY) {
+        m_records[entityIndex(moved)].row = record.row;
     }
     
-    m_availableEntityIDs.insert(entity);
+    record.archetype = destination;
+    record.row = row;
 }
 
 std::vector<EntityID> ECSManager::getEntitiesWithComponents(ComponentMask mask) {
     std::vector<EntityID> entities;
     
-    for (auto const& pair : m_entityMasks) {
-        EntityID entity = pair.first;
-        ComponentMask entityMask = pair.second;
+    for (const auto& archetype : m_archetypes) {
+        if ((archetype->getMask() & mask) != mask) continue;
         
-        if ((entityMask & mask) == mask) {
-            entities.push_back(entity);
+        for (size_t chunk = 0; chunk < archetype->getChunkCount(); chunk++) {
+            const EntityID* chunkEntities = archetype->getEntities(chunk);
+            entities.insert(entities.end(), chunkEntities, chunkEntities + archetype->getChunkCount(chunk));
         }
     }
     
     return entities;
 }
 
+ECSManager::SystemEntry& ECSManager::getSystemEntry(std::type_index type) {
+    auto it = m_systemIndices.find(type);
+    if (it != m_systemIndices.end()) {
+        return m_systems[it->second];
+    }
+    
+    m_systemIndices.emplace(type, m_systems.size());
+    m_systems.emplace_back();
+    return m_systems.back();
+}
+
 void ECSManager::updateEntitySystems(EntityID entity) {
-    ComponentMask entityMask = m_entityMasks[entity];
+    ComponentMask entityMask = getRecord(entity).archetype->getMask();
     
-    for (auto const& pair : m_systems) {
-        auto const& type = pair.first;
-        auto const& system = pair.second;
-        auto const& systemSignature = m_signatures[type];
+    for (auto const& entry : m_systems) {
+        if (!entry.system) continue;
         
-        if ((entityMask & systemSignature) == systemSignature) {
-            system->m_entities.insert(entity);
+        if ((entityMask & entry.signature) == entry.signature) {
+            entry.system->m_entities.insert(entity);
         } else {
-            system->m_entities.erase(entity);
+            entry.system->m_entities.erase(entity);
         }
     }
-}
\ No newline at end of file
+}
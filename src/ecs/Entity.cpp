@@ -1,3 +0,0 @@
-#include "ecs/Entity.h"
-
-EntityID Entity::s_nextID = 0;
\ No newline at end of file
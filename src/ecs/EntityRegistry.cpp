@@ -0,0 +1,48 @@
+#include "ecs/EntityRegistry.h"
+#include <stdexcept>
+
+EntityID EntityRegistry::create() {
+    uint32_t index;
+    if (m_freeCount > MIN_FREE_INDICES) {
+        index = m_freeHead;
+        m_freeHead = m_slots[index].nextFree;
+        if (m_freeHead == NONE) {
+            m_freeTail = NONE;
+        }
+        m_freeCount--;
+    } else {
+        // The top index is reserved so no handle equals INVALID_ENTITY
+        if (m_slots.size() >= ENTITY_INDEX_MASK) {
+            throw std::runtime_error("Failed to create entity: out of entity indices!");
+        }
+        index = static_cast<uint32_t>(m_slots.size());
+        m_slots.emplace_back();
+    }
+
+    Slot& slot = m_slots[index];
+    slot.nextFree = NONE;
+    slot.alive = true;
+    EntityID entity = makeEntity(index, slot.generation);
+    m_alive.insert(entity);
+    return entity;
+}
+
+void EntityRegistry::destroy(EntityID entity) {
+    if (!isAlive(entity)) {
+        return;
+    }
+
+    uint32_t index = entityIndex(entity);
+    Slot& slot = m_slots[index];
+    slot.alive = false;
+    slot.generation = (slot.generation + 1) & ENTITY_GENERATION_MASK;
+    m_alive.erase(entity);
+
+    if (m_freeTail == NONE) {
+        m_freeHead = index;
+    } else {
+        m_slots[m_freeTail].nextFree = index;
+    }
+    m_freeTail = index;
+    m_freeCount++;
+}
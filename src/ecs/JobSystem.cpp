@@ -0,0 +1,129 @@
+#include "ecs/JobSystem.h"
+#include <algorithm>
+
+namespace {
+constexpr uint32_t NO_WORKER = UINT32_MAX;
+
+// Which pool worker the current thread is, if any
+thread_local const JobSystem* t_pool = nullptr;
+thread_local uint32_t t_workerIndex = NO_WORKER;
+}
+
+JobSystem::JobSystem(uint32_t workerCount) {
+    if (workerCount == 0) {
+        workerCount = std::max(std::thread::hardware_concurrency(), 2u) - 1;
+    }
+
+    for (uint32_t i = 0; i < workerCount; i++) {
+        m_queues.push_back(std::make_unique<Queue>());
+    }
+    for (uint32_t i = 0; i < workerCount; i++) {
+        m_workers.emplace_back(&JobSystem::workerLoop, this, i);
+    }
+}
+
+JobSystem::~JobSystem() {
+    {
+        std::lock_guard<std::mutex> lock(m_sleepMutex);
+        m_stop = true;
+    }
+    m_wake.notify_all();
+    for (std::thread& worker : m_workers) {
+        worker.join();
+    }
+}
+
+void JobSystem::submit(Job job, Counter& counter) {
+    counter.pending.fetch_add(1);
+
+    uint32_t queue = t_pool == this ? t_workerIndex
+                                    : m_nextQueue.fetch_add(1) % static_cast<uint32_t>(m_queues.size());
+    {
+        std::lock_guard<std::mutex> lock(m_queues[queue]->mutex);
+        m_queues[queue]->tasks.push_back(Task{std::move(job), &counter});
+    }
+    m_queuedTasks.fetch_add(1);
+
+    // Taking the lock orders this against a worker checking m_queuedTasks on its way to sleep
+    {
+        std::lock_guard<std::mutex> lock(m_sleepMutex);
+    }
+    m_wake.notify_one();
+}
+
+void JobSystem::wait(Counter& counter) {
+    uint32_t home = t_pool == this ? t_workerIndex : 0;
+    while (counter.pending.load() > 0) {
+        if (!runOne(home)) {
+            std::this_thread::yield();
+        }
+    }
+}
+
+void JobSystem::parallelFor(uint32_t count, uint32_t grain, const std::function<void(uint32_t, uint32_t)>& func) {
+    if (count == 0) {
+        return;
+    }
+    grain = std::max(grain, 1u);
+    if (count <= grain || m_workers.empty()) {
+        func(0, count);
+        return;
+    }
+
+    Counter counter;
+    for (uint32_t begin = grain; begin < count; begin += grain) {
+        uint32_t end = std::min(count, begin + grain);
+        submit([&func, begin, end]() { func(begin, end); }, counter);
+    }
+    func(0, grain);
+    wait(counter);
+}
+
+bool JobSystem::runOne(uint32_t home) {
+    if (m_queuedTasks.load() == 0) {
+        return false;
+    }
+
+    Task task;
+    bool found = false;
+    uint32_t queueCount = static_cast<uint32_t>(m_queues.size());
+    for (uint32_t i = 0; i < queueCount && !found; i++) {
+        Queue& queue = *m_queues[(home + i) % queueCount];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.tasks.empty()) continue;
+
+        if (i == 0) {
+            task = std::move(queue.tasks.back());
+            queue.tasks.pop_back();
+        } else {
+            task = std::move(queue.tasks.front());
+            queue.tasks.pop_front();
+        }
+        found = true;
+    }
+    if (!found) {
+        return false;
+    }
+
+    m_queuedTasks.fetch_sub(1);
+    task.job();
+    task.counter->pending.fetch_sub(1);
+    return true;
+}
+
+void JobSystem::workerLoop(uint32_t index) {
+    t_pool = this;
+    t_workerIndex = index;
+
+    while (true) {
+        if (runOne(index)) {
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(m_sleepMutex);
+        m_wake.wait(lock, [this]() { return m_stop.load() || m_queuedTasks.load() > 0; });
+        if (m_stop && m_queuedTasks.load() == 0) {
+            return;
+        }
+    }
+}
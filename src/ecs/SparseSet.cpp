@@ -0,0 +1,43 @@
+#include "ecs/SparseSet.h"
+#include <algorithm>
+
+uint32_t& SparseSet::slot(EntityID entity) {
+    uint32_t index = entityIndex(entity);
+    size_t page = index / PAGE_SIZE;
+    if (page >= m_pages.size()) {
+        m_pages.resize(page + 1);
+    }
+    if (!m_pages[page]) {
+        m_pages[page] = std::make_unique<uint32_t[]>(PAGE_SIZE);
+        std::fill_n(m_pages[page].get(), PAGE_SIZE, NONE);
+    }
+    return m_pages[page][index % PAGE_SIZE];
+}
+
+void SparseSet::insert(EntityID entity) {
+    if (contains(entity)) {
+        return;
+    }
+    slot(entity) = static_cast<uint32_t>(m_dense.size());
+    m_dense.push_back(entity);
+}
+
+void SparseSet::erase(EntityID entity) {
+    if (!contains(entity)) {
+        return;
+    }
+
+    uint32_t& position = slot(entity);
+    EntityID last = m_dense.back();
+    m_dense[position] = last;
+    slot(last) = position;
+    position = NONE;
+    m_dense.pop_back();
+}
+
+void SparseSet::clear() {
+    for (EntityID entity : m_dense) {
+        slot(entity) = NONE;
+    }
+    m_dense.clear();
+}
@@ -0,0 +1,230 @@
+#include "ecs/SpatialGrid.h"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace {
+float distanceSquaredToBox(const glm::vec3& point, const glm::vec3& min, const glm::vec3& max) {
+    glm::vec3 nearest = glm::max(min, glm::min(point, max));
+    glm::vec3 offset = point - nearest;
+    return glm::dot(offset, offset);
+}
+
+float farthestDistanceSquaredInBox(const glm::vec3& point, const glm::vec3& min, const glm::vec3& max) {
+    glm::vec3 offset = glm::max(glm::abs(point - min), glm::abs(max - point));
+    return glm::dot(offset, offset);
+}
+}
+
+SpatialGrid::SpatialGrid(float cellSize) : m_cellSize(cellSize), m_inverseCellSize(1.0f / cellSize) {
+    if (cellSize <= 0.0f) {
+        throw std::runtime_error("Failed to create spatial grid: cell size must be positive!");
+    }
+}
+
+glm::ivec2 SpatialGrid::cellCoord(const glm::vec3& position) const {
+    return glm::ivec2(static_cast<int32_t>(std::floor(position.x * m_inverseCellSize)),
+                      static_cast<int32_t>(std::floor(position.z * m_inverseCellSize)));
+}
+
+uint64_t SpatialGrid::cellKey(const glm::ivec2& coord) {
+    return (static_cast<uint64_t>(static_cast<uint32_t>(coord.x)) << 32) | static_cast<uint32_t>(coord.y);
+}
+
+uint32_t SpatialGrid::acquireCell(const glm::ivec2& coord) {
+    uint64_t key = cellKey(coord);
+    auto it = m_cellIndices.find(key);
+    if (it != m_cellIndices.end()) {
+        return it->second;
+    }
+
+    uint32_t index;
+    if (!m_freeCells.empty()) {
+        index = m_freeCells.back();
+        m_freeCells.pop_back();
+    } else {
+        index = static_cast<uint32_t>(m_cells.size());
+        m_cells.emplace_back();
+    }
+    m_cells[index].coord = coord;
+    m_cellIndices.emplace(key, index);
+    return index;
+}
+
+void SpatialGrid::addToCell(uint32_t cellIndex, Item& item) {
+    Cell& cell = m_cells[cellIndex];
+    if (cell.items.empty()) {
+        cell.maxRadius = item.radius;
+        cell.minY = item.position.y;
+        cell.maxY = item.position.y;
+    } else {
+        cell.maxRadius = std::max(cell.maxRadius, item.radius);
+        cell.minY = std::min(cell.minY, item.position.y);
+        cell.maxY = std::max(cell.maxY, item.position.y);
+    }
+
+    item.cell = cellIndex;
+    item.slot = static_cast<uint32_t>(cell.items.size());
+    cell.items.push_back(item.id);
+}
+
+void SpatialGrid::removeFromCell(Item& item) {
+    Cell& cell = m_cells[item.cell];
+    uint32_t last = cell.items.back();
+    cell.items[item.slot] = last;
+    m_items[entityIndex(last)].slot = item.slot;
+    cell.items.pop_back();
+
+    if (cell.items.empty()) {
+        m_cellIndices.erase(cellKey(cell.coord));
+        m_freeCells.push_back(item.cell);
+    }
+    item.cell = NONE;
+}
+
+void SpatialGrid::insert(uint32_t item, const glm::vec3& position, float radius) {
+    uint32_t index = entityIndex(item);
+    if (index >= m_items.size()) {
+        m_items.resize(index + 1);
+    }
+
+    Item& entry = m_items[index];
+    if (entry.cell != NONE) {
+        if (entry.id == item) {
+            update(item, position, radius);
+            return;
+        }
+        // A stale ID that was never removed; the index now belongs to item
+        removeFromCell(entry);
+        m_itemCount--;
+    }
+
+    entry.id = item;
+    entry.position = position;
+    entry.radius = radius;
+    m_maxRadius = std::max(m_maxRadius, radius);
+    addToCell(acquireCell(cellCoord(position)), entry);
+    m_itemCount++;
+}
+
+void SpatialGrid::update(uint32_t item, const glm::vec3& position, float radius) {
+    if (!contains(item)) {
+        insert(item, position, radius);
+        return;
+    }
+
+    Item& entry = m_items[entityIndex(item)];
+    entry.position = position;
+    entry.radius = radius;
+    m_maxRadius = std::max(m_maxRadius, radius);
+
+    glm::ivec2 coord = cellCoord(position);
+    Cell& cell = m_cells[entry.cell];
+    if (cell.coord == coord) {
+        cell.maxRadius = std::max(cell.maxRadius, radius);
+        cell.minY = std::min(cell.minY, position.y);
+        cell.maxY = std::max(cell.maxY, position.y);
+        return;
+    }
+
+    removeFromCell(entry);
+    addToCell(acquireCell(coord), entry);
+}
+
+void SpatialGrid::remove(uint32_t item) {
+    if (!contains(item)) {
+        return;
+    }
+    removeFromCell(m_items[entityIndex(item)]);
+    m_itemCount--;
+}
+
+void SpatialGrid::clear() {
+    for (const auto& entry : m_cellIndices) {
+        Cell& cell = m_cells[entry.second];
+        for (uint32_t item : cell.items) {
+            m_items[entityIndex(item)].cell = NONE;
+        }
+        cell.items.clear();
+        m_freeCells.push_back(entry.second);
+    }
+    m_cellIndices.clear();
+    m_itemCount = 0;
+    m_maxRadius = 0.0f;
+}
+
+void SpatialGrid::cellBounds(const Cell& cell, glm::vec3& min, glm::vec3& max) const {
+    min = glm::vec3(cell.coord.x * m_cellSize - cell.maxRadius, cell.minY - cell.maxRadius,
+                    cell.coord.y * m_cellSize - cell.maxRadius);
+    max = glm::vec3((cell.coord.x + 1) * m_cellSize + cell.maxRadius, cell.maxY + cell.maxRadius,
+                    (cell.coord.y + 1) * m_cellSize + cell.maxRadius);
+}
+
+void SpatialGrid::queryRadius(const glm::vec3& center, float radius, std::vector<uint32_t>& results) const {
+    visitCells(center, radius, [&](const Cell& cell) {
+        glm::vec3 min, max;
+        cellBounds(cell, min, max);
+        if (distanceSquaredToBox(center, min, max) > radius * radius) {
+            return true;
+        }
+
+        for (uint32_t item : cell.items) {
+            const Item& entry = m_items[entityIndex(item)];
+            float reach = radius + entry.radius;
+            glm::vec3 offset = entry.position - center;
+            if (glm::dot(offset, offset) <= reach * reach) {
+                results.push_back(item);
+            }
+        }
+        return true;
+    });
+}
+
+void SpatialGrid::queryOutsideRadius(const glm::vec3& center, float radius, std::vector<uint32_t>& results) const {
+    float radiusSquared = radius * radius;
+
+    // Every occupied cell is a candidate, but whole cells are settled by their
+    // bounds and only the ones straddling the sphere look at each item
+    for (const auto& cellEntry : m_cellIndices) {
+        const Cell& cell = m_cells[cellEntry.second];
+        glm::vec3 min(cell.coord.x * m_cellSize, cell.minY, cell.coord.y * m_cellSize);
+        glm::vec3 max((cell.coord.x + 1) * m_cellSize, cell.maxY, (cell.coord.y + 1) * m_cellSize);
+
+        if (farthestDistanceSquaredInBox(center, min, max) <= radiusSquared) {
+            continue;
+        }
+        if (distanceSquaredToBox(center, min, max) > radiusSquared) {
+            results.insert(results.end(), cell.items.begin(), cell.items.end());
+            continue;
+        }
+
+        for (uint32_t item : cell.items) {
+            glm::vec3 offset = m_items[entityIndex(item)].position - center;
+            if (glm::dot(offset, offset) > radiusSquared) {
+                results.push_back(item);
+            }
+        }
+    }
+}
+
+void SpatialGrid::queryFrustum(const FrustumCuller& frustumCuller, const glm::vec3& center, float radius,
+                               std::vector<uint32_t>& results) const {
+    visitCells(center, radius, [&](const Cell& cell) {
+        glm::vec3 min, max;
+        cellBounds(cell, min, max);
+        if (distanceSquaredToBox(center, min, max) > radius * radius || !frustumCuller.isBoxVisible(min, max)) {
+            return true;
+        }
+
+        for (uint32_t item : cell.items) {
+            const Item& entry = m_items[entityIndex(item)];
+            float reach = radius + entry.radius;
+            glm::vec3 offset = entry.position - center;
+            if (glm::dot(offset, offset) <= reach * reach &&
+                frustumCuller.isVisible(entry.position, entry.radius)) {
+                results.push_back(item);
+            }
+        }
+        return true;
+    });
+}
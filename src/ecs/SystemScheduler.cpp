@@ -0,0 +1,92 @@
+#include "ecs/SystemScheduler.h"
+#include <chrono>
+
+SystemScheduler::SystemScheduler(JobSystem* jobs) : m_jobs(jobs) {
+}
+
+void SystemScheduler::addSystem(const std::string& name, const Access& access, SystemFunc func) {
+    auto node = std::make_unique<Node>();
+    node->name = name;
+    node->access = access;
+    node->func = std::move(func);
+    m_nodes.push_back(std::move(node));
+}
+
+void SystemScheduler::setEnabled(const std::string& name, bool enabled) {
+    for (auto& node : m_nodes) {
+        if (node->name == name) {
+            node->enabled = enabled;
+        }
+    }
+}
+
+bool SystemScheduler::conflicts(const Access& a, const Access& b) {
+    if (a.structural || b.structural) {
+        return true;
+    }
+    return (a.writes & (b.reads | b.writes)).any() || (b.writes & a.reads).any();
+}
+
+void SystemScheduler::buildGraph() {
+    for (auto& node : m_nodes) {
+        node->successors.clear();
+        node->predecessorCount = 0;
+    }
+
+    // Edges only run forward, so the graph is acyclic. Every conflicting pair
+    // gets an edge; the redundant ones cost a decrement each.
+    for (uint32_t later = 0; later < m_nodes.size(); later++) {
+        if (!m_nodes[later]->enabled) continue;
+        for (uint32_t earlier = 0; earlier < later; earlier++) {
+            if (!m_nodes[earlier]->enabled) continue;
+            if (conflicts(m_nodes[earlier]->access, m_nodes[later]->access)) {
+                m_nodes[earlier]->successors.push_back(later);
+                m_nodes[later]->predecessorCount++;
+            }
+        }
+    }
+}
+
+void SystemScheduler::launch(uint32_t index, JobSystem::Counter& counter) {
+    m_jobs->submit([this, index, &counter]() {
+        Node& node = *m_nodes[index];
+        auto start = std::chrono::high_resolution_clock::now();
+        node.func(*m_jobs);
+        node.cpuMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+
+        // Whoever finishes a system's last predecessor starts it
+        for (uint32_t successor : node.successors) {
+            if (m_nodes[successor]->remaining.fetch_sub(1) == 1) {
+                launch(successor, counter);
+            }
+        }
+    }, counter);
+}
+
+void SystemScheduler::run() {
+    buildGraph();
+
+    for (auto& node : m_nodes) {
+        node->remaining = node->predecessorCount;
+        node->cpuMs = 0.0;
+    }
+
+    // Successors are submitted before their predecessor's job returns, so the
+    // counter cannot reach zero while any system is still to come
+    JobSystem::Counter counter;
+    for (uint32_t i = 0; i < m_nodes.size(); i++) {
+        if (m_nodes[i]->enabled && m_nodes[i]->predecessorCount == 0) {
+            launch(i, counter);
+        }
+    }
+    m_jobs->wait(counter);
+
+    m_timings.clear();
+    for (const auto& node : m_nodes) {
+        if (!node->enabled) continue;
+        m_timings.push_back({node->name, node->cpuMs});
+        if (m_timingCallback) {
+            m_timingCallback(node->name, node->cpuMs);
+        }
+    }
+}
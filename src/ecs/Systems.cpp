@@ -3,88 +3,79 @@
 #include <cmath>
 
 // LOD System Implementation
-void LODSystem::update(ECSManager* ecs, const glm::vec3& cameraPos, const FrustumCuller& frustumCuller) {
-    for (EntityID entity : m_entities) {
-        auto& transform = ecs->getComponent<TransformComponent>(entity);
-        auto& render = ecs->getComponent<RenderComponent>(entity);
-        auto& lod = ecs->getComponent<LODComponent>(entity);
-        
-        // Calculate distance to camera
-        float distance = glm::length(transform.position - cameraPos);
-        
-        // Update LOD level
-        lod.updateLOD(distance);
-        
-        // Frustum culling
-        lod.inFrustum = frustumCuller.isVisible(transform.position, render.boundingRadius);
-        
-        // Update render component visibility
-        render.visible = lod.shouldRender();
-    }
+SystemScheduler::Access LODSystem::getAccess(ECSManager* ecs) {
+    SystemScheduler::Access access;
+    access.reads = ecs->getComponentMask<TransformComponent>();
+    access.writes = ecs->getComponentMask<RenderComponent, LODComponent>();
+    return access;
 }
 
-// Entity Generation System Implementation
-float EntityGenerationSystem::hash21(const glm::vec2& p) const {
-    float h = std::fmod(std::sin(p.x * 12.9898f + p.y * 78.233f) * 43758.5453f, 1.0f);
-    return h < 0.0f ? h + 1.0f : h;
-}
-
-float EntityGenerationSystem::noise2D(const glm::vec2& p) const {
-    glm::vec2 i = glm::floor(p);
-    glm::vec2 f = p - i;
+void LODSystem::update(ECSManager* ecs, const glm::vec3& cameraPos, const FrustumCuller& frustumCuller,
+                       float viewDistance, JobSystem& jobs) {
+    // Everything shown last frame starts hidden; whatever the grid finds in
+    // view below is shown again, and nothing else needs visiting
+    for (EntityID entity : m_inView) {
+        if (!m_entities.contains(entity)) continue; // Destroyed since
+        ecs->getComponent<RenderComponent>(entity).visible = false;
+        ecs->getComponent<LODComponent>(entity).inFrustum = false;
+    }
     
-    // Smooth interpolation
-    f = f * f * (3.0f - 2.0f * f);
+    // Beyond the last LOD distance nothing renders, so the view is searched no farther
+    m_candidates.clear();
+    float searchRadius = std::min(viewDistance, LODComponent::LOD_DISTANCES[3]);
+    ecs->getSpatialGrid().queryFrustum(frustumCuller, cameraPos, searchRadius, m_candidates);
     
-    float a = hash21(i);
-    float b = hash21(i + glm::vec2(1.0f, 0.0f));
-    float c = hash21(i + glm::vec2(0.0f, 1.0f));
-    float d = hash21(i + glm::vec2(1.0f, 1.0f));
+    jobs.parallelFor(static_cast<uint32_t>(m_candidates.size()), PARALLEL_GRAIN, [&](uint32_t begin, uint32_t end) {
+        for (uint32_t i = begin; i < end; i++) {
+            EntityID entity = m_candidates[i];
+            if (!m_entities.contains(entity)) continue;
+            
+            auto& transform = ecs->getComponent<TransformComponent>(entity);
+            auto& render = ecs->getComponent<RenderComponent>(entity);
+            auto& lod = ecs->getComponent<LODComponent>(entity);
+            
+            // Calculate distance to camera
+            float distance = glm::length(transform.position - cameraPos);
+            
+            // Update LOD level
+            lod.updateLOD(distance);
+            
+            // Frustum culling
+            lod.inFrustum = frustumCuller.isVisible(transform.position, render.boundingRadius);
+            
+            // Update render component visibility
+            render.visible = lod.shouldRender();
+        }
+    });
     
-    return glm::mix(glm::mix(a, b, f.x), glm::mix(c, d, f.x), f.y);
+    m_inView.swap(m_candidates);
 }
 
-float EntityGenerationSystem::getTerrainHeight(const glm::vec2& pos) const {
-    float height = 0.0f;
-    
-    // Large mountain ranges
-    height += std::sin(pos.x * 0.008f) * 12.0f + std::cos(pos.y * 0.01f) * 10.0f;
-    
-    // Rolling hills
-    height += std::sin(pos.x * 0.02f + pos.y * 0.015f) * 6.0f;
-    height += std::cos(pos.x * 0.025f) * std::cos(pos.y * 0.03f) * 4.0f;
-    
-    // Fine detail
-    height += noise2D(pos * 0.05f) * 3.0f;
-    height += noise2D(pos * 0.1f) * 1.5f;
-    
-    // Create river valleys
-    float river1 = std::abs(std::sin(pos.x * 0.005f + std::cos(pos.y * 0.003f) * 2.0f));
-    float river2 = std::abs(std::sin(pos.y * 0.004f + std::cos(pos.x * 0.006f) * 1.5f));
-    height -= glm::smoothstep(0.0f, 0.3f, 1.0f - river1) * 8.0f;
-    height -= glm::smoothstep(0.0f, 0.2f, 1.0f - river2) * 6.0f;
-    
-    return height;
+// Entity Generation System Implementation
+// Placement hashes are NoiseTable lattice values, offset per entity type so
+// the types do not pick the same cells
+SystemScheduler::Access EntityGenerationSystem::getAccess(ECSManager* ecs) {
+    SystemScheduler::Access access;
+    access.reads = ecs->getComponentMask<TransformComponent>();
+    access.structural = true;
+    return access;
 }
 
-bool EntityGenerationSystem::isValidTreePosition(const glm::vec2& pos) const {
-    glm::vec2 gridPos = glm::floor(pos / 12.0f);
-    float h = hash21(gridPos);
-    float terrainHeight = getTerrainHeight(pos);
+bool EntityGenerationSystem::isValidTreePosition(const glm::vec2& pos, float terrainHeight) const {
+    glm::ivec2 cell = glm::ivec2(glm::floor(pos / 12.0f));
+    float h = NoiseTable::lattice(cell.x, cell.y);
     return h > 0.7f && terrainHeight > 1.0f && terrainHeight < 15.0f;
 }
 
-bool EntityGenerationSystem::isValidRockPosition(const glm::vec2& pos) const {
-    glm::vec2 gridPos = glm::floor(pos / 10.0f);
-    float h = hash21(gridPos * 1.7f);
-    float terrainHeight = getTerrainHeight(pos);
+bool EntityGenerationSystem::isValidRockPosition(const glm::vec2& pos, float terrainHeight) const {
+    glm::ivec2 cell = glm::ivec2(glm::floor(pos / 10.0f));
+    float h = NoiseTable::lattice(cell.x + 71, cell.y + 29);
     return h > 0.85f && terrainHeight > 5.0f;
 }
 
-bool EntityGenerationSystem::isValidHousePosition(const glm::vec2& pos) const {
-    glm::vec2 gridPos = glm::floor(pos / 20.0f);
-    float h = hash21(gridPos * 2.7f);
-    float terrainHeight = getTerrainHeight(pos);
+bool EntityGenerationSystem::isValidHousePosition(const glm::vec2& pos, float terrainHeight) const {
+    glm::ivec2 cell = glm::ivec2(glm::floor(pos / 20.0f));
+    float h = NoiseTable::lattice(cell.x + 137, cell.y + 193);
     return h > 0.95f && terrainHeight > -1.0f && terrainHeight < 10.0f;
 }
 
@@ -100,121 +91,180 @@ void EntityGenerationSystem::generateEntitiesAroundCamera(ECSManager* ecs, const
     
     int gridSize = static_cast<int>(radius / 12.0f);
     
+    // Gather the candidate positions first, so the terrain is evaluated once per
+    // candidate in a single batch
+    std::vector<float> candidateX;
+    std::vector<float> candidateZ;
     for (int x = -gridSize; x <= gridSize; x++) {
         for (int z = -gridSize; z <= gridSize; z++) {
             glm::vec3 gridPos = cameraPos + glm::vec3(x * 12.0f, 0.0f, z * 12.0f);
             
             // Add randomness
-            gridPos.x += (hash21(glm::vec2(x, z)) - 0.5f) * 8.0f;
-            gridPos.z += (hash21(glm::vec2(x + 100, z + 100)) - 0.5f) * 8.0f;
+            gridPos.x += (NoiseTable::lattice(x, z) - 0.5f) * 8.0f;
+            gridPos.z += (NoiseTable::lattice(x + 100, z + 100) - 0.5f) * 8.0f;
             
             float distanceFromCamera = glm::length(gridPos - cameraPos);
             if (distanceFromCamera > radius) continue;
             
-            // Generate trees
-            if (isValidTreePosition(glm::vec2(gridPos.x, gridPos.z))) {
-                EntityID entity = ecs->createEntity();
-                
-                gridPos.y = getTerrainHeight(glm::vec2(gridPos.x, gridPos.z));
-                
-                ecs->addComponent(entity, TransformComponent(gridPos));
-                ecs->addComponent(entity, RenderComponent(RenderComponent::EntityType::TREE, 3.0f));
-                ecs->addComponent(entity, LODComponent());
-                ecs->addComponent(entity, TreeComponent());
-            }
-            
-            // Generate rocks
-            if (isValidRockPosition(glm::vec2(gridPos.x, gridPos.z))) {
-                EntityID entity = ecs->createEntity();
-                
-                gridPos.y = getTerrainHeight(glm::vec2(gridPos.x, gridPos.z));
-                
-                ecs->addComponent(entity, TransformComponent(gridPos));
-                ecs->addComponent(entity, RenderComponent(RenderComponent::EntityType::ROCK, 2.0f));
-                ecs->addComponent(entity, LODComponent());
-                ecs->addComponent(entity, RockComponent());
-            }
-            
-            // Generate houses (less frequent)
-            if (isValidHousePosition(glm::vec2(gridPos.x, gridPos.z))) {
-                EntityID entity = ecs->createEntity();
-                
-                gridPos.y = getTerrainHeight(glm::vec2(gridPos.x, gridPos.z));
-                
-                ecs->addComponent(entity, TransformComponent(gridPos));
-                ecs->addComponent(entity, RenderComponent(RenderComponent::EntityType::HOUSE, 5.0f));
-                ecs->addComponent(entity, LODComponent());
-                ecs->addComponent(entity, HouseComponent());
-            }
+            candidateX.push_back(gridPos.x);
+            candidateZ.push_back(gridPos.z);
         }
     }
-}
-
-void EntityGenerationSystem::cleanupDistantEntities(ECSManager* ecs, const glm::vec3& cameraPos, float maxDistance) {
-    std::vector<EntityID> toDestroy;
     
-    for (EntityID entity : m_entities) {
-        auto& transform = ecs->getComponent<TransformComponent>(entity);
-        float distance = glm::length(transform.position - cameraPos);
+    std::vector<float> heights(candidateX.size());
+    TerrainFunction::heights(candidateX.data(), candidateZ.data(), heights.data(), heights.size(),
+                             m_terrainParameters);
+    
+    // Placements are checked against the entities of earlier passes only, all
+    // before any is created, so a pass over fresh ground spawns exactly what
+    // the candidates ask for and only a regenerated overlap is skipped
+    m_pending.clear();
+    for (size_t i = 0; i < heights.size(); i++) {
+        glm::vec2 pos(candidateX[i], candidateZ[i]);
+        glm::vec3 position(pos.x, heights[i], pos.y);
+        
+        // Generate trees
+        if (isValidTreePosition(pos, heights[i])) {
+            queueSpawn(ecs, position, RenderComponent::EntityType::TREE, 3.0f);
+        }
+        
+        // Generate rocks
+        if (isValidRockPosition(pos, heights[i])) {
+            queueSpawn(ecs, position, RenderComponent::EntityType::ROCK, 2.0f);
+        }
         
-        if (distance > maxDistance) {
-            toDestroy.push_back(entity);
+        // Generate houses (less frequent)
+        if (isValidHousePosition(pos, heights[i])) {
+            queueSpawn(ecs, position, RenderComponent::EntityType::HOUSE, 5.0f);
+        }
+    }
+    
+    for (const PendingSpawn& pending : m_pending) {
+        switch (pending.type) {
+            case RenderComponent::EntityType::TREE:
+                spawn(ecs, pending, TreeComponent());
+                break;
+            case RenderComponent::EntityType::ROCK:
+                spawn(ecs, pending, RockComponent());
+                break;
+            case RenderComponent::EntityType::HOUSE:
+                spawn(ecs, pending, HouseComponent());
+                break;
         }
     }
+}
+
+void EntityGenerationSystem::queueSpawn(ECSManager* ecs, const glm::vec3& position, RenderComponent::EntityType type,
+                                        float boundingRadius) {
+    // Regenerating around a camera that moved overlaps the previous area, so
+    // anything already standing there wins
+    if (ecs->getSpatialGrid().anyWithin(position, boundingRadius)) {
+        return;
+    }
+    m_pending.push_back({position, type, boundingRadius});
+}
+
+template<typename Specific>
+void EntityGenerationSystem::spawn(ECSManager* ecs, const PendingSpawn& pending, Specific specific) {
+    // Hidden until the LOD system finds it in view
+    RenderComponent render(pending.type, pending.boundingRadius);
+    render.visible = false;
     
-    for (EntityID entity : toDestroy) {
-        ecs->destroyEntity(entity);
+    EntityID entity = ecs->createEntity();
+    ecs->addComponent(entity, TransformComponent(pending.position));
+    ecs->addComponent(entity, render);
+    ecs->addComponent(entity, LODComponent());
+    ecs->addComponent(entity, std::move(specific));
+}
+
+void EntityGenerationSystem::cleanupDistantEntities(ECSManager* ecs, const glm::vec3& cameraPos, float maxDistance) {
+    // Whole cells inside the radius are skipped without looking at their entities
+    m_toDestroy.clear();
+    ecs->getSpatialGrid().queryOutsideRadius(cameraPos, maxDistance, m_toDestroy);
+    
+    for (EntityID entity : m_toDestroy) {
+        if (m_entities.contains(entity)) {
+            ecs->destroyEntity(entity);
+        }
     }
 }
 
 // Render System Implementation
-std::vector<RenderSystem::RenderData> RenderSystem::getRenderList(ECSManager* ecs) {
-    std::vector<RenderData> renderList;
+namespace {
+RenderSystem::RenderData makeRenderData(const TransformComponent& transform, const RenderComponent& render,
+                                        const LODComponent& lod) {
+    RenderSystem::RenderData data;
+    data.position = transform.position;
+    data.rotation = transform.rotation;
+    data.scale = transform.scale;
+    data.type = render.type;
+    data.lodLevel = lod.currentLOD;
+    return data;
+}
+}
+
+SystemScheduler::Access RenderSystem::getAccess(ECSManager* ecs) {
+    SystemScheduler::Access access;
+    access.reads = ecs->getComponentMask<TransformComponent, RenderComponent, LODComponent, TreeComponent,
+                                         RockComponent, HouseComponent>();
+    return access;
+}
+
+template<typename Specific, typename Fill>
+void RenderSystem::collect(ECSManager* ecs, JobSystem& jobs, Fill fill) {
+    m_chunks.clear();
+    ecs->queryChunks<TransformComponent, RenderComponent, LODComponent, Specific>(m_chunks);
+    if (m_chunkLists.size() < m_chunks.size()) {
+        m_chunkLists.resize(m_chunks.size());
+    }
     
-    for (EntityID entity : m_entities) {
-        auto& render = ecs->getComponent<RenderComponent>(entity);
-        if (!render.visible) continue;
-        
-        auto& transform = ecs->getComponent<TransformComponent>(entity);
-        auto& lod = ecs->getComponent<LODComponent>(entity);
-        
-        RenderData data;
-        data.position = transform.position;
-        data.rotation = transform.rotation;
-        data.scale = transform.scale;
-        data.type = render.type;
-        data.lodLevel = lod.currentLOD;
-        
-        // Fill type-specific data
-        switch (render.type) {
-            case RenderComponent::EntityType::TREE: {
-                auto& tree = ecs->getComponent<TreeComponent>(entity);
-                data.tree.trunkHeight = tree.trunkHeight;
-                data.tree.trunkRadius = tree.trunkRadius;
-                data.tree.foliageRadius = tree.foliageRadius;
-                break;
-            }
-            case RenderComponent::EntityType::ROCK: {
-                auto& rock = ecs->getComponent<RockComponent>(entity);
-                data.rock.dimensions = rock.dimensions;
-                break;
-            }
-            case RenderComponent::EntityType::HOUSE: {
-                auto& house = ecs->getComponent<HouseComponent>(entity);
-                data.house.wallHeight = house.wallHeight;
-                data.house.roofHeight = house.roofHeight;
-                data.house.dimensions = house.dimensions;
-                break;
-            }
+    jobs.parallelFor(static_cast<uint32_t>(m_chunks.size()), 1, [&](uint32_t begin, uint32_t end) {
+        for (uint32_t i = begin; i < end; i++) {
+            std::vector<RenderData>& list = m_chunkLists[i];
+            list.clear();
+            ecs->forEachInChunk<TransformComponent, RenderComponent, LODComponent, Specific>(m_chunks[i],
+                [&](EntityID, TransformComponent& transform, RenderComponent& render, LODComponent& lod,
+                    Specific& specific) {
+                    if (!render.visible) return;
+                    
+                    RenderData data = makeRenderData(transform, render, lod);
+                    fill(data, specific);
+                    list.push_back(data);
+                });
         }
-        
-        renderList.push_back(data);
+    });
+    
+    // Chunk order, so the list comes out the same every run
+    for (size_t i = 0; i < m_chunks.size(); i++) {
+        m_renderList.insert(m_renderList.end(), m_chunkLists[i].begin(), m_chunkLists[i].end());
     }
+}
+
+const std::vector<RenderSystem::RenderData>& RenderSystem::getRenderList(ECSManager* ecs, JobSystem& jobs) {
+    m_renderList.clear();
     
-    return renderList;
+    // One pass per entity type, so the type-specific component comes from the
+    // same chunk as the rest instead of a lookup per entity
+    collect<TreeComponent>(ecs, jobs, [](RenderData& data, const TreeComponent& tree) {
+        data.tree.trunkHeight = tree.trunkHeight;
+        data.tree.trunkRadius = tree.trunkRadius;
+        data.tree.foliageRadius = tree.foliageRadius;
+    });
+    
+    collect<RockComponent>(ecs, jobs, [](RenderData& data, const RockComponent& rock) {
+        data.rock.dimensions = rock.dimensions;
+    });
+    
+    collect<HouseComponent>(ecs, jobs, [](RenderData& data, const HouseComponent& house) {
+        data.house.wallHeight = house.wallHeight;
+        data.house.roofHeight = house.roofHeight;
+        data.house.dimensions = house.dimensions;
+    });
+    
+    return m_renderList;
 }
 
 void RenderSystem::updateVisibility(ECSManager* ecs) {
     // This is now handled by the LOD system
     // Keep this method for future visibility optimizations
-}
\ No newline at end of file
+}
@@ -0,0 +1,397 @@
+#include "rendering/CascadedShadowMaps.h"
+#include "core/CommandContext.h"
+#include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+namespace {
+// Blend between uniform (0) and logarithmic (1) split distances
+constexpr float SPLIT_LAMBDA = 0.8f;
+// Maps are rendered for a region this much larger than the slice needs, so
+// small camera moves stay inside the cached region
+constexpr float CACHE_MARGIN = 1.25f;
+// Light direction changes smaller than this (cosine) keep the cached maps
+constexpr float LIGHT_EPSILON_COS = 0.99999f;
+}
+
+CascadedShadowMaps::CascadedShadowMaps(VulkanDevice* device) : m_device(device) {
+    createImages();
+    createSampler();
+    createDescriptors();
+    std::cout << "CascadedShadowMaps: " << CASCADE_COUNT << " cascades at " << MAP_SIZE << "x" << MAP_SIZE << std::endl;
+}
+
+CascadedShadowMaps::~CascadedShadowMaps() {
+    VkDevice device = m_device->getDevice();
+    for (auto& cascade : m_cascades) {
+        if (cascade.view != VK_NULL_HANDLE) vkDestroyImageView(device, cascade.view, nullptr);
+        if (cascade.image != VK_NULL_HANDLE) vkDestroyImage(device, cascade.image, nullptr);
+        if (cascade.memory != VK_NULL_HANDLE) vkFreeMemory(device, cascade.memory, nullptr);
+    }
+    if (m_sampler != VK_NULL_HANDLE) {
+        vkDestroySampler(device, m_sampler, nullptr);
+    }
+    if (m_uniformBuffer != VK_NULL_HANDLE) {
+        vkUnmapMemory(device, m_uniformMemory);
+        vkDestroyBuffer(device, m_uniformBuffer, nullptr);
+        vkFreeMemory(device, m_uniformMemory, nullptr);
+    }
+    if (m_descriptorPool != VK_NULL_HANDLE) {
+        vkDestroyDescriptorPool(device, m_descriptorPool, nullptr);
+    }
+    if (m_descriptorSetLayout != VK_NULL_HANDLE) {
+        vkDestroyDescriptorSetLayout(device, m_descriptorSetLayout, nullptr);
+    }
+}
+
+void CascadedShadowMaps::createImages() {
+    VkDevice device = m_device->getDevice();
+    for (auto& cascade : m_cascades) {
+        VkImageCreateInfo imageInfo{};
+        imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        imageInfo.imageType = VK_IMAGE_TYPE_2D;
+        imageInfo.extent = {MAP_SIZE, MAP_SIZE, 1};
+        imageInfo.mipLevels = 1;
+        imageInfo.arrayLayers = 1;
+        imageInfo.format = FORMAT;
+        imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+        imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        imageInfo.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT |
+                          VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+        imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+        imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+        if (vkCreateImage(device, &imageInfo, nullptr, &cascade.image) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to create shadow map image!");
+        }
+
+        VkMemoryRequirements memRequirements;
+        vkGetImageMemoryRequirements(device, cascade.image, &memRequirements);
+
+        VkMemoryAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        allocInfo.allocationSize = memRequirements.size;
+        allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+        if (vkAllocateMemory(device, &allocInfo, nullptr, &cascade.memory) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to allocate shadow map memory!");
+        }
+        vkBindImageMemory(device, cascade.image, cascade.memory, 0);
+
+        VkImageViewCreateInfo viewInfo{};
+        viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        viewInfo.image = cascade.image;
+        viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        viewInfo.format = FORMAT;
+        viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
+        viewInfo.subresourceRange.baseMipLevel = 0;
+        viewInfo.subresourceRange.levelCount = 1;
+        viewInfo.subresourceRange.baseArrayLayer = 0;
+        viewInfo.subresourceRange.layerCount = 1;
+
+        if (vkCreateImageView(device, &viewInfo, nullptr, &cascade.view) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to create shadow map image view!");
+        }
+    }
+
+    // The forward shader statically uses every cascade, so maps that have never been
+    // rendered must still be readable: clear them to the far plane (fully lit)
+    CommandContext context(m_device, VulkanDevice::QueueType::Graphics);
+    VkCommandBuffer commandBuffer = context.begin();
+
+    VkImageSubresourceRange range{VK_IMAGE_ASPECT_DEPTH_BIT, 0, 1, 0, 1};
+    VkClearDepthStencilValue clearValue{1.0f, 0};
+    for (auto& cascade : m_cascades) {
+        VkImageMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.image = cascade.image;
+        barrier.subresourceRange = range;
+        barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrier.srcAccessMask = 0;
+        barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                             0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+        vkCmdClearDepthStencilImage(commandBuffer, cascade.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                                    &clearValue, 1, &range);
+
+        barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                             0, 0, nullptr, 0, nullptr, 1, &barrier);
+    }
+    context.submitAndWait(commandBuffer);
+}
+
+void CascadedShadowMaps::createSampler() {
+    // Hardware depth comparison with bilinear filtering gives 2x2 PCF per tap
+    VkSamplerCreateInfo samplerInfo{};
+    samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    samplerInfo.magFilter = VK_FILTER_LINEAR;
+    samplerInfo.minFilter = VK_FILTER_LINEAR;
+    samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+    samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_BORDER;
+    samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_BORDER;
+    samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_BORDER;
+    samplerInfo.borderColor = VK_BORDER_COLOR_FLOAT_OPAQUE_WHITE; // Outside the map counts as lit
+    samplerInfo.compareEnable = VK_TRUE;
+    samplerInfo.compareOp = VK_COMPARE_OP_LESS_OR_EQUAL;
+    samplerInfo.minLod = 0.0f;
+    samplerInfo.maxLod = 0.0f;
+
+    if (vkCreateSampler(m_device->getDevice(), &samplerInfo, nullptr, &m_sampler) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create shadow map sampler!");
+    }
+}
+
+void CascadedShadowMaps::createDescriptors() {
+    VkDevice device = m_device->getDevice();
+
+    std::array<VkDescriptorSetLayoutBinding, 2> bindings{};
+    bindings[0].binding = 0;
+    bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+    bindings[0].descriptorCount = 1;
+    bindings[0].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+    bindings[1].binding = 1;
+    bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    bindings[1].descriptorCount = CASCADE_COUNT;
+    bindings[1].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+    layoutInfo.pBindings = bindings.data();
+
+    if (vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &m_descriptorSetLayout) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create shadow descriptor set layout!");
+    }
+
+    std::array<VkDescriptorPoolSize, 2> poolSizes{};
+    poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+    poolSizes[0].descriptorCount = 1;
+    poolSizes[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    poolSizes[1].descriptorCount = CASCADE_COUNT;
+
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+    poolInfo.pPoolSizes = poolSizes.data();
+    poolInfo.maxSets = 1;
+
+    if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &m_descriptorPool) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create shadow descriptor pool!");
+    }
+
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = m_descriptorPool;
+    allocInfo.descriptorSetCount = 1;
+    allocInfo.pSetLayouts = &m_descriptorSetLayout;
+
+    if (vkAllocateDescriptorSets(device, &allocInfo, &m_descriptorSet) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to allocate shadow descriptor set!");
+    }
+
+    // Uniform ring, persistently mapped
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(m_device->getPhysicalDevice(), &properties);
+    VkDeviceSize alignment = std::max<VkDeviceSize>(properties.limits.minUniformBufferOffsetAlignment, 1);
+    m_slotSize = (sizeof(ShadowData) + alignment - 1) / alignment * alignment;
+
+    VkBufferCreateInfo bufferInfo{};
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size = m_slotSize * RING_SLOTS;
+    bufferInfo.usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT;
+    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    if (vkCreateBuffer(device, &bufferInfo, nullptr, &m_uniformBuffer) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create shadow uniform buffer!");
+    }
+
+    VkMemoryRequirements memRequirements;
+    vkGetBufferMemoryRequirements(device, m_uniformBuffer, &memRequirements);
+
+    VkMemoryAllocateInfo memoryInfo{};
+    memoryInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    memoryInfo.allocationSize = memRequirements.size;
+    memoryInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+    if (vkAllocateMemory(device, &memoryInfo, nullptr, &m_uniformMemory) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to allocate shadow uniform buffer memory!");
+    }
+    vkBindBufferMemory(device, m_uniformBuffer, m_uniformMemory, 0);
+    vkMapMemory(device, m_uniformMemory, 0, bufferInfo.size, 0, &m_uniformMapped);
+
+    VkDescriptorBufferInfo uniformInfo{};
+    uniformInfo.buffer = m_uniformBuffer;
+    uniformInfo.offset = 0;
+    uniformInfo.range = sizeof(ShadowData);
+
+    std::array<VkDescriptorImageInfo, CASCADE_COUNT> imageInfos{};
+    for (uint32_t i = 0; i < CASCADE_COUNT; i++) {
+        imageInfos[i].sampler = m_sampler;
+        imageInfos[i].imageView = m_cascades[i].view;
+        imageInfos[i].imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    }
+
+    std::array<VkWriteDescriptorSet, 2> writes{};
+    writes[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    writes[0].dstSet = m_descriptorSet;
+    writes[0].dstBinding = 0;
+    writes[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+    writes[0].descriptorCount = 1;
+    writes[0].pBufferInfo = &uniformInfo;
+    writes[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    writes[1].dstSet = m_descriptorSet;
+    writes[1].dstBinding = 1;
+    writes[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    writes[1].descriptorCount = CASCADE_COUNT;
+    writes[1].pImageInfo = imageInfos.data();
+
+    vkUpdateDescriptorSets(device, static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+}
+
+void CascadedShadowMaps::update(const glm::mat4& view, const glm::mat4& projection, float nearPlane, float farPlane,
+                                const glm::vec3& lightDirection, const glm::vec3& sceneCenter, float sceneRadius,
+                                uint32_t sceneGeneration, int quality) {
+    m_stats.renderedThisFrame = 0;
+    glm::vec3 lightDir = glm::normalize(lightDirection);
+
+    // Anything the maps' contents depend on, other than their region
+    bool lightChanged = glm::dot(lightDir, m_lightDirection) < LIGHT_EPSILON_COS;
+    if (lightChanged || sceneGeneration != m_sceneGeneration || (quality != Off) != (m_quality != Off)) {
+        for (auto& cascade : m_cascades) {
+            cascade.valid = false;
+        }
+    }
+    m_lightDirection = lightDir;
+    m_sceneGeneration = sceneGeneration;
+    m_quality = quality;
+    m_activeCascades = 0;
+
+    if (quality != Off) {
+        glm::mat4 invView = glm::inverse(view);
+        float invP00 = 1.0f / projection[0][0];
+        float invP11 = 1.0f / projection[1][1];
+
+        float sliceNear = nearPlane;
+        for (uint32_t i = 0; i < CASCADE_COUNT; i++) {
+            // Practical split scheme
+            float p = static_cast<float>(i + 1) / CASCADE_COUNT;
+            float logSplit = nearPlane * std::pow(farPlane / nearPlane, p);
+            float uniformSplit = nearPlane + (farPlane - nearPlane) * p;
+            float sliceFar = uniformSplit + (logSplit - uniformSplit) * SPLIT_LAMBDA;
+
+            // Bounding sphere of the slice's corners, rounded so it only changes in steps
+            glm::vec3 corners[8];
+            glm::vec3 center(0.0f);
+            for (int c = 0; c < 8; c++) {
+                float depth = (c & 4) ? sliceFar : sliceNear;
+                glm::vec2 ndc((c & 1) ? 1.0f : -1.0f, (c & 2) ? 1.0f : -1.0f);
+                corners[c] = glm::vec3(invView * glm::vec4(ndc.x * invP00 * depth, ndc.y * invP11 * depth, -depth, 1.0f));
+                center += corners[c] / 8.0f;
+            }
+            float radius = 0.0f;
+            for (const auto& corner : corners) {
+                radius = std::max(radius, glm::length(corner - center));
+            }
+            radius = std::ceil(radius * 16.0f) / 16.0f;
+
+            // Once a slice holds the whole model, this cascade covers everything that
+            // casts or receives, and later cascades would only repeat it
+            bool coversScene = glm::length(center - sceneCenter) + sceneRadius <= radius;
+            if (coversScene) {
+                center = sceneCenter;
+                radius = sceneRadius;
+            }
+
+            Cascade& cascade = m_cascades[i];
+            bool cached = cascade.valid && glm::length(center - cascade.center) + radius <= cascade.radius &&
+                          radius * CACHE_MARGIN * 2.0f >= cascade.radius; // Don't keep a map that's gotten too coarse
+            if (!cached) {
+                cascade.center = center;
+                cascade.radius = coversScene ? radius : radius * CACHE_MARGIN;
+                cascade.viewProj = fitLightMatrix(cascade.center, cascade.radius, lightDir, sceneCenter, sceneRadius);
+                cascade.valid = true;
+                cascade.dirty = true;
+            }
+
+            m_data.lightViewProj[i] = cascade.viewProj;
+            m_data.splitDepths[i] = coversScene ? farPlane : sliceFar;
+            m_data.texelWorldSize[i] = 2.0f * cascade.radius / MAP_SIZE;
+            m_activeCascades = i + 1;
+            sliceNear = sliceFar;
+
+            if (coversScene) {
+                break;
+            }
+        }
+    }
+
+    for (uint32_t i = m_activeCascades; i < CASCADE_COUNT; i++) {
+        m_cascades[i].dirty = false;
+        m_data.splitDepths[i] = farPlane;
+    }
+    m_data.params = glm::vec4(static_cast<float>(quality), static_cast<float>(m_activeCascades), 1.0f / MAP_SIZE, 0.0f);
+    m_stats.activeCascades = m_activeCascades;
+
+    // Splits follow the camera every frame; a fresh slot keeps in-flight frames' data intact
+    m_slot = (m_slot + 1) % RING_SLOTS;
+    memcpy(static_cast<char*>(m_uniformMapped) + m_slot * m_slotSize, &m_data, sizeof(ShadowData));
+}
+
+void CascadedShadowMaps::markRendered(uint32_t cascade) {
+    m_cascades[cascade].dirty = false;
+    m_stats.renderedThisFrame++;
+    m_stats.totalRenders++;
+}
+
+glm::mat4 CascadedShadowMaps::fitLightMatrix(const glm::vec3& center, float radius, const glm::vec3& lightDirection,
+                                             const glm::vec3& sceneCenter, float sceneRadius) const {
+    glm::vec3 up = std::abs(lightDirection.y) > 0.99f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+    glm::vec3 eye = center - lightDirection * radius;
+    glm::mat4 lightView = glm::lookAt(eye, center, up);
+
+    // Depth range spans the whole model so casters outside the region still land in the map
+    float sceneDepth = glm::dot(sceneCenter - eye, lightDirection);
+    float zNear = std::min(0.0f, sceneDepth - sceneRadius);
+    float zFar = std::max(2.0f * radius, sceneDepth + sceneRadius);
+    glm::mat4 lightProj = glm::orthoRH_ZO(-radius, radius, -radius, radius, zNear, zFar);
+
+    // Snap to whole texels so re-fits don't make edges crawl
+    glm::vec4 origin = lightProj * lightView * glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+    glm::vec2 texels = glm::vec2(origin) * (MAP_SIZE * 0.5f);
+    glm::vec2 offset = (glm::round(texels) - texels) * (2.0f / MAP_SIZE);
+    lightProj[3][0] += offset.x;
+    lightProj[3][1] += offset.y;
+
+    return lightProj * lightView;
+}
+
+void CascadedShadowMaps::bind(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout) {
+    uint32_t dynamicOffset = static_cast<uint32_t>(m_slot * m_slotSize);
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout,
+                            2, 1, &m_descriptorSet, 1, &dynamicOffset);
+}
+
+uint32_t CascadedShadowMaps::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) {
+    VkPhysicalDeviceMemoryProperties memProperties;
+    vkGetPhysicalDeviceMemoryProperties(m_device->getPhysicalDevice(), &memProperties);
+
+    for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++) {
+        if ((typeFilter & (1 << i)) && (memProperties.memoryTypes[i].propertyFlags & properties) == properties) {
+            return i;
+        }
+    }
+
+    throw std::runtime_error("Failed to find suitable memory type!");
+}
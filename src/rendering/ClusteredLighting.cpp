@@ -0,0 +1,256 @@
+#include "rendering/ClusteredLighting.h"
+#include "core/DeletionQueue.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+namespace {
+// Lights without a range are cut off where their illuminance drops below this
+constexpr float MIN_ILLUMINANCE = 0.01f;
+// Sets still referenced by in-flight frames stay allocated until they retire
+constexpr uint32_t MAX_DESCRIPTOR_SETS = 4;
+}
+
+ClusteredLighting::ClusteredLighting(VulkanDevice* device) : m_device(device) {
+    createDescriptorSetLayout();
+    createDescriptorPool();
+    createClusterBuffers();
+    createLightBuffer(sizeof(GpuLight));
+    allocateDescriptorSet();
+
+    m_cullPipeline = std::make_unique<ComputePipeline>(m_device, "light_cull.comp",
+                                                       std::vector<VkDescriptorSetLayout>{m_descriptorSetLayout},
+                                                       static_cast<uint32_t>(sizeof(CullParams)));
+
+    std::cout << "ClusteredLighting: " << GRID_X << "x" << GRID_Y << "x" << GRID_Z << " clusters, up to "
+              << MAX_LIGHTS_PER_CLUSTER << " lights each" << std::endl;
+}
+
+ClusteredLighting::~ClusteredLighting() {
+    VkDevice device = m_device->getDevice();
+    m_cullPipeline.reset();
+
+    if (m_lightBuffer != VK_NULL_HANDLE) {
+        vkDestroyBuffer(device, m_lightBuffer, nullptr);
+        vkFreeMemory(device, m_lightBufferMemory, nullptr);
+    }
+    if (m_clusterCountBuffer != VK_NULL_HANDLE) {
+        vkDestroyBuffer(device, m_clusterCountBuffer, nullptr);
+        vkFreeMemory(device, m_clusterCountMemory, nullptr);
+    }
+    if (m_lightIndexBuffer != VK_NULL_HANDLE) {
+        vkDestroyBuffer(device, m_lightIndexBuffer, nullptr);
+        vkFreeMemory(device, m_lightIndexMemory, nullptr);
+    }
+    if (m_descriptorPool != VK_NULL_HANDLE) {
+        vkDestroyDescriptorPool(device, m_descriptorPool, nullptr);
+    }
+    if (m_descriptorSetLayout != VK_NULL_HANDLE) {
+        vkDestroyDescriptorSetLayout(device, m_descriptorSetLayout, nullptr);
+    }
+}
+
+void ClusteredLighting::createDescriptorSetLayout() {
+    std::array<VkDescriptorSetLayoutBinding, 3> bindings{};
+    for (uint32_t i = 0; i < bindings.size(); i++) {
+        bindings[i].binding = i;
+        bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        bindings[i].descriptorCount = 1;
+        bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+        bindings[i].pImmutableSamplers = nullptr;
+    }
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+    layoutInfo.pBindings = bindings.data();
+
+    if (vkCreateDescriptorSetLayout(m_device->getDevice(), &layoutInfo, nullptr, &m_descriptorSetLayout) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create clustered lighting descriptor set layout!");
+    }
+}
+
+void ClusteredLighting::createDescriptorPool() {
+    VkDescriptorPoolSize poolSize{};
+    poolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    poolSize.descriptorCount = 3 * MAX_DESCRIPTOR_SETS;
+
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT;
+    poolInfo.poolSizeCount = 1;
+    poolInfo.pPoolSizes = &poolSize;
+    poolInfo.maxSets = MAX_DESCRIPTOR_SETS;
+
+    if (vkCreateDescriptorPool(m_device->getDevice(), &poolInfo, nullptr, &m_descriptorPool) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create clustered lighting descriptor pool!");
+    }
+}
+
+void ClusteredLighting::createClusterBuffers() {
+    createBuffer(getClusterCountSize(), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                 VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_clusterCountBuffer, m_clusterCountMemory);
+    createBuffer(getLightIndexSize(), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                 VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_lightIndexBuffer, m_lightIndexMemory);
+}
+
+void ClusteredLighting::createLightBuffer(VkDeviceSize size) {
+    // Written once per model load, so host-visible memory is fine
+    m_lightBufferSize = size;
+    createBuffer(size, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                 VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                 m_lightBuffer, m_lightBufferMemory);
+}
+
+void ClusteredLighting::allocateDescriptorSet() {
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = m_descriptorPool;
+    allocInfo.descriptorSetCount = 1;
+    allocInfo.pSetLayouts = &m_descriptorSetLayout;
+
+    if (vkAllocateDescriptorSets(m_device->getDevice(), &allocInfo, &m_descriptorSet) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to allocate clustered lighting descriptor set!");
+    }
+
+    std::array<VkDescriptorBufferInfo, 3> bufferInfos{};
+    bufferInfos[0] = {m_lightBuffer, 0, m_lightBufferSize};
+    bufferInfos[1] = {m_clusterCountBuffer, 0, getClusterCountSize()};
+    bufferInfos[2] = {m_lightIndexBuffer, 0, getLightIndexSize()};
+
+    std::array<VkWriteDescriptorSet, 3> writes{};
+    for (uint32_t i = 0; i < writes.size(); i++) {
+        writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        writes[i].dstSet = m_descriptorSet;
+        writes[i].dstBinding = i;
+        writes[i].dstArrayElement = 0;
+        writes[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        writes[i].descriptorCount = 1;
+        writes[i].pBufferInfo = &bufferInfos[i];
+    }
+
+    vkUpdateDescriptorSets(m_device->getDevice(), static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+}
+
+void ClusteredLighting::setLights(const std::vector<PunctualLight>& lights) {
+    std::vector<GpuLight> gpuLights;
+    gpuLights.reserve(lights.size());
+    for (const auto& light : lights) {
+        float range = light.range;
+        if (range <= 0.0f) {
+            float peak = light.intensity * std::max(light.color.r, std::max(light.color.g, light.color.b));
+            range = std::sqrt(std::max(peak, 0.0f) / MIN_ILLUMINANCE);
+        }
+
+        // KHR_lights_punctual cone falloff: saturate(cd * scale + offset)^2
+        float cosOuter = std::cos(light.outerConeAngle);
+        float cosInner = std::cos(light.innerConeAngle);
+        float scale = 1.0f / std::max(0.001f, cosInner - cosOuter);
+
+        GpuLight gpuLight{};
+        gpuLight.positionRange = glm::vec4(light.position, range);
+        gpuLight.directionType = glm::vec4(light.direction, static_cast<float>(light.type));
+        gpuLight.colorIntensity = glm::vec4(light.color, light.intensity);
+        gpuLight.spotScaleOffset = glm::vec4(scale, -cosOuter * scale, 0.0f, 0.0f);
+        gpuLights.push_back(gpuLight);
+    }
+
+    // Frames in flight still read the old buffer through the old set, so both are retired
+    VkDevice device = m_device->getDevice();
+    VkDescriptorPool pool = m_descriptorPool;
+    VkDescriptorSet oldSet = m_descriptorSet;
+    VkBuffer oldBuffer = m_lightBuffer;
+    VkDeviceMemory oldMemory = m_lightBufferMemory;
+    m_device->getDeletionQueue()->push([device, pool, oldSet, oldBuffer, oldMemory]() {
+        vkFreeDescriptorSets(device, pool, 1, &oldSet);
+        vkDestroyBuffer(device, oldBuffer, nullptr);
+        vkFreeMemory(device, oldMemory, nullptr);
+    });
+
+    createLightBuffer(std::max<VkDeviceSize>(sizeof(GpuLight), sizeof(GpuLight) * gpuLights.size()));
+    if (!gpuLights.empty()) {
+        void* data;
+        vkMapMemory(device, m_lightBufferMemory, 0, m_lightBufferSize, 0, &data);
+        memcpy(data, gpuLights.data(), sizeof(GpuLight) * gpuLights.size());
+        vkUnmapMemory(device, m_lightBufferMemory);
+    }
+    allocateDescriptorSet();
+
+    m_lightCount = static_cast<uint32_t>(gpuLights.size());
+    std::cout << "ClusteredLighting: Uploaded " << m_lightCount << " light(s)" << std::endl;
+}
+
+void ClusteredLighting::cull(VkCommandBuffer commandBuffer, const glm::mat4& view, const glm::mat4& projection,
+                             float nearPlane, float farPlane) {
+    CullParams params{};
+    params.view = view;
+    params.projParams = glm::vec4(1.0f / projection[0][0], 1.0f / projection[1][1], nearPlane, farPlane);
+    params.counts = glm::uvec4(m_lightCount, MAX_LIGHTS_PER_CLUSTER, 0, 0);
+
+    m_cullPipeline->bind(commandBuffer);
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_cullPipeline->getPipelineLayout(),
+                            0, 1, &m_descriptorSet, 0, nullptr);
+    vkCmdPushConstants(commandBuffer, m_cullPipeline->getPipelineLayout(), VK_SHADER_STAGE_COMPUTE_BIT,
+                       0, sizeof(CullParams), &params);
+    // One workgroup per depth slice, one invocation per cluster in it
+    vkCmdDispatch(commandBuffer, 1, 1, GRID_Z);
+}
+
+void ClusteredLighting::bind(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout, float nearPlane,
+                             float farPlane, VkExtent2D extent) {
+    // slice = log(depth) * scale + bias, the inverse of the exponential split in light_cull.comp
+    float logRatio = std::log(farPlane / nearPlane);
+
+    ClusterParams params{};
+    params.depthParams = glm::vec4(nearPlane, farPlane, GRID_Z / logRatio, -GRID_Z * std::log(nearPlane) / logRatio);
+    params.tileSize = glm::vec4(static_cast<float>(extent.width) / GRID_X,
+                                static_cast<float>(extent.height) / GRID_Y, 0.0f, 0.0f);
+    params.grid = glm::uvec4(GRID_X, GRID_Y, GRID_Z, MAX_LIGHTS_PER_CLUSTER);
+
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout,
+                            1, 1, &m_descriptorSet, 0, nullptr);
+    vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(ClusterParams), &params);
+}
+
+void ClusteredLighting::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties,
+                                     VkBuffer& buffer, VkDeviceMemory& bufferMemory) {
+    VkBufferCreateInfo bufferInfo{};
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size = size;
+    bufferInfo.usage = usage;
+    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    if (vkCreateBuffer(m_device->getDevice(), &bufferInfo, nullptr, &buffer) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create clustered lighting buffer!");
+    }
+
+    VkMemoryRequirements memRequirements;
+    vkGetBufferMemoryRequirements(m_device->getDevice(), buffer, &memRequirements);
+
+    VkMemoryAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = memRequirements.size;
+    allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
+
+    if (vkAllocateMemory(m_device->getDevice(), &allocInfo, nullptr, &bufferMemory) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to allocate clustered lighting buffer memory!");
+    }
+
+    vkBindBufferMemory(m_device->getDevice(), buffer, bufferMemory, 0);
+}
+
+uint32_t ClusteredLighting::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) {
+    VkPhysicalDeviceMemoryProperties memProperties;
+    vkGetPhysicalDeviceMemoryProperties(m_device->getPhysicalDevice(), &memProperties);
+
+    for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++) {
+        if ((typeFilter & (1 << i)) && (memProperties.memoryTypes[i].propertyFlags & properties) == properties) {
+            return i;
+        }
+    }
+
+    throw std::runtime_error("Failed to find suitable memory type!");
+}
@@ -1,7 +1,7 @@
 #include "rendering/CommandBuffer.h"
-#include "ui/DebugUI.h"
+#include "rendering/RenderGraph.h"
+#include "core/Profiler.h"
 #include <stdexcept>
-#include <array>
 
 CommandBuffer::CommandBuffer(VulkanDevice* device) : m_device(device) {
     createCommandPool();
@@ -36,11 +36,8 @@ void CommandBuffer::createCommandPool() {
     }
 }
 
-void CommandBuffer::createCommandBuffers(VkRenderPass renderPass,
-    const std::vector<VkFramebuffer>& framebuffers, VkExtent2D extent, VkPipeline graphicsPipeline,
-    VkPipelineLayout pipelineLayout, VkDescriptorSet descriptorSet) {
-
-    m_commandBuffers.resize(framebuffers.size());
+void CommandBuffer::createCommandBuffers(uint32_t count) {
+    m_commandBuffers.resize(count);
 
     VkCommandBufferAllocateInfo allocInfo{};
     allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
@@ -51,50 +48,9 @@ void CommandBuffer::createCommandBuffers(VkRenderPass renderPass,
     if (vkAllocateCommandBuffers(m_device->getDevice(), &allocInfo, m_commandBuffers.data()) != VK_SUCCESS) {
         throw std::runtime_error("Failed to allocate command buffers!");
     }
-
-    // Record command buffers
-    for (size_t i = 0; i < m_commandBuffers.size(); i++) {
-        VkCommandBufferBeginInfo beginInfo{};
-        beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-
-        if (vkBeginCommandBuffer(m_commandBuffers[i], &beginInfo) != VK_SUCCESS) {
-            throw std::runtime_error("Failed to begin recording command buffer!");
-        }
-
-        VkRenderPassBeginInfo renderPassInfo{};
-        renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-        renderPassInfo.renderPass = renderPass;
-        renderPassInfo.framebuffer = framebuffers[i];
-        renderPassInfo.renderArea.offset = {0, 0};
-        renderPassInfo.renderArea.extent = extent;
-
-        VkClearValue clearColor = {{{0.95f, 0.95f, 0.95f, 1.0f}}};
-        renderPassInfo.clearValueCount = 1;
-        renderPassInfo.pClearValues = &clearColor;
-
-        vkCmdBeginRenderPass(m_commandBuffers[i], &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
-
-        // Bind the graphics pipeline
-        vkCmdBindPipeline(m_commandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline);
-
-        // Bind descriptor set
-        vkCmdBindDescriptorSets(m_commandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS,
-            pipelineLayout, 0, 1, &descriptorSet, 0, nullptr);
-
-        // No drawing commands here - actual rendering is done in recordCommandBuffer method
-
-        vkCmdEndRenderPass(m_commandBuffers[i]);
-
-        if (vkEndCommandBuffer(m_commandBuffers[i]) != VK_SUCCESS) {
-            throw std::runtime_error("Failed to record command buffer!");
-        }
-    }
 }
 
-void CommandBuffer::recordCommandBuffer(size_t index, VkRenderPass renderPass, VkFramebuffer framebuffer,
-                                       VkExtent2D extent, VkPipeline graphicsPipeline, VkPipelineLayout pipelineLayout,
-                                       VkDescriptorSet descriptorSet, DebugUI* debugUI, GLTFViewer* viewer) {
-    
+void CommandBuffer::recordCommandBuffer(size_t index, RenderGraph* renderGraph, Profiler* profiler, uint32_t frameIndex) {
     VkCommandBufferBeginInfo beginInfo{};
     beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
     beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
@@ -103,45 +59,16 @@ void CommandBuffer::recordCommandBuffer(size_t index, VkRenderPass renderPass, V
         throw std::runtime_error("Failed to begin recording command buffer!");
     }
 
-    VkRenderPassBeginInfo renderPassInfo{};
-    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-    renderPassInfo.renderPass = renderPass;
-    renderPassInfo.framebuffer = framebuffer;
-    renderPassInfo.renderArea.offset = {0, 0};
-    renderPassInfo.renderArea.extent = extent;
-
-    std::array<VkClearValue, 2> clearValues{};
-    clearValues[0].color = {{0.95f, 0.95f, 0.95f, 1.0f}};
-    clearValues[1].depthStencil = {1.0f, 0};
-    
-    renderPassInfo.clearValueCount = static_cast<uint32_t>(clearValues.size());
-    renderPassInfo.pClearValues = clearValues.data();
-
-    vkCmdBeginRenderPass(m_commandBuffers[index], &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
-
-    // Bind the graphics pipeline
-    vkCmdBindPipeline(m_commandBuffers[index], VK_PIPELINE_BIND_POINT_GRAPHICS, graphicsPipeline);
-
-    // Render model through GLTFViewer if provided
-    if (viewer && viewer->hasModel()) {
-        // Bind GLTFViewer's descriptor set which has proper camera matrices
-        VkDescriptorSet viewerDescriptorSet = viewer->getDescriptorSet();
-        vkCmdBindDescriptorSets(m_commandBuffers[index], VK_PIPELINE_BIND_POINT_GRAPHICS,
-            pipelineLayout, 0, 1, &viewerDescriptorSet, 0, nullptr);
-        
-        viewer->renderToCommandBuffer(m_commandBuffers[index], pipelineLayout);
-    } else {
-        // Fallback to pipeline descriptor set if no model
-        vkCmdBindDescriptorSets(m_commandBuffers[index], VK_PIPELINE_BIND_POINT_GRAPHICS,
-            pipelineLayout, 0, 1, &descriptorSet, 0, nullptr);
+    if (profiler) {
+        profiler->beginFrame(m_commandBuffers[index], frameIndex);
     }
 
-    // Render ImGui if provided
-    if (debugUI) {
-        debugUI->renderDrawData(m_commandBuffers[index]);
-    }
+    // Passes, barriers and render pass instances all come from the graph
+    renderGraph->execute(m_commandBuffers[index], profiler);
 
-    vkCmdEndRenderPass(m_commandBuffers[index]);
+    if (profiler) {
+        profiler->endFrame(m_commandBuffers[index]);
+    }
 
     if (vkEndCommandBuffer(m_commandBuffers[index]) != VK_SUCCESS) {
         throw std::runtime_error("Failed to record command buffer!");
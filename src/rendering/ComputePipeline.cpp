@@ -0,0 +1,88 @@
+#include "rendering/ComputePipeline.h"
+
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+
+ComputePipeline::ComputePipeline(VulkanDevice* device, const std::string& shaderName,
+                                 const std::vector<VkDescriptorSetLayout>& setLayouts, uint32_t pushConstantSize,
+                                 const VkSpecializationInfo* specialization)
+    : m_device(device) {
+    auto shaderPath = std::filesystem::current_path() / "shaders" / (shaderName + ".spv");
+    auto code = readShaderFile(shaderPath.string());
+
+    VkShaderModuleCreateInfo moduleInfo{};
+    moduleInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+    moduleInfo.codeSize = code.size();
+    moduleInfo.pCode = reinterpret_cast<const uint32_t*>(code.data());
+
+    VkShaderModule shaderModule;
+    if (vkCreateShaderModule(m_device->getDevice(), &moduleInfo, nullptr, &shaderModule) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create compute shader module!");
+    }
+
+    VkPushConstantRange pushConstantRange{};
+    pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    pushConstantRange.offset = 0;
+    pushConstantRange.size = pushConstantSize;
+
+    VkPipelineLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    layoutInfo.setLayoutCount = static_cast<uint32_t>(setLayouts.size());
+    layoutInfo.pSetLayouts = setLayouts.data();
+    layoutInfo.pushConstantRangeCount = pushConstantSize > 0 ? 1 : 0;
+    layoutInfo.pPushConstantRanges = pushConstantSize > 0 ? &pushConstantRange : nullptr;
+
+    if (vkCreatePipelineLayout(m_device->getDevice(), &layoutInfo, nullptr, &m_pipelineLayout) != VK_SUCCESS) {
+        vkDestroyShaderModule(m_device->getDevice(), shaderModule, nullptr);
+        throw std::runtime_error("Failed to create compute pipeline layout!");
+    }
+
+    VkComputePipelineCreateInfo pipelineInfo{};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    pipelineInfo.stage.module = shaderModule;
+    pipelineInfo.stage.pName = "main";
+    pipelineInfo.stage.pSpecializationInfo = specialization;
+    pipelineInfo.layout = m_pipelineLayout;
+
+    VkResult result = vkCreateComputePipelines(m_device->getDevice(), VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &m_pipeline);
+    vkDestroyShaderModule(m_device->getDevice(), shaderModule, nullptr);
+    if (result != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create compute pipeline!");
+    }
+
+    std::cout << "ComputePipeline: Created " << shaderName << std::endl;
+}
+
+ComputePipeline::~ComputePipeline() {
+    if (m_pipeline != VK_NULL_HANDLE) {
+        vkDestroyPipeline(m_device->getDevice(), m_pipeline, nullptr);
+    }
+    if (m_pipelineLayout != VK_NULL_HANDLE) {
+        vkDestroyPipelineLayout(m_device->getDevice(), m_pipelineLayout, nullptr);
+    }
+}
+
+void ComputePipeline::bind(VkCommandBuffer commandBuffer) const {
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipeline);
+}
+
+std::vector<char> ComputePipeline::readShaderFile(const std::string& filename) {
+    std::ifstream file(filename, std::ios::ate | std::ios::binary);
+
+    if (!file.is_open()) {
+        throw std::runtime_error("Failed to open shader file: " + filename);
+    }
+
+    size_t fileSize = (size_t) file.tellg();
+    std::vector<char> buffer(fileSize);
+
+    file.seekg(0);
+    file.read(buffer.data(), fileSize);
+    file.close();
+
+    return buffer;
+}
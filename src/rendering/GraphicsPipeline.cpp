@@ -1,19 +1,34 @@
 #include "rendering/GraphicsPipeline.h"
 #include "rendering/RenderPass.h"
-#include "rendering/Framebuffer.h"
 #include "rendering/CommandBuffer.h"
+#include "rendering/ClusteredLighting.h"
+#include "rendering/CascadedShadowMaps.h"
+#include "rendering/ImageBasedLighting.h"
+#include "rendering/PostProcessor.h"
+#include "rendering/ShaderPermutation.h"
+#include "rendering/WeightedBlendedOIT.h"
 #include "core/VulkanDevice.h"
 #include "viewer/GLTFLoader.h"
+#include "viewer/GLTFViewer.h"
 
+#include <cstddef>
 #include <filesystem>
 #include <fstream>
 #include <iostream>
 #include <stdexcept>
 
-GraphicsPipeline::GraphicsPipeline(VulkanDevice* device, SwapChain* swapChain)
-    : m_device(device), m_swapChain(swapChain) {
-    m_renderPass    = std::make_unique<RenderPass>(device, swapChain);
-    m_framebuffer   = std::make_unique<Framebuffer>(device, swapChain, m_renderPass->getRenderPass());
+GraphicsPipeline::GraphicsPipeline(VulkanDevice* device, SwapChain* swapChain, VkDescriptorSetLayout lightingLayout,
+                                   VkDescriptorSetLayout shadowLayout, VkDescriptorSetLayout environmentLayout,
+                                   VkDescriptorSetLayout oitCompositeLayout, VkDescriptorSetLayout presentLayout)
+    : m_device(device), m_swapChain(swapChain), m_lightingLayout(lightingLayout), m_shadowLayout(shadowLayout),
+      m_environmentLayout(environmentLayout), m_oitCompositeLayout(oitCompositeLayout), m_presentLayout(presentLayout) {
+    if (!device->supportsDynamicRendering()) {
+        m_renderPass      = std::make_unique<RenderPass>(device, swapChain);
+        m_sceneRenderPass = std::make_unique<RenderPass>(device, std::vector<VkFormat>{PostProcessor::HDR_FORMAT});
+        m_depthRenderPass = std::make_unique<RenderPass>(device, swapChain, true);
+        m_oitRenderPass   = std::make_unique<RenderPass>(device, std::vector<VkFormat>{
+            WeightedBlendedOIT::ACCUM_FORMAT, WeightedBlendedOIT::REVEALAGE_FORMAT});
+    }
     m_commandBuffer = std::make_unique<CommandBuffer>(device);
     m_uniformBuffer = std::make_unique<UniformBuffer>(device, sizeof(UniformBufferObject));
     createPipeline();
@@ -21,18 +36,65 @@ GraphicsPipeline::GraphicsPipeline(VulkanDevice* device, SwapChain* swapChain)
 }
 
 GraphicsPipeline::~GraphicsPipeline() {
-    if (m_graphicsPipeline != VK_NULL_HANDLE) {
-        vkDestroyPipeline(m_device->getDevice(), m_graphicsPipeline, nullptr);
+    // m_graphicsPipeline is one of the cached variants
+    for (const auto& [key, pipeline] : m_shadingPipelines) {
+        vkDestroyPipeline(m_device->getDevice(), pipeline, nullptr);
+    }
+    if (m_pipelineCache != VK_NULL_HANDLE) {
+        vkDestroyPipelineCache(m_device->getDevice(), m_pipelineCache, nullptr);
+    }
+    if (m_fragShaderModule != VK_NULL_HANDLE) {
+        vkDestroyShaderModule(m_device->getDevice(), m_fragShaderModule, nullptr);
+    }
+    if (m_vertShaderModule != VK_NULL_HANDLE) {
+        vkDestroyShaderModule(m_device->getDevice(), m_vertShaderModule, nullptr);
+    }
+    if (m_wireframeGeomModule != VK_NULL_HANDLE) {
+        vkDestroyShaderModule(m_device->getDevice(), m_wireframeGeomModule, nullptr);
+    }
+    if (m_depthPrepassPipeline != VK_NULL_HANDLE) {
+        vkDestroyPipeline(m_device->getDevice(), m_depthPrepassPipeline, nullptr);
+    }
+    if (m_shadowPipeline != VK_NULL_HANDLE) {
+        vkDestroyPipeline(m_device->getDevice(), m_shadowPipeline, nullptr);
+    }
+    if (m_pointsPipeline != VK_NULL_HANDLE) {
+        vkDestroyPipeline(m_device->getDevice(), m_pointsPipeline, nullptr);
+    }
+    if (m_pointsPipelineLayout != VK_NULL_HANDLE) {
+        vkDestroyPipelineLayout(m_device->getDevice(), m_pointsPipelineLayout, nullptr);
+    }
+    if (m_oitCompositePipeline != VK_NULL_HANDLE) {
+        vkDestroyPipeline(m_device->getDevice(), m_oitCompositePipeline, nullptr);
+    }
+    if (m_oitCompositePipelineLayout != VK_NULL_HANDLE) {
+        vkDestroyPipelineLayout(m_device->getDevice(), m_oitCompositePipelineLayout, nullptr);
+    }
+    if (m_presentPipeline != VK_NULL_HANDLE) {
+        vkDestroyPipeline(m_device->getDevice(), m_presentPipeline, nullptr);
+    }
+    if (m_presentPipelineLayout != VK_NULL_HANDLE) {
+        vkDestroyPipelineLayout(m_device->getDevice(), m_presentPipelineLayout, nullptr);
+    }
+    if (m_shadowPipelineLayout != VK_NULL_HANDLE) {
+        vkDestroyPipelineLayout(m_device->getDevice(), m_shadowPipelineLayout, nullptr);
     }
     if (m_pipelineLayout != VK_NULL_HANDLE) {
         vkDestroyPipelineLayout(m_device->getDevice(), m_pipelineLayout, nullptr);
     }
-    m_framebuffer.reset(); // Destroy framebuffer before render pass
+    m_oitRenderPass.reset();
+    m_sceneRenderPass.reset();
+    m_depthRenderPass.reset();
     m_renderPass.reset(); // Destroy render pass last
 }
 
 void GraphicsPipeline::createPipeline() {
     createGraphicsPipeline();
+    createDepthPrepassPipeline();
+    createShadowPipeline();
+    createPointsPipeline();
+    createOitCompositePipeline();
+    createPresentPipeline();
 }
 
 std::vector<char> GraphicsPipeline::readShaderFile(const std::string& filename) {
@@ -89,25 +151,131 @@ void GraphicsPipeline::createGraphicsPipeline() {
     auto fragShaderCode = readShaderFile(fragShaderPath.string());
     std::cout << "Successfully loaded fragment shader (" << fragShaderCode.size() << " bytes)" << std::endl;
 
-    VkShaderModule vertShaderModule = createShaderModule(vertShaderCode);
+    m_vertShaderModule = createShaderModule(vertShaderCode);
     std::cout << "Created vertex shader module" << std::endl;
 
-    VkShaderModule fragShaderModule = createShaderModule(fragShaderCode);
+    m_fragShaderModule = createShaderModule(fragShaderCode);
     std::cout << "Created fragment shader module" << std::endl;
 
+    // Only the wireframe overlay variants insert this stage, and only where geometry shaders exist
+    if (m_device->supportsGeometryShader()) {
+        m_wireframeGeomModule =
+            createShaderModule(readShaderFile((buildDir / "shaders" / "wireframe.geom.spv").string()));
+    }
+
+    // Variants compile lazily mid-session; the cache lets the driver reuse work between them
+    VkPipelineCacheCreateInfo cacheInfo{};
+    cacheInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    if (vkCreatePipelineCache(m_device->getDevice(), &cacheInfo, nullptr, &m_pipelineCache) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create pipeline cache");
+    }
+
+    // Pipeline layout
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    VkDescriptorSetLayout setLayouts[] = {m_uniformBuffer->getDescriptorSetLayout(), m_lightingLayout, m_shadowLayout,
+                                          m_environmentLayout};
+    pipelineLayoutInfo.setLayoutCount = 4;
+    pipelineLayoutInfo.pSetLayouts = setLayouts;
+
+    // Cluster lookup, environment and per-material parameters for the fragment shader
+    VkPushConstantRange pushConstantRange{};
+    pushConstantRange.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+    pushConstantRange.offset = 0;
+    pushConstantRange.size = sizeof(ClusteredLighting::ClusterParams) + sizeof(ImageBasedLighting::ShadingParams) +
+                             sizeof(GLTFViewer::MaterialParams);
+    pipelineLayoutInfo.pushConstantRangeCount = 1;
+    pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+    if (vkCreatePipelineLayout(m_device->getDevice(), &pipelineLayoutInfo, nullptr, &m_pipelineLayout) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create pipeline layout");
+    }
+
+    // The featureless variant doubles as the default pipeline for passes without a model
+    m_graphicsPipeline = getShadingPipeline(0, false);
+    std::cout << "Successfully created graphics pipeline\n" << std::endl;
+}
+
+VkPipeline GraphicsPipeline::getShadingPipeline(uint32_t permutation, bool depthPrepass) {
+    // Without a geometry stage the overlay has no barycentrics; shade those draws as plain PBR
+    if (ShaderPermutation::renderMode(permutation) == ShaderPermutation::WIREFRAME_MODE &&
+        !m_device->supportsGeometryShader()) {
+        permutation = ShaderPermutation::make(ShaderPermutation::features(permutation), 0);
+    }
+    uint32_t key = (permutation << 1) | (depthPrepass ? 1u : 0u);
+    auto it = m_shadingPipelines.find(key);
+    if (it != m_shadingPipelines.end()) {
+        return it->second;
+    }
+
+    VkPipeline pipeline = createShadingPipeline(permutation, depthPrepass);
+    m_shadingPipelines.emplace(key, pipeline);
+    std::cout << "GraphicsPipeline: compiled shading variant 0x" << std::hex << permutation << std::dec
+              << (depthPrepass ? " (prepass)" : "") << ", " << m_shadingPipelines.size() << " cached" << std::endl;
+    return pipeline;
+}
+
+VkPipeline GraphicsPipeline::createShadingPipeline(uint32_t permutation, bool depthPrepass) {
+    // Specialization data for shader.frag's constant_id 0-6
+    struct SpecializationData {
+        VkBool32 hasNormalMap;
+        VkBool32 hasEmissiveMap;
+        VkBool32 hasOcclusionMap;
+        VkBool32 useVertexColors;
+        int32_t renderMode;
+        VkBool32 alphaMask;
+        VkBool32 weightedOit;
+    };
+    uint32_t features = ShaderPermutation::features(permutation);
+    SpecializationData specializationData{};
+    specializationData.hasNormalMap    = (features & ShaderPermutation::NormalMap) ? VK_TRUE : VK_FALSE;
+    specializationData.hasEmissiveMap  = (features & ShaderPermutation::EmissiveMap) ? VK_TRUE : VK_FALSE;
+    specializationData.hasOcclusionMap = (features & ShaderPermutation::OcclusionMap) ? VK_TRUE : VK_FALSE;
+    specializationData.useVertexColors = (features & ShaderPermutation::VertexColors) ? VK_TRUE : VK_FALSE;
+    specializationData.renderMode      = ShaderPermutation::renderMode(permutation);
+    specializationData.alphaMask       = (features & ShaderPermutation::AlphaMask) ? VK_TRUE : VK_FALSE;
+    specializationData.weightedOit     = (features & ShaderPermutation::WeightedOIT) ? VK_TRUE : VK_FALSE;
+
+    const uint32_t offsets[] = {
+        offsetof(SpecializationData, hasNormalMap),    offsetof(SpecializationData, hasEmissiveMap),
+        offsetof(SpecializationData, hasOcclusionMap), offsetof(SpecializationData, useVertexColors),
+        offsetof(SpecializationData, renderMode),      offsetof(SpecializationData, alphaMask),
+        offsetof(SpecializationData, weightedOit)};
+    VkSpecializationMapEntry mapEntries[7]{};
+    for (uint32_t i = 0; i < 7; ++i) {
+        mapEntries[i].constantID = i;
+        mapEntries[i].offset     = offsets[i];
+        mapEntries[i].size       = sizeof(uint32_t); // VkBool32 and int32_t alike
+    }
+
+    VkSpecializationInfo specializationInfo{};
+    specializationInfo.mapEntryCount = 7;
+    specializationInfo.pMapEntries   = mapEntries;
+    specializationInfo.dataSize      = sizeof(SpecializationData);
+    specializationInfo.pData         = &specializationData;
+
     VkPipelineShaderStageCreateInfo vertShaderStageInfo{};
     vertShaderStageInfo.sType  = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
     vertShaderStageInfo.stage  = VK_SHADER_STAGE_VERTEX_BIT;
-    vertShaderStageInfo.module = vertShaderModule;
+    vertShaderStageInfo.module = m_vertShaderModule;
     vertShaderStageInfo.pName  = "main";
 
     VkPipelineShaderStageCreateInfo fragShaderStageInfo{};
-    fragShaderStageInfo.sType  = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-    fragShaderStageInfo.stage  = VK_SHADER_STAGE_FRAGMENT_BIT;
-    fragShaderStageInfo.module = fragShaderModule;
-    fragShaderStageInfo.pName  = "main";
-
-    VkPipelineShaderStageCreateInfo shaderStages[] = {vertShaderStageInfo, fragShaderStageInfo};
+    fragShaderStageInfo.sType               = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    fragShaderStageInfo.stage               = VK_SHADER_STAGE_FRAGMENT_BIT;
+    fragShaderStageInfo.module              = m_fragShaderModule;
+    fragShaderStageInfo.pName               = "main";
+    fragShaderStageInfo.pSpecializationInfo = &specializationInfo;
+
+    // The wireframe overlay gets its barycentrics from a pass-through geometry stage
+    VkPipelineShaderStageCreateInfo geomShaderStageInfo{};
+    geomShaderStageInfo.sType  = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    geomShaderStageInfo.stage  = VK_SHADER_STAGE_GEOMETRY_BIT;
+    geomShaderStageInfo.module = m_wireframeGeomModule;
+    geomShaderStageInfo.pName  = "main";
+
+    bool wireframe = ShaderPermutation::renderMode(permutation) == ShaderPermutation::WIREFRAME_MODE;
+    VkPipelineShaderStageCreateInfo shaderStages[] = {vertShaderStageInfo, fragShaderStageInfo, geomShaderStageInfo};
 
     // Vertex input state - use glTF vertex format
     auto bindingDescription = Vertex::getBindingDescription();
@@ -146,6 +314,13 @@ void GraphicsPipeline::createGraphicsPipeline() {
     viewportState.scissorCount  = 1;
     viewportState.pScissors     = &scissor;
 
+    // The scene renders at the dynamic resolution, so passes set the viewport themselves
+    VkDynamicState dynamicStates[] = {VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR};
+    VkPipelineDynamicStateCreateInfo dynamicState{};
+    dynamicState.sType             = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+    dynamicState.dynamicStateCount = 2;
+    dynamicState.pDynamicStates    = dynamicStates;
+
     // Rasterizer
     VkPipelineRasterizationStateCreateInfo rasterizer{};
     rasterizer.sType                   = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
@@ -172,7 +347,300 @@ void GraphicsPipeline::createGraphicsPipeline() {
     depthStencil.depthBoundsTestEnable = VK_FALSE;
     depthStencil.stencilTestEnable     = VK_FALSE;
 
-    // Color blending
+    bool blended     = (features & (ShaderPermutation::AlphaBlend | ShaderPermutation::WeightedOIT)) != 0;
+    bool weightedOit = (features & ShaderPermutation::WeightedOIT) != 0;
+    if (blended) {
+        // Transparent surfaces test against the opaque depth but never occlude each other
+        depthStencil.depthWriteEnable = VK_FALSE;
+    } else if (depthPrepass) {
+        // Shading after a depth prepass: depth is final, so only the visible surface passes EQUAL
+        depthStencil.depthWriteEnable = VK_FALSE;
+        depthStencil.depthCompareOp   = VK_COMPARE_OP_EQUAL;
+    }
+
+    // Color blending: index 0 is the scene color (or accumulation), 1 the revealage
+    VkPipelineColorBlendAttachmentState colorBlendAttachments[2]{};
+    colorBlendAttachments[0].colorWriteMask =
+        VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+    colorBlendAttachments[0].blendEnable = VK_FALSE;
+
+    if (weightedOit) {
+        // Accumulation adds; revealage multiplies by (1 - alpha)
+        colorBlendAttachments[0].blendEnable         = VK_TRUE;
+        colorBlendAttachments[0].srcColorBlendFactor = VK_BLEND_FACTOR_ONE;
+        colorBlendAttachments[0].dstColorBlendFactor = VK_BLEND_FACTOR_ONE;
+        colorBlendAttachments[0].colorBlendOp        = VK_BLEND_OP_ADD;
+        colorBlendAttachments[0].srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+        colorBlendAttachments[0].dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+        colorBlendAttachments[0].alphaBlendOp        = VK_BLEND_OP_ADD;
+
+        colorBlendAttachments[1].colorWriteMask      = VK_COLOR_COMPONENT_R_BIT;
+        colorBlendAttachments[1].blendEnable         = VK_TRUE;
+        colorBlendAttachments[1].srcColorBlendFactor = VK_BLEND_FACTOR_ZERO;
+        colorBlendAttachments[1].dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_COLOR;
+        colorBlendAttachments[1].colorBlendOp        = VK_BLEND_OP_ADD;
+        colorBlendAttachments[1].srcAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
+        colorBlendAttachments[1].dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+        colorBlendAttachments[1].alphaBlendOp        = VK_BLEND_OP_ADD;
+    } else if (blended) {
+        // Back-to-front "over"; alpha keeps the destination's coverage
+        colorBlendAttachments[0].blendEnable         = VK_TRUE;
+        colorBlendAttachments[0].srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+        colorBlendAttachments[0].dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+        colorBlendAttachments[0].colorBlendOp        = VK_BLEND_OP_ADD;
+        colorBlendAttachments[0].srcAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
+        colorBlendAttachments[0].dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+        colorBlendAttachments[0].alphaBlendOp        = VK_BLEND_OP_ADD;
+    }
+
+    VkPipelineColorBlendStateCreateInfo colorBlending{};
+    colorBlending.sType           = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+    colorBlending.logicOpEnable   = VK_FALSE;
+    colorBlending.attachmentCount = weightedOit ? 2 : 1;
+    colorBlending.pAttachments    = colorBlendAttachments;
+
+    // Create the graphics pipeline
+    VkGraphicsPipelineCreateInfo pipelineInfo{};
+    pipelineInfo.sType               = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+    pipelineInfo.stageCount          = wireframe ? 3 : 2;
+    pipelineInfo.pStages             = shaderStages;
+    pipelineInfo.pVertexInputState   = &vertexInputInfo;
+    pipelineInfo.pInputAssemblyState = &inputAssembly;
+    pipelineInfo.pViewportState      = &viewportState;
+    pipelineInfo.pRasterizationState = &rasterizer;
+    pipelineInfo.pMultisampleState   = &multisampling;
+    pipelineInfo.pDepthStencilState  = &depthStencil;
+    pipelineInfo.pColorBlendState    = &colorBlending;
+    pipelineInfo.pDynamicState       = &dynamicState;
+    pipelineInfo.layout              = m_pipelineLayout;
+    pipelineInfo.subpass             = 0;
+    pipelineInfo.basePipelineHandle  = VK_NULL_HANDLE;
+
+    // Dynamic rendering pipelines declare attachment formats instead of a render pass
+    VkFormat colorFormats[2] = {PostProcessor::HDR_FORMAT, VK_FORMAT_UNDEFINED};
+    if (weightedOit) {
+        colorFormats[0] = WeightedBlendedOIT::ACCUM_FORMAT;
+        colorFormats[1] = WeightedBlendedOIT::REVEALAGE_FORMAT;
+    }
+    VkPipelineRenderingCreateInfo renderingInfo{};
+    renderingInfo.sType                   = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO;
+    renderingInfo.colorAttachmentCount    = colorBlending.attachmentCount;
+    renderingInfo.pColorAttachmentFormats = colorFormats;
+    renderingInfo.depthAttachmentFormat   = RenderPass::DEPTH_FORMAT;
+
+    if (m_renderPass) {
+        pipelineInfo.renderPass = (weightedOit ? m_oitRenderPass : m_sceneRenderPass)->getRenderPass();
+    } else {
+        pipelineInfo.pNext      = &renderingInfo;
+        pipelineInfo.renderPass = VK_NULL_HANDLE;
+    }
+
+    VkPipeline pipeline = VK_NULL_HANDLE;
+    if (vkCreateGraphicsPipelines(m_device->getDevice(), m_pipelineCache, 1, &pipelineInfo, nullptr, &pipeline)
+        != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create graphics pipeline");
+    }
+    return pipeline;
+}
+
+void GraphicsPipeline::createCommandBuffers() {
+    // One command buffer per swap chain image; recorded each frame from the render graph
+    m_commandBuffer->createCommandBuffers(static_cast<uint32_t>(m_swapChain->getImages().size()));
+}
+
+void GraphicsPipeline::createDepthPrepassPipeline() {
+    auto vertShaderPath = std::filesystem::current_path() / "shaders" / "depth.vert.spv";
+    std::cout << "Loading depth prepass shader from: " << vertShaderPath << std::endl;
+
+    auto vertShaderCode = readShaderFile(vertShaderPath.string());
+    VkShaderModule vertShaderModule = createShaderModule(vertShaderCode);
+
+    // Vertex stage only: no fragment shader runs while laying down depth
+    VkPipelineShaderStageCreateInfo vertShaderStageInfo{};
+    vertShaderStageInfo.sType  = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    vertShaderStageInfo.stage  = VK_SHADER_STAGE_VERTEX_BIT;
+    vertShaderStageInfo.module = vertShaderModule;
+    vertShaderStageInfo.pName  = "main";
+
+    // Tightly packed positions (GLTFLoader's position stream)
+    VkVertexInputBindingDescription bindingDescription{};
+    bindingDescription.binding   = 0;
+    bindingDescription.stride    = sizeof(glm::vec3);
+    bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+
+    VkVertexInputAttributeDescription attributeDescription{};
+    attributeDescription.binding  = 0;
+    attributeDescription.location = 0;
+    attributeDescription.format   = VK_FORMAT_R32G32B32_SFLOAT;
+    attributeDescription.offset   = 0;
+
+    VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
+    vertexInputInfo.sType                           = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+    vertexInputInfo.vertexBindingDescriptionCount   = 1;
+    vertexInputInfo.pVertexBindingDescriptions      = &bindingDescription;
+    vertexInputInfo.vertexAttributeDescriptionCount = 1;
+    vertexInputInfo.pVertexAttributeDescriptions    = &attributeDescription;
+
+    VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
+    inputAssembly.sType                  = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+    inputAssembly.topology               = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+    inputAssembly.primitiveRestartEnable = VK_FALSE;
+
+    VkViewport viewport{};
+    viewport.x        = 0.0f;
+    viewport.y        = 0.0f;
+    viewport.width    = (float) m_swapChain->getExtent().width;
+    viewport.height   = (float) m_swapChain->getExtent().height;
+    viewport.minDepth = 0.0f;
+    viewport.maxDepth = 1.0f;
+
+    VkRect2D scissor{};
+    scissor.offset = {0, 0};
+    scissor.extent = m_swapChain->getExtent();
+
+    VkPipelineViewportStateCreateInfo viewportState{};
+    viewportState.sType         = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+    viewportState.viewportCount = 1;
+    viewportState.pViewports    = &viewport;
+    viewportState.scissorCount  = 1;
+    viewportState.pScissors     = &scissor;
+
+    // Shares the shading pipeline's render size
+    VkDynamicState dynamicStates[] = {VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR};
+    VkPipelineDynamicStateCreateInfo dynamicState{};
+    dynamicState.sType             = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+    dynamicState.dynamicStateCount = 2;
+    dynamicState.pDynamicStates    = dynamicStates;
+
+    // Must match the shading pipeline's rasterization so EQUAL sees identical depths
+    VkPipelineRasterizationStateCreateInfo rasterizer{};
+    rasterizer.sType                   = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+    rasterizer.depthClampEnable        = VK_FALSE;
+    rasterizer.rasterizerDiscardEnable = VK_FALSE;
+    rasterizer.polygonMode             = VK_POLYGON_MODE_FILL;
+    rasterizer.lineWidth               = 1.0f;
+    rasterizer.cullMode                = VK_CULL_MODE_BACK_BIT;
+    rasterizer.frontFace               = VK_FRONT_FACE_CLOCKWISE;
+    rasterizer.depthBiasEnable         = VK_FALSE;
+
+    VkPipelineMultisampleStateCreateInfo multisampling{};
+    multisampling.sType                = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+    multisampling.sampleShadingEnable  = VK_FALSE;
+    multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+
+    VkPipelineDepthStencilStateCreateInfo depthStencil{};
+    depthStencil.sType                 = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+    depthStencil.depthTestEnable       = VK_TRUE;
+    depthStencil.depthWriteEnable      = VK_TRUE;
+    depthStencil.depthCompareOp        = VK_COMPARE_OP_LESS;
+    depthStencil.depthBoundsTestEnable = VK_FALSE;
+    depthStencil.stencilTestEnable     = VK_FALSE;
+
+    VkPipelineColorBlendStateCreateInfo colorBlending{};
+    colorBlending.sType           = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+    colorBlending.logicOpEnable   = VK_FALSE;
+    colorBlending.attachmentCount = 0;
+
+    VkGraphicsPipelineCreateInfo pipelineInfo{};
+    pipelineInfo.sType               = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+    pipelineInfo.stageCount          = 1;
+    pipelineInfo.pStages             = &vertShaderStageInfo;
+    pipelineInfo.pVertexInputState   = &vertexInputInfo;
+    pipelineInfo.pInputAssemblyState = &inputAssembly;
+    pipelineInfo.pViewportState      = &viewportState;
+    pipelineInfo.pRasterizationState = &rasterizer;
+    pipelineInfo.pMultisampleState   = &multisampling;
+    pipelineInfo.pDepthStencilState  = &depthStencil;
+    pipelineInfo.pColorBlendState    = &colorBlending;
+    pipelineInfo.pDynamicState       = &dynamicState;
+    pipelineInfo.layout              = m_pipelineLayout; // Same UBO set as the shading pipeline
+    pipelineInfo.subpass             = 0;
+
+    VkPipelineRenderingCreateInfo renderingInfo{};
+    renderingInfo.sType                 = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO;
+    renderingInfo.colorAttachmentCount  = 0;
+    renderingInfo.depthAttachmentFormat = RenderPass::DEPTH_FORMAT;
+
+    if (m_depthRenderPass) {
+        pipelineInfo.renderPass = m_depthRenderPass->getRenderPass();
+    } else {
+        pipelineInfo.pNext      = &renderingInfo;
+        pipelineInfo.renderPass = VK_NULL_HANDLE;
+    }
+
+    if (vkCreateGraphicsPipelines(m_device->getDevice(), VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &m_depthPrepassPipeline)
+        != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create depth prepass pipeline");
+    }
+
+    vkDestroyShaderModule(m_device->getDevice(), vertShaderModule, nullptr);
+    std::cout << "Successfully created depth prepass pipeline" << std::endl;
+}
+
+void GraphicsPipeline::createPointsPipeline() {
+    auto shaderDir = std::filesystem::current_path() / "shaders";
+    std::cout << "Loading points shaders from: " << shaderDir << std::endl;
+
+    VkShaderModule vertShaderModule = createShaderModule(readShaderFile((shaderDir / "points.vert.spv").string()));
+    VkShaderModule fragShaderModule = createShaderModule(readShaderFile((shaderDir / "points.frag.spv").string()));
+
+    VkPipelineShaderStageCreateInfo shaderStages[2]{};
+    shaderStages[0].sType  = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    shaderStages[0].stage  = VK_SHADER_STAGE_VERTEX_BIT;
+    shaderStages[0].module = vertShaderModule;
+    shaderStages[0].pName  = "main";
+    shaderStages[1].sType  = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    shaderStages[1].stage  = VK_SHADER_STAGE_FRAGMENT_BIT;
+    shaderStages[1].module = fragShaderModule;
+    shaderStages[1].pName  = "main";
+
+    // The full glTF vertex, unindexed: every vertex becomes exactly one point
+    auto bindingDescription = Vertex::getBindingDescription();
+    auto attributeDescriptions = Vertex::getAttributeDescriptions();
+
+    VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
+    vertexInputInfo.sType                           = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+    vertexInputInfo.vertexBindingDescriptionCount   = 1;
+    vertexInputInfo.pVertexBindingDescriptions      = &bindingDescription;
+    vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.size());
+    vertexInputInfo.pVertexAttributeDescriptions    = attributeDescriptions.data();
+
+    VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
+    inputAssembly.sType                  = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+    inputAssembly.topology               = VK_PRIMITIVE_TOPOLOGY_POINT_LIST;
+    inputAssembly.primitiveRestartEnable = VK_FALSE;
+
+    VkPipelineViewportStateCreateInfo viewportState{};
+    viewportState.sType         = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+    viewportState.viewportCount = 1;
+    viewportState.scissorCount  = 1;
+
+    // Shares the shading pipeline's render size
+    VkDynamicState dynamicStates[] = {VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR};
+    VkPipelineDynamicStateCreateInfo dynamicState{};
+    dynamicState.sType             = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+    dynamicState.dynamicStateCount = 2;
+    dynamicState.pDynamicStates    = dynamicStates;
+
+    VkPipelineRasterizationStateCreateInfo rasterizer{};
+    rasterizer.sType                   = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+    rasterizer.depthClampEnable        = VK_FALSE;
+    rasterizer.rasterizerDiscardEnable = VK_FALSE;
+    rasterizer.polygonMode             = VK_POLYGON_MODE_FILL;
+    rasterizer.lineWidth               = 1.0f;
+    rasterizer.cullMode                = VK_CULL_MODE_NONE;
+    rasterizer.frontFace               = VK_FRONT_FACE_CLOCKWISE;
+
+    VkPipelineMultisampleStateCreateInfo multisampling{};
+    multisampling.sType                = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+    multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+
+    VkPipelineDepthStencilStateCreateInfo depthStencil{};
+    depthStencil.sType            = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+    depthStencil.depthTestEnable  = VK_TRUE;
+    depthStencil.depthWriteEnable = VK_TRUE;
+    depthStencil.depthCompareOp   = VK_COMPARE_OP_LESS;
+
     VkPipelineColorBlendAttachmentState colorBlendAttachment{};
     colorBlendAttachment.colorWriteMask =
         VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
@@ -184,18 +652,25 @@ void GraphicsPipeline::createGraphicsPipeline() {
     colorBlending.attachmentCount = 1;
     colorBlending.pAttachments    = &colorBlendAttachment;
 
-    // Pipeline layout
+    // Set 0 is GLTFViewer's UBO set, as in the shading layout; sizing goes in a vertex push constant
+    VkDescriptorSetLayout setLayout = m_uniformBuffer->getDescriptorSetLayout();
+    VkPushConstantRange pushConstantRange{};
+    pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+    pushConstantRange.offset     = 0;
+    pushConstantRange.size       = sizeof(PointParams);
+
     VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
-    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-    pipelineLayoutInfo.setLayoutCount = 1;
-    VkDescriptorSetLayout descriptorSetLayout = m_uniformBuffer->getDescriptorSetLayout();
-    pipelineLayoutInfo.pSetLayouts = &descriptorSetLayout;
+    pipelineLayoutInfo.sType                  = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount         = 1;
+    pipelineLayoutInfo.pSetLayouts            = &setLayout;
+    pipelineLayoutInfo.pushConstantRangeCount = 1;
+    pipelineLayoutInfo.pPushConstantRanges    = &pushConstantRange;
 
-    if (vkCreatePipelineLayout(m_device->getDevice(), &pipelineLayoutInfo, nullptr, &m_pipelineLayout) != VK_SUCCESS) {
-        throw std::runtime_error("Failed to create pipeline layout");
+    if (vkCreatePipelineLayout(m_device->getDevice(), &pipelineLayoutInfo, nullptr, &m_pointsPipelineLayout)
+        != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create points pipeline layout");
     }
 
-    // Create the graphics pipeline
     VkGraphicsPipelineCreateInfo pipelineInfo{};
     pipelineInfo.sType               = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
     pipelineInfo.stageCount          = 2;
@@ -207,39 +682,323 @@ void GraphicsPipeline::createGraphicsPipeline() {
     pipelineInfo.pMultisampleState   = &multisampling;
     pipelineInfo.pDepthStencilState  = &depthStencil;
     pipelineInfo.pColorBlendState    = &colorBlending;
-    pipelineInfo.pDynamicState       = nullptr;
-    pipelineInfo.layout              = m_pipelineLayout;
-    pipelineInfo.renderPass          = m_renderPass->getRenderPass();
+    pipelineInfo.pDynamicState       = &dynamicState;
+    pipelineInfo.layout              = m_pointsPipelineLayout;
     pipelineInfo.subpass             = 0;
-    pipelineInfo.basePipelineHandle  = VK_NULL_HANDLE;
 
-    if (vkCreateGraphicsPipelines(m_device->getDevice(), VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &m_graphicsPipeline)
-        != VK_SUCCESS) {
-        throw std::runtime_error("Failed to create graphics pipeline");
+    // Same attachments as the forward pass
+    VkFormat colorFormat = PostProcessor::HDR_FORMAT;
+    VkPipelineRenderingCreateInfo renderingInfo{};
+    renderingInfo.sType                   = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO;
+    renderingInfo.colorAttachmentCount    = 1;
+    renderingInfo.pColorAttachmentFormats = &colorFormat;
+    renderingInfo.depthAttachmentFormat   = RenderPass::DEPTH_FORMAT;
+
+    if (m_sceneRenderPass) {
+        pipelineInfo.renderPass = m_sceneRenderPass->getRenderPass();
+    } else {
+        pipelineInfo.pNext      = &renderingInfo;
+        pipelineInfo.renderPass = VK_NULL_HANDLE;
     }
 
-    std::cout << "Successfully created graphics pipeline\n" << std::endl;
+    if (vkCreateGraphicsPipelines(m_device->getDevice(), VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &m_pointsPipeline)
+        != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create points pipeline");
+    }
 
-    // Cleanup shader modules
     vkDestroyShaderModule(m_device->getDevice(), fragShaderModule, nullptr);
     vkDestroyShaderModule(m_device->getDevice(), vertShaderModule, nullptr);
-    std::cout << "Cleaned up shader modules\n" << std::endl;
+    std::cout << "Successfully created points pipeline" << std::endl;
 }
 
-void GraphicsPipeline::createCommandBuffers() {
-    // Get all framebuffers
-    std::vector<VkFramebuffer> framebuffers;
-    for (size_t i = 0; i < m_framebuffer->size(); i++) {
-        framebuffers.push_back(m_framebuffer->getFramebuffer(i));
-    }
-
-    // Create and record command buffers with pipeline binding
-    m_commandBuffer->createCommandBuffers(
-        m_renderPass->getRenderPass(),
-        framebuffers,
-        m_swapChain->getExtent(),
-        m_graphicsPipeline,
-        m_pipelineLayout,
-        m_uniformBuffer->getDescriptorSet()
-    );
+void GraphicsPipeline::createShadowPipeline() {
+    auto vertShaderPath = std::filesystem::current_path() / "shaders" / "shadow.vert.spv";
+    std::cout << "Loading shadow shader from: " << vertShaderPath << std::endl;
+
+    auto vertShaderCode = readShaderFile(vertShaderPath.string());
+    VkShaderModule vertShaderModule = createShaderModule(vertShaderCode);
+
+    VkPipelineShaderStageCreateInfo vertShaderStageInfo{};
+    vertShaderStageInfo.sType  = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    vertShaderStageInfo.stage  = VK_SHADER_STAGE_VERTEX_BIT;
+    vertShaderStageInfo.module = vertShaderModule;
+    vertShaderStageInfo.pName  = "main";
+
+    // Same position stream as the depth prepass
+    VkVertexInputBindingDescription bindingDescription{};
+    bindingDescription.binding   = 0;
+    bindingDescription.stride    = sizeof(glm::vec3);
+    bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+
+    VkVertexInputAttributeDescription attributeDescription{};
+    attributeDescription.binding  = 0;
+    attributeDescription.location = 0;
+    attributeDescription.format   = VK_FORMAT_R32G32B32_SFLOAT;
+    attributeDescription.offset   = 0;
+
+    VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
+    vertexInputInfo.sType                           = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+    vertexInputInfo.vertexBindingDescriptionCount   = 1;
+    vertexInputInfo.pVertexBindingDescriptions      = &bindingDescription;
+    vertexInputInfo.vertexAttributeDescriptionCount = 1;
+    vertexInputInfo.pVertexAttributeDescriptions    = &attributeDescription;
+
+    VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
+    inputAssembly.sType                  = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+    inputAssembly.topology               = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+    inputAssembly.primitiveRestartEnable = VK_FALSE;
+
+    VkViewport viewport{};
+    viewport.x        = 0.0f;
+    viewport.y        = 0.0f;
+    viewport.width    = (float) CascadedShadowMaps::MAP_SIZE;
+    viewport.height   = (float) CascadedShadowMaps::MAP_SIZE;
+    viewport.minDepth = 0.0f;
+    viewport.maxDepth = 1.0f;
+
+    VkRect2D scissor{};
+    scissor.offset = {0, 0};
+    scissor.extent = {CascadedShadowMaps::MAP_SIZE, CascadedShadowMaps::MAP_SIZE};
+
+    VkPipelineViewportStateCreateInfo viewportState{};
+    viewportState.sType         = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+    viewportState.viewportCount = 1;
+    viewportState.pViewports    = &viewport;
+    viewportState.scissorCount  = 1;
+    viewportState.pScissors     = &scissor;
+
+    // glTF assets are often single-sided, so both faces cast; the bias handles acne
+    VkPipelineRasterizationStateCreateInfo rasterizer{};
+    rasterizer.sType                   = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+    rasterizer.depthClampEnable        = VK_FALSE;
+    rasterizer.rasterizerDiscardEnable = VK_FALSE;
+    rasterizer.polygonMode             = VK_POLYGON_MODE_FILL;
+    rasterizer.lineWidth               = 1.0f;
+    rasterizer.cullMode                = VK_CULL_MODE_NONE;
+    rasterizer.frontFace               = VK_FRONT_FACE_CLOCKWISE;
+    rasterizer.depthBiasEnable         = VK_TRUE;
+    rasterizer.depthBiasConstantFactor = 1.25f;
+    rasterizer.depthBiasSlopeFactor    = 1.75f;
+
+    VkPipelineMultisampleStateCreateInfo multisampling{};
+    multisampling.sType                = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+    multisampling.sampleShadingEnable  = VK_FALSE;
+    multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+
+    VkPipelineDepthStencilStateCreateInfo depthStencil{};
+    depthStencil.sType                 = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+    depthStencil.depthTestEnable       = VK_TRUE;
+    depthStencil.depthWriteEnable      = VK_TRUE;
+    depthStencil.depthCompareOp        = VK_COMPARE_OP_LESS;
+    depthStencil.depthBoundsTestEnable = VK_FALSE;
+    depthStencil.stencilTestEnable     = VK_FALSE;
+
+    VkPipelineColorBlendStateCreateInfo colorBlending{};
+    colorBlending.sType           = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+    colorBlending.logicOpEnable   = VK_FALSE;
+    colorBlending.attachmentCount = 0;
+
+    VkPushConstantRange pushConstantRange{};
+    pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+    pushConstantRange.offset     = 0;
+    pushConstantRange.size       = sizeof(glm::mat4);
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType                  = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.pushConstantRangeCount = 1;
+    pipelineLayoutInfo.pPushConstantRanges    = &pushConstantRange;
+
+    if (vkCreatePipelineLayout(m_device->getDevice(), &pipelineLayoutInfo, nullptr, &m_shadowPipelineLayout) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create shadow pipeline layout");
+    }
+
+    VkGraphicsPipelineCreateInfo pipelineInfo{};
+    pipelineInfo.sType               = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+    pipelineInfo.stageCount          = 1;
+    pipelineInfo.pStages             = &vertShaderStageInfo;
+    pipelineInfo.pVertexInputState   = &vertexInputInfo;
+    pipelineInfo.pInputAssemblyState = &inputAssembly;
+    pipelineInfo.pViewportState      = &viewportState;
+    pipelineInfo.pRasterizationState = &rasterizer;
+    pipelineInfo.pMultisampleState   = &multisampling;
+    pipelineInfo.pDepthStencilState  = &depthStencil;
+    pipelineInfo.pColorBlendState    = &colorBlending;
+    pipelineInfo.layout              = m_shadowPipelineLayout;
+    pipelineInfo.subpass             = 0;
+
+    VkPipelineRenderingCreateInfo renderingInfo{};
+    renderingInfo.sType                 = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO;
+    renderingInfo.colorAttachmentCount  = 0;
+    renderingInfo.depthAttachmentFormat = CascadedShadowMaps::FORMAT;
+
+    // Shadow maps share the depth format, so the depth-only pass is compatible
+    if (m_depthRenderPass) {
+        pipelineInfo.renderPass = m_depthRenderPass->getRenderPass();
+    } else {
+        pipelineInfo.pNext      = &renderingInfo;
+        pipelineInfo.renderPass = VK_NULL_HANDLE;
+    }
+
+    if (vkCreateGraphicsPipelines(m_device->getDevice(), VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &m_shadowPipeline)
+        != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create shadow pipeline");
+    }
+
+    vkDestroyShaderModule(m_device->getDevice(), vertShaderModule, nullptr);
+    std::cout << "Successfully created shadow pipeline" << std::endl;
+}
+
+void GraphicsPipeline::createOitCompositePipeline() {
+    // Weighted average over the opaque image; the scene color's alpha is left alone
+    VkPipelineColorBlendAttachmentState colorBlendAttachment{};
+    colorBlendAttachment.colorWriteMask      = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT;
+    colorBlendAttachment.blendEnable         = VK_TRUE;
+    colorBlendAttachment.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+    colorBlendAttachment.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+    colorBlendAttachment.colorBlendOp        = VK_BLEND_OP_ADD;
+    colorBlendAttachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
+    colorBlendAttachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+    colorBlendAttachment.alphaBlendOp        = VK_BLEND_OP_ADD;
+
+    // Same attachments as the forward pass: scene color plus depth
+    m_oitCompositePipeline = createFullscreenPipeline("oit_composite.frag.spv", m_oitCompositeLayout,
+                                                      PostProcessor::HDR_FORMAT, m_sceneRenderPass.get(),
+                                                      colorBlendAttachment, nullptr, m_oitCompositePipelineLayout);
+    std::cout << "Successfully created OIT composite pipeline" << std::endl;
+}
+
+void GraphicsPipeline::createPresentPipeline() {
+    VkPipelineColorBlendAttachmentState colorBlendAttachment{};
+    colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT |
+                                          VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+    colorBlendAttachment.blendEnable    = VK_FALSE;
+
+    // The post chain already encoded for display; an sRGB swap chain would encode again on write
+    VkFormat swapChainFormat = m_swapChain->getImageFormat();
+    VkBool32 srgbTarget = swapChainFormat == VK_FORMAT_B8G8R8A8_SRGB || swapChainFormat == VK_FORMAT_R8G8B8A8_SRGB ||
+                          swapChainFormat == VK_FORMAT_A8B8G8R8_SRGB_PACK32;
+    VkSpecializationMapEntry srgbEntry{0, 0, sizeof(VkBool32)};
+    VkSpecializationInfo specialization{1, &srgbEntry, sizeof(VkBool32), &srgbTarget};
+
+    // Drawn into the swap chain by the UI pass, before the interface
+    m_presentPipeline = createFullscreenPipeline("present.frag.spv", m_presentLayout, swapChainFormat,
+                                                 m_renderPass.get(), colorBlendAttachment, &specialization,
+                                                 m_presentPipelineLayout);
+    std::cout << "Successfully created present pipeline" << std::endl;
+}
+
+VkPipeline GraphicsPipeline::createFullscreenPipeline(const std::string& fragmentShader, VkDescriptorSetLayout setLayout,
+                                                      VkFormat colorFormat, RenderPass* renderPass,
+                                                      const VkPipelineColorBlendAttachmentState& blendState,
+                                                      const VkSpecializationInfo* specialization,
+                                                      VkPipelineLayout& pipelineLayout) {
+    auto shaderDir = std::filesystem::current_path() / "shaders";
+    std::cout << "Loading fullscreen shaders from: " << shaderDir << " (" << fragmentShader << ")" << std::endl;
+
+    VkShaderModule vertShaderModule = createShaderModule(readShaderFile((shaderDir / "fullscreen.vert.spv").string()));
+    VkShaderModule fragShaderModule = createShaderModule(readShaderFile((shaderDir / fragmentShader).string()));
+
+    VkPipelineShaderStageCreateInfo shaderStages[2]{};
+    shaderStages[0].sType  = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    shaderStages[0].stage  = VK_SHADER_STAGE_VERTEX_BIT;
+    shaderStages[0].module = vertShaderModule;
+    shaderStages[0].pName  = "main";
+    shaderStages[1].sType  = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    shaderStages[1].stage  = VK_SHADER_STAGE_FRAGMENT_BIT;
+    shaderStages[1].module = fragShaderModule;
+    shaderStages[1].pName  = "main";
+    shaderStages[1].pSpecializationInfo = specialization;
+
+    // The triangle comes from gl_VertexIndex
+    VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
+    vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+
+    VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
+    inputAssembly.sType                  = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+    inputAssembly.topology               = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+    inputAssembly.primitiveRestartEnable = VK_FALSE;
+
+    VkPipelineViewportStateCreateInfo viewportState{};
+    viewportState.sType         = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+    viewportState.viewportCount = 1;
+    viewportState.scissorCount  = 1;
+
+    // Runs at whatever size the target has this frame
+    VkDynamicState dynamicStates[] = {VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR};
+    VkPipelineDynamicStateCreateInfo dynamicState{};
+    dynamicState.sType             = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+    dynamicState.dynamicStateCount = 2;
+    dynamicState.pDynamicStates    = dynamicStates;
+
+    VkPipelineRasterizationStateCreateInfo rasterizer{};
+    rasterizer.sType                   = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+    rasterizer.depthClampEnable        = VK_FALSE;
+    rasterizer.rasterizerDiscardEnable = VK_FALSE;
+    rasterizer.polygonMode             = VK_POLYGON_MODE_FILL;
+    rasterizer.lineWidth               = 1.0f;
+    rasterizer.cullMode                = VK_CULL_MODE_NONE;
+    rasterizer.frontFace               = VK_FRONT_FACE_CLOCKWISE;
+
+    VkPipelineMultisampleStateCreateInfo multisampling{};
+    multisampling.sType                = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+    multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+
+    // Depth stays attached for render pass compatibility but is neither tested nor written
+    VkPipelineDepthStencilStateCreateInfo depthStencil{};
+    depthStencil.sType            = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+    depthStencil.depthTestEnable  = VK_FALSE;
+    depthStencil.depthWriteEnable = VK_FALSE;
+
+    VkPipelineColorBlendStateCreateInfo colorBlending{};
+    colorBlending.sType           = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+    colorBlending.logicOpEnable   = VK_FALSE;
+    colorBlending.attachmentCount = 1;
+    colorBlending.pAttachments    = &blendState;
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType          = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = 1;
+    pipelineLayoutInfo.pSetLayouts    = &setLayout;
+
+    if (vkCreatePipelineLayout(m_device->getDevice(), &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create fullscreen pipeline layout");
+    }
+
+    VkGraphicsPipelineCreateInfo pipelineInfo{};
+    pipelineInfo.sType               = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+    pipelineInfo.stageCount          = 2;
+    pipelineInfo.pStages             = shaderStages;
+    pipelineInfo.pVertexInputState   = &vertexInputInfo;
+    pipelineInfo.pInputAssemblyState = &inputAssembly;
+    pipelineInfo.pViewportState      = &viewportState;
+    pipelineInfo.pRasterizationState = &rasterizer;
+    pipelineInfo.pMultisampleState   = &multisampling;
+    pipelineInfo.pDepthStencilState  = &depthStencil;
+    pipelineInfo.pColorBlendState    = &colorBlending;
+    pipelineInfo.pDynamicState       = &dynamicState;
+    pipelineInfo.layout              = pipelineLayout;
+    pipelineInfo.subpass             = 0;
+
+    VkPipelineRenderingCreateInfo renderingInfo{};
+    renderingInfo.sType                   = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO;
+    renderingInfo.colorAttachmentCount    = 1;
+    renderingInfo.pColorAttachmentFormats = &colorFormat;
+    renderingInfo.depthAttachmentFormat   = RenderPass::DEPTH_FORMAT;
+
+    if (renderPass) {
+        pipelineInfo.renderPass = renderPass->getRenderPass();
+    } else {
+        pipelineInfo.pNext      = &renderingInfo;
+        pipelineInfo.renderPass = VK_NULL_HANDLE;
+    }
+
+    VkPipeline pipeline = VK_NULL_HANDLE;
+    if (vkCreateGraphicsPipelines(m_device->getDevice(), VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pipeline)
+        != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create fullscreen pipeline");
+    }
+
+    vkDestroyShaderModule(m_device->getDevice(), fragShaderModule, nullptr);
+    vkDestroyShaderModule(m_device->getDevice(), vertShaderModule, nullptr);
+    return pipeline;
 }
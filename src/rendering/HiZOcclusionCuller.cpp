@@ -0,0 +1,546 @@
+#include "rendering/HiZOcclusionCuller.h"
+#include "core/CommandContext.h"
+#include "core/DeletionQueue.h"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+namespace {
+constexpr uint32_t CULL_GROUP_SIZE = 64;
+constexpr uint32_t BUILD_GROUP_SIZE = 8;
+
+// Level 0 halves the depth buffer; each level after that halves the one before
+VkExtent2D levelExtent(VkExtent2D depthExtent, uint32_t level) {
+    return {std::max(depthExtent.width >> (level + 1), 1u), std::max(depthExtent.height >> (level + 1), 1u)};
+}
+}
+
+HiZOcclusionCuller::HiZOcclusionCuller(VulkanDevice* device) : m_device(device) {
+    createSampler();
+    createDescriptors();
+    createFrameBuffers();
+    createObjectBuffers(1);
+
+    m_buildPipeline = std::make_unique<ComputePipeline>(device, "hiz_build.comp",
+                                                        std::vector<VkDescriptorSetLayout>{m_buildSetLayout},
+                                                        static_cast<uint32_t>(sizeof(BuildParams)));
+
+    // Both phases share one shader; the late phase is a specialization of it
+    VkSpecializationMapEntry mapEntry{0, 0, sizeof(VkBool32)};
+    VkBool32 latePhase = VK_FALSE;
+    VkSpecializationInfo specialization{1, &mapEntry, sizeof(VkBool32), &latePhase};
+    std::vector<VkDescriptorSetLayout> cullLayouts{m_cullSetLayout};
+    m_earlyPipeline = std::make_unique<ComputePipeline>(device, "occlusion_cull.comp", cullLayouts, 0, &specialization);
+    latePhase = VK_TRUE;
+    m_latePipeline = std::make_unique<ComputePipeline>(device, "occlusion_cull.comp", cullLayouts, 0, &specialization);
+
+    std::cout << "HiZOcclusionCuller: Two-phase culling, up to " << MAX_LEVELS << " pyramid levels" << std::endl;
+}
+
+HiZOcclusionCuller::~HiZOcclusionCuller() {
+    VkDevice device = m_device->getDevice();
+    m_buildPipeline.reset();
+    m_earlyPipeline.reset();
+    m_latePipeline.reset();
+
+    for (VkImageView view : m_levelViews) {
+        if (view != VK_NULL_HANDLE) vkDestroyImageView(device, view, nullptr);
+    }
+    if (m_pyramidView != VK_NULL_HANDLE) vkDestroyImageView(device, m_pyramidView, nullptr);
+    if (m_pyramid != VK_NULL_HANDLE) vkDestroyImage(device, m_pyramid, nullptr);
+    if (m_pyramidMemory != VK_NULL_HANDLE) vkFreeMemory(device, m_pyramidMemory, nullptr);
+
+    std::array<std::pair<VkBuffer, VkDeviceMemory>, 6> buffers{{
+        {m_frameBuffer, m_frameMemory},
+        {m_statisticsBuffer, m_statisticsMemory},
+        {m_objectBuffer, m_objectMemory},
+        {m_earlyCommandBuffer, m_earlyCommandMemory},
+        {m_lateCommandBuffer, m_lateCommandMemory},
+        {m_rejectedBuffer, m_rejectedMemory},
+    }};
+    for (const auto& [buffer, memory] : buffers) {
+        if (buffer != VK_NULL_HANDLE) vkDestroyBuffer(device, buffer, nullptr);
+        if (memory != VK_NULL_HANDLE) vkFreeMemory(device, memory, nullptr);
+    }
+
+    if (m_descriptorPool != VK_NULL_HANDLE) {
+        vkDestroyDescriptorPool(device, m_descriptorPool, nullptr);
+    }
+    if (m_cullSetLayout != VK_NULL_HANDLE) {
+        vkDestroyDescriptorSetLayout(device, m_cullSetLayout, nullptr);
+    }
+    if (m_buildSetLayout != VK_NULL_HANDLE) {
+        vkDestroyDescriptorSetLayout(device, m_buildSetLayout, nullptr);
+    }
+    if (m_sampler != VK_NULL_HANDLE) {
+        vkDestroySampler(device, m_sampler, nullptr);
+    }
+}
+
+void HiZOcclusionCuller::createSampler() {
+    // Depth and pyramid are only read with texelFetch
+    VkSamplerCreateInfo samplerInfo{};
+    samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    samplerInfo.magFilter = VK_FILTER_NEAREST;
+    samplerInfo.minFilter = VK_FILTER_NEAREST;
+    samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+    samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.minLod = 0.0f;
+    samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+
+    if (vkCreateSampler(m_device->getDevice(), &samplerInfo, nullptr, &m_sampler) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create Hi-Z sampler!");
+    }
+}
+
+void HiZOcclusionCuller::createDescriptors() {
+    VkDevice device = m_device->getDevice();
+
+    // Cull: 0 frame uniforms, 1 objects, 2 early commands, 3 late commands,
+    // 4 rejected flags, 5 statistics, 6 pyramid
+    std::array<VkDescriptorSetLayoutBinding, 7> cullBindings{};
+    for (uint32_t i = 0; i < cullBindings.size(); i++) {
+        cullBindings[i].binding = i;
+        cullBindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        cullBindings[i].descriptorCount = 1;
+        cullBindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    }
+    cullBindings[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    cullBindings[6].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = static_cast<uint32_t>(cullBindings.size());
+    layoutInfo.pBindings = cullBindings.data();
+
+    if (vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &m_cullSetLayout) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create occlusion cull descriptor set layout!");
+    }
+
+    // Build: 0 depth, 1 source level, 2 destination level
+    std::array<VkDescriptorSetLayoutBinding, 3> buildBindings{};
+    for (uint32_t i = 0; i < buildBindings.size(); i++) {
+        buildBindings[i].binding = i;
+        buildBindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+        buildBindings[i].descriptorCount = 1;
+        buildBindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    }
+    buildBindings[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+
+    layoutInfo.bindingCount = static_cast<uint32_t>(buildBindings.size());
+    layoutInfo.pBindings = buildBindings.data();
+
+    if (vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &m_buildSetLayout) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create Hi-Z build descriptor set layout!");
+    }
+
+    std::array<VkDescriptorPoolSize, 4> poolSizes{};
+    poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    poolSizes[0].descriptorCount = RING_SLOTS;
+    poolSizes[1].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    poolSizes[1].descriptorCount = 5 * RING_SLOTS;
+    poolSizes[2].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    poolSizes[2].descriptorCount = RING_SLOTS * (1 + MAX_LEVELS);
+    poolSizes[3].type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    poolSizes[3].descriptorCount = RING_SLOTS * MAX_LEVELS * 2;
+
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+    poolInfo.pPoolSizes = poolSizes.data();
+    poolInfo.maxSets = RING_SLOTS * (1 + MAX_LEVELS);
+
+    if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &m_descriptorPool) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create Hi-Z descriptor pool!");
+    }
+
+    std::array<VkDescriptorSetLayout, RING_SLOTS> cullLayouts;
+    cullLayouts.fill(m_cullSetLayout);
+
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = m_descriptorPool;
+    allocInfo.descriptorSetCount = RING_SLOTS;
+    allocInfo.pSetLayouts = cullLayouts.data();
+
+    if (vkAllocateDescriptorSets(device, &allocInfo, m_cullSets.data()) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to allocate occlusion cull descriptor sets!");
+    }
+
+    std::array<VkDescriptorSetLayout, MAX_LEVELS> buildLayouts;
+    buildLayouts.fill(m_buildSetLayout);
+    allocInfo.descriptorSetCount = MAX_LEVELS;
+    allocInfo.pSetLayouts = buildLayouts.data();
+    for (auto& slotSets : m_buildSets) {
+        if (vkAllocateDescriptorSets(device, &allocInfo, slotSets.data()) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to allocate Hi-Z build descriptor sets!");
+        }
+    }
+}
+
+void HiZOcclusionCuller::createFrameBuffers() {
+    VkDevice device = m_device->getDevice();
+    VkMemoryPropertyFlags hostVisible = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(m_device->getPhysicalDevice(), &properties);
+    VkDeviceSize alignment = std::max<VkDeviceSize>(properties.limits.minUniformBufferOffsetAlignment, 1);
+    m_frameSlotSize = (sizeof(CullFrame) + alignment - 1) / alignment * alignment;
+
+    createBuffer(m_frameSlotSize * RING_SLOTS, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, hostVisible,
+                 m_frameBuffer, m_frameMemory);
+    vkMapMemory(device, m_frameMemory, 0, m_frameSlotSize * RING_SLOTS, 0, &m_frameMapped);
+
+    // The cull passes count into their slot; the CPU reads a slot back just before reusing it
+    VkDeviceSize statisticsSize = sizeof(glm::uvec4) * RING_SLOTS;
+    createBuffer(statisticsSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, hostVisible,
+                 m_statisticsBuffer, m_statisticsMemory);
+    void* statistics;
+    vkMapMemory(device, m_statisticsMemory, 0, statisticsSize, 0, &statistics);
+    m_statisticsMapped = static_cast<glm::uvec4*>(statistics);
+    std::memset(m_statisticsMapped, 0, statisticsSize);
+}
+
+void HiZOcclusionCuller::createObjectBuffers(uint32_t capacity) {
+    m_capacity = capacity;
+    createBuffer(sizeof(DrawObject) * capacity, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                 VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                 m_objectBuffer, m_objectMemory);
+    createBuffer(getCommandBufferSize(), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+                 VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_earlyCommandBuffer, m_earlyCommandMemory);
+    createBuffer(getCommandBufferSize(), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+                 VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_lateCommandBuffer, m_lateCommandMemory);
+    createBuffer(getRejectedBufferSize(), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                 VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_rejectedBuffer, m_rejectedMemory);
+}
+
+void HiZOcclusionCuller::setObjects(const std::vector<DrawObject>& objects) {
+    // Frames in flight still cull into and draw from the old buffers, so all of them are retired
+    VkDevice device = m_device->getDevice();
+    std::array<std::pair<VkBuffer, VkDeviceMemory>, 4> oldBuffers{{
+        {m_objectBuffer, m_objectMemory},
+        {m_earlyCommandBuffer, m_earlyCommandMemory},
+        {m_lateCommandBuffer, m_lateCommandMemory},
+        {m_rejectedBuffer, m_rejectedMemory},
+    }};
+    m_device->getDeletionQueue()->push([device, oldBuffers]() {
+        for (const auto& [buffer, memory] : oldBuffers) {
+            vkDestroyBuffer(device, buffer, nullptr);
+            vkFreeMemory(device, memory, nullptr);
+        }
+    });
+
+    uint32_t count = static_cast<uint32_t>(objects.size());
+    createObjectBuffers(std::max(count, 1u));
+
+    if (count > 0) {
+        void* data;
+        vkMapMemory(device, m_objectMemory, 0, sizeof(DrawObject) * count, 0, &data);
+        std::memcpy(data, objects.data(), sizeof(DrawObject) * count);
+        vkUnmapMemory(device, m_objectMemory);
+    }
+    m_objectCount = count;
+    // The old depth belongs to a different scene
+    m_historyValid = false;
+
+    std::cout << "HiZOcclusionCuller: " << count << " draw object(s)" << std::endl;
+}
+
+void HiZOcclusionCuller::resize(VkExtent2D outputExtent) {
+    if (m_pyramid != VK_NULL_HANDLE && outputExtent.width == m_outputExtent.width &&
+        outputExtent.height == m_outputExtent.height) {
+        return;
+    }
+    retirePyramid();
+    createPyramid(outputExtent);
+    m_outputExtent = outputExtent;
+    m_historyValid = false;
+}
+
+uint32_t HiZOcclusionCuller::levelCount(VkExtent2D depthExtent) {
+    VkExtent2D base = levelExtent(depthExtent, 0);
+    uint32_t levels = 1;
+    for (uint32_t size = std::max(base.width, base.height); size > 1; size >>= 1) {
+        levels++;
+    }
+    return std::min(levels, MAX_LEVELS);
+}
+
+void HiZOcclusionCuller::beginFrame(const glm::mat4& viewProjection, VkExtent2D renderExtent) {
+    m_slot = (m_slot + 1) % RING_SLOTS;
+
+    // This slot's counters were last written RING_SLOTS frames ago and are complete
+    const glm::uvec4& counters = m_statisticsMapped[m_slot];
+    m_stats.objects = m_objectCount;
+    m_stats.drawnEarly = counters.x;
+    m_stats.drawnLate = counters.y;
+    m_stats.occluded = counters.z;
+    m_stats.outsideFrustum = counters.w;
+    m_statisticsMapped[m_slot] = glm::uvec4(0);
+
+    m_depthExtent = renderExtent;
+    m_frameLevels = std::min(levelCount(renderExtent), m_pyramidLevels);
+
+    CullFrame frame{};
+    frame.viewProj = viewProjection;
+    frame.historyViewProj = m_historyViewProj;
+    frame.pyramid = glm::uvec4(renderExtent.width, renderExtent.height, m_frameLevels, 0);
+    frame.historyPyramid = glm::uvec4(m_historyExtent.width, m_historyExtent.height, m_historyLevels,
+                                      m_historyValid ? 1 : 0);
+    frame.counts = glm::uvec4(m_objectCount, m_slot, 0, 0);
+    std::memcpy(static_cast<char*>(m_frameMapped) + m_frameSlotSize * m_slot, &frame, sizeof(CullFrame));
+
+    VkDescriptorBufferInfo frameInfo{m_frameBuffer, m_frameSlotSize * m_slot, sizeof(CullFrame)};
+    std::array<VkDescriptorBufferInfo, 5> bufferInfos{{
+        {m_objectBuffer, 0, VK_WHOLE_SIZE},
+        {m_earlyCommandBuffer, 0, VK_WHOLE_SIZE},
+        {m_lateCommandBuffer, 0, VK_WHOLE_SIZE},
+        {m_rejectedBuffer, 0, VK_WHOLE_SIZE},
+        {m_statisticsBuffer, 0, VK_WHOLE_SIZE},
+    }};
+    VkDescriptorImageInfo pyramidInfo{m_sampler, m_pyramidView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
+
+    std::array<VkWriteDescriptorSet, 7> writes{};
+    for (uint32_t i = 0; i < writes.size(); i++) {
+        writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        writes[i].dstSet = m_cullSets[m_slot];
+        writes[i].dstBinding = i;
+        writes[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        writes[i].descriptorCount = 1;
+        if (i >= 1 && i <= 5) {
+            writes[i].pBufferInfo = &bufferInfos[i - 1];
+        }
+    }
+    writes[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    writes[0].pBufferInfo = &frameInfo;
+    writes[6].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    writes[6].pImageInfo = &pyramidInfo;
+    vkUpdateDescriptorSets(m_device->getDevice(), static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+
+    // Next frame's early phase tests against the pyramid this frame builds
+    m_historyViewProj = viewProjection;
+    m_historyExtent = renderExtent;
+    m_historyLevels = m_frameLevels;
+    m_historyValid = true;
+}
+
+void HiZOcclusionCuller::dispatchCull(VkCommandBuffer commandBuffer, const ComputePipeline& pipeline) {
+    if (m_objectCount == 0) {
+        return;
+    }
+    pipeline.bind(commandBuffer);
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline.getPipelineLayout(),
+                            0, 1, &m_cullSets[m_slot], 0, nullptr);
+    vkCmdDispatch(commandBuffer, (m_objectCount + CULL_GROUP_SIZE - 1) / CULL_GROUP_SIZE, 1, 1);
+}
+
+void HiZOcclusionCuller::cullEarly(VkCommandBuffer commandBuffer) {
+    dispatchCull(commandBuffer, *m_earlyPipeline);
+}
+
+void HiZOcclusionCuller::cullLate(VkCommandBuffer commandBuffer) {
+    dispatchCull(commandBuffer, *m_latePipeline);
+}
+
+void HiZOcclusionCuller::buildPyramid(VkCommandBuffer commandBuffer, VkImageView depthView) {
+    VkDevice device = m_device->getDevice();
+    m_buildPipeline->bind(commandBuffer);
+
+    VkExtent2D srcExtent = m_depthExtent;
+    for (uint32_t level = 0; level < m_frameLevels; level++) {
+        VkExtent2D dstExtent = levelExtent(m_depthExtent, level);
+        VkDescriptorSet descriptorSet = m_buildSets[m_slot][level];
+
+        // Level 0 reads depth; its source binding only needs to be valid
+        std::array<VkDescriptorImageInfo, 3> imageInfos{};
+        imageInfos[0] = {m_sampler, depthView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
+        imageInfos[1] = {VK_NULL_HANDLE, m_levelViews[level == 0 ? 0 : level - 1], VK_IMAGE_LAYOUT_GENERAL};
+        imageInfos[2] = {VK_NULL_HANDLE, m_levelViews[level], VK_IMAGE_LAYOUT_GENERAL};
+
+        std::array<VkWriteDescriptorSet, 3> writes{};
+        for (uint32_t i = 0; i < writes.size(); i++) {
+            writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            writes[i].dstSet = descriptorSet;
+            writes[i].dstBinding = i;
+            writes[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+            writes[i].descriptorCount = 1;
+            writes[i].pImageInfo = &imageInfos[i];
+        }
+        writes[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        vkUpdateDescriptorSets(device, static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+
+        BuildParams params{};
+        params.srcSize = glm::ivec2(srcExtent.width, srcExtent.height);
+        params.dstSize = glm::ivec2(dstExtent.width, dstExtent.height);
+        params.level = level;
+
+        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_buildPipeline->getPipelineLayout(),
+                                0, 1, &descriptorSet, 0, nullptr);
+        vkCmdPushConstants(commandBuffer, m_buildPipeline->getPipelineLayout(), VK_SHADER_STAGE_COMPUTE_BIT,
+                           0, sizeof(BuildParams), &params);
+        vkCmdDispatch(commandBuffer, (dstExtent.width + BUILD_GROUP_SIZE - 1) / BUILD_GROUP_SIZE,
+                      (dstExtent.height + BUILD_GROUP_SIZE - 1) / BUILD_GROUP_SIZE, 1);
+
+        // The next level reads this one; the graph orders the last level against the late cull
+        if (level + 1 < m_frameLevels) {
+            VkImageMemoryBarrier barrier{};
+            barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+            barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            barrier.image = m_pyramid;
+            barrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, level, 1, 0, 1};
+            barrier.oldLayout = VK_IMAGE_LAYOUT_GENERAL;
+            barrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+            barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+            barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+            vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                                 0, 0, nullptr, 0, nullptr, 1, &barrier);
+        }
+        srcExtent = dstExtent;
+    }
+}
+
+void HiZOcclusionCuller::createPyramid(VkExtent2D extent) {
+    VkDevice device = m_device->getDevice();
+    m_pyramidExtent = levelExtent(extent, 0);
+    m_pyramidLevels = levelCount(extent);
+
+    VkImageCreateInfo imageInfo{};
+    imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    imageInfo.imageType = VK_IMAGE_TYPE_2D;
+    imageInfo.extent = {m_pyramidExtent.width, m_pyramidExtent.height, 1};
+    imageInfo.mipLevels = m_pyramidLevels;
+    imageInfo.arrayLayers = 1;
+    imageInfo.format = PYRAMID_FORMAT;
+    imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    imageInfo.usage = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+    imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+    imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    if (vkCreateImage(device, &imageInfo, nullptr, &m_pyramid) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create Hi-Z pyramid image!");
+    }
+
+    VkMemoryRequirements memRequirements;
+    vkGetImageMemoryRequirements(device, m_pyramid, &memRequirements);
+
+    VkMemoryAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = memRequirements.size;
+    allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+    if (vkAllocateMemory(device, &allocInfo, nullptr, &m_pyramidMemory) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to allocate Hi-Z pyramid memory!");
+    }
+    vkBindImageMemory(device, m_pyramid, m_pyramidMemory, 0);
+
+    VkImageViewCreateInfo viewInfo{};
+    viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    viewInfo.image = m_pyramid;
+    viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    viewInfo.format = PYRAMID_FORMAT;
+    viewInfo.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, m_pyramidLevels, 0, 1};
+
+    if (vkCreateImageView(device, &viewInfo, nullptr, &m_pyramidView) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create Hi-Z pyramid view!");
+    }
+    for (uint32_t level = 0; level < m_pyramidLevels; level++) {
+        viewInfo.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, level, 1, 0, 1};
+        if (vkCreateImageView(device, &viewInfo, nullptr, &m_levelViews[level]) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to create Hi-Z pyramid level view!");
+        }
+    }
+
+    // The early cull binds the pyramid before it has ever been built (it ignores
+    // the contents then), so it must already be in the layout the graph expects
+    CommandContext context(m_device, VulkanDevice::QueueType::Graphics);
+    VkCommandBuffer commandBuffer = context.begin();
+    VkImageMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = m_pyramid;
+    barrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, m_pyramidLevels, 0, 1};
+    barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    barrier.srcAccessMask = 0;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                         0, 0, nullptr, 0, nullptr, 1, &barrier);
+    context.submitAndWait(commandBuffer);
+
+    std::cout << "HiZOcclusionCuller: Pyramid at " << m_pyramidExtent.width << "x" << m_pyramidExtent.height
+              << ", " << m_pyramidLevels << " levels" << std::endl;
+}
+
+void HiZOcclusionCuller::retirePyramid() {
+    if (m_pyramid == VK_NULL_HANDLE) {
+        return;
+    }
+
+    // Frames in flight may still be building or sampling the old pyramid
+    VkDevice device = m_device->getDevice();
+    VkImage image = m_pyramid;
+    VkDeviceMemory memory = m_pyramidMemory;
+    std::vector<VkImageView> views{m_pyramidView};
+    for (uint32_t level = 0; level < m_pyramidLevels; level++) {
+        views.push_back(m_levelViews[level]);
+    }
+    m_device->getDeletionQueue()->push([device, image, memory, views]() {
+        for (VkImageView view : views) {
+            vkDestroyImageView(device, view, nullptr);
+        }
+        vkDestroyImage(device, image, nullptr);
+        vkFreeMemory(device, memory, nullptr);
+    });
+
+    m_pyramid = VK_NULL_HANDLE;
+    m_pyramidMemory = VK_NULL_HANDLE;
+    m_pyramidView = VK_NULL_HANDLE;
+    m_levelViews = {};
+    m_pyramidLevels = 0;
+}
+
+void HiZOcclusionCuller::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties,
+                                      VkBuffer& buffer, VkDeviceMemory& bufferMemory) {
+    VkBufferCreateInfo bufferInfo{};
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size = size;
+    bufferInfo.usage = usage;
+    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    if (vkCreateBuffer(m_device->getDevice(), &bufferInfo, nullptr, &buffer) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create occlusion culling buffer!");
+    }
+
+    VkMemoryRequirements memRequirements;
+    vkGetBufferMemoryRequirements(m_device->getDevice(), buffer, &memRequirements);
+
+    VkMemoryAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = memRequirements.size;
+    allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
+
+    if (vkAllocateMemory(m_device->getDevice(), &allocInfo, nullptr, &bufferMemory) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to allocate occlusion culling buffer memory!");
+    }
+
+    vkBindBufferMemory(m_device->getDevice(), buffer, bufferMemory, 0);
+}
+
+uint32_t HiZOcclusionCuller::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) {
+    VkPhysicalDeviceMemoryProperties memProperties;
+    vkGetPhysicalDeviceMemoryProperties(m_device->getPhysicalDevice(), &memProperties);
+
+    for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++) {
+        if ((typeFilter & (1 << i)) && (memProperties.memoryTypes[i].propertyFlags & properties) == properties) {
+            return i;
+        }
+    }
+
+    throw std::runtime_error("Failed to find suitable memory type!");
+}
@@ -0,0 +1,872 @@
+#include "rendering/ImageBasedLighting.h"
+#include "rendering/ClusteredLighting.h"
+#include "core/CommandContext.h"
+#include "core/DeletionQueue.h"
+#include "core/QueueOwnership.h"
+#include <glm/gtc/packing.hpp>
+#include <stb_image.h>
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+
+namespace {
+// Bump whenever anything that shapes the cached data changes
+constexpr uint32_t CACHE_VERSION = 1;
+constexpr uint32_t CACHE_MAGIC = 0x43424949; // "IIBC"
+
+constexpr uint32_t CUBE_MIPS = 10; // log2(CUBE_SIZE) + 1
+constexpr uint32_t PREFILTER_SAMPLES = 512;
+constexpr uint32_t IRRADIANCE_FACE_SIZE = 32; // SH projection reads this mip of the cubemap
+
+// Sets still referenced by in-flight frames stay allocated until they retire
+constexpr uint32_t MAX_DESCRIPTOR_SETS = 4;
+// One load uses a conversion set, a prefilter set per mip and an SH set
+constexpr uint32_t MAX_COMPUTE_SETS = ImageBasedLighting::SPECULAR_MIPS + 2;
+
+struct CacheHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t sourceHash;
+    uint32_t size;
+    uint32_t mipLevels;
+    uint32_t shCount;
+    uint32_t reserved;
+};
+
+struct PrefilterParams {
+    float roughness;
+    float sourceSize;
+    uint32_t faceSize;
+    uint32_t sampleCount;
+};
+
+struct IrradianceParams {
+    uint32_t faceSize;
+    float lod;
+};
+
+uint32_t groupCount(uint32_t size) {
+    return (size + 7) / 8;
+}
+}
+
+ImageBasedLighting::ImageBasedLighting(VulkanDevice* device) : m_device(device) {
+    createSamplers();
+    createDescriptorSetLayouts();
+    createDescriptorPool();
+
+    std::vector<VkDescriptorSetLayout> computeLayouts{m_computeSetLayout};
+    m_equirectToCubePipeline = std::make_unique<ComputePipeline>(m_device, "equirect_to_cube.comp", computeLayouts);
+    m_prefilterPipeline = std::make_unique<ComputePipeline>(m_device, "prefilter_env.comp", computeLayouts,
+                                                            static_cast<uint32_t>(sizeof(PrefilterParams)));
+    m_irradiancePipeline = std::make_unique<ComputePipeline>(m_device, "irradiance_sh.comp", computeLayouts,
+                                                             static_cast<uint32_t>(sizeof(IrradianceParams)));
+    m_brdfPipeline = std::make_unique<ComputePipeline>(m_device, "brdf_lut.comp", computeLayouts);
+
+    createBrdfLut();
+
+    // Black placeholder so set 3 is valid before any environment is loaded
+    EnvironmentData placeholder;
+    placeholder.size = 1;
+    placeholder.mipLevels = 1;
+    placeholder.sh.assign(SH_COEFFICIENTS, glm::vec4(0.0f));
+    placeholder.specular.assign(cubeMipBytes(1, 1), 0);
+    m_environment = createEnvironment(placeholder);
+
+    std::cout << "ImageBasedLighting: BRDF LUT ready, no environment loaded" << std::endl;
+}
+
+ImageBasedLighting::~ImageBasedLighting() {
+    VkDevice device = m_device->getDevice();
+
+    // Retired environments free their sets from this pool, so drain them first (the device is idle here)
+    m_device->getDeletionQueue()->flush();
+    destroyEnvironment(device, m_descriptorPool, m_environment);
+
+    m_equirectToCubePipeline.reset();
+    m_prefilterPipeline.reset();
+    m_irradiancePipeline.reset();
+    m_brdfPipeline.reset();
+
+    if (m_brdfLutView != VK_NULL_HANDLE) {
+        vkDestroyImageView(device, m_brdfLutView, nullptr);
+    }
+    if (m_brdfLut != VK_NULL_HANDLE) {
+        vkDestroyImage(device, m_brdfLut, nullptr);
+        vkFreeMemory(device, m_brdfLutMemory, nullptr);
+    }
+    if (m_sampler != VK_NULL_HANDLE) {
+        vkDestroySampler(device, m_sampler, nullptr);
+    }
+    if (m_equirectSampler != VK_NULL_HANDLE) {
+        vkDestroySampler(device, m_equirectSampler, nullptr);
+    }
+    if (m_descriptorPool != VK_NULL_HANDLE) {
+        vkDestroyDescriptorPool(device, m_descriptorPool, nullptr);
+    }
+    if (m_computePool != VK_NULL_HANDLE) {
+        vkDestroyDescriptorPool(device, m_computePool, nullptr);
+    }
+    if (m_descriptorSetLayout != VK_NULL_HANDLE) {
+        vkDestroyDescriptorSetLayout(device, m_descriptorSetLayout, nullptr);
+    }
+    if (m_computeSetLayout != VK_NULL_HANDLE) {
+        vkDestroyDescriptorSetLayout(device, m_computeSetLayout, nullptr);
+    }
+}
+
+void ImageBasedLighting::createSamplers() {
+    VkSamplerCreateInfo samplerInfo{};
+    samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    samplerInfo.magFilter = VK_FILTER_LINEAR;
+    samplerInfo.minFilter = VK_FILTER_LINEAR;
+    samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+    samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.minLod = 0.0f;
+    samplerInfo.maxLod = static_cast<float>(CUBE_MIPS);
+
+    if (vkCreateSampler(m_device->getDevice(), &samplerInfo, nullptr, &m_sampler) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create environment sampler!");
+    }
+
+    // Longitude wraps around, latitude stops at the poles
+    samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+    samplerInfo.maxLod = 0.0f;
+    if (vkCreateSampler(m_device->getDevice(), &samplerInfo, nullptr, &m_equirectSampler) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create equirectangular sampler!");
+    }
+}
+
+void ImageBasedLighting::createDescriptorSetLayouts() {
+    std::array<VkDescriptorSetLayoutBinding, 3> bindings{};
+    bindings[0] = {0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_FRAGMENT_BIT, nullptr};
+    bindings[1] = {1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_FRAGMENT_BIT, nullptr};
+    bindings[2] = {2, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, VK_SHADER_STAGE_FRAGMENT_BIT, nullptr};
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+    layoutInfo.pBindings = bindings.data();
+
+    if (vkCreateDescriptorSetLayout(m_device->getDevice(), &layoutInfo, nullptr, &m_descriptorSetLayout) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create environment descriptor set layout!");
+    }
+
+    // Shared by every precompute shader; each one only uses the bindings it needs
+    std::array<VkDescriptorSetLayoutBinding, 3> computeBindings{};
+    computeBindings[0] = {0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr};
+    computeBindings[1] = {1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr};
+    computeBindings[2] = {2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr};
+
+    layoutInfo.bindingCount = static_cast<uint32_t>(computeBindings.size());
+    layoutInfo.pBindings = computeBindings.data();
+
+    if (vkCreateDescriptorSetLayout(m_device->getDevice(), &layoutInfo, nullptr, &m_computeSetLayout) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create environment compute descriptor set layout!");
+    }
+}
+
+void ImageBasedLighting::createDescriptorPool() {
+    std::array<VkDescriptorPoolSize, 2> poolSizes{};
+    poolSizes[0] = {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 2 * MAX_DESCRIPTOR_SETS};
+    poolSizes[1] = {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, MAX_DESCRIPTOR_SETS};
+
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT;
+    poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+    poolInfo.pPoolSizes = poolSizes.data();
+    poolInfo.maxSets = MAX_DESCRIPTOR_SETS;
+
+    if (vkCreateDescriptorPool(m_device->getDevice(), &poolInfo, nullptr, &m_descriptorPool) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create environment descriptor pool!");
+    }
+
+    // Precompute sets live for one submission and are reset together
+    std::array<VkDescriptorPoolSize, 3> computeSizes{};
+    computeSizes[0] = {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, MAX_COMPUTE_SETS};
+    computeSizes[1] = {VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, MAX_COMPUTE_SETS};
+    computeSizes[2] = {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, MAX_COMPUTE_SETS};
+
+    poolInfo.flags = 0;
+    poolInfo.poolSizeCount = static_cast<uint32_t>(computeSizes.size());
+    poolInfo.pPoolSizes = computeSizes.data();
+    poolInfo.maxSets = MAX_COMPUTE_SETS;
+
+    if (vkCreateDescriptorPool(m_device->getDevice(), &poolInfo, nullptr, &m_computePool) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create environment compute descriptor pool!");
+    }
+}
+
+void ImageBasedLighting::createBrdfLut() {
+    // RGBA16F rather than RG16F: storage support for it is guaranteed
+    createImage(BRDF_LUT_SIZE, BRDF_LUT_SIZE, 1, 1, CUBE_FORMAT,
+                VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, 0, m_brdfLut, m_brdfLutMemory);
+    m_brdfLutView = createImageView(m_brdfLut, VK_IMAGE_VIEW_TYPE_2D, CUBE_FORMAT, 0, 1, 1);
+
+    CommandContext context(m_device, VulkanDevice::QueueType::Graphics);
+    VkCommandBuffer commandBuffer = context.begin();
+
+    transitionImage(commandBuffer, m_brdfLut, 0, 1, 1, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL,
+                    0, VK_ACCESS_SHADER_WRITE_BIT,
+                    VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+
+    VkDescriptorSet set = allocateComputeSet(VK_NULL_HANDLE, VK_NULL_HANDLE, m_brdfLutView, VK_NULL_HANDLE, 0);
+    m_brdfPipeline->bind(commandBuffer);
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_brdfPipeline->getPipelineLayout(),
+                            0, 1, &set, 0, nullptr);
+    vkCmdDispatch(commandBuffer, groupCount(BRDF_LUT_SIZE), groupCount(BRDF_LUT_SIZE), 1);
+
+    transitionImage(commandBuffer, m_brdfLut, 0, 1, 1, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+                    VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT,
+                    VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+
+    context.submitAndWait(commandBuffer);
+    vkResetDescriptorPool(m_device->getDevice(), m_computePool, 0);
+}
+
+bool ImageBasedLighting::loadEnvironment(const std::string& filePath) {
+    auto startTime = std::chrono::high_resolution_clock::now();
+
+    std::ifstream file(filePath, std::ios::ate | std::ios::binary);
+    if (!file.is_open()) {
+        std::cerr << "ImageBasedLighting: Failed to open " << filePath << std::endl;
+        return false;
+    }
+    std::vector<uint8_t> fileData(static_cast<size_t>(file.tellg()));
+    file.seekg(0);
+    file.read(reinterpret_cast<char*>(fileData.data()), static_cast<std::streamsize>(fileData.size()));
+    file.close();
+
+    // Keyed by content, so a renamed or re-downloaded file still hits the cache
+    uint64_t sourceHash = hashBytes(fileData);
+    std::string cachePath = getCachePath(sourceHash);
+
+    EnvironmentData data;
+    bool cached = readCache(cachePath, sourceHash, data);
+    if (!cached) {
+        if (!precompute(fileData, data)) {
+            return false;
+        }
+        writeCache(cachePath, sourceHash, data);
+    }
+
+    // Frames in flight still sample the old environment through the old set
+    VkDevice device = m_device->getDevice();
+    VkDescriptorPool pool = m_descriptorPool;
+    Environment oldEnvironment = m_environment;
+    m_device->getDeletionQueue()->push([device, pool, oldEnvironment]() {
+        destroyEnvironment(device, pool, oldEnvironment);
+    });
+
+    m_environment = createEnvironment(data);
+    m_hasEnvironment = true;
+    m_environmentPath = filePath;
+    m_lastLoadCached = cached;
+    m_lastLoadMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - startTime).count();
+
+    std::cout << "ImageBasedLighting: Loaded " << filePath << (cached ? " from cache" : " (precomputed)")
+              << " in " << m_lastLoadMs << " ms" << std::endl;
+    return true;
+}
+
+bool ImageBasedLighting::precompute(const std::vector<uint8_t>& fileData, EnvironmentData& outData) {
+    int width = 0, height = 0, channels = 0;
+    float* pixels = stbi_loadf_from_memory(fileData.data(), static_cast<int>(fileData.size()),
+                                           &width, &height, &channels, 4);
+    if (!pixels) {
+        std::cerr << "ImageBasedLighting: Failed to decode HDR image: " << stbi_failure_reason() << std::endl;
+        return false;
+    }
+
+    // Half floats are filterable everywhere, 32-bit floats are not
+    size_t texelCount = static_cast<size_t>(width) * height * 4;
+    std::vector<uint16_t> halfPixels(texelCount);
+    for (size_t i = 0; i < texelCount; i++) {
+        halfPixels[i] = glm::packHalf1x16(std::min(pixels[i], 65504.0f));
+    }
+    stbi_image_free(pixels);
+
+    VkDevice device = m_device->getDevice();
+    VkDeviceSize shBytes = sizeof(glm::vec4) * SH_COEFFICIENTS;
+    VkDeviceSize specularBytes = cubeMipBytes(SPECULAR_SIZE, SPECULAR_MIPS);
+
+    // Upload staging, then the readback buffer for the results
+    VkBuffer uploadBuffer, readbackBuffer;
+    VkDeviceMemory uploadMemory, readbackMemory;
+    VkDeviceSize uploadBytes = halfPixels.size() * sizeof(uint16_t);
+    createBuffer(uploadBytes, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                 VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, uploadBuffer, uploadMemory);
+    createBuffer(shBytes + specularBytes, VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                 VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, readbackBuffer, readbackMemory);
+
+    void* mapped;
+    vkMapMemory(device, uploadMemory, 0, uploadBytes, 0, &mapped);
+    memcpy(mapped, halfPixels.data(), static_cast<size_t>(uploadBytes));
+    vkUnmapMemory(device, uploadMemory);
+
+    // Transient images: panorama, full-resolution cubemap with mips, prefiltered output
+    VkImage equirect, cube, specular;
+    VkDeviceMemory equirectMemory, cubeMemory, specularMemory;
+    createImage(static_cast<uint32_t>(width), static_cast<uint32_t>(height), 1, 1, CUBE_FORMAT,
+                VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT, 0, equirect, equirectMemory);
+    createImage(CUBE_SIZE, CUBE_SIZE, CUBE_MIPS, 6, CUBE_FORMAT,
+                VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT |
+                VK_IMAGE_USAGE_TRANSFER_DST_BIT, VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT, cube, cubeMemory);
+    createImage(SPECULAR_SIZE, SPECULAR_SIZE, SPECULAR_MIPS, 6, CUBE_FORMAT,
+                VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT, VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT,
+                specular, specularMemory);
+
+    VkImageView equirectView = createImageView(equirect, VK_IMAGE_VIEW_TYPE_2D, CUBE_FORMAT, 0, 1, 1);
+    VkImageView cubeStorageView = createImageView(cube, VK_IMAGE_VIEW_TYPE_2D_ARRAY, CUBE_FORMAT, 0, 1, 6);
+    VkImageView cubeSampledView = createImageView(cube, VK_IMAGE_VIEW_TYPE_CUBE, CUBE_FORMAT, 0, CUBE_MIPS, 6);
+    std::array<VkImageView, SPECULAR_MIPS> specularViews{};
+    for (uint32_t mip = 0; mip < SPECULAR_MIPS; mip++) {
+        specularViews[mip] = createImageView(specular, VK_IMAGE_VIEW_TYPE_2D_ARRAY, CUBE_FORMAT, mip, 1, 6);
+    }
+
+    VkBuffer shBuffer;
+    VkDeviceMemory shMemory;
+    createBuffer(shBytes, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                 VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, shBuffer, shMemory);
+
+    // Upload, conversion and the blitted mip chain need the graphics queue; the
+    // prefilter and SH projection then run on the compute queue, which is a
+    // dedicated family where the device has one
+    CommandContext graphics(m_device, VulkanDevice::QueueType::Graphics);
+    CommandContext compute(m_device, VulkanDevice::QueueType::Compute);
+    VkCommandBuffer commandBuffer = graphics.begin();
+
+    // Panorama upload
+    transitionImage(commandBuffer, equirect, 0, 1, 1, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                    0, VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+    VkBufferImageCopy upload{};
+    upload.imageSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1};
+    upload.imageExtent = {static_cast<uint32_t>(width), static_cast<uint32_t>(height), 1};
+    vkCmdCopyBufferToImage(commandBuffer, uploadBuffer, equirect, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &upload);
+    transitionImage(commandBuffer, equirect, 0, 1, 1, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                    VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT,
+                    VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+
+    // Panorama to cubemap, top mip
+    transitionImage(commandBuffer, cube, 0, 1, 6, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL,
+                    0, VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+    VkDescriptorSet convertSet = allocateComputeSet(equirectView, m_equirectSampler, cubeStorageView, VK_NULL_HANDLE, 0);
+    m_equirectToCubePipeline->bind(commandBuffer);
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE,
+                            m_equirectToCubePipeline->getPipelineLayout(), 0, 1, &convertSet, 0, nullptr);
+    vkCmdDispatch(commandBuffer, groupCount(CUBE_SIZE), groupCount(CUBE_SIZE), 6);
+
+    // Mip chain by blits; the prefilter reads lower mips for wide lobes to avoid aliasing
+    transitionImage(commandBuffer, cube, 0, 1, 6, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                    VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT,
+                    VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+    for (uint32_t mip = 1; mip < CUBE_MIPS; mip++) {
+        transitionImage(commandBuffer, cube, mip, 1, 6, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                        0, VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+
+        int32_t srcSize = static_cast<int32_t>(CUBE_SIZE >> (mip - 1));
+        int32_t dstSize = static_cast<int32_t>(CUBE_SIZE >> mip);
+        VkImageBlit blit{};
+        blit.srcSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, mip - 1, 0, 6};
+        blit.srcOffsets[1] = {srcSize, srcSize, 1};
+        blit.dstSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, mip, 0, 6};
+        blit.dstOffsets[1] = {dstSize, dstSize, 1};
+        vkCmdBlitImage(commandBuffer, cube, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, cube,
+                       VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &blit, VK_FILTER_LINEAR);
+
+        transitionImage(commandBuffer, cube, mip, 1, 6, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                        VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT,
+                        VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+    }
+    QueueOwnership::releaseImage(commandBuffer, cube, CUBE_MIPS, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                                 VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, graphics.getQueueFamily(),
+                                 compute.getQueueFamily(), VK_ACCESS_TRANSFER_WRITE_BIT,
+                                 VK_PIPELINE_STAGE_TRANSFER_BIT, 6);
+    uint64_t cubeReady = graphics.submit(commandBuffer);
+
+    commandBuffer = compute.begin();
+    QueueOwnership::acquireImage(commandBuffer, cube, CUBE_MIPS, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+                                 VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, graphics.getQueueFamily(),
+                                 compute.getQueueFamily(), VK_ACCESS_SHADER_READ_BIT,
+                                 VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 6);
+
+    // GGX prefilter, one roughness per mip
+    transitionImage(commandBuffer, specular, 0, SPECULAR_MIPS, 6, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_GENERAL,
+                    0, VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+    m_prefilterPipeline->bind(commandBuffer);
+    for (uint32_t mip = 0; mip < SPECULAR_MIPS; mip++) {
+        PrefilterParams params{};
+        params.roughness = static_cast<float>(mip) / static_cast<float>(SPECULAR_MIPS - 1);
+        params.sourceSize = static_cast<float>(CUBE_SIZE);
+        params.faceSize = SPECULAR_SIZE >> mip;
+        params.sampleCount = PREFILTER_SAMPLES;
+
+        VkDescriptorSet set = allocateComputeSet(cubeSampledView, m_sampler, specularViews[mip], VK_NULL_HANDLE, 0);
+        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_prefilterPipeline->getPipelineLayout(),
+                                0, 1, &set, 0, nullptr);
+        vkCmdPushConstants(commandBuffer, m_prefilterPipeline->getPipelineLayout(), VK_SHADER_STAGE_COMPUTE_BIT,
+                           0, sizeof(PrefilterParams), &params);
+        vkCmdDispatch(commandBuffer, groupCount(params.faceSize), groupCount(params.faceSize), 6);
+    }
+
+    // SH9 projection of a low mip for diffuse irradiance
+    IrradianceParams irradianceParams{};
+    irradianceParams.faceSize = IRRADIANCE_FACE_SIZE;
+    irradianceParams.lod = std::log2(static_cast<float>(CUBE_SIZE) / IRRADIANCE_FACE_SIZE);
+    VkDescriptorSet shSet = allocateComputeSet(cubeSampledView, m_sampler, VK_NULL_HANDLE, shBuffer, shBytes);
+    m_irradiancePipeline->bind(commandBuffer);
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_irradiancePipeline->getPipelineLayout(),
+                            0, 1, &shSet, 0, nullptr);
+    vkCmdPushConstants(commandBuffer, m_irradiancePipeline->getPipelineLayout(), VK_SHADER_STAGE_COMPUTE_BIT,
+                       0, sizeof(IrradianceParams), &irradianceParams);
+    vkCmdDispatch(commandBuffer, 1, 1, 1);
+
+    // Read everything back for the cache; the same bytes are then uploaded like a cache hit
+    transitionImage(commandBuffer, specular, 0, SPECULAR_MIPS, 6, VK_IMAGE_LAYOUT_GENERAL,
+                    VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT,
+                    VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+    VkBufferMemoryBarrier shBarrier{};
+    shBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    shBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    shBarrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    shBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    shBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    shBarrier.buffer = shBuffer;
+    shBarrier.offset = 0;
+    shBarrier.size = shBytes;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         0, 0, nullptr, 1, &shBarrier, 0, nullptr);
+
+    VkBufferCopy shCopy{0, 0, shBytes};
+    vkCmdCopyBuffer(commandBuffer, shBuffer, readbackBuffer, 1, &shCopy);
+
+    std::vector<VkBufferImageCopy> regions(SPECULAR_MIPS);
+    VkDeviceSize offset = shBytes;
+    for (uint32_t mip = 0; mip < SPECULAR_MIPS; mip++) {
+        uint32_t faceSize = SPECULAR_SIZE >> mip;
+        regions[mip].bufferOffset = offset;
+        regions[mip].imageSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, mip, 0, 6};
+        regions[mip].imageExtent = {faceSize, faceSize, 1};
+        offset += cubeMipBytes(faceSize, 1);
+    }
+    vkCmdCopyImageToBuffer(commandBuffer, specular, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, readbackBuffer,
+                           static_cast<uint32_t>(regions.size()), regions.data());
+
+    compute.submitAndWait(commandBuffer, {{graphics.getTimeline(), cubeReady, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT}});
+
+    outData.size = SPECULAR_SIZE;
+    outData.mipLevels = SPECULAR_MIPS;
+    outData.sh.resize(SH_COEFFICIENTS);
+    outData.specular.resize(static_cast<size_t>(specularBytes));
+    vkMapMemory(device, readbackMemory, 0, shBytes + specularBytes, 0, &mapped);
+    memcpy(outData.sh.data(), mapped, static_cast<size_t>(shBytes));
+    memcpy(outData.specular.data(), static_cast<char*>(mapped) + shBytes, static_cast<size_t>(specularBytes));
+    vkUnmapMemory(device, readbackMemory);
+
+    // The submission has completed, so the transient resources can go right away
+    vkResetDescriptorPool(device, m_computePool, 0);
+    for (VkImageView view : specularViews) {
+        vkDestroyImageView(device, view, nullptr);
+    }
+    vkDestroyImageView(device, cubeSampledView, nullptr);
+    vkDestroyImageView(device, cubeStorageView, nullptr);
+    vkDestroyImageView(device, equirectView, nullptr);
+    vkDestroyImage(device, specular, nullptr);
+    vkFreeMemory(device, specularMemory, nullptr);
+    vkDestroyImage(device, cube, nullptr);
+    vkFreeMemory(device, cubeMemory, nullptr);
+    vkDestroyImage(device, equirect, nullptr);
+    vkFreeMemory(device, equirectMemory, nullptr);
+    vkDestroyBuffer(device, shBuffer, nullptr);
+    vkFreeMemory(device, shMemory, nullptr);
+    vkDestroyBuffer(device, uploadBuffer, nullptr);
+    vkFreeMemory(device, uploadMemory, nullptr);
+    vkDestroyBuffer(device, readbackBuffer, nullptr);
+    vkFreeMemory(device, readbackMemory, nullptr);
+
+    return true;
+}
+
+bool ImageBasedLighting::readCache(const std::string& cachePath, uint64_t sourceHash, EnvironmentData& outData) {
+    std::ifstream file(cachePath, std::ios::binary);
+    if (!file.is_open()) {
+        return false;
+    }
+
+    CacheHeader header{};
+    file.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (!file || header.magic != CACHE_MAGIC || header.version != CACHE_VERSION || header.sourceHash != sourceHash ||
+        header.size != SPECULAR_SIZE || header.mipLevels != SPECULAR_MIPS || header.shCount != SH_COEFFICIENTS) {
+        std::cout << "ImageBasedLighting: Ignoring stale cache file " << cachePath << std::endl;
+        return false;
+    }
+
+    outData.size = header.size;
+    outData.mipLevels = header.mipLevels;
+    outData.sh.resize(header.shCount);
+    outData.specular.resize(static_cast<size_t>(cubeMipBytes(header.size, header.mipLevels)));
+    file.read(reinterpret_cast<char*>(outData.sh.data()), outData.sh.size() * sizeof(glm::vec4));
+    file.read(reinterpret_cast<char*>(outData.specular.data()), static_cast<std::streamsize>(outData.specular.size()));
+    if (!file) {
+        std::cout << "ImageBasedLighting: Truncated cache file " << cachePath << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void ImageBasedLighting::writeCache(const std::string& cachePath, uint64_t sourceHash, const EnvironmentData& data) {
+    std::filesystem::path path(cachePath);
+    std::error_code error;
+    std::filesystem::create_directories(path.parent_path(), error);
+
+    CacheHeader header{};
+    header.magic = CACHE_MAGIC;
+    header.version = CACHE_VERSION;
+    header.sourceHash = sourceHash;
+    header.size = data.size;
+    header.mipLevels = data.mipLevels;
+    header.shCount = static_cast<uint32_t>(data.sh.size());
+
+    // Written to a temporary name first so an interrupted write never looks like a valid cache
+    std::filesystem::path tempPath = path;
+    tempPath += ".tmp";
+    {
+        std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) {
+            std::cerr << "ImageBasedLighting: Failed to write cache file " << cachePath << std::endl;
+            return;
+        }
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(data.sh.data()), data.sh.size() * sizeof(glm::vec4));
+        file.write(reinterpret_cast<const char*>(data.specular.data()), static_cast<std::streamsize>(data.specular.size()));
+        if (!file) {
+            std::cerr << "ImageBasedLighting: Failed to write cache file " << cachePath << std::endl;
+            return;
+        }
+    }
+    std::filesystem::rename(tempPath, path, error);
+    if (error) {
+        std::cerr << "ImageBasedLighting: Failed to write cache file " << cachePath << ": " << error.message() << std::endl;
+    }
+}
+
+std::string ImageBasedLighting::getCachePath(uint64_t sourceHash) const {
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx.ibl", static_cast<unsigned long long>(sourceHash));
+    return (std::filesystem::current_path() / "cache" / "ibl" / name).string();
+}
+
+ImageBasedLighting::Environment ImageBasedLighting::createEnvironment(const EnvironmentData& data) {
+    VkDevice device = m_device->getDevice();
+    VkDeviceSize shBytes = sizeof(glm::vec4) * data.sh.size();
+    VkDeviceSize specularBytes = data.specular.size();
+
+    Environment environment;
+    environment.size = data.size;
+    environment.mipLevels = data.mipLevels;
+    createImage(data.size, data.size, data.mipLevels, 6, CUBE_FORMAT,
+                VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT, VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT,
+                environment.image, environment.memory);
+    environment.view = createImageView(environment.image, VK_IMAGE_VIEW_TYPE_CUBE, CUBE_FORMAT, 0, data.mipLevels, 6);
+    createBuffer(shBytes, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                 VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, environment.shBuffer, environment.shMemory);
+
+    VkBuffer stagingBuffer;
+    VkDeviceMemory stagingMemory;
+    createBuffer(shBytes + specularBytes, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                 VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, stagingBuffer, stagingMemory);
+    void* mapped;
+    vkMapMemory(device, stagingMemory, 0, shBytes + specularBytes, 0, &mapped);
+    memcpy(mapped, data.sh.data(), static_cast<size_t>(shBytes));
+    memcpy(static_cast<char*>(mapped) + shBytes, data.specular.data(), static_cast<size_t>(specularBytes));
+    vkUnmapMemory(device, stagingMemory);
+
+    CommandContext context(m_device, VulkanDevice::QueueType::Graphics);
+    VkCommandBuffer commandBuffer = context.begin();
+
+    VkBufferCopy shCopy{0, 0, shBytes};
+    vkCmdCopyBuffer(commandBuffer, stagingBuffer, environment.shBuffer, 1, &shCopy);
+
+    transitionImage(commandBuffer, environment.image, 0, data.mipLevels, 6, VK_IMAGE_LAYOUT_UNDEFINED,
+                    VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 0, VK_ACCESS_TRANSFER_WRITE_BIT,
+                    VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+    std::vector<VkBufferImageCopy> regions(data.mipLevels);
+    VkDeviceSize offset = shBytes;
+    for (uint32_t mip = 0; mip < data.mipLevels; mip++) {
+        uint32_t faceSize = std::max(data.size >> mip, 1u);
+        regions[mip].bufferOffset = offset;
+        regions[mip].imageSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, mip, 0, 6};
+        regions[mip].imageExtent = {faceSize, faceSize, 1};
+        offset += cubeMipBytes(faceSize, 1);
+    }
+    vkCmdCopyBufferToImage(commandBuffer, stagingBuffer, environment.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                           static_cast<uint32_t>(regions.size()), regions.data());
+    transitionImage(commandBuffer, environment.image, 0, data.mipLevels, 6, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                    VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT,
+                    VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT);
+
+    VkBufferMemoryBarrier shBarrier{};
+    shBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    shBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    shBarrier.dstAccessMask = VK_ACCESS_UNIFORM_READ_BIT;
+    shBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    shBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    shBarrier.buffer = environment.shBuffer;
+    shBarrier.offset = 0;
+    shBarrier.size = shBytes;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                         0, 0, nullptr, 1, &shBarrier, 0, nullptr);
+
+    context.submitAndWait(commandBuffer);
+    vkDestroyBuffer(device, stagingBuffer, nullptr);
+    vkFreeMemory(device, stagingMemory, nullptr);
+
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = m_descriptorPool;
+    allocInfo.descriptorSetCount = 1;
+    allocInfo.pSetLayouts = &m_descriptorSetLayout;
+
+    if (vkAllocateDescriptorSets(device, &allocInfo, &environment.descriptorSet) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to allocate environment descriptor set!");
+    }
+
+    VkDescriptorImageInfo specularInfo{m_sampler, environment.view, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
+    VkDescriptorImageInfo lutInfo{m_sampler, m_brdfLutView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
+    VkDescriptorBufferInfo shInfo{environment.shBuffer, 0, shBytes};
+
+    std::array<VkWriteDescriptorSet, 3> writes{};
+    for (uint32_t i = 0; i < writes.size(); i++) {
+        writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        writes[i].dstSet = environment.descriptorSet;
+        writes[i].dstBinding = i;
+        writes[i].descriptorCount = 1;
+    }
+    writes[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    writes[0].pImageInfo = &specularInfo;
+    writes[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    writes[1].pImageInfo = &lutInfo;
+    writes[2].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    writes[2].pBufferInfo = &shInfo;
+
+    vkUpdateDescriptorSets(device, static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+    return environment;
+}
+
+void ImageBasedLighting::destroyEnvironment(VkDevice device, VkDescriptorPool pool, const Environment& environment) {
+    if (environment.descriptorSet != VK_NULL_HANDLE) {
+        vkFreeDescriptorSets(device, pool, 1, &environment.descriptorSet);
+    }
+    if (environment.view != VK_NULL_HANDLE) {
+        vkDestroyImageView(device, environment.view, nullptr);
+    }
+    if (environment.image != VK_NULL_HANDLE) {
+        vkDestroyImage(device, environment.image, nullptr);
+        vkFreeMemory(device, environment.memory, nullptr);
+    }
+    if (environment.shBuffer != VK_NULL_HANDLE) {
+        vkDestroyBuffer(device, environment.shBuffer, nullptr);
+        vkFreeMemory(device, environment.shMemory, nullptr);
+    }
+}
+
+VkDescriptorSet ImageBasedLighting::allocateComputeSet(VkImageView sampledView, VkSampler sampler,
+                                                       VkImageView storageView, VkBuffer storageBuffer,
+                                                       VkDeviceSize storageBufferSize) {
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = m_computePool;
+    allocInfo.descriptorSetCount = 1;
+    allocInfo.pSetLayouts = &m_computeSetLayout;
+
+    VkDescriptorSet set;
+    if (vkAllocateDescriptorSets(m_device->getDevice(), &allocInfo, &set) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to allocate environment compute descriptor set!");
+    }
+
+    // Only the bindings this dispatch's shader uses are written
+    VkDescriptorImageInfo sampledInfo{sampler, sampledView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
+    VkDescriptorImageInfo storageInfo{VK_NULL_HANDLE, storageView, VK_IMAGE_LAYOUT_GENERAL};
+    VkDescriptorBufferInfo bufferInfo{storageBuffer, 0, storageBufferSize};
+
+    std::vector<VkWriteDescriptorSet> writes;
+    VkWriteDescriptorSet write{};
+    write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    write.dstSet = set;
+    write.descriptorCount = 1;
+    if (sampledView != VK_NULL_HANDLE) {
+        write.dstBinding = 0;
+        write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        write.pImageInfo = &sampledInfo;
+        writes.push_back(write);
+    }
+    if (storageView != VK_NULL_HANDLE) {
+        write.dstBinding = 1;
+        write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+        write.pImageInfo = &storageInfo;
+        writes.push_back(write);
+    }
+    if (storageBuffer != VK_NULL_HANDLE) {
+        write.dstBinding = 2;
+        write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        write.pImageInfo = nullptr;
+        write.pBufferInfo = &bufferInfo;
+        writes.push_back(write);
+    }
+
+    vkUpdateDescriptorSets(m_device->getDevice(), static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+    return set;
+}
+
+void ImageBasedLighting::bind(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout, float rotationDegrees,
+                              float intensity) {
+    float angle = glm::radians(rotationDegrees);
+
+    ShadingParams params{};
+    params.rotation = glm::vec4(std::cos(angle), std::sin(angle), 0.0f, 0.0f);
+    params.params = glm::vec4(intensity, static_cast<float>(m_environment.mipLevels - 1),
+                              m_hasEnvironment ? 1.0f : 0.0f, 0.0f);
+
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout,
+                            3, 1, &m_environment.descriptorSet, 0, nullptr);
+    vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_FRAGMENT_BIT,
+                       sizeof(ClusteredLighting::ClusterParams), sizeof(ShadingParams), &params);
+}
+
+uint64_t ImageBasedLighting::hashBytes(const std::vector<uint8_t>& data) {
+    // FNV-1a
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (uint8_t byte : data) {
+        hash ^= byte;
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+VkDeviceSize ImageBasedLighting::cubeMipBytes(uint32_t size, uint32_t mipLevels) {
+    VkDeviceSize bytes = 0;
+    for (uint32_t mip = 0; mip < mipLevels; mip++) {
+        VkDeviceSize faceSize = std::max(size >> mip, 1u);
+        bytes += faceSize * faceSize * 6 * 8; // RGBA16F
+    }
+    return bytes;
+}
+
+void ImageBasedLighting::createImage(uint32_t width, uint32_t height, uint32_t mipLevels, uint32_t layers,
+                                     VkFormat format, VkImageUsageFlags usage, VkImageCreateFlags flags,
+                                     VkImage& image, VkDeviceMemory& memory) {
+    VkImageCreateInfo imageInfo{};
+    imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    imageInfo.flags = flags;
+    imageInfo.imageType = VK_IMAGE_TYPE_2D;
+    imageInfo.extent = {width, height, 1};
+    imageInfo.mipLevels = mipLevels;
+    imageInfo.arrayLayers = layers;
+    imageInfo.format = format;
+    imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    imageInfo.usage = usage;
+    imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+    imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    if (vkCreateImage(m_device->getDevice(), &imageInfo, nullptr, &image) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create environment image!");
+    }
+
+    VkMemoryRequirements memRequirements;
+    vkGetImageMemoryRequirements(m_device->getDevice(), image, &memRequirements);
+
+    VkMemoryAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = memRequirements.size;
+    allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+    if (vkAllocateMemory(m_device->getDevice(), &allocInfo, nullptr, &memory) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to allocate environment image memory!");
+    }
+    vkBindImageMemory(m_device->getDevice(), image, memory, 0);
+}
+
+VkImageView ImageBasedLighting::createImageView(VkImage image, VkImageViewType type, VkFormat format, uint32_t baseMip,
+                                                uint32_t mipCount, uint32_t layers) {
+    VkImageViewCreateInfo viewInfo{};
+    viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    viewInfo.image = image;
+    viewInfo.viewType = type;
+    viewInfo.format = format;
+    viewInfo.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, baseMip, mipCount, 0, layers};
+
+    VkImageView view;
+    if (vkCreateImageView(m_device->getDevice(), &viewInfo, nullptr, &view) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create environment image view!");
+    }
+    return view;
+}
+
+void ImageBasedLighting::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties,
+                                      VkBuffer& buffer, VkDeviceMemory& bufferMemory) {
+    VkBufferCreateInfo bufferInfo{};
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size = size;
+    bufferInfo.usage = usage;
+    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    if (vkCreateBuffer(m_device->getDevice(), &bufferInfo, nullptr, &buffer) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create environment buffer!");
+    }
+
+    VkMemoryRequirements memRequirements;
+    vkGetBufferMemoryRequirements(m_device->getDevice(), buffer, &memRequirements);
+
+    VkMemoryAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = memRequirements.size;
+    allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
+
+    if (vkAllocateMemory(m_device->getDevice(), &allocInfo, nullptr, &bufferMemory) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to allocate environment buffer memory!");
+    }
+
+    vkBindBufferMemory(m_device->getDevice(), buffer, bufferMemory, 0);
+}
+
+void ImageBasedLighting::transitionImage(VkCommandBuffer commandBuffer, VkImage image, uint32_t baseMip,
+                                         uint32_t mipCount, uint32_t layers, VkImageLayout oldLayout,
+                                         VkImageLayout newLayout, VkAccessFlags srcAccess, VkAccessFlags dstAccess,
+                                         VkPipelineStageFlags srcStage, VkPipelineStageFlags dstStage) {
+    VkImageMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.oldLayout = oldLayout;
+    barrier.newLayout = newLayout;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = image;
+    barrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, baseMip, mipCount, 0, layers};
+    barrier.srcAccessMask = srcAccess;
+    barrier.dstAccessMask = dstAccess;
+
+    vkCmdPipelineBarrier(commandBuffer, srcStage, dstStage, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+}
+
+uint32_t ImageBasedLighting::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) {
+    VkPhysicalDeviceMemoryProperties memProperties;
+    vkGetPhysicalDeviceMemoryProperties(m_device->getPhysicalDevice(), &memProperties);
+
+    for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++) {
+        if ((typeFilter & (1 << i)) && (memProperties.memoryTypes[i].propertyFlags & properties) == properties) {
+            return i;
+        }
+    }
+
+    throw std::runtime_error("Failed to find suitable memory type!");
+}
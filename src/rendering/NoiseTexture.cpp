@@ -0,0 +1,215 @@
+#include "rendering/NoiseTexture.h"
+#include "core/CommandContext.h"
+#include "core/NoiseTable.h"
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+// Next level down, each texel the average of its 2x2 parents
+std::vector<uint8_t> downsample(const std::vector<uint8_t>& level, uint32_t size) {
+    uint32_t half = size / 2;
+    std::vector<uint8_t> result(half * half);
+    for (uint32_t y = 0; y < half; y++) {
+        for (uint32_t x = 0; x < half; x++) {
+            uint32_t sum = level[(2 * y) * size + 2 * x] + level[(2 * y) * size + 2 * x + 1] +
+                           level[(2 * y + 1) * size + 2 * x] + level[(2 * y + 1) * size + 2 * x + 1];
+            result[y * half + x] = static_cast<uint8_t>((sum + 2) / 4);
+        }
+    }
+    return result;
+}
+}
+
+NoiseTexture::NoiseTexture(VulkanDevice* device) : m_device(device) {
+    createImage();
+    upload();
+    createSampler();
+    std::cout << "NoiseTexture: " << NoiseTable::SIZE << "x" << NoiseTable::SIZE << ", " << m_mipLevels
+              << " levels" << std::endl;
+}
+
+NoiseTexture::~NoiseTexture() {
+    VkDevice device = m_device->getDevice();
+    if (m_sampler != VK_NULL_HANDLE) {
+        vkDestroySampler(device, m_sampler, nullptr);
+    }
+    if (m_view != VK_NULL_HANDLE) {
+        vkDestroyImageView(device, m_view, nullptr);
+    }
+    if (m_image != VK_NULL_HANDLE) {
+        vkDestroyImage(device, m_image, nullptr);
+    }
+    if (m_memory != VK_NULL_HANDLE) {
+        vkFreeMemory(device, m_memory, nullptr);
+    }
+}
+
+void NoiseTexture::createImage() {
+    VkDevice device = m_device->getDevice();
+
+    // Down to a single texel
+    m_mipLevels = 1;
+    while ((NoiseTable::SIZE >> m_mipLevels) > 0) {
+        m_mipLevels++;
+    }
+
+    VkImageCreateInfo imageInfo{};
+    imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    imageInfo.imageType = VK_IMAGE_TYPE_2D;
+    imageInfo.extent = {NoiseTable::SIZE, NoiseTable::SIZE, 1};
+    imageInfo.mipLevels = m_mipLevels;
+    imageInfo.arrayLayers = 1;
+    imageInfo.format = FORMAT;
+    imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    imageInfo.usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+    imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+    imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    if (vkCreateImage(device, &imageInfo, nullptr, &m_image) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create noise texture image!");
+    }
+
+    VkMemoryRequirements memRequirements;
+    vkGetImageMemoryRequirements(device, m_image, &memRequirements);
+
+    VkMemoryAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = memRequirements.size;
+    allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+    if (vkAllocateMemory(device, &allocInfo, nullptr, &m_memory) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to allocate noise texture memory!");
+    }
+    vkBindImageMemory(device, m_image, m_memory, 0);
+
+    VkImageViewCreateInfo viewInfo{};
+    viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    viewInfo.image = m_image;
+    viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    viewInfo.format = FORMAT;
+    viewInfo.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, m_mipLevels, 0, 1};
+
+    if (vkCreateImageView(device, &viewInfo, nullptr, &m_view) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create noise texture view!");
+    }
+}
+
+void NoiseTexture::upload() {
+    VkDevice device = m_device->getDevice();
+
+    // The whole chain, level after level, in one staging buffer
+    std::vector<std::vector<uint8_t>> levels{NoiseTable::texels()};
+    for (uint32_t level = 1; level < m_mipLevels; level++) {
+        levels.push_back(downsample(levels.back(), NoiseTable::SIZE >> (level - 1)));
+    }
+    VkDeviceSize totalSize = 0;
+    for (const auto& level : levels) {
+        totalSize += level.size();
+    }
+
+    VkBufferCreateInfo bufferInfo{};
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size = totalSize;
+    bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    VkBuffer stagingBuffer;
+    if (vkCreateBuffer(device, &bufferInfo, nullptr, &stagingBuffer) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create noise texture staging buffer!");
+    }
+
+    VkMemoryRequirements memRequirements;
+    vkGetBufferMemoryRequirements(device, stagingBuffer, &memRequirements);
+
+    VkMemoryAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = memRequirements.size;
+    allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits,
+                                               VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                                               VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+    VkDeviceMemory stagingMemory;
+    if (vkAllocateMemory(device, &allocInfo, nullptr, &stagingMemory) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to allocate noise texture staging memory!");
+    }
+    vkBindBufferMemory(device, stagingBuffer, stagingMemory, 0);
+
+    std::vector<VkBufferImageCopy> regions;
+    void* data;
+    vkMapMemory(device, stagingMemory, 0, totalSize, 0, &data);
+    VkDeviceSize offset = 0;
+    for (uint32_t level = 0; level < m_mipLevels; level++) {
+        memcpy(static_cast<char*>(data) + offset, levels[level].data(), levels[level].size());
+
+        uint32_t size = NoiseTable::SIZE >> level;
+        VkBufferImageCopy region{};
+        region.bufferOffset = offset;
+        region.imageSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, level, 0, 1};
+        region.imageExtent = {size, size, 1};
+        regions.push_back(region);
+        offset += levels[level].size();
+    }
+    vkUnmapMemory(device, stagingMemory);
+
+    VkImageMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image = m_image;
+    barrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, m_mipLevels, 0, 1};
+    barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.srcAccessMask = 0;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+
+    CommandContext context(m_device, VulkanDevice::QueueType::Graphics);
+    VkCommandBuffer commandBuffer = context.begin();
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         0, 0, nullptr, 0, nullptr, 1, &barrier);
+    vkCmdCopyBufferToImage(commandBuffer, stagingBuffer, m_image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                           static_cast<uint32_t>(regions.size()), regions.data());
+
+    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                         0, 0, nullptr, 0, nullptr, 1, &barrier);
+    context.submitAndWait(commandBuffer);
+
+    vkDestroyBuffer(device, stagingBuffer, nullptr);
+    vkFreeMemory(device, stagingMemory, nullptr);
+}
+
+void NoiseTexture::createSampler() {
+    VkSamplerCreateInfo samplerInfo{};
+    samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    samplerInfo.magFilter = VK_FILTER_LINEAR;
+    samplerInfo.minFilter = VK_FILTER_LINEAR;
+    samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+    samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+    samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+    samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+    samplerInfo.minLod = 0.0f;
+    samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+
+    if (vkCreateSampler(m_device->getDevice(), &samplerInfo, nullptr, &m_sampler) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create noise texture sampler!");
+    }
+}
+
+uint32_t NoiseTexture::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) {
+    VkPhysicalDeviceMemoryProperties memProperties;
+    vkGetPhysicalDeviceMemoryProperties(m_device->getPhysicalDevice(), &memProperties);
+
+    for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++) {
+        if ((typeFilter & (1 << i)) && (memProperties.memoryTypes[i].propertyFlags & properties) == properties) {
+            return i;
+        }
+    }
+
+    throw std::runtime_error("Failed to find suitable memory type!");
+}
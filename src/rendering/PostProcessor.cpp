@@ -0,0 +1,560 @@
+#include "rendering/PostProcessor.h"
+#include "core/DeletionQueue.h"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+
+namespace {
+constexpr uint32_t GROUP_SIZE = 8;
+constexpr uint32_t HISTOGRAM_BINS = 256;
+// The chain stops before a level gets smaller than this
+constexpr uint32_t MIN_BLOOM_SIZE = 4;
+
+// Bindings shared by the post_*.comp shaders
+enum Binding : uint32_t {
+    SceneColor = 0,
+    BloomChain = 1,
+    BloomLevel = 2,
+    DisplayColor = 3,
+    Histogram = 4,
+    ExposureState = 5,
+    Statistics = 6,
+    BindingCount
+};
+
+uint32_t groupCount(uint32_t size) {
+    return (size + GROUP_SIZE - 1) / GROUP_SIZE;
+}
+}
+
+PostProcessor::PostProcessor(VulkanDevice* device) : m_device(device) {
+    createSamplers();
+    createDescriptors();
+    createStateBuffers();
+    createPipelines();
+    std::cout << "PostProcessor: Up to " << MAX_BLOOM_LEVELS << " bloom levels, " << HISTOGRAM_BINS
+              << "-bin exposure histogram" << std::endl;
+}
+
+PostProcessor::~PostProcessor() {
+    VkDevice device = m_device->getDevice();
+    m_firstDownsamplePipeline.reset();
+    m_downsamplePipeline.reset();
+    m_exposurePipeline.reset();
+    m_upsamplePipeline.reset();
+    for (auto& pipeline : m_compositePipelines) {
+        pipeline.reset();
+    }
+
+    for (VkImageView view : m_bloomLevelViews) {
+        if (view != VK_NULL_HANDLE) vkDestroyImageView(device, view, nullptr);
+    }
+    if (m_bloomView != VK_NULL_HANDLE) vkDestroyImageView(device, m_bloomView, nullptr);
+    if (m_bloomImage != VK_NULL_HANDLE) vkDestroyImage(device, m_bloomImage, nullptr);
+    if (m_bloomMemory != VK_NULL_HANDLE) vkFreeMemory(device, m_bloomMemory, nullptr);
+
+    std::array<std::pair<VkBuffer, VkDeviceMemory>, 3> buffers{{
+        {m_histogramBuffer, m_histogramMemory},
+        {m_exposureBuffer, m_exposureMemory},
+        {m_statisticsBuffer, m_statisticsMemory},
+    }};
+    for (const auto& [buffer, memory] : buffers) {
+        if (buffer != VK_NULL_HANDLE) vkDestroyBuffer(device, buffer, nullptr);
+        if (memory != VK_NULL_HANDLE) vkFreeMemory(device, memory, nullptr);
+    }
+
+    if (m_descriptorPool != VK_NULL_HANDLE) {
+        vkDestroyDescriptorPool(device, m_descriptorPool, nullptr);
+    }
+    if (m_setLayout != VK_NULL_HANDLE) {
+        vkDestroyDescriptorSetLayout(device, m_setLayout, nullptr);
+    }
+    if (m_presentSetLayout != VK_NULL_HANDLE) {
+        vkDestroyDescriptorSetLayout(device, m_presentSetLayout, nullptr);
+    }
+    if (m_nearestSampler != VK_NULL_HANDLE) {
+        vkDestroySampler(device, m_nearestSampler, nullptr);
+    }
+    if (m_linearSampler != VK_NULL_HANDLE) {
+        vkDestroySampler(device, m_linearSampler, nullptr);
+    }
+}
+
+void PostProcessor::createSamplers() {
+    VkSamplerCreateInfo samplerInfo{};
+    samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    samplerInfo.magFilter = VK_FILTER_NEAREST;
+    samplerInfo.minFilter = VK_FILTER_NEAREST;
+    samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+    samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.minLod = 0.0f;
+    samplerInfo.maxLod = 0.0f;
+
+    if (vkCreateSampler(m_device->getDevice(), &samplerInfo, nullptr, &m_nearestSampler) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create post-processing sampler!");
+    }
+
+    // Bloom taps land between texels of an explicit level
+    samplerInfo.magFilter = VK_FILTER_LINEAR;
+    samplerInfo.minFilter = VK_FILTER_LINEAR;
+    samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+
+    if (vkCreateSampler(m_device->getDevice(), &samplerInfo, nullptr, &m_linearSampler) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create bloom sampler!");
+    }
+}
+
+void PostProcessor::createDescriptors() {
+    VkDevice device = m_device->getDevice();
+
+    std::array<VkDescriptorSetLayoutBinding, BindingCount> bindings{};
+    for (uint32_t i = 0; i < bindings.size(); i++) {
+        bindings[i].binding = i;
+        bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        bindings[i].descriptorCount = 1;
+        bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    }
+    bindings[SceneColor].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    bindings[BloomChain].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    bindings[BloomLevel].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    bindings[DisplayColor].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+    layoutInfo.pBindings = bindings.data();
+
+    if (vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &m_setLayout) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create post-processing descriptor set layout!");
+    }
+
+    VkDescriptorSetLayoutBinding presentBinding{};
+    presentBinding.binding = 0;
+    presentBinding.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    presentBinding.descriptorCount = 1;
+    presentBinding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+
+    layoutInfo.bindingCount = 1;
+    layoutInfo.pBindings = &presentBinding;
+
+    if (vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &m_presentSetLayout) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create present descriptor set layout!");
+    }
+
+    constexpr uint32_t chainSets = RING_SLOTS * MAX_BLOOM_LEVELS;
+    std::array<VkDescriptorPoolSize, 3> poolSizes{};
+    poolSizes[0].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    poolSizes[0].descriptorCount = chainSets * 2 + RING_SLOTS;
+    poolSizes[1].type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    poolSizes[1].descriptorCount = chainSets * 2;
+    poolSizes[2].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    poolSizes[2].descriptorCount = chainSets * 3;
+
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+    poolInfo.pPoolSizes = poolSizes.data();
+    poolInfo.maxSets = chainSets + RING_SLOTS;
+
+    if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &m_descriptorPool) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create post-processing descriptor pool!");
+    }
+
+    std::array<VkDescriptorSetLayout, MAX_BLOOM_LEVELS> layouts;
+    layouts.fill(m_setLayout);
+
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = m_descriptorPool;
+    allocInfo.descriptorSetCount = MAX_BLOOM_LEVELS;
+    allocInfo.pSetLayouts = layouts.data();
+    for (auto& slotSets : m_sets) {
+        if (vkAllocateDescriptorSets(device, &allocInfo, slotSets.data()) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to allocate post-processing descriptor sets!");
+        }
+    }
+
+    std::array<VkDescriptorSetLayout, RING_SLOTS> presentLayouts;
+    presentLayouts.fill(m_presentSetLayout);
+    allocInfo.descriptorSetCount = RING_SLOTS;
+    allocInfo.pSetLayouts = presentLayouts.data();
+
+    if (vkAllocateDescriptorSets(device, &allocInfo, m_presentSets.data()) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to allocate present descriptor sets!");
+    }
+}
+
+void PostProcessor::createStateBuffers() {
+    VkDevice device = m_device->getDevice();
+    VkMemoryPropertyFlags hostVisible = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+
+    // Both start zeroed: an empty histogram, and an exposure of 0 marking "not adapted yet"
+    createBuffer(sizeof(uint32_t) * HISTOGRAM_BINS, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, hostVisible,
+                 m_histogramBuffer, m_histogramMemory);
+    createBuffer(sizeof(glm::vec4), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, hostVisible,
+                 m_exposureBuffer, m_exposureMemory);
+    for (auto [memory, size] : {std::pair{m_histogramMemory, sizeof(uint32_t) * HISTOGRAM_BINS},
+                                std::pair{m_exposureMemory, sizeof(glm::vec4)}}) {
+        void* data;
+        vkMapMemory(device, memory, 0, size, 0, &data);
+        std::memset(data, 0, size);
+        vkUnmapMemory(device, memory);
+    }
+
+    // The exposure pass writes its slot; the CPU reads a slot back just before reusing it
+    VkDeviceSize statisticsSize = sizeof(glm::vec4) * RING_SLOTS;
+    createBuffer(statisticsSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, hostVisible,
+                 m_statisticsBuffer, m_statisticsMemory);
+    void* statistics;
+    vkMapMemory(device, m_statisticsMemory, 0, statisticsSize, 0, &statistics);
+    m_statisticsMapped = static_cast<glm::vec4*>(statistics);
+    std::memset(m_statisticsMapped, 0, statisticsSize);
+}
+
+void PostProcessor::createPipelines() {
+    std::vector<VkDescriptorSetLayout> layouts{m_setLayout};
+    uint32_t pushSize = static_cast<uint32_t>(sizeof(PostParams));
+
+    VkSpecializationMapEntry firstLevelEntry{0, 0, sizeof(VkBool32)};
+    VkBool32 firstLevel = VK_TRUE;
+    VkSpecializationInfo firstLevelInfo{1, &firstLevelEntry, sizeof(VkBool32), &firstLevel};
+    m_firstDownsamplePipeline = std::make_unique<ComputePipeline>(m_device, "post_downsample.comp", layouts,
+                                                                  pushSize, &firstLevelInfo);
+    m_downsamplePipeline = std::make_unique<ComputePipeline>(m_device, "post_downsample.comp", layouts, pushSize);
+    m_exposurePipeline = std::make_unique<ComputePipeline>(m_device, "post_exposure.comp", layouts, pushSize);
+    m_upsamplePipeline = std::make_unique<ComputePipeline>(m_device, "post_upsample.comp", layouts, pushSize);
+
+    // One composite per operator, so the unused ones compile away
+    VkSpecializationMapEntry tonemapperEntry{0, 0, sizeof(int32_t)};
+    for (uint32_t i = 0; i < m_compositePipelines.size(); i++) {
+        int32_t tonemapper = static_cast<int32_t>(i);
+        VkSpecializationInfo tonemapperInfo{1, &tonemapperEntry, sizeof(int32_t), &tonemapper};
+        m_compositePipelines[i] = std::make_unique<ComputePipeline>(m_device, "post_composite.comp", layouts,
+                                                                    pushSize, &tonemapperInfo);
+    }
+}
+
+void PostProcessor::resize(VkExtent2D outputExtent) {
+    if (m_bloomImage != VK_NULL_HANDLE && outputExtent.width == m_outputExtent.width &&
+        outputExtent.height == m_outputExtent.height) {
+        return;
+    }
+    retireBloomChain();
+    createBloomChain(outputExtent);
+    m_outputExtent = outputExtent;
+}
+
+VkExtent2D PostProcessor::levelExtent(uint32_t level) const {
+    return {std::max(m_outputExtent.width >> (level + 1), 1u), std::max(m_outputExtent.height >> (level + 1), 1u)};
+}
+
+void PostProcessor::createBloomChain(VkExtent2D extent) {
+    VkDevice device = m_device->getDevice();
+    VkExtent2D base{std::max(extent.width >> 1, 1u), std::max(extent.height >> 1, 1u)};
+    m_bloomLevels = 1;
+    while (m_bloomLevels < MAX_BLOOM_LEVELS &&
+           std::min(base.width, base.height) >> m_bloomLevels >= MIN_BLOOM_SIZE) {
+        m_bloomLevels++;
+    }
+
+    VkImageCreateInfo imageInfo{};
+    imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    imageInfo.imageType = VK_IMAGE_TYPE_2D;
+    imageInfo.extent = {base.width, base.height, 1};
+    imageInfo.mipLevels = m_bloomLevels;
+    imageInfo.arrayLayers = 1;
+    imageInfo.format = HDR_FORMAT;
+    imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    imageInfo.usage = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+    imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+    imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    if (vkCreateImage(device, &imageInfo, nullptr, &m_bloomImage) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create bloom image!");
+    }
+
+    VkMemoryRequirements memRequirements;
+    vkGetImageMemoryRequirements(device, m_bloomImage, &memRequirements);
+
+    VkMemoryAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = memRequirements.size;
+    allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+    if (vkAllocateMemory(device, &allocInfo, nullptr, &m_bloomMemory) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to allocate bloom image memory!");
+    }
+    vkBindImageMemory(device, m_bloomImage, m_bloomMemory, 0);
+
+    VkImageViewCreateInfo viewInfo{};
+    viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    viewInfo.image = m_bloomImage;
+    viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    viewInfo.format = HDR_FORMAT;
+    viewInfo.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, m_bloomLevels, 0, 1};
+
+    if (vkCreateImageView(device, &viewInfo, nullptr, &m_bloomView) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create bloom view!");
+    }
+    for (uint32_t level = 0; level < m_bloomLevels; level++) {
+        viewInfo.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, level, 1, 0, 1};
+        if (vkCreateImageView(device, &viewInfo, nullptr, &m_bloomLevelViews[level]) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to create bloom level view!");
+        }
+    }
+
+    std::cout << "PostProcessor: Bloom chain at " << base.width << "x" << base.height << ", "
+              << m_bloomLevels << " levels" << std::endl;
+}
+
+void PostProcessor::retireBloomChain() {
+    if (m_bloomImage == VK_NULL_HANDLE) {
+        return;
+    }
+
+    // Frames in flight may still be filtering through the old chain
+    VkDevice device = m_device->getDevice();
+    VkImage image = m_bloomImage;
+    VkDeviceMemory memory = m_bloomMemory;
+    std::vector<VkImageView> views{m_bloomView};
+    for (uint32_t level = 0; level < m_bloomLevels; level++) {
+        views.push_back(m_bloomLevelViews[level]);
+    }
+    m_device->getDeletionQueue()->push([device, image, memory, views]() {
+        for (VkImageView view : views) {
+            vkDestroyImageView(device, view, nullptr);
+        }
+        vkDestroyImage(device, image, nullptr);
+        vkFreeMemory(device, memory, nullptr);
+    });
+
+    m_bloomImage = VK_NULL_HANDLE;
+    m_bloomMemory = VK_NULL_HANDLE;
+    m_bloomView = VK_NULL_HANDLE;
+    m_bloomLevelViews = {};
+    m_bloomLevels = 0;
+}
+
+void PostProcessor::writeDescriptors(VkImageView hdrView, VkImageView displayView) {
+    VkDescriptorImageInfo sceneInfo{m_nearestSampler, hdrView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
+    VkDescriptorImageInfo chainInfo{m_linearSampler, m_bloomView, VK_IMAGE_LAYOUT_GENERAL};
+    VkDescriptorImageInfo displayInfo{VK_NULL_HANDLE, displayView, VK_IMAGE_LAYOUT_GENERAL};
+    VkDescriptorBufferInfo histogramInfo{m_histogramBuffer, 0, VK_WHOLE_SIZE};
+    VkDescriptorBufferInfo exposureInfo{m_exposureBuffer, 0, VK_WHOLE_SIZE};
+    VkDescriptorBufferInfo statisticsInfo{m_statisticsBuffer, 0, VK_WHOLE_SIZE};
+
+    std::array<VkDescriptorImageInfo, MAX_BLOOM_LEVELS> levelInfos{};
+    std::vector<VkWriteDescriptorSet> writes;
+    writes.reserve(m_bloomLevels * BindingCount);
+    for (uint32_t level = 0; level < m_bloomLevels; level++) {
+        levelInfos[level] = {VK_NULL_HANDLE, m_bloomLevelViews[level], VK_IMAGE_LAYOUT_GENERAL};
+        for (uint32_t binding = 0; binding < BindingCount; binding++) {
+            VkWriteDescriptorSet write{};
+            write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            write.dstSet = m_sets[m_slot][level];
+            write.dstBinding = binding;
+            write.descriptorCount = 1;
+            switch (binding) {
+                case SceneColor:
+                    write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+                    write.pImageInfo = &sceneInfo;
+                    break;
+                case BloomChain:
+                    write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+                    write.pImageInfo = &chainInfo;
+                    break;
+                case BloomLevel:
+                    write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+                    write.pImageInfo = &levelInfos[level];
+                    break;
+                case DisplayColor:
+                    write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+                    write.pImageInfo = &displayInfo;
+                    break;
+                case Histogram:
+                    write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+                    write.pBufferInfo = &histogramInfo;
+                    break;
+                case ExposureState:
+                    write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+                    write.pBufferInfo = &exposureInfo;
+                    break;
+                default:
+                    write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+                    write.pBufferInfo = &statisticsInfo;
+                    break;
+            }
+            writes.push_back(write);
+        }
+    }
+    vkUpdateDescriptorSets(m_device->getDevice(), static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+}
+
+void PostProcessor::process(VkCommandBuffer commandBuffer, VkImageView hdrView, VkImageView displayView,
+                            const Settings& settings, float deltaSeconds) {
+    m_slot = (m_slot + 1) % RING_SLOTS;
+
+    // This slot's readback was last written RING_SLOTS frames ago and is complete
+    const glm::vec4& readback = m_statisticsMapped[m_slot];
+    if (readback.x > 0.0f) {
+        m_stats.exposure = readback.x;
+        m_stats.averageLuminance = readback.y;
+    }
+    if (!settings.autoExposure) {
+        m_stats.exposure = settings.exposure;
+    }
+
+    writeDescriptors(hdrView, displayView);
+
+    // The previous frame's chain last wrote the histogram and exposure, and read the
+    // bloom levels; its contents are rebuilt from scratch, so the layout is discarded
+    VkMemoryBarrier memoryBarrier{};
+    memoryBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    memoryBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    memoryBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    VkImageMemoryBarrier bloomBarrier{};
+    bloomBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    bloomBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    bloomBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    bloomBarrier.image = m_bloomImage;
+    bloomBarrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, m_bloomLevels, 0, 1};
+    bloomBarrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    bloomBarrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+    bloomBarrier.srcAccessMask = 0;
+    bloomBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                         0, 1, &memoryBarrier, 0, nullptr, 1, &bloomBarrier);
+
+    // Without bloom the first level still runs, for the histogram
+    uint32_t bloomLevels = settings.bloom ? m_bloomLevels : 1;
+
+    PostParams params{};
+    params.slot = m_slot;
+    params.deltaTime = deltaSeconds;
+    params.exposure = settings.exposure;
+    params.bloomThreshold = settings.bloomThreshold;
+    params.bloomIntensity = settings.bloom ? settings.bloomIntensity / static_cast<float>(bloomLevels) : 0.0f;
+    params.gamma = settings.gamma;
+    params.autoExposure = settings.autoExposure ? 1 : 0;
+
+    // Bright pass and histogram
+    VkExtent2D level0 = levelExtent(0);
+    params.srcSize = glm::ivec2(m_outputExtent.width, m_outputExtent.height);
+    params.dstSize = glm::ivec2(level0.width, level0.height);
+    params.srcLevel = -1;
+    dispatch(commandBuffer, *m_firstDownsamplePipeline, 0, params, {groupCount(level0.width), groupCount(level0.height)});
+    computeBarrier(commandBuffer);
+
+    dispatch(commandBuffer, *m_exposurePipeline, 0, params, {1, 1});
+
+    for (uint32_t level = 1; level < bloomLevels; level++) {
+        VkExtent2D src = levelExtent(level - 1);
+        VkExtent2D dst = levelExtent(level);
+        params.srcSize = glm::ivec2(src.width, src.height);
+        params.dstSize = glm::ivec2(dst.width, dst.height);
+        params.srcLevel = static_cast<int32_t>(level - 1);
+        dispatch(commandBuffer, *m_downsamplePipeline, level, params, {groupCount(dst.width), groupCount(dst.height)});
+        computeBarrier(commandBuffer);
+    }
+
+    for (uint32_t level = bloomLevels - 1; level-- > 0;) {
+        VkExtent2D src = levelExtent(level + 1);
+        VkExtent2D dst = levelExtent(level);
+        params.srcSize = glm::ivec2(src.width, src.height);
+        params.dstSize = glm::ivec2(dst.width, dst.height);
+        params.srcLevel = static_cast<int32_t>(level + 1);
+        dispatch(commandBuffer, *m_upsamplePipeline, level, params, {groupCount(dst.width), groupCount(dst.height)});
+        computeBarrier(commandBuffer);
+    }
+    if (bloomLevels == 1) {
+        computeBarrier(commandBuffer); // The exposure
+    }
+
+    params.srcSize = glm::ivec2(level0.width, level0.height);
+    params.dstSize = glm::ivec2(m_outputExtent.width, m_outputExtent.height);
+    params.srcLevel = 0;
+    const ComputePipeline& composite = *m_compositePipelines[static_cast<size_t>(settings.tonemapper)];
+    dispatch(commandBuffer, composite, 0, params, {groupCount(m_outputExtent.width), groupCount(m_outputExtent.height)});
+}
+
+void PostProcessor::dispatch(VkCommandBuffer commandBuffer, const ComputePipeline& pipeline, uint32_t level,
+                             const PostParams& params, VkExtent2D groups) {
+    pipeline.bind(commandBuffer);
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipeline.getPipelineLayout(),
+                            0, 1, &m_sets[m_slot][level], 0, nullptr);
+    vkCmdPushConstants(commandBuffer, pipeline.getPipelineLayout(), VK_SHADER_STAGE_COMPUTE_BIT,
+                       0, sizeof(PostParams), &params);
+    vkCmdDispatch(commandBuffer, groups.width, groups.height, 1);
+}
+
+void PostProcessor::computeBarrier(VkCommandBuffer commandBuffer) {
+    // Every step reads what the one before wrote; all chain images stay in GENERAL
+    VkMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                         0, 1, &barrier, 0, nullptr, 0, nullptr);
+}
+
+void PostProcessor::bindPresent(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout, VkImageView displayView) {
+    m_presentSlot = (m_presentSlot + 1) % RING_SLOTS;
+    VkDescriptorSet descriptorSet = m_presentSets[m_presentSlot];
+
+    VkDescriptorImageInfo imageInfo{m_nearestSampler, displayView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
+    VkWriteDescriptorSet write{};
+    write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    write.dstSet = descriptorSet;
+    write.dstBinding = 0;
+    write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    write.descriptorCount = 1;
+    write.pImageInfo = &imageInfo;
+    vkUpdateDescriptorSets(m_device->getDevice(), 1, &write, 0, nullptr);
+
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout,
+                            0, 1, &descriptorSet, 0, nullptr);
+}
+
+void PostProcessor::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties,
+                                 VkBuffer& buffer, VkDeviceMemory& bufferMemory) {
+    VkBufferCreateInfo bufferInfo{};
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size = size;
+    bufferInfo.usage = usage;
+    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    if (vkCreateBuffer(m_device->getDevice(), &bufferInfo, nullptr, &buffer) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create post-processing buffer!");
+    }
+
+    VkMemoryRequirements memRequirements;
+    vkGetBufferMemoryRequirements(m_device->getDevice(), buffer, &memRequirements);
+
+    VkMemoryAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = memRequirements.size;
+    allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
+
+    if (vkAllocateMemory(m_device->getDevice(), &allocInfo, nullptr, &bufferMemory) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to allocate post-processing buffer memory!");
+    }
+
+    vkBindBufferMemory(m_device->getDevice(), buffer, bufferMemory, 0);
+}
+
+uint32_t PostProcessor::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) {
+    VkPhysicalDeviceMemoryProperties memProperties;
+    vkGetPhysicalDeviceMemoryProperties(m_device->getPhysicalDevice(), &memProperties);
+
+    for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++) {
+        if ((typeFilter & (1 << i)) && (memProperties.memoryTypes[i].propertyFlags & properties) == properties) {
+            return i;
+        }
+    }
+
+    throw std::runtime_error("Failed to find suitable memory type!");
+}
@@ -0,0 +1,957 @@
+#include "rendering/RenderGraph.h"
+#include "core/Profiler.h"
+#include "core/DeletionQueue.h"
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+
+bool isDepthFormat(VkFormat format) {
+    return format == VK_FORMAT_D32_SFLOAT || format == VK_FORMAT_D16_UNORM ||
+           format == VK_FORMAT_D24_UNORM_S8_UINT || format == VK_FORMAT_D32_SFLOAT_S8_UINT;
+}
+
+} // namespace
+
+// ---------------------------------------------------------------------------
+// Builder
+
+void RenderGraphBuilder::writeColor(RGHandle image, VkAttachmentLoadOp loadOp, VkClearColorValue clearColor) {
+    RenderGraph::Access access{image, RGUsage::ColorAttachment, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
+    access.loadOp = loadOp;
+    access.clearValue.color = clearColor;
+    m_graph->m_passes[m_passIndex].accesses.push_back(access);
+}
+
+void RenderGraphBuilder::writeDepth(RGHandle image, VkAttachmentLoadOp loadOp, float clearDepth) {
+    RenderGraph::Access access{image, RGUsage::DepthAttachment,
+                               VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT};
+    access.loadOp = loadOp;
+    access.clearValue.depthStencil = {clearDepth, 0};
+    m_graph->m_passes[m_passIndex].accesses.push_back(access);
+}
+
+void RenderGraphBuilder::readDepth(RGHandle image) {
+    RenderGraph::Access access{image, RGUsage::DepthReadOnly,
+                               VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT};
+    access.loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+    m_graph->m_passes[m_passIndex].accesses.push_back(access);
+}
+
+void RenderGraphBuilder::readTexture(RGHandle image, VkPipelineStageFlags stages) {
+    m_graph->m_passes[m_passIndex].accesses.push_back({image, RGUsage::SampledRead, stages});
+}
+
+void RenderGraphBuilder::readStorage(RGHandle resource, VkPipelineStageFlags stages) {
+    m_graph->m_passes[m_passIndex].accesses.push_back({resource, RGUsage::StorageRead, stages});
+}
+
+void RenderGraphBuilder::writeStorage(RGHandle resource, VkPipelineStageFlags stages) {
+    m_graph->m_passes[m_passIndex].accesses.push_back({resource, RGUsage::StorageWrite, stages});
+}
+
+void RenderGraphBuilder::copyFrom(RGHandle resource) {
+    m_graph->m_passes[m_passIndex].accesses.push_back({resource, RGUsage::TransferSrc, VK_PIPELINE_STAGE_TRANSFER_BIT});
+}
+
+void RenderGraphBuilder::copyTo(RGHandle resource) {
+    m_graph->m_passes[m_passIndex].accesses.push_back({resource, RGUsage::TransferDst, VK_PIPELINE_STAGE_TRANSFER_BIT});
+}
+
+void RenderGraphBuilder::readIndirect(RGHandle buffer) {
+    m_graph->m_passes[m_passIndex].accesses.push_back({buffer, RGUsage::IndirectRead, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT});
+}
+
+void RenderGraphBuilder::setSideEffects() {
+    m_graph->m_passes[m_passIndex].sideEffects = true;
+}
+
+// ---------------------------------------------------------------------------
+// Usage tables
+
+bool RenderGraph::isWrite(RGUsage usage) {
+    return usage == RGUsage::ColorAttachment || usage == RGUsage::DepthAttachment ||
+           usage == RGUsage::StorageWrite || usage == RGUsage::TransferDst;
+}
+
+bool RenderGraph::isAttachment(RGUsage usage) {
+    return usage == RGUsage::ColorAttachment || usage == RGUsage::DepthAttachment ||
+           usage == RGUsage::DepthReadOnly;
+}
+
+VkImageLayout RenderGraph::layoutFor(RGUsage usage) {
+    switch (usage) {
+        case RGUsage::ColorAttachment: return VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+        case RGUsage::DepthAttachment: return VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+        case RGUsage::DepthReadOnly: return VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+        case RGUsage::SampledRead: return VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        case RGUsage::StorageRead:
+        case RGUsage::StorageWrite: return VK_IMAGE_LAYOUT_GENERAL;
+        case RGUsage::TransferSrc: return VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+        case RGUsage::TransferDst: return VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        case RGUsage::IndirectRead: return VK_IMAGE_LAYOUT_UNDEFINED; // Buffers only
+    }
+    return VK_IMAGE_LAYOUT_UNDEFINED;
+}
+
+VkAccessFlags RenderGraph::accessFor(RGUsage usage) {
+    switch (usage) {
+        case RGUsage::ColorAttachment: return VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+        case RGUsage::DepthAttachment: return VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+        case RGUsage::DepthReadOnly: return VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT;
+        case RGUsage::SampledRead: return VK_ACCESS_SHADER_READ_BIT;
+        case RGUsage::StorageRead: return VK_ACCESS_SHADER_READ_BIT;
+        case RGUsage::StorageWrite: return VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+        case RGUsage::TransferSrc: return VK_ACCESS_TRANSFER_READ_BIT;
+        case RGUsage::TransferDst: return VK_ACCESS_TRANSFER_WRITE_BIT;
+        case RGUsage::IndirectRead: return VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+    }
+    return 0;
+}
+
+VkImageUsageFlags RenderGraph::imageUsageFor(RGUsage usage) {
+    switch (usage) {
+        case RGUsage::ColorAttachment: return VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+        case RGUsage::DepthAttachment:
+        case RGUsage::DepthReadOnly: return VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+        case RGUsage::SampledRead: return VK_IMAGE_USAGE_SAMPLED_BIT;
+        case RGUsage::StorageRead:
+        case RGUsage::StorageWrite: return VK_IMAGE_USAGE_STORAGE_BIT;
+        case RGUsage::TransferSrc: return VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+        case RGUsage::TransferDst: return VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+        case RGUsage::IndirectRead: return 0;
+    }
+    return 0;
+}
+
+// synchronization2 splits the coarse 1.0 masks: copies get their own stage and
+// shader accesses say whether they sample or touch storage
+VkAccessFlags2 RenderGraph::accessFor2(RGUsage usage) {
+    switch (usage) {
+        case RGUsage::SampledRead: return VK_ACCESS_2_SHADER_SAMPLED_READ_BIT;
+        case RGUsage::StorageRead: return VK_ACCESS_2_SHADER_STORAGE_READ_BIT;
+        case RGUsage::StorageWrite: return VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT;
+        default: return static_cast<VkAccessFlags2>(accessFor(usage));
+    }
+}
+
+VkAccessFlags2 RenderGraph::srcAccessFor2(VkAccessFlags writeAccess) {
+    // Only writes need to be made available; the graph's only shader writes are storage writes
+    VkAccessFlags2 access = static_cast<VkAccessFlags2>(writeAccess & ~(VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT));
+    if (writeAccess & VK_ACCESS_SHADER_WRITE_BIT) {
+        access |= VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT;
+    }
+    return access;
+}
+
+VkPipelineStageFlags2 RenderGraph::stagesFor2(VkPipelineStageFlags stages) {
+    VkPipelineStageFlags2 stages2 = static_cast<VkPipelineStageFlags2>(
+        stages & ~(VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT | VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT));
+    if (stages & VK_PIPELINE_STAGE_TRANSFER_BIT) {
+        stages2 |= VK_PIPELINE_STAGE_2_COPY_BIT; // copyFrom/copyTo are the graph's only transfers
+    }
+    return stages2;
+}
+
+// ---------------------------------------------------------------------------
+// Graph
+
+RenderGraph::RenderGraph(VulkanDevice* device)
+    : m_device(device),
+      m_dynamicRendering(device->supportsDynamicRendering()),
+      m_synchronization2(device->supportsSynchronization2()) {
+}
+
+RenderGraph::~RenderGraph() {
+    // The graph is retired through the deletion queue, so the GPU is done with everything here
+    VkDevice device = m_device->getDevice();
+    for (auto& entry : m_framebufferCache) {
+        vkDestroyFramebuffer(device, entry.second, nullptr);
+    }
+    for (auto& entry : m_renderPassCache) {
+        vkDestroyRenderPass(device, entry.second, nullptr);
+    }
+    for (auto& entry : m_transientImages) {
+        vkDestroyImageView(device, entry.second.view, nullptr);
+        vkDestroyImage(device, entry.second.image, nullptr);
+    }
+    for (auto& block : m_memoryBlocks) {
+        vkFreeMemory(device, block.memory, nullptr);
+    }
+}
+
+void RenderGraph::reset() {
+    m_resources.clear();
+    m_passes.clear();
+    m_finalBarriers.clear();
+    m_finalBarriers2.clear();
+    m_finalSrcStages = 0;
+}
+
+RGHandle RenderGraph::importImage(const std::string& name, VkImage image, VkImageView view, VkFormat format,
+                                  VkExtent2D extent, VkImageLayout initialLayout, VkPipelineStageFlags initialStage,
+                                  VkImageLayout finalLayout, uint32_t mipLevels) {
+    Resource resource;
+    resource.name = name;
+    resource.desc.format = format;
+    resource.desc.extent = extent;
+    resource.aspect = isDepthFormat(format) ? VK_IMAGE_ASPECT_DEPTH_BIT : VK_IMAGE_ASPECT_COLOR_BIT;
+    resource.mipLevels = mipLevels;
+    resource.imported = true;
+    resource.image = image;
+    resource.view = view;
+    resource.initialLayout = initialLayout;
+    resource.initialStage = initialStage;
+    resource.finalLayout = finalLayout;
+    m_resources.push_back(resource);
+    return static_cast<RGHandle>(m_resources.size() - 1);
+}
+
+RGHandle RenderGraph::importBuffer(const std::string& name, VkBuffer buffer, VkDeviceSize size,
+                                   VkPipelineStageFlags initialStage) {
+    Resource resource;
+    resource.name = name;
+    resource.imported = true;
+    resource.isBuffer = true;
+    resource.buffer = buffer;
+    resource.size = size;
+    resource.initialStage = initialStage;
+    m_resources.push_back(resource);
+    return static_cast<RGHandle>(m_resources.size() - 1);
+}
+
+RGHandle RenderGraph::createImage(const std::string& name, const RGImageDesc& desc) {
+    Resource resource;
+    resource.name = name;
+    resource.desc = desc;
+    resource.aspect = isDepthFormat(desc.format) ? VK_IMAGE_ASPECT_DEPTH_BIT : VK_IMAGE_ASPECT_COLOR_BIT;
+    m_resources.push_back(resource);
+    return static_cast<RGHandle>(m_resources.size() - 1);
+}
+
+void RenderGraph::addPass(const std::string& name,
+                          const std::function<void(RenderGraphBuilder&)>& setup,
+                          std::function<void(VkCommandBuffer)> execute) {
+    Pass pass;
+    pass.name = name;
+    pass.execute = std::move(execute);
+    m_passes.push_back(std::move(pass));
+
+    RenderGraphBuilder builder(this, static_cast<uint32_t>(m_passes.size() - 1));
+    setup(builder);
+}
+
+void RenderGraph::compile() {
+    cullPasses();
+    computeLifetimes();
+    allocateTransients();
+    buildBarriers();
+    buildRenderPasses();
+
+    m_stats.passCount = static_cast<uint32_t>(m_passes.size());
+    m_stats.culledPassCount = 0;
+    m_stats.barrierCount = static_cast<uint32_t>(m_finalBarriers.size() + m_finalBarriers2.size());
+    m_passInfo.clear();
+    for (const auto& pass : m_passes) {
+        m_passInfo.push_back({pass.name, pass.culled});
+        if (pass.culled) {
+            m_stats.culledPassCount++;
+        }
+        m_stats.barrierCount += static_cast<uint32_t>(pass.barriers.size() + pass.barriers2.size() +
+                                                      pass.bufferBarriers.size() + pass.bufferBarriers2.size());
+    }
+}
+
+void RenderGraph::cullPasses() {
+    // Walk backwards from the graph outputs. A pass survives if it has side
+    // effects or writes something a later surviving pass (or the output) needs.
+    std::vector<bool> needed(m_resources.size(), false);
+    for (size_t i = 0; i < m_resources.size(); i++) {
+        needed[i] = m_resources[i].imported && m_resources[i].finalLayout != VK_IMAGE_LAYOUT_UNDEFINED;
+    }
+
+    for (size_t p = m_passes.size(); p-- > 0;) {
+        Pass& pass = m_passes[p];
+
+        bool live = pass.sideEffects;
+        for (const auto& access : pass.accesses) {
+            if (isWrite(access.usage) && needed[access.resource]) {
+                live = true;
+            }
+        }
+        pass.culled = !live;
+        if (!live) {
+            continue;
+        }
+
+        // Attachments nobody reads afterwards don't need to leave the tile
+        for (auto& access : pass.accesses) {
+            if (isAttachment(access.usage)) {
+                access.storeOp = needed[access.resource] ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+            }
+        }
+
+        // Full overwrites make earlier contents irrelevant; reads and loads keep them alive
+        for (const auto& access : pass.accesses) {
+            bool overwrites = (isAttachment(access.usage) && isWrite(access.usage) && access.loadOp != VK_ATTACHMENT_LOAD_OP_LOAD) ||
+                              access.usage == RGUsage::TransferDst;
+            if (overwrites) {
+                needed[access.resource] = false;
+            }
+        }
+        for (const auto& access : pass.accesses) {
+            bool overwrites = (isAttachment(access.usage) && isWrite(access.usage) && access.loadOp != VK_ATTACHMENT_LOAD_OP_LOAD) ||
+                              access.usage == RGUsage::TransferDst;
+            if (!overwrites) {
+                needed[access.resource] = true;
+            }
+        }
+    }
+}
+
+void RenderGraph::computeLifetimes() {
+    for (uint32_t p = 0; p < m_passes.size(); p++) {
+        if (m_passes[p].culled) {
+            continue;
+        }
+        for (const auto& access : m_passes[p].accesses) {
+            Resource& resource = m_resources[access.resource];
+            resource.firstPass = std::min(resource.firstPass, p);
+            resource.lastPass = std::max(resource.lastPass, p);
+            resource.desc.usage |= imageUsageFor(access.usage);
+        }
+    }
+}
+
+void RenderGraph::allocateTransients() {
+    std::vector<RGHandle> transients;
+    std::ostringstream signature;
+    for (RGHandle h = 0; h < m_resources.size(); h++) {
+        const Resource& resource = m_resources[h];
+        if (resource.imported || resource.firstPass == UINT32_MAX) {
+            continue;
+        }
+        transients.push_back(h);
+        signature << resource.name << ':' << resource.desc.format << ':' << resource.desc.extent.width << 'x'
+                  << resource.desc.extent.height << ':' << resource.desc.usage << ':' << resource.firstPass << '-'
+                  << resource.lastPass << ';';
+    }
+
+    if (signature.str() != m_transientSignature) {
+        releaseTransients();
+        m_transientSignature = signature.str();
+
+        VkDevice device = m_device->getDevice();
+        for (RGHandle h : transients) {
+            const Resource& resource = m_resources[h];
+
+            VkImageCreateInfo imageInfo{};
+            imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+            imageInfo.imageType = VK_IMAGE_TYPE_2D;
+            imageInfo.extent = {resource.desc.extent.width, resource.desc.extent.height, 1};
+            imageInfo.mipLevels = 1;
+            imageInfo.arrayLayers = 1;
+            imageInfo.format = resource.desc.format;
+            imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+            imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+            imageInfo.usage = resource.desc.usage;
+            imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+            imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+            TransientImage& transient = m_transientImages[resource.name];
+            if (vkCreateImage(device, &imageInfo, nullptr, &transient.image) != VK_SUCCESS) {
+                throw std::runtime_error("Failed to create render graph image!");
+            }
+            vkGetImageMemoryRequirements(device, transient.image, &transient.requirements);
+        }
+
+        // Greedy aliasing: reuse a block whose last occupant is dead before this image's first use
+        std::vector<RGHandle> byFirstUse = transients;
+        std::sort(byFirstUse.begin(), byFirstUse.end(), [this](RGHandle a, RGHandle b) {
+            return m_resources[a].firstPass < m_resources[b].firstPass;
+        });
+
+        std::vector<uint32_t> blockLastPass;
+        VkDeviceSize requestedMemory = 0;
+        for (RGHandle h : byFirstUse) {
+            const Resource& resource = m_resources[h];
+            TransientImage& transient = m_transientImages[resource.name];
+            requestedMemory += transient.requirements.size;
+
+            int32_t chosen = -1;
+            for (size_t b = 0; b < m_memoryBlocks.size(); b++) {
+                bool typeCompatible = (m_memoryBlocks[b].memoryTypeBits & transient.requirements.memoryTypeBits) != 0;
+                if (typeCompatible && blockLastPass[b] < resource.firstPass) {
+                    chosen = static_cast<int32_t>(b);
+                    break;
+                }
+            }
+            if (chosen < 0) {
+                m_memoryBlocks.push_back({});
+                blockLastPass.push_back(0);
+                chosen = static_cast<int32_t>(m_memoryBlocks.size() - 1);
+            }
+
+            MemoryBlock& block = m_memoryBlocks[chosen];
+            // Everything is bound at offset 0, so the block takes the strictest alignment
+            VkDeviceSize alignment = transient.requirements.alignment;
+            block.size = std::max(block.size, (transient.requirements.size + alignment - 1) / alignment * alignment);
+            block.memoryTypeBits &= transient.requirements.memoryTypeBits;
+            blockLastPass[chosen] = resource.lastPass;
+            transient.memoryBlock = chosen;
+        }
+
+        m_stats.transientMemory = 0;
+        for (auto& block : m_memoryBlocks) {
+            VkMemoryAllocateInfo allocInfo{};
+            allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+            allocInfo.allocationSize = block.size;
+            allocInfo.memoryTypeIndex = findMemoryType(block.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+            if (vkAllocateMemory(device, &allocInfo, nullptr, &block.memory) != VK_SUCCESS) {
+                throw std::runtime_error("Failed to allocate render graph memory!");
+            }
+            m_stats.transientMemory += block.size;
+        }
+        m_stats.aliasedMemorySaved = requestedMemory > m_stats.transientMemory ? requestedMemory - m_stats.transientMemory : 0;
+        m_stats.transientImageCount = static_cast<uint32_t>(transients.size());
+
+        for (RGHandle h : transients) {
+            const Resource& resource = m_resources[h];
+            TransientImage& transient = m_transientImages[resource.name];
+            vkBindImageMemory(device, transient.image, m_memoryBlocks[transient.memoryBlock].memory, 0);
+
+            VkImageViewCreateInfo viewInfo{};
+            viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+            viewInfo.image = transient.image;
+            viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+            viewInfo.format = resource.desc.format;
+            viewInfo.subresourceRange.aspectMask = resource.aspect;
+            viewInfo.subresourceRange.baseMipLevel = 0;
+            viewInfo.subresourceRange.levelCount = 1;
+            viewInfo.subresourceRange.baseArrayLayer = 0;
+            viewInfo.subresourceRange.layerCount = 1;
+
+            if (vkCreateImageView(device, &viewInfo, nullptr, &transient.view) != VK_SUCCESS) {
+                throw std::runtime_error("Failed to create render graph image view!");
+            }
+        }
+
+        std::cout << "RenderGraph: " << transients.size() << " transient image(s) in " << m_memoryBlocks.size()
+                  << " memory block(s), " << m_stats.aliasedMemorySaved / 1024 << " KB saved by aliasing" << std::endl;
+    }
+
+    for (RGHandle h : transients) {
+        Resource& resource = m_resources[h];
+        const TransientImage& transient = m_transientImages[resource.name];
+        resource.image = transient.image;
+        resource.view = transient.view;
+        resource.memoryBlock = transient.memoryBlock;
+    }
+}
+
+void RenderGraph::releaseTransients() {
+    if (m_transientImages.empty() && m_framebufferCache.empty()) {
+        return;
+    }
+
+    // Frames in flight may still use them; framebuffers go too since they hold the views
+    VkDevice device = m_device->getDevice();
+    std::vector<TransientImage> images;
+    for (auto& entry : m_transientImages) {
+        images.push_back(entry.second);
+    }
+    std::vector<VkDeviceMemory> memories;
+    for (auto& block : m_memoryBlocks) {
+        memories.push_back(block.memory);
+    }
+    std::vector<VkFramebuffer> framebuffers;
+    for (auto& entry : m_framebufferCache) {
+        framebuffers.push_back(entry.second);
+    }
+
+    m_device->getDeletionQueue()->push([device, images, memories, framebuffers]() {
+        for (auto framebuffer : framebuffers) {
+            vkDestroyFramebuffer(device, framebuffer, nullptr);
+        }
+        for (const auto& image : images) {
+            vkDestroyImageView(device, image.view, nullptr);
+            vkDestroyImage(device, image.image, nullptr);
+        }
+        for (auto memory : memories) {
+            vkFreeMemory(device, memory, nullptr);
+        }
+    });
+
+    m_transientImages.clear();
+    m_memoryBlocks.clear();
+    m_framebufferCache.clear();
+}
+
+void RenderGraph::buildBarriers() {
+    struct State {
+        VkImageLayout layout{VK_IMAGE_LAYOUT_UNDEFINED};
+        VkPipelineStageFlags writeStages{0};
+        VkAccessFlags writeAccess{0};
+        VkPipelineStageFlags readStages{0};
+        VkPipelineStageFlags visibleStages{0};
+        VkAccessFlags visibleAccess{0};
+    };
+
+    // Last use of each resource this frame, needed to hand memory between aliases
+    std::vector<State> lastUse(m_resources.size());
+    for (const auto& pass : m_passes) {
+        if (pass.culled) {
+            continue;
+        }
+        for (const auto& access : pass.accesses) {
+            State& use = lastUse[access.resource];
+            if (isWrite(access.usage)) {
+                use.writeStages = access.stages;
+                use.writeAccess = accessFor(access.usage);
+                use.readStages = 0;
+            } else {
+                use.readStages |= access.stages;
+            }
+        }
+    }
+
+    std::vector<State> states(m_resources.size());
+    for (RGHandle h = 0; h < m_resources.size(); h++) {
+        const Resource& resource = m_resources[h];
+        State& state = states[h];
+        if (resource.imported) {
+            state.layout = resource.initialLayout;
+            state.writeStages = resource.initialStage;
+            continue;
+        }
+        if (resource.memoryBlock < 0) {
+            continue;
+        }
+
+        // Wait for whichever image used this memory last: the previous alias this
+        // frame, or for the first alias, the last one of the previous frame
+        RGHandle previous = h;
+        uint32_t previousFirst = 0;
+        RGHandle wrap = h;
+        uint32_t wrapFirst = resource.firstPass;
+        for (RGHandle other = 0; other < m_resources.size(); other++) {
+            const Resource& o = m_resources[other];
+            if (o.imported || o.memoryBlock != resource.memoryBlock) {
+                continue;
+            }
+            if (o.firstPass < resource.firstPass && o.firstPass >= previousFirst) {
+                previous = other;
+                previousFirst = o.firstPass;
+            }
+            if (o.firstPass > wrapFirst) {
+                wrap = other;
+                wrapFirst = o.firstPass;
+            }
+        }
+        RGHandle source = previous != h ? previous : wrap;
+        state.writeStages = lastUse[source].writeStages;
+        state.writeAccess = lastUse[source].writeAccess;
+        state.readStages = lastUse[source].readStages;
+    }
+
+    auto makeBarrier = [this](RGHandle h, VkImageLayout oldLayout, VkImageLayout newLayout,
+                              VkAccessFlags srcAccess, VkAccessFlags dstAccess) {
+        VkImageMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barrier.oldLayout = oldLayout;
+        barrier.newLayout = newLayout;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.image = m_resources[h].image;
+        barrier.subresourceRange.aspectMask = m_resources[h].aspect;
+        barrier.subresourceRange.baseMipLevel = 0;
+        barrier.subresourceRange.levelCount = m_resources[h].mipLevels;
+        barrier.subresourceRange.baseArrayLayer = 0;
+        barrier.subresourceRange.layerCount = 1;
+        barrier.srcAccessMask = srcAccess;
+        barrier.dstAccessMask = dstAccess;
+        return barrier;
+    };
+
+    auto makeBarrier2 = [this](RGHandle h, VkImageLayout oldLayout, VkImageLayout newLayout,
+                               VkPipelineStageFlags2 srcStages, VkAccessFlags2 srcAccess,
+                               VkPipelineStageFlags2 dstStages, VkAccessFlags2 dstAccess) {
+        VkImageMemoryBarrier2 barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2;
+        barrier.srcStageMask = srcStages;
+        barrier.srcAccessMask = srcAccess;
+        barrier.dstStageMask = dstStages;
+        barrier.dstAccessMask = dstAccess;
+        barrier.oldLayout = oldLayout;
+        barrier.newLayout = newLayout;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.image = m_resources[h].image;
+        barrier.subresourceRange.aspectMask = m_resources[h].aspect;
+        barrier.subresourceRange.baseMipLevel = 0;
+        barrier.subresourceRange.levelCount = m_resources[h].mipLevels;
+        barrier.subresourceRange.baseArrayLayer = 0;
+        barrier.subresourceRange.layerCount = 1;
+        return barrier;
+    };
+
+    auto makeBufferBarrier = [this](RGHandle h, VkAccessFlags srcAccess, VkAccessFlags dstAccess) {
+        VkBufferMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+        barrier.srcAccessMask = srcAccess;
+        barrier.dstAccessMask = dstAccess;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.buffer = m_resources[h].buffer;
+        barrier.offset = 0;
+        barrier.size = VK_WHOLE_SIZE;
+        return barrier;
+    };
+
+    auto makeBufferBarrier2 = [this](RGHandle h, VkPipelineStageFlags2 srcStages, VkAccessFlags2 srcAccess,
+                                     VkPipelineStageFlags2 dstStages, VkAccessFlags2 dstAccess) {
+        VkBufferMemoryBarrier2 barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2;
+        barrier.srcStageMask = srcStages;
+        barrier.srcAccessMask = srcAccess;
+        barrier.dstStageMask = dstStages;
+        barrier.dstAccessMask = dstAccess;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.buffer = m_resources[h].buffer;
+        barrier.offset = 0;
+        barrier.size = VK_WHOLE_SIZE;
+        return barrier;
+    };
+
+    for (auto& pass : m_passes) {
+        pass.barriers.clear();
+        pass.barriers2.clear();
+        pass.bufferBarriers.clear();
+        pass.bufferBarriers2.clear();
+        pass.srcStages = 0;
+        pass.dstStages = 0;
+        if (pass.culled) {
+            continue;
+        }
+
+        for (const auto& access : pass.accesses) {
+            State& state = states[access.resource];
+            bool isBuffer = m_resources[access.resource].isBuffer;
+            VkImageLayout layout = isBuffer ? VK_IMAGE_LAYOUT_UNDEFINED : layoutFor(access.usage);
+            VkAccessFlags accessMask = accessFor(access.usage);
+            bool write = isWrite(access.usage);
+            bool layoutChange = state.layout != layout;
+
+            // Read-after-read, or a read whose producer is already visible: nothing to do
+            bool alreadyVisible = state.writeAccess == 0 ||
+                ((state.visibleAccess & accessMask) == accessMask && (state.visibleStages & access.stages) == access.stages);
+            if (!write && !layoutChange && alreadyVisible) {
+                state.readStages |= access.stages;
+                continue;
+            }
+
+            bool discards = (isAttachment(access.usage) && write && access.loadOp != VK_ATTACHMENT_LOAD_OP_LOAD) ||
+                            access.usage == RGUsage::TransferDst;
+            VkImageLayout oldLayout = discards ? VK_IMAGE_LAYOUT_UNDEFINED : state.layout;
+
+            VkPipelineStageFlags srcStages = state.writeStages;
+            if (write || layoutChange) {
+                srcStages |= state.readStages; // Write-after-read
+            }
+
+            if (isBuffer && m_synchronization2) {
+                pass.bufferBarriers2.push_back(makeBufferBarrier2(access.resource,
+                                                                  stagesFor2(srcStages), srcAccessFor2(state.writeAccess),
+                                                                  stagesFor2(access.stages), accessFor2(access.usage)));
+            } else if (isBuffer) {
+                pass.bufferBarriers.push_back(makeBufferBarrier(access.resource, state.writeAccess, accessMask));
+                pass.srcStages |= srcStages ? srcStages : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+                pass.dstStages |= access.stages;
+            } else if (m_synchronization2) {
+                pass.barriers2.push_back(makeBarrier2(access.resource, oldLayout, layout,
+                                                      stagesFor2(srcStages), srcAccessFor2(state.writeAccess),
+                                                      stagesFor2(access.stages), accessFor2(access.usage)));
+            } else {
+                pass.barriers.push_back(makeBarrier(access.resource, oldLayout, layout, state.writeAccess, accessMask));
+                pass.srcStages |= srcStages ? srcStages : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+                pass.dstStages |= access.stages;
+            }
+
+            state.layout = layout;
+            if (write) {
+                state.writeStages = access.stages;
+                state.writeAccess = accessMask;
+                state.readStages = 0;
+                state.visibleStages = 0;
+                state.visibleAccess = 0;
+            } else {
+                state.readStages = access.stages;
+                state.visibleStages = access.stages;
+                state.visibleAccess = accessMask;
+            }
+        }
+    }
+
+    // Hand outputs over in the layout their consumer expects
+    for (RGHandle h = 0; h < m_resources.size(); h++) {
+        const Resource& resource = m_resources[h];
+        const State& state = states[h];
+        if (!resource.imported || resource.finalLayout == VK_IMAGE_LAYOUT_UNDEFINED || state.layout == resource.finalLayout) {
+            continue;
+        }
+        VkPipelineStageFlags srcStages = state.writeStages | state.readStages;
+        if (m_synchronization2) {
+            // Presentation is ordered by the submit's semaphore, so nothing waits on the GPU side
+            m_finalBarriers2.push_back(makeBarrier2(h, state.layout, resource.finalLayout,
+                                                    stagesFor2(srcStages), srcAccessFor2(state.writeAccess),
+                                                    VK_PIPELINE_STAGE_2_NONE, VK_ACCESS_2_NONE));
+        } else {
+            m_finalBarriers.push_back(makeBarrier(h, state.layout, resource.finalLayout, state.writeAccess, 0));
+            m_finalSrcStages |= srcStages ? srcStages : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+        }
+    }
+}
+
+void RenderGraph::buildRenderPasses() {
+    for (auto& pass : m_passes) {
+        pass.renderPass = VK_NULL_HANDLE;
+        pass.framebuffer = VK_NULL_HANDLE;
+        pass.clearValues.clear();
+        pass.rendering = false;
+        pass.colorAttachments.clear();
+        pass.hasDepthAttachment = false;
+        if (pass.culled) {
+            continue;
+        }
+
+        // Color attachments first, then depth, matching the layout pipelines are built against
+        std::vector<const Access*> attachments;
+        for (const auto& access : pass.accesses) {
+            if (access.usage == RGUsage::ColorAttachment) {
+                attachments.push_back(&access);
+            }
+        }
+        for (const auto& access : pass.accesses) {
+            if (access.usage == RGUsage::DepthAttachment || access.usage == RGUsage::DepthReadOnly) {
+                attachments.push_back(&access);
+            }
+        }
+        if (attachments.empty()) {
+            continue;
+        }
+
+        pass.extent = m_resources[attachments[0]->resource].desc.extent;
+
+        if (m_dynamicRendering) {
+            // No render pass or framebuffer objects: attachments are named when recording
+            for (const Access* access : attachments) {
+                VkRenderingAttachmentInfo attachment{};
+                attachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
+                attachment.imageView = m_resources[access->resource].view;
+                attachment.imageLayout = layoutFor(access->usage);
+                attachment.resolveMode = VK_RESOLVE_MODE_NONE;
+                attachment.loadOp = access->loadOp;
+                attachment.storeOp = access->storeOp;
+                attachment.clearValue = access->clearValue;
+                if (access->usage == RGUsage::ColorAttachment) {
+                    pass.colorAttachments.push_back(attachment);
+                } else {
+                    pass.depthAttachment = attachment;
+                    pass.hasDepthAttachment = true;
+                }
+            }
+            pass.rendering = true;
+            continue;
+        }
+
+        std::vector<VkImageView> views;
+        for (const Access* access : attachments) {
+            views.push_back(m_resources[access->resource].view);
+            pass.clearValues.push_back(access->clearValue);
+        }
+        pass.renderPass = getOrCreateRenderPass(attachments);
+        pass.framebuffer = getOrCreateFramebuffer(pass.renderPass, views, pass.extent);
+    }
+}
+
+VkRenderPass RenderGraph::getOrCreateRenderPass(const std::vector<const Access*>& attachments) {
+    std::ostringstream key;
+    for (const Access* access : attachments) {
+        key << m_resources[access->resource].desc.format << ':' << static_cast<int>(access->usage) << ':'
+            << access->loadOp << ':' << access->storeOp << ';';
+    }
+
+    auto it = m_renderPassCache.find(key.str());
+    if (it != m_renderPassCache.end()) {
+        return it->second;
+    }
+
+    // Layout transitions are done by the graph's barriers, so each attachment
+    // stays in its working layout for the whole pass
+    std::vector<VkAttachmentDescription> descriptions;
+    std::vector<VkAttachmentReference> colorRefs;
+    VkAttachmentReference depthRef{};
+    bool hasDepth = false;
+
+    for (uint32_t i = 0; i < attachments.size(); i++) {
+        const Access* access = attachments[i];
+        VkImageLayout layout = layoutFor(access->usage);
+
+        VkAttachmentDescription description{};
+        description.format = m_resources[access->resource].desc.format;
+        description.samples = VK_SAMPLE_COUNT_1_BIT;
+        description.loadOp = access->loadOp;
+        description.storeOp = access->storeOp;
+        description.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+        description.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        description.initialLayout = layout;
+        description.finalLayout = layout;
+        descriptions.push_back(description);
+
+        if (access->usage == RGUsage::ColorAttachment) {
+            colorRefs.push_back({i, layout});
+        } else {
+            depthRef = {i, layout};
+            hasDepth = true;
+        }
+    }
+
+    VkSubpassDescription subpass{};
+    subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+    subpass.colorAttachmentCount = static_cast<uint32_t>(colorRefs.size());
+    subpass.pColorAttachments = colorRefs.data();
+    subpass.pDepthStencilAttachment = hasDepth ? &depthRef : nullptr;
+
+    VkRenderPassCreateInfo renderPassInfo{};
+    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+    renderPassInfo.attachmentCount = static_cast<uint32_t>(descriptions.size());
+    renderPassInfo.pAttachments = descriptions.data();
+    renderPassInfo.subpassCount = 1;
+    renderPassInfo.pSubpasses = &subpass;
+
+    VkRenderPass renderPass;
+    if (vkCreateRenderPass(m_device->getDevice(), &renderPassInfo, nullptr, &renderPass) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create render graph render pass!");
+    }
+    m_renderPassCache[key.str()] = renderPass;
+    return renderPass;
+}
+
+VkFramebuffer RenderGraph::getOrCreateFramebuffer(VkRenderPass renderPass, const std::vector<VkImageView>& views, VkExtent2D extent) {
+    std::ostringstream key;
+    key << renderPass << ':' << extent.width << 'x' << extent.height;
+    for (VkImageView view : views) {
+        key << ':' << view;
+    }
+
+    auto it = m_framebufferCache.find(key.str());
+    if (it != m_framebufferCache.end()) {
+        return it->second;
+    }
+
+    VkFramebufferCreateInfo framebufferInfo{};
+    framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+    framebufferInfo.renderPass = renderPass;
+    framebufferInfo.attachmentCount = static_cast<uint32_t>(views.size());
+    framebufferInfo.pAttachments = views.data();
+    framebufferInfo.width = extent.width;
+    framebufferInfo.height = extent.height;
+    framebufferInfo.layers = 1;
+
+    VkFramebuffer framebuffer;
+    if (vkCreateFramebuffer(m_device->getDevice(), &framebufferInfo, nullptr, &framebuffer) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create render graph framebuffer!");
+    }
+    m_framebufferCache[key.str()] = framebuffer;
+    return framebuffer;
+}
+
+void RenderGraph::execute(VkCommandBuffer commandBuffer, Profiler* profiler) {
+    for (auto& pass : m_passes) {
+        if (pass.culled) {
+            continue;
+        }
+
+        if (!pass.barriers2.empty() || !pass.bufferBarriers2.empty()) {
+            VkDependencyInfo dependencyInfo{};
+            dependencyInfo.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+            dependencyInfo.bufferMemoryBarrierCount = static_cast<uint32_t>(pass.bufferBarriers2.size());
+            dependencyInfo.pBufferMemoryBarriers = pass.bufferBarriers2.data();
+            dependencyInfo.imageMemoryBarrierCount = static_cast<uint32_t>(pass.barriers2.size());
+            dependencyInfo.pImageMemoryBarriers = pass.barriers2.data();
+            m_device->cmdPipelineBarrier2(commandBuffer, &dependencyInfo);
+        }
+        if (!pass.barriers.empty() || !pass.bufferBarriers.empty()) {
+            vkCmdPipelineBarrier(commandBuffer, pass.srcStages, pass.dstStages, 0, 0, nullptr,
+                                 static_cast<uint32_t>(pass.bufferBarriers.size()), pass.bufferBarriers.data(),
+                                 static_cast<uint32_t>(pass.barriers.size()), pass.barriers.data());
+        }
+
+        uint32_t scope = profiler ? profiler->beginScope(commandBuffer, pass.name) : UINT32_MAX;
+
+        if (pass.renderPass != VK_NULL_HANDLE) {
+            VkRenderPassBeginInfo renderPassInfo{};
+            renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+            renderPassInfo.renderPass = pass.renderPass;
+            renderPassInfo.framebuffer = pass.framebuffer;
+            renderPassInfo.renderArea.offset = {0, 0};
+            renderPassInfo.renderArea.extent = pass.extent;
+            renderPassInfo.clearValueCount = static_cast<uint32_t>(pass.clearValues.size());
+            renderPassInfo.pClearValues = pass.clearValues.data();
+            vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+        } else if (pass.rendering) {
+            VkRenderingInfo renderingInfo{};
+            renderingInfo.sType = VK_STRUCTURE_TYPE_RENDERING_INFO;
+            renderingInfo.renderArea.offset = {0, 0};
+            renderingInfo.renderArea.extent = pass.extent;
+            renderingInfo.layerCount = 1;
+            renderingInfo.colorAttachmentCount = static_cast<uint32_t>(pass.colorAttachments.size());
+            renderingInfo.pColorAttachments = pass.colorAttachments.data();
+            renderingInfo.pDepthAttachment = pass.hasDepthAttachment ? &pass.depthAttachment : nullptr;
+            m_device->cmdBeginRendering(commandBuffer, &renderingInfo);
+        }
+
+        if (pass.execute) {
+            pass.execute(commandBuffer);
+        }
+
+        if (pass.renderPass != VK_NULL_HANDLE) {
+            vkCmdEndRenderPass(commandBuffer);
+        } else if (pass.rendering) {
+            m_device->cmdEndRendering(commandBuffer);
+        }
+
+        if (profiler) {
+            profiler->endScope(commandBuffer, scope);
+        }
+    }
+
+    if (!m_finalBarriers2.empty()) {
+        VkDependencyInfo dependencyInfo{};
+        dependencyInfo.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+        dependencyInfo.imageMemoryBarrierCount = static_cast<uint32_t>(m_finalBarriers2.size());
+        dependencyInfo.pImageMemoryBarriers = m_finalBarriers2.data();
+        m_device->cmdPipelineBarrier2(commandBuffer, &dependencyInfo);
+    }
+    if (!m_finalBarriers.empty()) {
+        vkCmdPipelineBarrier(commandBuffer, m_finalSrcStages, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr,
+                             0, nullptr, static_cast<uint32_t>(m_finalBarriers.size()), m_finalBarriers.data());
+    }
+}
+
+uint32_t RenderGraph::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) {
+    VkPhysicalDeviceMemoryProperties memProperties;
+    vkGetPhysicalDeviceMemoryProperties(m_device->getPhysicalDevice(), &memProperties);
+
+    for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++) {
+        if ((typeFilter & (1 << i)) && (memProperties.memoryTypes[i].propertyFlags & properties) == properties) {
+            return i;
+        }
+    }
+
+    throw std::runtime_error("Failed to find suitable memory type!");
+}
@@ -0,0 +1,999 @@
+#include "rendering/RenderManager.h"
+#include "rendering/PostProcessor.h"
+#include "rendering/RenderPass.h"
+#include "core/CommandContext.h"
+#include <glm/gtc/constants.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+
+namespace {
+// Fraction of a level's own band (from the previous level's range to its own)
+// after which its vertices start morphing towards the next coarser grid
+constexpr float MORPH_START = 0.7f;
+// The heightfield region covers this many view distances, so the camera can
+// wander before it is reassembled; tiles stream in over the whole of it
+constexpr float REGION_EXTENT_SCALE = 3.0f;
+// Entities at this LOD or coarser use the low sphere
+constexpr int ENTITY_LOW_DETAIL_LOD = 2;
+
+// Entity albedo, linear
+const glm::vec4 TRUNK_COLOR(0.35f, 0.22f, 0.12f, 1.0f);
+const glm::vec4 FOLIAGE_COLOR(0.15f, 0.4f, 0.12f, 1.0f);
+const glm::vec4 ROCK_COLOR(0.42f, 0.4f, 0.38f, 1.0f);
+const glm::vec4 WALL_COLOR(0.75f, 0.7f, 0.6f, 1.0f);
+const glm::vec4 ROOF_COLOR(0.5f, 0.18f, 0.12f, 1.0f);
+
+// Corners of a shape's triangles, three per triangle, in any winding
+using Triangles = std::vector<glm::vec3>;
+
+void addQuad(Triangles& triangles, const glm::vec3& a, const glm::vec3& b, const glm::vec3& c, const glm::vec3& d) {
+    triangles.insert(triangles.end(), {a, b, c, a, c, d});
+}
+
+Triangles makeBox() {
+    Triangles triangles;
+    glm::vec3 corners[8];
+    for (int i = 0; i < 8; i++) {
+        corners[i] = glm::vec3((i & 1) ? 0.5f : -0.5f, (i & 2) ? 1.0f : 0.0f, (i & 4) ? 0.5f : -0.5f);
+    }
+    addQuad(triangles, corners[0], corners[1], corners[3], corners[2]); // -z
+    addQuad(triangles, corners[4], corners[5], corners[7], corners[6]); // +z
+    addQuad(triangles, corners[0], corners[4], corners[6], corners[2]); // -x
+    addQuad(triangles, corners[1], corners[5], corners[7], corners[3]); // +x
+    addQuad(triangles, corners[2], corners[3], corners[7], corners[6]); // top
+    addQuad(triangles, corners[0], corners[1], corners[5], corners[4]); // bottom
+    return triangles;
+}
+
+Triangles makeRoof() {
+    Triangles triangles;
+    glm::vec3 base[4] = {glm::vec3(-0.5f, 0.0f, -0.5f), glm::vec3(0.5f, 0.0f, -0.5f),
+                         glm::vec3(0.5f, 0.0f, 0.5f), glm::vec3(-0.5f, 0.0f, 0.5f)};
+    glm::vec3 ridge[2] = {glm::vec3(-0.5f, 1.0f, 0.0f), glm::vec3(0.5f, 1.0f, 0.0f)};
+    addQuad(triangles, base[0], base[1], ridge[1], ridge[0]);
+    addQuad(triangles, base[3], base[2], ridge[1], ridge[0]);
+    triangles.insert(triangles.end(), {base[0], base[3], ridge[0], base[1], base[2], ridge[1]});
+    // Underside, so the shape stays closed for the winding fix-up
+    addQuad(triangles, base[0], base[1], base[2], base[3]);
+    return triangles;
+}
+
+Triangles makeCylinder(uint32_t sides) {
+    Triangles triangles;
+    glm::vec3 bottomCenter(0.0f);
+    glm::vec3 topCenter(0.0f, 1.0f, 0.0f);
+    for (uint32_t i = 0; i < sides; i++) {
+        float a0 = glm::two_pi<float>() * static_cast<float>(i) / static_cast<float>(sides);
+        float a1 = glm::two_pi<float>() * static_cast<float>(i + 1) / static_cast<float>(sides);
+        glm::vec3 p0(std::cos(a0), 0.0f, std::sin(a0));
+        glm::vec3 p1(std::cos(a1), 0.0f, std::sin(a1));
+        glm::vec3 up(0.0f, 1.0f, 0.0f);
+        addQuad(triangles, p0, p1, p1 + up, p0 + up);
+        triangles.insert(triangles.end(), {topCenter, p0 + up, p1 + up, bottomCenter, p0, p1});
+    }
+    return triangles;
+}
+
+// Icosahedron, each face split into four subdivisions times over
+Triangles makeSphere(uint32_t subdivisions) {
+    const float t = (1.0f + std::sqrt(5.0f)) * 0.5f;
+    const glm::vec3 vertices[12] = {
+        {-1.0f, t, 0.0f}, {1.0f, t, 0.0f}, {-1.0f, -t, 0.0f}, {1.0f, -t, 0.0f},
+        {0.0f, -1.0f, t}, {0.0f, 1.0f, t}, {0.0f, -1.0f, -t}, {0.0f, 1.0f, -t},
+        {t, 0.0f, -1.0f}, {t, 0.0f, 1.0f}, {-t, 0.0f, -1.0f}, {-t, 0.0f, 1.0f}};
+    const uint32_t faces[20][3] = {
+        {0, 11, 5}, {0, 5, 1}, {0, 1, 7}, {0, 7, 10}, {0, 10, 11}, {1, 5, 9}, {5, 11, 4},
+        {11, 10, 2}, {10, 7, 6}, {7, 1, 8}, {3, 9, 4}, {3, 4, 2}, {3, 2, 6}, {3, 6, 8},
+        {3, 8, 9}, {4, 9, 5}, {2, 4, 11}, {6, 2, 10}, {8, 6, 7}, {9, 8, 1}};
+
+    Triangles triangles;
+    for (const auto& face : faces) {
+        triangles.insert(triangles.end(), {glm::normalize(vertices[face[0]]), glm::normalize(vertices[face[1]]),
+                                           glm::normalize(vertices[face[2]])});
+    }
+    for (uint32_t level = 0; level < subdivisions; level++) {
+        Triangles finer;
+        finer.reserve(triangles.size() * 4);
+        for (size_t i = 0; i < triangles.size(); i += 3) {
+            glm::vec3 a = triangles[i];
+            glm::vec3 b = triangles[i + 1];
+            glm::vec3 c = triangles[i + 2];
+            glm::vec3 ab = glm::normalize(a + b);
+            glm::vec3 bc = glm::normalize(b + c);
+            glm::vec3 ca = glm::normalize(c + a);
+            finer.insert(finer.end(), {a, ab, ca, ab, b, bc, ca, bc, c, ab, bc, ca});
+        }
+        triangles = std::move(finer);
+    }
+    return triangles;
+}
+}
+
+RenderManager::RenderManager(VulkanDevice* device, VkRenderPass sceneRenderPass) : m_device(device) {
+    m_heightfield = std::make_unique<TerrainHeightfield>(device);
+    m_noiseTexture = std::make_unique<NoiseTexture>(device);
+    createUniformBuffers();
+    createTraceSampler();
+    createDescriptors();
+    createPatchMesh();
+    createEntityMeshes();
+    createPipelines(sceneRenderPass);
+    std::cout << "RenderManager: " << PATCH_RESOLUTION << "x" << PATCH_RESOLUTION << " patch, " << LOD_LEVELS
+              << " LOD levels, up to " << MAX_PATCHES << " patches" << std::endl;
+}
+
+RenderManager::~RenderManager() {
+    VkDevice device = m_device->getDevice();
+    for (VkPipeline pipeline : {m_terrainPipeline, m_raymarchPipeline, m_skyPipeline, m_tracePipeline,
+                                m_upsamplePipeline, m_entityPipeline}) {
+        if (pipeline != VK_NULL_HANDLE) vkDestroyPipeline(device, pipeline, nullptr);
+    }
+    if (m_terrainPipelineLayout != VK_NULL_HANDLE) {
+        vkDestroyPipelineLayout(device, m_terrainPipelineLayout, nullptr);
+    }
+    if (m_descriptorPool != VK_NULL_HANDLE) {
+        vkDestroyDescriptorPool(device, m_descriptorPool, nullptr);
+    }
+    for (VkDescriptorSetLayout layout : {m_terrainDescriptorLayout, m_traceDescriptorLayout}) {
+        if (layout != VK_NULL_HANDLE) vkDestroyDescriptorSetLayout(device, layout, nullptr);
+    }
+    if (m_traceSampler != VK_NULL_HANDLE) {
+        vkDestroySampler(device, m_traceSampler, nullptr);
+    }
+    m_traceRenderPass.reset();
+    for (VkBuffer buffer : {m_terrainUniformBuffer, m_instanceBuffer, m_patchVertexBuffer, m_patchIndexBuffer,
+                            m_entityInstanceBuffer, m_entityVertexBuffer}) {
+        if (buffer != VK_NULL_HANDLE) vkDestroyBuffer(device, buffer, nullptr);
+    }
+    for (VkDeviceMemory memory : {m_terrainUniformMemory, m_instanceMemory, m_patchVertexMemory, m_patchIndexMemory,
+                                  m_entityInstanceMemory, m_entityVertexMemory}) {
+        if (memory != VK_NULL_HANDLE) vkFreeMemory(device, memory, nullptr);
+    }
+    m_heightfield.reset();
+    m_noiseTexture.reset();
+}
+
+void RenderManager::createUniformBuffers() {
+    VkDevice device = m_device->getDevice();
+
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(m_device->getPhysicalDevice(), &properties);
+    VkDeviceSize alignment = std::max<VkDeviceSize>(properties.limits.minUniformBufferOffsetAlignment, 1);
+    m_uniformSlotSize = (sizeof(TerrainUniformData) + alignment - 1) / alignment * alignment;
+
+    // All rings persistently mapped; the CPU writes one slot per frame
+    createBuffer(m_uniformSlotSize * RING_SLOTS, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+                 VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                 m_terrainUniformBuffer, m_terrainUniformMemory);
+    vkMapMemory(device, m_terrainUniformMemory, 0, m_uniformSlotSize * RING_SLOTS, 0, &m_terrainUniformMapped);
+
+    VkDeviceSize instanceSize = sizeof(PatchInstance) * MAX_PATCHES * RING_SLOTS;
+    createBuffer(instanceSize, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+                 VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                 m_instanceBuffer, m_instanceMemory);
+    vkMapMemory(device, m_instanceMemory, 0, instanceSize, 0, &m_instanceMapped);
+
+    VkDeviceSize entityInstanceSize = sizeof(EntityInstance) * MAX_ENTITY_INSTANCES * RING_SLOTS;
+    createBuffer(entityInstanceSize, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+                 VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                 m_entityInstanceBuffer, m_entityInstanceMemory);
+    vkMapMemory(device, m_entityInstanceMemory, 0, entityInstanceSize, 0, &m_entityInstanceMapped);
+}
+
+void RenderManager::createDescriptors() {
+    VkDevice device = m_device->getDevice();
+
+    // 0 uniform ring, 1 material noise
+    std::array<VkDescriptorSetLayoutBinding, 2> bindings{};
+    bindings[0].binding = 0;
+    bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+    bindings[0].descriptorCount = 1;
+    bindings[0].stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+    bindings[1].binding = 1;
+    bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    bindings[1].descriptorCount = 1;
+    bindings[1].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+    layoutInfo.pBindings = bindings.data();
+
+    if (vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &m_terrainDescriptorLayout) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create terrain descriptor set layout!");
+    }
+
+    // Trace color and distance, read by the upsample
+    std::array<VkDescriptorSetLayoutBinding, 2> traceBindings{};
+    for (uint32_t i = 0; i < traceBindings.size(); i++) {
+        traceBindings[i].binding = i;
+        traceBindings[i].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        traceBindings[i].descriptorCount = 1;
+        traceBindings[i].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+    }
+    layoutInfo.bindingCount = static_cast<uint32_t>(traceBindings.size());
+    layoutInfo.pBindings = traceBindings.data();
+
+    if (vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &m_traceDescriptorLayout) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create terrain trace descriptor set layout!");
+    }
+
+    std::array<VkDescriptorPoolSize, 2> poolSizes{};
+    poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+    poolSizes[0].descriptorCount = 1;
+    poolSizes[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    poolSizes[1].descriptorCount = 1 + static_cast<uint32_t>(traceBindings.size()) * RING_SLOTS;
+
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+    poolInfo.pPoolSizes = poolSizes.data();
+    poolInfo.maxSets = 1 + RING_SLOTS;
+
+    if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &m_descriptorPool) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create terrain descriptor pool!");
+    }
+
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = m_descriptorPool;
+    allocInfo.descriptorSetCount = 1;
+    allocInfo.pSetLayouts = &m_terrainDescriptorLayout;
+
+    if (vkAllocateDescriptorSets(device, &allocInfo, &m_terrainDescriptorSet) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to allocate terrain descriptor set!");
+    }
+
+    // Written per frame by renderTrace()
+    std::array<VkDescriptorSetLayout, RING_SLOTS> traceLayouts;
+    traceLayouts.fill(m_traceDescriptorLayout);
+    allocInfo.descriptorSetCount = RING_SLOTS;
+    allocInfo.pSetLayouts = traceLayouts.data();
+
+    if (vkAllocateDescriptorSets(device, &allocInfo, m_traceDescriptorSets.data()) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to allocate terrain trace descriptor sets!");
+    }
+
+    VkDescriptorBufferInfo bufferInfo{};
+    bufferInfo.buffer = m_terrainUniformBuffer;
+    bufferInfo.offset = 0;
+    bufferInfo.range = sizeof(TerrainUniformData);
+
+    VkDescriptorImageInfo noiseInfo{m_noiseTexture->getSampler(), m_noiseTexture->getImageView(),
+                                    VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
+
+    std::array<VkWriteDescriptorSet, 2> writes{};
+    writes[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    writes[0].dstSet = m_terrainDescriptorSet;
+    writes[0].dstBinding = 0;
+    writes[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+    writes[0].descriptorCount = 1;
+    writes[0].pBufferInfo = &bufferInfo;
+    writes[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    writes[1].dstSet = m_terrainDescriptorSet;
+    writes[1].dstBinding = 1;
+    writes[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    writes[1].descriptorCount = 1;
+    writes[1].pImageInfo = &noiseInfo;
+
+    vkUpdateDescriptorSets(device, static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+}
+
+void RenderManager::createTraceSampler() {
+    // The upsample fetches exact texels and weighs them itself
+    VkSamplerCreateInfo samplerInfo{};
+    samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    samplerInfo.magFilter = VK_FILTER_NEAREST;
+    samplerInfo.minFilter = VK_FILTER_NEAREST;
+    samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+    samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.maxLod = 0.0f;
+
+    if (vkCreateSampler(m_device->getDevice(), &samplerInfo, nullptr, &m_traceSampler) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create terrain trace sampler!");
+    }
+}
+
+void RenderManager::createPatchMesh() {
+    VkDevice device = m_device->getDevice();
+    constexpr uint32_t side = PATCH_RESOLUTION + 1;
+    static_assert(side * side <= 65536, "Patch vertices must be addressable with 16-bit indices");
+
+    std::vector<PatchVertex> vertices;
+    vertices.reserve(side * side);
+    for (uint32_t j = 0; j < side; j++) {
+        for (uint32_t i = 0; i < side; i++) {
+            vertices.push_back({glm::vec2(static_cast<float>(i), static_cast<float>(j))});
+        }
+    }
+
+    // Counter-clockwise seen from above, front-facing under the scene's projection
+    std::vector<uint16_t> indices;
+    indices.reserve(PATCH_RESOLUTION * PATCH_RESOLUTION * 6);
+    for (uint32_t j = 0; j < PATCH_RESOLUTION; j++) {
+        for (uint32_t i = 0; i < PATCH_RESOLUTION; i++) {
+            uint16_t v00 = static_cast<uint16_t>(j * side + i);
+            uint16_t v10 = static_cast<uint16_t>(v00 + 1);
+            uint16_t v01 = static_cast<uint16_t>(v00 + side);
+            uint16_t v11 = static_cast<uint16_t>(v01 + 1);
+            indices.insert(indices.end(), {v00, v01, v10, v10, v01, v11});
+        }
+    }
+    m_patchIndexCount = static_cast<uint32_t>(indices.size());
+
+    VkDeviceSize vertexSize = vertices.size() * sizeof(PatchVertex);
+    VkDeviceSize indexSize = indices.size() * sizeof(uint16_t);
+    createBuffer(vertexSize, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                 VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_patchVertexBuffer, m_patchVertexMemory);
+    createBuffer(indexSize, VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                 VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_patchIndexBuffer, m_patchIndexMemory);
+
+    VkBuffer stagingBuffer;
+    VkDeviceMemory stagingMemory;
+    createBuffer(vertexSize + indexSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                 VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                 stagingBuffer, stagingMemory);
+    void* data;
+    vkMapMemory(device, stagingMemory, 0, vertexSize + indexSize, 0, &data);
+    memcpy(data, vertices.data(), vertexSize);
+    memcpy(static_cast<char*>(data) + vertexSize, indices.data(), indexSize);
+    vkUnmapMemory(device, stagingMemory);
+
+    CommandContext context(m_device, VulkanDevice::QueueType::Graphics);
+    VkCommandBuffer commandBuffer = context.begin();
+    VkBufferCopy vertexCopy{0, 0, vertexSize};
+    VkBufferCopy indexCopy{vertexSize, 0, indexSize};
+    vkCmdCopyBuffer(commandBuffer, stagingBuffer, m_patchVertexBuffer, 1, &vertexCopy);
+    vkCmdCopyBuffer(commandBuffer, stagingBuffer, m_patchIndexBuffer, 1, &indexCopy);
+    context.submitAndWait(commandBuffer);
+
+    vkDestroyBuffer(device, stagingBuffer, nullptr);
+    vkFreeMemory(device, stagingMemory, nullptr);
+}
+
+void RenderManager::createEntityMeshes() {
+    VkDevice device = m_device->getDevice();
+
+    std::array<Triangles, ENTITY_MESH_COUNT> shapes;
+    shapes[ENTITY_BOX] = makeBox();
+    shapes[ENTITY_ROOF] = makeRoof();
+    shapes[ENTITY_CYLINDER] = makeCylinder(8);
+    shapes[ENTITY_SPHERE] = makeSphere(1);
+    shapes[ENTITY_SPHERE_LOW] = makeSphere(0);
+
+    // Flat shaded, so every triangle gets its own vertices. The shapes are convex,
+    // so a triangle faces outwards when its normal points away from their centre;
+    // counter-clockwise from outside, like the terrain patch.
+    std::vector<EntityVertex> vertices;
+    for (uint32_t mesh = 0; mesh < ENTITY_MESH_COUNT; mesh++) {
+        const Triangles& triangles = shapes[mesh];
+        glm::vec3 center(0.0f);
+        for (const glm::vec3& corner : triangles) {
+            center += corner;
+        }
+        center /= static_cast<float>(triangles.size());
+
+        m_entityFirstVertex[mesh] = static_cast<uint32_t>(vertices.size());
+        m_entityVertexCount[mesh] = static_cast<uint32_t>(triangles.size());
+        for (size_t i = 0; i < triangles.size(); i += 3) {
+            glm::vec3 a = triangles[i];
+            glm::vec3 b = triangles[i + 1];
+            glm::vec3 c = triangles[i + 2];
+            glm::vec3 normal = glm::normalize(glm::cross(b - a, c - a));
+            if (glm::dot(normal, (a + b + c) / 3.0f - center) < 0.0f) {
+                std::swap(b, c);
+                normal = -normal;
+            }
+            vertices.insert(vertices.end(), {{a, normal}, {b, normal}, {c, normal}});
+        }
+    }
+
+    VkDeviceSize vertexSize = vertices.size() * sizeof(EntityVertex);
+    createBuffer(vertexSize, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                 VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_entityVertexBuffer, m_entityVertexMemory);
+
+    VkBuffer stagingBuffer;
+    VkDeviceMemory stagingMemory;
+    createBuffer(vertexSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                 VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                 stagingBuffer, stagingMemory);
+    void* data;
+    vkMapMemory(device, stagingMemory, 0, vertexSize, 0, &data);
+    memcpy(data, vertices.data(), vertexSize);
+    vkUnmapMemory(device, stagingMemory);
+
+    CommandContext context(m_device, VulkanDevice::QueueType::Graphics);
+    VkCommandBuffer commandBuffer = context.begin();
+    VkBufferCopy copy{0, 0, vertexSize};
+    vkCmdCopyBuffer(commandBuffer, stagingBuffer, m_entityVertexBuffer, 1, &copy);
+    context.submitAndWait(commandBuffer);
+
+    vkDestroyBuffer(device, stagingBuffer, nullptr);
+    vkFreeMemory(device, stagingMemory, nullptr);
+}
+
+void RenderManager::createPipelines(VkRenderPass sceneRenderPass) {
+    // Set 0: uniform ring and noise, set 1: the heightfield, set 2: the trace targets
+    VkDescriptorSetLayout setLayouts[] = {m_terrainDescriptorLayout, m_heightfield->getDescriptorSetLayout(),
+                                          m_traceDescriptorLayout};
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = 3;
+    pipelineLayoutInfo.pSetLayouts = setLayouts;
+
+    if (vkCreatePipelineLayout(m_device->getDevice(), &pipelineLayoutInfo, nullptr, &m_terrainPipelineLayout)
+        != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create terrain pipeline layout!");
+    }
+
+    // CDLOD patches: the shared grid per vertex, the node per instance
+    std::array<VkVertexInputBindingDescription, 2> bindings{};
+    bindings[0].binding = 0;
+    bindings[0].stride = sizeof(PatchVertex);
+    bindings[0].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+    bindings[1].binding = 1;
+    bindings[1].stride = sizeof(PatchInstance);
+    bindings[1].inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
+
+    std::array<VkVertexInputAttributeDescription, 3> attributes{};
+    attributes[0] = {0, 0, VK_FORMAT_R32G32_SFLOAT, offsetof(PatchVertex, grid)};
+    attributes[1] = {1, 1, VK_FORMAT_R32G32B32A32_SFLOAT, offsetof(PatchInstance, node)};
+    attributes[2] = {2, 1, VK_FORMAT_R32G32B32A32_SFLOAT, offsetof(PatchInstance, morph)};
+
+    VkPipelineVertexInputStateCreateInfo patchInput{};
+    patchInput.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+    patchInput.vertexBindingDescriptionCount = static_cast<uint32_t>(bindings.size());
+    patchInput.pVertexBindingDescriptions = bindings.data();
+    patchInput.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributes.size());
+    patchInput.pVertexAttributeDescriptions = attributes.data();
+
+    float patchResolution = static_cast<float>(PATCH_RESOLUTION);
+    VkSpecializationMapEntry resolutionEntry{0, 0, sizeof(float)};
+    VkSpecializationInfo resolutionInfo{1, &resolutionEntry, sizeof(float), &patchResolution};
+
+    // Same attachments as the forward pass
+    std::vector<VkFormat> sceneFormats = {PostProcessor::HDR_FORMAT};
+    m_terrainPipeline = createPipeline("terrain_mesh.vert.spv", "terrain_mesh.frag.spv", patchInput,
+                                       &resolutionInfo, nullptr, VK_COMPARE_OP_LESS, true, sceneFormats,
+                                       RenderPass::DEPTH_FORMAT, sceneRenderPass);
+
+    // terrain.frag as a fullscreen triangle. Sky pixels write the far plane, so
+    // LESS_OR_EQUAL keeps them to where the cleared depth is still showing.
+    VkPipelineVertexInputStateCreateInfo emptyInput{};
+    emptyInput.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+
+    // TRACE_TERRAIN and RAYMARCH_PASS
+    struct RaymarchSpecialization {
+        VkBool32 traceTerrain;
+        int32_t pass;
+    };
+    std::array<VkSpecializationMapEntry, 2> raymarchEntries{};
+    raymarchEntries[0] = {0, offsetof(RaymarchSpecialization, traceTerrain), sizeof(VkBool32)};
+    raymarchEntries[1] = {1, offsetof(RaymarchSpecialization, pass), sizeof(int32_t)};
+    auto raymarchInfo = [&](const RaymarchSpecialization& data) {
+        return VkSpecializationInfo{static_cast<uint32_t>(raymarchEntries.size()), raymarchEntries.data(),
+                                    sizeof(RaymarchSpecialization), &data};
+    };
+
+    RaymarchSpecialization raymarch{VK_TRUE, 0};
+    VkSpecializationInfo info = raymarchInfo(raymarch);
+    m_raymarchPipeline = createPipeline("fullscreen.vert.spv", "terrain.frag.spv", emptyInput, nullptr, &info,
+                                        VK_COMPARE_OP_LESS_OR_EQUAL, true, sceneFormats, RenderPass::DEPTH_FORMAT,
+                                        sceneRenderPass);
+
+    RaymarchSpecialization skyOnly{VK_FALSE, 0};
+    info = raymarchInfo(skyOnly);
+    m_skyPipeline = createPipeline("fullscreen.vert.spv", "terrain.frag.spv", emptyInput, nullptr, &info,
+                                   VK_COMPARE_OP_LESS_OR_EQUAL, false, sceneFormats, RenderPass::DEPTH_FORMAT,
+                                   sceneRenderPass);
+
+    // The trace sees no scene depth; occlusion is resolved per pixel by the upsample's depth test
+    std::vector<VkFormat> traceFormats = {TRACE_COLOR_FORMAT, TRACE_DISTANCE_FORMAT};
+    if (sceneRenderPass != VK_NULL_HANDLE) {
+        m_traceRenderPass = std::make_unique<RenderPass>(m_device, traceFormats, false);
+    }
+    RaymarchSpecialization trace{VK_TRUE, 1};
+    info = raymarchInfo(trace);
+    m_tracePipeline = createPipeline("fullscreen.vert.spv", "terrain.frag.spv", emptyInput, nullptr, &info,
+                                     VK_COMPARE_OP_ALWAYS, false, traceFormats, VK_FORMAT_UNDEFINED,
+                                     m_traceRenderPass ? m_traceRenderPass->getRenderPass() : VK_NULL_HANDLE);
+
+    RaymarchSpecialization upsample{VK_TRUE, 2};
+    info = raymarchInfo(upsample);
+    m_upsamplePipeline = createPipeline("fullscreen.vert.spv", "terrain.frag.spv", emptyInput, nullptr, &info,
+                                        VK_COMPARE_OP_LESS_OR_EQUAL, true, sceneFormats, RenderPass::DEPTH_FORMAT,
+                                        sceneRenderPass);
+
+    // Entities: a shape per vertex, its placement per instance. Only set 0 is
+    // read, which the terrain layout starts with.
+    std::array<VkVertexInputBindingDescription, 2> entityBindings{};
+    entityBindings[0].binding = 0;
+    entityBindings[0].stride = sizeof(EntityVertex);
+    entityBindings[0].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+    entityBindings[1].binding = 1;
+    entityBindings[1].stride = sizeof(EntityInstance);
+    entityBindings[1].inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
+
+    std::array<VkVertexInputAttributeDescription, 5> entityAttributes{};
+    entityAttributes[0] = {0, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(EntityVertex, position)};
+    entityAttributes[1] = {1, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(EntityVertex, normal)};
+    entityAttributes[2] = {2, 1, VK_FORMAT_R32G32B32A32_SFLOAT, offsetof(EntityInstance, placement)};
+    entityAttributes[3] = {3, 1, VK_FORMAT_R32G32B32A32_SFLOAT, offsetof(EntityInstance, scale)};
+    entityAttributes[4] = {4, 1, VK_FORMAT_R32G32B32A32_SFLOAT, offsetof(EntityInstance, color)};
+
+    VkPipelineVertexInputStateCreateInfo entityInput{};
+    entityInput.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+    entityInput.vertexBindingDescriptionCount = static_cast<uint32_t>(entityBindings.size());
+    entityInput.pVertexBindingDescriptions = entityBindings.data();
+    entityInput.vertexAttributeDescriptionCount = static_cast<uint32_t>(entityAttributes.size());
+    entityInput.pVertexAttributeDescriptions = entityAttributes.data();
+
+    m_entityPipeline = createPipeline("entity.vert.spv", "entity.frag.spv", entityInput, nullptr, nullptr,
+                                      VK_COMPARE_OP_LESS, true, sceneFormats, RenderPass::DEPTH_FORMAT,
+                                      sceneRenderPass);
+}
+
+VkPipeline RenderManager::createPipeline(const std::string& vertexShader, const std::string& fragmentShader,
+                                         const VkPipelineVertexInputStateCreateInfo& vertexInput,
+                                         const VkSpecializationInfo* vertexSpecialization,
+                                         const VkSpecializationInfo* fragmentSpecialization, VkCompareOp depthCompare,
+                                         bool depthWrite, const std::vector<VkFormat>& colorFormats,
+                                         VkFormat depthFormat, VkRenderPass renderPass) {
+    auto shaderDir = std::filesystem::current_path() / "shaders";
+    VkShaderModule vertShaderModule = createShaderModule(readShaderFile((shaderDir / vertexShader).string()));
+    VkShaderModule fragShaderModule = createShaderModule(readShaderFile((shaderDir / fragmentShader).string()));
+
+    VkPipelineShaderStageCreateInfo shaderStages[2]{};
+    shaderStages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    shaderStages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+    shaderStages[0].module = vertShaderModule;
+    shaderStages[0].pName = "main";
+    shaderStages[0].pSpecializationInfo = vertexSpecialization;
+    shaderStages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    shaderStages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+    shaderStages[1].module = fragShaderModule;
+    shaderStages[1].pName = "main";
+    shaderStages[1].pSpecializationInfo = fragmentSpecialization;
+
+    VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
+    inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+    inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+    inputAssembly.primitiveRestartEnable = VK_FALSE;
+
+    VkPipelineViewportStateCreateInfo viewportState{};
+    viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+    viewportState.viewportCount = 1;
+    viewportState.scissorCount = 1;
+
+    // Shares the render size of the pass it is drawn in
+    VkDynamicState dynamicStates[] = {VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR};
+    VkPipelineDynamicStateCreateInfo dynamicState{};
+    dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+    dynamicState.dynamicStateCount = 2;
+    dynamicState.pDynamicStates = dynamicStates;
+
+    VkPipelineRasterizationStateCreateInfo rasterizer{};
+    rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+    rasterizer.depthClampEnable = VK_FALSE;
+    rasterizer.rasterizerDiscardEnable = VK_FALSE;
+    rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
+    rasterizer.lineWidth = 1.0f;
+    rasterizer.cullMode = VK_CULL_MODE_BACK_BIT;
+    rasterizer.frontFace = VK_FRONT_FACE_CLOCKWISE;
+
+    VkPipelineMultisampleStateCreateInfo multisampling{};
+    multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+    multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+
+    VkPipelineDepthStencilStateCreateInfo depthStencil{};
+    depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+    depthStencil.depthTestEnable = depthFormat != VK_FORMAT_UNDEFINED ? VK_TRUE : VK_FALSE;
+    depthStencil.depthWriteEnable = depthWrite ? VK_TRUE : VK_FALSE;
+    depthStencil.depthCompareOp = depthCompare;
+
+    VkPipelineColorBlendAttachmentState colorBlendAttachment{};
+    colorBlendAttachment.colorWriteMask =
+        VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+    colorBlendAttachment.blendEnable = VK_FALSE;
+    std::vector<VkPipelineColorBlendAttachmentState> blendAttachments(colorFormats.size(), colorBlendAttachment);
+
+    VkPipelineColorBlendStateCreateInfo colorBlending{};
+    colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+    colorBlending.logicOpEnable = VK_FALSE;
+    colorBlending.attachmentCount = static_cast<uint32_t>(blendAttachments.size());
+    colorBlending.pAttachments = blendAttachments.data();
+
+    VkGraphicsPipelineCreateInfo pipelineInfo{};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+    pipelineInfo.stageCount = 2;
+    pipelineInfo.pStages = shaderStages;
+    pipelineInfo.pVertexInputState = &vertexInput;
+    pipelineInfo.pInputAssemblyState = &inputAssembly;
+    pipelineInfo.pViewportState = &viewportState;
+    pipelineInfo.pRasterizationState = &rasterizer;
+    pipelineInfo.pMultisampleState = &multisampling;
+    pipelineInfo.pDepthStencilState = &depthStencil;
+    pipelineInfo.pColorBlendState = &colorBlending;
+    pipelineInfo.pDynamicState = &dynamicState;
+    pipelineInfo.layout = m_terrainPipelineLayout;
+    pipelineInfo.subpass = 0;
+
+    VkPipelineRenderingCreateInfo renderingInfo{};
+    renderingInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO;
+    renderingInfo.colorAttachmentCount = static_cast<uint32_t>(colorFormats.size());
+    renderingInfo.pColorAttachmentFormats = colorFormats.data();
+    renderingInfo.depthAttachmentFormat = depthFormat;
+
+    if (renderPass != VK_NULL_HANDLE) {
+        pipelineInfo.renderPass = renderPass;
+    } else {
+        pipelineInfo.pNext = &renderingInfo;
+        pipelineInfo.renderPass = VK_NULL_HANDLE;
+    }
+
+    VkPipeline pipeline;
+    if (vkCreateGraphicsPipelines(m_device->getDevice(), VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &pipeline)
+        != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create terrain pipeline (" + fragmentShader + ")!");
+    }
+
+    vkDestroyShaderModule(m_device->getDevice(), fragShaderModule, nullptr);
+    vkDestroyShaderModule(m_device->getDevice(), vertShaderModule, nullptr);
+    return pipeline;
+}
+
+bool RenderManager::update(const Settings& settings, const glm::mat4& viewMatrix, const glm::mat4& projMatrix,
+                           VkExtent2D extent, float time) {
+    m_technique = settings.technique;
+    m_traceExtent = {0, 0};
+    uint32_t traceScale = m_technique == Technique::Raymarch ? std::clamp(settings.raymarchScale, 1u, 4u) : 1;
+    if (traceScale > 1) {
+        m_traceExtent = {(extent.width + traceScale - 1) / traceScale, (extent.height + traceScale - 1) / traceScale};
+    }
+    m_cameraPos = glm::vec3(glm::inverse(viewMatrix)[3]);
+    m_viewDistance = settings.viewDistance;
+
+    m_heightfieldParameters.terrain.terrainScale = settings.terrainScale;
+    m_heightfieldParameters.terrain.terrainHeight = settings.terrainHeight;
+    m_heightfieldParameters.terrain.qualityLevel = settings.qualityLevel;
+    m_heightfieldParameters.extent = settings.viewDistance * REGION_EXTENT_SCALE;
+    bool heightfieldWork = m_heightfield->update(m_cameraPos, m_heightfieldParameters);
+    m_stats.tiles = m_heightfield->getTileStats();
+
+    m_slot = (m_slot + 1) % RING_SLOTS;
+    updateTerrainUniforms(settings, viewMatrix, projMatrix, extent, traceScale, time);
+
+    m_patchCount = 0;
+    if (m_technique == Technique::Mesh) {
+        selectPatches(settings, projMatrix * viewMatrix);
+    }
+    m_stats.patches = m_patchCount;
+    m_stats.triangles = m_patchCount * PATCH_RESOLUTION * PATCH_RESOLUTION * 2;
+
+    // Until updateEntities() fills this slot
+    m_entityInstanceCount.fill(0);
+    m_stats.entityInstances = 0;
+
+    return heightfieldWork;
+}
+
+void RenderManager::updateEntities(const std::vector<RenderSystem::RenderData>& renderList) {
+    for (std::vector<EntityInstance>& batch : m_entityBatches) {
+        batch.clear();
+    }
+
+    for (const RenderSystem::RenderData& data : renderList) {
+        float yaw = data.rotation.y;
+        auto place = [&](EntityMesh mesh, float height, const glm::vec3& scale, const glm::vec4& color) {
+            glm::vec3 position = data.position + glm::vec3(0.0f, height * data.scale.y, 0.0f);
+            m_entityBatches[mesh].push_back({glm::vec4(position, yaw), glm::vec4(scale * data.scale, 0.0f), color});
+        };
+        EntityMesh sphere = data.lodLevel >= ENTITY_LOW_DETAIL_LOD ? ENTITY_SPHERE_LOW : ENTITY_SPHERE;
+
+        switch (data.type) {
+            case RenderComponent::EntityType::TREE: {
+                float trunkRadius = data.tree.trunkRadius;
+                float foliageRadius = data.tree.foliageRadius;
+                // The crown sinks a little onto the trunk
+                place(ENTITY_CYLINDER, 0.0f, glm::vec3(trunkRadius, data.tree.trunkHeight, trunkRadius), TRUNK_COLOR);
+                place(sphere, data.tree.trunkHeight + foliageRadius * 0.7f, glm::vec3(foliageRadius), FOLIAGE_COLOR);
+                break;
+            }
+            case RenderComponent::EntityType::ROCK:
+                // Half buried
+                place(sphere, data.rock.dimensions.y * 0.2f, data.rock.dimensions * 0.5f, ROCK_COLOR);
+                break;
+            case RenderComponent::EntityType::HOUSE: {
+                glm::vec2 footprint = data.house.dimensions;
+                place(ENTITY_BOX, 0.0f, glm::vec3(footprint.x, data.house.wallHeight, footprint.y), WALL_COLOR);
+                // Eaves over the walls
+                place(ENTITY_ROOF, data.house.wallHeight,
+                      glm::vec3(footprint.x * 1.1f, data.house.roofHeight, footprint.y * 1.1f), ROOF_COLOR);
+                break;
+            }
+        }
+    }
+
+    // Into this frame's slot, shape by shape; whatever does not fit is dropped
+    auto* instances = static_cast<EntityInstance*>(m_entityInstanceMapped) + m_slot * MAX_ENTITY_INSTANCES;
+    uint32_t written = 0;
+    for (uint32_t mesh = 0; mesh < ENTITY_MESH_COUNT; mesh++) {
+        uint32_t count = std::min(static_cast<uint32_t>(m_entityBatches[mesh].size()), MAX_ENTITY_INSTANCES - written);
+        if (count > 0) {
+            memcpy(instances + written, m_entityBatches[mesh].data(), count * sizeof(EntityInstance));
+        }
+        m_entityFirstInstance[mesh] = written;
+        m_entityInstanceCount[mesh] = count;
+        written += count;
+    }
+    m_stats.entityInstances = written;
+}
+
+void RenderManager::recordHeightfield(VkCommandBuffer commandBuffer) {
+    if (!m_heightfield->record(commandBuffer)) {
+        return;
+    }
+    m_stats.rebuilds++;
+
+    // The region moved after this frame's uniforms were written
+    glm::vec4 region = m_heightfield->getRegion();
+    memcpy(static_cast<char*>(m_terrainUniformMapped) + m_slot * m_uniformSlotSize +
+               offsetof(TerrainUniformData, heightfieldRegion),
+           &region, sizeof(region));
+}
+
+void RenderManager::renderTrace(VkCommandBuffer commandBuffer, VkImageView colorView, VkImageView distanceView) {
+    VkDescriptorSet traceSet = m_traceDescriptorSets[m_slot];
+    std::array<VkDescriptorImageInfo, 2> imageInfos{};
+    imageInfos[0] = {m_traceSampler, colorView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
+    imageInfos[1] = {m_traceSampler, distanceView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
+
+    std::array<VkWriteDescriptorSet, 2> writes{};
+    for (uint32_t i = 0; i < writes.size(); i++) {
+        writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        writes[i].dstSet = traceSet;
+        writes[i].dstBinding = i;
+        writes[i].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        writes[i].descriptorCount = 1;
+        writes[i].pImageInfo = &imageInfos[i];
+    }
+    vkUpdateDescriptorSets(m_device->getDevice(), static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+
+    uint32_t dynamicOffset = static_cast<uint32_t>(m_slot * m_uniformSlotSize);
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_terrainPipelineLayout,
+                            0, 1, &m_terrainDescriptorSet, 1, &dynamicOffset);
+    m_heightfield->bind(commandBuffer, m_terrainPipelineLayout);
+
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_tracePipeline);
+    vkCmdDraw(commandBuffer, 3, 1, 0, 0);
+}
+
+void RenderManager::render(VkCommandBuffer commandBuffer) {
+    uint32_t dynamicOffset = static_cast<uint32_t>(m_slot * m_uniformSlotSize);
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_terrainPipelineLayout,
+                            0, 1, &m_terrainDescriptorSet, 1, &dynamicOffset);
+    m_heightfield->bind(commandBuffer, m_terrainPipelineLayout);
+
+    renderEntities(commandBuffer);
+
+    if (m_technique == Technique::Raymarch) {
+        if (m_traceExtent.width > 0) {
+            vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_terrainPipelineLayout,
+                                    2, 1, &m_traceDescriptorSets[m_slot], 0, nullptr);
+            vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_upsamplePipeline);
+        } else {
+            vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_raymarchPipeline);
+        }
+        vkCmdDraw(commandBuffer, 3, 1, 0, 0);
+        return;
+    }
+
+    // Nothing to displace the patches with until the first region is assembled
+    if (m_patchCount > 0 && m_heightfield->getRegion().w > 0.0f) {
+        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_terrainPipeline);
+        VkBuffer vertexBuffers[] = {m_patchVertexBuffer, m_instanceBuffer};
+        VkDeviceSize offsets[] = {0, m_slot * MAX_PATCHES * sizeof(PatchInstance)};
+        vkCmdBindVertexBuffers(commandBuffer, 0, 2, vertexBuffers, offsets);
+        vkCmdBindIndexBuffer(commandBuffer, m_patchIndexBuffer, 0, VK_INDEX_TYPE_UINT16);
+        vkCmdDrawIndexed(commandBuffer, m_patchIndexCount, m_patchCount, 0, 0, 0);
+    }
+
+    // Sky behind the mesh
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_skyPipeline);
+    vkCmdDraw(commandBuffer, 3, 1, 0, 0);
+}
+
+void RenderManager::renderEntities(VkCommandBuffer commandBuffer) {
+    if (m_stats.entityInstances == 0) {
+        return;
+    }
+
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_entityPipeline);
+    VkBuffer vertexBuffers[] = {m_entityVertexBuffer, m_entityInstanceBuffer};
+    VkDeviceSize offsets[] = {0, m_slot * MAX_ENTITY_INSTANCES * sizeof(EntityInstance)};
+    vkCmdBindVertexBuffers(commandBuffer, 0, 2, vertexBuffers, offsets);
+    for (uint32_t mesh = 0; mesh < ENTITY_MESH_COUNT; mesh++) {
+        if (m_entityInstanceCount[mesh] > 0) {
+            vkCmdDraw(commandBuffer, m_entityVertexCount[mesh], m_entityInstanceCount[mesh],
+                      m_entityFirstVertex[mesh], m_entityFirstInstance[mesh]);
+        }
+    }
+}
+
+void RenderManager::updateTerrainUniforms(const Settings& settings, const glm::mat4& viewMatrix,
+                                          const glm::mat4& projMatrix, VkExtent2D extent, uint32_t traceScale,
+                                          float time) {
+    TerrainUniformData data{};
+    data.viewMatrix = viewMatrix;
+    data.projMatrix = projMatrix;
+    data.invViewProj = glm::inverse(projMatrix * viewMatrix);
+    data.cameraPos = m_cameraPos;
+    data.time = time;
+
+    data.sunDirection = glm::normalize(settings.sunDirection);
+    data.sunIntensity = settings.sunIntensity;
+    data.sunColor = settings.sunColor;
+    data.baseHeight = settings.baseHeight;
+    data.ambientColor = settings.ambientColor;
+    data.ambientIntensity = settings.ambientIntensity;
+    data.skyColorHorizon = settings.skyColorHorizon;
+    data.skyColorZenith = settings.skyColorZenith;
+    data.fogColor = settings.fogColor;
+    data.fogDensity = settings.fogDensity;
+
+    data.terrainScale = settings.terrainScale;
+    data.terrainHeight = settings.terrainHeight;
+    data.waterLevel = settings.waterLevel;
+    data.enableWater = settings.enableWater ? 1 : 0;
+
+    data.qualityLevel = settings.qualityLevel;
+    data.viewDistance = settings.viewDistance;
+    data.viewportSize = glm::vec2(static_cast<float>(extent.width), static_cast<float>(extent.height));
+    data.heightfieldRegion = m_heightfield->getRegion();
+    data.traceParameters = glm::vec4(static_cast<float>(traceScale), TRACE_EDGE_THRESHOLD, 0.0f, 0.0f);
+
+    memcpy(static_cast<char*>(m_terrainUniformMapped) + m_slot * m_uniformSlotSize, &data, sizeof(data));
+}
+
+void RenderManager::selectPatches(const Settings& settings, const glm::mat4& viewProj) {
+    m_frustum.extractFromMatrix(viewProj);
+
+    // Any height the terrain function can produce, so node bounds never need the heightfield itself
+    float scale = settings.terrainHeight * 0.01f;
+    float low = settings.baseHeight + TerrainFunction::HEIGHT_MIN * scale;
+    float high = settings.baseHeight + TerrainFunction::HEIGHT_MAX * scale;
+    m_heightRange = glm::vec2(std::min(low, high), std::max(low, high));
+
+    // Each level's range doubles the last; starting at 2.5 leaf sizes keeps a node
+    // from ever bordering one more than a level coarser
+    float range = std::max(settings.lodDistance, 2.5f * LEAF_SIZE);
+    for (uint32_t level = 0; level < LOD_LEVELS; level++) {
+        m_lodRanges[level] = range;
+        range *= 2.0f;
+    }
+
+    // World-aligned roots around the camera, so nodes keep their place as it moves
+    float rootSize = LEAF_SIZE * static_cast<float>(1u << (LOD_LEVELS - 1));
+    glm::vec2 camera(m_cameraPos.x, m_cameraPos.z);
+    glm::ivec2 first = glm::ivec2(glm::floor((camera - m_viewDistance) / rootSize));
+    glm::ivec2 last = glm::ivec2(glm::floor((camera + m_viewDistance) / rootSize));
+
+    auto* instances = static_cast<PatchInstance*>(m_instanceMapped) + m_slot * MAX_PATCHES;
+    for (int z = first.y; z <= last.y; z++) {
+        for (int x = first.x; x <= last.x; x++) {
+            selectNode(glm::vec2(x, z) * rootSize, rootSize, LOD_LEVELS - 1, instances);
+        }
+    }
+}
+
+void RenderManager::selectNode(const glm::vec2& origin, float size, uint32_t level, PatchInstance* instances) {
+    glm::vec3 boxMin(origin.x, m_heightRange.x, origin.y);
+    glm::vec3 boxMax(origin.x + size, m_heightRange.y, origin.y + size);
+    float distance = glm::length(glm::max(glm::max(boxMin - m_cameraPos, m_cameraPos - boxMax), glm::vec3(0.0f)));
+    if (distance > m_viewDistance) {
+        return;
+    }
+    glm::vec3 center = (boxMin + boxMax) * 0.5f;
+    if (!m_frustum.isVisible(center, glm::length(boxMax - center))) {
+        return;
+    }
+
+    // Nodes reaching into the next finer level's range are split; the children
+    // outside it are drawn at this node's children's level, fully morphed
+    if (level > 0 && distance <= m_lodRanges[level - 1]) {
+        float half = size * 0.5f;
+        selectNode(origin, half, level - 1, instances);
+        selectNode(origin + glm::vec2(half, 0.0f), half, level - 1, instances);
+        selectNode(origin + glm::vec2(0.0f, half), half, level - 1, instances);
+        selectNode(origin + glm::vec2(half, half), half, level - 1, instances);
+        return;
+    }
+
+    if (m_patchCount >= MAX_PATCHES) {
+        return;
+    }
+    float previous = level > 0 ? m_lodRanges[level - 1] : 0.0f;
+    float morphEnd = m_lodRanges[level];
+    float morphStart = previous + (morphEnd - previous) * MORPH_START;
+    instances[m_patchCount++] = {glm::vec4(origin, size, static_cast<float>(level)),
+                                 glm::vec4(morphStart, morphEnd, 0.0f, 0.0f)};
+}
+
+void RenderManager::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties,
+                                 VkBuffer& buffer, VkDeviceMemory& bufferMemory) {
+    VkBufferCreateInfo bufferInfo{};
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size = size;
+    bufferInfo.usage = usage;
+    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    if (vkCreateBuffer(m_device->getDevice(), &bufferInfo, nullptr, &buffer) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create terrain buffer!");
+    }
+
+    VkMemoryRequirements memRequirements;
+    vkGetBufferMemoryRequirements(m_device->getDevice(), buffer, &memRequirements);
+
+    VkMemoryAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = memRequirements.size;
+    allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, properties);
+
+    if (vkAllocateMemory(m_device->getDevice(), &allocInfo, nullptr, &bufferMemory) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to allocate terrain buffer memory!");
+    }
+
+    vkBindBufferMemory(m_device->getDevice(), buffer, bufferMemory, 0);
+}
+
+uint32_t RenderManager::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) {
+    VkPhysicalDeviceMemoryProperties memProperties;
+    vkGetPhysicalDeviceMemoryProperties(m_device->getPhysicalDevice(), &memProperties);
+
+    for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++) {
+        if ((typeFilter & (1 << i)) && (memProperties.memoryTypes[i].propertyFlags & properties) == properties) {
+            return i;
+        }
+    }
+
+    throw std::runtime_error("Failed to find suitable memory type!");
+}
+
+std::vector<char> RenderManager::readShaderFile(const std::string& filename) {
+    std::ifstream file(filename, std::ios::ate | std::ios::binary);
+
+    if (!file.is_open()) {
+        throw std::runtime_error("Failed to open shader file: " + filename);
+    }
+
+    size_t fileSize = (size_t) file.tellg();
+    std::vector<char> buffer(fileSize);
+
+    file.seekg(0);
+    file.read(buffer.data(), fileSize);
+    file.close();
+
+    return buffer;
+}
+
+VkShaderModule RenderManager::createShaderModule(const std::vector<char>& code) {
+    VkShaderModuleCreateInfo createInfo{};
+    createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+    createInfo.codeSize = code.size();
+    createInfo.pCode = reinterpret_cast<const uint32_t*>(code.data());
+
+    VkShaderModule shaderModule;
+    if (vkCreateShaderModule(m_device->getDevice(), &createInfo, nullptr, &shaderModule) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create shader module");
+    }
+
+    return shaderModule;
+}
@@ -3,8 +3,17 @@
 #include <stdexcept>
 #include <array>
 
-RenderPass::RenderPass(VulkanDevice* device, SwapChain* swapChain)
-    : m_device(device), m_swapChain(swapChain), m_renderPass(VK_NULL_HANDLE) {
+RenderPass::RenderPass(VulkanDevice* device, SwapChain* swapChain, bool depthOnly)
+    : m_device(device), m_renderPass(VK_NULL_HANDLE), m_presentable(!depthOnly), m_depth(true) {
+    if (!depthOnly) {
+        m_colorFormats.push_back(swapChain->getImageFormat());
+    }
+    createRenderPass();
+}
+
+RenderPass::RenderPass(VulkanDevice* device, const std::vector<VkFormat>& colorFormats, bool depth)
+    : m_device(device), m_renderPass(VK_NULL_HANDLE), m_colorFormats(colorFormats), m_presentable(false),
+      m_depth(depth) {
     createRenderPass();
 }
 
@@ -14,21 +23,21 @@ RenderPass::~RenderPass() {
     }
 }
 
-void RenderPass::createColorAttachment(VkAttachmentDescription& colorAttachment) {
+void RenderPass::createColorAttachment(VkAttachmentDescription& colorAttachment, VkFormat format) {
     colorAttachment = {};
-    colorAttachment.format = m_swapChain->getImageFormat();
+    colorAttachment.format = format;
     colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
     colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
     colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
     colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
     colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
     colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    colorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+    colorAttachment.finalLayout = m_presentable ? VK_IMAGE_LAYOUT_PRESENT_SRC_KHR : VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
 }
 
 void RenderPass::createDepthAttachment(VkAttachmentDescription& depthAttachment) {
     depthAttachment = {};
-    depthAttachment.format = VK_FORMAT_D32_SFLOAT;
+    depthAttachment.format = DEPTH_FORMAT;
     depthAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
     depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
     depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
@@ -38,22 +47,6 @@ void RenderPass::createDepthAttachment(VkAttachmentDescription& depthAttachment)
     depthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
 }
 
-void RenderPass::setupSubpass(VkSubpassDescription& subpass, VkAttachmentReference& colorAttachmentRef, VkAttachmentReference& depthAttachmentRef) {
-    colorAttachmentRef = {};
-    colorAttachmentRef.attachment = 0;
-    colorAttachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-
-    depthAttachmentRef = {};
-    depthAttachmentRef.attachment = 1;
-    depthAttachmentRef.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
-
-    subpass = {};
-    subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
-    subpass.colorAttachmentCount = 1;
-    subpass.pColorAttachments = &colorAttachmentRef;
-    subpass.pDepthStencilAttachment = &depthAttachmentRef;
-}
-
 void RenderPass::setupDependency(VkSubpassDependency& dependency) {
     dependency = {};
     dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
@@ -65,19 +58,40 @@ void RenderPass::setupDependency(VkSubpassDependency& dependency) {
 }
 
 void RenderPass::createRenderPass() {
-    VkAttachmentDescription colorAttachment, depthAttachment;
-    createColorAttachment(colorAttachment);
-    createDepthAttachment(depthAttachment);
+    // Color attachments first, then depth
+    std::vector<VkAttachmentDescription> attachments;
+    std::vector<VkAttachmentReference> colorAttachmentRefs;
+    for (VkFormat format : m_colorFormats) {
+        VkAttachmentDescription colorAttachment;
+        createColorAttachment(colorAttachment, format);
+        colorAttachmentRefs.push_back({static_cast<uint32_t>(attachments.size()), VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL});
+        attachments.push_back(colorAttachment);
+    }
 
-    std::array<VkAttachmentDescription, 2> attachments = {colorAttachment, depthAttachment};
+    VkAttachmentReference depthAttachmentRef{};
+    if (m_depth) {
+        VkAttachmentDescription depthAttachment;
+        createDepthAttachment(depthAttachment);
+        depthAttachmentRef.attachment = static_cast<uint32_t>(attachments.size());
+        depthAttachmentRef.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+        attachments.push_back(depthAttachment);
+    }
 
-    VkAttachmentReference colorAttachmentRef, depthAttachmentRef;
-    VkSubpassDescription subpass;
-    setupSubpass(subpass, colorAttachmentRef, depthAttachmentRef);
+    VkSubpassDescription subpass{};
+    subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+    subpass.colorAttachmentCount = static_cast<uint32_t>(colorAttachmentRefs.size());
+    subpass.pColorAttachments = colorAttachmentRefs.empty() ? nullptr : colorAttachmentRefs.data();
+    subpass.pDepthStencilAttachment = m_depth ? &depthAttachmentRef : nullptr;
 
     VkSubpassDependency dependency;
     setupDependency(dependency);
 
+    if (m_colorFormats.empty()) {
+        dependency.srcStageMask = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+        dependency.dstStageMask = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+        dependency.dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+    }
+
     VkRenderPassCreateInfo renderPassInfo{};
     renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
     renderPassInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
@@ -3,8 +3,12 @@
 #include <iostream>
 #include <algorithm>
 
-SwapChain::SwapChain(VulkanDevice* device, VkExtent2D windowExtent)
-    : m_device(device), m_windowExtent(windowExtent) {
+SwapChain::SwapChain(VulkanDevice* device, VkExtent2D windowExtent,
+                     VkPresentModeKHR preferredPresentMode, uint32_t preferredImageCount,
+                     VkSwapchainKHR oldSwapChain)
+    : m_device(device), m_windowExtent(windowExtent),
+      m_preferredPresentMode(preferredPresentMode), m_preferredImageCount(preferredImageCount),
+      m_oldSwapChain(oldSwapChain) {
     createSwapChain();
     createImageViews();
 }
@@ -23,10 +27,13 @@ void SwapChain::createSwapChain() {
     VulkanDevice::SwapChainSupportDetails swapChainSupport = m_device->querySwapChainSupport(m_device->getPhysicalDevice());
 
     VkSurfaceFormatKHR surfaceFormat = chooseSwapSurfaceFormat(swapChainSupport.formats);
-    VkPresentModeKHR presentMode = chooseSwapPresentMode(swapChainSupport.presentModes);
+    VkPresentModeKHR presentMode = VulkanDevice::chooseSwapPresentMode(swapChainSupport.presentModes, m_preferredPresentMode);
     VkExtent2D extent = chooseSwapExtent(swapChainSupport.capabilities);
 
     uint32_t imageCount = swapChainSupport.capabilities.minImageCount + 1;
+    if (m_preferredImageCount > 0) {
+        imageCount = std::max(m_preferredImageCount, swapChainSupport.capabilities.minImageCount);
+    }
     if (swapChainSupport.capabilities.maxImageCount > 0) {
         imageCount = std::min(imageCount, swapChainSupport.capabilities.maxImageCount);
     }
@@ -39,6 +46,7 @@ void SwapChain::createSwapChain() {
     createInfo.imageColorSpace = surfaceFormat.colorSpace;
     createInfo.imageExtent = extent;
     createInfo.imageArrayLayers = 1;
+    // Frames reach the swap chain through the present draw, never a copy
     createInfo.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
 
     VulkanDevice::QueueFamilyIndices indices = m_device->findQueueFamilies(m_device->getPhysicalDevice());
@@ -56,7 +64,7 @@ void SwapChain::createSwapChain() {
     createInfo.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
     createInfo.presentMode = presentMode;
     createInfo.clipped = VK_TRUE;
-    createInfo.oldSwapchain = VK_NULL_HANDLE;
+    createInfo.oldSwapchain = m_oldSwapChain;
 
     if (vkCreateSwapchainKHR(m_device->getDevice(), &createInfo, nullptr, &m_swapChain) != VK_SUCCESS) {
         throw std::runtime_error("Failed to create swap chain!");
@@ -68,6 +76,9 @@ void SwapChain::createSwapChain() {
 
     m_imageFormat = surfaceFormat.format;
     m_extent = extent;
+    m_presentMode = presentMode;
+
+    std::cout << "SwapChain: " << imageCount << " images, present mode " << presentMode << std::endl;
 }
 
 void SwapChain::createImageViews() {
@@ -107,15 +118,6 @@ VkSurfaceFormatKHR SwapChain::chooseSwapSurfaceFormat(const std::vector<VkSurfac
     return availableFormats[0];
 }
 
-VkPresentModeKHR SwapChain::chooseSwapPresentMode(const std::vector<VkPresentModeKHR>& availablePresentModes) {
-    for (const auto& availablePresentMode : availablePresentModes) {
-        if (availablePresentMode == VK_PRESENT_MODE_MAILBOX_KHR) {
-            return availablePresentMode;
-        }
-    }
-    return VK_PRESENT_MODE_FIFO_KHR;
-}
-
 VkExtent2D SwapChain::chooseSwapExtent(const VkSurfaceCapabilitiesKHR& capabilities) {
     if (capabilities.currentExtent.width != UINT32_MAX) {
         return capabilities.currentExtent;
@@ -0,0 +1,329 @@
+#include "rendering/TemporalUpscaler.h"
+#include "core/CommandContext.h"
+#include "core/DeletionQueue.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <stdexcept>
+
+namespace {
+// Frames averaged between scale decisions; GPU timings lag a few frames, so
+// deciding every frame would react to its own previous change
+constexpr uint32_t ADJUST_INTERVAL = 8;
+constexpr float SCALE_STEP = 0.05f;
+// Only scale back up with this much headroom, so the scale doesn't oscillate
+// around the target
+constexpr float RAISE_THRESHOLD = 0.85f;
+// Weight of the new frame in the history blend
+constexpr float CURRENT_WEIGHT = 0.1f;
+// Enough phases to cover the 2x2 output pixels per input pixel at half scale
+constexpr uint32_t JITTER_PHASES = 16;
+
+float halton(uint32_t index, uint32_t base) {
+    float result = 0.0f;
+    float fraction = 1.0f / static_cast<float>(base);
+    while (index > 0) {
+        result += static_cast<float>(index % base) * fraction;
+        index /= base;
+        fraction /= static_cast<float>(base);
+    }
+    return result;
+}
+}
+
+TemporalUpscaler::TemporalUpscaler(VulkanDevice* device) : m_device(device) {
+    createSamplers();
+    createDescriptors();
+    m_resolvePipeline = std::make_unique<ComputePipeline>(device, "temporal_resolve.comp",
+                                                          std::vector<VkDescriptorSetLayout>{m_descriptorSetLayout},
+                                                          static_cast<uint32_t>(sizeof(ResolveParams)));
+    std::cout << "TemporalUpscaler: Render scale " << MIN_SCALE << " to " << MAX_SCALE << std::endl;
+}
+
+TemporalUpscaler::~TemporalUpscaler() {
+    VkDevice device = m_device->getDevice();
+    m_resolvePipeline.reset();
+    for (auto& history : m_history) {
+        if (history.view != VK_NULL_HANDLE) vkDestroyImageView(device, history.view, nullptr);
+        if (history.image != VK_NULL_HANDLE) vkDestroyImage(device, history.image, nullptr);
+        if (history.memory != VK_NULL_HANDLE) vkFreeMemory(device, history.memory, nullptr);
+    }
+    if (m_descriptorPool != VK_NULL_HANDLE) {
+        vkDestroyDescriptorPool(device, m_descriptorPool, nullptr);
+    }
+    if (m_descriptorSetLayout != VK_NULL_HANDLE) {
+        vkDestroyDescriptorSetLayout(device, m_descriptorSetLayout, nullptr);
+    }
+    if (m_linearSampler != VK_NULL_HANDLE) {
+        vkDestroySampler(device, m_linearSampler, nullptr);
+    }
+    if (m_nearestSampler != VK_NULL_HANDLE) {
+        vkDestroySampler(device, m_nearestSampler, nullptr);
+    }
+}
+
+void TemporalUpscaler::createSamplers() {
+    VkSamplerCreateInfo samplerInfo{};
+    samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    samplerInfo.magFilter = VK_FILTER_LINEAR;
+    samplerInfo.minFilter = VK_FILTER_LINEAR;
+    samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+    samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.minLod = 0.0f;
+    samplerInfo.maxLod = 0.0f;
+
+    if (vkCreateSampler(m_device->getDevice(), &samplerInfo, nullptr, &m_linearSampler) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create upscaler sampler!");
+    }
+
+    samplerInfo.magFilter = VK_FILTER_NEAREST;
+    samplerInfo.minFilter = VK_FILTER_NEAREST;
+    if (vkCreateSampler(m_device->getDevice(), &samplerInfo, nullptr, &m_nearestSampler) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create upscaler depth sampler!");
+    }
+}
+
+void TemporalUpscaler::createDescriptors() {
+    VkDevice device = m_device->getDevice();
+
+    // 0 current color, 1 current depth, 2 previous history, 3 history being written
+    std::array<VkDescriptorSetLayoutBinding, 4> bindings{};
+    for (uint32_t i = 0; i < bindings.size(); i++) {
+        bindings[i].binding = i;
+        bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        bindings[i].descriptorCount = 1;
+        bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    }
+    bindings[3].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = static_cast<uint32_t>(bindings.size());
+    layoutInfo.pBindings = bindings.data();
+
+    if (vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &m_descriptorSetLayout) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create upscaler descriptor set layout!");
+    }
+
+    std::array<VkDescriptorPoolSize, 2> poolSizes{};
+    poolSizes[0].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    poolSizes[0].descriptorCount = 3 * RING_SLOTS;
+    poolSizes[1].type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    poolSizes[1].descriptorCount = RING_SLOTS;
+
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+    poolInfo.pPoolSizes = poolSizes.data();
+    poolInfo.maxSets = RING_SLOTS;
+
+    if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &m_descriptorPool) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create upscaler descriptor pool!");
+    }
+
+    std::array<VkDescriptorSetLayout, RING_SLOTS> layouts;
+    layouts.fill(m_descriptorSetLayout);
+
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = m_descriptorPool;
+    allocInfo.descriptorSetCount = RING_SLOTS;
+    allocInfo.pSetLayouts = layouts.data();
+
+    if (vkAllocateDescriptorSets(device, &allocInfo, m_descriptorSets.data()) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to allocate upscaler descriptor sets!");
+    }
+}
+
+void TemporalUpscaler::updateScale(double gpuMs, float targetMs) {
+    if (gpuMs <= 0.0 || targetMs <= 0.0f) {
+        return;
+    }
+
+    m_accumulatedMs += gpuMs;
+    if (++m_accumulatedFrames < ADJUST_INTERVAL) {
+        return;
+    }
+    double averageMs = m_accumulatedMs / m_accumulatedFrames;
+    m_accumulatedMs = 0.0;
+    m_accumulatedFrames = 0;
+
+    float scale = m_scale;
+    if (averageMs > targetMs) {
+        // Cost follows pixel count, i.e. the square of the scale
+        float desired = m_scale * static_cast<float>(std::sqrt(targetMs / averageMs));
+        scale = std::min(std::floor(desired / SCALE_STEP) * SCALE_STEP, m_scale - SCALE_STEP);
+    } else if (averageMs < targetMs * RAISE_THRESHOLD) {
+        scale = m_scale + SCALE_STEP;
+    }
+    // Snap to the step grid so repeated steps don't drift
+    m_scale = std::clamp(std::round(scale / SCALE_STEP) * SCALE_STEP, MIN_SCALE, MAX_SCALE);
+}
+
+VkExtent2D TemporalUpscaler::getRenderExtent(VkExtent2D outputExtent) const {
+    VkExtent2D extent;
+    extent.width = std::max(1u, static_cast<uint32_t>(std::lround(outputExtent.width * m_scale)));
+    extent.height = std::max(1u, static_cast<uint32_t>(std::lround(outputExtent.height * m_scale)));
+    return extent;
+}
+
+void TemporalUpscaler::resize(VkExtent2D outputExtent) {
+    if (m_history[0].image != VK_NULL_HANDLE && outputExtent.width == m_outputExtent.width &&
+        outputExtent.height == m_outputExtent.height) {
+        return;
+    }
+    retireHistory();
+    createHistory(outputExtent);
+    m_outputExtent = outputExtent;
+    m_historyValid = false;
+}
+
+glm::vec2 TemporalUpscaler::beginFrame(VkExtent2D renderExtent) {
+    m_historyIndex ^= 1;
+
+    // Halton(2, 3) offsets within a pixel, skipping index 0 (the pixel center)
+    m_jitterIndex = (m_jitterIndex + 1) % JITTER_PHASES;
+    glm::vec2 pixelOffset(halton(m_jitterIndex + 1, 2) - 0.5f, halton(m_jitterIndex + 1, 3) - 0.5f);
+    m_jitterUV = pixelOffset / glm::vec2(static_cast<float>(renderExtent.width), static_cast<float>(renderExtent.height));
+    return m_jitterUV * 2.0f;
+}
+
+void TemporalUpscaler::resolve(VkCommandBuffer commandBuffer, VkImageView colorView, VkImageView depthView,
+                               const glm::mat4& viewProjection) {
+    m_slot = (m_slot + 1) % RING_SLOTS;
+    VkDescriptorSet descriptorSet = m_descriptorSets[m_slot];
+
+    std::array<VkDescriptorImageInfo, 4> imageInfos{};
+    imageInfos[0] = {m_linearSampler, colorView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
+    imageInfos[1] = {m_nearestSampler, depthView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
+    imageInfos[2] = {m_linearSampler, getPreviousHistoryView(), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
+    imageInfos[3] = {VK_NULL_HANDLE, getCurrentHistoryView(), VK_IMAGE_LAYOUT_GENERAL};
+
+    std::array<VkWriteDescriptorSet, 4> writes{};
+    for (uint32_t i = 0; i < writes.size(); i++) {
+        writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        writes[i].dstSet = descriptorSet;
+        writes[i].dstBinding = i;
+        writes[i].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        writes[i].descriptorCount = 1;
+        writes[i].pImageInfo = &imageInfos[i];
+    }
+    writes[3].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    vkUpdateDescriptorSets(m_device->getDevice(), static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+
+    ResolveParams params{};
+    params.reprojection = m_previousViewProjection * glm::inverse(viewProjection);
+    params.jitter = glm::vec4(m_jitterUV, 0.0f, 0.0f);
+    params.params = glm::vec4(CURRENT_WEIGHT, m_historyValid ? 0.0f : 1.0f, 0.0f, 0.0f);
+
+    m_resolvePipeline->bind(commandBuffer);
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_resolvePipeline->getPipelineLayout(),
+                            0, 1, &descriptorSet, 0, nullptr);
+    vkCmdPushConstants(commandBuffer, m_resolvePipeline->getPipelineLayout(), VK_SHADER_STAGE_COMPUTE_BIT,
+                       0, sizeof(ResolveParams), &params);
+    vkCmdDispatch(commandBuffer, (m_outputExtent.width + 7) / 8, (m_outputExtent.height + 7) / 8, 1);
+
+    m_previousViewProjection = viewProjection;
+    m_historyValid = true;
+}
+
+void TemporalUpscaler::createHistory(VkExtent2D extent) {
+    VkDevice device = m_device->getDevice();
+    for (auto& history : m_history) {
+        VkImageCreateInfo imageInfo{};
+        imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        imageInfo.imageType = VK_IMAGE_TYPE_2D;
+        imageInfo.extent = {extent.width, extent.height, 1};
+        imageInfo.mipLevels = 1;
+        imageInfo.arrayLayers = 1;
+        imageInfo.format = HISTORY_FORMAT;
+        imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+        imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        imageInfo.usage = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+        imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+        imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+        if (vkCreateImage(device, &imageInfo, nullptr, &history.image) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to create upscaler history image!");
+        }
+
+        VkMemoryRequirements memRequirements;
+        vkGetImageMemoryRequirements(device, history.image, &memRequirements);
+
+        VkMemoryAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        allocInfo.allocationSize = memRequirements.size;
+        allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+        if (vkAllocateMemory(device, &allocInfo, nullptr, &history.memory) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to allocate upscaler history memory!");
+        }
+        vkBindImageMemory(device, history.image, history.memory, 0);
+
+        VkImageViewCreateInfo viewInfo{};
+        viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        viewInfo.image = history.image;
+        viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        viewInfo.format = HISTORY_FORMAT;
+        viewInfo.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+
+        if (vkCreateImageView(device, &viewInfo, nullptr, &history.view) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to create upscaler history view!");
+        }
+    }
+
+    // The first resolve ignores the history's contents, but it is still bound,
+    // so it must already be in the layout the graph expects
+    CommandContext context(m_device, VulkanDevice::QueueType::Graphics);
+    VkCommandBuffer commandBuffer = context.begin();
+    for (auto& history : m_history) {
+        VkImageMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.image = history.image;
+        barrier.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+        barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        barrier.srcAccessMask = 0;
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                             0, 0, nullptr, 0, nullptr, 1, &barrier);
+    }
+    context.submitAndWait(commandBuffer);
+
+    std::cout << "TemporalUpscaler: History at " << extent.width << "x" << extent.height << std::endl;
+}
+
+void TemporalUpscaler::retireHistory() {
+    if (m_history[0].image == VK_NULL_HANDLE) {
+        return;
+    }
+
+    // Frames in flight may still be resolving into or blitting from the old images
+    VkDevice device = m_device->getDevice();
+    std::array<HistoryImage, 2> oldHistory = m_history;
+    m_device->getDeletionQueue()->push([device, oldHistory]() {
+        for (const auto& history : oldHistory) {
+            vkDestroyImageView(device, history.view, nullptr);
+            vkDestroyImage(device, history.image, nullptr);
+            vkFreeMemory(device, history.memory, nullptr);
+        }
+    });
+    m_history = {};
+}
+
+uint32_t TemporalUpscaler::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) {
+    VkPhysicalDeviceMemoryProperties memProperties;
+    vkGetPhysicalDeviceMemoryProperties(m_device->getPhysicalDevice(), &memProperties);
+
+    for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++) {
+        if ((typeFilter & (1 << i)) && (memProperties.memoryTypes[i].propertyFlags & properties) == properties) {
+            return i;
+        }
+    }
+
+    throw std::runtime_error("Failed to find suitable memory type!");
+}
@@ -0,0 +1,523 @@
+#include "rendering/TerrainHeightfield.h"
+#include "core/CommandContext.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <iostream>
+#include <stdexcept>
+
+namespace {
+constexpr uint32_t GROUP_SIZE = 8;
+
+// Bindings of terrain_maxmip.comp
+enum ComputeBinding : uint32_t {
+    MaxSource = 0,
+    MaxLevel = 1,
+    ComputeBindingCount
+};
+
+// Enough of the atlas for the region plus its prefetch ring
+constexpr uint32_t STREAMED_SIDE = TerrainHeightfield::TILES_PER_SIDE + 2 * TerrainHeightfield::PREFETCH_TILES;
+
+uint32_t groupCount(uint32_t size) {
+    return (size + GROUP_SIZE - 1) / GROUP_SIZE;
+}
+}
+
+TerrainHeightfield::TerrainHeightfield(VulkanDevice* device) : m_device(device) {
+    m_tileCache = std::make_unique<TerrainTileCache>(device, STREAMED_SIDE * STREAMED_SIDE);
+    createSamplers();
+    createImages();
+    createDescriptors();
+    createPipelines();
+    std::cout << "TerrainHeightfield: " << RESOLUTION << "x" << RESOLUTION << " heights, " << m_maxLevels
+              << " max-height levels" << std::endl;
+}
+
+TerrainHeightfield::~TerrainHeightfield() {
+    VkDevice device = m_device->getDevice();
+    m_maxMipPipeline.reset();
+
+    for (VkImageView view : m_maxLevelViews) {
+        vkDestroyImageView(device, view, nullptr);
+    }
+    for (VkImageView view : {m_heightView, m_normalView, m_maxView}) {
+        if (view != VK_NULL_HANDLE) vkDestroyImageView(device, view, nullptr);
+    }
+    for (VkImage image : {m_heightImage, m_normalImage, m_maxImage}) {
+        if (image != VK_NULL_HANDLE) vkDestroyImage(device, image, nullptr);
+    }
+    for (VkDeviceMemory memory : {m_heightMemory, m_normalMemory, m_maxMemory}) {
+        if (memory != VK_NULL_HANDLE) vkFreeMemory(device, memory, nullptr);
+    }
+
+    if (m_descriptorPool != VK_NULL_HANDLE) {
+        vkDestroyDescriptorPool(device, m_descriptorPool, nullptr);
+    }
+    if (m_descriptorSetLayout != VK_NULL_HANDLE) {
+        vkDestroyDescriptorSetLayout(device, m_descriptorSetLayout, nullptr);
+    }
+    if (m_computeSetLayout != VK_NULL_HANDLE) {
+        vkDestroyDescriptorSetLayout(device, m_computeSetLayout, nullptr);
+    }
+    if (m_linearSampler != VK_NULL_HANDLE) {
+        vkDestroySampler(device, m_linearSampler, nullptr);
+    }
+    if (m_nearestSampler != VK_NULL_HANDLE) {
+        vkDestroySampler(device, m_nearestSampler, nullptr);
+    }
+    m_tileCache.reset();
+}
+
+void TerrainHeightfield::createSamplers() {
+    VkSamplerCreateInfo samplerInfo{};
+    samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    samplerInfo.magFilter = VK_FILTER_LINEAR;
+    samplerInfo.minFilter = VK_FILTER_LINEAR;
+    samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+    samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.minLod = 0.0f;
+    samplerInfo.maxLod = 0.0f;
+
+    if (vkCreateSampler(m_device->getDevice(), &samplerInfo, nullptr, &m_linearSampler) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create terrain height sampler!");
+    }
+
+    // The max chain is only ever fetched texel by texel, at any level
+    samplerInfo.magFilter = VK_FILTER_NEAREST;
+    samplerInfo.minFilter = VK_FILTER_NEAREST;
+    samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+
+    if (vkCreateSampler(m_device->getDevice(), &samplerInfo, nullptr, &m_nearestSampler) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create terrain max-height sampler!");
+    }
+}
+
+void TerrainHeightfield::createImage(VkFormat format, uint32_t mipLevels, VkImageUsageFlags usage, VkImage& image,
+                                     VkDeviceMemory& memory) {
+    VkDevice device = m_device->getDevice();
+
+    VkImageCreateInfo imageInfo{};
+    imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    imageInfo.imageType = VK_IMAGE_TYPE_2D;
+    imageInfo.extent = {RESOLUTION, RESOLUTION, 1};
+    imageInfo.mipLevels = mipLevels;
+    imageInfo.arrayLayers = 1;
+    imageInfo.format = format;
+    imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    imageInfo.usage = usage;
+    imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+    imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    if (vkCreateImage(device, &imageInfo, nullptr, &image) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create terrain heightfield image!");
+    }
+
+    VkMemoryRequirements memRequirements;
+    vkGetImageMemoryRequirements(device, image, &memRequirements);
+
+    VkMemoryAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = memRequirements.size;
+    allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+    if (vkAllocateMemory(device, &allocInfo, nullptr, &memory) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to allocate terrain heightfield memory!");
+    }
+    vkBindImageMemory(device, image, memory, 0);
+}
+
+VkImageView TerrainHeightfield::createView(VkImage image, VkFormat format, uint32_t baseLevel, uint32_t levelCount) {
+    VkImageViewCreateInfo viewInfo{};
+    viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    viewInfo.image = image;
+    viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    viewInfo.format = format;
+    viewInfo.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, baseLevel, levelCount, 0, 1};
+
+    VkImageView view;
+    if (vkCreateImageView(m_device->getDevice(), &viewInfo, nullptr, &view) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create terrain heightfield view!");
+    }
+    return view;
+}
+
+void TerrainHeightfield::createImages() {
+    // Down to a single cell spanning the whole region
+    m_maxLevels = 1;
+    while ((RESOLUTION >> m_maxLevels) > 0) {
+        m_maxLevels++;
+    }
+
+    // Heights and normals are copied in from the tile atlas; heights also feed the max chain
+    createImage(HEIGHT_FORMAT, 1, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_STORAGE_BIT |
+                VK_IMAGE_USAGE_SAMPLED_BIT, m_heightImage, m_heightMemory);
+    createImage(NORMAL_FORMAT, 1, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+                m_normalImage, m_normalMemory);
+    createImage(HEIGHT_FORMAT, m_maxLevels, VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+                m_maxImage, m_maxMemory);
+
+    m_heightView = createView(m_heightImage, HEIGHT_FORMAT, 0, 1);
+    m_normalView = createView(m_normalImage, NORMAL_FORMAT, 0, 1);
+    m_maxView = createView(m_maxImage, HEIGHT_FORMAT, 0, m_maxLevels);
+    for (uint32_t level = 0; level < m_maxLevels; level++) {
+        m_maxLevelViews.push_back(createView(m_maxImage, HEIGHT_FORMAT, level, 1));
+    }
+
+    // Sampleable before the first assembly, so the terrain set is always valid to bind
+    std::array<VkImageMemoryBarrier, 3> barriers{};
+    std::array<std::pair<VkImage, uint32_t>, 3> images{{
+        {m_heightImage, 1}, {m_normalImage, 1}, {m_maxImage, m_maxLevels}}};
+    for (size_t i = 0; i < barriers.size(); i++) {
+        barriers[i].sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barriers[i].srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barriers[i].dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barriers[i].image = images[i].first;
+        barriers[i].subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, images[i].second, 0, 1};
+        barriers[i].oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        barriers[i].newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        barriers[i].srcAccessMask = 0;
+        barriers[i].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    }
+
+    CommandContext context(m_device, VulkanDevice::QueueType::Graphics);
+    VkCommandBuffer commandBuffer = context.begin();
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+                         VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+                         0, 0, nullptr, 0, nullptr, static_cast<uint32_t>(barriers.size()), barriers.data());
+    context.submitAndWait(commandBuffer);
+}
+
+void TerrainHeightfield::createDescriptors() {
+    VkDevice device = m_device->getDevice();
+
+    // Sampled by the terrain pipelines: the raymarch, and meshes displaced in the vertex stage
+    std::array<VkDescriptorSetLayoutBinding, 3> sampleBindings{};
+    for (uint32_t i = 0; i < sampleBindings.size(); i++) {
+        sampleBindings[i].binding = i;
+        sampleBindings[i].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        sampleBindings[i].descriptorCount = 1;
+        sampleBindings[i].stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+    }
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = static_cast<uint32_t>(sampleBindings.size());
+    layoutInfo.pBindings = sampleBindings.data();
+
+    if (vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &m_descriptorSetLayout) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create terrain heightfield descriptor set layout!");
+    }
+
+    std::array<VkDescriptorSetLayoutBinding, ComputeBindingCount> computeBindings{};
+    for (uint32_t i = 0; i < computeBindings.size(); i++) {
+        computeBindings[i].binding = i;
+        computeBindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+        computeBindings[i].descriptorCount = 1;
+        computeBindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    }
+    layoutInfo.bindingCount = static_cast<uint32_t>(computeBindings.size());
+    layoutInfo.pBindings = computeBindings.data();
+
+    if (vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &m_computeSetLayout) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create terrain max-chain descriptor set layout!");
+    }
+
+    std::array<VkDescriptorPoolSize, 2> poolSizes{};
+    poolSizes[0].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    poolSizes[0].descriptorCount = static_cast<uint32_t>(sampleBindings.size());
+    poolSizes[1].type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    poolSizes[1].descriptorCount = ComputeBindingCount * m_maxLevels;
+
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+    poolInfo.pPoolSizes = poolSizes.data();
+    poolInfo.maxSets = 1 + m_maxLevels;
+
+    if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &m_descriptorPool) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create terrain heightfield descriptor pool!");
+    }
+
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = m_descriptorPool;
+    allocInfo.descriptorSetCount = 1;
+    allocInfo.pSetLayouts = &m_descriptorSetLayout;
+
+    if (vkAllocateDescriptorSets(device, &allocInfo, &m_descriptorSet) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to allocate terrain heightfield descriptor set!");
+    }
+
+    std::vector<VkDescriptorSetLayout> computeLayouts(m_maxLevels, m_computeSetLayout);
+    m_computeSets.resize(m_maxLevels);
+    allocInfo.descriptorSetCount = m_maxLevels;
+    allocInfo.pSetLayouts = computeLayouts.data();
+
+    if (vkAllocateDescriptorSets(device, &allocInfo, m_computeSets.data()) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to allocate terrain max-chain descriptor sets!");
+    }
+
+    // The images never change, so every set is written once
+    std::array<VkDescriptorImageInfo, 3> sampleInfos{{
+        {m_linearSampler, m_heightView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL},
+        {m_nearestSampler, m_maxView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL},
+        {m_linearSampler, m_normalView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL},
+    }};
+    std::vector<VkDescriptorImageInfo> storageInfos(m_maxLevels * ComputeBindingCount);
+    std::vector<VkWriteDescriptorSet> writes;
+    writes.reserve(sampleInfos.size() + storageInfos.size());
+
+    for (uint32_t binding = 0; binding < sampleInfos.size(); binding++) {
+        VkWriteDescriptorSet write{};
+        write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        write.dstSet = m_descriptorSet;
+        write.dstBinding = binding;
+        write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        write.descriptorCount = 1;
+        write.pImageInfo = &sampleInfos[binding];
+        writes.push_back(write);
+    }
+    for (uint32_t level = 0; level < m_maxLevels; level++) {
+        VkDescriptorImageInfo* infos = &storageInfos[level * ComputeBindingCount];
+        infos[MaxSource] = {VK_NULL_HANDLE, level == 0 ? m_heightView : m_maxLevelViews[level - 1],
+                            VK_IMAGE_LAYOUT_GENERAL};
+        infos[MaxLevel] = {VK_NULL_HANDLE, m_maxLevelViews[level], VK_IMAGE_LAYOUT_GENERAL};
+        for (uint32_t binding = 0; binding < ComputeBindingCount; binding++) {
+            VkWriteDescriptorSet write{};
+            write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            write.dstSet = m_computeSets[level];
+            write.dstBinding = binding;
+            write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+            write.descriptorCount = 1;
+            write.pImageInfo = &infos[binding];
+            writes.push_back(write);
+        }
+    }
+    vkUpdateDescriptorSets(device, static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+}
+
+void TerrainHeightfield::createPipelines() {
+    std::vector<VkDescriptorSetLayout> layouts{m_computeSetLayout};
+    m_maxMipPipeline = std::make_unique<ComputePipeline>(m_device, "terrain_maxmip.comp", layouts,
+                                                         static_cast<uint32_t>(sizeof(MaxMipParams)));
+}
+
+TerrainTileCache::TileKey TerrainHeightfield::targetTile(uint32_t i, uint32_t j) const {
+    return {m_targetTile.x + static_cast<int32_t>(i), m_targetTile.y + static_cast<int32_t>(j), m_targetLevel};
+}
+
+bool TerrainHeightfield::update(const glm::vec3& cameraPos, const Parameters& parameters) {
+    m_tileCache->setParameters(parameters.terrain);
+
+    // Power-of-two tiles, the smallest whose region still spans the requested extent
+    int32_t level = static_cast<int32_t>(
+        std::ceil(std::log2(parameters.extent / static_cast<float>(TILES_PER_SIDE))));
+    float tileSize = TerrainTileCache::tileSize(level);
+    float extent = tileSize * static_cast<float>(TILES_PER_SIDE);
+    glm::vec2 camera(cameraPos.x, cameraPos.z);
+    glm::ivec2 cameraTile = glm::ivec2(glm::floor(camera / tileSize));
+
+    // Retargeting once the camera is an eighth of the region off centre keeps at
+    // least three eighths of it ahead in every direction, which covers the view
+    // distance when the region spans three of them (see RenderManager)
+    bool retarget;
+    if (m_targetPending) {
+        glm::vec2 targetCenter = (glm::vec2(m_targetTile) + 0.5f * TILES_PER_SIDE) * tileSize;
+        glm::vec2 offset = glm::abs(camera - targetCenter);
+        retarget = parameters != m_targetParameters || std::max(offset.x, offset.y) > extent * 0.125f;
+    } else if (!m_assembled || parameters != m_parameters) {
+        retarget = true;
+    } else {
+        glm::vec2 offset = glm::abs(camera - m_center);
+        retarget = std::max(offset.x, offset.y) > extent * 0.125f;
+    }
+    if (retarget) {
+        // Tile-aligned, with the camera in one of the two middle tiles
+        m_targetPending = true;
+        m_targetParameters = parameters;
+        m_targetLevel = level;
+        m_targetTile = cameraTile - glm::ivec2(TILES_PER_SIDE / 2);
+    }
+
+    // The square around the camera, which holds any target it can have, pending
+    // target tiles first and then nearest first
+    int32_t half = static_cast<int32_t>(STREAMED_SIDE / 2);
+    glm::ivec2 targetMin = m_targetTile;
+    glm::ivec2 targetMax = m_targetTile + glm::ivec2(TILES_PER_SIDE);
+    auto priority = [&](const TerrainTileCache::TileKey& key) {
+        glm::ivec2 tile(key.x, key.z);
+        bool inTarget = m_targetPending && glm::all(glm::greaterThanEqual(tile, targetMin)) &&
+                        glm::all(glm::lessThan(tile, targetMax));
+        glm::vec2 delta = (glm::vec2(tile) + 0.5f) * tileSize - camera;
+        return glm::dot(delta, delta) + (inTarget ? 0.0f : extent * extent * 4.0f);
+    };
+    m_wanted.clear();
+    for (int32_t z = -half; z < half; z++) {
+        for (int32_t x = -half; x < half; x++) {
+            m_wanted.push_back({cameraTile.x + x, cameraTile.y + z, level});
+        }
+    }
+    std::sort(m_wanted.begin(), m_wanted.end(),
+              [&](const TerrainTileCache::TileKey& a, const TerrainTileCache::TileKey& b) {
+                  return priority(a) < priority(b);
+              });
+    m_tileCache->request(m_wanted);
+
+    m_assembleThisFrame = false;
+    if (m_targetPending) {
+        m_assembleThisFrame = true;
+        for (uint32_t j = 0; j < TILES_PER_SIDE && m_assembleThisFrame; j++) {
+            for (uint32_t i = 0; i < TILES_PER_SIDE; i++) {
+                if (m_tileCache->findLayer(targetTile(i, j)) < 0) {
+                    m_assembleThisFrame = false;
+                    break;
+                }
+            }
+        }
+    }
+    return m_tileCache->hasUploads() || m_assembleThisFrame;
+}
+
+bool TerrainHeightfield::record(VkCommandBuffer commandBuffer) {
+    m_tileCache->recordUploads(commandBuffer);
+    if (!m_assembleThisFrame) {
+        return false;
+    }
+    m_assembleThisFrame = false;
+    assemble(commandBuffer);
+    return true;
+}
+
+void TerrainHeightfield::assemble(VkCommandBuffer commandBuffer) {
+    float tileSize = TerrainTileCache::tileSize(m_targetLevel);
+    m_texelSize = tileSize / static_cast<float>(TerrainTileCache::TILE_RESOLUTION);
+    m_origin = glm::vec2(m_targetTile) * tileSize;
+    m_center = m_origin + 0.5f * tileSize * static_cast<float>(TILES_PER_SIDE);
+    m_parameters = m_targetParameters;
+    m_assembled = true;
+    m_targetPending = false;
+
+    // Whatever earlier frames read is rebuilt from scratch
+    std::array<VkImageMemoryBarrier, 3> barriers{};
+    std::array<std::pair<VkImage, uint32_t>, 3> images{{
+        {m_heightImage, 1}, {m_normalImage, 1}, {m_maxImage, m_maxLevels}}};
+    for (size_t i = 0; i < barriers.size(); i++) {
+        barriers[i].sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barriers[i].srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barriers[i].dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barriers[i].image = images[i].first;
+        barriers[i].subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, images[i].second, 0, 1};
+        barriers[i].oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        barriers[i].newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barriers[i].srcAccessMask = 0;
+        barriers[i].dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    }
+    barriers[2].newLayout = VK_IMAGE_LAYOUT_GENERAL;
+    barriers[2].dstAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    VkPipelineStageFlags readerStages = VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+    vkCmdPipelineBarrier(commandBuffer, readerStages,
+                         VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                         0, 0, nullptr, 0, nullptr, static_cast<uint32_t>(barriers.size()), barriers.data());
+
+    // Every tile lands at its place in the region
+    constexpr uint32_t tileResolution = TerrainTileCache::TILE_RESOLUTION;
+    std::vector<VkImageCopy> copies;
+    copies.reserve(TILES_PER_SIDE * TILES_PER_SIDE);
+    for (uint32_t j = 0; j < TILES_PER_SIDE; j++) {
+        for (uint32_t i = 0; i < TILES_PER_SIDE; i++) {
+            VkImageCopy copy{};
+            copy.srcSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0,
+                                   static_cast<uint32_t>(m_tileCache->findLayer(targetTile(i, j))), 1};
+            copy.dstSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1};
+            copy.dstOffset = {static_cast<int32_t>(i * tileResolution), static_cast<int32_t>(j * tileResolution), 0};
+            copy.extent = {tileResolution, tileResolution, 1};
+            copies.push_back(copy);
+        }
+    }
+    vkCmdCopyImage(commandBuffer, m_tileCache->getHeightAtlas(), VK_IMAGE_LAYOUT_GENERAL,
+                   m_heightImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                   static_cast<uint32_t>(copies.size()), copies.data());
+    vkCmdCopyImage(commandBuffer, m_tileCache->getNormalAtlas(), VK_IMAGE_LAYOUT_GENERAL,
+                   m_normalImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                   static_cast<uint32_t>(copies.size()), copies.data());
+
+    // Heights go on to the max chain, normals straight to the readers
+    std::array<VkImageMemoryBarrier, 2> copied{barriers[0], barriers[1]};
+    for (auto& barrier : copied) {
+        barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    }
+    copied[0].newLayout = VK_IMAGE_LAYOUT_GENERAL;
+    copied[0].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    copied[1].newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    copied[1].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | readerStages,
+                         0, 0, nullptr, 0, nullptr, static_cast<uint32_t>(copied.size()), copied.data());
+
+    buildMaxChain(commandBuffer);
+
+    std::array<VkImageMemoryBarrier, 2> built{copied[0], barriers[2]};
+    for (auto& barrier : built) {
+        barrier.oldLayout = VK_IMAGE_LAYOUT_GENERAL;
+        barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        barrier.srcAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    }
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, readerStages,
+                         0, 0, nullptr, 0, nullptr, static_cast<uint32_t>(built.size()), built.data());
+
+    std::cout << "TerrainHeightfield: Assembled " << tileSize * TILES_PER_SIDE << "m region around ("
+              << m_center.x << ", " << m_center.y << ")" << std::endl;
+}
+
+void TerrainHeightfield::buildMaxChain(VkCommandBuffer commandBuffer) {
+    // Each max level reads the one before it (level 0 reads the heights)
+    VkMemoryBarrier computeBarrier{};
+    computeBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    computeBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    computeBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+    MaxMipParams params{};
+    m_maxMipPipeline->bind(commandBuffer);
+    for (uint32_t level = 0; level < m_maxLevels; level++) {
+        if (level > 0) {
+            vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                                 VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &computeBarrier, 0, nullptr, 0, nullptr);
+        }
+        uint32_t size = std::max(RESOLUTION >> level, 1u);
+        params.srcLevel = static_cast<int32_t>(level) - 1;
+        params.dstSize = static_cast<int32_t>(size);
+        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_maxMipPipeline->getPipelineLayout(),
+                                0, 1, &m_computeSets[level], 0, nullptr);
+        vkCmdPushConstants(commandBuffer, m_maxMipPipeline->getPipelineLayout(), VK_SHADER_STAGE_COMPUTE_BIT,
+                           0, sizeof(MaxMipParams), &params);
+        vkCmdDispatch(commandBuffer, groupCount(size), groupCount(size), 1);
+    }
+}
+
+void TerrainHeightfield::bind(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout) const {
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout,
+                            1, 1, &m_descriptorSet, 0, nullptr);
+}
+
+glm::vec4 TerrainHeightfield::getRegion() const {
+    return glm::vec4(m_origin, m_texelSize, m_assembled ? 1.0f : 0.0f);
+}
+
+uint32_t TerrainHeightfield::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) {
+    VkPhysicalDeviceMemoryProperties memProperties;
+    vkGetPhysicalDeviceMemoryProperties(m_device->getPhysicalDevice(), &memProperties);
+
+    for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++) {
+        if ((typeFilter & (1 << i)) && (memProperties.memoryTypes[i].propertyFlags & properties) == properties) {
+            return i;
+        }
+    }
+
+    throw std::runtime_error("Failed to find suitable memory type!");
+}
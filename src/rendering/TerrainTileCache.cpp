@@ -0,0 +1,393 @@
+#include "rendering/TerrainTileCache.h"
+#include "core/CommandContext.h"
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <iterator>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+namespace {
+constexpr uint32_t MAX_WORKERS = 4;
+constexpr uint32_t TILE_TEXELS = TerrainTileCache::TILE_RESOLUTION * TerrainTileCache::TILE_RESOLUTION;
+constexpr VkDeviceSize HEIGHT_BYTES = TILE_TEXELS * sizeof(float);
+constexpr VkDeviceSize NORMAL_BYTES = TILE_TEXELS * sizeof(uint32_t);
+constexpr VkDeviceSize TILE_BYTES = HEIGHT_BYTES + NORMAL_BYTES;
+
+int32_t packSnorm8(float value) {
+    return static_cast<int32_t>(std::round(std::clamp(value, -1.0f, 1.0f) * 127.0f)) & 0xff;
+}
+}
+
+TerrainTileCache::TerrainTileCache(VulkanDevice* device, uint32_t minimumTiles, VkDeviceSize memoryBudget)
+    : m_device(device) {
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(m_device->getPhysicalDevice(), &properties);
+    VkDeviceSize budgetTiles = memoryBudget / TILE_BYTES;
+    m_capacity = static_cast<uint32_t>(std::min<VkDeviceSize>(budgetTiles, properties.limits.maxImageArrayLayers));
+    if (m_capacity < minimumTiles) {
+        throw std::runtime_error("Failed to fit the terrain tile atlas: " + std::to_string(m_capacity) +
+                                 " layers for " + std::to_string(minimumTiles) + " tiles!");
+    }
+
+    createAtlases();
+    createStagingBuffer();
+
+    m_freeLayers.reserve(m_capacity);
+    for (uint32_t layer = m_capacity; layer > 0; layer--) {
+        m_freeLayers.push_back(layer - 1);
+    }
+    m_stats.capacity = m_capacity;
+
+    // Leave a core for the render thread
+    uint32_t hardwareThreads = std::max(std::thread::hardware_concurrency(), 2u);
+    uint32_t workerCount = std::clamp(hardwareThreads - 1, 1u, MAX_WORKERS);
+    for (uint32_t i = 0; i < workerCount; i++) {
+        m_workers.emplace_back(&TerrainTileCache::workerLoop, this);
+    }
+
+    std::cout << "TerrainTileCache: " << m_capacity << " tiles of " << TILE_RESOLUTION << "x" << TILE_RESOLUTION
+              << " (" << (m_capacity * TILE_BYTES) / (1024 * 1024) << " MB), " << workerCount << " workers, "
+              << TerrainFunction::batchKernel() << " heights" << std::endl;
+}
+
+TerrainTileCache::~TerrainTileCache() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_condition.notify_all();
+    for (std::thread& worker : m_workers) {
+        worker.join();
+    }
+
+    VkDevice device = m_device->getDevice();
+    for (VkImage image : {m_heightAtlas, m_normalAtlas}) {
+        if (image != VK_NULL_HANDLE) vkDestroyImage(device, image, nullptr);
+    }
+    for (VkDeviceMemory memory : {m_heightAtlasMemory, m_normalAtlasMemory}) {
+        if (memory != VK_NULL_HANDLE) vkFreeMemory(device, memory, nullptr);
+    }
+    if (m_stagingBuffer != VK_NULL_HANDLE) {
+        vkDestroyBuffer(device, m_stagingBuffer, nullptr);
+    }
+    if (m_stagingMemory != VK_NULL_HANDLE) {
+        vkFreeMemory(device, m_stagingMemory, nullptr);
+    }
+}
+
+void TerrainTileCache::createImage(VkFormat format, VkImage& image, VkDeviceMemory& memory) {
+    VkDevice device = m_device->getDevice();
+
+    VkImageCreateInfo imageInfo{};
+    imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    imageInfo.imageType = VK_IMAGE_TYPE_2D;
+    imageInfo.extent = {TILE_RESOLUTION, TILE_RESOLUTION, 1};
+    imageInfo.mipLevels = 1;
+    imageInfo.arrayLayers = m_capacity;
+    imageInfo.format = format;
+    imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    imageInfo.usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+    imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+    imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    if (vkCreateImage(device, &imageInfo, nullptr, &image) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create terrain tile atlas!");
+    }
+
+    VkMemoryRequirements memRequirements;
+    vkGetImageMemoryRequirements(device, image, &memRequirements);
+
+    VkMemoryAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = memRequirements.size;
+    allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+    if (vkAllocateMemory(device, &allocInfo, nullptr, &memory) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to allocate terrain tile atlas memory!");
+    }
+    vkBindImageMemory(device, image, memory, 0);
+}
+
+void TerrainTileCache::createAtlases() {
+    createImage(HEIGHT_FORMAT, m_heightAtlas, m_heightAtlasMemory);
+    createImage(NORMAL_FORMAT, m_normalAtlas, m_normalAtlasMemory);
+
+    // Both atlases live in GENERAL: they are written and read by transfers only
+    std::array<VkImageMemoryBarrier, 2> barriers{};
+    std::array<VkImage, 2> images{m_heightAtlas, m_normalAtlas};
+    for (size_t i = 0; i < barriers.size(); i++) {
+        barriers[i].sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barriers[i].srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barriers[i].dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barriers[i].image = images[i];
+        barriers[i].subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, m_capacity};
+        barriers[i].oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        barriers[i].newLayout = VK_IMAGE_LAYOUT_GENERAL;
+        barriers[i].srcAccessMask = 0;
+        barriers[i].dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    }
+
+    CommandContext context(m_device, VulkanDevice::QueueType::Graphics);
+    VkCommandBuffer commandBuffer = context.begin();
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         0, 0, nullptr, 0, nullptr, static_cast<uint32_t>(barriers.size()), barriers.data());
+    context.submitAndWait(commandBuffer);
+}
+
+void TerrainTileCache::createStagingBuffer() {
+    VkDevice device = m_device->getDevice();
+    VkDeviceSize size = TILE_BYTES * MAX_UPLOADS_PER_FRAME * RING_SLOTS;
+
+    VkBufferCreateInfo bufferInfo{};
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size = size;
+    bufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    if (vkCreateBuffer(device, &bufferInfo, nullptr, &m_stagingBuffer) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create terrain tile staging buffer!");
+    }
+
+    VkMemoryRequirements memRequirements;
+    vkGetBufferMemoryRequirements(device, m_stagingBuffer, &memRequirements);
+
+    VkMemoryAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.allocationSize = memRequirements.size;
+    allocInfo.memoryTypeIndex = findMemoryType(memRequirements.memoryTypeBits,
+                                               VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                                               VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+    if (vkAllocateMemory(device, &allocInfo, nullptr, &m_stagingMemory) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to allocate terrain tile staging memory!");
+    }
+    vkBindBufferMemory(device, m_stagingBuffer, m_stagingMemory, 0);
+    vkMapMemory(device, m_stagingMemory, 0, size, 0, &m_stagingMapped);
+}
+
+void TerrainTileCache::setParameters(const TerrainFunction::Parameters& parameters) {
+    if (parameters == m_parameters) {
+        return;
+    }
+    m_parameters = parameters;
+    // Tiles still generating with the old parameters are discarded when they come back
+    m_generation++;
+
+    m_resident.clear();
+    m_lru.clear();
+    m_requested.clear();
+    m_freeLayers.clear();
+    for (uint32_t layer = m_capacity; layer > 0; layer--) {
+        m_freeLayers.push_back(layer - 1);
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_queue.clear();
+}
+
+void TerrainTileCache::request(const std::vector<TileKey>& tiles) {
+    m_frame++;
+    m_stagingSlot = (m_stagingSlot + 1) % RING_SLOTS;
+    m_uploads.clear();
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        // Whatever no worker has picked up yet is requeued in this frame's order
+        for (const Job& job : m_queue) {
+            m_requested.erase(job.key);
+        }
+        m_queue.clear();
+
+        for (const TileKey& key : tiles) {
+            auto resident = m_resident.find(key);
+            if (resident != m_resident.end()) {
+                resident->second.lastUsed = m_frame;
+                m_lru.splice(m_lru.begin(), m_lru, resident->second.lruPosition);
+                continue;
+            }
+            if (m_requested.insert(key).second) {
+                m_queue.push_back({key, m_generation, m_parameters});
+            }
+        }
+    }
+    m_condition.notify_all();
+
+    collectFinished();
+
+    m_stats.resident = static_cast<uint32_t>(m_resident.size());
+    m_stats.pending = static_cast<uint32_t>(m_requested.size());
+}
+
+void TerrainTileCache::collectFinished() {
+    std::vector<TileData> finished;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        size_t count = std::min<size_t>(m_finished.size(), MAX_UPLOADS_PER_FRAME);
+        finished.assign(std::make_move_iterator(m_finished.begin()),
+                        std::make_move_iterator(m_finished.begin() + count));
+        m_finished.erase(m_finished.begin(), m_finished.begin() + count);
+    }
+
+    for (TileData& tile : finished) {
+        if (tile.generation != m_generation) {
+            continue;
+        }
+        m_requested.erase(tile.key);
+        m_stats.generated++;
+        if (m_resident.count(tile.key) > 0) {
+            continue;
+        }
+        // Dropped if every layer is in use this frame; it is requested again while wanted
+        if (m_freeLayers.empty() && !evict()) {
+            continue;
+        }
+        uint32_t layer = m_freeLayers.back();
+        m_freeLayers.pop_back();
+
+        VkDeviceSize offset = (m_stagingSlot * MAX_UPLOADS_PER_FRAME + m_uploads.size()) * TILE_BYTES;
+        char* staging = static_cast<char*>(m_stagingMapped) + offset;
+        memcpy(staging, tile.heights.data(), HEIGHT_BYTES);
+        memcpy(staging + HEIGHT_BYTES, tile.normals.data(), NORMAL_BYTES);
+        m_uploads.push_back({layer, offset});
+
+        m_lru.push_front(tile.key);
+        m_resident[tile.key] = {layer, m_frame, m_lru.begin()};
+    }
+}
+
+bool TerrainTileCache::evict() {
+    if (m_lru.empty()) {
+        return false;
+    }
+    auto resident = m_resident.find(m_lru.back());
+    if (resident->second.lastUsed == m_frame) {
+        return false;
+    }
+    m_freeLayers.push_back(resident->second.layer);
+    m_resident.erase(resident);
+    m_lru.pop_back();
+    m_stats.evictions++;
+    return true;
+}
+
+void TerrainTileCache::recordUploads(VkCommandBuffer commandBuffer) {
+    m_stats.uploads = static_cast<uint32_t>(m_uploads.size());
+    if (m_uploads.empty()) {
+        return;
+    }
+
+    // Earlier frames' uploads and copies out of the atlas finish first
+    VkMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+    std::vector<VkBufferImageCopy> heightCopies;
+    std::vector<VkBufferImageCopy> normalCopies;
+    heightCopies.reserve(m_uploads.size());
+    normalCopies.reserve(m_uploads.size());
+    for (const Upload& upload : m_uploads) {
+        VkBufferImageCopy copy{};
+        copy.bufferOffset = upload.offset;
+        copy.imageSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, upload.layer, 1};
+        copy.imageExtent = {TILE_RESOLUTION, TILE_RESOLUTION, 1};
+        heightCopies.push_back(copy);
+        copy.bufferOffset = upload.offset + HEIGHT_BYTES;
+        normalCopies.push_back(copy);
+    }
+    vkCmdCopyBufferToImage(commandBuffer, m_stagingBuffer, m_heightAtlas, VK_IMAGE_LAYOUT_GENERAL,
+                           static_cast<uint32_t>(heightCopies.size()), heightCopies.data());
+    vkCmdCopyBufferToImage(commandBuffer, m_stagingBuffer, m_normalAtlas, VK_IMAGE_LAYOUT_GENERAL,
+                           static_cast<uint32_t>(normalCopies.size()), normalCopies.data());
+
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                         0, 1, &barrier, 0, nullptr, 0, nullptr);
+    m_uploads.clear();
+}
+
+int32_t TerrainTileCache::findLayer(const TileKey& key) const {
+    auto resident = m_resident.find(key);
+    return resident != m_resident.end() ? static_cast<int32_t>(resident->second.layer) : -1;
+}
+
+void TerrainTileCache::workerLoop() {
+    for (;;) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_condition.wait(lock, [this] { return m_stopping || !m_queue.empty(); });
+            if (m_stopping) {
+                return;
+            }
+            job = m_queue.front();
+            m_queue.pop_front();
+        }
+
+        TileData tile = generate(job);
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_finished.push_back(std::move(tile));
+    }
+}
+
+TerrainTileCache::TileData TerrainTileCache::generate(const Job& job) {
+    TileData tile;
+    tile.key = job.key;
+    tile.generation = job.generation;
+    tile.heights.resize(TILE_TEXELS);
+    tile.normals.resize(TILE_TEXELS);
+
+    // Texel (i, j) sits at its centre, like the heightfield the tiles are assembled
+    // into. One batch covers the tile plus a texel of border, which are exactly
+    // the neighbours the central-difference normals need.
+    constexpr uint32_t side = TILE_RESOLUTION + 2;
+    float size = tileSize(job.key.level);
+    float texelSize = size / static_cast<float>(TILE_RESOLUTION);
+    glm::vec2 origin = glm::vec2(job.key.x, job.key.z) * size;
+    std::vector<float> x(side * side);
+    std::vector<float> z(side * side);
+    std::vector<float> heights(side * side);
+    for (uint32_t j = 0; j < side; j++) {
+        for (uint32_t i = 0; i < side; i++) {
+            x[j * side + i] = origin.x + (static_cast<float>(i) - 0.5f) * texelSize;
+            z[j * side + i] = origin.y + (static_cast<float>(j) - 0.5f) * texelSize;
+        }
+    }
+    TerrainFunction::heights(x.data(), z.data(), heights.data(), heights.size(), job.parameters);
+
+    for (uint32_t j = 0; j < TILE_RESOLUTION; j++) {
+        for (uint32_t i = 0; i < TILE_RESOLUTION; i++) {
+            uint32_t center = (j + 1) * side + i + 1;
+            float dx = heights[center + 1] - heights[center - 1];
+            float dz = heights[center + side] - heights[center - side];
+            glm::vec3 normal = glm::normalize(glm::vec3(-dx, 2.0f * texelSize, -dz));
+
+            uint32_t index = j * TILE_RESOLUTION + i;
+            tile.heights[index] = heights[center];
+            tile.normals[index] = static_cast<uint32_t>(packSnorm8(normal.x) | (packSnorm8(normal.y) << 8) |
+                                                        (packSnorm8(normal.z) << 16));
+        }
+    }
+    return tile;
+}
+
+uint32_t TerrainTileCache::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) {
+    VkPhysicalDeviceMemoryProperties memProperties;
+    vkGetPhysicalDeviceMemoryProperties(m_device->getPhysicalDevice(), &memProperties);
+
+    for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++) {
+        if ((typeFilter & (1 << i)) && (memProperties.memoryTypes[i].propertyFlags & properties) == properties) {
+            return i;
+        }
+    }
+
+    throw std::runtime_error("Failed to find suitable memory type!");
+}
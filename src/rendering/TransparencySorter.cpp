@@ -0,0 +1,120 @@
+#include "rendering/TransparencySorter.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <functional>
+#include <future>
+#include <thread>
+
+namespace {
+// Below this many draws, starting threads costs more than the sort itself
+constexpr size_t PARALLEL_THRESHOLD = 8192;
+constexpr uint32_t MAX_WORKERS = 8;
+constexpr uint32_t RADIX_BITS = 8;
+
+// Float bits reordered so unsigned comparison matches float comparison
+uint32_t orderedBits(float value) {
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return (bits & 0x80000000u) ? ~bits : (bits | 0x80000000u);
+}
+
+// Chunk 0 runs on the calling thread
+void forEachChunk(uint32_t chunkCount, const std::function<void(uint32_t)>& work) {
+    if (chunkCount == 1) {
+        work(0);
+        return;
+    }
+    std::vector<std::future<void>> tasks;
+    tasks.reserve(chunkCount - 1);
+    for (uint32_t chunk = 1; chunk < chunkCount; chunk++) {
+        tasks.push_back(std::async(std::launch::async, work, chunk));
+    }
+    work(0);
+    for (auto& task : tasks) {
+        task.get();
+    }
+}
+}
+
+TransparencySorter::TransparencySorter() {
+    m_workerCount = std::clamp(std::thread::hardware_concurrency(), 1u, MAX_WORKERS);
+}
+
+const std::vector<uint32_t>& TransparencySorter::sort(const std::vector<glm::vec3>& centers, const glm::mat4& viewMatrix) {
+    auto start = std::chrono::high_resolution_clock::now();
+
+    size_t count = centers.size();
+    m_keys.resize(count);
+    m_keysScratch.resize(count);
+    m_order.resize(count);
+    m_orderScratch.resize(count);
+
+    uint32_t chunkCount = count >= PARALLEL_THRESHOLD ? m_workerCount : 1;
+    size_t chunkSize = (count + chunkCount - 1) / chunkCount;
+
+    // Larger view-space distance must come first, so the ascending sort runs on inverted keys
+    glm::vec4 depthRow(viewMatrix[0][2], viewMatrix[1][2], viewMatrix[2][2], viewMatrix[3][2]);
+    forEachChunk(chunkCount, [&](uint32_t chunk) {
+        size_t end = std::min(count, (chunk + 1) * chunkSize);
+        for (size_t i = chunk * chunkSize; i < end; i++) {
+            float distance = -glm::dot(depthRow, glm::vec4(centers[i], 1.0f));
+            m_keys[i] = ~orderedBits(distance);
+            m_order[i] = static_cast<uint32_t>(i);
+        }
+    });
+
+    radixSort(chunkCount);
+
+    m_lastChunkCount = chunkCount;
+    m_lastSortMs = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+    return m_order;
+}
+
+void TransparencySorter::radixSort(uint32_t chunkCount) {
+    size_t count = m_keys.size();
+    size_t chunkSize = (count + chunkCount - 1) / chunkCount;
+    m_histograms.resize(chunkCount);
+
+    for (uint32_t shift = 0; shift < 32; shift += RADIX_BITS) {
+        forEachChunk(chunkCount, [&](uint32_t chunk) {
+            Histogram& histogram = m_histograms[chunk];
+            histogram.fill(0);
+            size_t end = std::min(count, (chunk + 1) * chunkSize);
+            for (size_t i = chunk * chunkSize; i < end; i++) {
+                histogram[(m_keys[i] >> shift) & 0xFF]++;
+            }
+        });
+
+        // Exclusive offsets, digit-major then chunk, so each chunk scatters into its
+        // own slice of every bucket and equal keys keep their input order
+        uint32_t offset = 0;
+        bool uniformDigit = false;
+        for (uint32_t digit = 0; digit < 256; digit++) {
+            uint32_t digitCount = 0;
+            for (uint32_t chunk = 0; chunk < chunkCount; chunk++) {
+                uint32_t n = m_histograms[chunk][digit];
+                m_histograms[chunk][digit] = offset;
+                offset += n;
+                digitCount += n;
+            }
+            uniformDigit = uniformDigit || digitCount == count;
+        }
+        // Every key shares this digit (common for the exponent byte), so the pass would not move anything
+        if (uniformDigit) {
+            continue;
+        }
+
+        forEachChunk(chunkCount, [&](uint32_t chunk) {
+            Histogram& offsets = m_histograms[chunk];
+            size_t end = std::min(count, (chunk + 1) * chunkSize);
+            for (size_t i = chunk * chunkSize; i < end; i++) {
+                uint32_t position = offsets[(m_keys[i] >> shift) & 0xFF]++;
+                m_keysScratch[position] = m_keys[i];
+                m_orderScratch[position] = m_order[i];
+            }
+        });
+        m_keys.swap(m_keysScratch);
+        m_order.swap(m_orderScratch);
+    }
+}
@@ -2,6 +2,8 @@
 #include "ecs/Systems.h"
 #include <iostream>
 
+const std::vector<RenderSystem::RenderData> Scene::s_emptyRenderList;
+
 Scene::Scene() {
     m_ecsManager = std::make_unique<ECSManager>();
 }
@@ -41,22 +43,52 @@ void Scene::initialize() {
     renderSignature.set(m_ecsManager->getComponentType<LODComponent>());
     m_ecsManager->setSystemSignature<RenderSystem>(renderSignature);
     
+    // Schedule the systems; each declares its component access, and the
+    // scheduler works out which of them may overlap
+    m_jobs = std::make_unique<JobSystem>();
+    m_scheduler = std::make_unique<SystemScheduler>(m_jobs.get());
+    ECSManager* ecs = m_ecsManager.get();
+    
+    m_scheduler->addSystem("EntityStreaming", EntityGenerationSystem::getAccess(ecs),
+                           [this](JobSystem&) { updateEntityStreaming(); });
+    m_scheduler->addSystem("LOD", LODSystem::getAccess(ecs), [this, ecs, lodSystem](JobSystem& jobs) {
+        lodSystem->update(ecs, m_cameraPos, *m_frustumCuller, m_settings.viewDistance, jobs);
+    });
+    m_scheduler->addSystem("RenderList", RenderSystem::getAccess(ecs), [this, ecs, renderSystem](JobSystem& jobs) {
+        m_renderList = &renderSystem->getRenderList(ecs, jobs);
+    });
+    
     std::cout << "Scene initialized successfully" << std::endl;
 }
 
-void Scene::update(float deltaTime, const glm::vec3& cameraPos) {
+void Scene::update(float deltaTime, const glm::vec3& cameraPos, const FrustumCuller& frustumCuller) {
+    m_deltaTime = deltaTime;
+    m_cameraPos = cameraPos;
+    m_frustumCuller = &frustumCuller;
+    
+    m_scheduler->run();
+    
+    m_frustumCuller = nullptr;
+}
+
+void Scene::updateEntityStreaming() {
     // Only update entities if camera moved significantly or enough time passed
-    float distanceMoved = glm::length(cameraPos - m_lastCameraPos);
-    m_lastSpawnTime += deltaTime;
+    float distanceMoved = glm::length(m_cameraPos - m_lastCameraPos);
+    m_lastSpawnTime += m_deltaTime;
     
-    if (distanceMoved > 10.0f || m_lastSpawnTime > 2.0f) {
-        populateEntities(cameraPos);
-        m_lastCameraPos = cameraPos;
+    if (distanceMoved > m_settings.entitySpawnRadius * m_settings.entityStreamDistance ||
+        m_lastSpawnTime > m_settings.entityStreamInterval) {
+        populateEntities(m_cameraPos);
+        m_lastCameraPos = m_cameraPos;
         m_lastSpawnTime = 0.0f;
     }
 }
 
 void Scene::cleanup() {
+    // The scheduled systems hold the ECS, so they go first
+    m_scheduler.reset();
+    m_jobs.reset();
+    m_renderList = &s_emptyRenderList;
     if (m_ecsManager) {
         m_ecsManager.reset();
     }
@@ -65,6 +97,12 @@ void Scene::cleanup() {
 void Scene::populateEntities(const glm::vec3& cameraPos) {
     auto entityGenSystem = m_ecsManager->getSystem<EntityGenerationSystem>();
     if (entityGenSystem) {
+        // On the same ground the terrain renders
+        TerrainFunction::Parameters terrain;
+        terrain.terrainScale = m_settings.terrainScale;
+        terrain.terrainHeight = m_settings.terrainHeight;
+        entityGenSystem->setTerrainParameters(terrain);
+        
         // Generate entities around camera
         entityGenSystem->generateEntitiesAroundCamera(
             m_ecsManager.get(), 
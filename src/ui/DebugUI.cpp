@@ -32,7 +32,22 @@ DebugUI::DebugUI(VulkanDevice* device, SwapChain* swapChain, VkRenderPass render
     init_info.MinImageCount = m_swapChain->getImages().size();
     init_info.ImageCount = m_swapChain->getImages().size();
     init_info.CheckVkResultFn = nullptr;
-    init_info.RenderPass = m_renderPass;
+    if (m_renderPass != VK_NULL_HANDLE) {
+        init_info.RenderPass = m_renderPass;
+    } else {
+#ifdef IMGUI_IMPL_VULKAN_HAS_DYNAMIC_RENDERING
+        // Same attachment formats the render graph's UI pass renders with
+        m_colorFormat = m_swapChain->getImageFormat();
+        init_info.UseDynamicRendering = true;
+        init_info.PipelineRenderingCreateInfo = {};
+        init_info.PipelineRenderingCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO;
+        init_info.PipelineRenderingCreateInfo.colorAttachmentCount = 1;
+        init_info.PipelineRenderingCreateInfo.pColorAttachmentFormats = &m_colorFormat;
+        init_info.PipelineRenderingCreateInfo.depthAttachmentFormat = RenderPass::DEPTH_FORMAT;
+#else
+        throw std::runtime_error("ImGui Vulkan backend was built without dynamic rendering support!");
+#endif
+    }
     
     ImGui_ImplVulkan_Init(&init_info);
     m_initialized = true;
@@ -121,6 +136,59 @@ void DebugUI::renderDrawData(VkCommandBuffer commandBuffer) {
     }
 }
 
+void DebugUI::setSwapChain(SwapChain* swapChain) {
+    m_swapChain = swapChain;
+    ImGui_ImplVulkan_SetMinImageCount(static_cast<uint32_t>(m_swapChain->getImages().size()));
+}
+
+void DebugUI::renderPresentationSettings(PerformanceStats& stats, RenderSettings& settings) {
+    const char* presentModes[] = { "FIFO (V-Sync)", "FIFO Relaxed", "Mailbox", "Immediate" };
+    ImGui::Combo("Present Mode", &settings.presentMode, presentModes, IM_ARRAYSIZE(presentModes));
+    if (stats.activePresentMode != settings.presentMode) {
+        ImGui::TextDisabled("Unsupported, using %s", presentModes[stats.activePresentMode]);
+    }
+    
+    ImGui::SliderInt("Frames In Flight", &settings.framesInFlight, 1, 3);
+    ImGui::SliderInt("Swapchain Images", &settings.swapchainImageCount, 0, 4, settings.swapchainImageCount == 0 ? "Auto" : "%d");
+    ImGui::Text("Active Images: %d", stats.swapchainImageCount);
+    ImGui::Checkbox("Low Latency Mode", &settings.lowLatencyMode);
+    
+    ImGui::Separator();
+    ImGui::Text("Input -> Submit: %.2f ms", stats.inputToSubmit * 1000.0f);
+    if (stats.presentTimed) {
+        ImGui::Text("Submit -> Present: %.2f ms", stats.submitToPresent * 1000.0f);
+        ImGui::Text("Input -> Present: %.2f ms", stats.inputToPresent * 1000.0f);
+    } else {
+        ImGui::Text("Submit -> GPU complete (polled): %.2f ms", stats.submitToGpuComplete * 1000.0f);
+        ImGui::Text("Input -> GPU complete (polled): %.2f ms", stats.inputToGpuComplete * 1000.0f);
+        ImGui::TextDisabled("No present wait, display time not measured");
+    }
+}
+
+void DebugUI::renderFrameGraphStats(const PerformanceStats& stats) {
+    if (!ImGui::TreeNode("Frame Graph")) return;
+    
+    ImGui::Text("Passes: %d (%d culled)", stats.graphPassCount, stats.graphCulledPasses);
+    ImGui::Text("Barriers: %d", stats.graphBarrierCount);
+    ImGui::Text("Transient Memory: %.2f MB (%.2f MB aliased)", stats.transientMemoryMB, stats.aliasedMemoryMB);
+    
+    if (stats.passTimings.empty()) {
+        ImGui::TextDisabled("GPU timestamps not supported");
+    }
+    for (const auto& pass : stats.passTimings) {
+        ImGui::Text("%-12s %.3f ms", pass.name.c_str(), pass.gpuTime * 1000.0f);
+    }
+    
+    if (!stats.systemTimings.empty()) {
+        ImGui::Separator();
+        ImGui::Text("Scene Systems (CPU)");
+        for (const auto& system : stats.systemTimings) {
+            ImGui::Text("%-16s %.3f ms", system.name.c_str(), system.cpuTime * 1000.0f);
+        }
+    }
+    ImGui::TreePop();
+}
+
 void DebugUI::renderDebugPanel(PerformanceStats& stats, RenderSettings& settings) {
     if (!settings.showDebugUI) return;
     
@@ -132,6 +200,7 @@ void DebugUI::renderDebugPanel(PerformanceStats& stats, RenderSettings& settings
         ImGui::Text("Frame Time: %.3f ms", stats.frameTime * 1000.0f);
         ImGui::Text("CPU Time: %.3f ms", stats.cpuTime * 1000.0f);
         ImGui::Text("GPU Time: %.3f ms", stats.gpuTime * 1000.0f);
+        renderFrameGraphStats(stats);
         
         ImGui::Separator();
         ImGui::Text("Terrain Performance");
@@ -172,8 +241,10 @@ void DebugUI::renderDebugPanel(PerformanceStats& stats, RenderSettings& settings
             settings.timeOffset = 0.0f;
         }
         
-        ImGui::Separator();
-        ImGui::Checkbox("V-Sync", &settings.enableVSync);
+    }
+    
+    if (ImGui::CollapsingHeader("Presentation")) {
+        renderPresentationSettings(stats, settings);
     }
     
     // Camera info
@@ -196,7 +267,7 @@ void DebugUI::renderDebugPanel(PerformanceStats& stats, RenderSettings& settings
     ImGui::End();
 }
 
-void DebugUI::renderViewerPanel(PerformanceStats& stats, GLTFViewer* viewer, BackgroundSettings& backgroundSettings) {
+void DebugUI::renderViewerPanel(PerformanceStats& stats, RenderSettings& renderSettings, GLTFViewer* viewer, BackgroundSettings& backgroundSettings) {
     if (!viewer) return;
     
     ImGui::Begin("glTF Viewer Controls");
@@ -206,6 +277,7 @@ void DebugUI::renderViewerPanel(PerformanceStats& stats, GLTFViewer* viewer, Bac
         ImGui::Text("FPS: %.1f (%.2f ms)", stats.fps, stats.frameTime * 1000.0f);
         ImGui::Text("CPU Time: %.2f ms", stats.cpuTime * 1000.0f);
         ImGui::Text("GPU Time: %.2f ms", stats.gpuTime * 1000.0f);
+        renderFrameGraphStats(stats);
         if (viewer->isModelLoaded()) {
             ImGui::Text("Vertices: %d", viewer->getVertexCount());
             ImGui::Text("Triangles: %d", viewer->getTriangleCount());
@@ -214,6 +286,11 @@ void DebugUI::renderViewerPanel(PerformanceStats& stats, GLTFViewer* viewer, Bac
         }
     }
     
+    // Present mode and latency
+    if (ImGui::CollapsingHeader("Presentation")) {
+        renderPresentationSettings(stats, renderSettings);
+    }
+    
     // Model loading
     if (ImGui::CollapsingHeader("Model", ImGuiTreeNodeFlags_DefaultOpen)) {
         if (ImGui::Button("Load glTF Model...")) {
@@ -281,6 +358,9 @@ void DebugUI::renderViewerPanel(PerformanceStats& stats, GLTFViewer* viewer, Bac
         if (ImGui::Combo("Render Mode", &settings.renderMode, renderModes, 8)) {
             // renderMode is now an int, so no conversion needed
         }
+        if (settings.renderMode == 2) {
+            ImGui::SliderFloat("Point Size", &settings.pointSize, 0.001f, 0.05f, "%.3f");
+        }
         
         // Material overrides
         ImGui::Checkbox("Use Vertex Colors", &settings.useVertexColors);
@@ -292,8 +372,92 @@ void DebugUI::renderViewerPanel(PerformanceStats& stats, GLTFViewer* viewer, Bac
         ImGui::SliderFloat("Roughness", &settings.roughnessFactor, 0.0f, 1.0f);
         
         // Debug visualization
-        ImGui::Checkbox("Show Wireframe Overlay", &settings.showWireframe);
+        if (m_device->supportsGeometryShader()) {
+            ImGui::Checkbox("Show Wireframe Overlay", &settings.showWireframe);
+        } else {
+            ImGui::TextDisabled("Wireframe overlay needs geometry shaders");
+        }
         ImGui::Checkbox("Show Bounding Box", &settings.showBoundingBox);
+        
+        ImGui::Separator();
+        ImGui::Checkbox("Depth Prepass", &renderSettings.depthPrepass);
+        if (stats.fragmentStatsSupported) {
+            ImGui::Text("Shaded Fragments: %llu", static_cast<unsigned long long>(stats.shadedFragments));
+            if (stats.shadedFragmentsNoPrepass > 0 && stats.shadedFragmentsWithPrepass > 0) {
+                // Compares the latest frame measured in each mode; keep the camera still for a fair number
+                int64_t saved = static_cast<int64_t>(stats.shadedFragmentsNoPrepass) - static_cast<int64_t>(stats.shadedFragmentsWithPrepass);
+                ImGui::Text("Saved by Prepass: %lld (%.1f%%)", static_cast<long long>(saved),
+                            100.0 * static_cast<double>(saved) / static_cast<double>(stats.shadedFragmentsNoPrepass));
+            } else {
+                ImGui::TextDisabled("Toggle the prepass to compare fragment counts");
+            }
+        } else {
+            ImGui::TextDisabled("Pipeline statistics not supported");
+        }
+        
+        ImGui::Separator();
+        ImGui::Checkbox("Occlusion Culling", &renderSettings.occlusionCulling);
+        if (renderSettings.occlusionCulling) {
+            ImGui::Text("Objects: %d (%d early, %d late)", stats.cullObjects, stats.cullDrawnEarly, stats.cullDrawnLate);
+            ImGui::Text("Culled: %d occluded, %d outside frustum", stats.cullOccluded, stats.cullOutsideFrustum);
+        }
+        
+        ImGui::Separator();
+        ImGui::Checkbox("Dynamic Resolution", &renderSettings.dynamicResolution);
+        if (renderSettings.dynamicResolution) {
+            ImGui::SliderFloat("Target Frame Time (ms)", &renderSettings.targetFrameMs, 4.0f, 50.0f, "%.1f");
+        }
+        ImGui::Text("Render Resolution: %dx%d (%.0f%%)", stats.renderWidth, stats.renderHeight,
+                    stats.renderScale * 100.0f);
+        
+        ImGui::Separator();
+        ImGui::Text("Shading Variants: %d", stats.shadingVariants);
+        ImGui::Text("Material Draws: %d", stats.materialDraws);
+        
+        ImGui::Separator();
+        const char* transparencyModes[] = {"Auto", "Sorted", "Weighted OIT"};
+        ImGui::Combo("Transparency", &renderSettings.transparencyMode, transparencyModes, 3);
+        ImGui::Text("Blended Draws: %d", stats.blendedDraws);
+        if (stats.blendedDraws > 0) {
+            if (stats.weightedOITActive) {
+                ImGui::Text("Resolved with weighted blended OIT");
+            } else {
+                ImGui::Text("Sort: %.3f ms (%d thread%s)", stats.transparencySortMs, stats.transparencySortChunks,
+                            stats.transparencySortChunks == 1 ? "" : "s");
+            }
+        }
+    }
+    
+    // Procedural terrain around the model
+    if (ImGui::CollapsingHeader("Terrain")) {
+        ImGui::Checkbox("Show Terrain", &renderSettings.showTerrain);
+        if (renderSettings.showTerrain) {
+            const char* techniqueItems[] = { "CDLOD Mesh", "Raymarch" };
+            ImGui::Combo("Technique", &renderSettings.terrainTechnique, techniqueItems, IM_ARRAYSIZE(techniqueItems));
+            const char* qualityItems[] = { "Low", "Medium", "High" };
+            ImGui::Combo("Detail", &renderSettings.qualityLevel, qualityItems, IM_ARRAYSIZE(qualityItems));
+            ImGui::SliderFloat("View Distance", &renderSettings.viewDistance, 50.0f, 1000.0f, "%.0f");
+            if (renderSettings.terrainTechnique == 0) {
+                ImGui::SliderFloat("LOD Distance", &renderSettings.terrainLodDistance, 40.0f, 200.0f, "%.0f");
+            } else {
+                const char* resolutionItems[] = { "Full", "Half", "Quarter" };
+                ImGui::Combo("Trace Resolution", &renderSettings.terrainRaymarchResolution, resolutionItems,
+                             IM_ARRAYSIZE(resolutionItems));
+            }
+            ImGui::SliderFloat("Base Height", &renderSettings.terrainBaseHeight, -100.0f, 20.0f, "%.1f");
+            ImGui::Checkbox("Water", &renderSettings.enableWater);
+            ImGui::SliderFloat("Fog Density", &renderSettings.fogDensity, 0.0f, 0.02f, "%.4f");
+            if (renderSettings.terrainTechnique == 0) {
+                ImGui::Text("Patches: %d (%d triangles)", stats.terrainPatches, stats.terrainTriangles);
+            }
+            ImGui::Text("Heightfield rebuilds: %llu", static_cast<unsigned long long>(stats.terrainRebuilds));
+            ImGui::Text("Tiles: %d / %d resident, %d pending", stats.terrainTilesResident,
+                        stats.terrainTileCapacity, stats.terrainTilesPending);
+            ImGui::Text("Tile uploads: %d this frame, %llu generated, %llu evicted", stats.terrainTileUploads,
+                        static_cast<unsigned long long>(stats.terrainTilesGenerated),
+                        static_cast<unsigned long long>(stats.terrainTileEvictions));
+            ImGui::Text("Entities: %d (%d parts)", stats.sceneEntities, stats.entityInstances);
+        }
     }
     
     // Lighting controls
@@ -316,6 +480,28 @@ void DebugUI::renderViewerPanel(PerformanceStats& stats, GLTFViewer* viewer, Bac
         
         ImGui::Separator();
         
+        // KHR_lights_punctual lights from the model, shaded through the light clusters
+        ImGui::Text("Model Lights");
+        if (viewer->hasModel()) {
+            ImGui::Text("Punctual lights: %zu", viewer->getLoader().getLights().size());
+        } else {
+            ImGui::TextDisabled("No model loaded");
+        }
+        
+        ImGui::Separator();
+        
+        // Cascaded shadows from the primary light
+        ImGui::Text("Shadows");
+        const char* shadowQualityItems[] = { "Off", "Hard", "PCF 3x3", "PCF 5x5" };
+        ImGui::Combo("Shadow Quality", &settings.shadowQuality, shadowQualityItems, IM_ARRAYSIZE(shadowQualityItems));
+        ImGui::SliderFloat("Shadow Intensity", &settings.shadowIntensity, 0.0f, 1.0f);
+        if (settings.shadowQuality > 0 && viewer->hasModel()) {
+            ImGui::Text("Cascades: %d active, %d re-rendered", stats.shadowCascadesActive, stats.shadowCascadesRendered);
+            ImGui::Text("Map renders: %llu", static_cast<unsigned long long>(stats.shadowMapRenders));
+        }
+        
+        ImGui::Separator();
+        
         // Ambient & IBL
         ImGui::Text("Ambient & IBL");
         ImGui::ColorEdit3("Ambient Color", &settings.ambientColor[0]);
@@ -326,8 +512,17 @@ void DebugUI::renderViewerPanel(PerformanceStats& stats, GLTFViewer* viewer, Bac
         
         // Post-Processing
         ImGui::Text("Post-Processing");
-        ImGui::SliderFloat("Exposure", &settings.exposure, 0.1f, 5.0f);
+        const char* tonemapperItems[] = { "Reinhard", "ACES", "AgX" };
+        ImGui::Combo("Tonemapper", &settings.tonemapper, tonemapperItems, IM_ARRAYSIZE(tonemapperItems));
+        ImGui::Checkbox("Auto Exposure", &settings.autoExposure);
+        ImGui::SliderFloat(settings.autoExposure ? "Exposure Compensation" : "Exposure", &settings.exposure, 0.1f, 5.0f);
         ImGui::SliderFloat("Gamma", &settings.gamma, 1.0f, 3.0f);
+        ImGui::Checkbox("Bloom", &settings.bloom);
+        if (settings.bloom) {
+            ImGui::SliderFloat("Bloom Intensity", &settings.bloomIntensity, 0.0f, 0.5f);
+            ImGui::SliderFloat("Bloom Threshold", &settings.bloomThreshold, 0.0f, 4.0f);
+        }
+        ImGui::Text("Exposure: %.3f (avg luminance %.3f)", stats.postExposure, stats.averageLuminance);
         
         ImGui::Separator();
         
@@ -422,31 +617,34 @@ void DebugUI::renderViewerPanel(PerformanceStats& stats, GLTFViewer* viewer, Bac
                 break;
                 
             case BackgroundSettings::Type::SKYBOX:
-                ImGui::SliderFloat("Environment Rotation", &backgroundSettings.environmentRotation, 0.0f, 360.0f);
-                ImGui::SliderFloat("Environment Intensity", &backgroundSettings.environmentIntensity, 0.0f, 3.0f);
-                if (ImGui::Button("Load HDR Environment...")) {
-                    std::vector<FileDialog::Filter> filters = {
-                        {"HDR Images", "hdr,exr"},
-                        {"Radiance HDR", "hdr"},
-                        {"OpenEXR", "exr"}
-                    };
-                    
-                    std::string filePath = FileDialog::openFile(filters);
-                    if (!filePath.empty()) {
-                        // TODO: Implement HDR environment loading
-                        ImGui::OpenPopup("HDR Loading");
-                    }
-                }
-                if (ImGui::BeginPopup("HDR Loading")) {
-                    ImGui::Text("HDR environment loading will be implemented");
-                    ImGui::Text("in a future update.");
-                    if (ImGui::Button("OK")) {
-                        ImGui::CloseCurrentPopup();
-                    }
-                    ImGui::EndPopup();
-                }
+                ImGui::TextDisabled("Skybox drawing not implemented yet");
                 break;
         }
+        
+        ImGui::Separator();
+        
+        // The environment lights the model whatever the background type
+        ImGui::Text("Environment Lighting");
+        if (ImGui::Button("Load HDR Environment...")) {
+            std::vector<FileDialog::Filter> filters = {
+                {"Radiance HDR", "hdr"}
+            };
+            
+            std::string filePath = FileDialog::openFile(filters);
+            if (!filePath.empty()) {
+                // Loaded by the app between frames
+                backgroundSettings.pendingEnvironmentPath = filePath;
+            }
+        }
+        if (!backgroundSettings.environmentName.empty()) {
+            ImGui::Text("Environment: %s", backgroundSettings.environmentName.c_str());
+            ImGui::Text("Loaded in %.1f ms (%s)", backgroundSettings.environmentLoadMs,
+                        backgroundSettings.environmentFromCache ? "cache" : "precomputed");
+            ImGui::SliderFloat("Environment Rotation", &backgroundSettings.environmentRotation, 0.0f, 360.0f);
+            ImGui::SliderFloat("Environment Intensity", &backgroundSettings.environmentIntensity, 0.0f, 3.0f);
+        } else {
+            ImGui::TextDisabled("No environment loaded, using ambient color");
+        }
     }
     
     // Camera controls
@@ -513,6 +711,8 @@ void DebugUI::renderViewerPanel(PerformanceStats& stats, GLTFViewer* viewer, Bac
         ImGui::BulletText("R - Reset camera");
         ImGui::BulletText("1 - Solid rendering mode");
         ImGui::BulletText("2 - Wireframe mode");  
+        ImGui::BulletText("3 - Points mode");
+        ImGui::BulletText("W - Toggle wireframe overlay");
         ImGui::BulletText("G - Toggle gizmos");
         ImGui::BulletText("A - Toggle auto-rotate");
     }
@@ -1,6 +1,12 @@
 #include "viewer/GLTFLoader.h"
+#include "core/TimelineSemaphore.h"
+#include "core/DeletionQueue.h"
+#include "core/QueueOwnership.h"
+#include "rendering/ShaderPermutation.h"
 #include <iostream>
 #include <algorithm>
+#include <functional>
+#include <limits>
 
 #define TINYGLTF_IMPLEMENTATION
 #define STB_IMAGE_IMPLEMENTATION
@@ -57,7 +63,8 @@ glm::mat4 Node::getWorldMatrix(const std::vector<Node>& nodes) const {
 }
 
 GLTFLoader::GLTFLoader(VulkanDevice* device) : m_device(device) {
-    createCommandPool();
+    m_transferContext = std::make_unique<CommandContext>(m_device, VulkanDevice::QueueType::Transfer);
+    m_graphicsContext = std::make_unique<CommandContext>(m_device, VulkanDevice::QueueType::Graphics);
     createDefaultTextures();
 }
 
@@ -98,11 +105,10 @@ bool GLTFLoader::loadFromFile(const std::string& filePath) {
     std::cout << "  - " << m_model.textures.size() << " textures" << std::endl;
     std::cout << "  - " << m_model.nodes.size() << " nodes" << std::endl;
     
-    // Process the loaded model
-    m_meshes.clear();
-    m_materials.clear();
-    m_nodes.clear();
-    m_textures.clear();
+    // Process the loaded model; the previous model's GPU resources are released
+    // once in-flight frames are done with them
+    releaseModelResources();
+    beginUploadBatch();
     
     // Load materials
     for (const auto& material : m_model.materials) {
@@ -124,11 +130,18 @@ bool GLTFLoader::loadFromFile(const std::string& filePath) {
         loadNode(m_model, m_model.nodes[i], static_cast<uint32_t>(i));
     }
     
+    // Lights need the node hierarchy for their world transforms
+    loadLights(m_model);
+    
+    buildMaterialDraws();
+    
     // Create Vulkan buffers
     createBuffers();
+    endUploadBatch();
     calculateBounds();
     
     m_loaded = true;
+    m_generation++;
     return true;
 }
 
@@ -231,6 +244,7 @@ void GLTFLoader::loadMesh(const tinygltf::Model& model, const tinygltf::Mesh& me
         }
         
         newPrimitive.materialIndex = primitive.material;
+        newPrimitive.hasVertexColors = colors != nullptr;
         newMesh.primitives.push_back(newPrimitive);
     }
     
@@ -241,6 +255,122 @@ void GLTFLoader::loadMesh(const tinygltf::Model& model, const tinygltf::Mesh& me
     m_meshes.push_back(newMesh);
 }
 
+namespace {
+// Sorted by first index, with touching ranges joined, so whole-model depth
+// passes stay a handful of draws however the materials are split
+std::vector<std::pair<uint32_t, uint32_t>> mergeIndexRanges(std::vector<std::pair<uint32_t, uint32_t>> ranges) {
+    std::sort(ranges.begin(), ranges.end());
+    std::vector<std::pair<uint32_t, uint32_t>> merged;
+    for (const auto& range : ranges) {
+        if (!merged.empty() && merged.back().first + merged.back().second == range.first) {
+            merged.back().second += range.second;
+        } else {
+            merged.push_back(range);
+        }
+    }
+    return merged;
+}
+}
+
+void GLTFLoader::buildMaterialDraws() {
+    auto hasTexture = [this](int index) {
+        return index >= 0 && index < static_cast<int>(m_textures.size());
+    };
+    
+    std::vector<std::pair<uint32_t, uint32_t>> opaqueRanges;
+    std::vector<std::pair<uint32_t, uint32_t>> maskedRanges;
+    std::vector<std::pair<MaterialDraw, DrawObject>> solidDraws;
+    for (const auto& mesh : m_meshes) {
+        for (const auto& primitive : mesh.primitives) {
+            if (primitive.indexCount == 0) {
+                continue;
+            }
+            
+            uint32_t features = 0;
+            int32_t materialIndex = primitive.materialIndex;
+            if (materialIndex >= static_cast<int32_t>(m_materials.size())) {
+                materialIndex = -1;
+            }
+            Material::AlphaMode alphaMode = Material::AlphaMode::Opaque;
+            if (materialIndex >= 0) {
+                const Material& material = m_materials[materialIndex];
+                if (hasTexture(material.normalTextureIndex)) features |= ShaderPermutation::NormalMap;
+                if (hasTexture(material.emissiveTextureIndex)) features |= ShaderPermutation::EmissiveMap;
+                if (hasTexture(material.occlusionTextureIndex)) features |= ShaderPermutation::OcclusionMap;
+                alphaMode = material.alphaMode;
+            }
+            if (primitive.hasVertexColors) {
+                features |= ShaderPermutation::VertexColors;
+            }
+            
+            // Bounding box: the blend sort key and the culling bounds
+            glm::vec3 minPos(std::numeric_limits<float>::max());
+            glm::vec3 maxPos(std::numeric_limits<float>::lowest());
+            for (uint32_t i = 0; i < primitive.indexCount; ++i) {
+                const glm::vec3& position = m_vertices[m_indices[primitive.firstIndex + i]].position;
+                minPos = glm::min(minPos, position);
+                maxPos = glm::max(maxPos, position);
+            }
+            
+            MaterialDraw draw{primitive.firstIndex, primitive.indexCount, materialIndex, features};
+            if (alphaMode == Material::AlphaMode::Blend) {
+                draw.features |= ShaderPermutation::AlphaBlend;
+                m_blendDraws.push_back(draw);
+                m_blendCenters.push_back((minPos + maxPos) * 0.5f);
+                continue;
+            }
+            if (alphaMode == Material::AlphaMode::Mask) {
+                draw.features |= ShaderPermutation::AlphaMask;
+                maskedRanges.emplace_back(draw.firstIndex, draw.indexCount);
+            } else {
+                opaqueRanges.emplace_back(draw.firstIndex, draw.indexCount);
+            }
+            solidDraws.emplace_back(draw, DrawObject{minPos, primitive.firstIndex, maxPos, primitive.indexCount});
+        }
+    }
+    
+    // Opaque before masked (the mask bit sorts above the texture bits), then group by
+    // permutation and material, so pipeline and descriptor binds only happen on a
+    // change; keep index order within a material so runs can merge
+    std::sort(solidDraws.begin(), solidDraws.end(), [](const auto& a, const auto& b) {
+        if (a.first.features != b.first.features) return a.first.features < b.first.features;
+        if (a.first.materialIndex != b.first.materialIndex) return a.first.materialIndex < b.first.materialIndex;
+        return a.first.firstIndex < b.first.firstIndex;
+    });
+    
+    // Objects keep the sorted order, so a merged run's objects stay consecutive
+    for (const auto& [primitiveDraw, object] : solidDraws) {
+        MaterialDraw draw = primitiveDraw;
+        draw.firstObject = static_cast<uint32_t>(m_drawObjects.size());
+        draw.objectCount = 1;
+        m_drawObjects.push_back(object);
+        
+        if (!m_materialDraws.empty()) {
+            MaterialDraw& last = m_materialDraws.back();
+            if (last.features == draw.features && last.materialIndex == draw.materialIndex &&
+                last.firstIndex + last.indexCount == draw.firstIndex) {
+                last.indexCount += draw.indexCount;
+                last.objectCount++;
+                continue;
+            }
+        }
+        m_materialDraws.push_back(draw);
+    }
+    m_maskedDrawBegin = std::find_if(m_materialDraws.begin(), m_materialDraws.end(), [](const MaterialDraw& draw) {
+        return (draw.features & ShaderPermutation::AlphaMask) != 0;
+    }) - m_materialDraws.begin();
+    m_maskedObjectBegin = m_maskedDrawBegin < m_materialDraws.size() ? m_materialDraws[m_maskedDrawBegin].firstObject
+                                                                     : static_cast<uint32_t>(m_drawObjects.size());
+    
+    m_opaqueDepthRanges = mergeIndexRanges(opaqueRanges);
+    opaqueRanges.insert(opaqueRanges.end(), maskedRanges.begin(), maskedRanges.end());
+    m_shadowDepthRanges = mergeIndexRanges(std::move(opaqueRanges));
+    
+    std::cout << "GLTFLoader: " << m_materialDraws.size() << " material draws ("
+              << m_materialDraws.size() - m_maskedDrawBegin << " masked), "
+              << m_blendDraws.size() << " blended" << std::endl;
+}
+
 void GLTFLoader::loadMaterial(const tinygltf::Model& model, const tinygltf::Material& material) {
     Material newMaterial{};
     
@@ -295,13 +425,27 @@ void GLTFLoader::loadMaterial(const tinygltf::Model& model, const tinygltf::Mate
         newMaterial.emissiveTextureIndex = material.additionalValues.find("emissiveTexture")->second.TextureIndex();
     }
     
+    // Occlusion texture
+    if (material.additionalValues.find("occlusionTexture") != material.additionalValues.end()) {
+        newMaterial.occlusionTextureIndex = material.additionalValues.find("occlusionTexture")->second.TextureIndex();
+    }
+    
+    // Alpha mode; anything unrecognised renders opaque, as the spec's default
+    if (material.alphaMode == "MASK") {
+        newMaterial.alphaMode = Material::AlphaMode::Mask;
+        newMaterial.alphaCutoff = static_cast<float>(material.alphaCutoff);
+    } else if (material.alphaMode == "BLEND") {
+        newMaterial.alphaMode = Material::AlphaMode::Blend;
+    }
+    
     m_materials.push_back(newMaterial);
     
     std::cout << "Loaded material with texture indices: "
               << "base=" << newMaterial.baseColorTextureIndex
               << ", normal=" << newMaterial.normalTextureIndex  
               << ", metallic=" << newMaterial.metallicRoughnessTextureIndex
-              << ", emissive=" << newMaterial.emissiveTextureIndex << std::endl;
+              << ", emissive=" << newMaterial.emissiveTextureIndex
+              << ", occlusion=" << newMaterial.occlusionTextureIndex << std::endl;
 }
 
 void GLTFLoader::loadTexture(const tinygltf::Model& model, const tinygltf::Texture& texture) {
@@ -387,6 +531,61 @@ void GLTFLoader::loadNode(const tinygltf::Model& model, const tinygltf::Node& no
     m_nodes.push_back(newNode);
 }
 
+void GLTFLoader::loadLights(const tinygltf::Model& model) {
+    if (model.lights.empty()) {
+        return;
+    }
+    
+    // Walk the default scene from its roots, accumulating parent transforms
+    std::vector<int> roots;
+    if (!model.scenes.empty()) {
+        int sceneIndex = model.defaultScene >= 0 ? model.defaultScene : 0;
+        roots = model.scenes[sceneIndex].nodes;
+    } else {
+        for (size_t i = 0; i < model.nodes.size(); ++i) {
+            roots.push_back(static_cast<int>(i));
+        }
+    }
+    
+    std::function<void(int, const glm::mat4&)> visit = [&](int nodeIndex, const glm::mat4& parentMatrix) {
+        const tinygltf::Node& node = model.nodes[nodeIndex];
+        glm::mat4 world = parentMatrix * m_nodes[nodeIndex].getLocalMatrix();
+        
+        if (node.light >= 0 && node.light < static_cast<int>(model.lights.size())) {
+            const tinygltf::Light& source = model.lights[node.light];
+            
+            PunctualLight light{};
+            if (source.type == "directional") {
+                light.type = PunctualLight::Type::Directional;
+            } else if (source.type == "spot") {
+                light.type = PunctualLight::Type::Spot;
+                light.innerConeAngle = static_cast<float>(source.spot.innerConeAngle);
+                light.outerConeAngle = static_cast<float>(source.spot.outerConeAngle);
+            } else {
+                light.type = PunctualLight::Type::Point;
+            }
+            light.position = glm::vec3(world[3]);
+            light.direction = glm::normalize(glm::vec3(world * glm::vec4(0.0f, 0.0f, -1.0f, 0.0f)));
+            if (source.color.size() == 3) {
+                light.color = glm::vec3(source.color[0], source.color[1], source.color[2]);
+            }
+            light.intensity = static_cast<float>(source.intensity);
+            light.range = static_cast<float>(source.range);
+            m_lights.push_back(light);
+        }
+        
+        for (int child : node.children) {
+            visit(child, world);
+        }
+    };
+    
+    for (int root : roots) {
+        visit(root, glm::mat4(1.0f));
+    }
+    
+    std::cout << "  - " << m_lights.size() << " punctual lights" << std::endl;
+}
+
 void GLTFLoader::createBuffers() {
     std::cout << "Creating buffers for " << m_totalVertices << " vertices" << std::endl;
     
@@ -403,26 +602,23 @@ void GLTFLoader::createBuffers() {
     std::cout << "Total vertices in buffer: " << m_vertices.size() << std::endl;
     std::cout << "Total indices in buffer: " << m_indices.size() << std::endl;
     
-    // Create vertex buffer
-    createBuffer(vertexBufferSize, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
-                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-                m_vertexBuffer, m_vertexBufferMemory);
-    
-    // Copy vertex data
-    void* data;
-    vkMapMemory(m_device->getDevice(), m_vertexBufferMemory, 0, vertexBufferSize, 0, &data);
-    memcpy(data, m_vertices.data(), static_cast<size_t>(vertexBufferSize));
-    vkUnmapMemory(m_device->getDevice(), m_vertexBufferMemory);
-    
-    // Create index buffer
-    createBuffer(indexBufferSize, VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
-                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
-                m_indexBuffer, m_indexBufferMemory);
-    
-    // Copy index data
-    vkMapMemory(m_device->getDevice(), m_indexBufferMemory, 0, indexBufferSize, 0, &data);
-    memcpy(data, m_indices.data(), static_cast<size_t>(indexBufferSize));
-    vkUnmapMemory(m_device->getDevice(), m_indexBufferMemory);
+    // Device-local vertex and index buffers, filled through staging copies
+    uploadBuffer(m_vertices.data(), vertexBufferSize, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+                 VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+                 m_vertexBuffer, m_vertexBufferMemory);
+    uploadBuffer(m_indices.data(), indexBufferSize, VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+                 VK_ACCESS_INDEX_READ_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+                 m_indexBuffer, m_indexBufferMemory);
+    
+    // Separate position stream so the depth prepass fetches 12 instead of 48 bytes per vertex
+    std::vector<glm::vec3> positions;
+    positions.reserve(m_vertices.size());
+    for (const auto& vertex : m_vertices) {
+        positions.push_back(vertex.position);
+    }
+    uploadBuffer(positions.data(), sizeof(glm::vec3) * positions.size(), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+                 VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+                 m_positionBuffer, m_positionBufferMemory);
     
     std::cout << "Buffers created successfully" << std::endl;
 }
@@ -451,11 +647,15 @@ void GLTFLoader::calculateBounds() {
 }
 
 void GLTFLoader::cleanup() {
-    // Cleanup command pool first
-    if (m_commandPool != VK_NULL_HANDLE) {
-        vkDestroyCommandPool(m_device->getDevice(), m_commandPool, nullptr);
-        m_commandPool = VK_NULL_HANDLE;
+    // Command contexts wait for their last submission before releasing their pools
+    m_transferContext.reset();
+    m_graphicsContext.reset();
+    
+    for (auto& staging : m_pendingStaging) {
+        vkDestroyBuffer(m_device->getDevice(), staging.first, nullptr);
+        vkFreeMemory(m_device->getDevice(), staging.second, nullptr);
     }
+    m_pendingStaging.clear();
     
     // Cleanup main vertex and index buffers
     if (m_vertexBuffer != VK_NULL_HANDLE) {
@@ -472,6 +672,13 @@ void GLTFLoader::cleanup() {
         m_indexBufferMemory = VK_NULL_HANDLE;
     }
     
+    if (m_positionBuffer != VK_NULL_HANDLE) {
+        vkDestroyBuffer(m_device->getDevice(), m_positionBuffer, nullptr);
+        vkFreeMemory(m_device->getDevice(), m_positionBufferMemory, nullptr);
+        m_positionBuffer = VK_NULL_HANDLE;
+        m_positionBufferMemory = VK_NULL_HANDLE;
+    }
+    
     // Cleanup Vulkan resources
     for (auto& mesh : m_meshes) {
         if (mesh.vertexBuffer != VK_NULL_HANDLE) {
@@ -532,12 +739,99 @@ void GLTFLoader::cleanup() {
     m_materials.clear();
     m_nodes.clear();
     m_textures.clear();
+    m_lights.clear();
+    m_materialDraws.clear();
+    m_maskedDrawBegin = 0;
+    m_drawObjects.clear();
+    m_maskedObjectBegin = 0;
+    m_blendDraws.clear();
+    m_blendCenters.clear();
+    m_opaqueDepthRanges.clear();
+    m_shadowDepthRanges.clear();
+    m_vertices.clear();
+    m_indices.clear();
+    m_loaded = false;
+}
+
+void GLTFLoader::releaseModelResources() {
+    VkDevice device = m_device->getDevice();
+    std::vector<VkBuffer> buffers;
+    std::vector<VkDeviceMemory> memories;
+    std::vector<Texture> textures = std::move(m_textures);
+    
+    if (m_vertexBuffer != VK_NULL_HANDLE) {
+        buffers.push_back(m_vertexBuffer);
+        memories.push_back(m_vertexBufferMemory);
+    }
+    if (m_indexBuffer != VK_NULL_HANDLE) {
+        buffers.push_back(m_indexBuffer);
+        memories.push_back(m_indexBufferMemory);
+    }
+    if (m_positionBuffer != VK_NULL_HANDLE) {
+        buffers.push_back(m_positionBuffer);
+        memories.push_back(m_positionBufferMemory);
+    }
+    for (const auto& mesh : m_meshes) {
+        if (mesh.vertexBuffer != VK_NULL_HANDLE) {
+            buffers.push_back(mesh.vertexBuffer);
+            memories.push_back(mesh.vertexBufferMemory);
+        }
+        for (const auto& primitive : mesh.primitives) {
+            if (primitive.indexBuffer != VK_NULL_HANDLE) {
+                buffers.push_back(primitive.indexBuffer);
+                memories.push_back(primitive.indexBufferMemory);
+            }
+        }
+    }
+    
+    if (!buffers.empty() || !textures.empty()) {
+        m_device->getDeletionQueue()->push([device, buffers, memories, textures]() {
+            for (auto buffer : buffers) {
+                vkDestroyBuffer(device, buffer, nullptr);
+            }
+            for (auto memory : memories) {
+                vkFreeMemory(device, memory, nullptr);
+            }
+            for (const auto& texture : textures) {
+                if (texture.sampler != VK_NULL_HANDLE) vkDestroySampler(device, texture.sampler, nullptr);
+                if (texture.imageView != VK_NULL_HANDLE) vkDestroyImageView(device, texture.imageView, nullptr);
+                if (texture.image != VK_NULL_HANDLE) vkDestroyImage(device, texture.image, nullptr);
+                if (texture.imageMemory != VK_NULL_HANDLE) vkFreeMemory(device, texture.imageMemory, nullptr);
+                if (texture.stagingBuffer != VK_NULL_HANDLE) vkDestroyBuffer(device, texture.stagingBuffer, nullptr);
+                if (texture.stagingMemory != VK_NULL_HANDLE) vkFreeMemory(device, texture.stagingMemory, nullptr);
+            }
+        });
+    }
+    
+    m_vertexBuffer = VK_NULL_HANDLE;
+    m_vertexBufferMemory = VK_NULL_HANDLE;
+    m_indexBuffer = VK_NULL_HANDLE;
+    m_indexBufferMemory = VK_NULL_HANDLE;
+    m_positionBuffer = VK_NULL_HANDLE;
+    m_positionBufferMemory = VK_NULL_HANDLE;
+    
+    m_meshes.clear();
+    m_materials.clear();
+    m_nodes.clear();
+    m_textures.clear();
+    m_lights.clear();
+    m_materialDraws.clear();
+    m_maskedDrawBegin = 0;
+    m_drawObjects.clear();
+    m_maskedObjectBegin = 0;
+    m_blendDraws.clear();
+    m_blendCenters.clear();
+    m_opaqueDepthRanges.clear();
+    m_shadowDepthRanges.clear();
     m_vertices.clear();
     m_indices.clear();
+    m_totalVertices = 0;
+    m_totalIndices = 0;
     m_loaded = false;
 }
 
-void GLTFLoader::render(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout) {
+void GLTFLoader::render(VkCommandBuffer commandBuffer, const std::function<void(const MaterialDraw&)>& bindMaterial,
+                        VkBuffer indirectBuffer) {
     if (!m_loaded || m_vertices.empty()) {
         return;
     }
@@ -550,8 +844,78 @@ void GLTFLoader::render(VkCommandBuffer commandBuffer, VkPipelineLayout pipeline
     // Bind index buffer
     vkCmdBindIndexBuffer(commandBuffer, m_indexBuffer, 0, VK_INDEX_TYPE_UINT32);
     
-    // Draw indexed
-    vkCmdDrawIndexed(commandBuffer, static_cast<uint32_t>(m_indices.size()), 1, 0, 0, 0);
+    for (const auto& draw : m_materialDraws) {
+        bindMaterial(draw);
+        if (indirectBuffer != VK_NULL_HANDLE) {
+            drawIndirect(commandBuffer, indirectBuffer, draw.firstObject, draw.objectCount);
+        } else {
+            vkCmdDrawIndexed(commandBuffer, draw.indexCount, 1, draw.firstIndex, 0, 0);
+        }
+    }
+}
+
+void GLTFLoader::renderBlended(VkCommandBuffer commandBuffer, const std::vector<uint32_t>& order,
+                               const std::function<void(const MaterialDraw&)>& bindMaterial) {
+    if (!m_loaded || m_blendDraws.empty()) {
+        return;
+    }
+    
+    VkBuffer vertexBuffers[] = {m_vertexBuffer};
+    VkDeviceSize offsets[] = {0};
+    vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);
+    vkCmdBindIndexBuffer(commandBuffer, m_indexBuffer, 0, VK_INDEX_TYPE_UINT32);
+    
+    for (size_t i = 0; i < m_blendDraws.size(); ++i) {
+        const MaterialDraw& draw = m_blendDraws[order.empty() ? i : order[i]];
+        bindMaterial(draw);
+        vkCmdDrawIndexed(commandBuffer, draw.indexCount, 1, draw.firstIndex, 0, 0);
+    }
+}
+
+void GLTFLoader::renderPoints(VkCommandBuffer commandBuffer) {
+    if (!m_loaded || m_vertices.empty()) {
+        return;
+    }
+    
+    VkBuffer vertexBuffers[] = {m_vertexBuffer};
+    VkDeviceSize offsets[] = {0};
+    vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);
+    vkCmdDraw(commandBuffer, static_cast<uint32_t>(m_vertices.size()), 1, 0, 0);
+}
+
+void GLTFLoader::renderDepth(VkCommandBuffer commandBuffer, bool includeMasked, VkBuffer indirectBuffer) {
+    if (!m_loaded || m_positionBuffer == VK_NULL_HANDLE) {
+        return;
+    }
+    
+    // Same index buffer and triangles as render(), so the rasterized depth matches exactly
+    VkDeviceSize offset = 0;
+    vkCmdBindVertexBuffers(commandBuffer, 0, 1, &m_positionBuffer, &offset);
+    vkCmdBindIndexBuffer(commandBuffer, m_indexBuffer, 0, VK_INDEX_TYPE_UINT32);
+    if (indirectBuffer != VK_NULL_HANDLE) {
+        // Opaque objects come first, so either selection is one contiguous range
+        drawIndirect(commandBuffer, indirectBuffer, 0,
+                     includeMasked ? static_cast<uint32_t>(m_drawObjects.size()) : m_maskedObjectBegin);
+        return;
+    }
+    for (const auto& [firstIndex, indexCount] : includeMasked ? m_shadowDepthRanges : m_opaqueDepthRanges) {
+        vkCmdDrawIndexed(commandBuffer, indexCount, 1, firstIndex, 0, 0);
+    }
+}
+
+void GLTFLoader::drawIndirect(VkCommandBuffer commandBuffer, VkBuffer indirectBuffer, uint32_t firstObject,
+                              uint32_t objectCount) {
+    constexpr uint32_t stride = sizeof(VkDrawIndexedIndirectCommand);
+    if (m_device->supportsMultiDrawIndirect()) {
+        if (objectCount > 0) {
+            vkCmdDrawIndexedIndirect(commandBuffer, indirectBuffer, VkDeviceSize{firstObject} * stride, objectCount, stride);
+        }
+        return;
+    }
+    // Culled objects still cost a (zero-instance) draw each without multi-draw
+    for (uint32_t i = 0; i < objectCount; ++i) {
+        vkCmdDrawIndexedIndirect(commandBuffer, indirectBuffer, VkDeviceSize{firstObject + i} * stride, 1, stride);
+    }
 }
 
 void GLTFLoader::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties,
@@ -662,12 +1026,35 @@ void GLTFLoader::createVulkanTexture(Texture& texture, const unsigned char* data
     
     vkBindImageMemory(m_device->getDevice(), texture.image, texture.imageMemory, 0);
     
-    // Transition image layout and copy buffer to image
-    transitionImageLayout(texture.image, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, texture.mipLevels);
-    copyBufferToImage(texture.stagingBuffer, texture.image, width, height);
+    bool ownsBatch = (m_transferCommands == VK_NULL_HANDLE);
+    if (ownsBatch) {
+        beginUploadBatch();
+    }
     
-    // Generate mipmaps
-    generateMipmaps(texture.image, VK_FORMAT_R8G8B8A8_SRGB, width, height, texture.mipLevels);
+    // Transition image layout and copy buffer to image on the transfer queue
+    uint32_t transferFamily = m_transferContext->getQueueFamily();
+    uint32_t graphicsFamily = m_graphicsContext->getQueueFamily();
+    transitionImageLayout(m_transferCommands, texture.image, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, texture.mipLevels);
+    copyBufferToImage(m_transferCommands, texture.stagingBuffer, texture.image, width, height);
+    QueueOwnership::releaseImage(m_transferCommands, texture.image, texture.mipLevels,
+                                 VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                                 transferFamily, graphicsFamily,
+                                 VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+    
+    // Blits need a graphics queue, so the mip chain is built after the acquire
+    QueueOwnership::acquireImage(m_graphicsCommands, texture.image, texture.mipLevels,
+                                 VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                                 transferFamily, graphicsFamily,
+                                 VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+    generateMipmaps(m_graphicsCommands, texture.image, VK_FORMAT_R8G8B8A8_SRGB, width, height, texture.mipLevels);
+    
+    m_pendingStaging.emplace_back(texture.stagingBuffer, texture.stagingMemory);
+    texture.stagingBuffer = VK_NULL_HANDLE;
+    texture.stagingMemory = VK_NULL_HANDLE;
+    
+    if (ownsBatch) {
+        endUploadBatch();
+    }
     
     // Create image view
     VkImageViewCreateInfo viewInfo{};
@@ -712,9 +1099,7 @@ void GLTFLoader::createVulkanTexture(Texture& texture, const unsigned char* data
               << " with " << channels << " channels, " << texture.mipLevels << " mip levels" << std::endl;
 }
 
-void GLTFLoader::transitionImageLayout(VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout, uint32_t mipLevels) {
-    VkCommandBuffer commandBuffer = beginSingleTimeCommands();
-    
+void GLTFLoader::transitionImageLayout(VkCommandBuffer commandBuffer, VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout, uint32_t mipLevels) {
     VkImageMemoryBarrier barrier{};
     barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
     barrier.oldLayout = oldLayout;
@@ -748,13 +1133,9 @@ void GLTFLoader::transitionImageLayout(VkImage image, VkFormat format, VkImageLa
     }
     
     vkCmdPipelineBarrier(commandBuffer, sourceStage, destinationStage, 0, 0, nullptr, 0, nullptr, 1, &barrier);
-    
-    endSingleTimeCommands(commandBuffer);
 }
 
-void GLTFLoader::copyBufferToImage(VkBuffer buffer, VkImage image, uint32_t width, uint32_t height) {
-    VkCommandBuffer commandBuffer = beginSingleTimeCommands();
-    
+void GLTFLoader::copyBufferToImage(VkCommandBuffer commandBuffer, VkBuffer buffer, VkImage image, uint32_t width, uint32_t height) {
     VkBufferImageCopy region{};
     region.bufferOffset = 0;
     region.bufferRowLength = 0;
@@ -767,11 +1148,9 @@ void GLTFLoader::copyBufferToImage(VkBuffer buffer, VkImage image, uint32_t widt
     region.imageExtent = {width, height, 1};
     
     vkCmdCopyBufferToImage(commandBuffer, buffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
-    
-    endSingleTimeCommands(commandBuffer);
 }
 
-void GLTFLoader::generateMipmaps(VkImage image, VkFormat imageFormat, int32_t texWidth, int32_t texHeight, uint32_t mipLevels) {
+void GLTFLoader::generateMipmaps(VkCommandBuffer commandBuffer, VkImage image, VkFormat imageFormat, int32_t texWidth, int32_t texHeight, uint32_t mipLevels) {
     // Check if image format supports linear blitting
     VkFormatProperties formatProperties;
     vkGetPhysicalDeviceFormatProperties(m_device->getPhysicalDevice(), imageFormat, &formatProperties);
@@ -780,8 +1159,6 @@ void GLTFLoader::generateMipmaps(VkImage image, VkFormat imageFormat, int32_t te
         throw std::runtime_error("Texture image format does not support linear blitting!");
     }
     
-    VkCommandBuffer commandBuffer = beginSingleTimeCommands();
-    
     VkImageMemoryBarrier barrier{};
     barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
     barrier.image = image;
@@ -842,41 +1219,64 @@ void GLTFLoader::generateMipmaps(VkImage image, VkFormat imageFormat, int32_t te
     
     vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0,
                        0, nullptr, 0, nullptr, 1, &barrier);
-    
-    endSingleTimeCommands(commandBuffer);
 }
 
-VkCommandBuffer GLTFLoader::beginSingleTimeCommands() {
-    VkCommandBufferAllocateInfo allocInfo{};
-    allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-    allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-    allocInfo.commandPool = m_commandPool;
-    allocInfo.commandBufferCount = 1;
-    
-    VkCommandBuffer commandBuffer;
-    vkAllocateCommandBuffers(m_device->getDevice(), &allocInfo, &commandBuffer);
-    
-    VkCommandBufferBeginInfo beginInfo{};
-    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
-    
-    vkBeginCommandBuffer(commandBuffer, &beginInfo);
-    
-    return commandBuffer;
+void GLTFLoader::beginUploadBatch() {
+    m_transferCommands = m_transferContext->begin();
+    m_graphicsCommands = m_graphicsContext->begin();
 }
 
-void GLTFLoader::endSingleTimeCommands(VkCommandBuffer commandBuffer) {
-    vkEndCommandBuffer(commandBuffer);
+void GLTFLoader::endUploadBatch() {
+    // The graphics half waits on the transfer half; neither blocks the CPU
+    uint64_t transferValue = m_transferContext->submit(m_transferCommands);
+    uint64_t graphicsValue = m_graphicsContext->submit(m_graphicsCommands,
+        {{m_transferContext->getTimeline(), transferValue, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT}});
+    m_transferCommands = VK_NULL_HANDLE;
+    m_graphicsCommands = VK_NULL_HANDLE;
+    
+    // Graphics completion implies the transfer it waited on has completed too
+    if (!m_pendingStaging.empty()) {
+        VkDevice device = m_device->getDevice();
+        auto staging = std::move(m_pendingStaging);
+        m_pendingStaging.clear();
+        m_device->getDeletionQueue()->push(m_graphicsContext->getTimeline(), graphicsValue, [device, staging]() {
+            for (const auto& entry : staging) {
+                vkDestroyBuffer(device, entry.first, nullptr);
+                vkFreeMemory(device, entry.second, nullptr);
+            }
+        });
+    }
+}
+
+void GLTFLoader::uploadBuffer(const void* data, VkDeviceSize size, VkBufferUsageFlags usage,
+                              VkAccessFlags dstAccess, VkPipelineStageFlags dstStage,
+                              VkBuffer& buffer, VkDeviceMemory& bufferMemory) {
+    VkBuffer stagingBuffer;
+    VkDeviceMemory stagingMemory;
+    createBuffer(size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                stagingBuffer, stagingMemory);
+    
+    void* mapped;
+    vkMapMemory(m_device->getDevice(), stagingMemory, 0, size, 0, &mapped);
+    memcpy(mapped, data, static_cast<size_t>(size));
+    vkUnmapMemory(m_device->getDevice(), stagingMemory);
+    
+    createBuffer(size, usage | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+                buffer, bufferMemory);
     
-    VkSubmitInfo submitInfo{};
-    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-    submitInfo.commandBufferCount = 1;
-    submitInfo.pCommandBuffers = &commandBuffer;
+    VkBufferCopy copyRegion{};
+    copyRegion.size = size;
+    vkCmdCopyBuffer(m_transferCommands, stagingBuffer, buffer, 1, &copyRegion);
     
-    vkQueueSubmit(m_device->getGraphicsQueue(), 1, &submitInfo, VK_NULL_HANDLE);
-    vkQueueWaitIdle(m_device->getGraphicsQueue());
+    uint32_t transferFamily = m_transferContext->getQueueFamily();
+    uint32_t graphicsFamily = m_graphicsContext->getQueueFamily();
+    QueueOwnership::releaseBuffer(m_transferCommands, buffer, transferFamily, graphicsFamily,
+                                  VK_ACCESS_TRANSFER_WRITE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT);
+    QueueOwnership::acquireBuffer(m_graphicsCommands, buffer, transferFamily, graphicsFamily,
+                                  dstAccess, dstStage);
     
-    vkFreeCommandBuffers(m_device->getDevice(), m_commandPool, 1, &commandBuffer);
+    m_pendingStaging.emplace_back(stagingBuffer, stagingMemory);
 }
 
 uint32_t GLTFLoader::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) {
@@ -925,16 +1325,3 @@ void GLTFLoader::createDefaultTextures() {
     
     std::cout << "Created default PBR textures" << std::endl;
 }
-
-void GLTFLoader::createCommandPool() {
-    VulkanDevice::QueueFamilyIndices queueFamilyIndices = m_device->findQueueFamilies(m_device->getPhysicalDevice());
-    
-    VkCommandPoolCreateInfo poolInfo{};
-    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
-    poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
-    poolInfo.queueFamilyIndex = queueFamilyIndices.graphicsFamily.value();
-    
-    if (vkCreateCommandPool(m_device->getDevice(), &poolInfo, nullptr, &m_commandPool) != VK_SUCCESS) {
-        throw std::runtime_error("Failed to create command pool!");
-    }
-}
\ No newline at end of file
@@ -1,5 +1,10 @@
 #include "viewer/GLTFViewer.h"
 #include "rendering/UniformBuffer.h"
+#include "rendering/GraphicsPipeline.h"
+#include "rendering/ShaderPermutation.h"
+#include "rendering/ClusteredLighting.h"
+#include "rendering/ImageBasedLighting.h"
+#include "core/DeletionQueue.h"
 #include <iostream>
 #include <stdexcept>
 #include <cstring>
@@ -46,8 +51,8 @@ void GLTFViewer::loadModel(const std::string& filePath) {
         // Adjust camera to fit the model
         m_camera->lookAt(m_modelCenter, m_modelRadius);
         
-        // Update texture descriptors with the loaded model's textures
-        updateTextureDescriptors();
+        // One descriptor set per material with that material's textures
+        createMaterialDescriptors();
         
         std::cout << "Model loaded successfully!" << std::endl;
         std::cout << "  - Vertices: " << m_loader->getVertexCount() << std::endl;
@@ -105,14 +110,6 @@ void GLTFViewer::cleanup() {
         vkDestroyDescriptorSetLayout(m_device->getDevice(), m_descriptorLayout, nullptr);
     }
     
-    if (m_solidPipeline != VK_NULL_HANDLE) {
-        vkDestroyPipeline(m_device->getDevice(), m_solidPipeline, nullptr);
-    }
-    
-    if (m_wireframePipeline != VK_NULL_HANDLE) {
-        vkDestroyPipeline(m_device->getDevice(), m_wireframePipeline, nullptr);
-    }
-    
     if (m_pipelineLayout != VK_NULL_HANDLE) {
         vkDestroyPipelineLayout(m_device->getDevice(), m_pipelineLayout, nullptr);
     }
@@ -171,6 +168,10 @@ void GLTFViewer::onKey(int key, int scancode, int action, int mods) {
                 std::cout << "Switched to PBR mode" << std::endl;
                 break;
             case 50: // 2 key - Wireframe mode
+                if (!m_device->supportsGeometryShader()) {
+                    std::cout << "Wireframe mode needs geometry shaders, which this device lacks" << std::endl;
+                    break;
+                }
                 m_settings.renderMode = 1;
                 std::cout << "Switched to wireframe mode" << std::endl;
                 break;
@@ -188,6 +189,10 @@ void GLTFViewer::onKey(int key, int scancode, int action, int mods) {
                 std::cout << "Auto rotate " << (m_settings.enableAutoRotate ? "enabled" : "disabled") << std::endl;
                 break;
             case 87: // W key - Toggle wireframe overlay
+                if (!m_device->supportsGeometryShader()) {
+                    std::cout << "Wireframe overlay needs geometry shaders, which this device lacks" << std::endl;
+                    break;
+                }
                 m_settings.showWireframe = !m_settings.showWireframe;
                 std::cout << "Wireframe overlay " << (m_settings.showWireframe ? "enabled" : "disabled") << std::endl;
                 break;
@@ -310,54 +315,8 @@ void GLTFViewer::createUniformBuffer() {
     
     vkBindBufferMemory(m_device->getDevice(), m_uniformBuffer, m_uniformMemory, 0);
     
-    // Create descriptor pool
-    std::array<VkDescriptorPoolSize, 2> poolSizes{};
-    poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-    poolSizes[0].descriptorCount = 1;
-    poolSizes[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-    poolSizes[1].descriptorCount = 5; // 5 texture samplers
-    
-    VkDescriptorPoolCreateInfo poolInfo{};
-    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-    poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
-    poolInfo.pPoolSizes = poolSizes.data();
-    poolInfo.maxSets = 1;
-    
-    if (vkCreateDescriptorPool(m_device->getDevice(), &poolInfo, nullptr, &m_descriptorPool) != VK_SUCCESS) {
-        throw std::runtime_error("Failed to create descriptor pool!");
-    }
-    
-    // Create descriptor set
-    VkDescriptorSetAllocateInfo allocInfo2{};
-    allocInfo2.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-    allocInfo2.descriptorPool = m_descriptorPool;
-    allocInfo2.descriptorSetCount = 1;
-    allocInfo2.pSetLayouts = &m_descriptorLayout;
-    
-    if (vkAllocateDescriptorSets(m_device->getDevice(), &allocInfo2, &m_descriptorSet) != VK_SUCCESS) {
-        throw std::runtime_error("Failed to allocate descriptor set!");
-    }
-    
-    // Update descriptor set - we'll do this when model is loaded to bind actual textures
-    VkDescriptorBufferInfo bufferInfo2{};
-    bufferInfo2.buffer = m_uniformBuffer;
-    bufferInfo2.offset = 0;
-    bufferInfo2.range = sizeof(UniformBufferObject);
-    
-    VkWriteDescriptorSet descriptorWrite{};
-    descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-    descriptorWrite.dstSet = m_descriptorSet;
-    descriptorWrite.dstBinding = 0;
-    descriptorWrite.dstArrayElement = 0;
-    descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-    descriptorWrite.descriptorCount = 1;
-    descriptorWrite.pBufferInfo = &bufferInfo2;
-    
-    // Initial uniform buffer binding
-    vkUpdateDescriptorSets(m_device->getDevice(), 1, &descriptorWrite, 0, nullptr);
-    
-    // Update texture bindings with default textures initially
-    updateTextureDescriptors();
+    // Descriptor sets start with default textures until a model is loaded
+    createMaterialDescriptors();
 }
 
 void GLTFViewer::updateUniformBuffers() {
@@ -414,87 +373,101 @@ void GLTFViewer::updateUniformBuffers() {
     vkUnmapMemory(m_device->getDevice(), m_uniformMemory);
 }
 
-void GLTFViewer::updateTextureDescriptors() {
-    if (!m_loader) return;
+void GLTFViewer::createMaterialDescriptors() {
+    if (!m_loader || m_uniformBuffer == VK_NULL_HANDLE) return;
     
-    // Get model textures and materials
     const auto& textures = m_loader->getTextures();
     const auto& materials = m_loader->getMaterials();
+    uint32_t setCount = static_cast<uint32_t>(materials.size()) + 1;
     
-    // Select textures to use - try to use from first material if available, otherwise use defaults
-    const Texture* albedoTexture = &m_loader->getDefaultAlbedoTexture();
-    const Texture* normalTexture = &m_loader->getDefaultNormalTexture();
-    const Texture* metallicRoughnessTexture = &m_loader->getDefaultMetallicRoughnessTexture();
-    const Texture* emissiveTexture = &m_loader->getDefaultEmissiveTexture();
-    const Texture* aoTexture = &m_loader->getDefaultAOTexture();
-    
-    // If we have materials and textures, use them
-    if (!materials.empty() && !textures.empty()) {
-        const Material& material = materials[0]; // Use first material
-        
-        // Use actual model textures if they exist
-        if (material.baseColorTextureIndex >= 0 && material.baseColorTextureIndex < static_cast<int>(textures.size())) {
-            albedoTexture = &textures[material.baseColorTextureIndex];
-        }
-        if (material.normalTextureIndex >= 0 && material.normalTextureIndex < static_cast<int>(textures.size())) {
-            normalTexture = &textures[material.normalTextureIndex];
-        }
-        if (material.metallicRoughnessTextureIndex >= 0 && material.metallicRoughnessTextureIndex < static_cast<int>(textures.size())) {
-            metallicRoughnessTexture = &textures[material.metallicRoughnessTextureIndex];
-        }
-        if (material.emissiveTextureIndex >= 0 && material.emissiveTextureIndex < static_cast<int>(textures.size())) {
-            emissiveTexture = &textures[material.emissiveTextureIndex];
-        }
+    // Frames in flight may still use the old sets, so the pool is replaced rather than reset
+    if (m_descriptorPool != VK_NULL_HANDLE) {
+        VkDevice device = m_device->getDevice();
+        VkDescriptorPool oldPool = m_descriptorPool;
+        m_device->getDeletionQueue()->push([device, oldPool]() {
+            vkDestroyDescriptorPool(device, oldPool, nullptr);
+        });
+        m_descriptorPool = VK_NULL_HANDLE;
     }
     
-    // Create descriptor image infos
-    std::array<VkDescriptorImageInfo, 5> imageInfos{};
-    
-    // Albedo texture
-    imageInfos[0].imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-    imageInfos[0].imageView = albedoTexture->imageView;
-    imageInfos[0].sampler = albedoTexture->sampler;
-    
-    // Normal texture
-    imageInfos[1].imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-    imageInfos[1].imageView = normalTexture->imageView;
-    imageInfos[1].sampler = normalTexture->sampler;
-    
-    // Metallic/Roughness texture
-    imageInfos[2].imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-    imageInfos[2].imageView = metallicRoughnessTexture->imageView;
-    imageInfos[2].sampler = metallicRoughnessTexture->sampler;
-    
-    // Emissive texture
-    imageInfos[3].imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-    imageInfos[3].imageView = emissiveTexture->imageView;
-    imageInfos[3].sampler = emissiveTexture->sampler;
-    
-    // AO texture
-    imageInfos[4].imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-    imageInfos[4].imageView = aoTexture->imageView;
-    imageInfos[4].sampler = aoTexture->sampler;
-    
-    // Create write descriptor sets
-    std::array<VkWriteDescriptorSet, 5> descriptorWrites{};
-    
-    for (size_t i = 0; i < 5; ++i) {
-        descriptorWrites[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-        descriptorWrites[i].dstSet = m_descriptorSet;
-        descriptorWrites[i].dstBinding = static_cast<uint32_t>(i + 1); // Bindings 1-5
-        descriptorWrites[i].dstArrayElement = 0;
-        descriptorWrites[i].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-        descriptorWrites[i].descriptorCount = 1;
-        descriptorWrites[i].pImageInfo = &imageInfos[i];
+    std::array<VkDescriptorPoolSize, 2> poolSizes{};
+    poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    poolSizes[0].descriptorCount = setCount;
+    poolSizes[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    poolSizes[1].descriptorCount = setCount * 5; // 5 texture samplers per set
+    
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+    poolInfo.pPoolSizes = poolSizes.data();
+    poolInfo.maxSets = setCount;
+    
+    if (vkCreateDescriptorPool(m_device->getDevice(), &poolInfo, nullptr, &m_descriptorPool) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to create descriptor pool!");
     }
     
-    vkUpdateDescriptorSets(m_device->getDevice(), static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+    std::vector<VkDescriptorSetLayout> layouts(setCount, m_descriptorLayout);
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = m_descriptorPool;
+    allocInfo.descriptorSetCount = setCount;
+    allocInfo.pSetLayouts = layouts.data();
     
-    if (!materials.empty() && !textures.empty()) {
-        std::cout << "Updated texture descriptors with model textures" << std::endl;
-    } else {
-        std::cout << "Updated texture descriptors with default textures" << std::endl;
+    m_materialDescriptorSets.resize(setCount);
+    if (vkAllocateDescriptorSets(m_device->getDevice(), &allocInfo, m_materialDescriptorSets.data()) != VK_SUCCESS) {
+        throw std::runtime_error("Failed to allocate descriptor sets!");
     }
+    m_descriptorSet = m_materialDescriptorSets[0];
+    
+    auto pick = [&textures](int index, const Texture& fallback) -> const Texture& {
+        return index >= 0 && index < static_cast<int>(textures.size()) ? textures[index] : fallback;
+    };
+    
+    VkDescriptorBufferInfo bufferInfo{};
+    bufferInfo.buffer = m_uniformBuffer;
+    bufferInfo.offset = 0;
+    bufferInfo.range = sizeof(UniformBufferObject);
+    
+    for (uint32_t set = 0; set < setCount; ++set) {
+        // Set 0 has no material, so every slot takes the default texture
+        Material defaults{};
+        const Material& material = set == 0 ? defaults : materials[set - 1];
+        const Texture* setTextures[5] = {
+            &pick(material.baseColorTextureIndex, m_loader->getDefaultAlbedoTexture()),
+            &pick(material.normalTextureIndex, m_loader->getDefaultNormalTexture()),
+            &pick(material.metallicRoughnessTextureIndex, m_loader->getDefaultMetallicRoughnessTexture()),
+            &pick(material.emissiveTextureIndex, m_loader->getDefaultEmissiveTexture()),
+            &pick(material.occlusionTextureIndex, m_loader->getDefaultAOTexture()),
+        };
+        
+        std::array<VkDescriptorImageInfo, 5> imageInfos{};
+        std::array<VkWriteDescriptorSet, 6> descriptorWrites{};
+        
+        descriptorWrites[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        descriptorWrites[0].dstSet = m_materialDescriptorSets[set];
+        descriptorWrites[0].dstBinding = 0;
+        descriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+        descriptorWrites[0].descriptorCount = 1;
+        descriptorWrites[0].pBufferInfo = &bufferInfo;
+        
+        for (size_t i = 0; i < 5; ++i) {
+            imageInfos[i].imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+            imageInfos[i].imageView = setTextures[i]->imageView;
+            imageInfos[i].sampler = setTextures[i]->sampler;
+            
+            descriptorWrites[i + 1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            descriptorWrites[i + 1].dstSet = m_materialDescriptorSets[set];
+            descriptorWrites[i + 1].dstBinding = static_cast<uint32_t>(i + 1); // Bindings 1-5
+            descriptorWrites[i + 1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+            descriptorWrites[i + 1].descriptorCount = 1;
+            descriptorWrites[i + 1].pImageInfo = &imageInfos[i];
+        }
+        
+        vkUpdateDescriptorSets(m_device->getDevice(), static_cast<uint32_t>(descriptorWrites.size()),
+                               descriptorWrites.data(), 0, nullptr);
+    }
+    
+    std::cout << "Created descriptor sets for " << materials.size() << " materials" << std::endl;
 }
 
 void GLTFViewer::renderModel() {
@@ -508,11 +481,100 @@ void GLTFViewer::renderModel() {
     // The actual rendering commands will be recorded in the command buffer
 }
 
-void GLTFViewer::renderToCommandBuffer(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout) {
+void GLTFViewer::bindMaterialDraw(VkCommandBuffer commandBuffer, GraphicsPipeline* pipeline, const MaterialDraw& draw,
+                                  uint32_t features, bool depthPrepass, MaterialBindState& state) {
+    if (!m_settings.useVertexColors) {
+        features &= ~static_cast<uint32_t>(ShaderPermutation::VertexColors);
+    }
+    // The overlay toggle is the wireframe variant, which shades exactly like PBR underneath
+    int renderMode = m_settings.renderMode;
+    if (m_settings.showWireframe && renderMode == 0) {
+        renderMode = ShaderPermutation::WIREFRAME_MODE;
+    }
+    VkPipeline variant = pipeline->getShadingPipeline(ShaderPermutation::make(features, renderMode), depthPrepass);
+    if (variant != state.pipeline) {
+        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, variant);
+        state.pipeline = variant;
+    }
+    if (draw.materialIndex != state.materialIndex) {
+        // Variants share one layout, so sets 1-3 and the other push constants stay bound
+        VkDescriptorSet descriptorSet = m_materialDescriptorSets[draw.materialIndex + 1];
+        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline->getPipelineLayout(),
+                                0, 1, &descriptorSet, 0, nullptr);
+        
+        MaterialParams params{glm::vec4(1.0f), glm::vec4(0.5f, 0.0f, 0.0f, 0.0f)};
+        if (draw.materialIndex >= 0) {
+            const Material& material = m_loader->getMaterials()[draw.materialIndex];
+            params.baseColorFactor = material.baseColorFactor;
+            params.alphaParams.x = material.alphaCutoff;
+        }
+        vkCmdPushConstants(commandBuffer, pipeline->getPipelineLayout(), VK_SHADER_STAGE_FRAGMENT_BIT,
+                           sizeof(ClusteredLighting::ClusterParams) + sizeof(ImageBasedLighting::ShadingParams),
+                           sizeof(MaterialParams), &params);
+        state.materialIndex = draw.materialIndex;
+    }
+}
+
+void GLTFViewer::renderToCommandBuffer(VkCommandBuffer commandBuffer, GraphicsPipeline* pipeline, bool depthPrepass,
+                                       VkBuffer indirectBuffer) {
     if (!m_modelLoaded || !m_loader) return;
     
-    // Let the GLTFLoader render to the command buffer
-    m_loader->render(commandBuffer, pipelineLayout);
+    // Draws arrive sorted by permutation then material, so each bind happens once per run
+    MaterialBindState state;
+    m_loader->render(commandBuffer, [&](const MaterialDraw& draw) {
+        bool masked = (draw.features & ShaderPermutation::AlphaMask) != 0;
+        bindMaterialDraw(commandBuffer, pipeline, draw, draw.features, depthPrepass && !masked, state);
+    }, indirectBuffer);
+}
+
+void GLTFViewer::renderTransparentToCommandBuffer(VkCommandBuffer commandBuffer, GraphicsPipeline* pipeline,
+                                                  bool weightedOIT) {
+    if (!m_modelLoaded || !m_loader || m_loader->getBlendDraws().empty()) return;
+    
+    // Sorted draws change material far more often than opaque runs; the bind
+    // state still skips rebinding between neighbours that share one
+    MaterialBindState state;
+    // OIT is order-independent; an order from before a model change is stale
+    const std::vector<uint32_t>& sorted = m_transparencySorter.getOrder();
+    bool useSorted = !weightedOIT && sorted.size() == m_loader->getBlendDraws().size();
+    m_loader->renderBlended(commandBuffer, useSorted ? sorted : std::vector<uint32_t>{}, [&](const MaterialDraw& draw) {
+        uint32_t features = draw.features;
+        if (weightedOIT) {
+            features = (features & ~static_cast<uint32_t>(ShaderPermutation::AlphaBlend)) | ShaderPermutation::WeightedOIT;
+        }
+        bindMaterialDraw(commandBuffer, pipeline, draw, features, false, state);
+    });
+}
+
+void GLTFViewer::renderDepthToCommandBuffer(VkCommandBuffer commandBuffer, bool includeMasked, VkBuffer indirectBuffer) {
+    if (!m_modelLoaded || !m_loader) return;
+    
+    m_loader->renderDepth(commandBuffer, includeMasked, indirectBuffer);
+}
+
+void GLTFViewer::renderPointsToCommandBuffer(VkCommandBuffer commandBuffer, GraphicsPipeline* pipeline,
+                                             float viewportHeight) {
+    if (!m_modelLoaded || !m_loader) return;
+    
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline->getPointsPipeline());
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline->getPointsPipelineLayout(),
+                            0, 1, &m_descriptorSet, 0, nullptr);
+    
+    GraphicsPipeline::PointParams params{};
+    params.worldSize = m_settings.pointSize * m_modelRadius;
+    params.viewportHeight = viewportHeight;
+    params.minSize = 1.0f;
+    params.maxSize = m_device->getMaxPointSize();
+    vkCmdPushConstants(commandBuffer, pipeline->getPointsPipelineLayout(), VK_SHADER_STAGE_VERTEX_BIT,
+                       0, sizeof(params), &params);
+    m_loader->renderPoints(commandBuffer);
+}
+
+void GLTFViewer::sortTransparentDraws() {
+    if (!m_modelLoaded || !m_loader || m_loader->getBlendDraws().empty()) return;
+    
+    // The model matrix is identity, so model-space centers are world-space
+    m_transparencySorter.sort(m_loader->getBlendCenters(), m_camera->getViewMatrix());
 }
 
 void GLTFViewer::renderGizmo() {
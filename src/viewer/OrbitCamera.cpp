@@ -67,8 +67,14 @@ glm::mat4 OrbitCamera::getViewMatrix() const {
     return glm::lookAt(position, m_target, getUp());
 }
 
-glm::mat4 OrbitCamera::getProjectionMatrix(float aspectRatio) const {
-    return glm::perspective(glm::radians(m_fov), aspectRatio, m_near, m_far);
+glm::mat4 OrbitCamera::getProjectionMatrix(float aspectRatio, bool jittered) const {
+    glm::mat4 projection = glm::perspective(glm::radians(m_fov), aspectRatio, m_near, m_far);
+    if (jittered) {
+        // clip.w is -z_view, so subtracting here moves NDC by +jitter
+        projection[2][0] -= m_jitter.x;
+        projection[2][1] -= m_jitter.y;
+    }
+    return projection;
 }
 
 glm::vec3 OrbitCamera::getPosition() const {
@@ -0,0 +1,120 @@
+#include "ecs/ECSManager.h"
+#include "ecs/Systems.h"
+#include <algorithm>
+#include <iostream>
+#include <memory>
+
+// Entity generation is deterministic: the noise table is built from a fixed
+// hash and the terrain uses its default parameters. The expected counts were
+// recorded from the generator as it was before the spatial grid, which placed
+// every valid candidate without any overlap check.
+namespace {
+struct Expected {
+    glm::vec3 cameraPos;
+    size_t trees;
+    size_t rocks;
+    size_t houses;
+};
+
+constexpr float RADIUS = 200.0f;
+
+const Expected BASELINE[] = {
+    {glm::vec3(0.0f), 117, 3, 25},
+    {glm::vec3(137.0f, 0.0f, -58.0f), 124, 3, 36},
+};
+
+struct World {
+    ECSManager ecs;
+    std::shared_ptr<EntityGenerationSystem> generator;
+
+    World() {
+        ecs.registerComponent<TransformComponent>();
+        ecs.registerComponent<RenderComponent>();
+        ecs.registerComponent<LODComponent>();
+        ecs.registerComponent<TreeComponent>();
+        ecs.registerComponent<RockComponent>();
+        ecs.registerComponent<HouseComponent>();
+
+        generator = ecs.registerSystem<EntityGenerationSystem>();
+        ecs.setSystemSignature<EntityGenerationSystem>(
+            ecs.getComponentMask<TransformComponent, RenderComponent, LODComponent>());
+    }
+
+    void count(size_t& trees, size_t& rocks, size_t& houses) {
+        trees = rocks = houses = 0;
+        ecs.forEach<RenderComponent>([&](EntityID, RenderComponent& render) {
+            switch (render.type) {
+                case RenderComponent::EntityType::TREE: trees++; break;
+                case RenderComponent::EntityType::ROCK: rocks++; break;
+                case RenderComponent::EntityType::HOUSE: houses++; break;
+            }
+        });
+    }
+};
+
+bool checkBaselineCounts() {
+    bool passed = true;
+    for (const Expected& expected : BASELINE) {
+        World world;
+        world.generator->generateEntitiesAroundCamera(&world.ecs, expected.cameraPos, RADIUS);
+
+        size_t trees, rocks, houses;
+        world.count(trees, rocks, houses);
+        if (trees != expected.trees || rocks != expected.rocks || houses != expected.houses) {
+            std::cout << "EntityGenerationTest: spawn counts at (" << expected.cameraPos.x << ", "
+                      << expected.cameraPos.z << ") are " << trees << "/" << rocks << "/" << houses
+                      << " trees/rocks/houses, expected " << expected.trees << "/" << expected.rocks << "/"
+                      << expected.houses << std::endl;
+            passed = false;
+        }
+    }
+    return passed;
+}
+
+// A second pass over ground the first already covered places nothing on top
+// of what the first left there
+bool checkRegenerationAvoidsOverlap() {
+    struct Placed {
+        glm::vec3 position;
+        float radius;
+    };
+    std::vector<Placed> passes[2];
+    const glm::vec3 cameraPositions[2] = {glm::vec3(0.0f), glm::vec3(RADIUS * 0.6f, 0.0f, 0.0f)};
+
+    World world;
+    std::vector<EntityID> seen;
+    for (int pass = 0; pass < 2; pass++) {
+        world.generator->generateEntitiesAroundCamera(&world.ecs, cameraPositions[pass], RADIUS);
+        world.ecs.forEach<TransformComponent, RenderComponent>(
+            [&](EntityID entity, TransformComponent& transform, RenderComponent& render) {
+                if (std::find(seen.begin(), seen.end(), entity) != seen.end()) return;
+                seen.push_back(entity);
+                passes[pass].push_back({transform.position, render.boundingRadius});
+            });
+    }
+
+    if (passes[1].empty()) {
+        std::cout << "EntityGenerationTest: the second pass spawned nothing" << std::endl;
+        return false;
+    }
+    for (const Placed& later : passes[1]) {
+        for (const Placed& earlier : passes[0]) {
+            float reach = later.radius + earlier.radius;
+            glm::vec3 offset = later.position - earlier.position;
+            if (glm::dot(offset, offset) < reach * reach) {
+                std::cout << "EntityGenerationTest: regeneration spawned over an existing entity at ("
+                          << later.position.x << ", " << later.position.z << ")" << std::endl;
+                return false;
+            }
+        }
+    }
+    return true;
+}
+}
+
+int main() {
+    bool passed = checkBaselineCounts();
+    passed = checkRegenerationAvoidsOverlap() && passed;
+    std::cout << "EntityGenerationTest: " << (passed ? "passed" : "FAILED") << std::endl;
+    return passed ? 0 : 1;
+}
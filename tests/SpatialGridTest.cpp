@@ -0,0 +1,350 @@
+#include "ecs/SpatialGrid.h"
+#include "ecs/Entity.h"
+#include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+// SpatialGrid against a brute-force list of the same spheres. A fixed random
+// sequence of inserts, moves and removals, with stale IDs reusing an index and
+// items crossing cell borders, is checked every few operations: every query
+// must return exactly what scanning the list does, and the grid must hold the
+// same items in the same number of cells. A scripted part then empties cells
+// one item at a time, so swap-removal and cell recycling are covered by name.
+namespace {
+constexpr float CELL_SIZE = 16.0f;
+constexpr float WORLD_EXTENT = 200.0f;  // Positions in [-extent, extent] on XZ
+constexpr uint32_t INDEX_COUNT = 256;   // Few enough that indices are reused often
+constexpr uint32_t OPERATIONS = 20000;
+constexpr uint32_t CHECK_INTERVAL = 50;
+constexpr uint32_t QUERIES_PER_CHECK = 8;
+
+struct Sphere {
+    uint32_t id;
+    glm::vec3 position;
+    float radius;
+};
+
+class Random {
+public:
+    uint32_t next() {
+        m_state = m_state * 1664525u + 1013904223u;
+        return m_state >> 8;
+    }
+    float unit() { return static_cast<float>(next()) * (1.0f / 16777216.0f); }
+    float range(float low, float high) { return low + (high - low) * unit(); }
+    uint32_t below(uint32_t count) { return next() % count; }
+
+private:
+    uint32_t m_state{12345u};
+};
+
+// What the grid should hold, keyed like it by entity index
+class Reference {
+public:
+    // Same contract as SpatialGrid::insert and update: a different ID on the
+    // same index replaces the one there
+    void insert(uint32_t id, const glm::vec3& position, float radius) {
+        m_items[entityIndex(id)] = {id, position, radius};
+    }
+    void remove(uint32_t id) {
+        auto it = m_items.find(entityIndex(id));
+        if (it != m_items.end() && it->second.id == id) {
+            m_items.erase(it);
+        }
+    }
+    const std::map<uint32_t, Sphere>& items() const { return m_items; }
+
+    size_t cellCount() const {
+        std::set<std::pair<int32_t, int32_t>> cells;
+        for (const auto& entry : m_items) {
+            const glm::vec3& p = entry.second.position;
+            cells.insert({static_cast<int32_t>(std::floor(p.x / CELL_SIZE)),
+                          static_cast<int32_t>(std::floor(p.z / CELL_SIZE))});
+        }
+        return cells.size();
+    }
+
+private:
+    std::map<uint32_t, Sphere> m_items;
+};
+
+float distanceSquared(const glm::vec3& a, const glm::vec3& b) {
+    glm::vec3 offset = a - b;
+    return glm::dot(offset, offset);
+}
+
+// Same expressions as the grid, so equality cases round the same way
+std::vector<uint32_t> bruteRadius(const Reference& reference, const glm::vec3& center, float radius) {
+    std::vector<uint32_t> results;
+    for (const auto& entry : reference.items()) {
+        const Sphere& sphere = entry.second;
+        float reach = radius + sphere.radius;
+        if (distanceSquared(sphere.position, center) <= reach * reach) {
+            results.push_back(sphere.id);
+        }
+    }
+    return results;
+}
+
+std::vector<uint32_t> bruteOutsideRadius(const Reference& reference, const glm::vec3& center, float radius) {
+    std::vector<uint32_t> results;
+    for (const auto& entry : reference.items()) {
+        if (distanceSquared(entry.second.position, center) > radius * radius) {
+            results.push_back(entry.second.id);
+        }
+    }
+    return results;
+}
+
+std::vector<uint32_t> bruteFrustum(const Reference& reference, const FrustumCuller& culler, const glm::vec3& center,
+                                   float radius) {
+    std::vector<uint32_t> results;
+    for (uint32_t id : bruteRadius(reference, center, radius)) {
+        const Sphere& sphere = reference.items().at(entityIndex(id));
+        if (culler.isVisible(sphere.position, sphere.radius)) {
+            results.push_back(id);
+        }
+    }
+    return results;
+}
+
+template<typename Predicate>
+bool bruteAnyWithin(const Reference& reference, const glm::vec3& center, float radius, Predicate accept) {
+    for (const auto& entry : reference.items()) {
+        const Sphere& sphere = entry.second;
+        float reach = radius + sphere.radius;
+        if (distanceSquared(sphere.position, center) < reach * reach && accept(sphere.id)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool sameItems(std::vector<uint32_t> actual, std::vector<uint32_t> expected, const std::string& what) {
+    std::sort(actual.begin(), actual.end());
+    std::sort(expected.begin(), expected.end());
+    if (std::adjacent_find(actual.begin(), actual.end()) != actual.end()) {
+        std::cout << "SpatialGridTest: " << what << " returned an item twice" << std::endl;
+        return false;
+    }
+    if (actual != expected) {
+        std::vector<uint32_t> missing;
+        std::vector<uint32_t> extra;
+        std::set_difference(expected.begin(), expected.end(), actual.begin(), actual.end(),
+                            std::back_inserter(missing));
+        std::set_difference(actual.begin(), actual.end(), expected.begin(), expected.end(),
+                            std::back_inserter(extra));
+        std::cout << "SpatialGridTest: " << what << " returned " << actual.size() << " items, expected "
+                  << expected.size() << " (" << missing.size() << " missing, " << extra.size() << " extra)"
+                  << std::endl;
+        return false;
+    }
+    return true;
+}
+
+glm::vec3 randomPosition(Random& random) {
+    return glm::vec3(random.range(-WORLD_EXTENT, WORLD_EXTENT), random.range(-20.0f, 20.0f),
+                     random.range(-WORLD_EXTENT, WORLD_EXTENT));
+}
+
+// Mostly small spheres, with the odd large one that overhangs several cells
+float randomRadius(Random& random) {
+    return random.below(20) == 0 ? random.range(10.0f, 40.0f) : random.range(0.0f, 4.0f);
+}
+
+bool checkState(const SpatialGrid& grid, const Reference& reference, Random& random, const std::string& where) {
+    bool passed = true;
+    if (grid.size() != reference.items().size()) {
+        std::cout << "SpatialGridTest: " << where << ": size " << grid.size() << ", expected "
+                  << reference.items().size() << std::endl;
+        passed = false;
+    }
+    // Emptied cells must leave the index, or queries and memory grow with every cell ever used
+    if (grid.getCellCount() != reference.cellCount()) {
+        std::cout << "SpatialGridTest: " << where << ": " << grid.getCellCount() << " cells, expected "
+                  << reference.cellCount() << std::endl;
+        passed = false;
+    }
+    for (const auto& entry : reference.items()) {
+        if (!grid.contains(entry.second.id)) {
+            std::cout << "SpatialGridTest: " << where << ": item " << entry.second.id << " missing" << std::endl;
+            passed = false;
+        }
+    }
+
+    for (uint32_t i = 0; i < QUERIES_PER_CHECK && passed; i++) {
+        glm::vec3 center = randomPosition(random);
+        // From a point query up to one wider than the world, which walks the cells instead
+        float radius = random.below(8) == 0 ? random.range(WORLD_EXTENT, 3.0f * WORLD_EXTENT)
+                                            : random.range(0.0f, 60.0f);
+
+        std::vector<uint32_t> results;
+        grid.queryRadius(center, radius, results);
+        passed = sameItems(results, bruteRadius(reference, center, radius), where + ": queryRadius") && passed;
+
+        results.clear();
+        grid.queryOutsideRadius(center, radius, results);
+        passed = sameItems(results, bruteOutsideRadius(reference, center, radius), where + ": queryOutsideRadius") &&
+                 passed;
+
+        auto all = [](uint32_t) { return true; };
+        auto evenIndex = [](uint32_t id) { return entityIndex(id) % 2 == 0; };
+        if (grid.anyWithin(center, radius) != bruteAnyWithin(reference, center, radius, all) ||
+            grid.anyWithin(center, radius, evenIndex) != bruteAnyWithin(reference, center, radius, evenIndex)) {
+            std::cout << "SpatialGridTest: " << where << ": anyWithin disagrees" << std::endl;
+            passed = false;
+        }
+
+        // A camera somewhere over the world looking across it
+        glm::vec3 eye = randomPosition(random) + glm::vec3(0.0f, 30.0f, 0.0f);
+        glm::vec3 target = randomPosition(random);
+        FrustumCuller culler;
+        culler.updateFrustum(glm::lookAt(eye, target, glm::vec3(0.0f, 1.0f, 0.0f)),
+                             glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.5f, 300.0f));
+        results.clear();
+        grid.queryFrustum(culler, eye, radius, results);
+        passed = sameItems(results, bruteFrustum(reference, culler, eye, radius), where + ": queryFrustum") && passed;
+    }
+    return passed;
+}
+
+bool checkRandomOperations() {
+    Random random;
+    SpatialGrid grid(CELL_SIZE);
+    Reference reference;
+    // Generation last used on each index, so new IDs for an index are new handles
+    std::vector<uint32_t> generations(INDEX_COUNT, 0);
+    uint32_t staleInserts = 0;
+
+    for (uint32_t op = 0; op < OPERATIONS; op++) {
+        uint32_t index = random.below(INDEX_COUNT);
+        auto present = reference.items().find(index);
+        uint32_t kind = random.below(10);
+
+        if (present == reference.items().end()) {
+            // Usually fill the index; sometimes remove or move an ID that is not there, which must do nothing
+            uint32_t id = makeEntity(index, ++generations[index]);
+            if (kind < 8) {
+                glm::vec3 position = randomPosition(random);
+                float radius = randomRadius(random);
+                grid.insert(id, position, radius);
+                reference.insert(id, position, radius);
+            } else {
+                grid.remove(id);
+            }
+            continue;
+        }
+
+        const Sphere current = present->second;
+        if (kind < 3) {
+            // A short move, which often stays in the cell
+            glm::vec3 position = current.position + glm::vec3(random.range(-4.0f, 4.0f), random.range(-2.0f, 2.0f),
+                                                              random.range(-4.0f, 4.0f));
+            float radius = randomRadius(random);
+            grid.update(current.id, position, radius);
+            reference.insert(current.id, position, radius);
+        } else if (kind < 5) {
+            // Anywhere, through insert on a present ID
+            glm::vec3 position = randomPosition(random);
+            float radius = randomRadius(random);
+            grid.insert(current.id, position, radius);
+            reference.insert(current.id, position, radius);
+        } else if (kind < 8) {
+            grid.remove(current.id);
+            reference.remove(current.id);
+        } else if (kind < 9) {
+            // A newer handle for the index while the old one is still in the grid
+            uint32_t id = makeEntity(index, ++generations[index]);
+            glm::vec3 position = randomPosition(random);
+            float radius = randomRadius(random);
+            grid.insert(id, position, radius);
+            reference.insert(id, position, radius);
+            if (grid.contains(current.id)) {
+                std::cout << "SpatialGridTest: stale item " << current.id << " still present after "
+                          << id << " took its index" << std::endl;
+                return false;
+            }
+            staleInserts++;
+        } else {
+            // Removing an older handle for a live index is a no-op
+            grid.remove(makeEntity(index, entityGeneration(current.id) - 1));
+        }
+
+        if ((op + 1) % CHECK_INTERVAL == 0 &&
+            !checkState(grid, reference, random, "after operation " + std::to_string(op + 1))) {
+            return false;
+        }
+    }
+
+    std::cout << "SpatialGridTest: " << OPERATIONS << " operations (" << staleInserts << " stale inserts), "
+              << grid.size() << " items in " << grid.getCellCount() << " cells at the end" << std::endl;
+    return true;
+}
+
+// One cell filled and emptied in every order a swap-remove can leave it in,
+// then refilled and a different cell used, which takes the recycled slot
+bool checkCellRecycling() {
+    Random random;
+    SpatialGrid grid(CELL_SIZE);
+    Reference reference;
+    auto add = [&](uint32_t id, const glm::vec3& position) {
+        grid.insert(id, position, 1.0f);
+        reference.insert(id, position, 1.0f);
+    };
+    auto drop = [&](uint32_t id) {
+        grid.remove(id);
+        reference.remove(id);
+    };
+
+    // Three items in cell (0, 0) and one elsewhere
+    add(1, glm::vec3(2.0f, 0.0f, 2.0f));
+    add(2, glm::vec3(8.0f, 0.0f, 3.0f));
+    add(3, glm::vec3(14.0f, 0.0f, 12.0f));
+    add(4, glm::vec3(-40.0f, 0.0f, 40.0f));
+    bool passed = checkState(grid, reference, random, "cell filled");
+
+    // The first slot: the last item moves into it
+    drop(1);
+    passed = checkState(grid, reference, random, "first of three removed") && passed;
+    // The moved item, from its new slot
+    drop(3);
+    passed = checkState(grid, reference, random, "moved item removed") && passed;
+    // The last item in the cell, which must then leave the index
+    drop(2);
+    passed = checkState(grid, reference, random, "cell emptied") && passed;
+
+    // Moving the last item out of a cell empties it too
+    add(5, glm::vec3(20.0f, 0.0f, 20.0f));
+    grid.update(5, glm::vec3(60.0f, 0.0f, -60.0f), 1.0f);
+    reference.insert(5, glm::vec3(60.0f, 0.0f, -60.0f), 1.0f);
+    passed = checkState(grid, reference, random, "last item moved away") && passed;
+
+    // New cells reuse the freed ones; nothing old may show up in them
+    add(6, glm::vec3(100.0f, 0.0f, 100.0f));
+    add(7, glm::vec3(3.0f, 0.0f, 5.0f));
+    add(8, glm::vec3(21.0f, 0.0f, 19.0f));
+    passed = checkState(grid, reference, random, "freed cells reused") && passed;
+
+    grid.clear();
+    reference = Reference();
+    passed = checkState(grid, reference, random, "cleared") && passed;
+    add(9, glm::vec3(-5.0f, 0.0f, -5.0f));
+    passed = checkState(grid, reference, random, "refilled after clear") && passed;
+    return passed;
+}
+}
+
+int main() {
+    bool passed = checkRandomOperations();
+    passed = checkCellRecycling() && passed;
+    std::cout << "SpatialGridTest: " << (passed ? "passed" : "FAILED") << std::endl;
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,152 @@
+#include "core/TerrainFunction.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+// TerrainFunction::height() (scalar) and heights() (the batch kernel this CPU
+// runs: AVX2, NEON or scalar) against a reference written the way the terrain
+// shader used to evaluate the height: GLSL's floor, mix, smoothstep, sin and
+// cos, here in double precision so float rounding in either path shows up as
+// a difference. Positions spread 8192 units around the origin, with some on
+// the noise lattice lines.
+namespace {
+// Tolerances in units of terrainHeight; heights() is documented to agree with
+// height() to within a few millionths of it
+constexpr double REFERENCE_TOLERANCE = 2e-5;
+constexpr double BATCH_TOLERANCE = 5e-6;
+
+double glslFloor(double x) { return std::floor(x); }
+double glslMix(double a, double b, double t) { return a * (1.0 - t) + b * t; }
+double glslSmoothstep(double edge0, double edge1, double x) {
+    double t = std::clamp((x - edge0) / (edge1 - edge0), 0.0, 1.0);
+    return t * t * (3.0 - 2.0 * t);
+}
+
+// The integer lattice hash is exact, so it is shared bit for bit
+double hash21(double x, double y) {
+    uint32_t h = static_cast<uint32_t>(static_cast<int32_t>(x)) * 0x8da6b343u ^
+                 static_cast<uint32_t>(static_cast<int32_t>(y)) * 0xd8163841u;
+    h ^= h >> 15;
+    h *= 0x2c1b3c6du;
+    h ^= h >> 12;
+    h *= 0x297a2d39u;
+    h ^= h >> 15;
+    return static_cast<double>(h >> 8) / 16777216.0;
+}
+
+double noise(double x, double y) {
+    double ix = glslFloor(x);
+    double iy = glslFloor(y);
+    double fx = x - ix;
+    double fy = y - iy;
+    fx = fx * fx * (3.0 - 2.0 * fx);
+    fy = fy * fy * (3.0 - 2.0 * fy);
+
+    double a = hash21(ix, iy);
+    double b = hash21(ix + 1.0, iy);
+    double c = hash21(ix, iy + 1.0);
+    double d = hash21(ix + 1.0, iy + 1.0);
+    return glslMix(glslMix(a, b, fx), glslMix(c, d, fx), fy);
+}
+
+double fbm(double x, double y, int octaves) {
+    double value = 0.0;
+    double amplitude = 0.5;
+    for (int i = 0; i < octaves; i++) {
+        value += amplitude * noise(x, y);
+        x *= 2.0;
+        y *= 2.0;
+        amplitude *= 0.5;
+    }
+    return value;
+}
+
+double referenceHeight(float worldX, float worldZ, const TerrainFunction::Parameters& parameters) {
+    double x = static_cast<double>(worldX) * parameters.terrainScale;
+    double z = static_cast<double>(worldZ) * parameters.terrainScale;
+    double height = 0.0;
+
+    height += std::sin(x * 0.008) * 15.0 + std::cos(z * 0.01) * 12.0;
+    height += std::sin(x * 0.02 + z * 0.015) * 8.0;
+    height += std::cos(x * 0.025) * std::cos(z * 0.03) * 5.0;
+
+    if (parameters.qualityLevel >= 1) {
+        height += fbm(x * 0.05, z * 0.05, 2) * 4.0;
+    }
+    if (parameters.qualityLevel >= 2) {
+        height += fbm(x * 0.1, z * 0.1, 1) * 2.0;
+    }
+
+    double river1 = std::abs(std::sin(x * 0.005 + std::cos(z * 0.003) * 2.0));
+    double river2 = std::abs(std::sin(z * 0.004 + std::cos(x * 0.006) * 1.5));
+    height -= glslSmoothstep(0.0, 0.3, 1.0 - river1) * 10.0;
+    height -= glslSmoothstep(0.0, 0.2, 1.0 - river2) * 8.0;
+
+    return height * parameters.terrainHeight * 0.01;
+}
+
+// Random positions from a fixed LCG, then lattice lines and a partial batch
+void makePositions(std::vector<float>& x, std::vector<float>& z) {
+    uint32_t state = 12345u;
+    auto next = [&state]() {
+        state = state * 1664525u + 1013904223u;
+        return static_cast<float>(state >> 8) * (1.0f / 16777216.0f);
+    };
+    for (int i = 0; i < 20000; i++) {
+        x.push_back((next() - 0.5f) * 8192.0f);
+        z.push_back((next() - 0.5f) * 8192.0f);
+    }
+    // Noise lattice lines at both fbm frequencies, and the origin
+    for (int i = -64; i <= 64; i++) {
+        x.push_back(static_cast<float>(i) * 20.0f);
+        z.push_back(static_cast<float>(i) * 10.0f);
+    }
+    // A count that leaves a partial batch at the end
+    x.push_back(3.25f);
+    z.push_back(-7.5f);
+}
+
+bool checkParameters(const std::vector<float>& x, const std::vector<float>& z,
+                     const TerrainFunction::Parameters& parameters) {
+    std::vector<float> batch(x.size());
+    TerrainFunction::heights(x.data(), z.data(), batch.data(), batch.size(), parameters);
+
+    double worstReference = 0.0;
+    double worstBatch = 0.0;
+    for (size_t i = 0; i < x.size(); i++) {
+        double reference = referenceHeight(x[i], z[i], parameters);
+        double scalar = TerrainFunction::height(glm::vec2(x[i], z[i]), parameters);
+        worstReference = std::max({worstReference, std::abs(scalar - reference),
+                                   std::abs(static_cast<double>(batch[i]) - reference)});
+        worstBatch = std::max(worstBatch, std::abs(static_cast<double>(batch[i]) - scalar));
+    }
+
+    worstReference /= parameters.terrainHeight;
+    worstBatch /= parameters.terrainHeight;
+    bool passed = worstReference <= REFERENCE_TOLERANCE && worstBatch <= BATCH_TOLERANCE;
+    std::cout << "TerrainFunctionTest: scale " << parameters.terrainScale << ", quality " << parameters.qualityLevel
+              << ": max error vs reference " << worstReference << ", " << TerrainFunction::batchKernel()
+              << " vs scalar " << worstBatch << " (of terrainHeight)" << (passed ? "" : " FAILED") << std::endl;
+    return passed;
+}
+}
+
+int main() {
+    std::vector<float> x;
+    std::vector<float> z;
+    makePositions(x, z);
+
+    bool passed = true;
+    for (float scale : {1.0f, 0.5f, 2.0f}) {
+        for (int quality = 0; quality <= 2; quality++) {
+            TerrainFunction::Parameters parameters;
+            parameters.terrainScale = scale;
+            parameters.qualityLevel = quality;
+            passed = checkParameters(x, z, parameters) && passed;
+        }
+    }
+    std::cout << "TerrainFunctionTest: " << (passed ? "passed" : "FAILED") << std::endl;
+    return passed ? 0 : 1;
+}